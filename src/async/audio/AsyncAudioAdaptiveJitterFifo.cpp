@@ -0,0 +1,654 @@
+/**
+@file	 AsyncAudioAdaptiveJitterFifo.cpp
+@brief   A jitter buffer that adapt its size to the packet jitter
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-06-11
+
+Implements a playout buffer for audio received from a packet network. The
+buffer depth is adapted to the measured packet jitter.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioAdaptiveJitterFifo.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+static const unsigned  MAX_WRITE_SIZE = 800;
+
+  // The interval in milliseconds for the playout timer
+static const int       PLAYOUT_INTERVAL = 10;
+
+  // Minimum time in milliseconds between two time scale adjustments
+static const unsigned  ADJUST_INTERVAL = 100;
+
+  // The pitch period search range and overlap length in milliseconds used
+  // for time scale modification
+static const float     MIN_PITCH_LAG = 2.5f;
+static const float     MAX_PITCH_LAG = 12.5f;
+static const float     OVERLAP_LEN = 10.0f;
+
+  // Minimum normalized correlation for a segment to be considered periodic
+  // enough to be compressed or expanded without audible artifacts
+static const float     MIN_CORRELATION = 0.6f;
+
+  // Segments with a mean power below this is considered to be silence
+static const float     SILENCE_POWER = 1.0e-5f;
+
+  // The jitter estimate is multiplied by this factor to get the delay
+static const double    JITTER_FACTOR = 4.0;
+
+  // The per packet decay factor for the peak delay estimate
+static const double    PEAK_DECAY = 0.998;
+
+  // Writes closer in time than this, in milliseconds, are regarded as parts
+  // of the same packet, e.g. the frames of a multi frame codec packet
+static const double    SAME_PACKET_TIME = 1.0;
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+AudioAdaptiveJitterFifo::AudioAdaptiveJitterFifo(unsigned min_delay_ms,
+                                                 unsigned max_delay_ms,
+                                                 unsigned sample_rate)
+  : sample_rate(sample_rate), min_delay(0), max_delay(0), rd_pos(0),
+    playout_timer(PLAYOUT_INTERVAL, Timer::TYPE_PERIODIC, false),
+    playout_timer_enabled(true), playing(false), is_flushing(false),
+    output_stopped(false), underrun(false), spurt_active(false),
+    spurt_start(0.0), spurt_samples(0), prev_transit(0.0),
+    packet_time(0.0), packet_samples(0), jitter(0.0),
+    peak_delay(0.0), target_delay(0), playout_start(0.0), samples_played(0),
+    samples_since_adjust(0)
+{
+  assert(sample_rate > 0);
+  setDelayLimits(min_delay_ms, max_delay_ms);
+  target_delay = min_delay;
+  resetStatistics();
+  playout_timer.expired.connect(
+      sigc::hide(sigc::mem_fun(*this, &AudioAdaptiveJitterFifo::playout)));
+} /* AudioAdaptiveJitterFifo::AudioAdaptiveJitterFifo */
+
+
+AudioAdaptiveJitterFifo::~AudioAdaptiveJitterFifo(void)
+{
+} /* AudioAdaptiveJitterFifo::~AudioAdaptiveJitterFifo */
+
+
+void AudioAdaptiveJitterFifo::setDelayLimits(unsigned min_delay_ms,
+                                             unsigned max_delay_ms)
+{
+  max_delay_ms = max(min_delay_ms, max_delay_ms);
+  min_delay = min_delay_ms * sample_rate / 1000;
+  max_delay = max_delay_ms * sample_rate / 1000;
+  target_delay = min(max(target_delay, min_delay), max_delay);
+} /* AudioAdaptiveJitterFifo::setDelayLimits */
+
+
+void AudioAdaptiveJitterFifo::clear(void)
+{
+  bool was_empty = empty();
+
+  buf.clear();
+  rd_pos = 0;
+  playing = false;
+  output_stopped = false;
+  underrun = false;
+  spurt_active = false;
+
+  if (is_flushing)
+  {
+    is_flushing = false;
+    if (!was_empty)
+    {
+      sinkFlushSamples();
+    }
+  }
+
+  updatePlayoutTimer();
+} /* AudioAdaptiveJitterFifo::clear */
+
+
+AudioAdaptiveJitterFifo::Statistics
+AudioAdaptiveJitterFifo::statistics(void) const
+{
+  Statistics s(stats);
+  s.jitter_ms = jitter;
+  s.target_delay_ms = 1000 * target_delay / sample_rate;
+  s.depth_ms = 1000 * samplesInFifo() / sample_rate;
+  return s;
+} /* AudioAdaptiveJitterFifo::statistics */
+
+
+void AudioAdaptiveJitterFifo::resetStatistics(void)
+{
+  stats.packets = 0;
+  stats.late_packets = 0;
+  stats.underruns = 0;
+  stats.discarded_samples = 0;
+  stats.compressions = 0;
+  stats.expansions = 0;
+  stats.jitter_ms = 0.0f;
+  stats.target_delay_ms = 0;
+  stats.depth_ms = 0;
+  stats.max_depth_ms = 0;
+} /* AudioAdaptiveJitterFifo::resetStatistics */
+
+
+void AudioAdaptiveJitterFifo::setPlayoutTimerEnabled(bool enable)
+{
+  playout_timer_enabled = enable;
+  updatePlayoutTimer();
+} /* AudioAdaptiveJitterFifo::setPlayoutTimerEnabled */
+
+
+void AudioAdaptiveJitterFifo::playout(void)
+{
+  if (output_stopped)
+  {
+    return;
+  }
+
+  double now = currentTime();
+  if (!playing)
+  {
+    if (!is_flushing || empty())
+    {
+      updatePlayoutTimer();
+      return;
+    }
+      // End of talk spurt before the target delay was reached
+    startPlayout(now);
+  }
+
+  double due_total = (now - playout_start) * sample_rate / 1000.0;
+  while (due_total > samples_played)
+  {
+    if (empty())
+    {
+      if (!is_flushing)
+      {
+          // The buffer ran dry in the middle of a talk spurt. Increase the
+          // target delay and start buffering again.
+        ++stats.underruns;
+        underrun = true;
+        playing = false;
+        peak_delay = max(peak_delay,
+                         1500.0 * target_delay / sample_rate);
+        updateTarget(0);
+      }
+      break;
+    }
+
+    adjustTimeScale();
+
+    unsigned due = static_cast<unsigned>(due_total - samples_played);
+    unsigned count = min(max(due, 1U), min(samplesInFifo(), MAX_WRITE_SIZE));
+    int written = sinkWriteSamples(&buf[rd_pos], count);
+    rd_pos += written;
+    samples_played += written;
+    samples_since_adjust += written;
+    if (written < static_cast<int>(count))
+    {
+      output_stopped = true;
+      break;
+    }
+  }
+
+  if (rd_pos > MAX_WRITE_SIZE)
+  {
+    buf.erase(buf.begin(), buf.begin() + rd_pos);
+    rd_pos = 0;
+  }
+
+  if (playing && empty() && is_flushing && !output_stopped)
+  {
+    playing = false;
+    spurt_active = false;
+    underrun = false;
+    sinkFlushSamples();
+  }
+
+  updatePlayoutTimer();
+} /* AudioAdaptiveJitterFifo::playout */
+
+
+int AudioAdaptiveJitterFifo::writeSamples(const float *samples, int count)
+{
+  assert(count > 0);
+
+  double now = currentTime();
+  is_flushing = false;
+
+  if (spurt_active && (now - packet_time < SAME_PACKET_TIME))
+  {
+      // More audio from the packet that arrived last
+    spurt_samples += count;
+    packet_samples += count;
+    updateTarget(packet_samples);
+  }
+  else
+  {
+    ++stats.packets;
+    if (underrun)
+    {
+      ++stats.late_packets;
+      underrun = false;
+    }
+    updateJitter(now, count);
+  }
+
+  buf.insert(buf.end(), samples, samples + count);
+  if (samplesInFifo() > max_delay + static_cast<unsigned>(count))
+  {
+      // Too much audio buffered, e.g. after a network stall. Throw away the
+      // oldest samples.
+    unsigned discard = samplesInFifo() - max_delay;
+    rd_pos += discard;
+    stats.discarded_samples += discard;
+  }
+  stats.max_depth_ms = max(stats.max_depth_ms,
+                           1000 * samplesInFifo() / sample_rate);
+
+  if (!playing && (samplesInFifo() >= target_delay))
+  {
+    startPlayout(now);
+  }
+
+  playout();
+
+  return count;
+  
+} /* AudioAdaptiveJitterFifo::writeSamples */
+
+
+void AudioAdaptiveJitterFifo::flushSamples(void)
+{
+  is_flushing = true;
+  if (empty())
+  {
+    playing = false;
+    spurt_active = false;
+    underrun = false;
+    sinkFlushSamples();
+    updatePlayoutTimer();
+  }
+  else
+  {
+    playout();
+  }
+} /* AudioAdaptiveJitterFifo::flushSamples */
+
+
+void AudioAdaptiveJitterFifo::resumeOutput(void)
+{
+  if (output_stopped)
+  {
+    output_stopped = false;
+    if (playing)
+    {
+        // Restart the playout clock since the sink have been pacing the
+        // output while it was stopped
+      playout_start = currentTime();
+      samples_played = 0;
+    }
+    playout();
+  }
+} /* AudioAdaptiveJitterFifo::resumeOutput */
+
+
+
+std::ostream& Async::operator<<(std::ostream& os,
+    const Async::AudioAdaptiveJitterFifo::Statistics& stats)
+{
+  return os << "jitter=" << static_cast<unsigned>(stats.jitter_ms + 0.5f)
+            << "ms target_delay=" << stats.target_delay_ms << "ms "
+            << "max_depth=" << stats.max_depth_ms << "ms "
+            << "packets=" << stats.packets << " "
+            << "late=" << stats.late_packets << " "
+            << "underruns=" << stats.underruns << " "
+            << "discarded=" << stats.discarded_samples << " "
+            << "compressions=" << stats.compressions << " "
+            << "expansions=" << stats.expansions;
+} /* Async::operator<< */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+void AudioAdaptiveJitterFifo::allSamplesFlushed(void)
+{
+  if (is_flushing && empty())
+  {
+    is_flushing = false;
+    sourceAllSamplesFlushed();
+  }
+} /* AudioAdaptiveJitterFifo::allSamplesFlushed */
+
+
+void AudioAdaptiveJitterFifo::getTime(struct timeval &tv)
+{
+  gettimeofday(&tv, NULL);
+} /* AudioAdaptiveJitterFifo::getTime */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+double AudioAdaptiveJitterFifo::currentTime(void)
+{
+  struct timeval tv;
+  getTime(tv);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+} /* AudioAdaptiveJitterFifo::currentTime */
+
+
+void AudioAdaptiveJitterFifo::updateJitter(double now, int count)
+{
+  if (!spurt_active)
+  {
+    spurt_active = true;
+    spurt_start = now;
+    spurt_samples = 0;
+    prev_transit = 0.0;
+  }
+
+    // The transit time is the arrival time relative to the expected arrival
+    // time calculated from the first packet in the talk spurt and the
+    // number of samples received
+  double transit = now - spurt_start - 1000.0 * spurt_samples / sample_rate;
+  if (transit < 0.0)
+  {
+      // The packet arrived earlier than any packet before. Use it as the
+      // new reference.
+    spurt_start += transit;
+    prev_transit -= transit;
+    transit = 0.0;
+  }
+  if (spurt_samples > 0)
+  {
+      // Interarrival jitter estimate as specified in RFC 3550
+    jitter += (fabs(transit - prev_transit) - jitter) / 16.0;
+  }
+  prev_transit = transit;
+  spurt_samples += count;
+  packet_time = now;
+  packet_samples = count;
+
+  peak_delay = max(peak_delay * PEAK_DECAY, transit);
+
+  updateTarget(count);
+} /* AudioAdaptiveJitterFifo::updateJitter */
+
+
+void AudioAdaptiveJitterFifo::updateTarget(unsigned packet_samples)
+{
+  double delay_ms = max(JITTER_FACTOR * jitter, peak_delay);
+  unsigned delay = static_cast<unsigned>(delay_ms * sample_rate / 1000.0);
+  target_delay = min(max(delay + packet_samples, min_delay), max_delay);
+} /* AudioAdaptiveJitterFifo::updateTarget */
+
+
+void AudioAdaptiveJitterFifo::startPlayout(double now)
+{
+  playing = true;
+  playout_start = now;
+  samples_played = 0;
+  samples_since_adjust = 0;
+} /* AudioAdaptiveJitterFifo::startPlayout */
+
+
+void AudioAdaptiveJitterFifo::adjustTimeScale(void)
+{
+  if (is_flushing ||
+      (samples_since_adjust < ADJUST_INTERVAL * sample_rate / 1000))
+  {
+    return;
+  }
+
+  const unsigned max_lag = static_cast<unsigned>(
+      MAX_PITCH_LAG * sample_rate / 1000);
+  const unsigned overlap = static_cast<unsigned>(
+      OVERLAP_LEN * sample_rate / 1000);
+  if (samplesInFifo() < max_lag + overlap)
+  {
+    return;
+  }
+
+  const unsigned hysteresis = max(10 * sample_rate / 1000, target_delay / 4);
+  bool do_compress = (samplesInFifo() > target_delay + hysteresis);
+  bool do_expand = (samplesInFifo() + hysteresis < target_delay);
+  if (!do_compress && !do_expand)
+  {
+    return;
+  }
+
+  float corr;
+  unsigned lag = findPitchLag(&buf[rd_pos], corr);
+  if (corr < MIN_CORRELATION)
+  {
+      // Not periodic enough. Try again a little later.
+    samples_since_adjust -= overlap;
+    return;
+  }
+
+  if (do_compress)
+  {
+    compress(lag);
+    ++stats.compressions;
+  }
+  else
+  {
+    expand(lag);
+    ++stats.expansions;
+  }
+  samples_since_adjust = 0;
+} /* AudioAdaptiveJitterFifo::adjustTimeScale */
+
+
+unsigned AudioAdaptiveJitterFifo::findPitchLag(const float *x,
+                                               float &corr) const
+{
+  const unsigned min_lag = static_cast<unsigned>(
+      MIN_PITCH_LAG * sample_rate / 1000);
+  const unsigned max_lag = static_cast<unsigned>(
+      MAX_PITCH_LAG * sample_rate / 1000);
+  const unsigned overlap = static_cast<unsigned>(
+      OVERLAP_LEN * sample_rate / 1000);
+
+  double e1 = 0.0;
+  for (unsigned i=0; i<overlap; ++i)
+  {
+    e1 += x[i] * x[i];
+  }
+  if (e1 < SILENCE_POWER * overlap)
+  {
+      // Silence can be compressed or expanded by any amount
+    corr = 1.0f;
+    return min_lag;
+  }
+
+  unsigned best_lag = min_lag;
+  corr = -1.0f;
+  for (unsigned lag=min_lag; lag<=max_lag; ++lag)
+  {
+    double c = 0.0;
+    double e2 = 0.0;
+    for (unsigned i=0; i<overlap; ++i)
+    {
+      c += x[i] * x[i+lag];
+      e2 += x[i+lag] * x[i+lag];
+    }
+    if (e2 <= 0.0)
+    {
+      continue;
+    }
+    float nc = static_cast<float>(c / sqrt(e1 * e2));
+    if (nc > corr)
+    {
+      corr = nc;
+      best_lag = lag;
+    }
+  }
+
+  return best_lag;
+} /* AudioAdaptiveJitterFifo::findPitchLag */
+
+
+void AudioAdaptiveJitterFifo::compress(unsigned lag)
+{
+    // Cross fade from the current segment into the segment one pitch
+    // period later and then continue after that segment. This remove
+    // lag samples from the stream.
+  const unsigned overlap = static_cast<unsigned>(
+      OVERLAP_LEN * sample_rate / 1000);
+  float *x = &buf[rd_pos];
+  for (unsigned i=0; i<overlap; ++i)
+  {
+    float w = (i + 0.5f) / overlap;
+    x[i] = (1.0f - w) * x[i] + w * x[i+lag];
+  }
+  buf.erase(buf.begin() + rd_pos + overlap,
+            buf.begin() + rd_pos + overlap + lag);
+} /* AudioAdaptiveJitterFifo::compress */
+
+
+void AudioAdaptiveJitterFifo::expand(unsigned lag)
+{
+    // Play one pitch period and then cross fade back to the start of the
+    // segment, in effect repeating one pitch period. This add lag samples
+    // to the stream.
+  const unsigned overlap = static_cast<unsigned>(
+      OVERLAP_LEN * sample_rate / 1000);
+  const float *x = &buf[rd_pos];
+  vector<float> y(lag + overlap);
+  for (unsigned i=0; i<lag; ++i)
+  {
+    y[i] = x[i];
+  }
+  for (unsigned i=0; i<overlap; ++i)
+  {
+    float w = (i + 0.5f) / overlap;
+    y[lag+i] = (1.0f - w) * x[lag+i] + w * x[i];
+  }
+  buf.erase(buf.begin() + rd_pos, buf.begin() + rd_pos + overlap);
+  buf.insert(buf.begin() + rd_pos, y.begin(), y.end());
+} /* AudioAdaptiveJitterFifo::expand */
+
+
+void AudioAdaptiveJitterFifo::updatePlayoutTimer(void)
+{
+  playout_timer.setEnable(playout_timer_enabled && !output_stopped &&
+                          (playing || (is_flushing && !empty())));
+} /* AudioAdaptiveJitterFifo::updatePlayoutTimer */
+
+
+
+/*
+ * This file has not been truncated
+ */
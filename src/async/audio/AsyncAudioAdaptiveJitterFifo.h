@@ -0,0 +1,339 @@
+/**
+@file	 AsyncAudioAdaptiveJitterFifo.h
+@brief   A jitter buffer that adapt its size to the packet jitter
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-06-11
+
+Implements a playout buffer for audio received from a packet network. The
+buffer depth is adapted to the measured packet jitter.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef ASYNC_AUDIO_ADAPTIVE_JITTER_FIFO_INCLUDED
+#define ASYNC_AUDIO_ADAPTIVE_JITTER_FIFO_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/time.h>
+#include <sigc++/sigc++.h>
+
+#include <vector>
+#include <iosfwd>
+
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioSink.h>
+#include <AsyncAudioSource.h>
+#include <AsyncTimer.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+  
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	An adaptive playout buffer for audio received from a network
+@author Tobias Blomberg / SM0SVX
+@date   2017-06-11
+
+This class implements a playout buffer for audio that is received in packets
+from a network. Calls to writeSamples made at the same time are regarded as
+the arrival of one packet, so a packet may be written one codec frame at a
+time. The arrival times are used to estimate the packet jitter and from
+that a target buffer delay is calculated, bounded by the given minimum and
+maximum delays.
+
+Audio is written to the connected sink in real time, paced by an internal
+timer. At the start of each talk spurt, samples are buffered until the
+target delay is reached. If the buffer runs dry in the middle of a talk
+spurt, the target delay is increased and the buffer is filled up again
+before playout continues. During a talk spurt, the buffer depth is slowly
+moved towards the target delay by compressing or expanding the audio in
+time using waveform similarity overlap-add (WSOLA). One pitch period at a
+time is removed or repeated so the adjustments are hardly audible.
+
+The internal timer may be disabled. In that case the user must call the
+playout function periodically. This, together with reimplementing the
+getTime function, make it possible to simulate the buffer behaviour.
+*/
+class AudioAdaptiveJitterFifo : public AudioSink, public AudioSource,
+                                public sigc::trackable
+{
+  public:
+    /**
+     * @brief Statistics for the jitter buffer
+     */
+    struct Statistics
+    {
+      unsigned packets;           ///< Number of received packets
+      unsigned late_packets;      ///< Packets arriving after their play time
+      unsigned underruns;         ///< Number of times the buffer ran dry
+      unsigned discarded_samples; ///< Samples discarded due to overflow
+      unsigned compressions;      ///< Number of time compressions done
+      unsigned expansions;        ///< Number of time expansions done
+      float    jitter_ms;         ///< Current packet jitter estimate
+      unsigned target_delay_ms;   ///< Current target buffer delay
+      unsigned depth_ms;          ///< Current buffer depth
+      unsigned max_depth_ms;      ///< Maximum buffer depth seen
+    };
+
+    /**
+     * @brief 	Constuctor
+     * @param   min_delay_ms The minimum buffer delay in milliseconds
+     * @param   max_delay_ms The maximum buffer delay in milliseconds
+     * @param   sample_rate  The sample rate of the audio stream
+     */
+    AudioAdaptiveJitterFifo(unsigned min_delay_ms, unsigned max_delay_ms,
+                            unsigned sample_rate=INTERNAL_SAMPLE_RATE);
+  
+    /**
+     * @brief 	Destructor
+     */
+    virtual ~AudioAdaptiveJitterFifo(void);
+  
+    /**
+     * @brief	Set the delay limits for the buffer
+     * @param   min_delay_ms The minimum buffer delay in milliseconds
+     * @param   max_delay_ms The maximum buffer delay in milliseconds
+     */
+    void setDelayLimits(unsigned min_delay_ms, unsigned max_delay_ms);
+    
+    /**
+     * @brief 	Check if the FIFO is empty
+     * @return	Returns \em true if the FIFO is empty or else \em false
+     */
+    bool empty(void) const { return samplesInFifo() == 0; }
+    
+    /**
+     * @brief 	Find out how many samples there are in the FIFO
+     * @return	Returns the number of samples in the FIFO
+     */
+    unsigned samplesInFifo(void) const { return buf.size() - rd_pos; }
+    
+    /**
+     * @brief 	Clear all samples from the FIFO
+     *
+     * This will immediately reset the FIFO and discard all samples. The
+     * jitter estimate is kept.
+     */
+    void clear(void);
+
+    /**
+     * @brief   Get the buffer statistics
+     * @return  Returns the current statistics
+     */
+    Statistics statistics(void) const;
+
+    /**
+     * @brief   Reset all statistics counters
+     */
+    void resetStatistics(void);
+
+    /**
+     * @brief   Enable or disable the internal playout timer
+     * @param   enable Set to \em true to enable the timer
+     *
+     * The playout timer is enabled by default. If it is disabled, the
+     * playout function must be called periodically by the user.
+     */
+    void setPlayoutTimerEnabled(bool enable);
+
+    /**
+     * @brief   Write all samples that are due for playout to the sink
+     *
+     * This function is normally called by the internal playout timer.
+     */
+    void playout(void);
+
+    /**
+     * @brief 	Write samples into the FIFO
+     * @param 	samples The buffer containing the samples
+     * @param 	count The number of samples in the buffer
+     * @return	Returns the number of samples that has been taken care of
+     *
+     * This function is used to write audio into the FIFO. Calls made at
+     * the same time are regarded as the arrival of one packet. All samples
+     * are always taken care of.
+     * This function is normally only called from a connected source object.
+     */
+    virtual int writeSamples(const float *samples, int count);
+    
+    /**
+     * @brief 	Tell the FIFO to flush the previously written samples
+     *
+     * This function is used to tell the FIFO to flush previously written
+     * samples. It marks the end of a talk spurt.
+     * This function is normally only called from a connected source object.
+     */
+    virtual void flushSamples(void);
+    
+    /**
+     * @brief Resume audio output to the connected sink
+     * 
+     * This function will be called when the registered audio sink is ready
+     * to accept more samples.
+     * This function is normally only called from a connected sink object.
+     */
+    virtual void resumeOutput(void);
+    
+    
+  protected:
+    /**
+     * @brief The registered sink has flushed all samples
+     *
+     * This function will be called when all samples have been flushed in the
+     * registered sink.
+     * This function is normally only called from a connected sink object.
+     */
+    virtual void allSamplesFlushed(void);
+
+    /**
+     * @brief   Get the current time
+     * @param   tv Will be filled in with the current time
+     *
+     * This function is used to read the clock that packet arrival and
+     * playout is timed against. Reimplement it to run the buffer on a
+     * simulated clock.
+     */
+    virtual void getTime(struct timeval &tv);
+    
+    
+  private:
+    unsigned            sample_rate;
+    unsigned            min_delay;
+    unsigned            max_delay;
+    std::vector<float>  buf;
+    unsigned            rd_pos;
+    Async::Timer        playout_timer;
+    bool                playout_timer_enabled;
+    bool                playing;
+    bool                is_flushing;
+    bool                output_stopped;
+    bool                underrun;
+    bool                spurt_active;
+    double              spurt_start;
+    unsigned long       spurt_samples;
+    double              prev_transit;
+    double              packet_time;
+    unsigned            packet_samples;
+    double              jitter;
+    double              peak_delay;
+    unsigned            target_delay;
+    double              playout_start;
+    unsigned long       samples_played;
+    unsigned            samples_since_adjust;
+    Statistics          stats;
+
+    double currentTime(void);
+    void updateJitter(double now, int count);
+    void updateTarget(unsigned packet_samples);
+    void startPlayout(double now);
+    void adjustTimeScale(void);
+    unsigned findPitchLag(const float *x, float &corr) const;
+    void compress(unsigned lag);
+    void expand(unsigned lag);
+    void updatePlayoutTimer(void);
+
+};  /* class AudioAdaptiveJitterFifo */
+
+
+/**
+ * @brief   Output jitter buffer statistics in a form suitable for logging
+ * @param   os    The stream to output data to
+ * @param   stats The statistics to output
+ */
+std::ostream& operator<<(std::ostream& os,
+                         const AudioAdaptiveJitterFifo::Statistics& stats);
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_ADAPTIVE_JITTER_FIFO_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,397 @@
+/**
+@file	 AsyncAudioCodecPool.cpp
+@brief   A thread pool used to run audio codecs outside of the main thread
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-17
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstring>
+#include <cstdio>
+
+#include <iostream>
+#include <algorithm>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncFdWatch.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioCodecPool.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+unsigned AudioCodecPool::default_thread_cnt = 0;
+AudioCodecPool *AudioCodecPool::default_pool = 0;
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+AudioCodecPool::Strand::Strand(AudioCodecPool *pool)
+  : pool(pool), scheduled(false), running(false)
+{
+} /* AudioCodecPool::Strand::Strand */
+
+
+AudioCodecPool::Strand::~Strand(void)
+{
+  pool->removeStrand(this);
+} /* AudioCodecPool::Strand::~Strand */
+
+
+void AudioCodecPool::Strand::post(Job *job)
+{
+  pool->post(this, job);
+} /* AudioCodecPool::Strand::post */
+
+
+void AudioCodecPool::setDefaultThreadCount(unsigned thread_cnt)
+{
+  default_thread_cnt = thread_cnt;
+} /* AudioCodecPool::setDefaultThreadCount */
+
+
+unsigned AudioCodecPool::defaultThreadCount(void)
+{
+  return default_thread_cnt;
+} /* AudioCodecPool::defaultThreadCount */
+
+
+AudioCodecPool *AudioCodecPool::defaultPool(void)
+{
+  if ((default_pool == 0) && (default_thread_cnt > 0))
+  {
+    default_pool = new AudioCodecPool(default_thread_cnt);
+  }
+  return default_pool;
+} /* AudioCodecPool::defaultPool */
+
+
+AudioCodecPool::AudioCodecPool(unsigned thread_cnt)
+  : stopping(false), notify_watch(0)
+{
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&work_cond, NULL);
+  pthread_cond_init(&idle_cond, NULL);
+
+  if (pipe(notify_pipe) == -1)
+  {
+    perror("*** ERROR: AudioCodecPool: pipe");
+    notify_pipe[0] = notify_pipe[1] = -1;
+    return;
+  }
+  for (int i=0; i<2; ++i)
+  {
+    int flags = fcntl(notify_pipe[i], F_GETFL);
+    fcntl(notify_pipe[i], F_SETFL, flags | O_NONBLOCK);
+  }
+  notify_watch = new FdWatch(notify_pipe[0], FdWatch::FD_WATCH_RD);
+  notify_watch->activity.connect(mem_fun(*this, &AudioCodecPool::onNotify));
+
+  for (unsigned i=0; i<thread_cnt; ++i)
+  {
+    pthread_t thread;
+    int ret = pthread_create(&thread, NULL, workerThread, this);
+    if (ret != 0)
+    {
+      cerr << "*** WARNING: AudioCodecPool: Could not create worker thread: "
+           << strerror(ret) << endl;
+      break;
+    }
+    threads.push_back(thread);
+  }
+} /* AudioCodecPool::AudioCodecPool */
+
+
+AudioCodecPool::~AudioCodecPool(void)
+{
+  pthread_mutex_lock(&mutex);
+  stopping = true;
+  pthread_cond_broadcast(&work_cond);
+  pthread_mutex_unlock(&mutex);
+  for (size_t i=0; i<threads.size(); ++i)
+  {
+    pthread_join(threads[i], NULL);
+  }
+  threads.clear();
+
+  while (!done.empty())
+  {
+    delete done.front().second;
+    done.pop_front();
+  }
+
+  delete notify_watch;
+  if (notify_pipe[0] != -1)
+  {
+    close(notify_pipe[0]);
+    close(notify_pipe[1]);
+  }
+  pthread_cond_destroy(&idle_cond);
+  pthread_cond_destroy(&work_cond);
+  pthread_mutex_destroy(&mutex);
+
+  if (this == default_pool)
+  {
+    default_pool = 0;
+  }
+} /* AudioCodecPool::~AudioCodecPool */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void *AudioCodecPool::workerThread(void *data)
+{
+  AudioCodecPool *pool = reinterpret_cast<AudioCodecPool *>(data);
+  pool->work();
+  return NULL;
+} /* AudioCodecPool::workerThread */
+
+
+void AudioCodecPool::work(void)
+{
+  pthread_mutex_lock(&mutex);
+  for (;;)
+  {
+    while (ready.empty() && !stopping)
+    {
+      pthread_cond_wait(&work_cond, &mutex);
+    }
+    if (stopping)
+    {
+      break;
+    }
+
+      // Only one job from each strand is running at any time. The strand is
+      // put back last in the ready queue if it has more jobs so that a busy
+      // stream cannot starve the others.
+    Strand *strand = ready.front();
+    ready.pop_front();
+    strand->scheduled = false;
+    strand->running = true;
+    Job *job = strand->jobs.front();
+    strand->jobs.pop_front();
+    pthread_mutex_unlock(&mutex);
+
+    job->run();
+
+    pthread_mutex_lock(&mutex);
+    bool notify = done.empty();
+    done.push_back(DoneJob(strand, job));
+    strand->running = false;
+    if (!strand->jobs.empty())
+    {
+      strand->scheduled = true;
+      ready.push_back(strand);
+      pthread_cond_signal(&work_cond);
+    }
+    pthread_cond_broadcast(&idle_cond);
+    if (notify)
+    {
+      char ch = 0;
+      if (write(notify_pipe[1], &ch, 1) == -1) {}
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+} /* AudioCodecPool::work */
+
+
+void AudioCodecPool::post(Strand *strand, Job *job)
+{
+  if (threads.empty())
+  {
+      // No worker threads could be started. Run the job right away but
+      // still complete it from the event loop, like when using threads.
+    job->run();
+    pthread_mutex_lock(&mutex);
+    bool notify = done.empty();
+    done.push_back(DoneJob(strand, job));
+    pthread_mutex_unlock(&mutex);
+    if (notify && (notify_pipe[1] != -1))
+    {
+      char ch = 0;
+      if (write(notify_pipe[1], &ch, 1) == -1) {}
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&mutex);
+  strand->jobs.push_back(job);
+  if (!strand->scheduled && !strand->running)
+  {
+    strand->scheduled = true;
+    ready.push_back(strand);
+    pthread_cond_signal(&work_cond);
+  }
+  pthread_mutex_unlock(&mutex);
+} /* AudioCodecPool::post */
+
+
+void AudioCodecPool::removeStrand(Strand *strand)
+{
+  pthread_mutex_lock(&mutex);
+  while (!strand->jobs.empty())
+  {
+    delete strand->jobs.front();
+    strand->jobs.pop_front();
+  }
+  if (strand->scheduled)
+  {
+    ready.erase(find(ready.begin(), ready.end(), strand));
+    strand->scheduled = false;
+  }
+  while (strand->running)
+  {
+    pthread_cond_wait(&idle_cond, &mutex);
+  }
+  deque<DoneJob>::iterator it = done.begin();
+  while (it != done.end())
+  {
+    if (it->first == strand)
+    {
+      delete it->second;
+      it = done.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+} /* AudioCodecPool::removeStrand */
+
+
+void AudioCodecPool::onNotify(FdWatch *w)
+{
+  char buf[64];
+  while (read(notify_pipe[0], buf, sizeof(buf)) > 0) {}
+
+    // Complete one job at a time without holding the lock. A completion
+    // handler may delete a strand, which remove its jobs from the queue.
+  for (;;)
+  {
+    pthread_mutex_lock(&mutex);
+    if (done.empty())
+    {
+      pthread_mutex_unlock(&mutex);
+      break;
+    }
+    Job *job = done.front().second;
+    done.pop_front();
+    pthread_mutex_unlock(&mutex);
+
+    job->complete();
+    delete job;
+  }
+} /* AudioCodecPool::onNotify */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,272 @@
+/**
+@file	 AsyncAudioCodecPool.h
+@brief   A thread pool used to run audio codecs outside of the main thread
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-17
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_AUDIO_CODEC_POOL_INCLUDED
+#define ASYNC_AUDIO_CODEC_POOL_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <pthread.h>
+
+#include <deque>
+#include <vector>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+class FdWatch;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	A thread pool used to run audio codecs outside of the main thread
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-17
+
+This class is a pool of worker threads that run jobs, like encoding a block
+of audio, and then deliver the result back to the main thread, where the
+event loop run. Jobs are posted to a strand. All jobs posted to the same
+strand are run in order, one at a time, and completed in the same order. Jobs
+in different strands may run in parallel. Normally there is one strand for
+each encoder or decoder, so the codec state is only used by one thread at a
+time.
+
+The pool is normally not used directly but through the
+Async::AudioEncoderThreaded and Async::AudioDecoderThreaded classes. If the
+default thread count is set to a value larger than zero, the
+AudioEncoder::create and AudioDecoder::create functions automatically wrap the
+CPU heavy codecs so that they use the default pool.
+
+The pool must be created and used from the main thread, after the
+application object has been created.
+*/
+class AudioCodecPool
+{
+  public:
+    /**
+     * @brief A job to run in a worker thread
+     */
+    class Job
+    {
+      public:
+        /**
+         * @brief Destructor
+         */
+        virtual ~Job(void) {}
+
+        /**
+         * @brief Run the job. Called by a worker thread.
+         */
+        virtual void run(void) = 0;
+
+        /**
+         * @brief Complete the job. Called by the main thread after run.
+         */
+        virtual void complete(void) = 0;
+    };
+
+    /**
+     * @brief A sequence of jobs that must be run in order
+     */
+    class Strand
+    {
+      public:
+        /**
+         * @brief   Constructor
+         * @param   pool The pool to run the jobs in
+         */
+        explicit Strand(AudioCodecPool *pool);
+
+        /**
+         * @brief   Destructor
+         *
+         * Jobs that have not been run yet are deleted without being run.
+         * If a job is running, the destructor wait until it has finished.
+         * Jobs that have been run but not completed are deleted without
+         * being completed.
+         */
+        ~Strand(void);
+
+        /**
+         * @brief   Post a job to this strand
+         * @param   job The job to post. Ownership is taken over.
+         */
+        void post(Job *job);
+
+      private:
+        AudioCodecPool    *pool;
+        std::deque<Job*>  jobs;
+        bool              scheduled;
+        bool              running;
+
+        Strand(const Strand&);
+        Strand& operator=(const Strand&);
+
+        friend class AudioCodecPool;
+    };
+
+    /**
+     * @brief   Set the number of threads to use in the default pool
+     * @param   thread_cnt The number of threads, 0 to disable the pool
+     *
+     * This function must be called before the default pool is used for the
+     * first time.
+     */
+    static void setDefaultThreadCount(unsigned thread_cnt);
+
+    /**
+     * @brief   Get the number of threads to use in the default pool
+     * @return  Returns the thread count, 0 if the default pool is disabled
+     */
+    static unsigned defaultThreadCount(void);
+
+    /**
+     * @brief   Get the default pool
+     * @return  Returns the default pool or 0 if it is disabled
+     *
+     * The default pool is created on first use.
+     */
+    static AudioCodecPool *defaultPool(void);
+
+    /**
+     * @brief 	Constructor
+     * @param 	thread_cnt The number of worker threads to start
+     */
+    explicit AudioCodecPool(unsigned thread_cnt);
+
+    /**
+     * @brief 	Destructor
+     *
+     * All strands must have been deleted before the pool is deleted.
+     */
+    ~AudioCodecPool(void);
+
+    /**
+     * @brief   Get the number of worker threads
+     * @return  Returns the number of worker threads in the pool
+     */
+    unsigned threadCount(void) const { return threads.size(); }
+
+  private:
+    typedef std::pair<Strand*, Job*> DoneJob;
+
+    static unsigned         default_thread_cnt;
+    static AudioCodecPool   *default_pool;
+
+    std::vector<pthread_t>  threads;
+    pthread_mutex_t         mutex;
+    pthread_cond_t          work_cond;
+    pthread_cond_t          idle_cond;
+    std::deque<Strand*>     ready;
+    std::deque<DoneJob>     done;
+    bool                    stopping;
+    int                     notify_pipe[2];
+    FdWatch                 *notify_watch;
+
+    AudioCodecPool(const AudioCodecPool&);
+    AudioCodecPool& operator=(const AudioCodecPool&);
+    static void *workerThread(void *data);
+    void work(void);
+    void post(Strand *strand, Job *job);
+    void removeStrand(Strand *strand);
+    void onNotify(FdWatch *w);
+
+};  /* class AudioCodecPool */
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_CODEC_POOL_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -54,6 +54,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "AsyncAudioDecoderRaw.h"
 #include "AsyncAudioDecoderS16.h"
 #include "AsyncAudioDecoderGsm.h"
+#include "AsyncAudioDecoderThreaded.h"
+#include "AsyncAudioCodecPool.h"
+#include "AsyncAudioProfiler.h"
 #ifdef SPEEX_MAJOR
 #include "AsyncAudioDecoderSpeex.h"
 #endif
@@ -95,6 +98,7 @@ using namespace Async;
  *
  ****************************************************************************/
 
+static AudioDecoder *runInPool(AudioDecoder *dec);
 
 
 /****************************************************************************
@@ -154,18 +158,18 @@ AudioDecoder *AudioDecoder::create(const std::string &name)
   }
   else if (name == "GSM")
   {
-    return new AudioDecoderGsm;
+    return runInPool(new AudioDecoderGsm);
   }
 #ifdef SPEEX_MAJOR
   else if (name == "SPEEX")
   {
-    return new AudioDecoderSpeex;
+    return runInPool(new AudioDecoderSpeex);
   }
 #endif
 #ifdef OPUS_MAJOR
   else if (name == "OPUS")
   {
-    return new AudioDecoderOpus;
+    return runInPool(new AudioDecoderOpus);
   }
 #endif
   else
@@ -191,6 +195,29 @@ AudioDecoder *AudioDecoder::create(const std::string &name)
 
 
 
+/****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Run the CPU heavy codecs in the default codec pool, if it is enabled. The
+ * audio profiler is not thread safe so the codecs are run in the main thread
+ * when profiling.
+ */
+static AudioDecoder *runInPool(AudioDecoder *dec)
+{
+  AudioCodecPool *pool = AudioCodecPool::defaultPool();
+  if ((pool == 0) || AudioProfiler::isEnabled())
+  {
+    return dec;
+  }
+  return new AudioDecoderThreaded(dec, pool);
+} /* runInPool */
+
+
+
 /*
  * This file has not been truncated
  */
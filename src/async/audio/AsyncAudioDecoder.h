@@ -160,6 +160,22 @@ class AudioDecoder : public AudioSource, public sigc::trackable
      */
     virtual void writeEncodedSamples(void *buf, int size) = 0;
     
+    /**
+     * @brief   Tell the decoder that encoded packets have been lost
+     * @param   count The number of consecutive packets that was lost
+     *
+     * Call this function when a gap in the packet stream has been detected,
+     * e.g. by looking at sequence numbers, before the packet following the
+     * gap is written to the decoder. A decoder that support packet loss
+     * concealment will then synthesize audio for the lost packets when the
+     * next packet arrive, so that the gap is not heard as a dropout. If the
+     * codec support forward error correction, the last lost packet may be
+     * recovered from the next packet. A loss that is followed by a call to
+     * flushEncodedSamples is not concealed. The default implementation
+     * ignore the loss.
+     */
+    virtual void packetsLost(unsigned count) {}
+
     /**
      * @brief Call this function when all encoded samples have been received
      */
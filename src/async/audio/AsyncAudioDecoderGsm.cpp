@@ -32,6 +32,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <cstring>
 
 
 /****************************************************************************
@@ -111,9 +112,10 @@ using namespace Async;
  ****************************************************************************/
 
 AudioDecoderGsm::AudioDecoderGsm(void)
-  : gsmh(0), frame_len(0)
+  : gsmh(0), frame_len(0), packet_frames(0), lost_cnt(0)
 {
   gsmh = gsm_create();
+  memset(last_frame, 0, sizeof(last_frame));
 } /* AudioDecoderGsm::AudioDecoderGsm */
 
 
@@ -128,6 +130,12 @@ void AudioDecoderGsm::writeEncodedSamples(void *buf, int size)
 {
   unsigned char *ptr = (unsigned char *)buf;
   
+  if (lost_cnt > 0)
+  {
+    concealLostPackets();
+  }
+  packet_frames = size / static_cast<int>(sizeof(frame));
+
   for (int i=0; i<size; ++i)
   {
     frame[frame_len++] = ptr[i];
@@ -141,6 +149,7 @@ void AudioDecoderGsm::writeEncodedSamples(void *buf, int size)
       {
         samples[j] = static_cast<float>(s16_samples[j]) / 32768.0;
       }
+      memcpy(last_frame, samples, sizeof(last_frame));
       sinkWriteSamples(samples, FRAME_SAMPLE_CNT);
       frame_len = 0;
     }
@@ -148,6 +157,20 @@ void AudioDecoderGsm::writeEncodedSamples(void *buf, int size)
 } /* AudioDecoderGsm::writeEncodedSamples */
 
 
+void AudioDecoderGsm::packetsLost(unsigned count)
+{
+  lost_cnt = (count < MAX_CONCEALED_PACKETS - lost_cnt)
+    ? lost_cnt + count : MAX_CONCEALED_PACKETS;
+} /* AudioDecoderGsm::packetsLost */
+
+
+void AudioDecoderGsm::flushEncodedSamples(void)
+{
+  lost_cnt = 0;
+  AudioDecoder::flushEncodedSamples();
+} /* AudioDecoderGsm::flushEncodedSamples */
+
+
 
 /****************************************************************************
  *
@@ -163,6 +186,24 @@ void AudioDecoderGsm::writeEncodedSamples(void *buf, int size)
  *
  ****************************************************************************/
 
+void AudioDecoderGsm::concealLostPackets(void)
+{
+  unsigned cnt = lost_cnt;
+  lost_cnt = 0;
+
+    // Bytes already received for a frame belong to a packet before the gap
+  frame_len = 0;
+
+  for (unsigned frame_no=0; frame_no<cnt*packet_frames; ++frame_no)
+  {
+    for (int j=0; j<FRAME_SAMPLE_CNT; ++j)
+    {
+      last_frame[j] *= 0.5f;
+    }
+    sinkWriteSamples(last_frame, FRAME_SAMPLE_CNT);
+  }
+} /* AudioDecoderGsm::concealLostPackets */
+
 
 
 /*
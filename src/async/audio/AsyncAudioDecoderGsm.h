@@ -145,15 +145,37 @@ class AudioDecoderGsm : public AudioDecoder
      */
     virtual void writeEncodedSamples(void *buf, int size);
     
+    /**
+     * @brief   Tell the decoder that encoded packets have been lost
+     * @param   count The number of consecutive packets that was lost
+     *
+     GSM have no built in packet loss concealment so the last received
+     * frame is repeated, attenuated 6dB for each repetition, for each frame
+     * in the lost packets. The packet size is assumed to be the same as for
+     * the last received packet.
+     */
+    virtual void packetsLost(unsigned count);
+
+    /**
+     * @brief Call this function when all encoded samples have been received
+     */
+    virtual void flushEncodedSamples(void);
+
 
   protected:
     
   private:
-    static const int FRAME_SAMPLE_CNT = 160;
+    static const int      FRAME_SAMPLE_CNT = 160;
+    static const unsigned MAX_CONCEALED_PACKETS = 10;
     
     gsm       gsmh;
     gsm_frame frame;
     int       frame_len;
+    float     last_frame[FRAME_SAMPLE_CNT];
+    int       packet_frames;
+    unsigned  lost_cnt;
+
+    void concealLostPackets(void);
     
     AudioDecoderGsm(const AudioDecoderGsm&);
     AudioDecoderGsm& operator=(const AudioDecoderGsm&);
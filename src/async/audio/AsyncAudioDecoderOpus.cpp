@@ -115,7 +115,7 @@ using namespace Async;
  ****************************************************************************/
 
 AudioDecoderOpus::AudioDecoderOpus(void)
-  : frame_size(0)
+  : frame_size(0), packet_samples(0), lost_cnt(0)
 {
   int error;
   dec = opus_decoder_create(INTERNAL_SAMPLE_RATE, 1, &error);
@@ -182,6 +182,8 @@ float AudioDecoderOpus::gain(void) const
 void AudioDecoderOpus::reset(void)
 {
   opus_decoder_ctl(dec, OPUS_RESET_STATE);
+  packet_samples = 0;
+  lost_cnt = 0;
 } /* AudioDecoderOpus::reset */
 
 
@@ -224,6 +226,11 @@ void AudioDecoderOpus::writeEncodedSamples(void *buf, int size)
             "channel can be handled\n";
     return;
   }
+  if (lost_cnt > 0)
+  {
+    concealLostPackets(packet, size);
+  }
+
   //cout << "### frame_cnt=" << frame_cnt << " frame_size=" << frame_size;
   float samples[frame_cnt*frame_size];
   frame_size = opus_decode_float(dec, packet, size, samples,
@@ -231,6 +238,7 @@ void AudioDecoderOpus::writeEncodedSamples(void *buf, int size)
   //cout << " " << frame_size << endl;
   if (frame_size > 0)
   {
+    packet_samples = frame_size;
     sinkWriteSamples(samples, frame_size);
   }
   else if (frame_size < 0)
@@ -241,6 +249,20 @@ void AudioDecoderOpus::writeEncodedSamples(void *buf, int size)
 } /* AudioDecoderOpus::writeEncodedSamples */
 
 
+void AudioDecoderOpus::packetsLost(unsigned count)
+{
+  lost_cnt = (count < MAX_CONCEALED_PACKETS - lost_cnt)
+    ? lost_cnt + count : MAX_CONCEALED_PACKETS;
+} /* AudioDecoderOpus::packetsLost */
+
+
+void AudioDecoderOpus::flushEncodedSamples(void)
+{
+  lost_cnt = 0;
+  AudioDecoder::flushEncodedSamples();
+} /* AudioDecoderOpus::flushEncodedSamples */
+
+
 
 /****************************************************************************
  *
@@ -256,6 +278,40 @@ void AudioDecoderOpus::writeEncodedSamples(void *buf, int size)
  *
  ****************************************************************************/
 
+/**
+ * @brief  Synthesize audio for lost packets before decoding the next one
+ *
+ * The length of each lost packet is assumed to be the same as the length of
+ * the last successfully decoded packet. All but the last lost packet are
+ * concealed using PLC. The last one is decoded from the FEC data in the
+ * packet that follow the gap. If there is no FEC data in that packet, Opus
+ * fall back to PLC by itself.
+ */
+void AudioDecoderOpus::concealLostPackets(unsigned char *packet, int size)
+{
+  unsigned cnt = lost_cnt;
+  lost_cnt = 0;
+  if (packet_samples <= 0)
+  {
+    return;
+  }
+
+  float samples[packet_samples];
+  for (unsigned i=0; i<cnt; ++i)
+  {
+    bool use_fec = (i == cnt - 1);
+    int ret = opus_decode_float(dec, use_fec ? packet : 0,
+                                use_fec ? size : 0, samples,
+                                packet_samples, use_fec ? 1 : 0);
+    if (ret < 0)
+    {
+      cerr << "*** ERROR: Opus decoder error: " << opus_strerror(ret) << endl;
+      return;
+    }
+    sinkWriteSamples(samples, ret);
+  }
+} /* AudioDecoderOpus::concealLostPackets */
+
 
 
 /*
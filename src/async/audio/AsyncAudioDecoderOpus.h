@@ -167,12 +167,33 @@ class AudioDecoderOpus : public AudioDecoder
      */
     virtual void writeEncodedSamples(void *buf, int size);
     
+    /**
+     * @brief   Tell the decoder that encoded packets have been lost
+     * @param   count The number of consecutive packets that was lost
+     *
+     * When the next packet arrive, the last lost packet is recovered using
+     * the inband FEC data in that packet, if the remote encoder have FEC
+     * enabled. Earlier lost packets are concealed using the Opus PLC.
+     */
+    virtual void packetsLost(unsigned count);
+
+    /**
+     * @brief Call this function when all encoded samples have been received
+     */
+    virtual void flushEncodedSamples(void);
+
 
   protected:
     
   private:
+    static const unsigned MAX_CONCEALED_PACKETS = 10;
+
     OpusDecoder *dec;
     int         frame_size;
+    int         packet_samples;
+    unsigned    lost_cnt;
+
+    void concealLostPackets(unsigned char *packet, int size);
     
     AudioDecoderOpus(const AudioDecoderOpus&);
     AudioDecoderOpus& operator=(const AudioDecoderOpus&);
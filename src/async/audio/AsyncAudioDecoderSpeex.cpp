@@ -113,6 +113,7 @@ using namespace Async;
  ****************************************************************************/
 
 AudioDecoderSpeex::AudioDecoderSpeex(void)
+  : packet_frames(0), lost_cnt(0)
 {
   speex_bits_init(&bits);
 #if INTERNAL_SAMPLE_RATE == 16000
@@ -179,8 +180,14 @@ void AudioDecoderSpeex::writeEncodedSamples(void *buf, int size)
 {
   char *ptr = (char *)buf;
   
+  if (lost_cnt > 0)
+  {
+    concealLostPackets();
+  }
+
   speex_bits_read_from(&bits, ptr, size);
   float samples[frame_size];
+  packet_frames = 0;
 #if SPEEX_MAJOR > 1 || (SPEEX_MAJOR == 1 && SPEEX_MINOR >= 1)
   while (speex_decode(dec_state, &bits, samples) == 0)
 #else
@@ -193,10 +200,25 @@ void AudioDecoderSpeex::writeEncodedSamples(void *buf, int size)
       samples[i] = samples [i] / 32767.0;
     }
     sinkWriteSamples(samples, frame_size);
+    ++packet_frames;
   }
 } /* AudioDecoderSpeex::writeEncodedSamples */
 
 
+void AudioDecoderSpeex::packetsLost(unsigned count)
+{
+  lost_cnt = (count < MAX_CONCEALED_PACKETS - lost_cnt)
+    ? lost_cnt + count : MAX_CONCEALED_PACKETS;
+} /* AudioDecoderSpeex::packetsLost */
+
+
+void AudioDecoderSpeex::flushEncodedSamples(void)
+{
+  lost_cnt = 0;
+  AudioDecoder::flushEncodedSamples();
+} /* AudioDecoderSpeex::flushEncodedSamples */
+
+
 
 /****************************************************************************
  *
@@ -212,6 +234,25 @@ void AudioDecoderSpeex::writeEncodedSamples(void *buf, int size)
  *
  ****************************************************************************/
 
+void AudioDecoderSpeex::concealLostPackets(void)
+{
+  unsigned cnt = lost_cnt;
+  lost_cnt = 0;
+
+  float samples[frame_size];
+  for (int frame_no=0; frame_no<static_cast<int>(cnt)*packet_frames;
+       ++frame_no)
+  {
+      // Passing a NULL bits pointer make Speex synthesize a lost frame
+    speex_decode(dec_state, 0, samples);
+    for (int i=0; i<frame_size; ++i)
+    {
+      samples[i] = samples[i] / 32767.0;
+    }
+    sinkWriteSamples(samples, frame_size);
+  }
+} /* AudioDecoderSpeex::concealLostPackets */
+
 
 
 /*
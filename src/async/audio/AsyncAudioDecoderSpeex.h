@@ -166,14 +166,35 @@ class AudioDecoderSpeex : public AudioDecoder
      * @param 	size The size of the buffer
      */
     virtual void writeEncodedSamples(void *buf, int size);
+
+    /**
+     * @brief   Tell the decoder that encoded packets have been lost
+     * @param   count The number of consecutive packets that was lost
+     *
+     Lost packets are concealed using the Speex PLC. The number of
+     * frames in each lost packet is assumed to be the same as in the last
+     * received packet.
+     */
+    virtual void packetsLost(unsigned count);
+
+    /**
+     * @brief Call this function when all encoded samples have been received
+     */
+    virtual void flushEncodedSamples(void);
     
 
   protected:
     
   private:
+    static const unsigned MAX_CONCEALED_PACKETS = 10;
+
     SpeexBits bits;
     void      *dec_state;
     int       frame_size;
+    int       packet_frames;
+    unsigned  lost_cnt;
+
+    void concealLostPackets(void);
     
     AudioDecoderSpeex(const AudioDecoderSpeex&);
     AudioDecoderSpeex& operator=(const AudioDecoderSpeex&);
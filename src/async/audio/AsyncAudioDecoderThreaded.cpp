@@ -0,0 +1,312 @@
+/**
+@file	 AsyncAudioDecoderThreaded.cpp
+@brief   Run an audio decoder in a worker thread
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-17
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioDecoderThreaded.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+class AudioDecoderThreaded::DecodeJob : public AudioCodecPool::Job
+{
+  public:
+    typedef enum
+    {
+      DECODE, LOST, FLUSH, OPTION, PRINT
+    } Type;
+
+    struct Output
+    {
+      bool          flush;
+      vector<float> samples;
+    };
+
+    AudioDecoderThreaded  *dec;
+    Type                  type;
+    vector<char>          data;
+    unsigned              lost_cnt;
+    string                name;
+    string                value;
+    vector<Output>        output;
+
+    DecodeJob(AudioDecoderThreaded *dec, Type type)
+      : dec(dec), type(type), lost_cnt(0) {}
+
+    virtual void run(void);
+
+    virtual void complete(void)
+    {
+        // The sink may delete the decoder. The destructor then clear the
+        // alive flag and nothing more may be done.
+      bool alive = true;
+      dec->alive = &alive;
+      for (size_t i=0; alive && (i<output.size()); ++i)
+      {
+        if (output[i].flush)
+        {
+          dec->sinkFlushSamples();
+        }
+        else
+        {
+          dec->sinkWriteSamples(&output[i].samples[0],
+                                output[i].samples.size());
+        }
+      }
+      if (alive)
+      {
+        dec->alive = 0;
+      }
+    }
+};
+
+
+class AudioDecoderThreaded::Collector : public AudioSink
+{
+  public:
+    DecodeJob *current_job;
+
+    Collector(void) : current_job(0) {}
+
+    virtual int writeSamples(const float *samples, int count)
+    {
+      if (count <= 0)
+      {
+        return 0;
+      }
+      DecodeJob::Output out;
+      out.flush = false;
+      out.samples.assign(samples, samples + count);
+      current_job->output.push_back(out);
+      return count;
+    }
+
+    virtual void flushSamples(void)
+    {
+      DecodeJob::Output out;
+      out.flush = true;
+      current_job->output.push_back(out);
+      sourceAllSamplesFlushed();
+    }
+};
+
+
+void AudioDecoderThreaded::DecodeJob::run(void)
+{
+  dec->collector->current_job = this;
+  switch (type)
+  {
+    case DECODE:
+      dec->decoder->writeEncodedSamples(&data[0], data.size());
+      break;
+    case LOST:
+      dec->decoder->packetsLost(lost_cnt);
+      break;
+    case FLUSH:
+      dec->decoder->flushEncodedSamples();
+      break;
+    case OPTION:
+      dec->decoder->setOption(name, value);
+      break;
+    case PRINT:
+      dec->decoder->printCodecParams();
+      break;
+  }
+  dec->collector->current_job = 0;
+} /* AudioDecoderThreaded::DecodeJob::run */
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+AudioDecoderThreaded::AudioDecoderThreaded(AudioDecoder *decoder,
+                                           AudioCodecPool *pool)
+  : decoder(decoder), collector(new Collector),
+    strand(new AudioCodecPool::Strand(pool)), alive(0)
+{
+  decoder->registerSink(collector);
+} /* AudioDecoderThreaded::AudioDecoderThreaded */
+
+
+AudioDecoderThreaded::~AudioDecoderThreaded(void)
+{
+  if (alive != 0)
+  {
+    *alive = false;
+  }
+    // The strand must be deleted first since it wait for a running job to
+    // finish using the decoder
+  delete strand;
+  decoder->unregisterSink();
+  delete decoder;
+  delete collector;
+} /* AudioDecoderThreaded::~AudioDecoderThreaded */
+
+
+void AudioDecoderThreaded::setOption(const std::string &name,
+                                     const std::string &value)
+{
+  DecodeJob *job = new DecodeJob(this, DecodeJob::OPTION);
+  job->name = name;
+  job->value = value;
+  post(job);
+} /* AudioDecoderThreaded::setOption */
+
+
+void AudioDecoderThreaded::printCodecParams(void) const
+{
+  post(new DecodeJob(const_cast<AudioDecoderThreaded *>(this),
+                     DecodeJob::PRINT));
+} /* AudioDecoderThreaded::printCodecParams */
+
+
+void AudioDecoderThreaded::writeEncodedSamples(void *buf, int size)
+{
+  if (size <= 0)
+  {
+    return;
+  }
+  const char *ptr = reinterpret_cast<const char *>(buf);
+  DecodeJob *job = new DecodeJob(this, DecodeJob::DECODE);
+  job->data.assign(ptr, ptr + size);
+  post(job);
+} /* AudioDecoderThreaded::writeEncodedSamples */
+
+
+void AudioDecoderThreaded::packetsLost(unsigned count)
+{
+  DecodeJob *job = new DecodeJob(this, DecodeJob::LOST);
+  job->lost_cnt = count;
+  post(job);
+} /* AudioDecoderThreaded::packetsLost */
+
+
+void AudioDecoderThreaded::flushEncodedSamples(void)
+{
+  post(new DecodeJob(this, DecodeJob::FLUSH));
+} /* AudioDecoderThreaded::flushEncodedSamples */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void AudioDecoderThreaded::post(DecodeJob *job) const
+{
+  strand->post(job);
+} /* AudioDecoderThreaded::post */
+
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,198 @@
+/**
+@file	 AsyncAudioDecoderThreaded.h
+@brief   Run an audio decoder in a worker thread
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-17
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_AUDIO_DECODER_THREADED_INCLUDED
+#define ASYNC_AUDIO_DECODER_THREADED_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <vector>
+#include <string>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioDecoder.h>
+#include <AsyncAudioSink.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioCodecPool.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Run an audio decoder in a worker thread
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-17
+
+This class wrap another audio decoder and run it in a worker thread from an
+Async::AudioCodecPool. Encoded samples written to this object are copied and
+handed over to the worker thread. The decoded samples are delivered back to
+the main thread, where they are written to the registered sink, in the same
+order as the encoded samples were written. Lost packets, flushes and options
+are handled in order with the audio.
+
+The decoded samples are written to the sink without waiting for it to accept
+them, just like the wrapped decoders do.
+*/
+class AudioDecoderThreaded : public AudioDecoder
+{
+  public:
+    /**
+     * @brief 	Constructor
+     * @param 	decoder The decoder to wrap. Ownership is taken over.
+     * @param 	pool The pool to run the decoder in
+     */
+    AudioDecoderThreaded(AudioDecoder *decoder, AudioCodecPool *pool);
+
+    /**
+     * @brief 	Destructor
+     */
+    virtual ~AudioDecoderThreaded(void);
+
+    /**
+     * @brief   Get the name of the codec
+     * @returns Return the name of the wrapped codec
+     */
+    virtual const char *name(void) const { return decoder->name(); }
+
+    /**
+     * @brief 	Set an option for the decoder
+     * @param 	name The name of the option
+     * @param 	value The value of the option
+     */
+    virtual void setOption(const std::string &name, const std::string &value);
+
+    /**
+     * @brief Print codec parameter settings
+     */
+    virtual void printCodecParams(void) const;
+
+    /**
+     * @brief 	Write encoded samples into the decoder
+     * @param 	buf  Buffer containing encoded samples
+     * @param 	size The size of the buffer
+     */
+    virtual void writeEncodedSamples(void *buf, int size);
+
+    /**
+     * @brief   Tell the decoder that encoded packets have been lost
+     * @param   count The number of consecutive packets that was lost
+     */
+    virtual void packetsLost(unsigned count);
+
+    /**
+     * @brief Call this function when all encoded samples have been received
+     */
+    virtual void flushEncodedSamples(void);
+
+  private:
+    class DecodeJob;
+    class Collector;
+
+    AudioDecoder            *decoder;
+    Collector               *collector;
+    AudioCodecPool::Strand  *strand;
+    bool                    *alive;
+
+    AudioDecoderThreaded(const AudioDecoderThreaded&);
+    AudioDecoderThreaded& operator=(const AudioDecoderThreaded&);
+    void post(DecodeJob *job) const;
+
+};  /* class AudioDecoderThreaded */
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_DECODER_THREADED_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -59,6 +59,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "AsyncAudioIO.h"
 #include "AsyncAudioDevice.h"
 #include "AsyncAudioDeviceFactory.h"
+#include "AsyncAudioSampleConv.h"
 
 
 /****************************************************************************
@@ -269,11 +270,8 @@ void AudioDevice::putBlocks(int16_t *buf, int frame_cnt)
   float samples[frame_cnt];
   for (int ch=0; ch<channels; ch++)
   {
-    for (int i=0; i<frame_cnt; i++)
-    {
-        // no divisions in index calculation (embedded system performance !!!)
-      samples[i] = static_cast<float>(buf[i * channels + ch]) / 32768.0;
-    }
+    AudioSampleConv::s16ToFloatDeinterleave(samples, buf, frame_cnt,
+                                            channels, ch);
     list<AudioIO*>::iterator it;
     for (it=aios.begin(); it!=aios.end(); ++it)
     {
@@ -353,23 +351,8 @@ int AudioDevice::getBlocks(int16_t *buf, int block_cnt)
       int channel = (*it)->channel();
       float tmp[frames_to_write];
       int samples_read = (*it)->readSamples(tmp, frames_to_write);
-      for (int i=0; i<samples_read; ++i)
-      {
-	int buf_pos = i * channels + channel;
-	float sample = 32767.0 * tmp[i] + buf[buf_pos];
-	if (sample > 32767)
-	{
-	  buf[buf_pos] = 32767;
-	}
-	else if (sample < -32767)
-	{
-	  buf[buf_pos] = -32767;
-	}
-	else
-	{
-	  buf[buf_pos] = static_cast<int16_t>(sample);
-	}
-      }
+      AudioSampleConv::floatMixToS16Interleave(buf, tmp, samples_read,
+                                               channels, channel);
     }
   }  
       
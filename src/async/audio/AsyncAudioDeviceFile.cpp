@@ -0,0 +1,617 @@
+/**
+@file	 AsyncAudioDeviceFile.cpp
+@brief   Read and write audio samples from and to files
+@author  Tobias Blomberg / SM0SVX
+@date    2017-11-26
+
+Implements an "audio interface" that read samples from a file and write
+samples to a file, paced by a timer. Together with the SimApplication class
+this can be used to run audio processing faster than real time.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <strings.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncTimer.h>
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioDeviceFile.h"
+#include "AsyncAudioDeviceFactory.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+#define WAV_HEADER_SIZE 44
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+static uint16_t getLe16(const unsigned char *buf);
+static uint32_t getLe32(const unsigned char *buf);
+static void putLe16(unsigned char *buf, uint16_t val);
+static void putLe32(unsigned char *buf, uint32_t val);
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+REGISTER_AUDIO_DEVICE_TYPE("file", AudioDeviceFile);
+REGISTER_AUDIO_DEVICE_TYPE("null", AudioDeviceNull);
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+AudioDeviceFile::AudioDeviceFile(const string& dev_name)
+  : AudioDevice(dev_name), null_dev(false)
+{
+  assert(AudioDeviceFile_creator_registered);
+  init();
+} /* AudioDeviceFile::AudioDeviceFile */
+
+
+AudioDeviceFile::~AudioDeviceFile(void)
+{
+  closeDevice();
+  if (rd_file != 0)
+  {
+    fclose(rd_file);
+  }
+  if (wr_file != 0)
+  {
+    fclose(wr_file);
+  }
+  delete read_timer;
+  delete write_timer;
+  delete [] read_buf;
+  delete [] file_buf;
+} /* AudioDeviceFile::~AudioDeviceFile */
+
+
+int AudioDeviceFile::readBlocksize(void)
+{
+  return block_size;
+} /* AudioDeviceFile::readBlocksize */
+
+
+int AudioDeviceFile::writeBlocksize(void)
+{
+  return block_size;
+} /* AudioDeviceFile::writeBlocksize */
+
+
+bool AudioDeviceFile::isFullDuplexCapable(void)
+{
+  return null_dev;
+} /* AudioDeviceFile::isFullDuplexCapable */
+
+
+void AudioDeviceFile::audioToWriteAvailable(void)
+{
+  if (!write_timer->isEnabled())
+  {
+    audioWriteHandler();
+  }
+} /* AudioDeviceFile::audioToWriteAvailable */
+
+
+void AudioDeviceFile::flushSamples(void)
+{
+  if (!write_timer->isEnabled())
+  {
+    audioWriteHandler();
+  }
+} /* AudioDeviceFile::flushSamples */
+
+
+int AudioDeviceFile::samplesToWrite(void) const
+{
+  return 0;
+} /* AudioDeviceFile::samplesToWrite */
+
+
+AudioDeviceNull::AudioDeviceNull(const string& dev_name)
+  : AudioDeviceFile(dev_name, true)
+{
+  assert(AudioDeviceNull_creator_registered);
+} /* AudioDeviceNull::AudioDeviceNull */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+AudioDeviceFile::AudioDeviceFile(const string& dev_name, bool null_dev)
+  : AudioDevice(dev_name), null_dev(null_dev)
+{
+  init();
+} /* AudioDeviceFile::AudioDeviceFile */
+
+
+bool AudioDeviceFile::openDevice(Mode mode)
+{
+  switch (mode)
+  {
+    case MODE_RD:
+      if (!openReadFile())
+      {
+        return false;
+      }
+      break;
+
+    case MODE_WR:
+      if (!openWriteFile())
+      {
+        return false;
+      }
+      break;
+
+    case MODE_RDWR:
+      if (!null_dev)
+      {
+        cerr << "*** ERROR: The file audio device \"" << devName()
+             << "\" cannot be used for both reading and writing. Use "
+                "different files for receivers and transmitters.\n";
+        return false;
+      }
+      break;
+
+    case MODE_NONE:
+      return true;
+  }
+
+  if ((mode == MODE_RD) || (mode == MODE_RDWR))
+  {
+    read_timer->setEnable(true);
+  }
+
+  return true;
+
+} /* AudioDeviceFile::openDevice */
+
+
+void AudioDeviceFile::closeDevice(void)
+{
+  read_timer->setEnable(false);
+  write_timer->setEnable(false);
+  if (wr_file != 0)
+  {
+    updateWavHeader();
+    fflush(wr_file);
+  }
+} /* AudioDeviceFile::closeDevice */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void AudioDeviceFile::init(void)
+{
+  rd_file = 0;
+  rd_file_channels = 1;
+  rd_eof = false;
+  wr_file = 0;
+  wr_wav = false;
+  wr_data_bytes = 0;
+
+  int pace_interval = 1000 * block_size_hint / sampleRate();
+  block_size = pace_interval * sampleRate() / 1000;
+
+  read_buf = new int16_t[block_size * channels];
+  file_buf = new int16_t[block_size * channels];
+
+  read_timer = new Timer(pace_interval, Timer::TYPE_PERIODIC);
+  read_timer->setEnable(false);
+  read_timer->expired.connect(
+      sigc::hide(mem_fun(*this, &AudioDeviceFile::audioReadHandler)));
+
+  write_timer = new Timer(pace_interval, Timer::TYPE_PERIODIC);
+  write_timer->setEnable(false);
+  write_timer->expired.connect(
+      sigc::hide(mem_fun(*this, &AudioDeviceFile::audioWriteHandler)));
+} /* AudioDeviceFile::init */
+
+
+bool AudioDeviceFile::isWavFile(void) const
+{
+  const string &path = devName();
+  return (path.size() > 4) &&
+         (strcasecmp(path.c_str() + path.size() - 4, ".wav") == 0);
+} /* AudioDeviceFile::isWavFile */
+
+
+bool AudioDeviceFile::openReadFile(void)
+{
+  if (null_dev || (rd_file != 0))
+  {
+    return true;
+  }
+
+  if (wr_file != 0)
+  {
+    cerr << "*** ERROR: The file audio device \"" << devName()
+         << "\" cannot be used for both reading and writing. Use "
+            "different files for receivers and transmitters.\n";
+    return false;
+  }
+
+  rd_file = fopen(devName().c_str(), "rb");
+  if (rd_file == 0)
+  {
+    cerr << "*** ERROR: Could not open audio file \"" << devName()
+         << "\" for reading: " << strerror(errno) << endl;
+    return false;
+  }
+  rd_file_channels = 1;
+  rd_eof = false;
+
+  if (!isWavFile())
+  {
+    return true;
+  }
+
+    // Find the format and data chunks of the WAV file
+  unsigned char hdr[12];
+  if ((fread(hdr, 1, sizeof(hdr), rd_file) != sizeof(hdr)) ||
+      (memcmp(hdr, "RIFF", 4) != 0) || (memcmp(hdr + 8, "WAVE", 4) != 0))
+  {
+    cerr << "*** ERROR: The audio file \"" << devName()
+         << "\" is not a WAV file\n";
+    fclose(rd_file);
+    rd_file = 0;
+    return false;
+  }
+  bool fmt_ok = false;
+  for (;;)
+  {
+    unsigned char chunk[8];
+    if (fread(chunk, 1, sizeof(chunk), rd_file) != sizeof(chunk))
+    {
+      cerr << "*** ERROR: No audio data found in WAV file \"" << devName()
+           << "\"\n";
+      fclose(rd_file);
+      rd_file = 0;
+      return false;
+    }
+    uint32_t chunk_size = getLe32(chunk + 4);
+    if (memcmp(chunk, "fmt ", 4) == 0)
+    {
+      unsigned char fmt[16];
+      if ((chunk_size < sizeof(fmt)) ||
+          (fread(fmt, 1, sizeof(fmt), rd_file) != sizeof(fmt)))
+      {
+        break;
+      }
+      chunk_size -= sizeof(fmt);
+      rd_file_channels = getLe16(fmt + 2);
+      if ((getLe16(fmt) != 1) || (getLe16(fmt + 14) != 16))
+      {
+        cerr << "*** ERROR: The WAV file \"" << devName()
+             << "\" is not in 16 bit PCM format\n";
+        break;
+      }
+      if (getLe32(fmt + 4) != static_cast<uint32_t>(sampleRate()))
+      {
+        cerr << "*** ERROR: The sample rate of the WAV file \"" << devName()
+             << "\" is " << getLe32(fmt + 4) << " but the audio device use "
+             << sampleRate() << "\n";
+        break;
+      }
+      if ((rd_file_channels != 1) && (rd_file_channels != channels))
+      {
+        cerr << "*** ERROR: The WAV file \"" << devName() << "\" have "
+             << rd_file_channels << " channels but the audio device use "
+             << channels << "\n";
+        break;
+      }
+      fmt_ok = true;
+    }
+    else if (memcmp(chunk, "data", 4) == 0)
+    {
+      if (!fmt_ok)
+      {
+        cerr << "*** ERROR: No format chunk found before the data chunk in "
+                "WAV file \"" << devName() << "\"\n";
+        break;
+      }
+      return true;
+    }
+    if (fseek(rd_file, chunk_size + (chunk_size & 1), SEEK_CUR) != 0)
+    {
+      break;
+    }
+  }
+
+  fclose(rd_file);
+  rd_file = 0;
+  return false;
+
+} /* AudioDeviceFile::openReadFile */
+
+
+bool AudioDeviceFile::openWriteFile(void)
+{
+  if (null_dev || (wr_file != 0))
+  {
+    return true;
+  }
+
+  if (rd_file != 0)
+  {
+    cerr << "*** ERROR: The file audio device \"" << devName()
+         << "\" cannot be used for both reading and writing. Use "
+            "different files for receivers and transmitters.\n";
+    return false;
+  }
+
+  wr_file = fopen(devName().c_str(), "wb");
+  if (wr_file == 0)
+  {
+    cerr << "*** ERROR: Could not open audio file \"" << devName()
+         << "\" for writing: " << strerror(errno) << endl;
+    return false;
+  }
+  wr_wav = isWavFile();
+  wr_data_bytes = 0;
+  if (wr_wav)
+  {
+    updateWavHeader();
+  }
+
+  return true;
+
+} /* AudioDeviceFile::openWriteFile */
+
+
+void AudioDeviceFile::updateWavHeader(void)
+{
+  if (!wr_wav)
+  {
+    return;
+  }
+
+  unsigned char hdr[WAV_HEADER_SIZE];
+  memcpy(hdr, "RIFF", 4);
+  putLe32(hdr + 4, WAV_HEADER_SIZE - 8 + wr_data_bytes);
+  memcpy(hdr + 8, "WAVEfmt ", 8);
+  putLe32(hdr + 16, 16);
+  putLe16(hdr + 20, 1);
+  putLe16(hdr + 22, channels);
+  putLe32(hdr + 24, sampleRate());
+  putLe32(hdr + 28, sampleRate() * channels * sizeof(int16_t));
+  putLe16(hdr + 32, channels * sizeof(int16_t));
+  putLe16(hdr + 34, 16);
+  memcpy(hdr + 36, "data", 4);
+  putLe32(hdr + 40, wr_data_bytes);
+
+  long pos = ftell(wr_file);
+  if ((fseek(wr_file, 0, SEEK_SET) != 0) ||
+      (fwrite(hdr, 1, sizeof(hdr), wr_file) != sizeof(hdr)) ||
+      ((pos > 0) && (fseek(wr_file, pos, SEEK_SET) != 0)))
+  {
+    perror("write WAV header in AudioDeviceFile::updateWavHeader");
+  }
+} /* AudioDeviceFile::updateWavHeader */
+
+
+void AudioDeviceFile::audioReadHandler(void)
+{
+  if ((rd_file != 0) && !rd_eof)
+  {
+    size_t frames = fread(file_buf, rd_file_channels * sizeof(int16_t),
+                          block_size, rd_file);
+    if (frames < static_cast<size_t>(block_size))
+    {
+      if (ferror(rd_file))
+      {
+        perror("fread in AudioDeviceFile::audioReadHandler");
+      }
+      else
+      {
+        cout << "--- End of audio file \"" << devName() << "\" reached\n";
+      }
+      rd_eof = true;
+    }
+    memset(file_buf + frames * rd_file_channels, 0,
+           (block_size - frames) * rd_file_channels * sizeof(int16_t));
+
+    if (rd_file_channels == channels)
+    {
+      memcpy(read_buf, file_buf, block_size * channels * sizeof(int16_t));
+    }
+    else
+    {
+      for (int i=0; i<block_size; ++i)
+      {
+        for (int ch=0; ch<channels; ++ch)
+        {
+          read_buf[i * channels + ch] = file_buf[i];
+        }
+      }
+    }
+  }
+  else
+  {
+    memset(read_buf, 0, block_size * channels * sizeof(int16_t));
+  }
+
+  putBlocks(read_buf, block_size);
+
+} /* AudioDeviceFile::audioReadHandler */
+
+
+void AudioDeviceFile::audioWriteHandler(void)
+{
+  assert((mode() == MODE_WR) || (mode() == MODE_RDWR));
+
+  int16_t buf[block_size * channels];
+  if (getBlocks(buf, 1) == 0)
+  {
+    write_timer->setEnable(false);
+    return;
+  }
+
+  if (wr_file != 0)
+  {
+    size_t sample_cnt = block_size * channels;
+    int16_t *samples = buf;
+    if (!wr_wav && (channels > 1))
+    {
+        // Mix all channels together when writing a raw mono file
+      for (int i=0; i<block_size; ++i)
+      {
+        int sum = 0;
+        for (int ch=0; ch<channels; ++ch)
+        {
+          sum += buf[i * channels + ch];
+        }
+        file_buf[i] = max(-32767, min(32767, sum));
+      }
+      samples = file_buf;
+      sample_cnt = block_size;
+    }
+    if (fwrite(samples, sizeof(int16_t), sample_cnt, wr_file) != sample_cnt)
+    {
+      perror("fwrite in AudioDeviceFile::audioWriteHandler");
+      write_timer->setEnable(false);
+      return;
+    }
+    wr_data_bytes += sample_cnt * sizeof(int16_t);
+  }
+
+  write_timer->setEnable(true);
+
+} /* AudioDeviceFile::audioWriteHandler */
+
+
+static uint16_t getLe16(const unsigned char *buf)
+{
+  return buf[0] | (buf[1] << 8);
+} /* getLe16 */
+
+
+static uint32_t getLe32(const unsigned char *buf)
+{
+  return static_cast<uint32_t>(getLe16(buf)) |
+         (static_cast<uint32_t>(getLe16(buf + 2)) << 16);
+} /* getLe32 */
+
+
+static void putLe16(unsigned char *buf, uint16_t val)
+{
+  buf[0] = val & 0xff;
+  buf[1] = val >> 8;
+} /* putLe16 */
+
+
+static void putLe32(unsigned char *buf, uint32_t val)
+{
+  putLe16(buf, val & 0xffff);
+  putLe16(buf + 2, val >> 16);
+} /* putLe32 */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,274 @@
+/**
+@file	 AsyncAudioDeviceFile.h
+@brief   Read and write audio samples from and to files
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-11-26
+
+Implements an "audio interface" that read samples from a file and write
+samples to a file, paced by a timer. Together with the SimApplication class
+this can be used to run audio processing faster than real time.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef ASYNC_AUDIO_DEVICE_FILE_INCLUDED
+#define ASYNC_AUDIO_DEVICE_FILE_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cstdio>
+#include <string>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioDevice.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+class Timer;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	An audio device that read from and write to files
+@author Tobias Blomberg / SM0SVX
+@date   2017-11-26
+
+Implements an "audio interface" that read samples from a file and write
+samples to a file. The device is specified as "file:path". When opened for
+reading, samples are read from the file one block at a time, paced by a
+timer, just like a sound card would deliver them. When the end of the file
+is reached, silence is delivered. When opened for writing, the file is
+created and the samples are written to it at the pace of the sample rate.
+
+If the file name end with ".wav", the file is read and written in WAV
+format. The sample format must then be 16 bit PCM and the sample rate must
+match the sample rate of the audio device. Other files are treated as raw
+16 bit signed native endian mono samples. A mono file being read is copied to
+all channels. When writing a raw file, all channels are mixed together.
+
+Since the file is kept open until the device is destroyed, a transmitter
+that open and close the audio device for each transmission will write all
+transmissions, back to back, to the same file.
+
+A file device cannot be opened for both reading and writing at the same time.
+Use different files for receivers and transmitters.
+
+The "null" device type ("null:" or "null:anything") is a file device without
+a file. It deliver silence when read and discard all written samples.
+
+Using a timer to pace the samples make it possible to run the audio
+processing faster than real time by using the Async::SimApplication class
+instead of Async::CppApplication.
+*/
+class AudioDeviceFile : public Async::AudioDevice
+{
+  public:
+    /**
+     * @brief 	Constuctor
+     * @param 	dev_name  The name of the file to read or write
+     */
+    explicit AudioDeviceFile(const std::string& dev_name);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~AudioDeviceFile(void);
+
+    /**
+     * @brief 	Find out what the read (recording) blocksize is set to
+     * @return	Returns the currently set blocksize in samples per channel
+     */
+    virtual int readBlocksize(void);
+
+    /**
+     * @brief 	Find out what the write (playback) blocksize is set to
+     * @return	Returns the currently set blocksize in samples per channel
+     */
+    virtual int writeBlocksize(void);
+
+    /**
+     * @brief 	Check if the audio device has full duplex capability
+     * @return	Returns \em true if the device has full duplex capability
+     *	      	or else \em false
+     */
+    virtual bool isFullDuplexCapable(void);
+
+    /**
+     * @brief 	Tell the audio device handler that there are audio to be
+     *	      	written in the buffer
+     */
+    virtual void audioToWriteAvailable(void);
+
+    /**
+     * @brief	Tell the audio device to flush its buffers
+     */
+    virtual void flushSamples(void);
+
+    /**
+     * @brief 	Find out how many samples there are in the output buffer
+     * @return	Returns the number of samples in the output buffer on
+     *          success or -1 on failure.
+     *
+     * Samples are written to the file as soon as they are taken from the
+     * audio pipe so this function always return 0.
+     */
+    virtual int samplesToWrite(void) const;
+
+
+  protected:
+    /**
+     * @brief 	Constuctor
+     * @param 	dev_name  The name of the file to read or write
+     * @param 	null_dev  Set to \em true to not use a file at all
+     */
+    AudioDeviceFile(const std::string& dev_name, bool null_dev);
+
+    /**
+     * @brief 	Open the audio device
+     * @param 	mode The mode to open the audio device in (See AudioIO::Mode)
+     * @return	Returns \em true on success or else \em false
+     */
+    virtual bool openDevice(Mode mode);
+
+    /**
+     * @brief 	Close the audio device
+     */
+    virtual void closeDevice(void);
+
+
+  private:
+    bool                null_dev;
+    int                 block_size;
+    int16_t             *read_buf;
+    int16_t             *file_buf;
+    Async::Timer        *read_timer;
+    Async::Timer        *write_timer;
+    FILE                *rd_file;
+    int                 rd_file_channels;
+    bool                rd_eof;
+    FILE                *wr_file;
+    bool                wr_wav;
+    unsigned long       wr_data_bytes;
+
+    AudioDeviceFile(const AudioDeviceFile&);
+    AudioDeviceFile& operator=(const AudioDeviceFile&);
+    void init(void);
+    bool isWavFile(void) const;
+    bool openReadFile(void);
+    bool openWriteFile(void);
+    void updateWavHeader(void);
+    void audioReadHandler(void);
+    void audioWriteHandler(void);
+
+};  /* class AudioDeviceFile */
+
+
+/**
+@brief	An audio device that deliver silence and discard written samples
+@author Tobias Blomberg / SM0SVX
+@date   2017-11-26
+
+The "null" audio device type. See AudioDeviceFile for details.
+*/
+class AudioDeviceNull : public AudioDeviceFile
+{
+  public:
+    /**
+     * @brief 	Constuctor
+     * @param 	dev_name  The name of the device (not used)
+     */
+    explicit AudioDeviceNull(const std::string& dev_name);
+
+};  /* class AudioDeviceNull */
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_DEVICE_FILE_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
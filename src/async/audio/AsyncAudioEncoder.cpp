@@ -54,6 +54,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "AsyncAudioEncoderRaw.h"
 #include "AsyncAudioEncoderS16.h"
 #include "AsyncAudioEncoderGsm.h"
+#include "AsyncAudioEncoderThreaded.h"
+#include "AsyncAudioCodecPool.h"
+#include "AsyncAudioProfiler.h"
 #ifdef SPEEX_MAJOR
 #include "AsyncAudioEncoderSpeex.h"
 #endif
@@ -95,6 +98,7 @@ using namespace Async;
  *
  ****************************************************************************/
 
+static AudioEncoder *runInPool(AudioEncoder *enc);
 
 
 /****************************************************************************
@@ -154,18 +158,18 @@ AudioEncoder *AudioEncoder::create(const std::string &name)
   }
   else if (name == "GSM")
   {
-    return new AudioEncoderGsm;
+    return runInPool(new AudioEncoderGsm);
   }
 #ifdef SPEEX_MAJOR
   else if (name == "SPEEX")
   {
-    return new AudioEncoderSpeex;
+    return runInPool(new AudioEncoderSpeex);
   }
 #endif
 #ifdef OPUS_MAJOR
   else if (name == "OPUS")
   {
-    return new AudioEncoderOpus;
+    return runInPool(new AudioEncoderOpus);
   }
 #endif
   else
@@ -191,6 +195,29 @@ AudioEncoder *AudioEncoder::create(const std::string &name)
 
 
 
+/****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+/*
+ * Run the CPU heavy codecs in the default codec pool, if it is enabled. The
+ * audio profiler is not thread safe so the codecs are run in the main thread
+ * when profiling.
+ */
+static AudioEncoder *runInPool(AudioEncoder *enc)
+{
+  AudioCodecPool *pool = AudioCodecPool::defaultPool();
+  if ((pool == 0) || AudioProfiler::isEnabled())
+  {
+    return enc;
+  }
+  return new AudioEncoderThreaded(enc, pool);
+} /* runInPool */
+
+
+
 /*
  * This file has not been truncated
  */
@@ -181,6 +181,14 @@ void AudioEncoderOpus::setOption(const std::string &name,
   {
     enableConstrainedVbr(atoi(value.c_str()) != 0);
   }
+  else if (name == "FEC")
+  {
+    enableInbandFec(atoi(value.c_str()) != 0);
+  }
+  else if (name == "PACKET_LOSS")
+  {
+    setExpectedPacketLoss(atoi(value.c_str()));
+  }
   else
   {
     cerr << "*** WARNING AudioEncoderOpus: Unknown option \""
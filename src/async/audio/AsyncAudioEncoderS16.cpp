@@ -50,6 +50,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include "AsyncAudioEncoderS16.h"
+#include "AsyncAudioSampleConv.h"
 
 
 
@@ -128,24 +129,7 @@ AudioEncoderS16::~AudioEncoderS16(void)
 int AudioEncoderS16::writeSamples(const float *samples, int count)
 {
   int16_t s16_samples[count];
-  
-  for (int i=0; i<count; ++i)
-  {
-    float sample = samples[i];
-    if (sample > 1.0)
-    {
-      s16_samples[i] = 32767;
-    }
-    else if (sample < -1.0)
-    {
-      s16_samples[i] = -32767;
-    }
-    else
-    {
-      s16_samples[i] = static_cast<int16_t>(sample * 32767.0);
-    }
-  }
-  
+  AudioSampleConv::floatToS16(s16_samples, samples, count);
   writeEncodedSamples(s16_samples, count * sizeof(*s16_samples));
   
   return count;
@@ -0,0 +1,283 @@
+/**
+@file	 AsyncAudioEncoderThreaded.cpp
+@brief   Run an audio encoder in a worker thread
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-17
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioEncoderThreaded.h"
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+class AudioEncoderThreaded::EncodeJob : public AudioCodecPool::Job
+{
+  public:
+    typedef enum
+    {
+      SAMPLES, FLUSH, OPTION, PRINT
+    } Type;
+
+    struct Output
+    {
+      bool          flush;
+      vector<char>  data;
+    };
+
+    AudioEncoderThreaded  *enc;
+    Type                  type;
+    vector<float>         samples;
+    string                name;
+    string                value;
+    vector<Output>        output;
+
+    EncodeJob(AudioEncoderThreaded *enc, Type type) : enc(enc), type(type) {}
+
+    virtual void run(void)
+    {
+      enc->current_job = this;
+      switch (type)
+      {
+        case SAMPLES:
+          enc->encoder->writeSamples(&samples[0], samples.size());
+          break;
+        case FLUSH:
+          enc->encoder->flushSamples();
+          break;
+        case OPTION:
+          enc->encoder->setOption(name, value);
+          break;
+        case PRINT:
+          enc->encoder->printCodecParams();
+          break;
+      }
+      enc->current_job = 0;
+    }
+
+    virtual void complete(void)
+    {
+        // A handler connected to the signals may delete the encoder. The
+        // destructor then clear the alive flag and nothing more may be done.
+      bool alive = true;
+      enc->alive = &alive;
+      for (size_t i=0; alive && (i<output.size()); ++i)
+      {
+        if (output[i].flush)
+        {
+          enc->flushEncodedSamples();
+        }
+        else
+        {
+          enc->writeEncodedSamples(&output[i].data[0], output[i].data.size());
+        }
+      }
+      if (alive)
+      {
+        enc->alive = 0;
+      }
+    }
+};
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+AudioEncoderThreaded::AudioEncoderThreaded(AudioEncoder *encoder,
+                                           AudioCodecPool *pool)
+  : encoder(encoder), strand(new AudioCodecPool::Strand(pool)),
+    current_job(0), alive(0)
+{
+  encoder->writeEncodedSamples.connect(
+      mem_fun(*this, &AudioEncoderThreaded::onEncodedSamples));
+  encoder->flushEncodedSamples.connect(
+      mem_fun(*this, &AudioEncoderThreaded::onFlushEncodedSamples));
+} /* AudioEncoderThreaded::AudioEncoderThreaded */
+
+
+AudioEncoderThreaded::~AudioEncoderThreaded(void)
+{
+  if (alive != 0)
+  {
+    *alive = false;
+  }
+    // The strand must be deleted first since it wait for a running job to
+    // finish using the encoder
+  delete strand;
+  delete encoder;
+} /* AudioEncoderThreaded::~AudioEncoderThreaded */
+
+
+void AudioEncoderThreaded::setOption(const std::string &name,
+                                     const std::string &value)
+{
+  EncodeJob *job = new EncodeJob(this, EncodeJob::OPTION);
+  job->name = name;
+  job->value = value;
+  strand->post(job);
+} /* AudioEncoderThreaded::setOption */
+
+
+void AudioEncoderThreaded::printCodecParams(void)
+{
+  strand->post(new EncodeJob(this, EncodeJob::PRINT));
+} /* AudioEncoderThreaded::printCodecParams */
+
+
+int AudioEncoderThreaded::writeSamples(const float *samples, int count)
+{
+  if (count <= 0)
+  {
+    return 0;
+  }
+  EncodeJob *job = new EncodeJob(this, EncodeJob::SAMPLES);
+  job->samples.assign(samples, samples + count);
+  strand->post(job);
+  return count;
+} /* AudioEncoderThreaded::writeSamples */
+
+
+void AudioEncoderThreaded::flushSamples(void)
+{
+  strand->post(new EncodeJob(this, EncodeJob::FLUSH));
+} /* AudioEncoderThreaded::flushSamples */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void AudioEncoderThreaded::onEncodedSamples(const void *buf, int size)
+{
+    // Called in the worker thread while running a job
+  if (size <= 0)
+  {
+    return;
+  }
+  const char *ptr = reinterpret_cast<const char *>(buf);
+  EncodeJob::Output out;
+  out.flush = false;
+  out.data.assign(ptr, ptr + size);
+  current_job->output.push_back(out);
+} /* AudioEncoderThreaded::onEncodedSamples */
+
+
+void AudioEncoderThreaded::onFlushEncodedSamples(void)
+{
+    // Called in the worker thread while running a job
+  EncodeJob::Output out;
+  out.flush = true;
+  current_job->output.push_back(out);
+} /* AudioEncoderThreaded::onFlushEncodedSamples */
+
+
+
+
+/*
+ * This file has not been truncated
+ */
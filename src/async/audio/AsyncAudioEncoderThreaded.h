@@ -0,0 +1,194 @@
+/**
+@file	 AsyncAudioEncoderThreaded.h
+@brief   Run an audio encoder in a worker thread
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-17
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_AUDIO_ENCODER_THREADED_INCLUDED
+#define ASYNC_AUDIO_ENCODER_THREADED_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <vector>
+#include <string>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioEncoder.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioCodecPool.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Run an audio encoder in a worker thread
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-17
+
+This class wrap another audio encoder and run it in a worker thread from an
+Async::AudioCodecPool. Samples written to this object are copied and handed
+over to the worker thread. Encoded samples are delivered back to the main
+thread, where they are emitted using the writeEncodedSamples signal, in the
+same order as the samples were written. A flush is handled in order with the
+audio so the flushEncodedSamples signal is emitted after the last encoded
+samples written before the flush. Options are also applied in order.
+
+The encoded audio is delayed by the time it take to hand the samples over to
+the worker thread and back again. In exchange, the event loop is not blocked
+while encoding, which matter when many streams are encoded at the same time.
+*/
+class AudioEncoderThreaded : public AudioEncoder
+{
+  public:
+    /**
+     * @brief 	Constructor
+     * @param 	encoder The encoder to wrap. Ownership is taken over.
+     * @param 	pool The pool to run the encoder in
+     */
+    AudioEncoderThreaded(AudioEncoder *encoder, AudioCodecPool *pool);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~AudioEncoderThreaded(void);
+
+    /**
+     * @brief   Get the name of the codec
+     * @returns Return the name of the wrapped codec
+     */
+    virtual const char *name(void) const { return encoder->name(); }
+
+    /**
+     * @brief 	Set an option for the encoder
+     * @param 	name The name of the option
+     * @param 	value The value of the option
+     */
+    virtual void setOption(const std::string &name, const std::string &value);
+
+    /**
+     * @brief Print codec parameter settings
+     */
+    virtual void printCodecParams(void);
+
+    /**
+     * @brief 	Write samples into this audio sink
+     * @param 	samples The buffer containing the samples
+     * @param 	count The number of samples in the buffer
+     * @return	Returns the number of samples that has been taken care of
+     */
+    virtual int writeSamples(const float *samples, int count);
+
+    /**
+     * @brief 	Tell the sink to flush the previously written samples
+     */
+    virtual void flushSamples(void);
+
+  private:
+    class EncodeJob;
+
+    AudioEncoder            *encoder;
+    AudioCodecPool::Strand  *strand;
+    EncodeJob               *current_job;
+    bool                    *alive;
+
+    AudioEncoderThreaded(const AudioEncoderThreaded&);
+    AudioEncoderThreaded& operator=(const AudioEncoderThreaded&);
+    void onEncodedSamples(const void *buf, int size);
+    void onFlushEncodedSamples(void);
+
+};  /* class AudioEncoderThreaded */
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_ENCODER_THREADED_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
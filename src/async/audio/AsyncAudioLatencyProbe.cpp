@@ -0,0 +1,675 @@
+/**
+@file	 AsyncAudioLatencyProbe.cpp
+@brief   Measure the latency through an audio pipeline
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-11-22
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2004-2017  Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <time.h>
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <deque>
+#include <set>
+#include <map>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioLatencyProbe.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+#define DEFAULT_MARKER_INTERVAL 100     // ms
+#define BIN_WIDTH_MS            2
+#define BIN_CNT                 1000    // Covers 0 - 2000ms
+#define MAX_MARKER_AGE          10000   // ms
+#define MAX_ENDED_STREAMS       32
+#define NO_MARKER               (~0U)
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+namespace {
+  struct Marker
+  {
+    unsigned long pos;
+    uint64_t      ns;
+  };
+
+  struct Stream
+  {
+    std::string         trace;
+    std::string         origin;
+    bool                active;
+    std::deque<Marker>  markers;
+    unsigned            first_marker;
+  };
+
+  class Histogram
+  {
+    public:
+      Histogram(void) : bins(BIN_CNT + 1, 0), cnt(0), sum_ns(0), min_ns(0),
+                        max_ns(0) {}
+
+      void add(uint64_t ns)
+      {
+        unsigned bin = ns / (BIN_WIDTH_MS * 1000000ULL);
+        bins[bin < BIN_CNT ? bin : BIN_CNT] += 1;
+        min_ns = ((cnt == 0) || (ns < min_ns)) ? ns : min_ns;
+        max_ns = (ns > max_ns) ? ns : max_ns;
+        sum_ns += ns;
+        ++cnt;
+      }
+
+      unsigned long count(void) const { return cnt; }
+      double minMs(void) const { return min_ns / 1000000.0; }
+      double maxMs(void) const { return max_ns / 1000000.0; }
+      double avgMs(void) const
+      {
+        return (cnt > 0) ? (sum_ns / 1000000.0 / cnt) : 0.0;
+      }
+
+        // Return the upper edge of the bin containing the given percentile
+      unsigned percentileMs(unsigned pct) const
+      {
+        unsigned long limit = (cnt * pct + 99) / 100;
+        unsigned long acc = 0;
+        for (unsigned i=0; i<bins.size(); ++i)
+        {
+          acc += bins[i];
+          if ((acc > 0) && (acc >= limit))
+          {
+            return (i + 1) * BIN_WIDTH_MS;
+          }
+        }
+        return 0;
+      }
+
+      const std::vector<unsigned long>& binCounts(void) const { return bins; }
+
+    private:
+      std::vector<unsigned long>  bins;
+      unsigned long               cnt;
+      uint64_t                    sum_ns;
+      uint64_t                    min_ns;
+      uint64_t                    max_ns;
+  };
+
+  struct ProbeStats
+  {
+    std::string trace;
+    Histogram   start;
+    Histogram   frame;
+  };
+
+  typedef std::map<unsigned long, Stream>                       StreamMap;
+  typedef std::pair<std::string, std::string>                   StatsKey;
+  typedef std::map<StatsKey, ProbeStats>                        StatsMap;
+  typedef std::set<std::pair<std::string, std::string> >        LinkSet;
+
+  struct Registry
+  {
+    StreamMap       streams;
+    StatsMap        stats;
+    LinkSet         links;
+    unsigned long   next_stream_id;
+
+    Registry(void) : next_stream_id(1) {}
+  };
+};
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+namespace {
+  Registry& registry(void);
+  uint64_t now_ns(void);
+  void visible_traces(const std::string& trace, std::set<std::string>& traces);
+  void purge_streams(void);
+  void write_json_histogram(std::ostream& os, const Histogram& hist);
+  std::string json_escape(const std::string& str);
+};
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+bool AudioLatencyProbe::enabled = false;
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+void AudioLatencyProbe::linkTraces(const std::string& from,
+                                   const std::string& to)
+{
+  if (from != to)
+  {
+    registry().links.insert(make_pair(from, to));
+  }
+} /* AudioLatencyProbe::linkTraces */
+
+
+void AudioLatencyProbe::unlinkTraces(const std::string& from,
+                                     const std::string& to)
+{
+  registry().links.erase(make_pair(from, to));
+} /* AudioLatencyProbe::unlinkTraces */
+
+
+void AudioLatencyProbe::reset(void)
+{
+  StatsMap& stats = registry().stats;
+  for (StatsMap::iterator it = stats.begin(); it != stats.end(); ++it)
+  {
+    (*it).second.start = Histogram();
+    (*it).second.frame = Histogram();
+  }
+} /* AudioLatencyProbe::reset */
+
+
+void AudioLatencyProbe::writeReport(std::ostream& os)
+{
+  const StatsMap& stats = registry().stats;
+  ios_base::fmtflags orig_flags = os.flags();
+  streamsize orig_precision = os.precision();
+  os << setiosflags(ios::fixed) << setprecision(1);
+  os << left << setw(28) << "Probe" << setw(16) << "Origin" << right
+     << setw(6) << "Type" << setw(9) << "Count" << setw(8) << "Min"
+     << setw(8) << "Avg" << setw(8) << "Max" << setw(7) << "P50"
+     << setw(7) << "P95" << setw(7) << "P99" << "  (ms)" << endl;
+  for (StatsMap::const_iterator it = stats.begin(); it != stats.end(); ++it)
+  {
+    const StatsKey& key = (*it).first;
+    const Histogram *hists[] = { &(*it).second.start, &(*it).second.frame };
+    const char *types[] = { "start", "frame" };
+    for (int i=0; i<2; ++i)
+    {
+      const Histogram& hist = *hists[i];
+      if (hist.count() == 0)
+      {
+        continue;
+      }
+      os << left << setw(28) << key.first << setw(16) << key.second << right
+         << setw(6) << types[i] << setw(9) << hist.count()
+         << setw(8) << hist.minMs() << setw(8) << hist.avgMs()
+         << setw(8) << hist.maxMs() << setw(7) << hist.percentileMs(50)
+         << setw(7) << hist.percentileMs(95)
+         << setw(7) << hist.percentileMs(99) << endl;
+    }
+  }
+  os.flags(orig_flags);
+  os.precision(orig_precision);
+} /* AudioLatencyProbe::writeReport */
+
+
+void AudioLatencyProbe::writeJson(std::ostream& os)
+{
+  const StatsMap& stats = registry().stats;
+  os << "{\n  \"bin_width_ms\": " << BIN_WIDTH_MS << ",\n  \"probes\": [";
+  for (StatsMap::const_iterator it = stats.begin(); it != stats.end(); ++it)
+  {
+    const StatsKey& key = (*it).first;
+    const ProbeStats& st = (*it).second;
+    os << ((it == stats.begin()) ? "\n" : ",\n");
+    os << "    {\"probe\": \"" << json_escape(key.first) << "\""
+       << ", \"trace\": \"" << json_escape(st.trace) << "\""
+       << ", \"origin\": \"" << json_escape(key.second) << "\"";
+    os << ",\n     \"start\": ";
+    write_json_histogram(os, st.start);
+    os << ",\n     \"frame\": ";
+    write_json_histogram(os, st.frame);
+    os << "}";
+  }
+  os << "\n  ]\n}\n";
+} /* AudioLatencyProbe::writeJson */
+
+
+AudioLatencyProbe::AudioLatencyProbe(Type type, const std::string& trace,
+                                     const std::string& name)
+  : m_type(type), m_trace(trace), m_name(name), m_marker_interval(0),
+    m_pos_offset(0), m_streaming(false), m_pos(0), m_stream_id(0),
+    m_next_marker(0)
+{
+  setMarkerInterval(DEFAULT_MARKER_INTERVAL);
+} /* AudioLatencyProbe::AudioLatencyProbe */
+
+
+AudioLatencyProbe::~AudioLatencyProbe(void)
+{
+  endStream();
+} /* AudioLatencyProbe::~AudioLatencyProbe */
+
+
+void AudioLatencyProbe::setMarkerInterval(unsigned interval_ms)
+{
+  m_marker_interval = interval_ms * INTERNAL_SAMPLE_RATE / 1000;
+  if (m_marker_interval == 0)
+  {
+    m_marker_interval = 1;
+  }
+} /* AudioLatencyProbe::setMarkerInterval */
+
+
+int AudioLatencyProbe::writeSamples(const float *samples, int count)
+{
+  if (!m_streaming && (count > 0))
+  {
+    startStream();
+  }
+
+  if (m_type == ORIGIN)
+  {
+      // The markers must be recorded before the samples are forwarded since
+      // the measurement probes may be called before sinkWriteSamples return
+    addMarkers(count);
+    int ret = sinkWriteSamples(samples, count);
+    if (ret < count)
+    {
+      removeMarkers(ret);
+    }
+    m_pos += ret;
+    return ret;
+  }
+
+  int ret = sinkWriteSamples(samples, count);
+  measureMarkers(ret);
+  m_pos += ret;
+  return ret;
+} /* AudioLatencyProbe::writeSamples */
+
+
+void AudioLatencyProbe::flushSamples(void)
+{
+  endStream();
+  sinkFlushSamples();
+} /* AudioLatencyProbe::flushSamples */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void AudioLatencyProbe::startStream(void)
+{
+  Registry& reg = registry();
+  m_streaming = true;
+  m_pos = 0;
+  m_next_marker = 0;
+
+  if (m_type == ORIGIN)
+  {
+    purge_streams();
+    m_stream_id = reg.next_stream_id++;
+    Stream& stream = reg.streams[m_stream_id];
+    stream.trace = m_trace;
+    stream.origin = m_name;
+    stream.active = true;
+    stream.first_marker = 0;
+    return;
+  }
+
+    // Bind to the most recently started stream visible in our trace. A
+    // stream that we have already measured is never used again. Active
+    // streams are preferred but a stream that just ended may still have
+    // audio in the buffers between the origin and this probe.
+  set<string> traces;
+  visible_traces(m_trace, traces);
+  unsigned long best_id = 0;
+  bool best_active = false;
+  for (StreamMap::const_iterator it = reg.streams.begin();
+       it != reg.streams.end(); ++it)
+  {
+    const Stream& stream = (*it).second;
+    if (((*it).first <= m_stream_id) ||
+        (traces.find(stream.trace) == traces.end()))
+    {
+      continue;
+    }
+    if (stream.active || !best_active)
+    {
+      best_id = (*it).first;
+      best_active = stream.active;
+    }
+  }
+  if (best_id != 0)
+  {
+    m_stream_id = best_id;
+    StatsKey key(m_name, reg.streams[best_id].origin);
+    reg.stats[key].trace = m_trace;
+  }
+  else
+  {
+      // Nothing to measure in this stream, e.g. an announcement
+    m_next_marker = NO_MARKER;
+  }
+} /* AudioLatencyProbe::startStream */
+
+
+void AudioLatencyProbe::endStream(void)
+{
+  if (!m_streaming)
+  {
+    return;
+  }
+  m_streaming = false;
+  if (m_type == ORIGIN)
+  {
+    StreamMap::iterator it = registry().streams.find(m_stream_id);
+    if (it != registry().streams.end())
+    {
+      (*it).second.active = false;
+    }
+  }
+} /* AudioLatencyProbe::endStream */
+
+
+void AudioLatencyProbe::addMarkers(unsigned count)
+{
+  StreamMap::iterator it = registry().streams.find(m_stream_id);
+  if (it == registry().streams.end())
+  {
+    return;
+  }
+  Stream& stream = (*it).second;
+  uint64_t now = now_ns();
+  unsigned long end_pos = m_pos + count;
+  while (static_cast<unsigned long>(m_next_marker) * m_marker_interval
+         < end_pos)
+  {
+    Marker marker;
+    marker.pos = m_next_marker * m_marker_interval;
+    if (m_next_marker > 0)
+    {
+      marker.pos += m_pos_offset;
+    }
+    marker.ns = now;
+    stream.markers.push_back(marker);
+    ++m_next_marker;
+  }
+
+    // Forget markers that are too old to ever be used
+  uint64_t max_age = MAX_MARKER_AGE * 1000000ULL;
+  while ((stream.markers.size() > 1) &&
+         (now - stream.markers.front().ns > max_age))
+  {
+    stream.markers.pop_front();
+    ++stream.first_marker;
+  }
+} /* AudioLatencyProbe::addMarkers */
+
+
+void AudioLatencyProbe::removeMarkers(unsigned written)
+{
+  StreamMap::iterator it = registry().streams.find(m_stream_id);
+  if (it == registry().streams.end())
+  {
+    return;
+  }
+  Stream& stream = (*it).second;
+  unsigned long written_end_pos = m_pos + written;
+  while (!stream.markers.empty() && (m_next_marker > stream.first_marker) &&
+         (static_cast<unsigned long>(m_next_marker - 1) * m_marker_interval
+          >= written_end_pos))
+  {
+    stream.markers.pop_back();
+    --m_next_marker;
+  }
+} /* AudioLatencyProbe::removeMarkers */
+
+
+void AudioLatencyProbe::measureMarkers(unsigned count)
+{
+  Registry& reg = registry();
+  StreamMap::iterator it = reg.streams.find(m_stream_id);
+  if ((count == 0) || (m_next_marker == NO_MARKER) ||
+      (it == reg.streams.end()))
+  {
+    return;
+  }
+  Stream& stream = (*it).second;
+  uint64_t now = now_ns();
+  unsigned long end_pos = m_pos + count;
+  if (m_next_marker < stream.first_marker)
+  {
+    m_next_marker = stream.first_marker;
+  }
+  ProbeStats& stats = reg.stats[StatsKey(m_name, stream.origin)];
+  while (m_next_marker - stream.first_marker < stream.markers.size())
+  {
+    const Marker& marker = stream.markers[m_next_marker - stream.first_marker];
+    if (marker.pos >= end_pos)
+    {
+      break;
+    }
+    uint64_t latency = (now > marker.ns) ? (now - marker.ns) : 0;
+    if (m_next_marker == 0)
+    {
+      stats.start.add(latency);
+    }
+    else
+    {
+      stats.frame.add(latency);
+    }
+    ++m_next_marker;
+  }
+} /* AudioLatencyProbe::measureMarkers */
+
+
+
+namespace {
+  Registry& registry(void)
+  {
+    static Registry reg;
+    return reg;
+  } /* registry */
+
+
+  uint64_t now_ns(void)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+  } /* now_ns */
+
+
+    // Find all traces whose origins are visible in the given trace, that is
+    // the trace itself and all traces linked to it, directly or indirectly.
+  void visible_traces(const std::string& trace, std::set<std::string>& traces)
+  {
+    const LinkSet& links = registry().links;
+    vector<string> work(1, trace);
+    traces.insert(trace);
+    while (!work.empty())
+    {
+      string to = work.back();
+      work.pop_back();
+      for (LinkSet::const_iterator it = links.begin(); it != links.end(); ++it)
+      {
+        if (((*it).second == to) && traces.insert((*it).first).second)
+        {
+          work.push_back((*it).first);
+        }
+      }
+    }
+  } /* visible_traces */
+
+
+    // Throw away the oldest ended streams so that the registry does not grow
+    // without bounds
+  void purge_streams(void)
+  {
+    StreamMap& streams = registry().streams;
+    unsigned ended_cnt = 0;
+    for (StreamMap::const_iterator it = streams.begin(); it != streams.end();
+         ++it)
+    {
+      ended_cnt += (*it).second.active ? 0 : 1;
+    }
+    StreamMap::iterator it = streams.begin();
+    while ((ended_cnt > MAX_ENDED_STREAMS) && (it != streams.end()))
+    {
+      if (!(*it).second.active)
+      {
+        streams.erase(it++);
+        --ended_cnt;
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  } /* purge_streams */
+
+
+  void write_json_histogram(std::ostream& os, const Histogram& hist)
+  {
+    os << "{\"count\": " << hist.count()
+       << ", \"min_ms\": " << hist.minMs()
+       << ", \"avg_ms\": " << hist.avgMs()
+       << ", \"max_ms\": " << hist.maxMs()
+       << ", \"p50_ms\": " << hist.percentileMs(50)
+       << ", \"p95_ms\": " << hist.percentileMs(95)
+       << ", \"p99_ms\": " << hist.percentileMs(99)
+       << ", \"bins\": {";
+    const vector<unsigned long>& bins = hist.binCounts();
+    bool first = true;
+    for (unsigned i=0; i<bins.size(); ++i)
+    {
+      if (bins[i] > 0)
+      {
+        os << (first ? "" : ", ") << "\"" << (i * BIN_WIDTH_MS) << "\": "
+           << bins[i];
+        first = false;
+      }
+    }
+    os << "}}";
+  } /* write_json_histogram */
+
+
+  std::string json_escape(const std::string& str)
+  {
+    string escaped;
+    for (string::const_iterator it = str.begin(); it != str.end(); ++it)
+    {
+      switch (*it)
+      {
+        case '"':
+          escaped += "\\\"";
+          break;
+        case '\\':
+          escaped += "\\\\";
+          break;
+        case '\n':
+          escaped += "\\n";
+          break;
+        default:
+          escaped += *it;
+          break;
+      }
+    }
+    return escaped;
+  } /* json_escape */
+};
+
+
+
+/*
+ * This file has not been truncated
+ */
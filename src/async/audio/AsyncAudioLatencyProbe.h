@@ -0,0 +1,297 @@
+/**
+@file	 AsyncAudioLatencyProbe.h
+@brief   Measure the latency through an audio pipeline
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-11-22
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2004-2017  Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/** @example AsyncAudioLatencyProbe_demo.cpp
+An example of how to use the AudioLatencyProbe class
+*/
+
+
+#ifndef ASYNC_AUDIO_LATENCY_PROBE_INCLUDED
+#define ASYNC_AUDIO_LATENCY_PROBE_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <string>
+#include <iosfwd>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioPassthrough.h>
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Measure the latency through an audio pipeline
+@author Tobias Blomberg / SM0SVX
+@date   2017-11-22
+
+Latency probes are audio passthrough objects that are inserted at interesting
+points in an audio pipeline. An origin probe is placed where an audio stream
+begin, typically directly after the squelch in a receiver. When the first
+sample of a new stream pass the origin probe, a stream start marker is
+recorded. After that a marker is recorded at a regular interval, counted in
+samples.
+
+Measurement probes are placed further down the pipeline. When a new stream
+pass a measurement probe it is bound to the most recently started stream from
+an origin probe in the same trace. When the measurement probe has seen as many
+samples as the position of a marker, the time since the marker was recorded is
+added to a histogram. The stream start marker is kept in a separate histogram
+so that the time from squelch open to the first sample reaching the probe can
+be told apart from the latency of the audio frames that follow.
+
+Since markers are matched by sample position no timestamps need to be
+carried with the audio. Buffers like FIFOs, jitter buffers and pacers are
+handled correctly as long as they do not drop or insert samples within a
+stream. Objects that insert a fixed number of samples, like a delay line,
+can be compensated for using the setPositionOffset function on the origin
+probe.
+
+Probes belong to a named trace. Traces can be linked so that a measurement
+probe also see the origins of other traces. For example, the trace of a voter
+is linked from the traces of all its satellite receivers.
+
+Probes should only be created when tracing is enabled. That way there is no
+overhead at all when tracing is not used.
+
+\include AsyncAudioLatencyProbe_demo.cpp
+*/
+class AudioLatencyProbe : public AudioPassthrough
+{
+  public:
+    /**
+     * @brief The role of a probe
+     */
+    typedef enum
+    {
+      ORIGIN,   ///< Start of streams, record markers
+      MEASURE   ///< Measure the latency of markers from an origin
+    } Type;
+
+    /**
+     * @brief   Enable or disable latency tracing
+     * @param   enable Set to \em true to enable tracing
+     *
+     * This function does not affect probes that have already been created.
+     * It is used by applications to decide if probes should be created.
+     */
+    static void setEnabled(bool enable) { enabled = enable; }
+
+    /**
+     * @brief   Check if latency tracing is enabled
+     * @return  Returns \em true if probes should be created
+     */
+    static bool isEnabled(void) { return enabled; }
+
+    /**
+     * @brief   Make the origins of one trace visible in another trace
+     * @param   from The trace containing origin probes
+     * @param   to The trace that also should see the origins
+     *
+     * Links are followed transitively.
+     */
+    static void linkTraces(const std::string& from, const std::string& to);
+
+    /**
+     * @brief   Remove a link created by linkTraces
+     * @param   from The trace containing origin probes
+     * @param   to The trace that should no longer see the origins
+     */
+    static void unlinkTraces(const std::string& from, const std::string& to);
+
+    /**
+     * @brief   Clear all histograms
+     */
+    static void reset(void);
+
+    /**
+     * @brief   Write a human readable latency report
+     * @param   os The stream to write to
+     *
+     * One line is written for each combination of measurement probe and
+     * origin probe with the number of measurements, the minimum, average
+     * and maximum latency and the 50th, 95th and 99th percentiles.
+     */
+    static void writeReport(std::ostream& os);
+
+    /**
+     * @brief   Write all latency histograms in JSON format
+     * @param   os The stream to write to
+     */
+    static void writeJson(std::ostream& os);
+
+    /**
+     * @brief   Constructor
+     * @param   type The role of the probe
+     * @param   trace The name of the trace this probe belong to
+     * @param   name The name of the probe
+     */
+    AudioLatencyProbe(Type type, const std::string& trace,
+                      const std::string& name);
+
+    /**
+     * @brief   Destructor
+     */
+    virtual ~AudioLatencyProbe(void);
+
+    /**
+     * @brief   Return the name of the probe
+     * @return  Returns the name given in the constructor
+     */
+    const std::string& name(void) const { return m_name; }
+
+    /**
+     * @brief   Set the interval between markers
+     * @param   interval_ms The interval in milliseconds
+     *
+     * This setting is only used by origin probes. The default is 100ms.
+     */
+    void setMarkerInterval(unsigned interval_ms);
+
+    /**
+     * @brief   Compensate for samples inserted after the origin
+     * @param   samples The number of samples to compensate for
+     *
+     * If an object downstream of an origin probe insert a fixed number of
+     * samples at the start of each stream, like a delay line does, the
+     * position of all markers after the stream start marker is adjusted by
+     * this number of samples.
+     */
+    void setPositionOffset(unsigned samples) { m_pos_offset = samples; }
+
+    /**
+     * @brief 	Write samples into this audio sink
+     * @param 	samples The buffer containing the samples
+     * @param 	count The number of samples in the buffer
+     * @return	Returns the number of samples that has been taken care of
+     */
+    virtual int writeSamples(const float *samples, int count);
+
+    /**
+     * @brief 	Tell the sink to flush the previously written samples
+     */
+    virtual void flushSamples(void);
+
+  protected:
+
+  private:
+    static bool enabled;
+
+    Type            m_type;
+    std::string     m_trace;
+    std::string     m_name;
+    unsigned        m_marker_interval;
+    unsigned        m_pos_offset;
+    bool            m_streaming;
+    unsigned long   m_pos;
+    unsigned long   m_stream_id;
+    unsigned        m_next_marker;
+
+    AudioLatencyProbe(const AudioLatencyProbe&);
+    AudioLatencyProbe& operator=(const AudioLatencyProbe&);
+    void startStream(void);
+    void endStream(void);
+    void addMarkers(unsigned count);
+    void removeMarkers(unsigned written);
+    void measureMarkers(unsigned count);
+
+};  /* class AudioLatencyProbe */
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_LATENCY_PROBE_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
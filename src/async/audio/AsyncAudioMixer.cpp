@@ -208,6 +208,7 @@ AudioMixer::~AudioMixer(void)
 void AudioMixer::addSource(AudioSource *source)
 {
   MixerSrc *mixer_src = new MixerSrc(this);
+  AudioProfiler::setOwner(mixer_src, this);
   //mixer_src->stopOutput(true);
   //mixer_src->setOverwrite(false);
   mixer_src->registerSource(source);
@@ -0,0 +1,772 @@
+/**
+@file	 AsyncAudioProfiler.cpp
+@brief   Instrumentation of the audio pipeline
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-11-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2004-2017  Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <time.h>
+#include <stdint.h>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <typeinfo>
+#include <vector>
+#include <set>
+#include <map>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioProfiler.h"
+#include "AsyncAudioSource.h"
+#include "AsyncAudioSink.h"
+#include "AsyncAudioFifo.h"
+#include "AsyncAudioJitterFifo.h"
+#include "AsyncAudioAdaptiveJitterFifo.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+namespace {
+  typedef enum
+  {
+    FIFO_UNKNOWN, FIFO_NONE, FIFO_PLAIN, FIFO_JITTER, FIFO_ADAPTIVE
+  } FifoType;
+
+  struct SinkStats
+  {
+    unsigned long write_cnt;
+    unsigned long sample_cnt;
+    uint64_t      total_ns;
+    uint64_t      self_ns;
+    uint64_t      max_ns;
+    unsigned long flush_cnt;
+    bool          flushing;
+    uint64_t      flush_start_ns;
+    uint64_t      flush_total_ns;
+    uint64_t      flush_max_ns;
+    FifoType      fifo_type;
+    unsigned      fill_max;
+
+    SinkStats(void)
+      : write_cnt(0), sample_cnt(0), total_ns(0), self_ns(0), max_ns(0),
+        flush_cnt(0), flushing(false), flush_start_ns(0), flush_total_ns(0),
+        flush_max_ns(0), fifo_type(FIFO_UNKNOWN), fill_max(0)
+    {
+    }
+  };
+
+  struct CallFrame
+  {
+    AudioSink*  sink;
+    uint64_t    child_ns;
+    bool        removed;
+  };
+
+  struct Owner
+  {
+    AudioSource*  source;
+    AudioSink*    sink;
+  };
+
+  struct Node
+  {
+    unsigned      id;
+    AudioSource*  source;
+    AudioSink*    sink;
+    Node(void) : id(0), source(0), sink(0) {}
+  };
+
+  struct Edge
+  {
+    const void* from;
+    const void* to;
+    bool        registered;
+  };
+
+  typedef std::set<AudioSource*>                  SourceSet;
+  typedef std::set<AudioSink*>                    SinkSet;
+  typedef std::map<AudioSink*, SinkStats>         StatsMap;
+  typedef std::map<const void*, std::string>      NameMap;
+  typedef std::map<const void*, Node>             NodeMap;
+  typedef std::map<const void*, Owner>            OwnerMap;
+
+  struct Registry
+  {
+    SourceSet               sources;
+    SinkSet                 sinks;
+    StatsMap                stats;
+    NameMap                 names;
+    OwnerMap                owners;
+    std::vector<CallFrame>  call_stack;
+  };
+};
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+namespace {
+  Registry& registry(void);
+  uint64_t now_ns(void);
+  unsigned fifo_fill(AudioSink *sink, FifoType type);
+  FifoType fifo_type(AudioSink *sink);
+  std::string type_name(const std::type_info& ti);
+  std::string json_escape(const std::string& str);
+  void build_graph(NodeMap& nodes, std::vector<Edge>& edges);
+  std::string node_name(const Node& node);
+  std::string node_type(const Node& node);
+};
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+bool AudioProfiler::enabled = false;
+bool AudioProfiler::used = false;
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+void AudioProfiler::setEnabled(bool enable)
+{
+  enabled = enable;
+  used = used || enable;
+} /* AudioProfiler::setEnabled */
+
+
+void AudioProfiler::reset(void)
+{
+  StatsMap& stats = registry().stats;
+  for (StatsMap::iterator it = stats.begin(); it != stats.end(); ++it)
+  {
+    SinkStats& st = (*it).second;
+    FifoType type = st.fifo_type;
+    bool flushing = st.flushing;
+    uint64_t flush_start_ns = st.flush_start_ns;
+    st = SinkStats();
+    st.fifo_type = type;
+    st.flushing = flushing;
+    st.flush_start_ns = flush_start_ns;
+  }
+} /* AudioProfiler::reset */
+
+
+void AudioProfiler::writeDot(std::ostream& os)
+{
+  NodeMap nodes;
+  vector<Edge> edges;
+  build_graph(nodes, edges);
+
+  Registry& reg = registry();
+  ostringstream ss;
+  ss << fixed << setprecision(3);
+  ss << "digraph audio {\n";
+  ss << "  node [shape=box, fontname=\"monospace\", fontsize=10];\n";
+  for (NodeMap::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+  {
+    const Node& node = (*it).second;
+    ss << "  n" << node.id << " [label=\"";
+    string name = node_name(node);
+    if (!name.empty())
+    {
+      ss << name << "\\n";
+    }
+    ss << node_type(node);
+    if (node.sink != 0)
+    {
+      StatsMap::const_iterator sit = reg.stats.find(node.sink);
+      if (sit != reg.stats.end())
+      {
+        const SinkStats& st = (*sit).second;
+        ss << "\\nwrites=" << st.write_cnt << " samples=" << st.sample_cnt
+           << "\\ntime=" << (st.total_ns / 1000000.0) << "ms"
+           << " self=" << (st.self_ns / 1000000.0) << "ms"
+           << " max=" << (st.max_ns / 1000.0) << "us";
+        if ((st.fifo_type != FIFO_NONE) && (st.fifo_type != FIFO_UNKNOWN))
+        {
+          ss << "\\nfill=" << fifo_fill(node.sink, st.fifo_type)
+             << " max=" << st.fill_max;
+        }
+        if (st.flush_cnt > 0)
+        {
+          ss << "\\nflushes=" << st.flush_cnt
+             << " avg=" << (st.flush_total_ns / st.flush_cnt / 1000000.0)
+             << "ms max=" << (st.flush_max_ns / 1000000.0) << "ms";
+        }
+      }
+    }
+    ss << "\"];\n";
+  }
+  for (vector<Edge>::const_iterator it = edges.begin(); it != edges.end();
+       ++it)
+  {
+    ss << "  n" << nodes[(*it).from].id << " -> n" << nodes[(*it).to].id;
+    if (!(*it).registered)
+    {
+      ss << " [style=dashed]";
+    }
+    ss << ";\n";
+  }
+  ss << "}\n";
+  os << ss.str();
+} /* AudioProfiler::writeDot */
+
+
+void AudioProfiler::writeJson(std::ostream& os)
+{
+  NodeMap nodes;
+  vector<Edge> edges;
+  build_graph(nodes, edges);
+
+  Registry& reg = registry();
+  ostringstream ss;
+  ss << fixed << setprecision(3);
+  ss << "{\n  \"enabled\": " << (enabled ? "true" : "false") << ",\n";
+  ss << "  \"nodes\": [";
+  const char *sep = "\n";
+  for (NodeMap::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+  {
+    const Node& node = (*it).second;
+    ss << sep << "    {\"id\": " << node.id
+       << ", \"name\": \"" << json_escape(node_name(node)) << "\""
+       << ", \"type\": \"" << json_escape(node_type(node)) << "\""
+       << ", \"source\": " << (node.source != 0 ? "true" : "false")
+       << ", \"sink\": " << (node.sink != 0 ? "true" : "false");
+    if (node.sink != 0)
+    {
+      StatsMap::const_iterator sit = reg.stats.find(node.sink);
+      if (sit != reg.stats.end())
+      {
+        const SinkStats& st = (*sit).second;
+        ss << ", \"writes\": " << st.write_cnt
+           << ", \"samples\": " << st.sample_cnt
+           << ", \"time_ms\": " << (st.total_ns / 1000000.0)
+           << ", \"self_time_ms\": " << (st.self_ns / 1000000.0)
+           << ", \"max_write_us\": " << (st.max_ns / 1000.0)
+           << ", \"flushes\": " << st.flush_cnt
+           << ", \"flush_avg_ms\": "
+           << (st.flush_cnt > 0
+               ? st.flush_total_ns / st.flush_cnt / 1000000.0 : 0.0)
+           << ", \"flush_max_ms\": " << (st.flush_max_ns / 1000000.0);
+        if ((st.fifo_type != FIFO_NONE) && (st.fifo_type != FIFO_UNKNOWN))
+        {
+          ss << ", \"fill\": " << fifo_fill(node.sink, st.fifo_type)
+             << ", \"fill_max\": " << st.fill_max;
+        }
+      }
+    }
+    ss << "}";
+    sep = ",\n";
+  }
+  ss << "\n  ],\n  \"edges\": [";
+  sep = "\n";
+  for (vector<Edge>::const_iterator it = edges.begin(); it != edges.end();
+       ++it)
+  {
+    ss << sep << "    {\"from\": " << nodes[(*it).from].id
+       << ", \"to\": " << nodes[(*it).to].id
+       << ", \"registered\": " << ((*it).registered ? "true" : "false")
+       << "}";
+    sep = ",\n";
+  }
+  ss << "\n  ]\n}\n";
+  os << ss.str();
+} /* AudioProfiler::writeJson */
+
+
+void AudioProfiler::addSource(AudioSource *source)
+{
+  registry().sources.insert(source);
+} /* AudioProfiler::addSource */
+
+
+void AudioProfiler::removeSource(AudioSource *source)
+{
+  Registry& reg = registry();
+  reg.sources.erase(source);
+  reg.names.erase(source);
+  reg.owners.erase(source);
+} /* AudioProfiler::removeSource */
+
+
+void AudioProfiler::addSink(AudioSink *sink)
+{
+  registry().sinks.insert(sink);
+} /* AudioProfiler::addSink */
+
+
+void AudioProfiler::removeSink(AudioSink *sink)
+{
+  Registry& reg = registry();
+  reg.sinks.erase(sink);
+  reg.stats.erase(sink);
+  reg.names.erase(sink);
+  reg.owners.erase(sink);
+  for (vector<CallFrame>::iterator it = reg.call_stack.begin();
+       it != reg.call_stack.end(); ++it)
+  {
+    if ((*it).sink == sink)
+    {
+      (*it).removed = true;
+    }
+  }
+} /* AudioProfiler::removeSink */
+
+
+/**
+ * The time spent in a sink includes the time spent in all sinks further down
+ * the chain since the samples are normally passed on synchronously. The time
+ * of nested writes is therefore accumulated in the call frame of the caller so
+ * that the time spent in the sink itself can be calculated.
+ */
+int AudioProfiler::writeSamples(AudioSink *sink, const float *samples,
+                                int count)
+{
+  Registry& reg = registry();
+  CallFrame frame;
+  frame.sink = sink;
+  frame.child_ns = 0;
+  frame.removed = false;
+  reg.call_stack.push_back(frame);
+
+  uint64_t start = now_ns();
+  int ret = sink->writeSamples(samples, count);
+  uint64_t elapsed = now_ns() - start;
+
+  frame = reg.call_stack.back();
+  reg.call_stack.pop_back();
+  if (!reg.call_stack.empty())
+  {
+    reg.call_stack.back().child_ns += elapsed;
+  }
+  if (frame.removed)
+  {
+    return ret;
+  }
+
+  SinkStats& st = reg.stats[sink];
+  st.write_cnt += 1;
+  st.sample_cnt += (ret > 0) ? ret : 0;
+  st.total_ns += elapsed;
+  st.self_ns += (elapsed > frame.child_ns) ? (elapsed - frame.child_ns) : 0;
+  if (elapsed > st.max_ns)
+  {
+    st.max_ns = elapsed;
+  }
+  if (st.fifo_type == FIFO_UNKNOWN)
+  {
+    st.fifo_type = fifo_type(sink);
+  }
+  if (st.fifo_type != FIFO_NONE)
+  {
+    unsigned fill = fifo_fill(sink, st.fifo_type);
+    if (fill > st.fill_max)
+    {
+      st.fill_max = fill;
+    }
+  }
+
+  return ret;
+} /* AudioProfiler::writeSamples */
+
+
+void AudioProfiler::flushStarted(AudioSink *sink)
+{
+  SinkStats& st = registry().stats[sink];
+  if (!st.flushing)
+  {
+    st.flushing = true;
+    st.flush_start_ns = now_ns();
+  }
+} /* AudioProfiler::flushStarted */
+
+
+void AudioProfiler::flushDone(AudioSink *sink)
+{
+  if (sink == 0)
+  {
+    return;
+  }
+  Registry& reg = registry();
+  StatsMap::iterator it = reg.stats.find(sink);
+  if ((it == reg.stats.end()) || !(*it).second.flushing)
+  {
+    return;
+  }
+  SinkStats& st = (*it).second;
+  uint64_t latency = now_ns() - st.flush_start_ns;
+  st.flushing = false;
+  st.flush_cnt += 1;
+  st.flush_total_ns += latency;
+  if (latency > st.flush_max_ns)
+  {
+    st.flush_max_ns = latency;
+  }
+} /* AudioProfiler::flushDone */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void AudioProfiler::setNodeName(AudioSource *source, AudioSink *sink,
+                                const std::string& name)
+{
+  Registry& reg = registry();
+  if (source != 0)
+  {
+    reg.names[source] = name;
+  }
+  if (sink != 0)
+  {
+    reg.names[sink] = name;
+  }
+} /* AudioProfiler::setNodeName */
+
+
+void AudioProfiler::setNodeOwner(AudioSource *source, AudioSink *sink,
+                                 AudioSource *owner_source,
+                                 AudioSink *owner_sink)
+{
+  Owner owner;
+  owner.source = owner_source;
+  owner.sink = owner_sink;
+  Registry& reg = registry();
+  if (source != 0)
+  {
+    reg.owners[source] = owner;
+  }
+  else if (sink != 0)
+  {
+    reg.owners[sink] = owner;
+  }
+} /* AudioProfiler::setNodeOwner */
+
+
+
+namespace {
+  Registry& registry(void)
+  {
+    static Registry reg;
+    return reg;
+  } /* registry */
+
+
+  uint64_t now_ns(void)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+  } /* now_ns */
+
+
+  FifoType fifo_type(AudioSink *sink)
+  {
+    if (dynamic_cast<AudioFifo*>(sink) != 0)
+    {
+      return FIFO_PLAIN;
+    }
+    if (dynamic_cast<AudioJitterFifo*>(sink) != 0)
+    {
+      return FIFO_JITTER;
+    }
+    if (dynamic_cast<AudioAdaptiveJitterFifo*>(sink) != 0)
+    {
+      return FIFO_ADAPTIVE;
+    }
+    return FIFO_NONE;
+  } /* fifo_type */
+
+
+  unsigned fifo_fill(AudioSink *sink, FifoType type)
+  {
+    switch (type)
+    {
+      case FIFO_PLAIN:
+        return static_cast<AudioFifo*>(sink)->samplesInFifo();
+      case FIFO_JITTER:
+        return static_cast<AudioJitterFifo*>(sink)->samplesInFifo();
+      case FIFO_ADAPTIVE:
+        return static_cast<AudioAdaptiveJitterFifo*>(sink)->samplesInFifo();
+      default:
+        return 0;
+    }
+  } /* fifo_fill */
+
+
+  std::string type_name(const std::type_info& ti)
+  {
+    string name(ti.name());
+#ifdef __GNUC__
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(ti.name(), 0, 0, &status);
+    if (demangled != 0)
+    {
+      if (status == 0)
+      {
+        name = demangled;
+      }
+      free(demangled);
+    }
+#endif
+    return name;
+  } /* type_name */
+
+
+  std::string json_escape(const std::string& str)
+  {
+    string escaped;
+    for (string::const_iterator it = str.begin(); it != str.end(); ++it)
+    {
+      switch (*it)
+      {
+        case '"':
+          escaped += "\\\"";
+          break;
+        case '\\':
+          escaped += "\\\\";
+          break;
+        case '\n':
+          escaped += "\\n";
+          break;
+        default:
+          escaped += *it;
+          break;
+      }
+    }
+    return escaped;
+  } /* json_escape */
+
+
+    // Objects that are both a source and a sink are merged into one node,
+    // identified by the address of the most derived object.
+  void build_graph(NodeMap& nodes, std::vector<Edge>& edges)
+  {
+    Registry& reg = registry();
+    for (SourceSet::const_iterator it = reg.sources.begin();
+         it != reg.sources.end(); ++it)
+    {
+      nodes[dynamic_cast<const void*>(*it)].source = *it;
+    }
+    for (SinkSet::const_iterator it = reg.sinks.begin();
+         it != reg.sinks.end(); ++it)
+    {
+      nodes[dynamic_cast<const void*>(*it)].sink = *it;
+    }
+
+      // Add edges from all known sources. Sources that are connected to a
+      // sink without the sink knowing about it are internal handlers.
+    for (SourceSet::const_iterator it = reg.sources.begin();
+         it != reg.sources.end(); ++it)
+    {
+      AudioSink *sink = (*it)->sink();
+      if (sink != 0)
+      {
+        Edge edge;
+        edge.from = dynamic_cast<const void*>(*it);
+        edge.to = dynamic_cast<const void*>(sink);
+        edge.registered = (sink->source() == *it);
+        nodes[edge.to].sink = sink;
+        edges.push_back(edge);
+      }
+    }
+
+      // Add edges from unknown sources connected to a known sink
+    for (SinkSet::const_iterator it = reg.sinks.begin();
+         it != reg.sinks.end(); ++it)
+    {
+      AudioSource *source = (*it)->source();
+      if ((source != 0) && (reg.sources.find(source) == reg.sources.end()))
+      {
+        Edge edge;
+        edge.from = dynamic_cast<const void*>(source);
+        edge.to = dynamic_cast<const void*>(*it);
+        edge.registered = true;
+        nodes[edge.from].source = source;
+        edges.push_back(edge);
+      }
+    }
+
+      // Add edges between internal objects and their owners. An internal
+      // source get audio from its owner while an internal sink pass audio on
+      // to its owner.
+    for (SourceSet::const_iterator it = reg.sources.begin();
+         it != reg.sources.end(); ++it)
+    {
+      OwnerMap::const_iterator oit = reg.owners.find(*it);
+      if (oit != reg.owners.end())
+      {
+        const Owner& owner = (*oit).second;
+        Edge edge;
+        edge.from = (owner.source != 0)
+          ? dynamic_cast<const void*>(owner.source)
+          : dynamic_cast<const void*>(owner.sink);
+        edge.to = dynamic_cast<const void*>(*it);
+        edge.registered = false;
+        Node& node = nodes[edge.from];
+        node.source = (node.source != 0) ? node.source : owner.source;
+        node.sink = (node.sink != 0) ? node.sink : owner.sink;
+        edges.push_back(edge);
+      }
+    }
+    for (SinkSet::const_iterator it = reg.sinks.begin();
+         it != reg.sinks.end(); ++it)
+    {
+      OwnerMap::const_iterator oit = reg.owners.find(*it);
+      if (oit != reg.owners.end())
+      {
+        const Owner& owner = (*oit).second;
+        Edge edge;
+        edge.from = dynamic_cast<const void*>(*it);
+        edge.to = (owner.sink != 0)
+          ? dynamic_cast<const void*>(owner.sink)
+          : dynamic_cast<const void*>(owner.source);
+        edge.registered = false;
+        Node& node = nodes[edge.to];
+        node.source = (node.source != 0) ? node.source : owner.source;
+        node.sink = (node.sink != 0) ? node.sink : owner.sink;
+        edges.push_back(edge);
+      }
+    }
+
+    unsigned id = 0;
+    for (NodeMap::iterator it = nodes.begin(); it != nodes.end(); ++it)
+    {
+      (*it).second.id = id++;
+    }
+  } /* build_graph */
+
+
+  std::string node_name(const Node& node)
+  {
+    Registry& reg = registry();
+    NameMap::const_iterator it = reg.names.end();
+    if (node.source != 0)
+    {
+      it = reg.names.find(node.source);
+    }
+    if ((it == reg.names.end()) && (node.sink != 0))
+    {
+      it = reg.names.find(node.sink);
+    }
+    return (it != reg.names.end()) ? (*it).second : string();
+  } /* node_name */
+
+
+  std::string node_type(const Node& node)
+  {
+    if (node.source != 0)
+    {
+      return type_name(typeid(*node.source));
+    }
+    return type_name(typeid(*node.sink));
+  } /* node_type */
+};
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,286 @@
+/**
+@file	 AsyncAudioProfiler.h
+@brief   Instrumentation of the audio pipeline
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-11-18
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2004-2017  Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef ASYNC_AUDIO_PROFILER_INCLUDED
+#define ASYNC_AUDIO_PROFILER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <string>
+#include <iosfwd>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+class AudioSource;
+class AudioSink;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Instrumentation of the audio pipeline
+@author Tobias Blomberg / SM0SVX
+@date   2017-11-18
+
+This class collect statistics for the audio sink and source objects that make
+up an audio pipeline. When enabled, every audio source and sink that is created
+is registered and every write from a source to a sink is timed. For each sink
+the number of writes, the number of samples, the total time spent in
+writeSamples, the time spent in the sink itself excluding the sinks further
+down the chain, the maximum write time and the flush latency are recorded. The
+number of samples buffered is recorded for FIFO objects.
+
+The graph topology, including the counters, can be written in Graphviz DOT or
+JSON format.
+
+The profiler should be enabled before the audio pipeline is created so that
+all objects are registered. Objects created while the profiler is disabled
+will only show up in the graph if connected to a registered object. When
+disabled, the only overhead is a check of a static flag in the audio source
+and sink base classes.
+
+\code
+Async::AudioProfiler::setEnabled(true);
+// Create the audio pipeline and let it run for a while
+std::ofstream dot("audio.dot");
+Async::AudioProfiler::writeDot(dot);
+\endcode
+*/
+class AudioProfiler
+{
+  public:
+    /**
+     * @brief   Enable or disable the profiler
+     * @param   enable Set to \em true to enable the profiler
+     */
+    static void setEnabled(bool enable);
+
+    /**
+     * @brief   Check if the profiler is enabled
+     * @return  Returns \em true if the profiler is enabled
+     */
+    static bool isEnabled(void) { return enabled; }
+
+    /**
+     * @brief   Check if the profiler has ever been enabled
+     * @return  Returns \em true if the profiler has been enabled at some time
+     *
+     * Objects must unregister from the profiler on destruction even if the
+     * profiler has been disabled after they were registered.
+     */
+    static bool hasBeenEnabled(void) { return used; }
+
+    /**
+     * @brief   Set a descriptive name for an audio source and/or sink
+     * @param   obj The audio source or sink object
+     * @param   name The name to show in the graph
+     */
+    template <typename T>
+    static void setName(T *obj, const std::string& name)
+    {
+      if (enabled)
+      {
+        setNodeName(asSource(obj), asSink(obj), name);
+      }
+    }
+
+    /**
+     * @brief   Tell the profiler that an object is a part of another object
+     * @param   internal The internal audio source or sink
+     * @param   owner The audio object that own the internal object
+     *
+     * Objects like splitters and selectors use internal branch objects to
+     * distribute the audio. Those branch objects are not connected to the
+     * owning object through a normal source/sink connection so this function
+     * is used to tell the profiler about the relation.
+     */
+    template <typename T, typename O>
+    static void setOwner(T *internal, O *owner)
+    {
+      if (enabled)
+      {
+        setNodeOwner(asSource(internal), asSink(internal),
+                     asSource(owner), asSink(owner));
+      }
+    }
+
+    /**
+     * @brief   Reset all counters
+     */
+    static void reset(void);
+
+    /**
+     * @brief   Write the audio graph in Graphviz DOT format
+     * @param   os The stream to write to
+     */
+    static void writeDot(std::ostream& os);
+
+    /**
+     * @brief   Write the audio graph in JSON format
+     * @param   os The stream to write to
+     */
+    static void writeJson(std::ostream& os);
+
+    /**
+     * @brief   Called by AudioSource when a new object is created
+     * @param   source The new audio source
+     */
+    static void addSource(AudioSource *source);
+
+    /**
+     * @brief   Called by AudioSource when an object is destroyed
+     * @param   source The audio source being destroyed
+     */
+    static void removeSource(AudioSource *source);
+
+    /**
+     * @brief   Called by AudioSink when a new object is created
+     * @param   sink The new audio sink
+     */
+    static void addSink(AudioSink *sink);
+
+    /**
+     * @brief   Called by AudioSink when an object is destroyed
+     * @param   sink The audio sink being destroyed
+     */
+    static void removeSink(AudioSink *sink);
+
+    /**
+     * @brief   Write samples to a sink and record statistics
+     * @param   sink The sink to write to
+     * @param   samples The samples to write
+     * @param   count The number of samples to write
+     * @return  Returns the value returned by the sink
+     */
+    static int writeSamples(AudioSink *sink, const float *samples, int count);
+
+    /**
+     * @brief   Called by AudioSource when a sink is told to flush
+     * @param   sink The sink that is flushing
+     */
+    static void flushStarted(AudioSink *sink);
+
+    /**
+     * @brief   Called by AudioSource when a sink is done flushing
+     * @param   sink The sink that has flushed all samples
+     */
+    static void flushDone(AudioSink *sink);
+
+  private:
+    static bool enabled;
+    static bool used;
+
+    static AudioSource *asSource(AudioSource *source) { return source; }
+    static AudioSource *asSource(...) { return 0; }
+    static AudioSink *asSink(AudioSink *sink) { return sink; }
+    static AudioSink *asSink(...) { return 0; }
+    static void setNodeName(AudioSource *source, AudioSink *sink,
+                            const std::string& name);
+    static void setNodeOwner(AudioSource *source, AudioSink *sink,
+                             AudioSource *owner_source,
+                             AudioSink *owner_sink);
+
+    AudioProfiler(void);
+    AudioProfiler(const AudioProfiler&);
+    AudioProfiler& operator=(const AudioProfiler&);
+
+};  /* class AudioProfiler */
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_PROFILER_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
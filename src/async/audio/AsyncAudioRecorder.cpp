@@ -56,6 +56,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include "AsyncAudioRecorder.h"
+#include "AsyncAudioSampleConv.h"
 
 
 
@@ -238,23 +239,8 @@ int AudioRecorder::writeSamples(const float *samples, int count)
     timersub(&end_timestamp, &block_time, &begin_timestamp);
   }
   
-  short buf[count];
-  for (int i=0; i<count; ++i)
-  {
-    float sample = samples[i];
-    if (sample > 1)
-    {
-      buf[i] = 32767;
-    }
-    else if (sample < -1)
-    {
-      buf[i] = -32767;
-    }
-    else
-    {
-      buf[i] = static_cast<short>(32767.0 * sample);
-    }
-  }
+  int16_t buf[count];
+  AudioSampleConv::floatToS16(buf, samples, count);
   
   int written = fwrite(buf, sizeof(*buf), count, file);
   if ((written != count) && ferror(file))
@@ -0,0 +1,728 @@
+/**
+@file	 AsyncAudioSampleConv.cpp
+@brief   Vectorized audio sample format conversion
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-11-27
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2004-2017  Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SAMPLE_CONV_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SAMPLE_CONV_NEON 1
+#include <arm_neon.h>
+#endif
+
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncAudioSampleConv.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+#define S16_SCALE         32767.0f
+#define S16_INV_SCALE     (1.0f / 32768.0f)
+#define S16_MAX           32767.0f
+#define U8_OFFSET         127.5f
+#define U8_INV_SCALE      (1.0f / 127.5f)
+
+#ifdef SAMPLE_CONV_X86
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+namespace {
+
+  /*
+   * Plain C++ implementation. The clipping is written in the same way as the
+   * min/max instructions of the SIMD implementations work so that all
+   * implementations give the same result.
+   */
+
+  inline float clip(float x, float lim)
+  {
+    x = (x > -lim) ? x : -lim;
+    return (x < lim) ? x : lim;
+  }
+
+  void scalarFloatToS16(int16_t *dest, const float *src, int count)
+  {
+    for (int i=0; i<count; ++i)
+    {
+      dest[i] = static_cast<int16_t>(clip(src[i], 1.0f) * S16_SCALE);
+    }
+  }
+
+  void scalarS16ToFloat(float *dest, const int16_t *src, int count)
+  {
+    for (int i=0; i<count; ++i)
+    {
+      dest[i] = src[i] * S16_INV_SCALE;
+    }
+  }
+
+  void scalarS16ToFloatDeinterleave(float *dest, const int16_t *src,
+                                    int frames, int channels, int channel)
+  {
+    src += channel;
+    for (int i=0; i<frames; ++i, src += channels)
+    {
+      dest[i] = *src * S16_INV_SCALE;
+    }
+  }
+
+  void scalarFloatMixToS16Interleave(int16_t *dest, const float *src,
+                                     int frames, int channels, int channel)
+  {
+    dest += channel;
+    for (int i=0; i<frames; ++i, dest += channels)
+    {
+      float sample = src[i] * S16_SCALE + *dest;
+      *dest = static_cast<int16_t>(clip(sample, S16_MAX));
+    }
+  }
+
+  bool scalarU8ToFloat(float *dest, const uint8_t *src, int count)
+  {
+    bool full_scale = false;
+    for (int i=0; i<count; ++i)
+    {
+      full_scale |= (src[i] == 255);
+      dest[i] = (src[i] - U8_OFFSET) * U8_INV_SCALE;
+    }
+    return full_scale;
+  }
+
+
+#ifdef SAMPLE_CONV_X86
+
+  /*
+   * SSE2 implementation
+   */
+
+  TARGET_SSE2 inline __m128i sse2FloatToS32(__m128 x, __m128 lim,
+                                            __m128 scale)
+  {
+    x = _mm_max_ps(x, _mm_sub_ps(_mm_setzero_ps(), lim));
+    x = _mm_min_ps(x, lim);
+    return _mm_cvttps_epi32(_mm_mul_ps(x, scale));
+  }
+
+  TARGET_SSE2 void sse2FloatToS16(int16_t *dest, const float *src, int count)
+  {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    int i = 0;
+    for (; i+8<=count; i+=8)
+    {
+      __m128i lo = sse2FloatToS32(_mm_loadu_ps(src + i), one, scale);
+      __m128i hi = sse2FloatToS32(_mm_loadu_ps(src + i + 4), one, scale);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i),
+                       _mm_packs_epi32(lo, hi));
+    }
+    scalarFloatToS16(dest + i, src + i, count - i);
+  }
+
+  TARGET_SSE2 void sse2S16ToFloat(float *dest, const int16_t *src, int count)
+  {
+    const __m128 scale = _mm_set1_ps(S16_INV_SCALE);
+    int i = 0;
+    for (; i+8<=count; i+=8)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+      _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+      _mm_storeu_ps(dest + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    scalarS16ToFloat(dest + i, src + i, count - i);
+  }
+
+  TARGET_SSE2 void sse2S16ToFloatDeinterleave(float *dest, const int16_t *src,
+                                              int frames, int channels,
+                                              int channel)
+  {
+    if (channels == 1)
+    {
+      sse2S16ToFloat(dest, src, frames);
+      return;
+    }
+    int i = 0;
+    if (channels == 2)
+    {
+        // Each 32 bit lane hold one stereo frame
+      const __m128 scale = _mm_set1_ps(S16_INV_SCALE);
+      for (; i+4<=frames; i+=4)
+      {
+        __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(src + 2 * i));
+        if (channel == 0)
+        {
+          v = _mm_slli_epi32(v, 16);
+        }
+        v = _mm_srai_epi32(v, 16);
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+      }
+    }
+    scalarS16ToFloatDeinterleave(dest + i, src + i * channels, frames - i,
+                                 channels, channel);
+  }
+
+  TARGET_SSE2 inline __m128i sse2Mix(__m128i old, __m128 x)
+  {
+    const __m128 lim = _mm_set1_ps(S16_MAX);
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    __m128 sample = _mm_add_ps(_mm_mul_ps(x, scale), _mm_cvtepi32_ps(old));
+    return sse2FloatToS32(sample, lim, _mm_set1_ps(1.0f));
+  }
+
+  TARGET_SSE2 void sse2FloatMixToS16Interleave(int16_t *dest, const float *src,
+                                               int frames, int channels,
+                                               int channel)
+  {
+    int i = 0;
+    if (channels == 1)
+    {
+      for (; i+8<=frames; i+=8)
+      {
+        __m128i *ptr = reinterpret_cast<__m128i *>(dest + i);
+        __m128i v = _mm_loadu_si128(ptr);
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        lo = sse2Mix(lo, _mm_loadu_ps(src + i));
+        hi = sse2Mix(hi, _mm_loadu_ps(src + i + 4));
+        _mm_storeu_si128(ptr, _mm_packs_epi32(lo, hi));
+      }
+    }
+    else if (channels == 2)
+    {
+        // Each 32 bit lane hold one stereo frame. The other channel is
+        // masked out and then merged back.
+      const __m128i lo_mask = _mm_set1_epi32(0xffff);
+      for (; i+4<=frames; i+=4)
+      {
+        __m128i *ptr = reinterpret_cast<__m128i *>(dest + 2 * i);
+        __m128i v = _mm_loadu_si128(ptr);
+        __m128 x = _mm_loadu_ps(src + i);
+        if (channel == 0)
+        {
+          __m128i s = sse2Mix(_mm_srai_epi32(_mm_slli_epi32(v, 16), 16), x);
+          v = _mm_or_si128(_mm_andnot_si128(lo_mask, v),
+                           _mm_and_si128(s, lo_mask));
+        }
+        else
+        {
+          __m128i s = sse2Mix(_mm_srai_epi32(v, 16), x);
+          v = _mm_or_si128(_mm_and_si128(v, lo_mask), _mm_slli_epi32(s, 16));
+        }
+        _mm_storeu_si128(ptr, v);
+      }
+    }
+    scalarFloatMixToS16Interleave(dest + i * channels, src + i, frames - i,
+                                  channels, channel);
+  }
+
+  TARGET_SSE2 inline void sse2U8x4ToFloat(float *dest, __m128i v)
+  {
+    const __m128 offset = _mm_set1_ps(U8_OFFSET);
+    const __m128 scale = _mm_set1_ps(U8_INV_SCALE);
+    _mm_storeu_ps(dest,
+        _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(v), offset), scale));
+  }
+
+  TARGET_SSE2 bool sse2U8ToFloat(float *dest, const uint8_t *src, int count)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(-1);
+    __m128i full_scale = zero;
+    int i = 0;
+    for (; i+16<=count; i+=16)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      full_scale = _mm_or_si128(full_scale, _mm_cmpeq_epi8(v, ones));
+      __m128i lo = _mm_unpacklo_epi8(v, zero);
+      __m128i hi = _mm_unpackhi_epi8(v, zero);
+      sse2U8x4ToFloat(dest + i, _mm_unpacklo_epi16(lo, zero));
+      sse2U8x4ToFloat(dest + i + 4, _mm_unpackhi_epi16(lo, zero));
+      sse2U8x4ToFloat(dest + i + 8, _mm_unpacklo_epi16(hi, zero));
+      sse2U8x4ToFloat(dest + i + 12, _mm_unpackhi_epi16(hi, zero));
+    }
+    bool tail_full_scale = scalarU8ToFloat(dest + i, src + i, count - i);
+    return tail_full_scale || (_mm_movemask_epi8(full_scale) != 0);
+  }
+
+
+
+  /*
+   * AVX2 implementation. The interleaving functions are not used often
+   * enough to justify their own AVX2 versions so the SSE2 versions are used.
+   */
+
+  TARGET_AVX2 inline __m256i avx2FloatToS32(__m256 x)
+  {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 minus_one = _mm256_set1_ps(-1.0f);
+    x = _mm256_min_ps(_mm256_max_ps(x, minus_one), one);
+    return _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(S16_SCALE)));
+  }
+
+  TARGET_AVX2 void avx2FloatToS16(int16_t *dest, const float *src, int count)
+  {
+    int i = 0;
+    for (; i+16<=count; i+=16)
+    {
+      __m256i lo = avx2FloatToS32(_mm256_loadu_ps(src + i));
+      __m256i hi = avx2FloatToS32(_mm256_loadu_ps(src + i + 8));
+        // The pack instruction work on each 128 bit half separately so the
+        // 64 bit blocks have to be put back in order afterwards
+      __m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xd8);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i), v);
+    }
+    sse2FloatToS16(dest + i, src + i, count - i);
+  }
+
+  TARGET_AVX2 void avx2S16ToFloat(float *dest, const int16_t *src, int count)
+  {
+    const __m256 scale = _mm256_set1_ps(S16_INV_SCALE);
+    int i = 0;
+    for (; i+8<=count; i+=8)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v));
+      _mm256_storeu_ps(dest + i, _mm256_mul_ps(x, scale));
+    }
+    scalarS16ToFloat(dest + i, src + i, count - i);
+  }
+
+  TARGET_AVX2 bool avx2U8ToFloat(float *dest, const uint8_t *src, int count)
+  {
+    const __m256 offset = _mm256_set1_ps(U8_OFFSET);
+    const __m256 scale = _mm256_set1_ps(U8_INV_SCALE);
+    const __m256i ones = _mm256_set1_epi8(-1);
+    __m256i full_scale = _mm256_setzero_si256();
+    int i = 0;
+    for (; i+32<=count; i+=32)
+    {
+      __m256i v = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(src + i));
+      full_scale = _mm256_or_si256(full_scale, _mm256_cmpeq_epi8(v, ones));
+      for (int j=0; j<32; j+=8)
+      {
+        __m128i b = _mm_loadl_epi64(
+            reinterpret_cast<const __m128i *>(src + i + j));
+        __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b));
+        _mm256_storeu_ps(dest + i + j,
+                         _mm256_mul_ps(_mm256_sub_ps(x, offset), scale));
+      }
+    }
+    bool tail_full_scale = sse2U8ToFloat(dest + i, src + i, count - i);
+    return tail_full_scale || (_mm256_movemask_epi8(full_scale) != 0);
+  }
+
+#endif /* SAMPLE_CONV_X86 */
+
+
+#ifdef SAMPLE_CONV_NEON
+
+  /*
+   * ARM NEON implementation
+   */
+
+  inline float32x4_t neonClip(float32x4_t x, float lim)
+  {
+    const float32x4_t pos = vdupq_n_f32(lim);
+    const float32x4_t neg = vdupq_n_f32(-lim);
+    x = vbslq_f32(vcgtq_f32(x, neg), x, neg);
+    return vbslq_f32(vcltq_f32(x, pos), x, pos);
+  }
+
+  inline int16x8_t neonFloatToS16x8(float32x4_t lo, float32x4_t hi)
+  {
+    const float32x4_t scale = vdupq_n_f32(S16_SCALE);
+    int32x4_t ilo = vcvtq_s32_f32(vmulq_f32(neonClip(lo, 1.0f), scale));
+    int32x4_t ihi = vcvtq_s32_f32(vmulq_f32(neonClip(hi, 1.0f), scale));
+    return vcombine_s16(vqmovn_s32(ilo), vqmovn_s32(ihi));
+  }
+
+  inline void neonS16x8ToFloat(float *dest, int16x8_t v)
+  {
+    const float32x4_t scale = vdupq_n_f32(S16_INV_SCALE);
+    vst1q_f32(dest,
+        vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+    vst1q_f32(dest + 4,
+        vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+  }
+
+  inline int16x8_t neonMix(int16x8_t old, const float *src)
+  {
+    const float32x4_t scale = vdupq_n_f32(S16_SCALE);
+    float32x4_t lo = vaddq_f32(vmulq_f32(vld1q_f32(src), scale),
+                               vcvtq_f32_s32(vmovl_s16(vget_low_s16(old))));
+    float32x4_t hi = vaddq_f32(vmulq_f32(vld1q_f32(src + 4), scale),
+                               vcvtq_f32_s32(vmovl_s16(vget_high_s16(old))));
+    return vcombine_s16(vqmovn_s32(vcvtq_s32_f32(neonClip(lo, S16_MAX))),
+                        vqmovn_s32(vcvtq_s32_f32(neonClip(hi, S16_MAX))));
+  }
+
+  void neonFloatToS16(int16_t *dest, const float *src, int count)
+  {
+    int i = 0;
+    for (; i+8<=count; i+=8)
+    {
+      vst1q_s16(dest + i,
+                neonFloatToS16x8(vld1q_f32(src + i), vld1q_f32(src + i + 4)));
+    }
+    scalarFloatToS16(dest + i, src + i, count - i);
+  }
+
+  void neonS16ToFloat(float *dest, const int16_t *src, int count)
+  {
+    int i = 0;
+    for (; i+8<=count; i+=8)
+    {
+      neonS16x8ToFloat(dest + i, vld1q_s16(src + i));
+    }
+    scalarS16ToFloat(dest + i, src + i, count - i);
+  }
+
+  void neonS16ToFloatDeinterleave(float *dest, const int16_t *src,
+                                  int frames, int channels, int channel)
+  {
+    if (channels == 1)
+    {
+      neonS16ToFloat(dest, src, frames);
+      return;
+    }
+    int i = 0;
+    if (channels == 2)
+    {
+      for (; i+8<=frames; i+=8)
+      {
+        int16x8x2_t v = vld2q_s16(src + 2 * i);
+        neonS16x8ToFloat(dest + i, v.val[channel]);
+      }
+    }
+    scalarS16ToFloatDeinterleave(dest + i, src + i * channels, frames - i,
+                                 channels, channel);
+  }
+
+  void neonFloatMixToS16Interleave(int16_t *dest, const float *src,
+                                   int frames, int channels, int channel)
+  {
+    int i = 0;
+    if (channels == 1)
+    {
+      for (; i+8<=frames; i+=8)
+      {
+        vst1q_s16(dest + i, neonMix(vld1q_s16(dest + i), src + i));
+      }
+    }
+    else if (channels == 2)
+    {
+      for (; i+8<=frames; i+=8)
+      {
+        int16x8x2_t v = vld2q_s16(dest + 2 * i);
+        v.val[channel] = neonMix(v.val[channel], src + i);
+        vst2q_s16(dest + 2 * i, v);
+      }
+    }
+    scalarFloatMixToS16Interleave(dest + i * channels, src + i, frames - i,
+                                  channels, channel);
+  }
+
+  inline void neonU16x4ToFloat(float *dest, uint16x4_t v)
+  {
+    const float32x4_t offset = vdupq_n_f32(U8_OFFSET);
+    const float32x4_t scale = vdupq_n_f32(U8_INV_SCALE);
+    float32x4_t x = vcvtq_f32_u32(vmovl_u16(v));
+    vst1q_f32(dest, vmulq_f32(vsubq_f32(x, offset), scale));
+  }
+
+  bool neonU8ToFloat(float *dest, const uint8_t *src, int count)
+  {
+    const uint8x16_t ones = vdupq_n_u8(255);
+    uint8x16_t full_scale = vdupq_n_u8(0);
+    int i = 0;
+    for (; i+16<=count; i+=16)
+    {
+      uint8x16_t v = vld1q_u8(src + i);
+      full_scale = vorrq_u8(full_scale, vceqq_u8(v, ones));
+      uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+      uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+      neonU16x4ToFloat(dest + i, vget_low_u16(lo));
+      neonU16x4ToFloat(dest + i + 4, vget_high_u16(lo));
+      neonU16x4ToFloat(dest + i + 8, vget_low_u16(hi));
+      neonU16x4ToFloat(dest + i + 12, vget_high_u16(hi));
+    }
+    uint8x8_t fs = vorr_u8(vget_low_u8(full_scale), vget_high_u8(full_scale));
+    bool tail_full_scale = scalarU8ToFloat(dest + i, src + i, count - i);
+    return tail_full_scale ||
+           (vget_lane_u64(vreinterpret_u64_u8(fs), 0) != 0);
+  }
+
+#endif /* SAMPLE_CONV_NEON */
+
+} /* anonymous namespace */
+
+
+const AudioSampleConv::Ops *AudioSampleConv::current_ops = 0;
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+bool AudioSampleConv::setImpl(Impl impl)
+{
+  if (impl == IMPL_AUTO)
+  {
+    if (implSupported(IMPL_AVX2))
+    {
+      impl = IMPL_AVX2;
+    }
+    else if (implSupported(IMPL_SSE2))
+    {
+      impl = IMPL_SSE2;
+    }
+    else if (implSupported(IMPL_NEON))
+    {
+      impl = IMPL_NEON;
+    }
+    else
+    {
+      impl = IMPL_SCALAR;
+    }
+  }
+
+  if (!implSupported(impl))
+  {
+    return false;
+  }
+
+  static const Ops scalar_ops =
+  {
+    IMPL_SCALAR,
+    scalarFloatToS16,
+    scalarS16ToFloat,
+    scalarS16ToFloatDeinterleave,
+    scalarFloatMixToS16Interleave,
+    scalarU8ToFloat
+  };
+#ifdef SAMPLE_CONV_X86
+  static const Ops sse2_ops =
+  {
+    IMPL_SSE2,
+    sse2FloatToS16,
+    sse2S16ToFloat,
+    sse2S16ToFloatDeinterleave,
+    sse2FloatMixToS16Interleave,
+    sse2U8ToFloat
+  };
+  static const Ops avx2_ops =
+  {
+    IMPL_AVX2,
+    avx2FloatToS16,
+    avx2S16ToFloat,
+    sse2S16ToFloatDeinterleave,
+    sse2FloatMixToS16Interleave,
+    avx2U8ToFloat
+  };
+#endif
+#ifdef SAMPLE_CONV_NEON
+  static const Ops neon_ops =
+  {
+    IMPL_NEON,
+    neonFloatToS16,
+    neonS16ToFloat,
+    neonS16ToFloatDeinterleave,
+    neonFloatMixToS16Interleave,
+    neonU8ToFloat
+  };
+#endif
+
+  switch (impl)
+  {
+#ifdef SAMPLE_CONV_X86
+    case IMPL_SSE2:
+      current_ops = &sse2_ops;
+      break;
+    case IMPL_AVX2:
+      current_ops = &avx2_ops;
+      break;
+#endif
+#ifdef SAMPLE_CONV_NEON
+    case IMPL_NEON:
+      current_ops = &neon_ops;
+      break;
+#endif
+    default:
+      current_ops = &scalar_ops;
+      break;
+  }
+
+  return true;
+
+} /* AudioSampleConv::setImpl */
+
+
+bool AudioSampleConv::implSupported(Impl impl)
+{
+  switch (impl)
+  {
+    case IMPL_AUTO:
+    case IMPL_SCALAR:
+      return true;
+#ifdef SAMPLE_CONV_X86
+    case IMPL_SSE2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse2");
+    case IMPL_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+#ifdef SAMPLE_CONV_NEON
+    case IMPL_NEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+} /* AudioSampleConv::implSupported */
+
+
+const char *AudioSampleConv::implName(Impl impl)
+{
+  if (impl == IMPL_AUTO)
+  {
+    impl = ops().impl;
+  }
+  switch (impl)
+  {
+    case IMPL_SCALAR:
+      return "scalar";
+    case IMPL_SSE2:
+      return "SSE2";
+    case IMPL_AVX2:
+      return "AVX2";
+    case IMPL_NEON:
+      return "NEON";
+    default:
+      return "auto";
+  }
+} /* AudioSampleConv::implName */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+
+
+/*
+ * This file has not been truncated
+ */
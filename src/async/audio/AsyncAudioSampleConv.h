@@ -0,0 +1,287 @@
+/**
+@file	 AsyncAudioSampleConv.h
+@brief   Vectorized audio sample format conversion
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-11-27
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2004-2017  Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef ASYNC_AUDIO_SAMPLE_CONV_INCLUDED
+#define ASYNC_AUDIO_SAMPLE_CONV_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Vectorized audio sample format conversion
+@author Tobias Blomberg / SM0SVX
+@date   2017-11-27
+
+This class contain the conversion functions used to move audio between the
+internal floating point format and the 16 bit integer format used by sound
+cards, audio files and codecs, and the 8 bit unsigned format used by
+RTL2832U based SDR dongles.
+
+Each function is available in a plain C++ version and in versions using the
+SIMD instructions of the CPU. On x86 there are SSE2 and AVX2 versions and on
+ARM there is a NEON version. The best implementation is selected at runtime,
+the first time one of the functions is called, depending on what the CPU
+support. All implementations produce the same result.
+
+The conversions are done in single precision. Code that did the conversion in
+double precision, like the earlier conversion loops in SvxLink, may get a
+result that differ by one LSB for a few samples when converting to 16 bit
+integers since the product is rounded to float before it is truncated. The
+8 bit conversion may differ in the last bit of the float mantissa since the
+division by 127.5 is done as a multiplication by its inverse.
+
+Floating point samples are in the range -1.0 to 1.0. When converting to 16
+bit integers, samples outside of that range are clipped and the samples are
+scaled by 32767 and truncated toward zero. When converting from 16 bit
+integers, samples are scaled by 1/32768.
+
+\include AsyncAudioSampleConv_demo.cpp
+*/
+class AudioSampleConv
+{
+  public:
+    /**
+     * @brief The available implementations
+     */
+    typedef enum
+    {
+      IMPL_AUTO,    ///< Select the best implementation for the CPU
+      IMPL_SCALAR,  ///< Plain C++
+      IMPL_SSE2,    ///< x86 SSE2
+      IMPL_AVX2,    ///< x86 AVX2
+      IMPL_NEON     ///< ARM NEON
+    } Impl;
+
+    /**
+     * @brief   Select which implementation to use
+     * @param   impl The implementation to use
+     * @return  Returns \em false if the implementation is not supported
+     *
+     * This function is normally not needed since the best implementation is
+     * selected automatically. It is mostly useful for benchmarking.
+     */
+    static bool setImpl(Impl impl);
+
+    /**
+     * @brief   Check if an implementation is supported by this CPU
+     * @param   impl The implementation to check
+     * @return  Returns \em true if the implementation can be used
+     */
+    static bool implSupported(Impl impl);
+
+    /**
+     * @brief   Get the name of an implementation
+     * @param   impl The implementation, IMPL_AUTO for the one in use
+     * @return  Returns the name of the implementation
+     */
+    static const char *implName(Impl impl=IMPL_AUTO);
+
+    /**
+     * @brief   Convert floating point samples to 16 bit integers
+     * @param   dest The destination buffer
+     * @param   src The source buffer
+     * @param   count The number of samples to convert
+     */
+    static void floatToS16(int16_t *dest, const float *src, int count)
+    {
+      ops().float_to_s16(dest, src, count);
+    }
+
+    /**
+     * @brief   Convert 16 bit integer samples to floating point
+     * @param   dest The destination buffer
+     * @param   src The source buffer
+     * @param   count The number of samples to convert
+     */
+    static void s16ToFloat(float *dest, const int16_t *src, int count)
+    {
+      ops().s16_to_float(dest, src, count);
+    }
+
+    /**
+     * @brief   Extract one channel from interleaved 16 bit samples
+     * @param   dest The destination buffer, \em frames samples long
+     * @param   src The interleaved source buffer
+     * @param   frames The number of frames to convert
+     * @param   channels The number of interleaved channels in \em src
+     * @param   channel The channel to extract
+     */
+    static void s16ToFloatDeinterleave(float *dest, const int16_t *src,
+                                       int frames, int channels, int channel)
+    {
+      ops().s16_to_float_deinterleave(dest, src, frames, channels, channel);
+    }
+
+    /**
+     * @brief   Mix floating point samples into interleaved 16 bit samples
+     * @param   dest The interleaved destination buffer
+     * @param   src The source buffer, \em frames samples long
+     * @param   frames The number of frames to convert
+     * @param   channels The number of interleaved channels in \em dest
+     * @param   channel The channel to mix the samples into
+     *
+     * The scaled samples are added to the samples already in the destination
+     * channel and the sum is clipped to the range -32767 to 32767.
+     */
+    static void floatMixToS16Interleave(int16_t *dest, const float *src,
+                                        int frames, int channels,
+                                        int channel)
+    {
+      ops().float_mix_to_s16_interleave(dest, src, frames, channels, channel);
+    }
+
+    /**
+     * @brief   Convert unsigned 8 bit samples to floating point
+     * @param   dest The destination buffer
+     * @param   src The source buffer
+     * @param   count The number of samples to convert
+     * @return  Returns \em true if any source sample was at full scale (255)
+     *
+     * The samples are converted using the formula x / 127.5 - 1. This is the
+     * format of the I/Q samples delivered by RTL2832U based dongles. The
+     * real and imaginary parts are converted in the same way so an
+     * interleaved I/Q buffer can be converted directly into a buffer of
+     * complex floats.
+     */
+    static bool u8ToFloat(float *dest, const uint8_t *src, int count)
+    {
+      return ops().u8_to_float(dest, src, count);
+    }
+
+  protected:
+
+  private:
+    struct Ops
+    {
+      Impl impl;
+      void (*float_to_s16)(int16_t *dest, const float *src, int count);
+      void (*s16_to_float)(float *dest, const int16_t *src, int count);
+      void (*s16_to_float_deinterleave)(float *dest, const int16_t *src,
+                                        int frames, int channels,
+                                        int channel);
+      void (*float_mix_to_s16_interleave)(int16_t *dest, const float *src,
+                                          int frames, int channels,
+                                          int channel);
+      bool (*u8_to_float)(float *dest, const uint8_t *src, int count);
+    };
+
+    static const Ops *current_ops;
+
+    static const Ops& ops(void)
+    {
+      if (current_ops == 0)
+      {
+        setImpl(IMPL_AUTO);
+      }
+      return *current_ops;
+    }
+
+    AudioSampleConv(void);
+
+};  /* class AudioSampleConv */
+
+
+} /* namespace */
+
+#endif /* ASYNC_AUDIO_SAMPLE_CONV_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
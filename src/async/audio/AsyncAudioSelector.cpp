@@ -268,6 +268,7 @@ void AudioSelector::addSource(Async::AudioSource *source)
   assert(source != 0);
   assert(m_branch_map.find(source) == m_branch_map.end());
   Branch *branch = new Branch(this);
+  AudioProfiler::setOwner(branch, this);
   source->registerSink(branch);
   m_branch_map[source] = branch;
 } /* AudioSelector::addSource */
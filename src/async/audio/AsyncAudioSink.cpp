@@ -113,6 +113,10 @@ using namespace Async;
 
 AudioSink::~AudioSink(void)
 {
+  if (AudioProfiler::hasBeenEnabled())
+  {
+    AudioProfiler::removeSink(this);
+  }
   unregisterSource();
   clearHandler();
 } /* AudioSink::~AudioSink */
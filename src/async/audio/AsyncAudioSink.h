@@ -53,6 +53,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include "AsyncAudioProfiler.h"
 
 
 /****************************************************************************
@@ -118,7 +119,13 @@ class AudioSink
     /**
      * @brief 	Default constuctor
      */
-    AudioSink(void) : m_source(0), m_handler(0), m_auto_unreg_sink(false) {}
+    AudioSink(void) : m_source(0), m_handler(0), m_auto_unreg_sink(false)
+    {
+      if (AudioProfiler::isEnabled())
+      {
+        AudioProfiler::addSink(this);
+      }
+    }
   
     /**
      * @brief 	Destructor
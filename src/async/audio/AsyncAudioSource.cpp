@@ -113,6 +113,11 @@ using namespace Async;
 
 AudioSource::~AudioSource(void)
 {
+  if (AudioProfiler::hasBeenEnabled())
+  {
+    AudioProfiler::removeSource(this);
+  }
+
   if (m_sink_managed)
   {
     AudioSink *sink = m_sink;
@@ -171,7 +176,14 @@ int AudioSource::sinkWriteSamples(const float *samples, int len)
   
   if (m_sink != 0)
   {
-    len = m_sink->writeSamples(samples, len);
+    if (AudioProfiler::isEnabled())
+    {
+      len = AudioProfiler::writeSamples(m_sink, samples, len);
+    }
+    else
+    {
+      len = m_sink->writeSamples(samples, len);
+    }
   }
   
   return len;
@@ -184,6 +196,10 @@ void AudioSource::sinkFlushSamples(void)
   if (m_sink != 0)
   {
     is_flushing = true;
+    if (AudioProfiler::isEnabled())
+    {
+      AudioProfiler::flushStarted(m_sink);
+    }
     m_sink->flushSamples();
   }
   else
@@ -52,6 +52,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include "AsyncAudioProfiler.h"
 
 
 /****************************************************************************
@@ -121,6 +122,10 @@ class AudioSource
       : m_sink(0), m_sink_managed(false), m_handler(0),
         m_auto_unreg_source(false), is_flushing(false)
     {
+      if (AudioProfiler::isEnabled())
+      {
+        AudioProfiler::addSource(this);
+      }
     }
   
     /**
@@ -174,6 +179,10 @@ class AudioSource
      */
     void handleAllSamplesFlushed(void)
     {
+      if (AudioProfiler::isEnabled())
+      {
+        AudioProfiler::flushDone(m_sink);
+      }
       is_flushing = false;
       allSamplesFlushed();
     }
@@ -231,6 +231,7 @@ AudioSplitter::AudioSplitter(void)
     flushed_branches(0), main_branch(0)
 {
   main_branch = new Branch(this);
+  AudioProfiler::setOwner(main_branch, this);
   branches.push_back(main_branch);
   AudioSource::setHandler(main_branch);
 } /* AudioSplitter::AudioSplitter */
@@ -250,6 +251,7 @@ AudioSplitter::~AudioSplitter(void)
 void AudioSplitter::addSink(AudioSink *sink, bool managed)
 {
   Branch *branch = new Branch(this);
+  AudioProfiler::setOwner(branch, this);
   branch->registerSink(sink, managed);
   branches.push_back(branch);
   if (do_flush)
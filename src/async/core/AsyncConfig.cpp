@@ -45,6 +45,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iostream>
 #include <cassert>
 #include <cstring>
+#include <utility>
 
 
 /****************************************************************************
@@ -152,19 +153,13 @@ bool Config::open(const string& name)
 bool Config::getValue(const string& section, const string& tag,
 		      string& value) const
 {
-  Sections::const_iterator sec_it = sections.find(section);
-  if (sec_it == sections.end())
-  {
-    return false;
-  }
-
-  Values::const_iterator val_it = sec_it->second.find(tag);
-  if (val_it == sec_it->second.end())
+  const Entry *val = findValue(section, tag);
+  if (val == 0)
   {
     return false;
   }
 
-  value = val_it->second;
+  value = val->value;
   return true;
 } /* Config::getValue */
 
@@ -173,19 +168,13 @@ const string &Config::getValue(const string& section, const string& tag) const
 {
   static const string empty_strng;
   
-  Sections::const_iterator sec_it = sections.find(section);
-  if (sec_it == sections.end())
-  {
-    return empty_strng;
-  }
-
-  Values::const_iterator val_it = sec_it->second.find(tag);
-  if (val_it == sec_it->second.end())
+  const Entry *val = findValue(section, tag);
+  if (val == 0)
   {
     return empty_strng;
   }
 
-  return val_it->second;
+  return val->value;
   
 } /* Config::getValue */
 
@@ -211,14 +200,55 @@ list<string> Config::listSection(const string& section)
 } /* Config::listSection */
 
 
+list<string> Config::listSections(void) const
+{
+  list<string> section_list;
+  for (Sections::const_iterator it=sections.begin(); it!=sections.end(); ++it)
+  {
+    section_list.push_back(it->first);
+  }
+  return section_list;
+} /* Config::listSections */
+
+
 void Config::setValue(const std::string& section, const std::string& tag,
       	      	      const std::string& value)
 {
   Values &values = sections[section];
-  values[tag] = value;
+  Entry &val = values[tag];
+  if (val.value == value)
+  {
+    return;
+  }
+  val.value = value;
+  val.clearCache();
+  notifyValueUpdated(section, tag, val);
 } /* Config::setValue */
 
 
+bool Config::removeValue(const std::string& section, const std::string& tag)
+{
+  Sections::iterator sec_it = sections.find(section);
+  if (sec_it == sections.end())
+  {
+    return false;
+  }
+
+  Values &values = sec_it->second;
+  if (values.erase(tag) == 0)
+  {
+    return false;
+  }
+  if (values.empty())
+  {
+    sections.erase(sec_it);
+  }
+  valueUpdated(section, tag);
+
+  return true;
+} /* Config::removeValue */
+
+
 
 /****************************************************************************
  *
@@ -251,6 +281,61 @@ void Config::setValue(const std::string& section, const std::string& tag,
  *
  ****************************************************************************/
 
+void Config::Entry::clearCache(void)
+{
+  for (ConvCache::iterator it = conv_cache.begin(); it != conv_cache.end();
+       ++it)
+  {
+    delete it->second;
+  }
+  conv_cache.clear();
+  inline_type = 0;
+  inline_valid = false;
+  read_cnt = 0;
+} /* Config::Entry::clearCache */
+
+
+void Config::notifyValueUpdated(const std::string& section,
+                                const std::string& tag, Entry& val)
+{
+    // Copy the subscriber list since a subscriber may add new subscriptions
+  ValueSubscribers subscribers(val.subscribers);
+  for (ValueSubscribers::iterator it = subscribers.begin();
+       it != subscribers.end(); ++it)
+  {
+    (*it)(val);
+  }
+  valueUpdated(section, tag);
+} /* Config::notifyValueUpdated */
+
+
+
+const Config::Entry *Config::findValue(const string& section,
+                                       const string& tag) const
+{
+  Sections::const_iterator sec_it = sections.find(section);
+  if (sec_it == sections.end())
+  {
+    return 0;
+  }
+
+  Values::const_iterator val_it = sec_it->second.find(tag);
+  if (val_it == sec_it->second.end())
+  {
+    return 0;
+  }
+
+  return &val_it->second;
+} /* Config::findValue */
+
+
+Config::Entry *Config::findValue(const string& section, const string& tag)
+{
+  const Config *cthis = this;
+  return const_cast<Entry*>(cthis->findValue(section, tag));
+} /* Config::findValue */
+
+
 
 /*
  *----------------------------------------------------------------------------
@@ -270,6 +355,12 @@ bool Config::parseCfgFile(void)
   int line_no = 0;
   string current_sec;
   string current_tag;
+
+    // The old value of each variable changed by this file. Subscribers are
+    // notified when the whole file has been read so that they never see a
+    // value that is only partially read from a multi line value.
+  typedef map<pair<string, string>, string> OldValues;
+  OldValues old_values;
   
   while (fgets(line, sizeof(line), file) != 0)
   {
@@ -325,8 +416,11 @@ bool Config::parseCfgFile(void)
 	assert(!current_sec.empty());
 	
 	Values &values = sections[current_sec];
-	string& value = values[current_tag];
-	value += val;
+	Entry& value = values[current_tag];
+	old_values.insert(make_pair(make_pair(current_sec, current_tag),
+                                    value.value));
+	value.value += val;
+	value.clearCache();
 	break;
       }
       
@@ -349,11 +443,27 @@ bool Config::parseCfgFile(void)
 	}
 	Values &values = sections[current_sec];
 	current_tag = tag;
-	values[current_tag] = value;
+	Entry &v = values[current_tag];
+	old_values.insert(make_pair(make_pair(current_sec, current_tag),
+                                    v.value));
+	v.value = value;
+	v.clearCache();
       	break;
       }
     }
   }
+
+  for (OldValues::const_iterator it = old_values.begin();
+       it != old_values.end(); ++it)
+  {
+    const string& section = it->first.first;
+    const string& tag = it->first.second;
+    Entry *val = findValue(section, tag);
+    if ((val != 0) && (val->value != it->second))
+    {
+      notifyValueUpdated(section, tag, *val);
+    }
+  }
   
   return true;
   
@@ -46,12 +46,15 @@ An example of how to use the Config class
  ****************************************************************************/
 
 #include <stdio.h>
+#include <sigc++/sigc++.h>
 
 #include <string>
 #include <map>
 #include <list>
 #include <memory>
 #include <sstream>
+#include <typeinfo>
+#include <cstring>
 
 
 /****************************************************************************
@@ -130,10 +133,34 @@ is shown below.
 \include test.cfg
 
 \include AsyncConfig_demo.cpp
+
+Typed values read using the template getValue functions are converted from
+their string representation on the stack the first time they are read. When
+a variable is read again, the converted value is cached and reused on
+subsequent reads of the same variable as the same type, until the value is
+changed using setValue or by reading another configuration file. This make
+it cheap to read the same value many times, e.g. when a large number of
+receivers are initialized from the same configuration section, without
+slowing down variables that are only read once.
+
+It is also possible to subscribe to a configuration variable using the
+subscribeValue function. The given function will then be called each time
+the variable is changed using setValue or by reading another configuration
+file. This can be used to implement configuration variables that can be
+changed at runtime without polling.
 */
 class Config
 {
   public:
+    /**
+     * @brief   The type of a function subscribing to a configuration variable
+     */
+    template <typename Rsp>
+    struct Subscriber
+    {
+      typedef sigc::slot<void, const Rsp&> Type;
+    };
+
     /**
      * @brief 	Default constuctor
      */
@@ -209,24 +236,12 @@ class Config
     bool getValue(const std::string& section, const std::string& tag,
 		  Rsp &rsp, bool missing_ok = false) const
     {
-      std::string str_val;
-      if (!getValue(section, tag, str_val))
+      const Entry *entry = findValue(section, tag);
+      if (entry == 0)
       {
 	return missing_ok;
       }
-      std::stringstream ssval(str_val);
-      Rsp tmp;
-      ssval >> tmp;
-      if(!ssval.eof())
-      {
-        ssval >> std::ws;
-      }
-      if (ssval.fail() || !ssval.eof())
-      {
-	return false;
-      }
-      rsp = tmp;
-      return true;
+      return entry->convert(rsp);
     } /* Config::getValue */
 
     /**
@@ -255,17 +270,17 @@ class Config
 		  Container<Value, std::allocator<Value> > &c,
                   bool missing_ok = false) const
     {
-      std::string str_val;
-      if (!getValue(section, tag, str_val))
+      const Entry *entry = findValue(section, tag);
+      if (entry == 0)
       {
 	return missing_ok;
       }
-      if (str_val.empty())
+      if (entry->value.empty())
       {
         c.clear();
         return true;
       }
-      std::stringstream ssval(str_val);
+      std::stringstream ssval(entry->value);
       while (!ssval.eof())
       {
         Value tmp;
@@ -309,19 +324,13 @@ class Config
 		  const Rsp& min, const Rsp& max, Rsp &rsp,
 		  bool missing_ok = false) const
     {
-      std::string str_val;
-      if (!getValue(section, tag, str_val))
+      const Entry *entry = findValue(section, tag);
+      if (entry == 0)
       {
 	return missing_ok;
       }
-      std::stringstream ssval(str_val);
       Rsp tmp;
-      ssval >> tmp;
-      if(!ssval.eof())
-      {
-        ssval >> std::ws;
-      }
-      if (ssval.fail() || !ssval.eof() || (tmp < min) || (tmp > max))
+      if (!entry->convert(tmp) || (tmp < min) || (tmp > max))
       {
 	return false;
       }
@@ -337,6 +346,12 @@ class Config
      */
     std::list<std::string> listSection(const std::string& section);
 
+    /**
+     * @brief 	Return the name of all configuration sections
+     * @return	Returns a list of all existing section names
+     */
+    std::list<std::string> listSections(void) const;
+
     /**
      * @brief   Set the value of a configuration variable
      * @param 	section   The name of the section where the configuration
@@ -352,15 +367,249 @@ class Config
      */
     void setValue(const std::string& section, const std::string& tag,
       	      	  const std::string& value);
-    
+
+    /**
+     * @brief   Set the value of a configuration variable
+     * @param 	section   The name of the section where the configuration
+     *	      	      	  variable is located
+     * @param 	tag   	  The name of the configuration variable to set.
+     * @param   value     The value to set
+     *
+     * This is a convenience function for setting a value of any type that
+     * support the operator<< function.
+     */
+    template <typename Rsp>
+    void setValue(const std::string& section, const std::string& tag,
+                  const Rsp& value)
+    {
+      std::ostringstream ss;
+      ss << value;
+      setValue(section, tag, ss.str());
+    } /* Config::setValue */
+
+    /**
+     * @brief   Remove a configuration variable
+     * @param 	section   The name of the section where the configuration
+     *	      	      	  variable is located
+     * @param 	tag   	  The name of the configuration variable to remove
+     * @return  Returns \em true if the variable existed or else \em false
+     *
+     * This function is used to remove a configuration variable from memory.
+     * Subscribers of the removed variable will not be notified anymore. The
+     * section itself is removed when the last variable in it is removed.
+     * The valueUpdated signal is emitted if the variable existed.
+     */
+    bool removeValue(const std::string& section, const std::string& tag);
+
+    /**
+     * @brief   Subscribe to changes of a configuration variable
+     * @param 	section   The name of the section where the configuration
+     *	      	      	  variable is located
+     * @param 	tag   	  The name of the configuration variable
+     * @param   def       Default value used if the variable is not set
+     * @param   func      The function to call when the value change
+     * @return  Returns \em true if the current value could be converted to
+     *          the requested type or else \em false
+     *
+     * This function is used to get notified when a configuration variable
+     * is changed using the setValue function. If the configuration variable
+     * does not exist it is created using the given default value. The
+     * given function is called directly with the current value and then
+     * each time the value change. Values that cannot be converted to the
+     * requested type are ignored.
+     */
+    template <typename Rsp>
+    bool subscribeValue(const std::string& section, const std::string& tag,
+                        const Rsp& def, typename Subscriber<Rsp>::Type func)
+    {
+      Entry *entry = findValue(section, tag);
+      if (entry == 0)
+      {
+        setValue(section, tag, def);
+        entry = findValue(section, tag);
+      }
+      entry->subscribers.push_back(
+          sigc::bind(sigc::ptr_fun(&Config::callSubscriber<Rsp>), func));
+      return callSubscriber<Rsp>(*entry, func);
+    } /* Config::subscribeValue */
+
+    /**
+     * @brief   A signal that is emitted when a config value is changed
+     * @param   section The name of the section for the changed variable
+     * @param   tag     The name of the changed configuration variable
+     *
+     * This signal is emitted each time a configuration variable is changed
+     * using the setValue function or by reading another configuration file.
+     */
+    sigc::signal<void, const std::string&, const std::string&> valueUpdated;
+
   private:
-    typedef std::map<std::string, std::string>	Values;
+    struct ConvertedValueBase
+    {
+      virtual ~ConvertedValueBase(void) {}
+    };
+
+    template <typename Rsp>
+    struct ConvertedValue : public ConvertedValueBase
+    {
+      Rsp   value;
+      bool  valid;
+
+      explicit ConvertedValue(const std::string& str) : value(), valid(false)
+      {
+        std::stringstream ssval(str);
+        Rsp tmp;
+        ssval >> tmp;
+        if(!ssval.eof())
+        {
+          ssval >> std::ws;
+        }
+        if (!ssval.fail() && ssval.eof())
+        {
+          value = tmp;
+          valid = true;
+        }
+      }
+
+      bool get(Rsp &rsp) const
+      {
+        if (valid)
+        {
+          rsp = value;
+        }
+        return valid;
+      }
+    };
+
+      // Types that can be stored inline in an Entry. Specialized below.
+      // The size is zero for other types so that the inline copy compile
+      // to nothing for them.
+    template <typename T> struct IsScalar { enum { value = 0, size = 0 }; };
+
+    struct TypeInfoLess
+    {
+      bool operator()(const std::type_info *a, const std::type_info *b) const
+      {
+        return a->before(*b);
+      }
+    };
+
+    class Entry;
+    typedef sigc::slot<bool, const Entry&>              ValueSubscriber;
+    typedef std::list<ValueSubscriber>                  ValueSubscribers;
+
+    class Entry
+    {
+      public:
+        std::string       value;
+        ValueSubscribers  subscribers;
+
+        Entry(void) : inline_type(0), inline_valid(false), read_cnt(0) {}
+        Entry(const Entry& other)
+          : value(other.value), subscribers(other.subscribers),
+            inline_type(0), inline_valid(false), read_cnt(0)
+        {
+        }
+        ~Entry(void) { clearCache(); }
+
+        Entry& operator=(const Entry& other)
+        {
+          if (&other != this)
+          {
+            clearCache();
+            value = other.value;
+            subscribers = other.subscribers;
+          }
+          return *this;
+        }
+
+        template <typename Rsp>
+        bool convert(Rsp &rsp) const
+        {
+            // The first scalar type read is stored inline in the entry
+          if (IsScalar<Rsp>::value)
+          {
+            if (inline_type == 0)
+            {
+              ConvertedValue<Rsp> conv(value);
+              inline_type = &typeid(Rsp);
+              inline_valid = conv.valid;
+              std::memcpy(&inline_value, &conv.value, IsScalar<Rsp>::size);
+              return conv.get(rsp);
+            }
+            if (*inline_type == typeid(Rsp))
+            {
+              if (inline_valid)
+              {
+                std::memcpy(static_cast<void*>(&rsp), &inline_value,
+                            IsScalar<Rsp>::size);
+              }
+              return inline_valid;
+            }
+          }
+
+          ConvCache::const_iterator it = conv_cache.find(&typeid(Rsp));
+          if (it == conv_cache.end())
+          {
+              // A value that is only read once is converted on the stack.
+              // The cache entry is allocated when the value is read again.
+            if (read_cnt++ == 0)
+            {
+              ConvertedValue<Rsp> conv(value);
+              return conv.get(rsp);
+            }
+            it = conv_cache.insert(std::make_pair(&typeid(Rsp),
+                  new ConvertedValue<Rsp>(value))).first;
+          }
+          const ConvertedValue<Rsp> *conv =
+            static_cast<const ConvertedValue<Rsp>*>(it->second);
+          return conv->get(rsp);
+        }
+
+        void clearCache(void);
+
+      private:
+        typedef std::map<const std::type_info*, ConvertedValueBase*,
+                         TypeInfoLess> ConvCache;
+        union InlineValue
+        {
+          long long           ll;
+          unsigned long long  ull;
+          double              d;
+        };
+
+        mutable const std::type_info  *inline_type;
+        mutable InlineValue           inline_value;
+        mutable bool                  inline_valid;
+        mutable ConvCache             conv_cache;
+        mutable unsigned              read_cnt;
+    };
+
+    typedef std::map<std::string, Entry>	Values;
     typedef std::map<std::string, Values>   	Sections;
     
     FILE      *file;
     Sections  sections;
     
+    template <typename Rsp>
+    static bool callSubscriber(const Entry& entry,
+                               typename Subscriber<Rsp>::Type func)
+    {
+      Rsp value;
+      if (!entry.convert(value))
+      {
+        return false;
+      }
+      func(value);
+      return true;
+    } /* Config::callSubscriber */
+
+    const Entry *findValue(const std::string& section,
+                           const std::string& tag) const;
+    Entry *findValue(const std::string& section, const std::string& tag);
     bool parseCfgFile(void);
+    void notifyValueUpdated(const std::string& section,
+                            const std::string& tag, Entry& val);
     char *trimSpaces(char *line);
     char *parseSection(char *line);
     char *parseDelimitedString(char *str, char begin_tok, char end_tok);
@@ -371,6 +620,28 @@ class Config
 };  /* class Config */
 
 
+#define ASYNC_CONFIG_SCALAR(T) \
+  template <> struct Config::IsScalar<T> \
+  { \
+    enum { value = 1, size = sizeof(T) }; \
+  }
+ASYNC_CONFIG_SCALAR(bool);
+ASYNC_CONFIG_SCALAR(char);
+ASYNC_CONFIG_SCALAR(signed char);
+ASYNC_CONFIG_SCALAR(unsigned char);
+ASYNC_CONFIG_SCALAR(short);
+ASYNC_CONFIG_SCALAR(unsigned short);
+ASYNC_CONFIG_SCALAR(int);
+ASYNC_CONFIG_SCALAR(unsigned int);
+ASYNC_CONFIG_SCALAR(long);
+ASYNC_CONFIG_SCALAR(unsigned long);
+ASYNC_CONFIG_SCALAR(long long);
+ASYNC_CONFIG_SCALAR(unsigned long long);
+ASYNC_CONFIG_SCALAR(float);
+ASYNC_CONFIG_SCALAR(double);
+#undef ASYNC_CONFIG_SCALAR
+
+
 } /* namespace */
 
 #endif /* ASYNC_CONFIG_INCLUDED */
@@ -0,0 +1,844 @@
+/**
+@file	 AsyncLog.cpp
+@brief   Asynchronous logging with levels and rate limiting
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-10
+
+This file contains a logging subsystem where log messages are handed over to
+a writer thread through a lock free queue. The writer thread also take care of
+writing everything printed on stdout/stderr to the logfile, when one is used.
+Each subsystem can have its own log level and messages on hot paths can be
+rate limited.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <pthread.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <iostream>
+#include <iomanip>
+#include <map>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncLog.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+namespace {
+
+/**
+ * @brief  One queued log message
+ */
+struct LogEntry
+{
+  static const size_t MAX_TEXT = 480;
+
+  typedef enum
+  {
+    TYPE_MESSAGE, TYPE_REOPEN
+  } Type;
+
+  Type            type;
+  Log::Level      level;
+  struct timeval  tv;
+  char            text[MAX_TEXT];
+};
+
+
+/**
+ * @brief  A bounded lock free multi producer, single consumer queue
+ *
+ * Each cell carry a sequence number telling if it is free for the producer
+ * with the matching enqueue position or ready for the consumer. This is the
+ * well known bounded queue design by Dmitry Vyukov.
+ */
+class LogQueue
+{
+  public:
+    explicit LogQueue(size_t size_pow2)
+      : cells(new Cell[size_pow2]), mask(size_pow2 - 1), enqueue_pos(0),
+        dequeue_pos(0)
+    {
+      for (size_t i=0; i<size_pow2; ++i)
+      {
+        cells[i].seq = i;
+      }
+    }
+
+    ~LogQueue(void) { delete [] cells; }
+
+      // Claim a cell for writing. Return 0 if the queue is full.
+    LogEntry *claim(size_t& pos)
+    {
+      pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+      for (;;)
+      {
+        Cell *cell = &cells[pos & mask];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = static_cast<intptr_t>(seq) -
+                        static_cast<intptr_t>(pos);
+        if (diff == 0)
+        {
+          if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+          {
+            return &cell->entry;
+          }
+        }
+        else if (diff < 0)
+        {
+          return 0;
+        }
+        else
+        {
+          pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+        }
+      }
+    }
+
+      // Hand a claimed cell over to the consumer
+    void publish(size_t pos)
+    {
+      __atomic_store_n(&cells[pos & mask].seq, pos + 1, __ATOMIC_RELEASE);
+    }
+
+      // Get the oldest entry or 0 if the queue is empty
+    LogEntry *front(void)
+    {
+      Cell *cell = &cells[dequeue_pos & mask];
+      size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+      return (seq == dequeue_pos + 1) ? &cell->entry : 0;
+    }
+
+      // Release the entry returned by front
+    void pop(void)
+    {
+      __atomic_store_n(&cells[dequeue_pos & mask].seq, dequeue_pos + mask + 1,
+                       __ATOMIC_RELEASE);
+      ++dequeue_pos;
+    }
+
+  private:
+    struct Cell
+    {
+      size_t    seq;
+      LogEntry  entry;
+    };
+
+    Cell          *cells;
+    const size_t  mask;
+    size_t        enqueue_pos;
+    size_t        dequeue_pos;
+
+    LogQueue(const LogQueue&);
+    LogQueue& operator=(const LogQueue&);
+};
+
+
+/**
+ * @brief  The state of the logging subsystem
+ */
+struct LogState
+{
+  static const size_t QUEUE_SIZE = 1024;
+
+  typedef std::map<std::string, Log::Level> LevelMap;
+
+  LogQueue        queue;
+  Log::Level      default_level;
+  LevelMap        levels;
+  std::string     logfile_name;
+  int             logfd;
+  int             input_fd;
+  std::string     tstamp_format;
+  bool            print_timestamp;
+  pthread_t       thread;
+  bool            running;
+  bool            stop_requested;
+  int             wakeup_pipe[2];
+  bool            wakeup_pending;
+  unsigned long   dropped_cnt;
+  unsigned long   reported_dropped_cnt;
+
+  LogState(void)
+    : queue(QUEUE_SIZE), default_level(Log::LEVEL_INFO), logfd(-1),
+      input_fd(-1), print_timestamp(true), thread(), running(false),
+      stop_requested(false), wakeup_pending(false), dropped_cnt(0),
+      reported_dropped_cnt(0)
+  {
+    wakeup_pipe[0] = wakeup_pipe[1] = -1;
+  }
+};
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+LogState& state(void);
+void *writerThread(void *);
+void processQueue(void);
+void readInput(void);
+void writeText(const char *buf, size_t len, const struct timeval *tv);
+bool writeTimestamp(const struct timeval& tv);
+void reopen(const char *reason);
+bool writeAll(const char *buf, size_t len);
+void enqueue(LogEntry::Type type, Log::Level level, const char *text);
+bool parseLevel(string str, Log::Level& level);
+string trim(const string& str);
+
+
+
+/****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+LogState& state(void)
+{
+  static LogState *s = new LogState;
+  return *s;
+} /* state */
+
+
+void *writerThread(void *)
+{
+  LogState& s = state();
+  for (;;)
+  {
+    struct pollfd fds[2];
+    fds[0].fd = s.wakeup_pipe[0];
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    nfds_t nfds = 1;
+    if (s.input_fd >= 0)
+    {
+      fds[1].fd = s.input_fd;
+      fds[1].events = POLLIN;
+      fds[1].revents = 0;
+      nfds = 2;
+    }
+    if ((poll(fds, nfds, -1) == -1) && (errno != EINTR))
+    {
+      break;
+    }
+
+    if (fds[0].revents != 0)
+    {
+      char buf[64];
+      while (read(s.wakeup_pipe[0], buf, sizeof(buf)) > 0) {}
+    }
+    __atomic_store_n(&s.wakeup_pending, false, __ATOMIC_SEQ_CST);
+
+    readInput();
+    processQueue();
+
+    if (__atomic_load_n(&s.stop_requested, __ATOMIC_SEQ_CST))
+    {
+      readInput();
+      processQueue();
+      break;
+    }
+  }
+  return 0;
+} /* writerThread */
+
+
+void processQueue(void)
+{
+  LogState& s = state();
+  LogEntry *entry;
+  while ((entry = s.queue.front()) != 0)
+  {
+    if (entry->type == LogEntry::TYPE_REOPEN)
+    {
+      reopen(entry->text);
+    }
+    else
+    {
+      string line(entry->text);
+      line += '\n';
+      writeText(line.data(), line.size(), &entry->tv);
+    }
+    s.queue.pop();
+  }
+
+  unsigned long dropped_cnt = __atomic_load_n(&s.dropped_cnt,
+                                              __ATOMIC_RELAXED);
+  if (dropped_cnt != s.reported_dropped_cnt)
+  {
+    ostringstream ss;
+    ss << "*** WARNING: " << (dropped_cnt - s.reported_dropped_cnt)
+       << " log messages dropped since the log queue was full\n";
+    s.reported_dropped_cnt = dropped_cnt;
+    writeText(ss.str().data(), ss.str().size(), 0);
+  }
+} /* processQueue */
+
+
+void readInput(void)
+{
+  LogState& s = state();
+  if (s.input_fd < 0)
+  {
+    return;
+  }
+  ssize_t len = 0;
+  do
+  {
+    char buf[256];
+    len = read(s.input_fd, buf, sizeof(buf));
+    if (len > 0)
+    {
+      writeText(buf, len, 0);
+    }
+  } while (len > 0);
+} /* readInput */
+
+
+void writeText(const char *buf, size_t len, const struct timeval *tv)
+{
+  LogState& s = state();
+  if (s.logfd == -1)
+  {
+    writeAll(buf, len);
+    return;
+  }
+
+  const char *ptr = buf;
+  const char *end = buf + len;
+  while (ptr < end)
+  {
+    if (s.print_timestamp)
+    {
+      struct timeval now;
+      if (tv == 0)
+      {
+        gettimeofday(&now, NULL);
+        tv = &now;
+      }
+      if (!writeTimestamp(*tv))
+      {
+        reopen("Write error");
+        return;
+      }
+      s.print_timestamp = false;
+    }
+
+    const char *nl = static_cast<const char *>(memchr(ptr, '\n', end - ptr));
+    size_t write_len = end - ptr;
+    if (nl != 0)
+    {
+      write_len = nl - ptr + 1;
+      s.print_timestamp = true;
+    }
+    if (!writeAll(ptr, write_len))
+    {
+      reopen("Write error");
+      return;
+    }
+    ptr += write_len;
+  }
+} /* writeText */
+
+
+bool writeTimestamp(const struct timeval& tv)
+{
+  LogState& s = state();
+  if (s.tstamp_format.empty())
+  {
+    return true;
+  }
+
+  string fmt(s.tstamp_format);
+  const string frac_code("%f");
+  size_t pos = fmt.find(frac_code);
+  if (pos != string::npos)
+  {
+    stringstream ss;
+    ss << setfill('0') << setw(3) << (tv.tv_usec / 1000);
+    fmt.replace(pos, frac_code.length(), ss.str());
+  }
+  struct tm tm;
+  time_t sec = tv.tv_sec;
+  localtime_r(&sec, &tm);
+  char tstr[256];
+  size_t tlen = strftime(tstr, sizeof(tstr) - 2, fmt.c_str(), &tm);
+  tstr[tlen++] = ':';
+  tstr[tlen++] = ' ';
+  return writeAll(tstr, tlen);
+} /* writeTimestamp */
+
+
+void reopen(const char *reason)
+{
+  LogState& s = state();
+  if (s.logfd == -1)
+  {
+    return;
+  }
+
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  writeTimestamp(tv);
+  string msg(reason);
+  msg += ". Reopening logfile\n";
+  writeAll(msg.data(), msg.size());
+
+  close(s.logfd);
+  s.logfd = open(s.logfile_name.c_str(), O_WRONLY | O_APPEND | O_CREAT,
+                 00644);
+  if (s.logfd == -1)
+  {
+    return;
+  }
+
+  gettimeofday(&tv, NULL);
+  writeTimestamp(tv);
+  msg = reason;
+  msg += ". Logfile reopened\n";
+  writeAll(msg.data(), msg.size());
+  s.print_timestamp = true;
+} /* reopen */
+
+
+bool writeAll(const char *buf, size_t len)
+{
+  LogState& s = state();
+  int fd = (s.logfd != -1) ? s.logfd : STDOUT_FILENO;
+  while (len > 0)
+  {
+    ssize_t ret = ::write(fd, buf, len);
+    if (ret == -1)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    buf += ret;
+    len -= ret;
+  }
+  return true;
+} /* writeAll */
+
+
+void enqueue(LogEntry::Type type, Log::Level level, const char *text)
+{
+  LogState& s = state();
+  size_t pos;
+  LogEntry *entry = s.queue.claim(pos);
+  if (entry == 0)
+  {
+    __atomic_add_fetch(&s.dropped_cnt, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  entry->type = type;
+  entry->level = level;
+  gettimeofday(&entry->tv, NULL);
+  strncpy(entry->text, text, sizeof(entry->text) - 1);
+  entry->text[sizeof(entry->text) - 1] = 0;
+  s.queue.publish(pos);
+
+  if (__atomic_load_n(&s.running, __ATOMIC_SEQ_CST) &&
+      !__atomic_exchange_n(&s.wakeup_pending, true, __ATOMIC_SEQ_CST))
+  {
+    char ch = 0;
+    if (::write(s.wakeup_pipe[1], &ch, 1) == -1) {}
+  }
+} /* enqueue */
+
+
+bool parseLevel(string str, Log::Level& level)
+{
+  for (size_t i=0; i<str.size(); ++i)
+  {
+    str[i] = toupper(str[i]);
+  }
+  if (str == "ERROR")
+  {
+    level = Log::LEVEL_ERROR;
+  }
+  else if (str == "WARNING")
+  {
+    level = Log::LEVEL_WARNING;
+  }
+  else if (str == "INFO")
+  {
+    level = Log::LEVEL_INFO;
+  }
+  else if (str == "DEBUG")
+  {
+    level = Log::LEVEL_DEBUG;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+} /* parseLevel */
+
+
+string trim(const string& str)
+{
+  size_t first = str.find_first_not_of(" \t");
+  if (first == string::npos)
+  {
+    return "";
+  }
+  size_t last = str.find_last_not_of(" \t");
+  return str.substr(first, last - first + 1);
+} /* trim */
+
+} /* anonymous namespace */
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+bool Log::openLogfile(const std::string& filename)
+{
+  LogState& s = state();
+  if (s.logfd != -1)
+  {
+    close(s.logfd);
+  }
+  s.logfile_name = filename;
+  s.logfd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 00644);
+  if (s.logfd == -1)
+  {
+    cerr << "open(\"" << filename << "\"): " << strerror(errno) << endl;
+    return false;
+  }
+  return true;
+} /* Log::openLogfile */
+
+
+void Log::reopenLogfile(const std::string& reason)
+{
+  enqueue(LogEntry::TYPE_REOPEN, LEVEL_INFO, reason.c_str());
+} /* Log::reopenLogfile */
+
+
+void Log::setInputFd(int fd)
+{
+  state().input_fd = fd;
+} /* Log::setInputFd */
+
+
+void Log::setTimestampFormat(const std::string& format)
+{
+  state().tstamp_format = format;
+} /* Log::setTimestampFormat */
+
+
+void Log::setDefaultLevel(Level level)
+{
+  state().default_level = level;
+} /* Log::setDefaultLevel */
+
+
+void Log::setLevel(const std::string& subsys, Level level)
+{
+  state().levels[subsys] = level;
+} /* Log::setLevel */
+
+
+bool Log::setLevels(const std::string& spec)
+{
+  stringstream ss(spec);
+  string item;
+  while (getline(ss, item, ','))
+  {
+    item = trim(item);
+    if (item.empty())
+    {
+      continue;
+    }
+    Level level;
+    size_t eq = item.find('=');
+    if (eq == string::npos)
+    {
+      if (!parseLevel(item, level))
+      {
+        return false;
+      }
+      setDefaultLevel(level);
+    }
+    else
+    {
+      string subsys(trim(item.substr(0, eq)));
+      if (subsys.empty() || !parseLevel(trim(item.substr(eq + 1)), level))
+      {
+        return false;
+      }
+      setLevel(subsys, level);
+    }
+  }
+  return true;
+} /* Log::setLevels */
+
+
+bool Log::isEnabled(Level level, const char *subsys)
+{
+  LogState& s = state();
+  if (!s.levels.empty())
+  {
+    LogState::LevelMap::const_iterator it = s.levels.find(subsys);
+    if (it != s.levels.end())
+    {
+      return level <= it->second;
+    }
+  }
+  return level <= s.default_level;
+} /* Log::isEnabled */
+
+
+void Log::write(Level level, const char *subsys, const std::string& msg)
+{
+  enqueue(LogEntry::TYPE_MESSAGE, level, msg.c_str());
+} /* Log::write */
+
+
+bool Log::start(void)
+{
+  LogState& s = state();
+  if (s.running)
+  {
+    return true;
+  }
+
+  if (pipe(s.wakeup_pipe) == -1)
+  {
+    perror("pipe");
+    return false;
+  }
+  for (int i=0; i<2; ++i)
+  {
+    int flags = fcntl(s.wakeup_pipe[i], F_GETFL);
+    fcntl(s.wakeup_pipe[i], F_SETFL, flags | O_NONBLOCK);
+  }
+
+  s.stop_requested = false;
+  s.wakeup_pending = false;
+  __atomic_store_n(&s.running, true, __ATOMIC_SEQ_CST);
+  int err = pthread_create(&s.thread, NULL, writerThread, NULL);
+  if (err != 0)
+  {
+    __atomic_store_n(&s.running, false, __ATOMIC_SEQ_CST);
+    cerr << "*** ERROR: Could not start the log writer thread: "
+         << strerror(err) << endl;
+    close(s.wakeup_pipe[0]);
+    close(s.wakeup_pipe[1]);
+    s.wakeup_pipe[0] = s.wakeup_pipe[1] = -1;
+    return false;
+  }
+
+    // Wake the thread up in case messages were queued before it started
+  __atomic_store_n(&s.wakeup_pending, true, __ATOMIC_SEQ_CST);
+  char ch = 0;
+  if (::write(s.wakeup_pipe[1], &ch, 1) == -1) {}
+
+  return true;
+} /* Log::start */
+
+
+void Log::stop(void)
+{
+  LogState& s = state();
+  if (__atomic_load_n(&s.running, __ATOMIC_SEQ_CST))
+  {
+    __atomic_store_n(&s.stop_requested, true, __ATOMIC_SEQ_CST);
+    char ch = 0;
+    if (::write(s.wakeup_pipe[1], &ch, 1) == -1) {}
+    pthread_join(s.thread, NULL);
+    __atomic_store_n(&s.running, false, __ATOMIC_SEQ_CST);
+    close(s.wakeup_pipe[0]);
+    close(s.wakeup_pipe[1]);
+    s.wakeup_pipe[0] = s.wakeup_pipe[1] = -1;
+  }
+  else
+  {
+    readInput();
+    processQueue();
+  }
+} /* Log::stop */
+
+
+unsigned long Log::droppedCount(void)
+{
+  return __atomic_load_n(&state().dropped_cnt, __ATOMIC_RELAXED);
+} /* Log::droppedCount */
+
+
+LogRateLimit::LogRateLimit(float rate, unsigned burst)
+  : m_rate(rate), m_burst(burst), m_tokens(burst), m_suppressed(0)
+{
+  clock_gettime(CLOCK_MONOTONIC, &m_last_refill);
+} /* LogRateLimit::LogRateLimit */
+
+
+bool LogRateLimit::allow(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  float elapsed = (now.tv_sec - m_last_refill.tv_sec) +
+                  (now.tv_nsec - m_last_refill.tv_nsec) / 1.0e9f;
+  m_last_refill = now;
+  m_tokens += elapsed * m_rate;
+  if (m_tokens > m_burst)
+  {
+    m_tokens = m_burst;
+  }
+
+  if (m_tokens < 1.0f)
+  {
+    ++m_suppressed;
+    return false;
+  }
+  m_tokens -= 1.0f;
+  return true;
+} /* LogRateLimit::allow */
+
+
+unsigned LogRateLimit::takeSuppressed(void)
+{
+  unsigned cnt = m_suppressed;
+  m_suppressed = 0;
+  return cnt;
+} /* LogRateLimit::takeSuppressed */
+
+
+LogMessage::~LogMessage(void)
+{
+  if (m_limit != 0)
+  {
+    unsigned suppressed_cnt = m_limit->takeSuppressed();
+    if (suppressed_cnt > 0)
+    {
+      m_ss << " (" << suppressed_cnt << " similar messages suppressed)";
+    }
+  }
+  Log::write(m_level, m_subsys, m_ss.str());
+} /* LogMessage::~LogMessage */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+
+
+/*
+ * This file has not been truncated
+ */
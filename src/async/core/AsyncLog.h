@@ -0,0 +1,391 @@
+/**
+@file	 AsyncLog.h
+@brief   Asynchronous logging with levels and rate limiting
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-10
+
+This file contains a logging subsystem where log messages are handed over to
+a writer thread through a lock free queue. The writer thread also take care of
+writing everything printed on stdout/stderr to the logfile, when one is used.
+Each subsystem can have its own log level and messages on hot paths can be
+rate limited.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef ASYNC_LOG_INCLUDED
+#define ASYNC_LOG_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/time.h>
+
+#include <string>
+#include <sstream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+class LogRateLimit;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+/**
+ * @brief   Log a message if the level is enabled for the subsystem
+ * @param   level The log level (Async::Log::Level)
+ * @param   subsys The name of the subsystem
+ *
+ * Use it like an output stream:
+ *
+ *   ASYNC_LOG(Async::Log::LEVEL_INFO, "REFLECTOR") << "Talker start";
+ *
+ * The message is only formatted if the level is enabled.
+ */
+#define ASYNC_LOG(level, subsys) \
+  if (!Async::Log::isEnabled(level, subsys)) {} \
+  else Async::LogMessage(level, subsys).stream()
+
+/**
+ * @brief   Log a message with rate limiting
+ * @param   level The log level (Async::Log::Level)
+ * @param   subsys The name of the subsystem
+ * @param   limit An Async::LogRateLimit object
+ *
+ * Same as ASYNC_LOG but the message is dropped if the rate limit has been
+ * exceeded. The number of dropped messages is added to the next message
+ * that get through.
+ */
+#define ASYNC_LOG_LIMITED(level, subsys, limit) \
+  if (!Async::Log::isEnabled(level, subsys) || !(limit).allow()) {} \
+  else Async::LogMessage(level, subsys, &(limit)).stream()
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Asynchronous logging with levels and rate limiting
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-10
+
+Writing to a logfile from the main thread may block the event loop, just when
+it is as busy as it gets, e.g. when many log messages are printed during a
+network glitch. This class move all logfile writes to a writer thread. Log
+messages are time stamped and put into a lock free queue, which the writer
+thread drain. If the queue is full, the message is dropped and the number of
+dropped messages is reported later.
+
+The writer thread can also read from a file descriptor, normally the read end
+of a pipe that stdout and stderr has been redirected to. Everything written to
+cout and cerr then end up in the logfile, written by the writer thread and
+time stamped.
+
+Each subsystem, identified by a name, can have its own log level. Subsystems
+that do not have a level of their own use the default level.
+
+The level is only used to decide if a message should be logged. The message
+text is written as is, so warnings and errors should be formatted the usual
+way, e.g. "*** WARNING: ...".
+
+All functions are static. The log levels should be set up before any other
+threads start logging.
+*/
+class Log
+{
+  public:
+    /**
+     * @brief The log levels, in order of increasing verbosity
+     */
+    typedef enum
+    {
+      LEVEL_ERROR,    ///< Errors
+      LEVEL_WARNING,  ///< Warnings
+      LEVEL_INFO,     ///< Normal operational messages
+      LEVEL_DEBUG     ///< Debug messages
+    } Level;
+
+    /**
+     * @brief   Open a logfile
+     * @param   filename The name of the logfile
+     * @return  Returns \em true on success or else \em false
+     *
+     * If no logfile is opened, log messages are written to stdout.
+     */
+    static bool openLogfile(const std::string& filename);
+
+    /**
+     * @brief   Reopen the logfile, e.g. after a log rotation
+     * @param   reason The reason for reopening the logfile
+     *
+     * The reopen is done by the writer thread. The reason is written to the
+     * logfile before and after reopening it.
+     */
+    static void reopenLogfile(const std::string& reason);
+
+    /**
+     * @brief   Set a file descriptor to read text to log from
+     * @param   fd The file descriptor, normally the read end of a pipe
+     *
+     * Text read from the file descriptor is written to the log line by line.
+     * The file descriptor must be set in non-blocking mode.
+     */
+    static void setInputFd(int fd);
+
+    /**
+     * @brief   Set the timestamp format
+     * @param   format The format, see strftime(3). %f is milliseconds.
+     *
+     * Timestamps are only written when logging to a logfile.
+     */
+    static void setTimestampFormat(const std::string& format);
+
+    /**
+     * @brief   Set the default log level
+     * @param   level The new default log level
+     */
+    static void setDefaultLevel(Level level);
+
+    /**
+     * @brief   Set the log level for a subsystem
+     * @param   subsys The name of the subsystem
+     * @param   level The new log level
+     */
+    static void setLevel(const std::string& subsys, Level level);
+
+    /**
+     * @brief   Set log levels from a specification string
+     * @param   spec The specification
+     * @return  Returns \em true on success or \em false on syntax error
+     *
+     * The specification is a comma separated list. An item without a
+     * subsystem name set the default level, e.g. "INFO,REFLECTOR=DEBUG".
+     * Valid levels are ERROR, WARNING, INFO and DEBUG.
+     */
+    static bool setLevels(const std::string& spec);
+
+    /**
+     * @brief   Check if a log level is enabled for a subsystem
+     * @param   level The log level to check
+     * @param   subsys The name of the subsystem
+     * @return  Returns \em true if messages of the level should be logged
+     */
+    static bool isEnabled(Level level, const char *subsys);
+
+    /**
+     * @brief   Write a log message
+     * @param   level The log level
+     * @param   subsys The name of the subsystem
+     * @param   msg The message, without trailing newline
+     *
+     * This function is thread safe. The level is not checked.
+     */
+    static void write(Level level, const char *subsys, const std::string& msg);
+
+    /**
+     * @brief   Start the writer thread
+     * @return  Returns \em true on success or else \em false
+     *
+     * This function must not be called before a fork, e.g. daemon(3), since
+     * threads do not survive a fork.
+     */
+    static bool start(void);
+
+    /**
+     * @brief   Write all pending messages and stop the writer thread
+     *
+     * If the writer thread is not running, pending messages are written by
+     * the calling thread. Everything that can be read from the input file
+     * descriptor is also written.
+     */
+    static void stop(void);
+
+    /**
+     * @brief   Get the number of messages dropped due to a full queue
+     * @return  Returns the number of dropped messages
+     */
+    static unsigned long droppedCount(void);
+
+  private:
+    Log(void);
+    Log(const Log&);
+    Log& operator=(const Log&);
+
+};  /* class Log */
+
+
+/**
+@brief	A token bucket rate limiter for log messages
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-10
+
+Use one object of this class for each message, or group of similar messages,
+that may be printed at a high rate. The bucket hold at most \em burst tokens
+and is refilled with \em rate tokens per second. Each message use one token.
+When the bucket is empty, messages are suppressed and counted. The count is
+reported in the next message that get through, as "(N similar messages
+suppressed)". Normally the ASYNC_LOG_LIMITED macro is used.
+*/
+class LogRateLimit
+{
+  public:
+    /**
+     * @brief   Constructor
+     * @param   rate The number of messages per second to let through
+     * @param   burst The maximum number of messages in a burst
+     */
+    LogRateLimit(float rate=1.0f, unsigned burst=5);
+
+    /**
+     * @brief   Check if a message may be printed
+     * @return  Returns \em true if the message may be printed
+     *
+     * If \em false is returned, the message is counted as suppressed.
+     */
+    bool allow(void);
+
+    /**
+     * @brief   Get and reset the number of suppressed messages
+     * @return  Returns the number of messages suppressed since last call
+     */
+    unsigned takeSuppressed(void);
+
+  private:
+    float           m_rate;
+    float           m_burst;
+    float           m_tokens;
+    struct timespec m_last_refill;
+    unsigned        m_suppressed;
+
+};  /* class LogRateLimit */
+
+
+/**
+@brief	A log message being built
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-10
+
+An object of this class is created by the ASYNC_LOG macros. The message is
+built using the output stream and written to the log when the object is
+destroyed, at the end of the statement.
+*/
+class LogMessage
+{
+  public:
+    /**
+     * @brief   Constructor
+     * @param   level The log level
+     * @param   subsys The name of the subsystem
+     * @param   limit A rate limiter to take the suppressed count from
+     */
+    LogMessage(Log::Level level, const char *subsys, LogRateLimit *limit=0)
+      : m_level(level), m_subsys(subsys), m_limit(limit) {}
+
+    /**
+     * @brief   Destructor, write the message to the log
+     */
+    ~LogMessage(void);
+
+    /**
+     * @brief   Get the stream to write the message to
+     * @return  Returns the output stream
+     */
+    std::ostream& stream(void) { return m_ss; }
+
+  private:
+    Log::Level          m_level;
+    const char          *m_subsys;
+    LogRateLimit        *m_limit;
+    std::ostringstream  m_ss;
+
+    LogMessage(const LogMessage&);
+    LogMessage& operator=(const LogMessage&);
+
+};  /* class LogMessage */
+
+
+} /* namespace */
+
+#endif /* ASYNC_LOG_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,559 @@
+/**
+@file	 AsyncMetrics.cpp
+@brief   A registry of counters, gauges and histograms for monitoring
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-29
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <pthread.h>
+
+#include <cassert>
+#include <cstring>
+#include <cfloat>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <algorithm>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncMetrics.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+namespace {
+
+/**
+ * @brief  All metrics with the same name
+ */
+struct Family
+{
+  string            help;
+  string            type;
+  vector<Metric*>   metrics;
+  vector<Metric*>   unexported;
+};
+
+typedef map<string, Family> FamilyMap;
+
+
+/**
+ * @brief  The state of the registry
+ *
+ * The registry is never destroyed so that metrics can still be updated by
+ * objects destroyed after main has returned.
+ */
+struct Registry
+{
+  pthread_mutex_t mutex;
+  FamilyMap       families;
+
+  Registry(void) { pthread_mutex_init(&mutex, NULL); }
+};
+
+
+class Locker
+{
+  public:
+    explicit Locker(pthread_mutex_t *mutex) : mutex(mutex)
+    {
+      pthread_mutex_lock(mutex);
+    }
+    ~Locker(void) { pthread_mutex_unlock(mutex); }
+
+  private:
+    pthread_mutex_t *mutex;
+};
+
+
+}; /* anonymous namespace */
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+static Registry& registry(void);
+static Metric *findMetric(Family& family, const string& labels,
+                          const char *type);
+static void addMetric(const string& name, Family& family, Metric *metric,
+                      const string& help);
+static bool eraseMetric(vector<Metric*>& metrics, Metric *metric);
+static uint64_t doubleToBits(double value);
+static double bitsToDouble(uint64_t bits);
+static void atomicAddDouble(uint64_t *bits, double value);
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+void MetricCounter::write(std::ostream& os) const
+{
+  writeName(os);
+  os << " " << value() << "\n";
+} /* MetricCounter::write */
+
+
+MetricGauge::MetricGauge(const std::string& name, const std::string& labels)
+  : Metric(name, labels), m_bits(doubleToBits(0.0))
+{
+} /* MetricGauge::MetricGauge */
+
+
+void MetricGauge::set(double value)
+{
+  __atomic_store_n(&m_bits, doubleToBits(value), __ATOMIC_RELAXED);
+} /* MetricGauge::set */
+
+
+void MetricGauge::add(double value)
+{
+  atomicAddDouble(&m_bits, value);
+} /* MetricGauge::add */
+
+
+double MetricGauge::value(void) const
+{
+  return bitsToDouble(__atomic_load_n(&m_bits, __ATOMIC_RELAXED));
+} /* MetricGauge::value */
+
+
+void MetricGauge::write(std::ostream& os) const
+{
+  writeName(os);
+  os << " ";
+  writeValue(os, value());
+  os << "\n";
+} /* MetricGauge::write */
+
+
+MetricHistogram::MetricHistogram(const std::string& name,
+                                 const std::string& labels,
+                                 const std::vector<double>& bounds)
+  : Metric(name, labels), m_bounds(bounds), m_counts(bounds.size() + 1, 0),
+    m_sum_bits(doubleToBits(0.0))
+{
+} /* MetricHistogram::MetricHistogram */
+
+
+void MetricHistogram::observe(double value)
+{
+    // Only the bucket the value fall into is counted. The buckets are made
+    // cumulative when written.
+  size_t idx = lower_bound(m_bounds.begin(), m_bounds.end(), value) -
+               m_bounds.begin();
+  __atomic_add_fetch(&m_counts[idx], 1, __ATOMIC_RELAXED);
+  atomicAddDouble(&m_sum_bits, value);
+} /* MetricHistogram::observe */
+
+
+void MetricHistogram::write(std::ostream& os) const
+{
+  uint64_t cnt = 0;
+  for (size_t i=0; i<m_counts.size(); ++i)
+  {
+    cnt += __atomic_load_n(&m_counts[i], __ATOMIC_RELAXED);
+    ostringstream le;
+    le << "le=\"";
+    if (i < m_bounds.size())
+    {
+      writeValue(le, m_bounds[i]);
+    }
+    else
+    {
+      le << "+Inf";
+    }
+    le << "\"";
+    writeName(os, "_bucket", le.str());
+    os << " " << cnt << "\n";
+  }
+  writeName(os, "_sum");
+  os << " ";
+  writeValue(os, bitsToDouble(__atomic_load_n(&m_sum_bits, __ATOMIC_RELAXED)));
+  os << "\n";
+  writeName(os, "_count");
+  os << " " << cnt << "\n";
+} /* MetricHistogram::write */
+
+
+MetricCounter *Metrics::counter(const std::string& name,
+                                const std::string& help,
+                                const std::string& labels)
+{
+  Registry& reg = registry();
+  Locker lock(&reg.mutex);
+  Family& family = reg.families[name];
+  MetricCounter *metric =
+      static_cast<MetricCounter*>(findMetric(family, labels, "counter"));
+  if (metric == 0)
+  {
+    metric = new MetricCounter(name, labels);
+    addMetric(name, family, metric, help);
+  }
+  ++metric->m_ref_cnt;
+  return metric;
+} /* Metrics::counter */
+
+
+MetricGauge *Metrics::gauge(const std::string& name, const std::string& help,
+                            const std::string& labels)
+{
+  Registry& reg = registry();
+  Locker lock(&reg.mutex);
+  Family& family = reg.families[name];
+  MetricGauge *metric =
+      static_cast<MetricGauge*>(findMetric(family, labels, "gauge"));
+  if (metric == 0)
+  {
+    metric = new MetricGauge(name, labels);
+    addMetric(name, family, metric, help);
+  }
+  ++metric->m_ref_cnt;
+  return metric;
+} /* Metrics::gauge */
+
+
+MetricHistogram *Metrics::histogram(const std::string& name,
+                                    const std::string& help,
+                                    const std::vector<double>& bounds,
+                                    const std::string& labels)
+{
+  Registry& reg = registry();
+  Locker lock(&reg.mutex);
+  Family& family = reg.families[name];
+  MetricHistogram *metric =
+      static_cast<MetricHistogram*>(findMetric(family, labels, "histogram"));
+  if (metric == 0)
+  {
+    metric = new MetricHistogram(name, labels, bounds);
+    addMetric(name, family, metric, help);
+  }
+  ++metric->m_ref_cnt;
+  return metric;
+} /* Metrics::histogram */
+
+
+void Metrics::remove(Metric *metric)
+{
+  if (metric == 0)
+  {
+    return;
+  }
+
+  Registry& reg = registry();
+  Locker lock(&reg.mutex);
+  assert(metric->m_ref_cnt > 0);
+  if (--metric->m_ref_cnt > 0)
+  {
+    return;
+  }
+  FamilyMap::iterator it = reg.families.find(metric->name());
+  if (it != reg.families.end())
+  {
+    Family& family = (*it).second;
+    if (!eraseMetric(family.metrics, metric))
+    {
+      eraseMetric(family.unexported, metric);
+    }
+    if (family.metrics.empty() && family.unexported.empty())
+    {
+      reg.families.erase(it);
+    }
+  }
+  delete metric;
+} /* Metrics::remove */
+
+
+void Metrics::write(std::ostream& os)
+{
+  Registry& reg = registry();
+  Locker lock(&reg.mutex);
+  for (FamilyMap::const_iterator it = reg.families.begin();
+       it != reg.families.end(); ++it)
+  {
+    const Family& family = (*it).second;
+    if (family.metrics.empty())
+    {
+      continue;
+    }
+    os << "# HELP " << (*it).first << " " << family.help << "\n";
+    os << "# TYPE " << (*it).first << " " << family.type << "\n";
+    for (size_t i=0; i<family.metrics.size(); ++i)
+    {
+      family.metrics[i]->write(os);
+    }
+  }
+} /* Metrics::write */
+
+
+std::string Metrics::label(const std::string& name, const std::string& value)
+{
+  string label(name);
+  label += "=\"";
+  for (string::const_iterator it = value.begin(); it != value.end(); ++it)
+  {
+    switch (*it)
+    {
+      case '\\':
+        label += "\\\\";
+        break;
+      case '"':
+        label += "\\\"";
+        break;
+      case '\n':
+        label += "\\n";
+        break;
+      default:
+        label += *it;
+        break;
+    }
+  }
+  label += "\"";
+  return label;
+} /* Metrics::label */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+void Metric::writeName(std::ostream& os, const char *suffix,
+                       const std::string& extra_label) const
+{
+  os << m_name << suffix;
+  if (!m_labels.empty() || !extra_label.empty())
+  {
+    os << "{" << m_labels;
+    if (!m_labels.empty() && !extra_label.empty())
+    {
+      os << ",";
+    }
+    os << extra_label << "}";
+  }
+} /* Metric::writeName */
+
+
+void Metric::writeValue(std::ostream& os, double value)
+{
+  if (value != value)
+  {
+    os << "NaN";
+  }
+  else if ((value > DBL_MAX) || (value < -DBL_MAX))
+  {
+    os << ((value > 0) ? "+Inf" : "-Inf");
+  }
+  else
+  {
+    ostringstream ss;
+    ss << setprecision(12) << value;
+    os << ss.str();
+  }
+} /* Metric::writeValue */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local functions
+ *
+ ****************************************************************************/
+
+static Registry& registry(void)
+{
+  static Registry *reg = new Registry;
+  return *reg;
+} /* registry */
+
+
+static Metric *findMetric(Family& family, const string& labels,
+                          const char *type)
+{
+  vector<Metric*> *lists[] = { &family.metrics, &family.unexported };
+  for (size_t l=0; l<2; ++l)
+  {
+    const vector<Metric*>& metrics = *lists[l];
+    for (size_t i=0; i<metrics.size(); ++i)
+    {
+      if ((metrics[i]->labels() == labels) &&
+          (strcmp(metrics[i]->type(), type) == 0))
+      {
+        return metrics[i];
+      }
+    }
+  }
+  return 0;
+} /* findMetric */
+
+
+  /*
+   * A metric with another type than the family is kept in the registry, so
+   * that it is reference counted and deleted like all other metrics, but it
+   * is not exported.
+   */
+static void addMetric(const string& name, Family& family, Metric *metric,
+                      const string& help)
+{
+  if (family.metrics.empty())
+  {
+    family.help = help;
+    family.type = metric->type();
+  }
+  if (family.type == metric->type())
+  {
+    family.metrics.push_back(metric);
+  }
+  else
+  {
+    cerr << "*** WARNING: Metric \"" << name << "\" used with different "
+            "types. It will not be exported as a " << metric->type() << "."
+         << endl;
+    family.unexported.push_back(metric);
+  }
+} /* addMetric */
+
+
+static bool eraseMetric(vector<Metric*>& metrics, Metric *metric)
+{
+  vector<Metric*>::iterator it = find(metrics.begin(), metrics.end(), metric);
+  if (it == metrics.end())
+  {
+    return false;
+  }
+  metrics.erase(it);
+  return true;
+} /* eraseMetric */
+
+
+static uint64_t doubleToBits(double value)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+} /* doubleToBits */
+
+
+static double bitsToDouble(uint64_t bits)
+{
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+} /* bitsToDouble */
+
+
+static void atomicAddDouble(uint64_t *bits, double value)
+{
+  uint64_t old_bits = __atomic_load_n(bits, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(bits, &old_bits,
+              doubleToBits(bitsToDouble(old_bits) + value), true,
+              __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+  {
+  }
+} /* atomicAddDouble */
+
+
+
+/*
+ * This file has not been truncated
+ */
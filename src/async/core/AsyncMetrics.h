@@ -0,0 +1,414 @@
+/**
+@file	 AsyncMetrics.h
+@brief   A registry of counters, gauges and histograms for monitoring
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-29
+
+This file contains classes for collecting metrics, like packet counts and
+buffer fill levels, inside an application. The metrics can be written in the
+Prometheus text exposition format, e.g. by the Async::MetricsHttpServer class.
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef ASYNC_METRICS_INCLUDED
+#define ASYNC_METRICS_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	The base class for all metrics
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-29
+
+A metric has a name, a help text and an optional set of labels. Metrics are
+created and owned by the Async::Metrics registry. Updating a metric only use
+atomic operations so it is cheap and can be done from any thread.
+*/
+class Metric
+{
+  public:
+    /**
+     * @brief   Destructor
+     */
+    virtual ~Metric(void) {}
+
+    /**
+     * @brief   Get the name of the metric
+     * @return  Returns the name of the metric
+     */
+    const std::string& name(void) const { return m_name; }
+
+    /**
+     * @brief   Get the labels of the metric
+     * @return  Returns the labels, e.g. logic="SimplexLogic"
+     */
+    const std::string& labels(void) const { return m_labels; }
+
+    /**
+     * @brief   Get the Prometheus type of the metric
+     * @return  Returns "counter", "gauge" or "histogram"
+     */
+    virtual const char *type(void) const = 0;
+
+    /**
+     * @brief   Write the samples of the metric in Prometheus text format
+     * @param   os The stream to write to
+     */
+    virtual void write(std::ostream& os) const = 0;
+
+  protected:
+    /**
+     * @brief   Constructor
+     * @param   name The name of the metric
+     * @param   labels The labels of the metric
+     */
+    Metric(const std::string& name, const std::string& labels)
+      : m_name(name), m_labels(labels), m_ref_cnt(0) {}
+
+    /**
+     * @brief   Write a sample name followed by the labels
+     * @param   os The stream to write to
+     * @param   suffix A suffix to add to the name, e.g. "_sum"
+     * @param   extra_label An extra label to add, e.g. le="0.5"
+     */
+    void writeName(std::ostream& os, const char *suffix="",
+                   const std::string& extra_label="") const;
+
+    /**
+     * @brief   Write a floating point sample value
+     * @param   os The stream to write to
+     * @param   value The value to write
+     */
+    static void writeValue(std::ostream& os, double value);
+
+  private:
+    std::string m_name;
+    std::string m_labels;
+    unsigned    m_ref_cnt;
+
+    Metric(const Metric&);
+    Metric& operator=(const Metric&);
+
+    friend class Metrics;
+
+};  /* class Metric */
+
+
+/**
+@brief	A counter metric
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-29
+
+A counter is a value that only increase, like the number of received packets.
+*/
+class MetricCounter : public Metric
+{
+  public:
+    /**
+     * @brief   Increase the counter
+     * @param   n The number to add
+     */
+    void inc(uint64_t n=1) { __atomic_add_fetch(&m_value, n, __ATOMIC_RELAXED); }
+
+    /**
+     * @brief   Get the value of the counter
+     * @return  Returns the current value
+     */
+    uint64_t value(void) const
+    {
+      return __atomic_load_n(&m_value, __ATOMIC_RELAXED);
+    }
+
+    virtual const char *type(void) const { return "counter"; }
+    virtual void write(std::ostream& os) const;
+
+  private:
+    uint64_t m_value;
+
+    MetricCounter(const std::string& name, const std::string& labels)
+      : Metric(name, labels), m_value(0) {}
+
+    friend class Metrics;
+
+};  /* class MetricCounter */
+
+
+/**
+@brief	A gauge metric
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-29
+
+A gauge is a value that can go up and down, like a buffer fill level.
+*/
+class MetricGauge : public Metric
+{
+  public:
+    /**
+     * @brief   Set the value of the gauge
+     * @param   value The new value
+     */
+    void set(double value);
+
+    /**
+     * @brief   Add to the value of the gauge
+     * @param   value The value to add, may be negative
+     */
+    void add(double value);
+
+    /**
+     * @brief   Get the value of the gauge
+     * @return  Returns the current value
+     */
+    double value(void) const;
+
+    virtual const char *type(void) const { return "gauge"; }
+    virtual void write(std::ostream& os) const;
+
+  private:
+    uint64_t m_bits;
+
+    MetricGauge(const std::string& name, const std::string& labels);
+
+    friend class Metrics;
+
+};  /* class MetricGauge */
+
+
+/**
+@brief	A histogram metric
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-29
+
+A histogram count observations, like latencies, in buckets. Each bucket is
+given by its upper bound. An implicit +Inf bucket is always added.
+*/
+class MetricHistogram : public Metric
+{
+  public:
+    /**
+     * @brief   Add an observation
+     * @param   value The observed value
+     */
+    void observe(double value);
+
+    virtual const char *type(void) const { return "histogram"; }
+    virtual void write(std::ostream& os) const;
+
+  private:
+    std::vector<double>   m_bounds;
+    std::vector<uint64_t> m_counts;
+    uint64_t              m_sum_bits;
+
+    MetricHistogram(const std::string& name, const std::string& labels,
+                    const std::vector<double>& bounds);
+
+    friend class Metrics;
+
+};  /* class MetricHistogram */
+
+
+/**
+@brief	The registry of all metrics in the application
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-29
+
+All metrics are created using the static functions in this class. If a metric
+with the same name, labels and type already exist, that metric is returned.
+Metrics with the same name must be of the same type and have the same help
+text. A metric of another type than the first one with the same name is
+created but is not exported. The metrics are kept until they are removed or
+until the application exit so a pointer to a metric can be kept and updated
+without locking.
+
+The metrics are reference counted. Each call to one of the functions getting
+a metric must be matched by a call to the remove function. The metric is
+deleted when the last user has removed it.
+
+Labels are given as a preformatted string, e.g. built using the label
+function:
+
+  MetricCounter *rx_cnt = Metrics::counter("svxlink_udp_rx_packets_total",
+      "Received UDP packets", Metrics::label("logic", name()));
+  rx_cnt->inc();
+
+Creating, removing and writing metrics is thread safe.
+*/
+class Metrics
+{
+  public:
+    /**
+     * @brief   Get or create a counter
+     * @param   name The name of the metric
+     * @param   help A short description of the metric
+     * @param   labels The labels of the metric
+     * @return  Returns the counter
+     */
+    static MetricCounter *counter(const std::string& name,
+                                  const std::string& help,
+                                  const std::string& labels="");
+
+    /**
+     * @brief   Get or create a gauge
+     * @param   name The name of the metric
+     * @param   help A short description of the metric
+     * @param   labels The labels of the metric
+     * @return  Returns the gauge
+     */
+    static MetricGauge *gauge(const std::string& name,
+                              const std::string& help,
+                              const std::string& labels="");
+
+    /**
+     * @brief   Get or create a histogram
+     * @param   name The name of the metric
+     * @param   help A short description of the metric
+     * @param   bounds The upper bounds of the buckets, in increasing order
+     * @param   labels The labels of the metric
+     * @return  Returns the histogram
+     */
+    static MetricHistogram *histogram(const std::string& name,
+                                      const std::string& help,
+                                      const std::vector<double>& bounds,
+                                      const std::string& labels="");
+
+    /**
+     * @brief   Release a metric
+     * @param   metric The metric to release
+     *
+     * The metric is removed from the registry and deleted when all users that
+     * got it from the registry have released it. The metric must not be used
+     * by any other thread when it is deleted. Nothing is done if the metric
+     * is 0.
+     */
+    static void remove(Metric *metric);
+
+    /**
+     * @brief   Write all metrics in the Prometheus text format
+     * @param   os The stream to write to
+     */
+    static void write(std::ostream& os);
+
+    /**
+     * @brief   Format a label
+     * @param   name The name of the label
+     * @param   value The value of the label
+     * @return  Returns the label, e.g. logic="SimplexLogic"
+     *
+     * Special characters in the value are escaped. Use a comma to separate
+     * labels when there are more than one.
+     */
+    static std::string label(const std::string& name,
+                             const std::string& value);
+
+  private:
+    Metrics(void);
+    Metrics(const Metrics&);
+    Metrics& operator=(const Metrics&);
+
+};  /* class Metrics */
+
+
+} /* namespace */
+
+#endif /* ASYNC_METRICS_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,290 @@
+/**
+@file	 AsyncMetricsHttpServer.cpp
+@brief   A minimal HTTP server exporting metrics in Prometheus text format
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-29
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <sstream>
+#include <iomanip>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncTimer.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncMetricsHttpServer.h"
+#include "AsyncMetrics.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+MetricsHttpServer::MetricsHttpServer(const std::string& port_str,
+                                     const IpAddress& bind_ip)
+  : m_srv(port_str, bind_ip)
+{
+  m_srv.clientConnected.connect(
+      mem_fun(*this, &MetricsHttpServer::onClientConnected));
+  m_srv.clientDisconnected.connect(
+      mem_fun(*this, &MetricsHttpServer::onClientDisconnected));
+} /* MetricsHttpServer::MetricsHttpServer */
+
+
+MetricsHttpServer::~MetricsHttpServer(void)
+{
+  for (ClientMap::iterator it = m_clients.begin(); it != m_clients.end(); ++it)
+  {
+    delete (*it).second.timer;
+  }
+} /* MetricsHttpServer::~MetricsHttpServer */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void MetricsHttpServer::onClientConnected(TcpConnection *con)
+{
+  Client& client = m_clients[con];
+  client.timer = new Timer(REQUEST_TIMEOUT);
+  client.timer->expired.connect(
+      sigc::bind(mem_fun(*this, &MetricsHttpServer::onTimeout), con));
+  con->dataReceived.connect(
+      mem_fun(*this, &MetricsHttpServer::onDataReceived));
+    // The response should never be cut short, even if larger than the
+    // kernel send buffer
+  con->setSendQueueSize(16 * 1024 * 1024);
+} /* MetricsHttpServer::onClientConnected */
+
+
+void MetricsHttpServer::onClientDisconnected(TcpConnection *con,
+                                       TcpConnection::DisconnectReason reason)
+{
+  ClientMap::iterator it = m_clients.find(con);
+  if (it != m_clients.end())
+  {
+    delete (*it).second.timer;
+    m_clients.erase(it);
+  }
+} /* MetricsHttpServer::onClientDisconnected */
+
+
+int MetricsHttpServer::onDataReceived(TcpConnection *con, void *buf,
+                                      int count)
+{
+  ClientMap::iterator it = m_clients.find(con);
+  if ((it == m_clients.end()) || !con->isConnected())
+  {
+    return count;
+  }
+  Client& client = (*it).second;
+  if (client.request.size() + count > MAX_REQUEST_SIZE)
+  {
+    closeConnection(con);
+    return count;
+  }
+  client.request.append(reinterpret_cast<char *>(buf), count);
+  if (client.request.find("\r\n\r\n") != string::npos)
+  {
+    handleRequest(con, client.request);
+  }
+  return count;
+} /* MetricsHttpServer::onDataReceived */
+
+
+void MetricsHttpServer::handleRequest(TcpConnection *con,
+                                      const std::string& request)
+{
+  istringstream is(request.substr(0, request.find("\r\n")));
+  string method, path, version;
+  is >> method >> path >> version;
+  string::size_type query_pos = path.find('?');
+  if (query_pos != string::npos)
+  {
+    path.erase(query_pos);
+  }
+
+  if (method != "GET")
+  {
+    sendResponse(con, "405 Method Not Allowed", "Method not allowed\n");
+    return;
+  }
+  if ((path != "/metrics") && (path != "/"))
+  {
+    sendResponse(con, "404 Not Found", "Not found\n");
+    return;
+  }
+
+  ostringstream body;
+  Metrics::write(body);
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) == 0)
+  {
+    double cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1000000.0 +
+                 ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1000000.0;
+    body << "# HELP process_cpu_seconds_total "
+            "Total user and system CPU time spent in seconds\n"
+         << "# TYPE process_cpu_seconds_total counter\n"
+         << "process_cpu_seconds_total " << fixed << setprecision(3) << cpu
+         << "\n";
+  }
+  sendResponse(con, "200 OK", body.str());
+} /* MetricsHttpServer::handleRequest */
+
+
+void MetricsHttpServer::sendResponse(TcpConnection *con,
+                                     const std::string& status,
+                                     const std::string& body)
+{
+  ostringstream ss;
+  ss << "HTTP/1.0 " << status << "\r\n"
+     << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+     << "Content-Length: " << body.size() << "\r\n"
+     << "Connection: close\r\n"
+     << "\r\n"
+     << body;
+  string response(ss.str());
+  con->write(response.data(), response.size());
+
+    // If not everything could be sent right away, the client is left to
+    // close the connection when it has read the whole response. The request
+    // timer close it if the client does not.
+  if (con->sendQueueBytes() == 0)
+  {
+    closeConnection(con);
+  }
+} /* MetricsHttpServer::sendResponse */
+
+
+void MetricsHttpServer::onTimeout(Timer *t, TcpConnection *con)
+{
+  closeConnection(con);
+} /* MetricsHttpServer::onTimeout */
+
+
+void MetricsHttpServer::closeConnection(TcpConnection *con)
+{
+  if (!con->isConnected())
+  {
+    return;
+  }
+    // The disconnected signal is not emitted by disconnect so emit it here
+    // to make the server remove the connection
+  con->disconnect();
+  con->disconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
+} /* MetricsHttpServer::closeConnection */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,178 @@
+/**
+@file	 AsyncMetricsHttpServer.h
+@brief   A minimal HTTP server exporting metrics in Prometheus text format
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-29
+
+\verbatim
+Async - A library for programming event driven applications
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef ASYNC_METRICS_HTTP_SERVER_INCLUDED
+#define ASYNC_METRICS_HTTP_SERVER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+
+#include <string>
+#include <map>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncTcpServer.h>
+#include <AsyncIpAddress.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+class Timer;
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	A minimal HTTP server exporting metrics in Prometheus text format
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-29
+
+This class listen for HTTP requests and answer "GET /metrics" with all metrics
+in the Async::Metrics registry, in the Prometheus text exposition format. The
+standard process_cpu_seconds_total metric is added to each response. Only
+one request is handled for each connection. The connection is closed after
+the response has been sent or if no complete request has been received within
+a few seconds.
+
+The server run in the main thread, just like the rest of the application, so
+a scrape show a consistent view of the metrics updated by the main thread.
+*/
+class MetricsHttpServer : public sigc::trackable
+{
+  public:
+    /**
+     * @brief 	Constructor
+     * @param 	port_str The port number or service name to listen to
+     * @param 	bind_ip The IP address to bind to, default all
+     */
+    MetricsHttpServer(const std::string& port_str,
+                      const IpAddress& bind_ip=IpAddress());
+
+    /**
+     * @brief 	Destructor
+     */
+    ~MetricsHttpServer(void);
+
+  private:
+    static const size_t   MAX_REQUEST_SIZE  = 8192;
+    static const unsigned REQUEST_TIMEOUT   = 5000;
+
+    struct Client
+    {
+      std::string request;
+      Timer       *timer;
+    };
+    typedef std::map<TcpConnection*, Client> ClientMap;
+
+    TcpServer<TcpConnection>  m_srv;
+    ClientMap                 m_clients;
+
+    MetricsHttpServer(const MetricsHttpServer&);
+    MetricsHttpServer& operator=(const MetricsHttpServer&);
+    void onClientConnected(TcpConnection *con);
+    void onClientDisconnected(TcpConnection *con,
+                              TcpConnection::DisconnectReason reason);
+    int onDataReceived(TcpConnection *con, void *buf, int count);
+    void handleRequest(TcpConnection *con, const std::string& request);
+    void sendResponse(TcpConnection *con, const std::string& status,
+                      const std::string& body);
+    void onTimeout(Timer *t, TcpConnection *con);
+    void closeConnection(TcpConnection *con);
+
+};  /* class MetricsHttpServer */
+
+
+} /* namespace */
+
+#endif /* ASYNC_METRICS_HTTP_SERVER_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
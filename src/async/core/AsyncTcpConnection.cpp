@@ -35,6 +35,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <assert.h>
@@ -42,6 +45,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
+#include <vector>
+#include <algorithm>
 
 
 /****************************************************************************
@@ -81,6 +86,16 @@ using namespace Async;
  *
  ****************************************************************************/
 
+namespace {
+    // The size of each send queue memory chunk
+  const size_t SEND_CHUNK_SIZE = 4096;
+
+    // The maximum number of unused chunks to keep in the pool
+  const size_t SEND_CHUNK_POOL_MAX = 64;
+
+    // The maximum number of chunks to write in one system call
+  const int SEND_MAX_IOV = 64;
+};
 
 
 /****************************************************************************
@@ -89,6 +104,25 @@ using namespace Async;
  *
  ****************************************************************************/
 
+struct TcpConnection::SendChunk
+{
+  size_t  head;
+  size_t  tail;
+  char    data[SEND_CHUNK_SIZE];
+};
+
+
+class TcpConnection::SendChunkPool : public std::vector<SendChunk*>
+{
+  public:
+    ~SendChunkPool(void)
+    {
+      for (iterator it = begin(); it != end(); ++it)
+      {
+        delete *it;
+      }
+    }
+};
 
 
 /****************************************************************************
@@ -114,6 +148,7 @@ using namespace Async;
  *
  ****************************************************************************/
 
+TcpConnection::SendChunkPool TcpConnection::chunk_pool;
 
 
 /****************************************************************************
@@ -164,7 +199,8 @@ const char *TcpConnection::disconnectReasonStr(DisconnectReason reason)
  */
 TcpConnection::TcpConnection(size_t recv_buf_len)
   : remote_port(0), recv_buf_len(recv_buf_len), sock(-1), rd_watch(0),
-    wr_watch(0), recv_buf(0), recv_buf_cnt(0)
+    wr_watch(0), recv_buf(0), recv_buf_cnt(0), send_queue_max(0),
+    send_queue_bytes(0), send_cork_cnt(0), send_buf_full(false)
 {
   recv_buf = new char[recv_buf_len];
   rd_watch = new FdWatch;
@@ -178,7 +214,8 @@ TcpConnection::TcpConnection(int sock, const IpAddress& remote_addr,
       	      	      	     uint16_t remote_port, size_t recv_buf_len)
   : remote_addr(remote_addr), remote_port(remote_port),
     recv_buf_len(recv_buf_len), sock(sock), rd_watch(0), wr_watch(0),
-    recv_buf(0), recv_buf_cnt(0)
+    recv_buf(0), recv_buf_cnt(0), send_queue_max(0), send_queue_bytes(0),
+    send_cork_cnt(0), send_buf_full(false)
 {
   recv_buf = new char[recv_buf_len];
   rd_watch = new FdWatch;
@@ -213,9 +250,16 @@ void TcpConnection::setRecvBufLen(size_t recv_buf_len)
 } /* TcpConnection::setRecvBufLen */
 
 
+void TcpConnection::setSendQueueSize(size_t max_size)
+{
+  send_queue_max = max_size;
+} /* TcpConnection::setSendQueueSize */
+
+
 void TcpConnection::disconnect(void)
 {
   recv_buf_cnt = 0;
+  clearSendQueue();
   
   wr_watch->setEnabled(false);
   rd_watch->setEnabled(false);
@@ -231,27 +275,104 @@ void TcpConnection::disconnect(void)
 int TcpConnection::write(const void *buf, int count)
 {
   assert(sock != -1);
-  int cnt = ::send(sock, buf, count, MSG_NOSIGNAL);
-  if (cnt < 0)
+
+  if ((send_queue_max == 0) && (send_cork_cnt == 0) && send_queue.empty())
   {
-    if (errno != EAGAIN)
+    int cnt = ::send(sock, buf, count, MSG_NOSIGNAL);
+    if (cnt < 0)
+    {
+      if (errno != EAGAIN)
+      {
+        return -1;
+      }
+      cnt = 0;
+    }
+
+    if (cnt < count)
     {
-      return -1;
+      send_buf_full = true;
+      sendBufferFull(true);
+      wr_watch->setEnabled(true);
+    }
+
+    return cnt;
+  }
+
+  if ((send_queue_max > 0) &&
+      (send_queue_bytes + count > send_queue_max))
+  {
+    if (!send_buf_full)
+    {
+      send_buf_full = true;
+      sendBufferFull(true);
+    }
+    return 0;
+  }
+
+  const char *ptr = static_cast<const char *>(buf);
+  int cnt = 0;
+  if ((send_cork_cnt == 0) && send_queue.empty())
+  {
+    cnt = ::send(sock, ptr, count, MSG_NOSIGNAL);
+    if (cnt < 0)
+    {
+      if (errno != EAGAIN)
+      {
+        return -1;
+      }
+      cnt = 0;
     }
-    cnt = 0;
   }
 
   if (cnt < count)
   {
-    sendBufferFull(true);
-    wr_watch->setEnabled(true);
+    queueData(ptr + cnt, count - cnt);
+    if (send_cork_cnt == 0)
+    {
+      wr_watch->setEnabled(true);
+    }
   }
-  
-  return cnt;
+
+  return count;
   
 } /* TcpConnection::write */
 
 
+void TcpConnection::uncork(void)
+{
+  if ((send_cork_cnt == 0) || (--send_cork_cnt > 0))
+  {
+    return;
+  }
+
+  if ((sock != -1) && !send_queue.empty())
+  {
+      // On failure, the error is reported by the write handler
+    if (!flushSendQueue() || !send_queue.empty())
+    {
+      wr_watch->setEnabled(true);
+    }
+  }
+} /* TcpConnection::uncork */
+
+
+long TcpConnection::roundTripTime(void) const
+{
+#ifdef TCP_INFO
+  if (sock != -1)
+  {
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &len) == 0)
+    {
+      return info.tcpi_rtt;
+    }
+  }
+#endif
+  return -1;
+} /* TcpConnection::roundTripTime */
+
+
 
 /****************************************************************************
  *
@@ -387,11 +508,167 @@ void TcpConnection::recvHandler(FdWatch *watch)
 
 void TcpConnection::writeHandler(FdWatch *watch)
 {
+  if (!send_queue.empty())
+  {
+    if (!flushSendQueue())
+    {
+      int errno_tmp = errno;
+      disconnect();
+      errno = errno_tmp;
+      onDisconnected(DR_SYSTEM_ERROR);
+      return;
+    }
+    if (send_buf_full && (send_queue_bytes <= send_queue_max / 2))
+    {
+      send_buf_full = false;
+      sendBufferFull(false);
+    }
+    if (!send_queue.empty())
+    {
+      return;
+    }
+  }
+
   watch->setEnabled(false);
-  sendBufferFull(false);
+  if (send_buf_full || (send_queue_max == 0))
+  {
+    send_buf_full = false;
+    sendBufferFull(false);
+  }
 } /* TcpConnection::writeHandler */
 
 
+void TcpConnection::queueData(const char *buf, size_t count)
+{
+  send_queue_bytes += count;
+  while (count > 0)
+  {
+    if (send_queue.empty() || (send_queue.back()->tail == SEND_CHUNK_SIZE))
+    {
+      send_queue.push_back(allocChunk());
+    }
+    SendChunk *chunk = send_queue.back();
+    size_t len = min(count, SEND_CHUNK_SIZE - chunk->tail);
+    memcpy(chunk->data + chunk->tail, buf, len);
+    chunk->tail += len;
+    buf += len;
+    count -= len;
+  }
+} /* TcpConnection::queueData */
+
+
+/*
+ *----------------------------------------------------------------------------
+ * Method:    TcpConnection::flushSendQueue
+ * Purpose:   Write as much as possible of the send queue to the socket.
+ *            Chunks are gathered into one sendmsg call, which works like
+ *            writev but makes it possible to use MSG_NOSIGNAL.
+ * Input:     None
+ * Output:    Returns \em false on write error, with errno set
+ * Author:    
+ * Created:   
+ * Remarks:   
+ * Bugs:      
+ *----------------------------------------------------------------------------
+ */
+bool TcpConnection::flushSendQueue(void)
+{
+  while (!send_queue.empty())
+  {
+    struct iovec iov[SEND_MAX_IOV];
+    int iovcnt = 0;
+    size_t total = 0;
+    for (SendQueue::const_iterator it = send_queue.begin();
+         (it != send_queue.end()) && (iovcnt < SEND_MAX_IOV); ++it)
+    {
+      iov[iovcnt].iov_base = (*it)->data + (*it)->head;
+      iov[iovcnt].iov_len = (*it)->tail - (*it)->head;
+      total += iov[iovcnt].iov_len;
+      ++iovcnt;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    ssize_t cnt = ::sendmsg(sock, &msg, MSG_NOSIGNAL);
+    if (cnt < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return (errno == EAGAIN);
+    }
+
+    send_queue_bytes -= cnt;
+    size_t left = cnt;
+    while (left > 0)
+    {
+      SendChunk *chunk = send_queue.front();
+      size_t len = min(left, chunk->tail - chunk->head);
+      chunk->head += len;
+      left -= len;
+      if (chunk->head == chunk->tail)
+      {
+        send_queue.pop_front();
+        freeChunk(chunk);
+      }
+    }
+
+    if (static_cast<size_t>(cnt) < total)
+    {
+      break;
+    }
+  }
+
+  return true;
+
+} /* TcpConnection::flushSendQueue */
+
+
+void TcpConnection::clearSendQueue(void)
+{
+  while (!send_queue.empty())
+  {
+    freeChunk(send_queue.front());
+    send_queue.pop_front();
+  }
+  send_queue_bytes = 0;
+  send_buf_full = false;
+} /* TcpConnection::clearSendQueue */
+
+
+TcpConnection::SendChunk *TcpConnection::allocChunk(void)
+{
+  SendChunk *chunk;
+  if (chunk_pool.empty())
+  {
+    chunk = new SendChunk;
+  }
+  else
+  {
+    chunk = chunk_pool.back();
+    chunk_pool.pop_back();
+  }
+  chunk->head = chunk->tail = 0;
+  return chunk;
+} /* TcpConnection::allocChunk */
+
+
+void TcpConnection::freeChunk(SendChunk *chunk)
+{
+  if (chunk_pool.size() < SEND_CHUNK_POOL_MAX)
+  {
+    chunk_pool.push_back(chunk);
+  }
+  else
+  {
+    delete chunk;
+  }
+} /* TcpConnection::freeChunk */
+
+
 
 /*
  * This file has not been truncated
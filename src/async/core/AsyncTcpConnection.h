@@ -43,6 +43,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <stdint.h>
 
 #include <string>
+#include <deque>
 
 
 /****************************************************************************
@@ -195,6 +196,65 @@ class TcpConnection : public sigc::trackable
      * @return	Returns the number of bytes written or -1 on failure
      */
     virtual int write(const void *buf, int count);
+
+    /**
+     * @brief   Enable the user space send queue
+     * @param   max_size The maximum number of bytes to queue (0=disable)
+     *
+     * By default, data that cannot be written to the kernel send buffer
+     * straight away is not accepted by the write function, which will return
+     * a short count. When the send queue is enabled, data that does not fit
+     * in the kernel buffer is instead stored in a queue of pooled memory
+     * chunks and is written to the socket when it becomes writable again.
+     * Queued data is written in as few system calls as possible, coalescing
+     * many small writes into one.
+     * When the send queue is enabled, the write function will either accept
+     * all data or, if the queue would grow larger than max_size bytes, no
+     * data at all. In the latter case zero is returned and the sendBufferFull
+     * signal is emitted. The sendBufferFull(false) signal is emitted when the
+     * queue has been drained to half its maximum size.
+     */
+    void setSendQueueSize(size_t max_size);
+
+    /**
+     * @brief   Get the maximum size of the user space send queue
+     * @return  Returns the maximum queue size in bytes (0=disabled)
+     */
+    size_t sendQueueSize(void) const { return send_queue_max; }
+
+    /**
+     * @brief   Get the number of bytes waiting in the send queue
+     * @return  Returns the number of bytes not yet written to the socket
+     */
+    size_t sendQueueBytes(void) const { return send_queue_bytes; }
+
+    /**
+     * @brief   Hold back written data until uncork is called
+     *
+     * Use this function before writing a number of small messages that
+     * belong together, like all messages produced for one audio block. All
+     * data written while corked is put in the send queue and is then sent
+     * using a single system call when uncork is called. Calls to cork may be
+     * nested. Each call to cork must be matched by a call to uncork.
+     * If the send queue has not been enabled using setSendQueueSize, the
+     * amount of data that can be stored while corked is unbounded.
+     */
+    void cork(void) { ++send_cork_cnt; }
+
+    /**
+     * @brief   Send data held back by cork
+     *
+     * When the last nested cork has been matched by a call to this function,
+     * all queued data is written to the socket. Write errors are reported
+     * through the disconnected signal.
+     */
+    void uncork(void);
+
+    /**
+     * @brief   Check if the connection is corked
+     * @return  Returns \em true if the connection is corked
+     */
+    bool isCorked(void) const { return send_cork_cnt > 0; }
     
     /**
      * @brief 	Return the IP-address of the remote host
@@ -225,6 +285,13 @@ class TcpConnection : public sigc::trackable
      * NOTE: This function is overridden in Async::TcpClient.
      */
     bool isIdle(void) const { return sock == -1; }
+
+    /**
+     * @brief   Get the round trip time estimated by the kernel
+     * @return  Returns the smoothed round trip time in microseconds or -1 if
+     *          not connected or not supported by the operating system
+     */
+    long roundTripTime(void) const;
     
     /**
      * @brief 	A signal that is emitted when a connection has been terminated
@@ -325,6 +392,12 @@ class TcpConnection : public sigc::trackable
   private:
     friend class TcpClientBase;
 
+    struct SendChunk;
+    class SendChunkPool;
+    typedef std::deque<SendChunk*> SendQueue;
+
+    static SendChunkPool chunk_pool;
+
     IpAddress remote_addr;
     uint16_t  remote_port;
     size_t    recv_buf_len;
@@ -333,9 +406,19 @@ class TcpConnection : public sigc::trackable
     FdWatch * wr_watch;
     char *    recv_buf;
     size_t    recv_buf_cnt;
+    SendQueue send_queue;
+    size_t    send_queue_max;
+    size_t    send_queue_bytes;
+    unsigned  send_cork_cnt;
+    bool      send_buf_full;
     
     void recvHandler(FdWatch *watch);
     void writeHandler(FdWatch *watch);
+    void queueData(const char *buf, size_t count);
+    bool flushSendQueue(void);
+    void clearSendQueue(void);
+    static SendChunk *allocChunk(void);
+    static void freeChunk(SendChunk *chunk);
 
 };  /* class TcpConnection */
 
@@ -0,0 +1,397 @@
+/**
+ * @file    AsyncSimApplication.cpp
+ * @brief   An application class that run timers in simulated time
+ * @author  Tobias Blomberg
+ * @date    2017-11-26
+ *
+ * This file contains the SimApplication class which can be used instead of
+ * the CppApplication class to run an Async application faster than real
+ * time, e.g. when replaying recorded audio through a signal processing chain.
+ *
+ * \verbatim
+ * Async - A library for programming event driven applications
+ * Copyright (C) 2003-2017  Tobias Blomberg
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * \endverbatim
+ */
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/select.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <cassert>
+
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "AsyncCppDnsLookupWorker.h"
+#include "AsyncFdWatch.h"
+#include "AsyncTimer.h"
+#include "AsyncSimApplication.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+# define clock_timeradd(a, b, result)                                         \
+  do {                                                                        \
+    (result)->tv_sec = (a)->tv_sec + (b)->tv_sec;                             \
+    (result)->tv_nsec = (a)->tv_nsec + (b)->tv_nsec;                          \
+    if ((result)->tv_nsec >= 1000000000)                                      \
+      {                                                                       \
+        ++(result)->tv_sec;                                                   \
+        (result)->tv_nsec -= 1000000000;                                      \
+      }                                                                       \
+  } while (0)
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+SimApplication::SimApplication(void)
+  : do_quit(false)
+{
+  FD_ZERO(&rd_set);
+  FD_ZERO(&wr_set);
+  sim_time.tv_sec = 0;
+  sim_time.tv_nsec = 0;
+} /* SimApplication::SimApplication */
+
+
+SimApplication::~SimApplication(void)
+{
+
+} /* SimApplication::~SimApplication */
+
+
+void SimApplication::exec(void)
+{
+  do_quit = false;
+  while (!do_quit)
+  {
+    if (hasFdWatches())
+    {
+      handleFdWatches(false);
+      if (do_quit)
+      {
+        break;
+      }
+    }
+
+    TimerMap::iterator titer = timer_map.begin();
+    while ((titer != timer_map.end()) && (titer->second == 0))
+    {
+      timer_map.erase(titer);
+      titer = timer_map.begin();
+    }
+
+    if (titer == timer_map.end())
+    {
+        // No timers left. Only file descriptor activity can make something
+        // happen now so wait for that, in real time. If there are no watches
+        // either, the application is dead.
+      if (!hasFdWatches())
+      {
+        break;
+      }
+      handleFdWatches(true);
+      continue;
+    }
+
+      // Advance the virtual clock to the expiration time of the timer
+    if (lttimespec()(sim_time, titer->first))
+    {
+      sim_time = titer->first;
+    }
+
+    titer->second->expired(titer->second);
+    if ((titer->second != 0) &&
+        (titer->second->type() == Timer::TYPE_PERIODIC))
+    {
+      addTimerP(titer->second, titer->first);
+    }
+    timer_map.erase(titer);
+  }
+} /* SimApplication::exec */
+
+
+void SimApplication::quit(void)
+{
+  do_quit = true;
+} /* SimApplication::quit */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void SimApplication::addFdWatch(FdWatch *fd_watch)
+{
+  int fd = fd_watch->fd();
+  WatchMap *watch_map = 0;
+  switch (fd_watch->type())
+  {
+    case FdWatch::FD_WATCH_RD:
+      FD_SET(fd, &rd_set);
+      watch_map = &rd_watch_map;
+      break;
+
+    case FdWatch::FD_WATCH_WR:
+      FD_SET(fd, &wr_set);
+      watch_map = &wr_watch_map;
+      break;
+  }
+  assert(watch_map != 0);
+
+  WatchMap::iterator iter = watch_map->find(fd);
+  assert((iter == watch_map->end()) || (iter->second == 0));
+
+  (*watch_map)[fd] = fd_watch;
+} /* SimApplication::addFdWatch */
+
+
+void SimApplication::delFdWatch(FdWatch *fd_watch)
+{
+  int fd = fd_watch->fd();
+  WatchMap *watch_map = 0;
+  switch (fd_watch->type())
+  {
+    case FdWatch::FD_WATCH_RD:
+      FD_CLR(fd, &rd_set);
+      watch_map = &rd_watch_map;
+      break;
+
+    case FdWatch::FD_WATCH_WR:
+      FD_CLR(fd, &wr_set);
+      watch_map = &wr_watch_map;
+      break;
+  }
+  assert(watch_map != 0);
+
+  WatchMap::iterator iter = watch_map->find(fd);
+  assert((iter != watch_map->end()) && (iter->second != 0));
+  iter->second = 0;
+} /* SimApplication::delFdWatch */
+
+
+void SimApplication::addTimer(Timer *timer)
+{
+  addTimerP(timer, sim_time);
+} /* SimApplication::addTimer */
+
+
+void SimApplication::addTimerP(Timer *timer, const struct timespec& current)
+{
+  struct timespec add;
+  struct timespec expiration;
+  int timeout = timer->timeout();
+  add.tv_sec = timeout / 1000;
+  timeout -= add.tv_sec * 1000;
+  add.tv_nsec = timeout * 1000000;
+  clock_timeradd(&current, &add, &expiration);
+
+  timer_map.insert(pair<struct timespec, Timer *>(expiration, timer));
+} /* SimApplication::addTimerP */
+
+
+void SimApplication::delTimer(Timer *timer)
+{
+  TimerMap::iterator iter;
+  for (iter=timer_map.begin(); iter!=timer_map.end(); ++iter)
+  {
+    if (iter->second == timer)
+    {
+      iter->second = 0;
+      break;
+    }
+  }
+} /* SimApplication::delTimer */
+
+
+DnsLookupWorker *SimApplication::newDnsLookupWorker(const string& label)
+{
+  return new CppDnsLookupWorker(label);
+} /* SimApplication::newDnsLookupWorker */
+
+
+bool SimApplication::hasFdWatches(void) const
+{
+  WatchMap::const_iterator it;
+  for (it=rd_watch_map.begin(); it!=rd_watch_map.end(); ++it)
+  {
+    if (it->second != 0)
+    {
+      return true;
+    }
+  }
+  for (it=wr_watch_map.begin(); it!=wr_watch_map.end(); ++it)
+  {
+    if (it->second != 0)
+    {
+      return true;
+    }
+  }
+  return false;
+} /* SimApplication::hasFdWatches */
+
+
+void SimApplication::handleFdWatches(bool wait)
+{
+  int max_desc = 0;
+  if (!rd_watch_map.empty())
+  {
+    max_desc = rd_watch_map.rbegin()->first + 1;
+  }
+  if (!wr_watch_map.empty() && (wr_watch_map.rbegin()->first >= max_desc))
+  {
+    max_desc = wr_watch_map.rbegin()->first + 1;
+  }
+
+  struct timespec zero_timeout;
+  zero_timeout.tv_sec = 0;
+  zero_timeout.tv_nsec = 0;
+  fd_set local_rd_set = rd_set;
+  fd_set local_wr_set = wr_set;
+  int dcnt = pselect(max_desc, &local_rd_set, &local_wr_set, NULL,
+                     wait ? NULL : &zero_timeout, NULL);
+  if (dcnt == -1)
+  {
+    if (errno == EINTR)
+    {
+      return;
+    }
+    perror("pselect");
+    exit(1);
+  }
+  if (dcnt == 0)
+  {
+    return;
+  }
+
+  dispatchFdWatches(rd_watch_map, local_rd_set);
+  dispatchFdWatches(wr_watch_map, local_wr_set);
+} /* SimApplication::handleFdWatches */
+
+
+void SimApplication::dispatchFdWatches(WatchMap& watch_map,
+                                       fd_set& active_set)
+{
+  WatchMap::iterator witer = watch_map.begin();
+  while (witer != watch_map.end())
+  {
+    WatchMap::iterator next_witer = witer;
+    ++next_witer;
+    if (witer->second == 0)
+    {
+      watch_map.erase(witer);
+    }
+    else if (FD_ISSET(witer->first, &active_set))
+    {
+      witer->second->activity(witer->second);
+    }
+    witer = next_witer;
+  }
+} /* SimApplication::dispatchFdWatches */
+
+
+
+/*
+ * This file has not been truncated
+ */
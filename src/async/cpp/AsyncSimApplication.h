@@ -0,0 +1,222 @@
+/**
+ * @file    AsyncSimApplication.h
+ * @brief   An application class that run timers in simulated time
+ * @author  Tobias Blomberg
+ * @date    2017-11-26
+ *
+ * This file contains the SimApplication class which can be used instead of
+ * the CppApplication class to run an Async application faster than real
+ * time, e.g. when replaying recorded audio through a signal processing chain.
+ *
+ * \verbatim
+ * Async - A library for programming event driven applications
+ * Copyright (C) 2003-2017  Tobias Blomberg
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ * \endverbatim
+ */
+
+
+#ifndef ASYNC_SIM_APPLICATION_INCLUDED
+#define ASYNC_SIM_APPLICATION_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sys/types.h>
+#include <sys/select.h>
+#include <time.h>
+
+#include <map>
+#include <utility>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncApplication.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief  An application class that run timers in simulated time
+@author Tobias Blomberg
+@date   2017-11-26
+
+This application class has a virtual clock. Instead of sleeping until the
+next timer expire, the virtual clock is advanced directly to the expiration
+time of the next timer. An application driven by timers, like one reading
+audio from a file using the "file" audio device, will then run as fast as
+the CPU allow. Since the order of events only depend on the timer settings,
+a run is fully reproducible which make this class suitable for regression
+testing.
+
+File descriptor watches are still supported. They are polled, without
+waiting, between each timer expiration. When there are no timers left the
+application will wait for file descriptor activity in real time. If there
+are no file descriptor watches either, the exec function return since
+nothing can ever happen again.
+
+Note that only Async::Timer objects are affected by the virtual clock.
+Code that read the system clock directly, like Async::AtTimer, will see the
+real time.
+*/
+class SimApplication : public Application
+{
+  public:
+    /**
+     * @brief Constructor
+     */
+    SimApplication(void);
+
+    /**
+     * @brief Destructor
+     */
+    ~SimApplication(void);
+
+    /**
+     * @brief Execute the application main loop
+     *
+     * When this member function is called the application core will enter the
+     * main loop. It will not exit from this loop until the
+     * Async::Application::quit method is called or there is nothing more
+     * to wait for.
+     */
+    void exec(void);
+
+    /**
+     * @brief Exit the application main loop
+     *
+     * This function should be called to exit the application core main loop.
+     */
+    void quit(void);
+
+    /**
+     * @brief   Get the current simulated time
+     * @return  Returns the time elapsed on the virtual clock
+     *
+     * The virtual clock start at zero when the application object is created.
+     */
+    const struct timespec& simTime(void) const { return sim_time; }
+
+    /**
+     * @brief   Get the current simulated time in milliseconds
+     * @return  Returns the number of milliseconds on the virtual clock
+     */
+    unsigned long long simTimeMs(void) const
+    {
+      return 1000ULL * sim_time.tv_sec + sim_time.tv_nsec / 1000000;
+    }
+
+  protected:
+
+  private:
+    struct lttimespec
+    {
+      bool operator()(const struct timespec& t1, const struct timespec& t2) const
+      {
+        return ((t1.tv_sec == t2.tv_sec)
+                ? (t1.tv_nsec < t2.tv_nsec)
+                : (t1.tv_sec < t2.tv_sec));
+      }
+    };
+    typedef std::map<int, FdWatch*>                             WatchMap;
+    typedef std::multimap<struct timespec, Timer *, lttimespec> TimerMap;
+
+    bool                do_quit;
+    fd_set              rd_set;
+    fd_set              wr_set;
+    WatchMap            rd_watch_map;
+    WatchMap            wr_watch_map;
+    TimerMap            timer_map;
+    struct timespec     sim_time;
+
+    SimApplication(const SimApplication&);
+    SimApplication& operator=(const SimApplication&);
+    void addFdWatch(FdWatch *fd_watch);
+    void delFdWatch(FdWatch *fd_watch);
+    void addTimer(Timer *timer);
+    void addTimerP(Timer *timer, const struct timespec& current);
+    void delTimer(Timer *timer);
+    DnsLookupWorker *newDnsLookupWorker(const std::string& label);
+    bool hasFdWatches(void) const;
+    void handleFdWatches(bool wait);
+    void dispatchFdWatches(WatchMap& watch_map, fd_set& active_set);
+
+};  /* class SimApplication */
+
+
+} /* namespace */
+
+#endif /* ASYNC_SIM_APPLICATION_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,263 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <unistd.h>
+
+#include <AsyncAudioAdaptiveJitterFifo.h>
+#include <AsyncAudioSink.h>
+
+using namespace std;
+using namespace Async;
+
+
+/*
+ * Replay a packet trace through an adaptive jitter buffer running on a
+ * simulated clock. The trace file contain one line per packet with the
+ * arrival time in milliseconds and, optionally, the number of samples in
+ * the packet. Lines starting with # are ignored.
+ *
+ *   0.0    320
+ *   21.7   320
+ *   39.2   320
+ *
+ * If no trace file is given, a trace with random network jitter is
+ * generated. Use -p to generate a trace for a perfect network without
+ * any jitter.
+ *
+ * Each packet is written to the jitter buffer in the given number of frames
+ * (-f) at the same time, the way a decoder write one codec frame at a time.
+ * E.g. an EchoLink GSM packet hold four frames.
+ *
+ * Usage: AsyncAudioAdaptiveJitterFifo_demo [-p] [-f frames] [trace file]
+ */
+
+static const unsigned SAMPLE_RATE = 16000;
+static const unsigned PACKET_SAMPLES = 320;
+
+
+class SimulatedJitterFifo : public AudioAdaptiveJitterFifo
+{
+  public:
+    SimulatedJitterFifo(unsigned min_delay_ms, unsigned max_delay_ms)
+      : AudioAdaptiveJitterFifo(min_delay_ms, max_delay_ms, SAMPLE_RATE),
+        now_ms(0.0)
+    {
+      setPlayoutTimerEnabled(false);
+    }
+
+    void setTime(double ms) { now_ms = ms; }
+
+  protected:
+    virtual void getTime(struct timeval &tv)
+    {
+      tv.tv_sec = static_cast<time_t>(now_ms / 1000.0);
+      tv.tv_usec = static_cast<suseconds_t>(
+          (now_ms - tv.tv_sec * 1000.0) * 1000.0);
+    }
+
+  private:
+    double now_ms;
+};
+
+
+class SampleCounter : public AudioSink
+{
+  public:
+    SampleCounter(void) : samples(0) {}
+
+    virtual int writeSamples(const float *samples, int count)
+    {
+      this->samples += count;
+      return count;
+    }
+
+    virtual void flushSamples(void)
+    {
+      sourceAllSamplesFlushed();
+    }
+
+    unsigned long samples;
+};
+
+
+struct Packet
+{
+  double    arrival;
+  unsigned  samples;
+};
+
+
+static void generateTrace(vector<Packet> &trace, bool perfect)
+{
+  srand(4711);
+  double send_time = 0.0;
+  for (int i=0; i<1500; ++i)
+  {
+    double delay = 40.0;
+    if (!perfect)
+    {
+      delay -= 10.0 * log(1.0 - rand() / (RAND_MAX + 1.0));
+      if (rand() % 200 == 0)
+      {
+        delay += 150.0;
+      }
+    }
+    Packet p;
+    p.arrival = send_time + delay;
+    p.samples = PACKET_SAMPLES;
+    trace.push_back(p);
+    send_time += 1000.0 * PACKET_SAMPLES / SAMPLE_RATE;
+  }
+}
+
+
+static bool readTrace(const char *filename, vector<Packet> &trace)
+{
+  ifstream file(filename);
+  if (!file)
+  {
+    return false;
+  }
+  string line;
+  while (getline(file, line))
+  {
+    if (line.empty() || (line[0] == '#'))
+    {
+      continue;
+    }
+    istringstream ss(line);
+    Packet p;
+    p.samples = PACKET_SAMPLES;
+    if (!(ss >> p.arrival))
+    {
+      continue;
+    }
+    ss >> p.samples;
+    trace.push_back(p);
+  }
+  return true;
+}
+
+
+static void printStats(double t, const AudioAdaptiveJitterFifo &fifo)
+{
+  AudioAdaptiveJitterFifo::Statistics stats = fifo.statistics();
+  cout << "t=" << static_cast<unsigned>(t) << "ms"
+       << " depth=" << stats.depth_ms << "ms"
+       << " target=" << stats.target_delay_ms << "ms"
+       << " jitter=" << stats.jitter_ms << "ms"
+       << " late=" << stats.late_packets
+       << " underruns=" << stats.underruns
+       << " compress=" << stats.compressions
+       << " expand=" << stats.expansions << endl;
+}
+
+
+int main(int argc, char **argv)
+{
+  bool perfect = false;
+  unsigned frames = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, "pf:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'p':
+        perfect = true;
+        break;
+      case 'f':
+        frames = atoi(optarg);
+        break;
+      default:
+        cerr << "Usage: AsyncAudioAdaptiveJitterFifo_demo [-p] [-f frames] "
+                "[trace file]\n";
+        exit(1);
+    }
+  }
+  if (frames == 0)
+  {
+    frames = 1;
+  }
+
+  vector<Packet> trace;
+  if (optind < argc)
+  {
+    if (!readTrace(argv[optind], trace))
+    {
+      cerr << "*** ERROR: Could not read trace file " << argv[optind] << endl;
+      exit(1);
+    }
+  }
+  else
+  {
+    generateTrace(trace, perfect);
+  }
+  if (trace.empty())
+  {
+    cerr << "*** ERROR: Empty packet trace\n";
+    exit(1);
+  }
+
+  SimulatedJitterFifo fifo(20, 500);
+  SampleCounter sink;
+  fifo.registerSink(&sink);
+
+  vector<float> samples;
+  unsigned long samples_written = 0;
+  vector<Packet>::const_iterator it = trace.begin();
+  double end_time = trace.back().arrival + 1000.0;
+  for (double t=0.0; t<end_time; t+=1.0)
+  {
+    fifo.setTime(t);
+    while ((it != trace.end()) && (it->arrival <= t))
+    {
+      samples.resize(it->samples);
+      for (unsigned i=0; i<it->samples; ++i)
+      {
+        samples[i] = 0.5 * sin(2.0 * M_PI * 220.0 *
+                               (samples_written + i) / SAMPLE_RATE);
+      }
+        // Write the packet one frame at a time
+      unsigned pos = 0;
+      for (unsigned f=0; f<frames; ++f)
+      {
+        unsigned end = (f + 1) * samples.size() / frames;
+        if (end > pos)
+        {
+          fifo.writeSamples(&samples[pos], end - pos);
+          pos = end;
+        }
+      }
+      samples_written += samples.size();
+      if (++it == trace.end())
+      {
+        fifo.flushSamples();
+      }
+    }
+    if (static_cast<unsigned>(t) % 10 == 0)
+    {
+      fifo.playout();
+    }
+    if (static_cast<unsigned>(t) % 1000 == 0)
+    {
+      printStats(t, fifo);
+    }
+  }
+
+  AudioAdaptiveJitterFifo::Statistics stats = fifo.statistics();
+  cout << "\nPackets:           " << stats.packets << endl;
+  cout << "Late packets:      " << stats.late_packets << endl;
+  cout << "Underruns:         " << stats.underruns << endl;
+  cout << "Discarded samples: " << stats.discarded_samples << endl;
+  cout << "Compressions:      " << stats.compressions << endl;
+  cout << "Expansions:        " << stats.expansions << endl;
+  cout << "Max depth:         " << stats.max_depth_ms << "ms" << endl;
+  cout << "Samples in/out:    " << samples_written << "/"
+       << sink.samples << endl;
+
+  return 0;
+}
+
@@ -0,0 +1,193 @@
+#include <sys/time.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+
+#include <AsyncCppApplication.h>
+#include <AsyncAudioEncoder.h>
+#include <AsyncAudioEncoderThreaded.h>
+#include <AsyncAudioCodecPool.h>
+
+using namespace std;
+using namespace Async;
+
+
+/*
+ * Encode a number of audio streams, first in the main thread and then using
+ * a codec worker pool. The time spent in the main thread and the total time
+ * is printed for both cases. The encoded output from the pool is also checked
+ * to be identical to the output from the main thread.
+ *
+ *   AsyncAudioCodecPool_demo [codec [streams [threads]]]
+ */
+
+static const int SIGNAL_LENGTH = 10 * INTERNAL_SAMPLE_RATE;
+static const int BLOCK_SIZE = INTERNAL_SAMPLE_RATE / 50;
+
+
+class Stream : public sigc::trackable
+{
+  public:
+    AudioEncoder                  *enc;
+    vector<vector<unsigned char> > packets;
+    bool                          flushed;
+
+    Stream(AudioEncoder *enc) : enc(enc), flushed(false)
+    {
+      enc->writeEncodedSamples.connect(mem_fun(*this, &Stream::write));
+      enc->flushEncodedSamples.connect(mem_fun(*this, &Stream::flush));
+    }
+
+    ~Stream(void) { delete enc; }
+
+    void write(const void *buf, int size)
+    {
+      const unsigned char *ptr = reinterpret_cast<const unsigned char *>(buf);
+      packets.push_back(vector<unsigned char>(ptr, ptr + size));
+    }
+
+    void flush(void)
+    {
+      flushed = true;
+      enc->allEncodedSamplesFlushed();
+      if ((--active == 0) && in_loop)
+      {
+        Application::app().quit();
+      }
+    }
+
+    static int  active;
+    static bool in_loop;
+};
+
+int Stream::active = 0;
+bool Stream::in_loop = false;
+
+
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+static void makeSignal(vector<float>& sig)
+{
+  sig.resize(SIGNAL_LENGTH);
+  double phase = 0.0;
+  for (int i=0; i<SIGNAL_LENGTH; ++i)
+  {
+    double t = static_cast<double>(i) / INTERNAL_SAMPLE_RATE;
+    phase += 2.0 * M_PI * (300.0 + 200.0 * sin(2.0 * M_PI * 0.5 * t)) /
+             INTERNAL_SAMPLE_RATE;
+    sig[i] = static_cast<float>(0.3 * sin(phase) +
+                                0.05 * (rand() / (RAND_MAX + 1.0) - 0.5));
+  }
+}
+
+
+static double run(const string& codec, int stream_cnt, AudioCodecPool *pool,
+                  const vector<float>& sig, vector<Stream*>& streams,
+                  double& main_time)
+{
+  for (int i=0; i<stream_cnt; ++i)
+  {
+    AudioEncoder *enc = AudioEncoder::create(codec);
+    if (pool != 0)
+    {
+      enc = new AudioEncoderThreaded(enc, pool);
+    }
+    streams.push_back(new Stream(enc));
+  }
+  Stream::active = stream_cnt;
+
+  double start = now();
+  for (int pos=0; pos<SIGNAL_LENGTH; pos+=BLOCK_SIZE)
+  {
+    for (int i=0; i<stream_cnt; ++i)
+    {
+      streams[i]->enc->writeSamples(&sig[pos], BLOCK_SIZE);
+    }
+  }
+  for (int i=0; i<stream_cnt; ++i)
+  {
+    streams[i]->enc->flushSamples();
+  }
+  main_time = now() - start;
+    // Application::quit can only be called once so only run the event loop
+    // if there are streams left to flush
+  if (Stream::active > 0)
+  {
+    Stream::in_loop = true;
+    Application::app().exec();
+    Stream::in_loop = false;
+  }
+  return now() - start;
+}
+
+
+int main(int argc, char **argv)
+{
+  CppApplication app;
+
+  string codec = (argc > 1) ? argv[1] : "OPUS";
+  int stream_cnt = (argc > 2) ? atoi(argv[2]) : 8;
+  int thread_cnt = (argc > 3) ? atoi(argv[3]) : 4;
+  if (!AudioEncoder::isAvailable(codec) || (stream_cnt <= 0) ||
+      (thread_cnt <= 0))
+  {
+    cerr << "Usage: AsyncAudioCodecPool_demo [codec [streams [threads]]]\n";
+    return 1;
+  }
+
+  vector<float> sig;
+  makeSignal(sig);
+
+  vector<Stream*> sync_streams;
+  double sync_main;
+  double sync_total = run(codec, stream_cnt, 0, sig, sync_streams, sync_main);
+
+  AudioCodecPool pool(thread_cnt);
+  vector<Stream*> pool_streams;
+  double pool_main;
+  double pool_total = run(codec, stream_cnt, &pool, sig, pool_streams,
+                          pool_main);
+
+  int mismatch_cnt = 0;
+  for (int i=0; i<stream_cnt; ++i)
+  {
+    if ((sync_streams[i]->packets != pool_streams[i]->packets) ||
+        !pool_streams[i]->flushed)
+    {
+      ++mismatch_cnt;
+    }
+    delete sync_streams[i];
+    delete pool_streams[i];
+  }
+
+  cout << "Encoded " << stream_cnt << " streams of "
+       << (SIGNAL_LENGTH / INTERNAL_SAMPLE_RATE) << "s " << codec
+       << " audio\n";
+  cout << fixed << setprecision(1);
+  cout << setw(16) << left << "Main thread:" << right
+       << setw(8) << (1000.0 * sync_main) << "ms main thread, "
+       << setw(8) << (1000.0 * sync_total) << "ms total\n";
+  cout << setw(16) << left << "Codec pool:" << right
+       << setw(8) << (1000.0 * pool_main) << "ms main thread, "
+       << setw(8) << (1000.0 * pool_total) << "ms total ("
+       << pool.threadCount() << " threads)\n";
+  if (mismatch_cnt > 0)
+  {
+    cout << "*** ERROR: The output differ for " << mismatch_cnt
+         << " streams\n";
+    return 1;
+  }
+  cout << "The output from the pool is identical\n";
+
+  return 0;
+}
@@ -0,0 +1,245 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+
+#include <AsyncAudioEncoder.h>
+#include <AsyncAudioDecoder.h>
+#include <AsyncAudioSink.h>
+
+using namespace std;
+using namespace Async;
+
+
+/*
+ * Simulate packet loss on an encoded audio stream and measure how well the
+ * decoder packet loss concealment work. A speech like test signal is encoded
+ * and then decoded three times: without loss, with lost packets replaced by
+ * silence and with lost packets reported to the decoder using
+ * AudioDecoder::packetsLost. The SNR, relative to the decoding without loss,
+ * is printed for each codec and loss rate. Losses occur in bursts of one to
+ * three packets. Opus is run with inband FEC enabled.
+ *
+ *   AsyncAudioDecoderPlc_demo [codec...]
+ */
+
+static const int SIGNAL_LENGTH = 20 * INTERNAL_SAMPLE_RATE;
+static const unsigned RANDOM_SEED = 4711;
+static const float loss_rates[] = { 0.01f, 0.02f, 0.05f, 0.1f, 0.2f };
+static const int loss_rate_cnt = sizeof(loss_rates) / sizeof(*loss_rates);
+
+
+class SampleCollector : public AudioSink
+{
+  public:
+    vector<float> samples;
+
+    virtual int writeSamples(const float *buf, int count)
+    {
+      samples.insert(samples.end(), buf, buf + count);
+      return count;
+    }
+
+    virtual void flushSamples(void) { sourceAllSamplesFlushed(); }
+};
+
+
+class PacketCollector : public sigc::trackable
+{
+  public:
+    vector<vector<unsigned char> > packets;
+
+    void write(const void *buf, int size)
+    {
+      const unsigned char *ptr = reinterpret_cast<const unsigned char *>(buf);
+      packets.push_back(vector<unsigned char>(ptr, ptr + size));
+    }
+};
+
+
+static void makeSignal(vector<float>& sig)
+{
+    // A vowel like harmonic series with a slowly varying pitch and syllable
+    // rate amplitude modulation
+  sig.resize(SIGNAL_LENGTH);
+  double phase = 0.0;
+  for (int i=0; i<SIGNAL_LENGTH; ++i)
+  {
+    double t = static_cast<double>(i) / INTERNAL_SAMPLE_RATE;
+    double f0 = 140.0 + 30.0 * sin(2.0 * M_PI * 0.7 * t);
+    phase += 2.0 * M_PI * f0 / INTERNAL_SAMPLE_RATE;
+    double s = 0.0;
+    for (int h=1; h<=12; ++h)
+    {
+      s += sin(h * phase) / h;
+    }
+    double env = 0.5 + 0.5 * sin(2.0 * M_PI * 4.0 * t);
+    sig[i] = static_cast<float>(0.2 * env * s);
+  }
+}
+
+
+static void makeLossPattern(vector<bool>& lost, size_t cnt, float rate)
+{
+  lost.assign(cnt, false);
+  size_t i = 1;
+  while (i < cnt - 1)
+  {
+    if (rand() < rate / 2.0f * RAND_MAX)
+    {
+      int burst = 1 + rand() % 3;
+      for (int j=0; (j<burst) && (i<cnt-1); ++j)
+      {
+        lost[i++] = true;
+      }
+    }
+    ++i;
+  }
+}
+
+
+static void decode(const string& codec, const PacketCollector& enc,
+                   const vector<bool>& lost, const vector<int>& ref_len,
+                   bool conceal, vector<float>& out)
+{
+  AudioDecoder *dec = AudioDecoder::create(codec);
+  SampleCollector sink;
+  dec->registerSink(&sink);
+  unsigned lost_cnt = 0;
+  for (size_t i=0; i<enc.packets.size(); ++i)
+  {
+    if (lost[i])
+    {
+      if (conceal)
+      {
+        ++lost_cnt;
+      }
+      else
+      {
+        sink.samples.insert(sink.samples.end(), ref_len[i], 0.0f);
+      }
+      continue;
+    }
+    if (lost_cnt > 0)
+    {
+      dec->packetsLost(lost_cnt);
+      lost_cnt = 0;
+    }
+    vector<unsigned char> packet(enc.packets[i]);
+    dec->writeEncodedSamples(&packet[0], packet.size());
+  }
+  dec->flushEncodedSamples();
+  dec->unregisterSink();
+  delete dec;
+  out.swap(sink.samples);
+}
+
+
+static double snr(const vector<float>& ref, const vector<float>& out)
+{
+  double sig = 0.0;
+  double noise = 0.0;
+  for (size_t i=0; i<ref.size(); ++i)
+  {
+    float o = (i < out.size()) ? out[i] : 0.0f;
+    sig += ref[i] * ref[i];
+    noise += (ref[i] - o) * (ref[i] - o);
+  }
+  return 10.0 * log10(sig / max(noise, 1e-12));
+}
+
+
+int main(int argc, char **argv)
+{
+  vector<string> codecs;
+  for (int i=1; i<argc; ++i)
+  {
+    codecs.push_back(argv[i]);
+  }
+  if (codecs.empty())
+  {
+    codecs.push_back("GSM");
+    codecs.push_back("SPEEX");
+    codecs.push_back("OPUS");
+  }
+
+  vector<float> sig;
+  makeSignal(sig);
+
+  cout << setw(8) << left << "Codec" << right << setw(8) << "Loss"
+       << setw(10) << "Lost" << setw(14) << "SNR silence"
+       << setw(14) << "SNR concealed" << endl;
+  for (size_t c=0; c<codecs.size(); ++c)
+  {
+    const string& codec = codecs[c];
+    if (!AudioEncoder::isAvailable(codec) || !AudioDecoder::isAvailable(codec))
+    {
+      cout << setw(8) << left << codec << right << "  not available\n";
+      continue;
+    }
+
+    AudioEncoder *enc = AudioEncoder::create(codec);
+    if (codec == "OPUS")
+    {
+      enc->setOption("FEC", "1");
+      enc->setOption("PACKET_LOSS", "10");
+    }
+    PacketCollector packets;
+    enc->writeEncodedSamples.connect(
+        mem_fun(packets, &PacketCollector::write));
+    enc->writeSamples(&sig[0], sig.size());
+    enc->flushSamples();
+    delete enc;
+
+      // Decode without loss to get the reference and the packet lengths
+    vector<bool> no_loss(packets.packets.size(), false);
+    vector<int> ref_len;
+    AudioDecoder *dec = AudioDecoder::create(codec);
+    SampleCollector ref;
+    dec->registerSink(&ref);
+    for (size_t i=0; i<packets.packets.size(); ++i)
+    {
+      size_t before = ref.samples.size();
+      vector<unsigned char> packet(packets.packets[i]);
+      dec->writeEncodedSamples(&packet[0], packet.size());
+      ref_len.push_back(ref.samples.size() - before);
+    }
+    dec->unregisterSink();
+    delete dec;
+
+    srand(RANDOM_SEED);
+    for (int r=0; r<loss_rate_cnt; ++r)
+    {
+      vector<bool> lost;
+      makeLossPattern(lost, packets.packets.size(), loss_rates[r]);
+      size_t lost_cnt = 0;
+      for (size_t i=0; i<lost.size(); ++i)
+      {
+        lost_cnt += lost[i] ? 1 : 0;
+      }
+      vector<float> silence;
+      vector<float> concealed;
+      decode(codec, packets, lost, ref_len, false, silence);
+      decode(codec, packets, lost, ref_len, true, concealed);
+      cout << setw(8) << left << codec << right
+           << setw(7) << fixed << setprecision(0)
+           << (100.0f * loss_rates[r]) << "%"
+           << setw(10) << lost_cnt
+           << setw(13) << setprecision(1) << snr(ref.samples, silence)
+           << "dB"
+           << setw(12) << snr(ref.samples, concealed) << "dB";
+      if (concealed.size() != ref.samples.size())
+      {
+        cout << "  (length differ by "
+             << (static_cast<long>(concealed.size()) -
+                 static_cast<long>(ref.samples.size()))
+             << " samples)";
+      }
+      cout << endl;
+    }
+  }
+
+  return 0;
+}
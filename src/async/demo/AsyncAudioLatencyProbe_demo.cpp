@@ -0,0 +1,124 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include <AsyncCppApplication.h>
+#include <AsyncTimer.h>
+#include <AsyncAudioLatencyProbe.h>
+#include <AsyncAudioDelayLine.h>
+#include <AsyncAudioPacer.h>
+#include <AsyncAudioSink.h>
+
+using namespace std;
+using namespace Async;
+
+
+/*
+ * A talker write audio in real time, in bursts, through a delay line and a
+ * pacer. The latency from the origin probe, placed where the audio enter the
+ * pipeline, to the measurement probe at the end is printed when done. The
+ * delay line output silence at the start of each stream so the stream start
+ * latency should be close to zero. The pacer send its prebuffer ahead so it
+ * should not add any latency either, which mean that the frame latency
+ * should be close to the length of the delay line.
+ */
+
+static const unsigned BLOCK_SIZE = INTERNAL_SAMPLE_RATE / 50;
+static const int DELAY_MS = 60;
+static const int PREBUF_MS = 100;
+
+
+class NullSink : public AudioSink
+{
+  public:
+    virtual int writeSamples(const float *samples, int count)
+    {
+      return count;
+    }
+
+    virtual void flushSamples(void)
+    {
+      sourceAllSamplesFlushed();
+    }
+};
+
+
+class Talker : public sigc::trackable
+{
+  public:
+    Talker(AudioSink *sink)
+      : sink(sink), timer(20, Timer::TYPE_PERIODIC), block(BLOCK_SIZE),
+        block_cnt(0), burst_cnt(0), sample_no(0)
+    {
+      timer.expired.connect(mem_fun(*this, &Talker::onTimerExpired));
+    }
+
+  private:
+    AudioSink*      sink;
+    Timer           timer;
+    vector<float>   block;
+    unsigned        block_cnt;
+    unsigned        burst_cnt;
+    unsigned long   sample_no;
+
+    void onTimerExpired(Timer *t)
+    {
+      ++block_cnt;
+      if (block_cnt <= 100)
+      {
+        for (unsigned i=0; i<BLOCK_SIZE; ++i, ++sample_no)
+        {
+          block[i] = 0.5 * sin(2.0 * M_PI * 1000.0 * sample_no /
+                               INTERNAL_SAMPLE_RATE);
+        }
+        sink->writeSamples(&block[0], BLOCK_SIZE);
+      }
+      else if (block_cnt == 101)
+      {
+        sink->flushSamples();
+      }
+      else if (block_cnt == 150)
+      {
+        block_cnt = 0;
+        if (++burst_cnt == 3)
+        {
+          Application::app().quit();
+        }
+      }
+    }
+};
+
+
+int main(int argc, char **argv)
+{
+  CppApplication app;
+
+  AudioLatencyProbe origin(AudioLatencyProbe::ORIGIN, "demo", "origin");
+  AudioSource *prev_src = &origin;
+
+  AudioDelayLine delay(DELAY_MS);
+  origin.setPositionOffset(DELAY_MS * INTERNAL_SAMPLE_RATE / 1000);
+  prev_src->registerSink(&delay);
+  prev_src = &delay;
+
+  AudioPacer pacer(INTERNAL_SAMPLE_RATE, BLOCK_SIZE, PREBUF_MS);
+  prev_src->registerSink(&pacer);
+  prev_src = &pacer;
+
+  AudioLatencyProbe probe(AudioLatencyProbe::MEASURE, "demo", "output");
+  prev_src->registerSink(&probe);
+  prev_src = &probe;
+
+  NullSink sink;
+  prev_src->registerSink(&sink);
+
+  Talker talker(&origin);
+  app.exec();
+
+  AudioLatencyProbe::writeReport(cout);
+  cout << endl;
+  AudioLatencyProbe::writeJson(cout);
+
+  return 0;
+}
+
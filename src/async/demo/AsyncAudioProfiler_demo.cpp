@@ -0,0 +1,102 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+
+#include <AsyncAudioProfiler.h>
+#include <AsyncAudioPassthrough.h>
+#include <AsyncAudioAmp.h>
+#include <AsyncAudioSplitter.h>
+#include <AsyncAudioFilter.h>
+#include <AsyncAudioFifo.h>
+#include <AsyncAudioValve.h>
+#include <AsyncAudioSink.h>
+
+using namespace std;
+using namespace Async;
+
+
+/*
+ * Build a small audio pipeline with the audio profiler enabled, push some
+ * audio through it and then dump the graph with the collected statistics.
+ * The DOT output can be turned into a picture using Graphviz:
+ *
+ *   AsyncAudioProfiler_demo audio.dot audio.json
+ *   dot -Tpng audio.dot > audio.png
+ */
+
+static const unsigned SAMPLE_RATE = 16000;
+static const unsigned BLOCK_SIZE = 320;
+
+
+class NullSink : public AudioSink
+{
+  public:
+    virtual int writeSamples(const float *samples, int count)
+    {
+      return count;
+    }
+
+    virtual void flushSamples(void)
+    {
+      sourceAllSamplesFlushed();
+    }
+};
+
+
+int main(int argc, char **argv)
+{
+  AudioProfiler::setEnabled(true);
+
+  AudioPassthrough input;
+  AudioProfiler::setName(&input, "Input");
+  AudioSource *prev_src = &input;
+
+  AudioAmp *amp = new AudioAmp;
+  amp->setGain(-6);
+  prev_src->registerSink(amp, true);
+  prev_src = amp;
+
+  AudioSplitter *splitter = new AudioSplitter;
+  prev_src->registerSink(splitter, true);
+
+  AudioFilter *filter = new AudioFilter("BpCh10/-0.1/300-3500", SAMPLE_RATE);
+  AudioProfiler::setName(filter, "Voiceband filter");
+  splitter->addSink(filter, true);
+  AudioFifo *fifo = new AudioFifo(4 * BLOCK_SIZE);
+  filter->registerSink(fifo, true);
+  fifo->registerSink(new NullSink, true);
+
+  AudioValve *valve = new AudioValve;
+  valve->setOpen(false);
+  splitter->addSink(valve, true);
+  valve->registerSink(new NullSink, true);
+
+  vector<float> block(BLOCK_SIZE);
+  unsigned long sample_no = 0;
+  for (unsigned b=0; b<500; ++b)
+  {
+    for (unsigned i=0; i<BLOCK_SIZE; ++i, ++sample_no)
+    {
+      block[i] = 0.5 * sin(2.0 * M_PI * 1000.0 * sample_no / SAMPLE_RATE);
+    }
+    input.writeSamples(&block[0], BLOCK_SIZE);
+  }
+  input.flushSamples();
+
+  if (argc > 2)
+  {
+    ofstream dot(argv[1]);
+    AudioProfiler::writeDot(dot);
+    ofstream json(argv[2]);
+    AudioProfiler::writeJson(json);
+  }
+  else
+  {
+    AudioProfiler::writeDot(cout);
+    AudioProfiler::writeJson(cout);
+  }
+
+  return 0;
+}
+
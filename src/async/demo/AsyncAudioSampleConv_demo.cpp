@@ -0,0 +1,196 @@
+#include <sys/time.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include <AsyncAudioSampleConv.h>
+
+using namespace std;
+using namespace Async;
+
+
+/*
+ * Check that all sample conversion implementations supported by this CPU
+ * give the same result as the plain C++ implementation and then measure the
+ * throughput of each one. To benchmark the ARM NEON implementation on a PC,
+ * cross compile the demo and run it in qemu, e.g. qemu-aarch64.
+ */
+
+static const int BENCH_SAMPLES = 4096;
+static const int BENCH_ITERATIONS = 2000;
+
+static const AudioSampleConv::Impl impls[] =
+{
+  AudioSampleConv::IMPL_SCALAR, AudioSampleConv::IMPL_SSE2,
+  AudioSampleConv::IMPL_AVX2, AudioSampleConv::IMPL_NEON
+};
+static const int impl_cnt = sizeof(impls) / sizeof(*impls);
+
+
+struct Buffers
+{
+  vector<float>   flt;
+  vector<int16_t> s16;
+  vector<uint8_t> u8;
+  vector<float>   flt_out;
+  vector<int16_t> s16_out;
+  bool            full_scale;
+
+  Buffers(int count)
+    : flt(count), s16(2 * count), u8(count), flt_out(count),
+      s16_out(2 * count), full_scale(false)
+  {
+    for (int i=0; i<count; ++i)
+    {
+      flt[i] = 2.4f * rand() / RAND_MAX - 1.2f;
+      u8[i] = rand() % 255;
+    }
+    for (int i=0; i<2*count; ++i)
+    {
+      s16[i] = rand() % 65536 - 32768;
+    }
+  }
+};
+
+
+static void runAll(Buffers& b, int count, int channels, int channel)
+{
+  AudioSampleConv::floatToS16(&b.s16_out[0], &b.flt[0], count);
+  AudioSampleConv::s16ToFloat(&b.flt_out[0], &b.s16[0], count);
+  int frames = 2 * count / channels;
+  vector<float> deint(frames);
+  AudioSampleConv::s16ToFloatDeinterleave(&deint[0], &b.s16[0], frames,
+                                          channels, channel);
+  b.flt_out.insert(b.flt_out.end(), deint.begin(), deint.end());
+  vector<int16_t> mix(b.s16.begin(), b.s16.begin() + frames * channels);
+  AudioSampleConv::floatMixToS16Interleave(&mix[0], &b.flt[0],
+                                           min(frames, count), channels,
+                                           channel);
+  b.s16_out.insert(b.s16_out.end(), mix.begin(), mix.end());
+  vector<float> iq(count);
+  b.full_scale = AudioSampleConv::u8ToFloat(&iq[0], &b.u8[0], count);
+  b.flt_out.insert(b.flt_out.end(), iq.begin(), iq.end());
+}
+
+
+static bool verify(void)
+{
+  bool ok = true;
+  for (int count=0; count<100; count+=7)
+  {
+    for (int channels=1; channels<=3; ++channels)
+    {
+      for (int channel=0; channel<channels; ++channel)
+      {
+        Buffers input(count);
+        if (count > 0)
+        {
+          input.u8[count - 1] = (channel == 0) ? 255 : 0;
+        }
+        Buffers ref(input);
+        AudioSampleConv::setImpl(AudioSampleConv::IMPL_SCALAR);
+        runAll(ref, count, channels, channel);
+        for (int i=1; i<impl_cnt; ++i)
+        {
+          if (!AudioSampleConv::setImpl(impls[i]))
+          {
+            continue;
+          }
+          Buffers b(input);
+          runAll(b, count, channels, channel);
+          if ((b.s16_out != ref.s16_out) || (b.flt_out != ref.flt_out) ||
+              (b.full_scale != ref.full_scale))
+          {
+            cout << "*** " << AudioSampleConv::implName(impls[i])
+                 << " differ from the scalar implementation: count="
+                 << count << " channels=" << channels << " channel="
+                 << channel << endl;
+            ok = false;
+          }
+        }
+      }
+    }
+  }
+  return ok;
+}
+
+
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+int main(int argc, char **argv)
+{
+  if (!verify())
+  {
+    exit(1);
+  }
+  cout << "All implementations give the same result\n\n";
+
+  const char *names[] =
+  {
+    "floatToS16", "s16ToFloat", "s16ToFloatDeinterleave",
+    "floatMixToS16Interleave", "u8ToFloat"
+  };
+  Buffers b(BENCH_SAMPLES);
+  cout << setw(24) << left << "Msamples/s" << right;
+  for (int i=0; i<impl_cnt; ++i)
+  {
+    cout << setw(10) << AudioSampleConv::implName(impls[i]);
+  }
+  cout << endl;
+  for (int func=0; func<5; ++func)
+  {
+    cout << setw(24) << left << names[func] << right;
+    for (int i=0; i<impl_cnt; ++i)
+    {
+      if (!AudioSampleConv::setImpl(impls[i]))
+      {
+        cout << setw(10) << "-";
+        continue;
+      }
+      double start = now();
+      for (int it=0; it<BENCH_ITERATIONS; ++it)
+      {
+        switch (func)
+        {
+          case 0:
+            AudioSampleConv::floatToS16(&b.s16_out[0], &b.flt[0],
+                                        BENCH_SAMPLES);
+            break;
+          case 1:
+            AudioSampleConv::s16ToFloat(&b.flt_out[0], &b.s16[0],
+                                        BENCH_SAMPLES);
+            break;
+          case 2:
+            AudioSampleConv::s16ToFloatDeinterleave(&b.flt_out[0], &b.s16[0],
+                                                    BENCH_SAMPLES, 2, 1);
+            break;
+          case 3:
+            AudioSampleConv::floatMixToS16Interleave(&b.s16_out[0],
+                                                     &b.flt[0],
+                                                     BENCH_SAMPLES, 2, 0);
+            break;
+          case 4:
+            b.full_scale ^= AudioSampleConv::u8ToFloat(&b.flt_out[0],
+                                                       &b.u8[0],
+                                                       BENCH_SAMPLES);
+            break;
+        }
+      }
+      double secs = now() - start;
+      cout << setw(10) << fixed << setprecision(0)
+           << (1.0 * BENCH_SAMPLES * BENCH_ITERATIONS / secs / 1000000.0);
+    }
+    cout << endl;
+  }
+
+  return 0;
+}
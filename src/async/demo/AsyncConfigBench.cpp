@@ -0,0 +1,263 @@
+/*
+ * Startup benchmark for the Async::Config class.
+ *
+ * A configuration file resembling a large SvxLink setup is generated, with
+ * a number of receiver sections each holding a set of numeric and string
+ * variables. The file is then read and every variable is read a number of
+ * times, the way the receivers, voters and logics read their configuration
+ * when SvxLink is started. The typed reads are timed both using the cached
+ * conversion in Config::getValue and using a string read followed by a
+ * stringstream conversion, which is how getValue worked before the cache
+ * was added. The time for just looking up the string values is printed too
+ * since that is the part a flat lookup table would speed up.
+ *
+ * Usage: AsyncConfigBench [-s sections] [-v variables] [-r reads]
+ */
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <AsyncConfig.h>
+
+using namespace std;
+using namespace Async;
+
+
+static unsigned sections = 200;
+static unsigned variables = 30;
+static unsigned reads = 5;
+static vector<string> section_names;
+static vector<string> var_names;
+
+
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+static string sectionName(unsigned s)
+{
+  ostringstream ss;
+  ss << "Rx" << s;
+  return ss.str();
+}
+
+
+static string varName(unsigned v)
+{
+  ostringstream ss;
+  ss << "VAR" << v;
+  return ss.str();
+}
+
+
+static bool generateConfig(const string& path)
+{
+  for (unsigned s = 0; s < sections; ++s)
+  {
+    section_names.push_back(sectionName(s));
+  }
+  for (unsigned v = 0; v < variables; ++v)
+  {
+    var_names.push_back(varName(v));
+  }
+
+  ofstream ofs(path.c_str());
+  if (!ofs)
+  {
+    return false;
+  }
+  for (unsigned s = 0; s < sections; ++s)
+  {
+    ofs << "[" << section_names[s] << "]\n";
+    ofs << "TYPE=Local\n";
+    ofs << "AUDIO_DEV=alsa:plughw:" << s << "\n";
+    for (unsigned v = 0; v < variables; ++v)
+    {
+      ofs << var_names[v] << "=";
+      if (v % 2 == 0)
+      {
+        ofs << (s * 100 + v);
+      }
+      else
+      {
+        ofs << (s + v) / 10.0;
+      }
+      ofs << "\n";
+    }
+    ofs << "\n";
+  }
+  return ofs.good();
+}
+
+
+  // This is how Config::getValue converted values before the cache was added
+template <typename Rsp>
+static bool uncachedGetValue(const Config& cfg, const string& section,
+                             const string& tag, Rsp &rsp)
+{
+  string str_val;
+  if (!cfg.getValue(section, tag, str_val))
+  {
+    return false;
+  }
+  stringstream ssval(str_val);
+  Rsp tmp;
+  ssval >> tmp;
+  if(!ssval.eof())
+  {
+    ssval >> std::ws;
+  }
+  if (ssval.fail() || !ssval.eof())
+  {
+    return false;
+  }
+  rsp = tmp;
+  return true;
+}
+
+
+template <bool cached>
+static double readAll(const Config& cfg, double &sum)
+{
+  double start = now();
+  for (unsigned r = 0; r < reads; ++r)
+  {
+    for (unsigned s = 0; s < sections; ++s)
+    {
+      const string& section = section_names[s];
+      for (unsigned v = 0; v < variables; ++v)
+      {
+        const string& tag = var_names[v];
+        bool ok;
+        if (v % 2 == 0)
+        {
+          unsigned val = 0;
+          ok = cached ? cfg.getValue(section, tag, val)
+                      : uncachedGetValue(cfg, section, tag, val);
+          sum += val;
+        }
+        else
+        {
+          float val = 0.0f;
+          ok = cached ? cfg.getValue(section, tag, val)
+                      : uncachedGetValue(cfg, section, tag, val);
+          sum += val;
+        }
+        if (!ok)
+        {
+          cerr << "*** ERROR: Could not read " << section << "/" << tag
+               << endl;
+          exit(1);
+        }
+      }
+    }
+  }
+  return now() - start;
+}
+
+
+static double readStrings(const Config& cfg, size_t &len)
+{
+  double start = now();
+  for (unsigned r = 0; r < reads; ++r)
+  {
+    for (unsigned s = 0; s < sections; ++s)
+    {
+      const string& section = section_names[s];
+      for (unsigned v = 0; v < variables; ++v)
+      {
+        string val;
+        cfg.getValue(section, var_names[v], val);
+        len += val.size();
+      }
+    }
+  }
+  return now() - start;
+}
+
+
+int main(int argc, char **argv)
+{
+  int opt;
+  while ((opt = getopt(argc, argv, "s:v:r:")) != -1)
+  {
+    switch (opt)
+    {
+      case 's':
+        sections = atoi(optarg);
+        break;
+      case 'v':
+        variables = atoi(optarg);
+        break;
+      case 'r':
+        reads = atoi(optarg);
+        break;
+      default:
+        cerr << "Usage: AsyncConfigBench [-s sections] [-v variables] "
+                "[-r reads]\n";
+        exit(1);
+    }
+  }
+
+  char path[] = "/tmp/AsyncConfigBench.XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0)
+  {
+    cerr << "*** ERROR: Could not create a temporary file\n";
+    exit(1);
+  }
+  close(fd);
+  if (!generateConfig(path))
+  {
+    cerr << "*** ERROR: Could not write the configuration to " << path
+         << endl;
+    unlink(path);
+    exit(1);
+  }
+
+    // Use separate objects so that the cached run does not benefit from
+    // the uncached one or the other way around
+  Config cached_cfg;
+  Config uncached_cfg;
+  double start = now();
+  bool ok = cached_cfg.open(path);
+  double open_time = now() - start;
+  ok = ok && uncached_cfg.open(path);
+  unlink(path);
+  if (!ok)
+  {
+    cerr << "*** ERROR: Could not open the generated configuration\n";
+    exit(1);
+  }
+
+  double sum = 0.0;
+  size_t len = 0;
+  double string_time = readStrings(cached_cfg, len);
+  double uncached_time = readAll<false>(uncached_cfg, sum);
+  double cached_time = readAll<true>(cached_cfg, sum);
+
+  unsigned long cnt = static_cast<unsigned long>(sections) * variables * reads;
+  cout << "Variables:       " << sections * variables << " in " << sections
+       << " sections" << endl;
+  cout << "Reads:           " << cnt << endl;
+  cout << "Open:            " << open_time * 1000.0 << "ms" << endl;
+  cout << "String lookups:  " << string_time * 1000.0 << "ms" << endl;
+  cout << "Typed, uncached: " << uncached_time * 1000.0 << "ms" << endl;
+  cout << "Typed, cached:   " << cached_time * 1000.0 << "ms" << endl;
+  cout << "Speedup:         " << uncached_time / cached_time << endl;
+
+    // Make sure that the reads are not optimized away
+  return (sum < 0.0) || (len == 0);
+}
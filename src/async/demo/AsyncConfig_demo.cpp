@@ -7,6 +7,11 @@
 using namespace std;
 using namespace Async;
 
+void myIntUpdated(const int& val)
+{
+  cout << "my_int=" << val << endl;
+}
+
 int main(int argc, char **argv)
 {
   Config cfg;
@@ -65,4 +70,10 @@ int main(int argc, char **argv)
     cerr << "*** ERROR: Config variable SECTION2/MY_FLOAT malformed, "
 	    "not found or out of range.\n";
   }
+
+    // Subscribe to changes of an integer value. The function is called
+    // directly with the current value and then each time the value change.
+  Config::Subscriber<int>::Type subscriber = sigc::ptr_fun(myIntUpdated);
+  cfg.subscribeValue("SECTION2", "MY_INT", 0, subscriber);
+  cfg.setValue("SECTION2", "MY_INT", 4711);
 }
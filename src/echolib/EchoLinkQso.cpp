@@ -63,6 +63,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "rtpacket.h"
 #include "EchoLinkDispatcher.h"
 #include "EchoLinkQso.h"
+#include "EchoLinkSharedEncoder.h"
 
 
 
@@ -159,7 +160,7 @@ Qso::Qso(const IpAddress& addr, const string& callsign, const string& name,
     send_buffer_cnt(0), remote_ip(addr), rx_indicator_timer(0),
     remote_name("?"), remote_call("?"), is_remote_initiated(false),
     receiving_audio(false), use_gsm_only(false), p(new Private),
-    rx_timeout_left(0)
+    rx_timeout_left(0), writing_samples(false)
 {
   if (!addr.isUnicast())
   {
@@ -444,6 +445,49 @@ bool Qso::sendAudioRaw(RawPacket *raw_packet)
 } /* Qso::sendAudioRaw */
 
 
+bool Qso::sendEncodedAudio(SharedEncoder& encoder)
+{
+  if (state != STATE_CONNECTED)
+  {
+    return false;
+  }
+
+    // The audio written using writeSamples have priority. The shared
+    // packets are dropped until that audio stream has been flushed.
+  if (writing_samples)
+  {
+    return true;
+  }
+
+  SharedEncoder::Codec codec = SharedEncoder::CODEC_GSM;
+#ifdef SPEEX_MAJOR
+  if (p->remote_codec == Private::CODEC_SPEEX)
+  {
+    codec = SharedEncoder::CODEC_SPEEX;
+  }
+#endif
+
+  size_t len = 0;
+  VoicePacket *voice_packet = encoder.packet(codec, len);
+  if (voice_packet == 0)
+  {
+    cerr << "*** WARNING: Audio encoding failed in Qso::sendEncodedAudio\n";
+    return false;
+  }
+  voice_packet->header.seqNum = htons(next_audio_seq++);
+
+  bool success = Dispatcher::instance()->sendAudioMsg(remote_ip, voice_packet,
+                                                      len);
+  if (!success)
+  {
+    perror("sendAudioMsg in Qso::sendEncodedAudio");
+    return false;
+  }
+
+  return true;
+} /* Qso::sendEncodedAudio */
+
+
 void Qso::setRemoteParams(const string& priv)
 {
 #ifdef SPEEX_MAJOR  
@@ -466,6 +510,8 @@ int Qso::writeSamples(const float *samples, int count)
   {
     return count;
   }
+
+  writing_samples = true;
   
   while (samples_read < count)
   {
@@ -518,6 +564,7 @@ void Qso::flushSamples(void)
       send_buffer_cnt = 0;
     }
   }
+  writing_samples = false;
   
   sourceAllSamplesFlushed();
   
@@ -922,6 +969,7 @@ void Qso::connectionTimeout(Timer *timer)
 bool Qso::setupConnection(void)
 {
   send_buffer_cnt = 0;
+  writing_samples = false;
   
   bool send_sdes_ok = sendSdesPacket();
   if (send_sdes_ok)
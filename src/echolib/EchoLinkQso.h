@@ -99,6 +99,7 @@ namespace EchoLink
  *
  ****************************************************************************/
 
+class SharedEncoder;
 
 
 /****************************************************************************
@@ -315,6 +316,23 @@ class Qso
      */
     bool sendAudioRaw(RawPacket *raw_packet);
 
+    /**
+     * @brief 	Send a voice packet from a shared encoder
+     * @param 	encoder The shared encoder to take the packet from
+     * @return	Returns \em true on success or else \em false
+     *
+     * This function should be called from a slot connected to the
+     * EchoLink::SharedEncoder::packetReady signal. The packet for the codec
+     * used on this connection is taken from the shared encoder, so that the
+     * audio is only encoded once no matter how many connections that it is
+     * sent to. Only the sequence number is set by this function.
+     * If audio is being written to this object using the writeSamples
+     * function, the packet is dropped. Packets are sent again when that
+     * audio stream has been flushed. The shared packets are not queued since
+     * sending them in a burst afterwards would only delay the audio.
+     */
+    bool sendEncodedAudio(SharedEncoder& encoder);
+
     /**
       * @brief Set parameters of the remote station connection
       * @param priv A private string for passing connection parameters
@@ -502,6 +520,7 @@ class Qso
     bool                use_gsm_only;
     Private             *p;
     int                 rx_timeout_left;
+    bool                writing_samples;
 
     Qso(const Qso&);
     Qso& operator=(const Qso&);
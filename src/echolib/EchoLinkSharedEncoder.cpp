@@ -0,0 +1,297 @@
+/**
+@file	 EchoLinkSharedEncoder.cpp
+@brief   An audio encoder shared by many EchoLink connections
+@author  Tobias Blomberg
+@date	 2017-12-03
+
+This file contains a class that encode audio to EchoLink voice packets once,
+so that the same packets can be sent to many EchoLink connections. For more
+information, see the documentation for class EchoLink::SharedEncoder.
+
+\verbatim
+EchoLib - A library for EchoLink communication
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <netinet/in.h>
+
+#include <cstring>
+#include <algorithm>
+
+#ifdef SPEEX_MAJOR
+#include <speex/speex.h>
+#endif
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioSampleConv.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "EchoLinkSharedEncoder.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+using namespace EchoLink;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+struct SharedEncoder::Private
+{
+#ifdef SPEEX_MAJOR
+  SpeexBits enc_bits;
+  void *    enc_state;
+#endif
+
+  Private(void)
+#ifdef SPEEX_MAJOR
+    : enc_bits(), enc_state(0)
+#endif
+  {}
+};
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+SharedEncoder::SharedEncoder(void)
+  : buf_cnt(0), gsmh(0), p(new Private)
+{
+  gsmh = gsm_create();
+
+#ifdef SPEEX_MAJOR
+    // Use the same settings as EchoLink::Qso
+  speex_bits_init(&p->enc_bits);
+  p->enc_state = speex_encoder_init(&speex_nb_mode);
+  int val = 25000;
+  speex_encoder_ctl(p->enc_state, SPEEX_SET_BITRATE, &val);
+  val = 8;
+  speex_encoder_ctl(p->enc_state, SPEEX_SET_QUALITY, &val);
+  val = 4;
+  speex_encoder_ctl(p->enc_state, SPEEX_SET_COMPLEXITY, &val);
+#endif
+
+  for (int i=0; i<2; ++i)
+  {
+    packet_len[i] = 0;
+    packet_valid[i] = false;
+    encoded_cnt[i] = 0;
+  }
+} /* SharedEncoder::SharedEncoder */
+
+
+SharedEncoder::~SharedEncoder(void)
+{
+  gsm_destroy(gsmh);
+  gsmh = 0;
+
+#ifdef SPEEX_MAJOR
+  speex_bits_destroy(&p->enc_bits);
+  speex_encoder_destroy(p->enc_state);
+#endif
+
+  delete p;
+  p = 0;
+} /* SharedEncoder::~SharedEncoder */
+
+
+Qso::VoicePacket *SharedEncoder::packet(Codec codec, size_t& len)
+{
+  if (!packet_valid[codec])
+  {
+    Qso::VoicePacket& voice_packet = packets[codec];
+    voice_packet.header.version = 0xc0;
+    voice_packet.header.time = htonl(0);
+    voice_packet.header.ssrc = htonl(0);
+    voice_packet.header.seqNum = htons(0);
+    size_t nbytes = (codec == CODEC_SPEEX) ? encodeSpeex(voice_packet)
+                                           : encodeGsm(voice_packet);
+    packet_len[codec] = (nbytes > 0) ? nbytes + sizeof(voice_packet.header)
+                                     : 0;
+    packet_valid[codec] = true;
+    encoded_cnt[codec] += 1;
+  }
+
+  len = packet_len[codec];
+  return (len > 0) ? &packets[codec] : 0;
+} /* SharedEncoder::packet */
+
+
+int SharedEncoder::writeSamples(const float *samples, int count)
+{
+  int samples_read = 0;
+  while (samples_read < count)
+  {
+    int read_cnt = min(BUFFER_SIZE - buf_cnt, count - samples_read);
+    AudioSampleConv::floatToS16(buf + buf_cnt, samples + samples_read,
+                                read_cnt);
+    buf_cnt += read_cnt;
+    samples_read += read_cnt;
+
+    if (buf_cnt == BUFFER_SIZE)
+    {
+      emitBlock();
+    }
+  }
+
+  return samples_read;
+} /* SharedEncoder::writeSamples */
+
+
+void SharedEncoder::flushSamples(void)
+{
+  if (buf_cnt > 0)
+  {
+    memset(buf + buf_cnt, 0, sizeof(*buf) * (BUFFER_SIZE - buf_cnt));
+    buf_cnt = BUFFER_SIZE;
+    emitBlock();
+  }
+  sourceAllSamplesFlushed();
+} /* SharedEncoder::flushSamples */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void SharedEncoder::emitBlock(void)
+{
+  packet_valid[CODEC_GSM] = false;
+  packet_valid[CODEC_SPEEX] = false;
+  packetReady(*this);
+  buf_cnt = 0;
+} /* SharedEncoder::emitBlock */
+
+
+size_t SharedEncoder::encodeGsm(Qso::VoicePacket& voice_packet)
+{
+  size_t nbytes = 0;
+  for (int i=0; i<FRAME_COUNT; i++)
+  {
+    gsm_encode(gsmh, buf + i*160, voice_packet.data + i*33);
+    nbytes += 33;
+  }
+  voice_packet.header.pt = 0x03;
+  return nbytes;
+} /* SharedEncoder::encodeGsm */
+
+
+size_t SharedEncoder::encodeSpeex(Qso::VoicePacket& voice_packet)
+{
+  size_t nbytes = 0;
+#ifdef SPEEX_MAJOR
+  for (int i=0; i<BUFFER_SIZE; i+=160)
+  {
+    speex_encode_int(p->enc_state, buf + i, &p->enc_bits);
+  }
+  speex_bits_insert_terminator(&p->enc_bits);
+  size_t nsize = speex_bits_nbytes(&p->enc_bits);
+  if (nsize < sizeof(voice_packet.data))
+  {
+    nbytes = speex_bits_write(&p->enc_bits, (char*)voice_packet.data, nsize);
+  }
+  speex_bits_reset(&p->enc_bits);
+  voice_packet.header.pt = 0x96;
+#endif
+  return nbytes;
+} /* SharedEncoder::encodeSpeex */
+
+
+
+/*
+ * This file has not been truncated
+ */
+
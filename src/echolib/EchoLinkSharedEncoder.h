@@ -0,0 +1,237 @@
+/**
+@file	 EchoLinkSharedEncoder.h
+@brief   An audio encoder shared by many EchoLink connections
+@author  Tobias Blomberg
+@date	 2017-12-03
+
+This file contains a class that encode audio to EchoLink voice packets once,
+so that the same packets can be sent to many EchoLink connections. For more
+information, see the documentation for class EchoLink::SharedEncoder.
+
+\verbatim
+EchoLib - A library for EchoLink communication
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+#ifndef ECHOLINK_SHARED_ENCODER_INCLUDED
+#define ECHOLINK_SHARED_ENCODER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+#include <stdint.h>
+#include <cstddef>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+extern "C" {
+#include <gsm.h>
+}
+#include <AsyncAudioSink.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "EchoLinkQso.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+namespace EchoLink
+{
+
+/****************************************************************************
+ *
+ * Forward declarations inside the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	An audio encoder shared by many EchoLink connections
+@author Tobias Blomberg
+@date   2017-12-03
+
+When the same audio is sent to many EchoLink stations, like the audio from a
+SvxLink node to all connected stations, it is a waste of CPU to encode the
+audio separately for each connection. This class collect 8kHz audio into
+blocks the size of an EchoLink voice packet and then emit the packetReady
+signal once for each block. Each connection then ask for the packet in the
+codec it use, by calling EchoLink::Qso::sendEncodedAudio. The audio is
+encoded at most once per block and codec, no matter how many connections
+that are using the packet. Only the sequence number in the RTP header is
+set separately for each connection.
+*/
+class SharedEncoder : public Async::AudioSink, public sigc::trackable
+{
+  public:
+    /**
+     * @brief The audio codecs that can be used
+     */
+    typedef enum
+    {
+      CODEC_GSM,  ///< The GSM codec
+      CODEC_SPEEX ///< The Speex codec
+    } Codec;
+
+    /**
+     * @brief 	Default constructor
+     */
+    SharedEncoder(void);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~SharedEncoder(void);
+
+    /**
+     * @brief 	Get the voice packet for the current block
+     * @param 	codec The codec to get the packet for
+     * @param 	len   Is set to the total length of the packet, in bytes
+     * @return	Returns the voice packet or 0 if the encoding failed
+     *
+     * This function may only be called from a slot connected to the
+     * packetReady signal. The first time a packet for a specific codec is
+     * asked for, the audio block is encoded. Later calls for the same codec
+     * return the same packet. The header sequence number is not set.
+     */
+    Qso::VoicePacket *packet(Codec codec, size_t& len);
+
+    /**
+     * @brief 	Get the number of packets that have been encoded
+     * @param 	codec The codec to get the count for
+     * @return	Returns the number of encoded packets for the given codec
+     */
+    unsigned encodedCount(Codec codec) const
+    {
+      return encoded_cnt[codec];
+    }
+
+    /**
+     * @brief 	Write samples into this audio sink
+     * @param 	samples The buffer containing the samples
+     * @param 	count   The number of samples in the buffer
+     * @return	Returns the number of samples that has been taken care of
+     *
+     * The samples must be sampled at 8kHz.
+     */
+    virtual int writeSamples(const float *samples, int count);
+
+    /**
+     * @brief 	Tell the sink to flush the previously written samples
+     *
+     * A partially filled block is padded with silence and the packetReady
+     * signal is emitted for it.
+     */
+    virtual void flushSamples(void);
+
+    /**
+     * @brief 	A signal that is emitted when a block of audio is ready
+     * @param 	encoder A reference to this object
+     *
+     * Connect this signal to each connection that should have the audio.
+     * The connections then call the packet function, usually through the
+     * EchoLink::Qso::sendEncodedAudio function.
+     */
+    sigc::signal<void, SharedEncoder&> packetReady;
+
+  protected:
+
+  private:
+    struct Private;
+
+    static const int  FRAME_COUNT = 4;
+    static const int  BUFFER_SIZE = FRAME_COUNT * 160;
+
+    int16_t           buf[BUFFER_SIZE];
+    int               buf_cnt;
+    gsm               gsmh;
+    Qso::VoicePacket  packets[2];
+    size_t            packet_len[2];
+    bool              packet_valid[2];
+    unsigned          encoded_cnt[2];
+    Private           *p;
+
+    SharedEncoder(const SharedEncoder&);
+    SharedEncoder& operator=(const SharedEncoder&);
+    void emitBlock(void);
+    size_t encodeGsm(Qso::VoicePacket& voice_packet);
+    size_t encodeSpeex(Qso::VoicePacket& voice_packet);
+
+};  /* class SharedEncoder */
+
+
+} /* namespace */
+
+#endif /* ECHOLINK_SHARED_ENCODER_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -49,12 +49,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <AsyncTimer.h>
 #include <AsyncConfig.h>
-#include <AsyncAudioSplitter.h>
+#include <AsyncAudioDecimator.h>
 #include <AsyncAudioValve.h>
 #include <AsyncAudioSelector.h>
 #include <EchoLinkDirectory.h>
 #include <EchoLinkDispatcher.h>
 #include <EchoLinkProxy.h>
+#include <EchoLinkSharedEncoder.h>
 #include <LocationInfo.h>
 #include <common.h>
 
@@ -71,6 +72,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "version/MODULE_ECHOLINK.h"
 #include "ModuleEchoLink.h"
 #include "QsoImpl.h"
+#include "multirate_filter_coeff.h"
 
 
 /****************************************************************************
@@ -158,7 +160,7 @@ ModuleEchoLink::ModuleEchoLink(void *dl_handle, Logic *logic,
     max_connections(1), max_qsos(1), talker(0), squelch_is_open(false),
     state(STATE_NORMAL), cbc_timer(0), dbc_timer(0), drop_incoming_regex(0),
     reject_incoming_regex(0), accept_incoming_regex(0),
-    reject_outgoing_regex(0), accept_outgoing_regex(0), splitter(0),
+    reject_outgoing_regex(0), accept_outgoing_regex(0), shared_encoder(0),
     listen_only_valve(0), selector(0), num_con_max(0), num_con_ttl(5*60),
     num_con_block_time(120*60), num_con_update_timer(0), reject_conf(false),
     autocon_echolink_id(0), autocon_time(DEFAULT_AUTOCON_TIME),
@@ -437,12 +439,23 @@ bool ModuleEchoLink::initialize(void)
       mem_fun(*this, &ModuleEchoLink::onIncomingConnection));
 
     // Create audio pipe chain for audio transmitted to the remote EchoLink
-    // stations: <from core> -> Valve -> Splitter (-> QsoImpl ...)
+    // stations: <from core> -> Valve -> Decimator -> SharedEncoder
+    // (-> QsoImpl ...). The audio is encoded once for each codec in use
+    // and the encoded packets are sent to all connected stations.
   listen_only_valve = new AudioValve;
   AudioSink::setHandler(listen_only_valve);
-  
-  splitter = new AudioSplitter;
-  listen_only_valve->registerSink(splitter);
+  AudioSource *prev_src = listen_only_valve;
+
+#if INTERNAL_SAMPLE_RATE == 16000
+  AudioDecimator *down_sampler = new AudioDecimator(
+          2, coeff_16_8, coeff_16_8_taps);
+  prev_src->registerSink(down_sampler, true);
+  prev_src = down_sampler;
+#endif
+
+  shared_encoder = new SharedEncoder;
+  prev_src->registerSink(shared_encoder);
+  prev_src = 0;
 
     // Create audio pipe chain for audio received from the remove EchoLink
     // stations: (QsoImpl -> ) Selector -> Fifo -> <to core>
@@ -654,8 +667,8 @@ void ModuleEchoLink::moduleCleanup(void)
   autocon_timer = 0;
   
   AudioSink::clearHandler();
-  delete splitter;
-  splitter = 0;
+  delete shared_encoder;
+  shared_encoder = 0;
   delete listen_only_valve;
   listen_only_valve = 0;
   
@@ -1114,7 +1127,8 @@ void ModuleEchoLink::onIncomingConnection(const IpAddress& ip,
       	  mem_fun(*this, &ModuleEchoLink::audioFromRemoteRaw));
   qso->destroyMe.connect(mem_fun(*this, &ModuleEchoLink::destroyQsoObject));
 
-  splitter->addSink(qso);
+  shared_encoder->packetReady.connect(
+      mem_fun(*qso, &QsoImpl::sendEncodedAudio));
   selector->addSource(qso);
   selector->enableAutoSelect(qso, 0);
 
@@ -1367,7 +1381,6 @@ void ModuleEchoLink::destroyQsoObject(QsoImpl *qso)
   //cout << qso->remoteCallsign() << ": Destroying QSO object" << endl;
   string callsign = qso->remoteCallsign();
 
-  splitter->removeSink(qso);
   selector->removeSource(qso);
       
   vector<QsoImpl*>::iterator it = find(qsos.begin(), qsos.end(), qso);
@@ -1519,7 +1532,8 @@ void ModuleEchoLink::createOutgoingConnection(const StationData &station)
       	    mem_fun(*this, &ModuleEchoLink::audioFromRemoteRaw));
     qso->destroyMe.connect(mem_fun(*this, &ModuleEchoLink::destroyQsoObject));
 
-    splitter->addSink(qso);
+    shared_encoder->packetReady.connect(
+        mem_fun(*qso, &QsoImpl::sendEncodedAudio));
     selector->addSource(qso);
     selector->enableAutoSelect(qso, 0);
   }
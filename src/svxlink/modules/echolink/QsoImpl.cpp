@@ -49,9 +49,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <AsyncConfig.h>
 #include <AsyncAudioPacer.h>
-#include <AsyncAudioSelector.h>
-#include <AsyncAudioPassthrough.h>
 #include <AsyncAudioFifo.h>
+#include <AsyncAudioAdaptiveJitterFifo.h>
 #include <AsyncAudioDecimator.h>
 #include <AsyncAudioInterpolator.h>
 #include <AsyncAudioDebugger.h>
@@ -134,9 +133,10 @@ using namespace sigc;
 
 QsoImpl::QsoImpl(const StationData &station, ModuleEchoLink *module)
   : m_qso(station.ip()), module(module), event_handler(0), msg_handler(0),
-    output_sel(0), init_ok(false), reject_qso(false), last_message(""),
+    init_ok(false), reject_qso(false), last_message(""),
     last_info_msg(""), idle_timer(0), disc_when_done(false), idle_timer_cnt(0),
-    idle_timeout(0), destroy_timer(0), station(station), sink_handler(0)
+    idle_timeout(0), destroy_timer(0), station(station),
+    jitter_fifo(0)
 {
   assert(module != 0);
 
@@ -191,9 +191,6 @@ QsoImpl::QsoImpl(const StationData &station, ModuleEchoLink *module)
     idle_timer->expired.connect(mem_fun(*this, &QsoImpl::idleTimeoutCheck));
   }
   
-  sink_handler = new AudioPassthrough;
-  AudioSink::setHandler(sink_handler);
-
   msg_handler = new MsgHandler(INTERNAL_SAMPLE_RATE);
   msg_handler->allMsgsWritten.connect(
       	  mem_fun(*this, &QsoImpl::allRemoteMsgsWritten));
@@ -203,12 +200,11 @@ QsoImpl::QsoImpl(const StationData &station, ModuleEchoLink *module)
 					 500);
   msg_handler->registerSink(msg_pacer, true);
   
-  output_sel = new AudioSelector;
-  output_sel->addSource(sink_handler);
-  output_sel->enableAutoSelect(sink_handler, 0);
-  output_sel->addSource(msg_pacer);
-  output_sel->enableAutoSelect(msg_pacer, 10);
-  AudioSource *prev_src = output_sel;
+
+    // The audio from the logic core is encoded once for all QSOs by a
+    // shared encoder in the module. Only messages played to this remote
+    // station are encoded by the Qso object itself.
+  AudioSource *prev_src = msg_pacer;
 
 #if INTERNAL_SAMPLE_RATE == 16000
   AudioDecimator *down_sampler = new AudioDecimator(
@@ -252,11 +248,27 @@ QsoImpl::QsoImpl(const StationData &station, ModuleEchoLink *module)
   
   prev_src = &m_qso;
   
-  AudioFifo *input_fifo = new AudioFifo(2048);
-  input_fifo->setOverwrite(true);
-  input_fifo->setPrebufSamples(1024);
-  prev_src->registerSink(input_fifo, true);
-  prev_src = input_fifo;
+    // Use an adaptive jitter buffer if a maximum jitter buffer delay is set.
+    // The audio from the QSO object is sampled at 8kHz.
+  unsigned jitter_buffer_max_delay = 0;
+  cfg.getValue(cfg_name, "JITTER_BUFFER_MAX_DELAY", jitter_buffer_max_delay);
+  if (jitter_buffer_max_delay > 0)
+  {
+    unsigned jitter_buffer_delay = 60;
+    cfg.getValue(cfg_name, "JITTER_BUFFER_DELAY", jitter_buffer_delay);
+    jitter_fifo = new AudioAdaptiveJitterFifo(jitter_buffer_delay,
+                                              jitter_buffer_max_delay, 8000);
+    prev_src->registerSink(jitter_fifo, true);
+    prev_src = jitter_fifo;
+  }
+  else
+  {
+    AudioFifo *input_fifo = new AudioFifo(2048);
+    input_fifo->setOverwrite(true);
+    input_fifo->setPrebufSamples(1024);
+    prev_src->registerSink(input_fifo, true);
+    prev_src = input_fifo;
+  }
   
 #if INTERNAL_SAMPLE_RATE == 16000
   AudioInterpolator *up_sampler = new AudioInterpolator(
@@ -274,12 +286,9 @@ QsoImpl::QsoImpl(const StationData &station, ModuleEchoLink *module)
 
 QsoImpl::~QsoImpl(void)
 {
-  AudioSink::clearHandler();
   AudioSource::clearHandler();
   delete event_handler;
-  delete output_sel;
   delete msg_handler;
-  delete sink_handler;
   delete idle_timer;
   delete destroy_timer;
 } /* QsoImpl::~QsoImpl */
@@ -319,6 +328,16 @@ bool QsoImpl::sendAudioRaw(Qso::RawPacket *packet)
 } /* QsoImpl::sendAudioRaw */
 
 
+void QsoImpl::sendEncodedAudio(SharedEncoder &encoder)
+{
+    // Audio from the logic core is dropped while playing a message
+  if (!msg_handler->isWritingMessage())
+  {
+    m_qso.sendEncodedAudio(encoder);
+  }
+} /* QsoImpl::sendEncodedAudio */
+
+
 bool QsoImpl::connect(void)
 {
   if (destroy_timer != 0)
@@ -498,6 +517,11 @@ void QsoImpl::onStateChange(Qso::State state)
   {
     case Qso::STATE_DISCONNECTED:
       cout << "DISCONNECTED\n";
+      if (jitter_fifo != 0)
+      {
+        cout << remoteCallsign() << ": Jitter buffer statistics: "
+             << jitter_fifo->statistics() << endl;
+      }
       if (!reject_qso)
       {
       	stringstream ss;
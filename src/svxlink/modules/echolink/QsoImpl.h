@@ -47,7 +47,6 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
-#include <AsyncAudioSink.h>
 #include <AsyncAudioSource.h>
 #include <EchoLinkQso.h>
 #include <EchoLinkStationData.h>
@@ -71,7 +70,7 @@ namespace Async
 {
   class Config;
   class AudioPacer;
-  class AudioPassthrough;
+  class AudioAdaptiveJitterFifo;
 };
 
 
@@ -127,7 +126,7 @@ class ModuleEchoLink;
 A class that implementes the things needed for one EchoLink Qso.
 */
 class QsoImpl
-  : public Async::AudioSink, public Async::AudioSource, public sigc::trackable
+  : public Async::AudioSource, public sigc::trackable
 {
   public:
     /**
@@ -167,6 +166,18 @@ class QsoImpl
      * audioReceivedRaw signal.
      */
     bool sendAudioRaw(EchoLink::Qso::RawPacket *packet);
+
+    /**
+     * @brief 	Send audio from a shared encoder to the remote station
+     * @param 	encoder The shared encoder holding the encoded audio
+     *
+     * This function should be connected to the packetReady signal of the
+     * shared encoder that encode the audio from the logic core. The packet
+     * is dropped while a message is being played to the remote station, in
+     * the same way as the audio from the logic core was discarded by the
+     * output selector before the shared encoder was introduced.
+     */
+    void sendEncodedAudio(EchoLink::SharedEncoder &encoder);
     
     /**
      * @brief 	Initiate a connection to the remote station
@@ -321,7 +332,6 @@ class QsoImpl
     ModuleEchoLink    	    *module;
     EventHandler      	    *event_handler;
     MsgHandler	      	    *msg_handler;
-    Async::AudioSelector    *output_sel;
     bool      	      	    init_ok;
     bool      	      	    reject_qso;
     std::string       	    last_message;
@@ -332,8 +342,8 @@ class QsoImpl
     int       	      	    idle_timeout;
     Async::Timer	    *destroy_timer;
     EchoLink::StationData   station;
-    Async::AudioPassthrough *sink_handler;
     std::string             sysop_name;
+    Async::AudioAdaptiveJitterFifo *jitter_fifo;
     
     void allRemoteMsgsWritten(void);
     void onInfoMsgReceived(const std::string& msg);
@@ -57,6 +57,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncAudioDebugger.h>
 #include <AsyncTcpClient.h>
 #include <AsyncTimer.h>
+#include <AsyncAudioSampleConv.h>
 
 
 /****************************************************************************
@@ -379,16 +380,10 @@ int QsoFrn::writeSamples(const float *samples, int count)
   while (samples_read < count)
   {
     int read_cnt = min(BUFFER_SIZE - send_buffer_cnt, count-samples_read);
-    for (int i = 0; i < read_cnt; i++)
-    {
-      float sample = samples[samples_read++];
-      if (sample > 1)
-        send_buffer[send_buffer_cnt++] = 32767;
-      else if (sample < -1)
-        send_buffer[send_buffer_cnt++] = -32767;
-      else
-        send_buffer[send_buffer_cnt++] = static_cast<int16_t>(32767.0 * sample);
-    }
+    AudioSampleConv::floatToS16(send_buffer + send_buffer_cnt,
+                                samples + samples_read, read_cnt);
+    send_buffer_cnt += read_cnt;
+    samples_read += read_cnt;
     if (send_buffer_cnt == BUFFER_SIZE)
     {
       if (state == STATE_TX_AUDIO)
@@ -627,8 +622,7 @@ int QsoFrn::handleAudioData(unsigned char *data, int len)
       if (!is_gsm_decode_success)
         cerr << "gsm decoder failed to decode frame " << frameno << endl;
 
-      for (int i = 0; i < PCM_FRAME_SIZE; i++)
-         pcm_samples[i] = static_cast<float>(pcm_buffer[i]) / 32768.0;
+      AudioSampleConv::s16ToFloat(pcm_samples, pcm_buffer, PCM_FRAME_SIZE);
 
       int all_written = 0;
       while (all_written < PCM_FRAME_SIZE)
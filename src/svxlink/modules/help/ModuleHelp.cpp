@@ -317,11 +317,11 @@ void ModuleHelp::playChooseModuleMsg(void)
   stringstream ss;
   ss << "choose_module [list";
 
-  list<Module*> modules = moduleList();
-  list<Module*>::const_iterator it;
+  map<int, string> modules = moduleNames();
+  map<int, string>::const_iterator it;
   for (it=modules.begin(); it!=modules.end(); ++it)
   {
-    ss << " " << (*it)->id() << " " << (*it)->name();
+    ss << " " << it->first << " " << it->second;
   }
   ss << "]";
   processEvent(ss.str());
@@ -0,0 +1,339 @@
+/*
+ * Corpus test for the METAR parser in the MetarInfo module.
+ *
+ * A set of representative METAR reports is run through
+ * ModuleMetarInfo::handleMetar and the events that would have been sent to
+ * the TCL event handler are compared to the expected ones. The module is
+ * linked against the minimal Module implementation below instead of the
+ * real one so that no logic core is needed.
+ *
+ * Usage: MetarCorpusTest [-v] [-f file]
+ *
+ *   -v  Print the events generated for each report
+ *   -f  Parse the reports in the given file, one per line, and print the
+ *       events instead of checking the built in corpus
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <AsyncConfig.h>
+
+#include "version/SVXLINK.h"
+#include "ModuleMetarInfo.h"
+
+using namespace std;
+using namespace Async;
+
+
+static const char *CFG_NAME = "ModuleMetarInfo";
+
+
+namespace {
+  Config          cfg;
+  vector<string>  events;
+};
+
+
+/*
+ * Minimal Module implementation that record the events instead of handing
+ * them to the logic core
+ */
+Module::Module(void *dl_handle, Logic *logic, const string& cfg_name)
+  : m_dl_handle(dl_handle), m_logic(logic), m_id(-1), m_name(cfg_name),
+    m_is_transmitting(false), m_is_active(false), m_cfg_name(cfg_name),
+    m_tmo_timer(0)
+{
+}
+
+Module::~Module(void) {}
+
+bool Module::initialize(void)
+{
+  return strcmp(compiledForVersion(), SVXLINK_VERSION) == 0;
+}
+
+Config &Module::cfg(void) const { return ::cfg; }
+void Module::dtmfCmdReceivedWhenIdle(const std::string &cmd) {}
+void Module::processEvent(const string& event) { events.push_back(event); }
+void Module::deactivateMe(void) {}
+void Module::logicIdleStateChanged(bool is_idle) {}
+
+
+struct CorpusEntry
+{
+  const char *metar;
+  const char *events[32];
+};
+
+static const CorpusEntry corpus[] =
+{
+  {
+    "ESSA 181250Z 02005KT CAVOK 12/04 Q1021 NOSIG",
+    {
+      "metar \"ESSA 181250Z 02005KT CAVOK 12/04 Q1021 NOSIG\"",
+      "airports ",
+      "say airport",
+      "metreport_time 1250",
+      "wind 020 05 unit_kts",
+      "say cavok",
+      "temperature 12",
+      "dewpoint 4",
+      "qnh 1021",
+      "trend nosig",
+      0
+    }
+  },
+  {
+    "EDDF 181250Z 24012KT 9999 FEW035 SCT250 18/09 Q1014 NOSIG",
+    {
+      "metar \"EDDF 181250Z 24012KT 9999 FEW035 SCT250 18/09 Q1014 NOSIG\"",
+      "airports ",
+      "say airport",
+      "metreport_time 1250",
+      "wind 240 12 unit_kts",
+      "visibility more_than 10 unit_kms",
+      "say clouds",
+      "clouds few 3500",
+      "clouds sct 25000",
+      "temperature 18",
+      "dewpoint 9",
+      "qnh 1014",
+      "trend nosig",
+      0
+    }
+  },
+  {
+    "EGLL 181250Z 22008KT 190V250 4000 -RA BR BKN008 OVC015 14/13 Q1008 "
+    "TEMPO 3000 RA",
+    {
+      "metar \"EGLL 181250Z 22008KT 190V250 4000 -RA BR BKN008 "
+      "OVC015 14/13 Q1008 TEMPO 3000 RA\"",
+      "airports ",
+      "say airport",
+      "metreport_time 1250",
+      "wind 220 08 unit_kts",
+      "windvaries 190 250",
+      "visibility 4000 unit_meters",
+      "actualWX light ra",
+      "actualWX moderate br",
+      "say clouds",
+      "clouds bkn 800",
+      "clouds ovc 1500",
+      "temperature 14",
+      "dewpoint 13",
+      "qnh 1008",
+      "say tempo",
+      "visibility 3000 unit_meters",
+      "actualWX moderate ra",
+      0
+    }
+  },
+  {
+    "LFPG 181230Z 00000KT 0300 R27L/0550N FG VV001 08/08 Q1025 BECMG 0800",
+    {
+      "metar \"LFPG 181230Z 00000KT 0300 R27L/0550N FG VV001 08/08 "
+      "Q1025 BECMG 0800\"",
+      "airports ",
+      "say airport",
+      "metreport_time 1230",
+      "wind calm",
+      "visibility 300 unit_meters",
+      "rvr 27 left rvr 550 unit_meters ndt",
+      "actualWX moderate fg",
+      "ceiling 100",
+      "temperature 8",
+      "dewpoint 8",
+      "qnh 1025",
+      "trend becmg",
+      "visibility 800 unit_meters",
+      0
+    }
+  },
+  {
+    "KJFK 181251Z 31015G25KT 10SM FEW050 BKN250 22/08 A3002 RMK AO2 SLP166 "
+    "T02220083",
+    {
+      "metar \"KJFK 181251Z 31015G25KT 10SM FEW050 BKN250 22/08 "
+      "A3002 RMK AO2 SLP166 T02220083\"",
+      "airports ",
+      "say airport",
+      "metreport_time 1251",
+      "wind 310 15 unit_kts 25 unit_kts",
+      "visibility 10 unit_miles",
+      "say clouds",
+      "clouds few 5000",
+      "clouds bkn 25000",
+      "temperature 22",
+      "dewpoint 8",
+      "altimeter 30.02",
+      0
+    }
+  },
+  {
+    "KORD 181251Z 28010KT 1 1/2SM +TSRA BKN020CB 24/21 A2985",
+    {
+      "metar \"KORD 181251Z 28010KT 1 1/2SM +TSRA BKN020CB 24/21 A2985\"",
+      "airports ",
+      "say airport",
+      "metreport_time 1251",
+      "wind 280 10 unit_kts",
+      "visibility 1.5 unit_miles",
+      "actualWX heavy ts ra",
+      "say clouds",
+      "clouds bkn 2000 cld_cb",
+      "temperature 24",
+      "dewpoint 21",
+      "altimeter 29.85",
+      0
+    }
+  },
+  {
+    "UUEE 181230Z 16003MPS 9999 -SHSN OVC010 M02/M04 Q1002 R06L/290050 NOSIG",
+    {
+      "metar \"UUEE 181230Z 16003MPS 9999 -SHSN OVC010 M02/M04 "
+      "Q1002 R06L/290050 NOSIG\"",
+      "airports ",
+      "say airport",
+      "metreport_time 1230",
+      "wind 160 03 unit_mps",
+      "visibility more_than 10 unit_kms",
+      "actualWX light sn sh ",
+      "say clouds",
+      "clouds ovc 1000",
+      "temperature -2",
+      "dewpoint -4",
+      "qnh 1002",
+      "runwaystate runway 06 left wet_or_water_patches "
+      "contamination 51 to 100 percent deposit_depth less_than 1 unit_mm  "
+      "friction_coefficient 0.50",
+      "trend nosig",
+      0
+    }
+  },
+  { 0, { 0 } }
+};
+
+
+static void printEvents(void)
+{
+  for (vector<string>::const_iterator it = events.begin();
+       it != events.end(); ++it)
+  {
+    cout << "  " << *it << endl;
+  }
+}
+
+
+static bool checkEntry(ModuleMetarInfo &module, const CorpusEntry &entry,
+                       bool verbose)
+{
+  events.clear();
+  module.handleMetar(entry.metar);
+
+  unsigned expected_cnt = 0;
+  while (entry.events[expected_cnt] != 0)
+  {
+    ++expected_cnt;
+  }
+
+  bool ok = (events.size() == expected_cnt);
+  for (unsigned i = 0; ok && (i < expected_cnt); ++i)
+  {
+    ok = (events[i] == entry.events[i]);
+  }
+
+  cout << (ok ? "OK    " : "FAIL  ") << entry.metar << endl;
+  if (!ok)
+  {
+    cout << " Expected:" << endl;
+    for (unsigned i = 0; i < expected_cnt; ++i)
+    {
+      cout << "  " << entry.events[i] << endl;
+    }
+    cout << " Got:" << endl;
+  }
+  if (!ok || verbose)
+  {
+    printEvents();
+  }
+
+  return ok;
+}
+
+
+int main(int argc, const char **argv)
+{
+  bool verbose = false;
+  const char *filename = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-v") == 0)
+    {
+      verbose = true;
+    }
+    else if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc))
+    {
+      filename = argv[++i];
+    }
+    else
+    {
+      cerr << "Usage: MetarCorpusTest [-v] [-f file]\n";
+      exit(1);
+    }
+  }
+
+  cfg.setValue(CFG_NAME, "AIRPORTS", "ESSA,EDDF,KJFK");
+  cfg.setValue(CFG_NAME, "TYPE", "TXT");
+  cfg.setValue(CFG_NAME, "SERVER", "localhost");
+  cfg.setValue(CFG_NAME, "CACHE_TTL", "0");
+
+  ModuleMetarInfo module(0, 0, CFG_NAME);
+  Module *base = &module;
+  if (!base->initialize())
+  {
+    cerr << "*** ERROR: Could not initialize the MetarInfo module\n";
+    exit(1);
+  }
+
+  if (filename != 0)
+  {
+    ifstream ifs(filename);
+    if (!ifs)
+    {
+      cerr << "*** ERROR: Could not open " << filename << endl;
+      exit(1);
+    }
+    string line;
+    while (getline(ifs, line))
+    {
+      if (line.empty())
+      {
+        continue;
+      }
+      events.clear();
+      module.handleMetar(line);
+      cout << line << endl;
+      printEvents();
+    }
+    return 0;
+  }
+
+  unsigned fail_cnt = 0;
+  unsigned cnt = 0;
+  for (; corpus[cnt].metar != 0; ++cnt)
+  {
+    if (!checkEntry(module, corpus[cnt], verbose))
+    {
+      ++fail_cnt;
+    }
+  }
+
+  cout << cnt - fail_cnt << " of " << cnt << " reports OK" << endl;
+
+  return (fail_cnt == 0) ? 0 : 1;
+}
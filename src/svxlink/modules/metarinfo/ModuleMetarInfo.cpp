@@ -145,6 +145,8 @@ using namespace SvxLink;
 #define NOTACTUAL 98
 #define INVALID 99
 
+#define DEFAULT_CACHE_TTL 600
+
 
 /****************************************************************************
  *
@@ -220,7 +222,8 @@ extern "C" {
 
 ModuleMetarInfo::ModuleMetarInfo(void *dl_handle, Logic *logic,
                                  const string& cfg_name)
-  : Module(dl_handle, logic, cfg_name), remarks(false), debug(false), con(0)
+  : Module(dl_handle, logic, cfg_name), remarks(false), debug(false),
+    cache_ttl(DEFAULT_CACHE_TTL), con(0)
 {
   cout << "\tModule MetarInfo v" MODULE_METARINFO_VERSION " starting...\n";
 
@@ -230,6 +233,7 @@ ModuleMetarInfo::ModuleMetarInfo(void *dl_handle, Logic *logic,
 ModuleMetarInfo::~ModuleMetarInfo(void)
 {
    delete con;
+   freeTokenPatterns();
 } /* ~ModuleMetarInfo */
 
 
@@ -416,6 +420,20 @@ bool ModuleMetarInfo::initialize(void)
      longmsg = "_long ";  // taking "cavok_long" instead of "cavok"
   }
 
+  // Time in seconds a fetched METAR is reused before asking the server
+  // again. Zero disables the cache.
+  if (!cfg().getValue(cfgName(), "CACHE_TTL", cache_ttl, true))
+  {
+    cout << "*** ERROR: Config variable " << cfgName()
+         << "/CACHE_TTL is not valid.\n";
+    return false;
+  }
+
+  if (!compileTokenPatterns())
+  {
+    return false;
+  }
+
   return true;
 
 } /* initialize */
@@ -438,7 +456,7 @@ void ModuleMetarInfo::activateInit(void)
   if (icao_default.length() == 4)
   {
       icao = icao_default;
-      openConnection();
+      requestMetar();
   }
 } /* activateInit */
 
@@ -595,7 +613,7 @@ void ModuleMetarInfo::dtmfCmdReceived(const string& cmd)
   else if (icmd <= (int)aplist.size() && icmd > 0)
   {
      icao = aplist[icmd - 1];
-     openConnection();
+     requestMetar();
      return;
   }
 
@@ -603,7 +621,7 @@ void ModuleMetarInfo::dtmfCmdReceived(const string& cmd)
   if (icao.length() == 4)
   {
      if (debug) cout << "icao-code by dtmf-method: " << icao << endl;
-     openConnection();
+     requestMetar();
   }
   else
   {
@@ -662,6 +680,25 @@ void ModuleMetarInfo::allMsgsWritten(void)
 } /* allMsgsWritten */
 
 
+/*
+* give out the METAR for the current icao, from the cache if possible
+*/
+void ModuleMetarInfo::requestMetar(void)
+{
+  string metar;
+  if (getCachedMetar(metar))
+  {
+    if (debug)
+    {
+      cout << "Using cached METAR for " << icao << ": " << metar << endl;
+    }
+    handleMetar(metar);
+    return;
+  }
+  openConnection();
+} /* requestMetar */
+
+
 /*
 * establish a tcp-connection to the METAR-Server
 */
@@ -669,6 +706,7 @@ void ModuleMetarInfo::openConnection(void)
 {
   if (con == 0)
   {
+    html.clear();
     con = new TcpClient<>(server, 80);
     con->connected.connect(mem_fun(*this, &ModuleMetarInfo::onConnected));
     con->disconnected.connect(mem_fun(*this, &ModuleMetarInfo::onDisconnected));
@@ -714,7 +752,12 @@ int ModuleMetarInfo::onDataReceived(TcpConnection *con, void *buf, int count)
     // look for raw metar data
     metar = getXmlParam("raw_text", html);
 
-    if (metar.length() > 0)
+    if (metar.empty())
+    {
+      // Wait for the rest of the document
+      return count;
+    }
+    else
     {
       html = "";
       if (debug)
@@ -774,6 +817,7 @@ int ModuleMetarInfo::onDataReceived(TcpConnection *con, void *buf, int count)
     }
   }
 
+  cacheMetar(metar);
   handleMetar(metar);
   return count;
 
@@ -804,7 +848,7 @@ std::string ModuleMetarInfo::getXmlParam(std::string token, std::string input)
 } /* getXmlParam */
 
 
-int ModuleMetarInfo::handleMetar(std::string input)
+int ModuleMetarInfo::handleMetar(const std::string &input)
 {
    std::string current;
    std::string tempstr;
@@ -1172,17 +1216,13 @@ int ModuleMetarInfo::handleMetar(std::string input)
 }
 
 
-// here we check the current METAR-token with regex
-// function, it returns the type (temperature, dewpoint, clouds, ...)
-int ModuleMetarInfo::checkToken(std::string token)
+// The METAR token patterns are compiled once when the module is initialized
+// since they are matched against every token of every report
+bool ModuleMetarInfo::compileTokenPatterns(void)
 {
-    regex_t re;
-    int retvalue = INVALID;
     typedef std::map<std::string, int> Mregex;
     Mregex mre;
 
-    map<string, int>::iterator rt;
-
     mre["^[0-9]/[0-9]sm$"]                           = ISPARTOFMILES;
     mre["^(a|q)([0-9]{4})$"]                         = QNH;
     mre["^([0-9]{3}|vrb)([0-9]{2}g)?([0-9]{2})(kt|mph|mps|kph)"] = WIND; // wind
@@ -1234,17 +1274,52 @@ int ModuleMetarInfo::checkToken(std::string token)
     mre["^((ac|acc|as|cb|cbmam|cc|cf|ci|cs|cu|tcu|ns|sc|sf|st)[1-8]){1,4}$"] = CLOUDTYPE;
     mre["^(mar|alqds|mod|twr|sfc|dsnt|lan|loc|fir|presrr|presfr|abv|agl|btn|cld|cot|nil|obs|obsc|stnr|turb|valid|wkn|wspd|ltg|wx)$"] = WORDSINRMK;
 
-    for (rt = mre.begin(); rt != mre.end(); rt++)
+      // The patterns are tried in map order, first match wins
+    freeTokenPatterns();
+    tokpatterns.reserve(mre.size());
+    for (Mregex::const_iterator rt = mre.begin(); rt != mre.end(); rt++)
+    {
+       TokenPattern tp;
+       if (regcomp(&tp.re, rt->first.c_str(), REG_EXTENDED | REG_NOSUB) != 0)
+       {
+          cout << "*** ERROR: Could not compile METAR token pattern \""
+               << rt->first << "\"\n";
+          freeTokenPatterns();
+          return false;
+       }
+       tp.type = rt->second;
+       tokpatterns.push_back(tp);
+    }
+
+    return true;
+} /* compileTokenPatterns */
+
+
+void ModuleMetarInfo::freeTokenPatterns(void)
+{
+    for (TokenPatterns::iterator it = tokpatterns.begin();
+         it != tokpatterns.end(); ++it)
     {
-       if (rmatch(token, rt->first, &re))
+       regfree(&it->re);
+    }
+    tokpatterns.clear();
+} /* freeTokenPatterns */
+
+
+// here we check the current METAR-token with the precompiled regex
+// patterns, it returns the type (temperature, dewpoint, clouds, ...)
+int ModuleMetarInfo::checkToken(const std::string &token)
+{
+    for (TokenPatterns::iterator it = tokpatterns.begin();
+         it != tokpatterns.end(); ++it)
+    {
+       if (regexec(&it->re, token.c_str(), 0, NULL, 0) == 0)
        {
-           retvalue = rt->second;
-           break;
+           return it->type;
        }
     }
-    regfree(&re);
 
-    return retvalue;
+    return INVALID;
 } /* checkToken */
 
 
@@ -1648,21 +1723,53 @@ bool ModuleMetarInfo::isActualWX(std::string &retval, std::string token)
 } /* isActualWX */
 
 
-// needed by regex
-bool ModuleMetarInfo::rmatch(std::string tok, std::string pattern, regex_t *re)
+bool ModuleMetarInfo::getCachedMetar(std::string &metar)
 {
-  int status;
+  ReportCache::iterator it = report_cache.find(icao);
+  if (it == report_cache.end())
+  {
+    return false;
+  }
 
-  if (( status = regcomp(re, pattern.c_str(), REG_EXTENDED)) != 0 )
+  if ((cache_ttl == 0) ||
+      (difftime(time(NULL), it->second.timestamp) >= cache_ttl))
   {
+    report_cache.erase(it);
     return false;
   }
 
-  bool success = (regexec(re, tok.c_str(), 0, NULL, 0) == 0);
-  regfree(re);
-  return success;
+  metar = it->second.metar;
+  return true;
+} /* getCachedMetar */
+
+
+void ModuleMetarInfo::cacheMetar(const std::string &metar)
+{
+  if (cache_ttl == 0)
+  {
+    return;
+  }
+
+    // Throw out old reports so that the cache does not grow forever when
+    // many different stations are requested
+  time_t now = time(NULL);
+  ReportCache::iterator it = report_cache.begin();
+  while (it != report_cache.end())
+  {
+    if (difftime(now, it->second.timestamp) >= cache_ttl)
+    {
+      report_cache.erase(it++);
+    }
+    else
+    {
+      ++it;
+    }
+  }
 
-} /* rmatch */
+  CachedReport &report = report_cache[icao];
+  report.metar = metar;
+  report.timestamp = now;
+} /* cacheMetar */
 
 
 bool ModuleMetarInfo::isvalidUTC(std::string utctoken)
@@ -43,6 +43,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <list>
 #include <map>
 #include <iostream>
+#include <ctime>
+#include <regex.h>
 
 
 /****************************************************************************
@@ -126,6 +128,17 @@ class ModuleMetarInfo : public Module
     ~ModuleMetarInfo(void);
     const char *compiledForVersion(void) const { return SVXLINK_VERSION; }
 
+    /**
+     * @brief 	Announce a raw METAR report
+     * @param 	input The METAR report, e.g. "ESSA 181250Z 02005KT CAVOK ..."
+     * @return	Always returns 1
+     *
+     * The report is split into tokens and an event is processed for each
+     * recognized token. This is normally called when a report has been
+     * received from the server but it's also used by the corpus test.
+     */
+    int handleMetar(const std::string &input);
+
   protected:
     virtual void resumeOutput(void);
     virtual void allSamplesFlushed(void);
@@ -149,6 +162,23 @@ class ModuleMetarInfo : public Module
     typedef std::map<std::string, std::string> Repdefs;
     Repdefs repstr;
 
+    struct TokenPattern
+    {
+      regex_t re;
+      int     type;
+    };
+    typedef std::vector<TokenPattern> TokenPatterns;
+    TokenPatterns tokpatterns;
+
+    struct CachedReport
+    {
+      std::string metar;
+      time_t      timestamp;
+    };
+    typedef std::map<std::string, CachedReport> ReportCache;
+    ReportCache   report_cache;
+    unsigned      cache_ttl;
+
     Async::TcpClient<> *con;
     std::string html;
     std::string type;
@@ -167,6 +197,11 @@ class ModuleMetarInfo : public Module
                         Async::TcpClient<>::DisconnectReason reason);
     void onConnected(void);
     void openConnection(void);
+    void requestMetar(void);
+    bool compileTokenPatterns(void);
+    void freeTokenPatterns(void);
+    bool getCachedMetar(std::string &metar);
+    void cacheMetar(const std::string &metar);
     std::string getSlp(std::string token);
     std::string getTempTime(std::string token);
     std::string getTempinRmk(std::string token);
@@ -182,8 +217,7 @@ class ModuleMetarInfo : public Module
     int  splitEmptyStr(StrList& L, const std::string& seq);
     bool isWind(std::string &retval, std::string token);
     bool isvalidUTC(std::string utctoken);
-    int checkToken(std::string token);
-    bool rmatch(std::string tok, std::string token, regex_t *re);
+    int checkToken(const std::string &token);
     bool checkDirection(std::string &retval, std::string token);
     bool getRmkVisibility(std::string &retval, std::string token);
     void isTime(std::string &retval, std::string token);
@@ -200,7 +234,6 @@ class ModuleMetarInfo : public Module
     bool ispObscurance(std::string &tempstr, std::string token);
     bool getPeakWind(std::string &retval, std::string token);
     void say(std::stringstream &tmp);
-    int handleMetar(std::string input);
     std::string getXmlParam(std::string token, std::string input);
 
 };  /* class ModuleMetarInfo */
@@ -31,6 +31,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <cassert>
+#include <algorithm>
+#include <ctime>
 
 
 /****************************************************************************
@@ -43,6 +45,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncTcpServer.h>
 #include <AsyncUdpSocket.h>
 #include <AsyncApplication.h>
+#include <AsyncMetrics.h>
+#include <common.h>
 
 
 /****************************************************************************
@@ -53,6 +57,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "Reflector.h"
 #include "ReflectorClient.h"
+#include "ReflectorTranscoder.h"
 
 
 
@@ -73,6 +78,8 @@ using namespace Async;
  *
  ****************************************************************************/
 
+#define LOG_SUBSYS "REFLECTOR"
+
 
 
 /****************************************************************************
@@ -120,11 +127,29 @@ void delete_client(ReflectorClient *client);
 Reflector::Reflector(void)
   : m_srv(0), m_udp_sock(0), m_talker(0),
     m_talker_timeout_timer(1000, Timer::TYPE_PERIODIC),
-    m_sql_timeout(0), m_sql_timeout_cnt(0), m_sql_timeout_blocktime(60)
+    m_sql_timeout(0), m_sql_timeout_cnt(0), m_sql_timeout_blocktime(60),
+    m_cfg(0), m_transcoder(0), m_next_node_id(1),
+    m_node_update_timer(NODE_UPDATE_DELAY, Timer::TYPE_ONESHOT, false),
+    m_session_resume_time(300)
 {
+  m_udp_rx_cnt = Metrics::counter("svxreflector_udp_rx_packets_total",
+      "Received UDP packets");
+  m_udp_tx_cnt = Metrics::counter("svxreflector_udp_tx_packets_total",
+      "Sent UDP packets");
+  m_udp_lost_cnt = Metrics::counter("svxreflector_udp_lost_frames_total",
+      "UDP frames lost on the way from the clients");
+  m_talker_cnt = Metrics::counter("svxreflector_talker_starts_total",
+      "Number of times a node has started talking");
+  m_nodes_gauge = Metrics::gauge("svxreflector_connected_nodes",
+      "Number of logged in nodes");
+  m_talker_gauge = Metrics::gauge("svxreflector_talker_active",
+      "1 if a node is talking, otherwise 0");
+
   timerclear(&m_last_talker_timestamp);
   m_talker_timeout_timer.expired.connect(
       mem_fun(*this, &Reflector::checkTalkerTimeout));
+  m_node_update_timer.expired.connect(
+      mem_fun(*this, &Reflector::sendNodeUpdate));
 } /* Reflector::Reflector */
 
 
@@ -138,6 +163,8 @@ Reflector::~Reflector(void)
   {
     delete (*it).second;
   }
+
+  delete m_transcoder;
 } /* Reflector::~Reflector */
 
 
@@ -167,6 +194,52 @@ bool Reflector::initialize(Async::Config &cfg)
     }
   }
 
+  string codecs;
+  if (cfg.getValue("GLOBAL", "CODECS", codecs))
+  {
+    SvxLink::splitStr(m_codecs, codecs, ",");
+  }
+  if (m_codecs.size() > 1)
+  {
+      // More than one codec means that audio must be transcoded between the
+      // codec groups so all codecs must have both an encoder and a decoder
+    vector<string>::iterator it = m_codecs.begin();
+    while (it != m_codecs.end())
+    {
+      if (!ReflectorTranscoder::codecIsAvailable(*it))
+      {
+        cerr << "*** WARNING: Codec \"" << *it << "\" in GLOBAL/CODECS is "
+                "not available for transcoding. Ignoring it." << endl;
+        it = m_codecs.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+  if (m_codecs.empty())
+  {
+    string codec = "GSM";
+    if (ReflectorTranscoder::codecIsAvailable("OPUS"))
+    {
+      codec = "OPUS";
+    }
+    else if (ReflectorTranscoder::codecIsAvailable("SPEEX"))
+    {
+      codec = "SPEEX";
+    }
+    m_codecs.push_back(codec);
+  }
+  if (m_codecs.size() > 1)
+  {
+    m_transcoder = new ReflectorTranscoder;
+    m_transcoder->transcodedAudio.connect(
+        mem_fun(*this, &Reflector::transcodedAudio));
+    m_transcoder->transcodedFlush.connect(
+        mem_fun(*this, &Reflector::transcodedFlush));
+  }
+
   std::string listen_port("5300");
   cfg.getValue("GLOBAL", "LISTEN_PORT", listen_port);
   m_srv = new TcpServer<FramedTcpConnection>(listen_port);
@@ -189,6 +262,7 @@ bool Reflector::initialize(Async::Config &cfg)
   cfg.getValue("GLOBAL", "SQL_TIMEOUT", m_sql_timeout);
   cfg.getValue("GLOBAL", "SQL_TIMEOUT_BLOCKTIME", m_sql_timeout_blocktime);
   m_sql_timeout_blocktime = max(m_sql_timeout_blocktime, 1U);
+  cfg.getValue("GLOBAL", "SESSION_RESUME_TIME", m_session_resume_time);
 
   return true;
 } /* Reflector::initialize */
@@ -197,29 +271,86 @@ bool Reflector::initialize(Async::Config &cfg)
 void Reflector::nodeList(std::vector<std::string>& nodes) const
 {
   nodes.clear();
-  for (ReflectorClientMap::const_iterator it = m_client_map.begin();
-       it != m_client_map.end(); ++it)
+  nodes.reserve(m_nodes.size());
+  for (NodeMap::const_iterator it = m_nodes.begin(); it != m_nodes.end(); ++it)
+  {
+    nodes.push_back((*it).second);
+  }
+} /* Reflector::nodeList */
+
+
+bool Reflector::nodeIsConnected(const std::string& callsign) const
+{
+  NodeIdMap::const_iterator it = m_node_ids.find(callsign);
+  return (it != m_node_ids.end()) &&
+         (m_nodes.find((*it).second) != m_nodes.end());
+} /* Reflector::nodeIsConnected */
+
+
+bool Reflector::useSessionToken(const std::vector<uint8_t>& token,
+                                uint32_t expires)
+{
+    // Forget the tokens that have expired since they cannot be used anyway
+  uint32_t now = time(NULL);
+  SessionTokenMap::iterator it = m_used_session_tokens.begin();
+  while (it != m_used_session_tokens.end())
   {
-    const std::string& callsign = (*it).second->callsign();
-    if (!callsign.empty())
+    if (it->second <= now)
     {
-      nodes.push_back(callsign);
+      m_used_session_tokens.erase(it++);
+    }
+    else
+    {
+      ++it;
     }
   }
-} /* Reflector::nodeList */
+
+  return m_used_session_tokens.insert(make_pair(token, expires)).second;
+} /* Reflector::useSessionToken */
+
+
+void Reflector::nodeJoined(ReflectorClient *client)
+{
+  uint16_t node_id = nodeId(client->callsign());
+  m_nodes[node_id] = client->callsign();
+  m_nodes_gauge->set(m_nodes.size());
+
+  broadcastMsgExcept(MsgNodeJoined(client->callsign()), client, PROTO_LEGACY);
+
+  std::vector<uint16_t>& left = m_node_update.left();
+  left.erase(std::remove(left.begin(), left.end(), node_id), left.end());
+  m_node_update.joined()[node_id] = client->callsign();
+  if (m_node_update.size() >= MAX_NODE_UPDATE_SIZE)
+  {
+    sendNodeUpdate();
+  }
+  else
+  {
+    m_node_update_timer.setEnable(true);
+  }
+} /* Reflector::nodeJoined */
 
 
 void Reflector::broadcastMsgExcept(const ReflectorMsg& msg,
-                                   ReflectorClient *except)
+                                   ReflectorClient *except,
+                                   ProtoFilter filter)
 {
+  string frame;
+  if (!ReflectorClient::packMsg(msg, frame))
+  {
+    cerr << "*** ERROR: Failed to pack TCP message\n";
+    return;
+  }
   ReflectorClientMap::const_iterator it = m_client_map.begin();
   for (; it != m_client_map.end(); ++it)
   {
     ReflectorClient *client = (*it).second;
     if ((client != except) &&
-        (client->conState() == ReflectorClient::STATE_CONNECTED))
+        (client->conState() == ReflectorClient::STATE_CONNECTED) &&
+        ((filter == PROTO_ALL) ||
+         ((filter == PROTO_NODE_ID) == client->useNodeIds())))
     {
-      (*it).second->sendMsg(msg);
+      client->sendFrame(msg.type(), frame);
     }
   }
 } /* Reflector::broadcastMsgExcept */
@@ -228,6 +359,7 @@ void Reflector::broadcastMsgExcept(const ReflectorMsg& msg,
 bool Reflector::sendUdpDatagram(ReflectorClient *client, const void *buf,
                                 size_t count)
 {
+  m_udp_tx_cnt->inc();
   return m_udp_sock->write(client->remoteHost(), client->remoteUdpPort(), buf,
                            count);
 } /* Reflector::sendUdpDatagram */
@@ -285,7 +417,7 @@ void Reflector::clientDisconnected(Async::FramedTcpConnection *con,
 
   if (!client->callsign().empty())
   {
-    broadcastMsgExcept(MsgNodeLeft(client->callsign()), client);
+    nodeLeft(client);
   }
   Application::app().runTask(sigc::bind(sigc::ptr_fun(&delete_client), client));
 } /* Reflector::clientDisconnected */
@@ -294,27 +426,32 @@ void Reflector::clientDisconnected(Async::FramedTcpConnection *con,
 void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
                                     void *buf, int count)
 {
+  m_udp_rx_cnt->inc();
+
   stringstream ss;
   ss.write(reinterpret_cast<const char *>(buf), count);
 
   ReflectorUdpMsg header;
   if (!header.unpack(ss))
   {
-    cout << "*** WARNING: Unpacking failed for UDP message header\n";
+    ASYNC_LOG_LIMITED(Log::LEVEL_WARNING, LOG_SUBSYS, m_udp_warning_log_limit)
+      << "*** WARNING: Unpacking failed for UDP message header";
     return;
   }
 
   ReflectorClientMap::iterator it = m_client_map.find(header.clientId());
   if (it == m_client_map.end())
   {
-    cerr << "*** WARNING: Incoming UDP packet has invalid client id" << endl;
+    ASYNC_LOG_LIMITED(Log::LEVEL_WARNING, LOG_SUBSYS, m_udp_warning_log_limit)
+      << "*** WARNING: Incoming UDP packet has invalid client id";
     return;
   }
   ReflectorClient *client = (*it).second;
   if (addr != client->remoteHost())
   {
-    cerr << "*** WARNING[" << client->callsign()
-         << "]: Incoming UDP packet has the wrong source ip" << endl;
+    ASYNC_LOG_LIMITED(Log::LEVEL_WARNING, LOG_SUBSYS, m_udp_warning_log_limit)
+      << "*** WARNING[" << client->callsign()
+      << "]: Incoming UDP packet has the wrong source ip";
     return;
   }
   if (client->remoteUdpPort() == 0)
@@ -324,27 +461,32 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
   }
   else if (port != client->remoteUdpPort())
   {
-    cerr << "*** WARNING[" << client->callsign()
-         << "]: Incoming UDP packet has the wrong source UDP "
-            "port number" << endl;
+    ASYNC_LOG_LIMITED(Log::LEVEL_WARNING, LOG_SUBSYS, m_udp_warning_log_limit)
+      << "*** WARNING[" << client->callsign()
+      << "]: Incoming UDP packet has the wrong source UDP port number";
     return;
   }
 
     // Check sequence number
   uint16_t udp_rx_seq_diff = header.sequenceNum() - client->nextUdpRxSeq();
+  unsigned lost_frame_cnt = 0;
   if (udp_rx_seq_diff > 0x7fff) // Frame out of sequence (ignore)
   {
-    cout << client->callsign()
-         << ": Dropping out of sequence frame with seq="
-         << header.sequenceNum() << ". Expected seq="
-         << client->nextUdpRxSeq() << endl;
+    ASYNC_LOG_LIMITED(Log::LEVEL_INFO, LOG_SUBSYS, m_udp_seq_log_limit)
+      << client->callsign()
+      << ": Dropping out of sequence frame with seq="
+      << header.sequenceNum() << ". Expected seq="
+      << client->nextUdpRxSeq();
     return;
   }
   else if (udp_rx_seq_diff > 0) // Frame(s) lost
   {
-    cout << client->callsign()
-         << ": UDP frame(s) lost. Expected seq=" << client->nextUdpRxSeq()
-         << ". Received seq=" << header.sequenceNum() << endl;
+    ASYNC_LOG_LIMITED(Log::LEVEL_INFO, LOG_SUBSYS, m_udp_seq_log_limit)
+      << client->callsign()
+      << ": UDP frame(s) lost. Expected seq=" << client->nextUdpRxSeq()
+      << ". Received seq=" << header.sequenceNum();
+    lost_frame_cnt = udp_rx_seq_diff;
+    m_udp_lost_cnt->inc(lost_frame_cnt);
   }
 
   client->udpMsgReceived(header);
@@ -372,10 +514,14 @@ void Reflector::udpDatagramReceived(const IpAddress& addr, uint16_t port,
             setTalker(client);
             cout << m_talker->callsign() << ": Talker start" << endl;
           }
+          else if ((m_talker == client) && (lost_frame_cnt > 0))
+          {
+            broadcastTalkerLoss(lost_frame_cnt);
+          }
           if (m_talker == client)
           {
             gettimeofday(&m_last_talker_timestamp, NULL);
-            broadcastUdpMsgExcept(client, msg);
+            broadcastTalkerAudio(msg);
           }
         }
       }
@@ -430,6 +576,113 @@ void Reflector::broadcastUdpMsgExcept(const ReflectorClient *except,
 } /* Reflector::broadcastUdpMsgExcept */
 
 
+/**
+ * @brief  Send talker audio to all other clients
+ *
+ * Clients using the same codec as the talker get the audio forwarded as is.
+ * The codecs used by all other clients are collected and the audio is handed
+ * over to the transcoder, which decode it once and encode it once per codec.
+ */
+void Reflector::broadcastTalkerAudio(MsgUdpAudio& msg)
+{
+  assert(m_talker != 0);
+  const string& talker_codec = m_talker->codec();
+  set<string> dst_codecs;
+  for (ReflectorClientMap::iterator it = m_client_map.begin();
+       it != m_client_map.end(); ++it)
+  {
+    ReflectorClient *client = (*it).second;
+    if ((client == m_talker) ||
+        (client->conState() != ReflectorClient::STATE_CONNECTED))
+    {
+      continue;
+    }
+    if (client->codec() == talker_codec)
+    {
+      client->sendUdpMsg(msg);
+    }
+    else
+    {
+      dst_codecs.insert(client->codec());
+    }
+  }
+
+  if (!dst_codecs.empty() && (m_transcoder != 0))
+  {
+    m_transcoder->writeEncodedSamples(talker_codec, dst_codecs,
+                                      &msg.audioData().front(),
+                                      msg.audioData().size());
+  }
+} /* Reflector::broadcastTalkerAudio */
+
+
+/**
+ * @brief  Forward packet loss in the talker stream to all other clients
+ *
+ * Clients using the same codec as the talker get a gap in their sequence
+ * numbers so that their decoder can conceal the lost audio. For transcoded
+ * clients, the loss is concealed by the transcoder decoder instead.
+ */
+void Reflector::broadcastTalkerLoss(unsigned lost_frame_cnt)
+{
+  assert(m_talker != 0);
+  uint16_t skip_cnt = (lost_frame_cnt < MAX_FORWARDED_LOSS)
+    ? lost_frame_cnt : MAX_FORWARDED_LOSS;
+  const string& talker_codec = m_talker->codec();
+  for (ReflectorClientMap::iterator it = m_client_map.begin();
+       it != m_client_map.end(); ++it)
+  {
+    ReflectorClient *client = (*it).second;
+    if ((client != m_talker) &&
+        (client->conState() == ReflectorClient::STATE_CONNECTED) &&
+        (client->codec() == talker_codec))
+    {
+      client->skipUdpTxSeq(skip_cnt);
+    }
+  }
+
+  if (m_transcoder != 0)
+  {
+    m_transcoder->packetsLost(lost_frame_cnt);
+  }
+} /* Reflector::broadcastTalkerLoss */
+
+
+void Reflector::transcodedAudio(const std::string& codec, const void *buf,
+                                int size)
+{
+  MsgUdpAudio msg(buf, size);
+  for (ReflectorClientMap::iterator it = m_client_map.begin();
+       it != m_client_map.end(); ++it)
+  {
+    ReflectorClient *client = (*it).second;
+    if ((client != m_talker) &&
+        (client->conState() == ReflectorClient::STATE_CONNECTED) &&
+        (client->codec() == codec))
+    {
+      client->sendUdpMsg(msg);
+    }
+  }
+} /* Reflector::transcodedAudio */
+
+
+void Reflector::transcodedFlush(const std::string& codec)
+{
+  MsgUdpFlushSamples msg;
+  for (ReflectorClientMap::iterator it = m_client_map.begin();
+       it != m_client_map.end(); ++it)
+  {
+    ReflectorClient *client = (*it).second;
+    if ((client != m_talker) &&
+        (client->conState() == ReflectorClient::STATE_CONNECTED) &&
+        (client->codec() == codec))
+    {
+      client->sendUdpMsg(msg);
+    }
+  }
+} /* Reflector::transcodedFlush */
+
+
 void Reflector::checkTalkerTimeout(Async::Timer *t)
 {
   if (m_talker != 0)
@@ -464,21 +717,115 @@ void Reflector::setTalker(ReflectorClient *client)
 
   if (client == 0)
   {
-    broadcastMsgExcept(MsgTalkerStop(m_talker->callsign()));
-    broadcastUdpMsgExcept(m_talker, MsgUdpFlushSamples());
+    if (m_transcoder != 0)
+    {
+      m_transcoder->flushEncodedSamples();
+    }
+    sendNodeUpdate();
+    broadcastMsgExcept(MsgTalkerStop(m_talker->callsign()), 0, PROTO_LEGACY);
+    broadcastMsgExcept(MsgTalkerStopNode(nodeId(m_talker->callsign())), 0,
+                       PROTO_NODE_ID);
+    if (m_transcoder == 0)
+    {
+      broadcastUdpMsgExcept(m_talker, MsgUdpFlushSamples());
+    }
+    else
+    {
+        // Clients getting transcoded audio are told to flush when the
+        // encoder for their codec has been flushed, in transcodedFlush
+      MsgUdpFlushSamples msg;
+      for (ReflectorClientMap::iterator it = m_client_map.begin();
+           it != m_client_map.end(); ++it)
+      {
+        ReflectorClient *c = (*it).second;
+        if ((c != m_talker) &&
+            (c->conState() == ReflectorClient::STATE_CONNECTED) &&
+            (c->codec() == m_talker->codec()))
+        {
+          c->sendUdpMsg(msg);
+        }
+      }
+    }
     m_sql_timeout_cnt = 0;
     m_talker = 0;
+    m_talker_gauge->set(0);
   }
   else
   {
     assert(m_talker == 0);
     m_sql_timeout_cnt = m_sql_timeout;
     m_talker = client;
-    broadcastMsgExcept(MsgTalkerStart(m_talker->callsign()));
+    m_talker_cnt->inc();
+    m_talker_gauge->set(1);
+      // The talker must be in the node table before it is referenced
+    sendNodeUpdate();
+    broadcastMsgExcept(MsgTalkerStart(m_talker->callsign()), 0, PROTO_LEGACY);
+    broadcastMsgExcept(MsgTalkerStartNode(nodeId(m_talker->callsign())), 0,
+                       PROTO_NODE_ID);
   }
 } /* Reflector::setTalker */
 
 
+/**
+ * @brief  Get the node ID for a callsign
+ *
+ * Node IDs are assigned the first time a callsign is seen and are kept for as
+ * long as the reflector is running so that a node get the same ID when it
+ * reconnect.
+ */
+uint16_t Reflector::nodeId(const std::string& callsign)
+{
+  NodeIdMap::iterator it = m_node_ids.find(callsign);
+  if (it != m_node_ids.end())
+  {
+    return (*it).second;
+  }
+  uint16_t node_id = m_next_node_id++;
+  m_node_ids[callsign] = node_id;
+  return node_id;
+} /* Reflector::nodeId */
+
+
+void Reflector::nodeLeft(ReflectorClient *client)
+{
+  uint16_t node_id = nodeId(client->callsign());
+  m_nodes.erase(node_id);
+  m_nodes_gauge->set(m_nodes.size());
+
+  broadcastMsgExcept(MsgNodeLeft(client->callsign()), client, PROTO_LEGACY);
+
+  m_node_update.joined().erase(node_id);
+  m_node_update.left().push_back(node_id);
+  if (m_node_update.size() >= MAX_NODE_UPDATE_SIZE)
+  {
+    sendNodeUpdate();
+  }
+  else
+  {
+    m_node_update_timer.setEnable(true);
+  }
+} /* Reflector::nodeLeft */
+
+
+/**
+ * @brief  Send collected node table changes
+ *
+ * Changes to the node table are collected for NODE_UPDATE_DELAY milliseconds
+ * so that a storm of nodes joining, e.g. after a reflector restart, result in
+ * a few update messages instead of one message per node and client.
+ */
+void Reflector::sendNodeUpdate(Async::Timer *t)
+{
+  m_node_update_timer.setEnable(false);
+  if (m_node_update.empty())
+  {
+    return;
+  }
+  broadcastMsgExcept(m_node_update, 0, PROTO_NODE_ID);
+  m_node_update.clear();
+} /* Reflector::sendNodeUpdate */
+
+
 namespace {
 void delete_client(ReflectorClient *client) { delete client; }
 };
@@ -38,6 +38,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <sys/time.h>
 #include <vector>
 #include <string>
+#include <set>
+#include <map>
 
 
 /****************************************************************************
@@ -49,6 +51,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncTcpServer.h>
 #include <AsyncFramedTcpConnection.h>
 #include <AsyncTimer.h>
+#include <AsyncLog.h>
 
 
 /****************************************************************************
@@ -57,6 +60,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include "ReflectorMsg.h"
 
 
 /****************************************************************************
@@ -69,11 +73,12 @@ namespace Async
 {
   class UdpSocket;
   class Config;
+  class MetricCounter;
+  class MetricGauge;
 };
 
 class ReflectorClient;
-class ReflectorMsg;
-class ReflectorUdpMsg;
+class ReflectorTranscoder;
 
 
 /****************************************************************************
@@ -117,6 +122,21 @@ the dispatching of incoming messages to the correct ReflectorClient object.
 class Reflector : public sigc::trackable
 {
   public:
+    /**
+     * @brief The clients to send a broadcast message to
+     */
+    typedef enum
+    {
+      PROTO_ALL,      ///< All clients
+      PROTO_LEGACY,   ///< Clients that identify nodes using callsigns
+      PROTO_NODE_ID   ///< Clients that identify nodes using node IDs
+    } ProtoFilter;
+
+    /**
+     * @brief A map from node ID to callsign
+     */
+    typedef std::map<uint16_t, std::string> NodeMap;
+
     /**
      * @brief 	Default constructor
      */
@@ -143,17 +163,43 @@ class Reflector : public sigc::trackable
      */
     void nodeList(std::vector<std::string>& nodes) const;
 
+    /**
+     * @brief   Return the node table
+     * @return  Returns a map from node ID to callsign for all connected nodes
+     */
+    const NodeMap& nodeTable(void) const { return m_nodes; }
+
+    /**
+     * @brief   Check if a node is connected
+     * @param   callsign The callsign of the node
+     * @return  Returns \em true if a node with the given callsign is connected
+     */
+    bool nodeIsConnected(const std::string& callsign) const;
+
+    /**
+     * @brief   Tell the reflector that a client has logged in
+     * @param   client The client that logged in
+     *
+     * The node is added to the node table and the other clients are told
+     * about it. Clients using node IDs get the change in the next
+     * MsgNodeUpdate message.
+     */
+    void nodeJoined(ReflectorClient *client);
+
     /**
      * @brief   Broadcast a TCP message to all connected clients except one
      * @param   msg The message to broadcast
      * @param   client The client to exclude from the broadcast
+     * @param   filter Which clients to send the message to
      *
      * This function is used to broadcast a message to all connected clients,
      * possibly excluding one client. The excluded client is most often the one
      * where the message originate from. The message is not really a IP
-     * broadcast but rather unicast to all connected clients.
+     * broadcast but rather unicast to all connected clients. The message is
+     * packed once and the same frame is sent to all clients.
      */
-    void broadcastMsgExcept(const ReflectorMsg& msg, ReflectorClient *except=0);
+    void broadcastMsgExcept(const ReflectorMsg& msg, ReflectorClient *except=0,
+                            ProtoFilter filter=PROTO_ALL);
 
     /**
      * @brief   Send a UDP datagram to the specificed ReflectorClient
@@ -164,13 +210,55 @@ class Reflector : public sigc::trackable
      */
     bool sendUdpDatagram(ReflectorClient *client, const void *buf, size_t count);
 
+    /**
+     * @brief   Return the list of codecs supported by the reflector
+     * @return  Returns the codecs from the CODECS configuration variable
+     *
+     * The first codec in the list is the preferred one. Clients using another
+     * codec than the talker will receive transcoded audio.
+     */
+    const std::vector<std::string>& supportedCodecs(void) const
+    {
+      return m_codecs;
+    }
+
+    /**
+     * @brief   Return the time a client session can be resumed
+     * @return  Returns the SESSION_RESUME_TIME in seconds, 0 if disabled
+     *
+     * A client that has been connected within this time can log in again
+     * using a session token instead of the authentication challenge.
+     */
+    unsigned sessionResumeTime(void) const { return m_session_resume_time; }
+
+    /**
+     * @brief   Mark a session token as used
+     * @param   token   The session token
+     * @param   expires The expiry time of the token (seconds since the epoch)
+     * @return  Returns \em false if the token has been used before
+     *
+     * Used tokens are remembered until they expire so that a session token
+     * only can be used once. The used tokens are not saved so a token that
+     * was issued before a restart of the reflector can be used once more
+     * after the restart.
+     */
+    bool useSessionToken(const std::vector<uint8_t>& token, uint32_t expires);
+
   private:
     static const time_t TALKER_AUDIO_TIMEOUT = 3;   // Max three seconds gap
+      // Max number of lost talker frames forwarded as a sequence number gap
+    static const unsigned MAX_FORWARDED_LOSS = 10;
+      // Time in milliseconds to collect node changes before sending them
+    static const unsigned NODE_UPDATE_DELAY = 100;
+      // Max number of node changes in one MsgNodeUpdate message
+    static const size_t MAX_NODE_UPDATE_SIZE = 500;
 
     typedef std::map<uint32_t, ReflectorClient*> ReflectorClientMap;
     typedef std::map<Async::FramedTcpConnection*,
                      ReflectorClient*> ReflectorClientConMap;
     typedef Async::TcpServer<Async::FramedTcpConnection> FramedTcpServer;
+    typedef std::map<std::string, uint16_t> NodeIdMap;
+    typedef std::map<std::vector<uint8_t>, uint32_t> SessionTokenMap;
 
     FramedTcpServer*      m_srv;
     Async::UdpSocket*     m_udp_sock;
@@ -183,6 +271,23 @@ class Reflector : public sigc::trackable
     unsigned              m_sql_timeout_cnt;
     unsigned              m_sql_timeout_blocktime;
     Async::Config*        m_cfg;
+    std::vector<std::string> m_codecs;
+    ReflectorTranscoder*  m_transcoder;
+    Async::LogRateLimit   m_udp_warning_log_limit;
+    Async::LogRateLimit   m_udp_seq_log_limit;
+    NodeIdMap             m_node_ids;
+    uint16_t              m_next_node_id;
+    NodeMap               m_nodes;
+    MsgNodeUpdate         m_node_update;
+    Async::Timer          m_node_update_timer;
+    unsigned              m_session_resume_time;
+    SessionTokenMap       m_used_session_tokens;
+    Async::MetricCounter* m_udp_rx_cnt;
+    Async::MetricCounter* m_udp_tx_cnt;
+    Async::MetricCounter* m_udp_lost_cnt;
+    Async::MetricCounter* m_talker_cnt;
+    Async::MetricGauge*   m_nodes_gauge;
+    Async::MetricGauge*   m_talker_gauge;
 
     Reflector(const Reflector&);
     Reflector& operator=(const Reflector&);
@@ -193,8 +298,15 @@ class Reflector : public sigc::trackable
                              void *buf, int count);
     void broadcastUdpMsgExcept(const ReflectorClient *except,
                                const ReflectorUdpMsg& msg);
+    void broadcastTalkerAudio(MsgUdpAudio& msg);
+    void broadcastTalkerLoss(unsigned lost_frame_cnt);
+    void transcodedAudio(const std::string& codec, const void *buf, int size);
+    void transcodedFlush(const std::string& codec);
     void checkTalkerTimeout(Async::Timer *t);
     void setTalker(ReflectorClient *client);
+    uint16_t nodeId(const std::string& callsign);
+    void nodeLeft(ReflectorClient *client);
+    void sendNodeUpdate(Async::Timer *t=0);
 
 };  /* class Reflector */
 
@@ -35,6 +35,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iomanip>
 #include <algorithm>
 #include <cerrno>
+#include <ctime>
 
 
 /****************************************************************************
@@ -44,9 +45,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <AsyncTimer.h>
-#include <AsyncAudioEncoder.h>
-#include <AsyncAudioDecoder.h>
-#include <common.h>
+#include <AsyncMetrics.h>
 
 
 /****************************************************************************
@@ -130,7 +129,8 @@ ReflectorClient::ReflectorClient(Reflector *ref, Async::FramedTcpConnection *con
     m_heartbeat_rx_cnt(HEARTBEAT_RX_CNT_RESET),
     m_udp_heartbeat_tx_cnt(UDP_HEARTBEAT_TX_CNT_RESET),
     m_udp_heartbeat_rx_cnt(UDP_HEARTBEAT_RX_CNT_RESET),
-    m_reflector(ref), m_blocktime(0), m_remaining_blocktime(0)
+    m_reflector(ref), m_blocktime(0), m_remaining_blocktime(0),
+    m_session_token_cnt(0), m_rtt_gauge(0)
 {
   m_con->setMaxFrameSize(ReflectorMsg::MAX_PREAUTH_FRAME_SIZE);
   m_con->frameReceived.connect(
@@ -140,39 +140,13 @@ ReflectorClient::ReflectorClient(Reflector *ref, Async::FramedTcpConnection *con
   m_heartbeat_timer.expired.connect(
       mem_fun(*this, &ReflectorClient::handleHeartbeat));
 
-  string codecs;
-  if (m_cfg->getValue("GLOBAL", "CODECS", codecs))
-  {
-    SvxLink::splitStr(m_supported_codecs, codecs, ",");
-  }
-  if (m_supported_codecs.size() > 1)
-  {
-    m_supported_codecs.erase(m_supported_codecs.begin()+1,
-                             m_supported_codecs.end());
-    cout << "*** WARNING: The GLOBAL/CODECS configuration "
-            "variable can only take one codec at the moment. Using the first "
-            "one: \"" << m_supported_codecs.front() << "\"" << endl;
-  }
-  else if (m_supported_codecs.empty())
-  {
-    string codec = "GSM";
-    if (AudioDecoder::isAvailable("OPUS") &&
-        AudioEncoder::isAvailable("OPUS"))
-    {
-      codec = "OPUS";
-    }
-    else if (AudioDecoder::isAvailable("SPEEX") &&
-             AudioEncoder::isAvailable("SPEEX"))
-    {
-      codec = "SPEEX";
-    }
-    m_supported_codecs.push_back(codec);
-  }
+  m_codec = m_reflector->supportedCodecs().front();
 } /* ReflectorClient::ReflectorClient */
 
 
 ReflectorClient::~ReflectorClient(void)
 {
+  Metrics::remove(m_rtt_gauge);
 } /* ReflectorClient::~ReflectorClient */
 
 
@@ -185,18 +159,43 @@ int ReflectorClient::sendMsg(const ReflectorMsg& msg)
     return -1;
   }
 
+  string frame;
+  if (!packMsg(msg, frame))
+  {
+    cerr << "*** ERROR: Failed to pack TCP message\n";
+    errno = EBADMSG;
+    return -1;
+  }
+  return sendFrame(msg.type(), frame);
+} /* ReflectorClient::sendMsg */
+
+
+int ReflectorClient::sendFrame(uint16_t type, const std::string& frame)
+{
+  if (((m_con_state != STATE_CONNECTED) && (type >= 100)) ||
+      !m_con->isConnected())
+  {
+    errno = ENOTCONN;
+    return -1;
+  }
+
   m_heartbeat_tx_cnt = HEARTBEAT_TX_CNT_RESET;
 
+  return m_con->write(frame.data(), frame.size());
+} /* ReflectorClient::sendFrame */
+
+
+bool ReflectorClient::packMsg(const ReflectorMsg& msg, std::string& frame)
+{
   ReflectorMsg header(msg.type());
   ostringstream ss;
   if (!header.pack(ss) || !msg.pack(ss))
   {
-    cerr << "*** ERROR: Failed to pack TCP message\n";
-    errno = EBADMSG;
-    return -1;
+    return false;
   }
-  return m_con->write(ss.str().data(), ss.str().size());
-} /* ReflectorClient::sendMsg */
+  frame = ss.str();
+  return true;
+} /* ReflectorClient::packMsg */
 
 
 void ReflectorClient::udpMsgReceived(const ReflectorUdpMsg &header)
@@ -295,9 +294,15 @@ void ReflectorClient::onFrameReceived(FramedTcpConnection *con,
     case MsgAuthResponse::TYPE:
       handleMsgAuthResponse(ss);
       break;
+    case MsgAuthResume::TYPE:
+      handleMsgAuthResume(ss);
+      break;
     case MsgError::TYPE:
       handleMsgError(ss);
       break;
+    case MsgCodecSelect::TYPE:
+      handleMsgCodecSelect(ss);
+      break;
     default:
       // Better just ignoring unknown protocol messages for making it easier to
       // add messages to the protocol and still be backwards compatible.
@@ -327,6 +332,17 @@ void ReflectorClient::handleMsgProtoVer(std::istream& is)
   }
   m_client_proto_ver.major_ver = msg.majorVer();
   m_client_proto_ver.minor_ver = msg.minorVer();
+  if ((m_client_proto_ver > ProtoVer(MsgProtoVer::MAJOR, MsgProtoVer::MINOR)) &&
+      (m_client_proto_ver.major_ver == MsgProtoVer::MAJOR))
+  {
+      // A newer client may fall back to our protocol version
+    cout << "Client " << m_con->remoteHost() << ":" << m_con->remotePort()
+         << " use protocol version "
+         << msg.majorVer() << "." << msg.minorVer() << ". Asking for "
+         << MsgProtoVer::MAJOR << "." << MsgProtoVer::MINOR << "." << endl;
+    sendMsg(MsgProtoVerDowngrade());
+    return;
+  }
   if (m_client_proto_ver < ProtoVer(MIN_MAJOR_VER, MIN_MINOR_VER) ||
       m_client_proto_ver > ProtoVer(MsgProtoVer::MAJOR, MsgProtoVer::MINOR))
   {
@@ -371,29 +387,9 @@ void ReflectorClient::handleMsgAuthResponse(std::istream& is)
   string auth_key = lookupUserKey(msg.callsign());
   if (msg.verify(auth_key, m_auth_challenge))
   {
-    vector<string> connected_nodes;
-    m_reflector->nodeList(connected_nodes);
-    if (find(connected_nodes.begin(), connected_nodes.end(),
-             msg.callsign()) == connected_nodes.end())
+    if (!m_reflector->nodeIsConnected(msg.callsign()))
     {
-      m_con->setMaxFrameSize(ReflectorMsg::MAX_POSTAUTH_FRAME_SIZE);
-      m_callsign = msg.callsign();
-      sendMsg(MsgAuthOk());
-      cout << m_callsign << ": Login OK from "
-           << m_con->remoteHost() << ":" << m_con->remotePort()
-           << " with protocol version " << m_client_proto_ver.major_ver
-           << "." << m_client_proto_ver.minor_ver
-           << endl;
-      m_con_state = STATE_CONNECTED;
-      MsgServerInfo msg_srv_info(m_client_id, m_supported_codecs);
-      m_reflector->nodeList(msg_srv_info.nodes());
-      sendMsg(msg_srv_info);
-      if (m_client_proto_ver < ProtoVer(0, 7))
-      {
-        MsgNodeList msg_node_list(msg_srv_info.nodes());
-        sendMsg(msg_node_list);
-      }
-      m_reflector->broadcastMsgExcept(MsgNodeJoined(m_callsign), this);
+      loginOk(msg.callsign(), "Login OK");
     }
     else
     {
@@ -411,6 +407,107 @@ void ReflectorClient::handleMsgAuthResponse(std::istream& is)
 } /* ReflectorClient::handleMsgAuthResponse */
 
 
+void ReflectorClient::handleMsgAuthResume(std::istream& is)
+{
+  if ((m_con_state != STATE_EXPECT_AUTH_RESPONSE) ||
+      (m_client_proto_ver < ProtoVer(1, 2)))
+  {
+    cout << "Client " << m_con->remoteHost() << ":" << m_con->remotePort()
+         << " Authentication resume unexpected" << endl;
+    sendError("Authentication resume unexpected");
+    return;
+  }
+
+  MsgAuthResume msg;
+  if (!msg.unpack(is))
+  {
+    cout << "Client " << m_con->remoteHost() << ":" << m_con->remotePort()
+         << " ERROR: Could not unpack MsgAuthResume" << endl;
+    sendError("Illegal MsgAuthResume protocol message received");
+    return;
+  }
+
+    // The expiry time is stored in clear text first in the token. It is
+    // covered by the digest so it cannot be changed by the client.
+  const vector<uint8_t>& token = msg.token();
+  uint32_t expires = 0;
+  if (token.size() == SESSION_TOKEN_LEN)
+  {
+    expires = (static_cast<uint32_t>(token[0]) << 24) |
+              (static_cast<uint32_t>(token[1]) << 16) |
+              (static_cast<uint32_t>(token[2]) << 8) |
+              static_cast<uint32_t>(token[3]);
+  }
+  uint32_t now = time(NULL);
+  vector<uint8_t> expected_token;
+  if ((expires <= now) ||
+      (expires > now + m_reflector->sessionResumeTime()) ||
+      !calcSessionToken(expected_token, msg.callsign(), expires) ||
+      (memcmp(&token[0], &expected_token[0], SESSION_TOKEN_LEN) != 0))
+  {
+    cout << "Client " << m_con->remoteHost() << ":" << m_con->remotePort()
+         << " Session resumption failed for user \"" << msg.callsign()
+         << "\"" << endl;
+    sendError("Session resumption failed");
+    return;
+  }
+
+  if (!m_reflector->useSessionToken(token, expires))
+  {
+    cout << "Client " << m_con->remoteHost() << ":" << m_con->remotePort()
+         << " Session token already used for user \"" << msg.callsign()
+         << "\"" << endl;
+    sendError("Session resumption failed");
+    return;
+  }
+
+  if (m_reflector->nodeIsConnected(msg.callsign()))
+  {
+    cout << msg.callsign() << ": Already connected" << endl;
+    sendError("Access denied");
+    return;
+  }
+
+  loginOk(msg.callsign(), "Session resumed");
+} /* ReflectorClient::handleMsgAuthResume */
+
+
+void ReflectorClient::loginOk(const std::string& callsign, const char *how)
+{
+  m_con->setMaxFrameSize(ReflectorMsg::MAX_POSTAUTH_FRAME_SIZE);
+  m_callsign = callsign;
+  sendMsg(MsgAuthOk());
+  cout << m_callsign << ": " << how << " from "
+       << m_con->remoteHost() << ":" << m_con->remotePort()
+       << " with protocol version " << m_client_proto_ver.major_ver
+       << "." << m_client_proto_ver.minor_ver
+       << endl;
+  m_con_state = STATE_CONNECTED;
+  m_rtt_gauge = Metrics::gauge("svxreflector_client_rtt_seconds",
+      "TCP round trip time to the client as estimated by the kernel",
+      Metrics::label("callsign", m_callsign));
+  updateRtt();
+  sendSessionToken();
+  m_reflector->nodeJoined(this);
+  MsgServerInfo msg_srv_info(m_client_id, m_reflector->supportedCodecs());
+  if (useNodeIds())
+  {
+    sendMsg(msg_srv_info);
+    sendMsg(MsgNodeTable(m_reflector->nodeTable()));
+  }
+  else
+  {
+    m_reflector->nodeList(msg_srv_info.nodes());
+    sendMsg(msg_srv_info);
+    if (m_client_proto_ver < ProtoVer(0, 7))
+    {
+      MsgNodeList msg_node_list(msg_srv_info.nodes());
+      sendMsg(msg_node_list);
+    }
+  }
+} /* ReflectorClient::loginOk */
+
+
 void ReflectorClient::handleMsgError(std::istream& is)
 {
   MsgError msg;
@@ -432,6 +529,39 @@ void ReflectorClient::handleMsgError(std::istream& is)
 } /* ReflectorClient::handleMsgError */
 
 
+void ReflectorClient::handleMsgCodecSelect(std::istream& is)
+{
+  if (m_con_state != STATE_CONNECTED)
+  {
+    return;
+  }
+
+  MsgCodecSelect msg;
+  if (!msg.unpack(is))
+  {
+    cout << m_callsign << ": ERROR: Could not unpack MsgCodecSelect" << endl;
+    sendError("Illegal MsgCodecSelect protocol message received");
+    return;
+  }
+
+  const vector<string>& codecs = m_reflector->supportedCodecs();
+  if (find(codecs.begin(), codecs.end(), msg.codec()) == codecs.end())
+  {
+    cout << m_callsign << ": Selected codec \"" << msg.codec()
+         << "\" is not supported. Keeping codec \"" << m_codec << "\""
+         << endl;
+    return;
+  }
+
+  if (msg.codec() != m_codec)
+  {
+    cout << m_callsign << ": Using audio codec \"" << msg.codec() << "\""
+         << endl;
+    m_codec = msg.codec();
+  }
+} /* ReflectorClient::handleMsgCodecSelect */
+
+
 void ReflectorClient::sendError(const std::string& msg)
 {
   sendMsg(MsgError(msg));
@@ -501,6 +631,13 @@ void ReflectorClient::handleHeartbeat(Async::Timer *t)
     sendError("UDP heartbeat timeout");
   }
 
+  updateRtt();
+
+  if ((m_session_token_cnt > 0) && (--m_session_token_cnt == 0))
+  {
+    sendSessionToken();
+  }
+
   if (m_blocktime > 0)
   {
     if (m_remaining_blocktime == 0)
@@ -536,7 +673,94 @@ std::string ReflectorClient::lookupUserKey(const std::string& callsign)
 } /* ReflectorClient::lookupUserKey */
 
 
+/**
+ * @brief  Calculate a session token
+ *
+ * The token is the expiry time followed by a HMAC, using the key of the user,
+ * of the callsign, the IP address of the client and the expiry time. The
+ * token itself need not be kept in the server so a token is still valid after
+ * a restart of the reflector, which is when it is needed the most. Since the
+ * token is bound to the IP address, a token seen on the network cannot be
+ * used from another host. Used tokens are remembered by the Reflector until
+ * they expire so that a token cannot be replayed.
+ */
+bool ReflectorClient::calcSessionToken(std::vector<uint8_t>& token,
+                                       const std::string& callsign,
+                                       uint32_t expires)
+{
+  string auth_key = lookupUserKey(callsign);
+  if (auth_key.empty())
+  {
+    return false;
+  }
+
+  token.resize(SESSION_TOKEN_LEN);
+  token[0] = (expires >> 24) & 0xff;
+  token[1] = (expires >> 16) & 0xff;
+  token[2] = (expires >> 8) & 0xff;
+  token[3] = expires & 0xff;
+
+  string host = m_con->remoteHost().toString();
+  gcry_md_hd_t hd = { 0 };
+  gcry_error_t err = gcry_md_open(&hd, MsgAuthResponse::ALGO,
+                                  GCRY_MD_FLAG_HMAC);
+  if (!err)
+  {
+    err = gcry_md_setkey(hd, auth_key.data(), auth_key.size());
+  }
+  if (err)
+  {
+    gcry_md_close(hd);
+    cerr << "*** ERROR: gcrypt error: "
+         << gcry_strsource(err) << "/" << gcry_strerror(err) << endl;
+    return false;
+  }
+  gcry_md_write(hd, callsign.c_str(), callsign.size() + 1);
+  gcry_md_write(hd, host.c_str(), host.size() + 1);
+  gcry_md_write(hd, &token[0], 4);
+  memcpy(&token[4], gcry_md_read(hd, 0), MsgAuthResponse::DIGEST_LEN);
+  gcry_md_close(hd);
+  return true;
+} /* ReflectorClient::calcSessionToken */
+
+
+void ReflectorClient::sendSessionToken(void)
+{
+  unsigned lifetime = m_reflector->sessionResumeTime();
+  if ((lifetime == 0) || (m_con_state != STATE_CONNECTED) ||
+      (m_client_proto_ver < ProtoVer(1, 2)))
+  {
+    m_session_token_cnt = 0;
+    return;
+  }
+
+  vector<uint8_t> token;
+  if (calcSessionToken(token, m_callsign, time(NULL) + lifetime))
+  {
+    sendMsg(MsgSessionToken(token, lifetime));
+  }
+
+    // Send a new token before the old one expire so that a client that lose
+    // the connection always have at least half the lifetime left
+  m_session_token_cnt = (lifetime > 1) ? lifetime / 2 : 1;
+} /* ReflectorClient::sendSessionToken */
+
+
+void ReflectorClient::updateRtt(void)
+{
+  if (m_rtt_gauge == 0)
+  {
+    return;
+  }
+  long rtt = m_con->roundTripTime();
+  if (rtt >= 0)
+  {
+    m_rtt_gauge->set(rtt / 1000000.0);
+  }
+} /* ReflectorClient::updateRtt */
+
+
+
 /*
  * This file has not been truncated
  */
-
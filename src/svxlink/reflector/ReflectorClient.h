@@ -63,6 +63,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+namespace Async
+{
+  class MetricGauge;
+};
 
 
 /****************************************************************************
@@ -181,6 +185,16 @@ class ReflectorClient
      */
     uint16_t nextUdpTxSeq(void) { return m_next_udp_tx_seq++; }
 
+    /**
+     * @brief   Skip a number of UDP packet transmit sequence numbers
+     * @param   cnt The number of sequence numbers to skip
+     *
+     * This function is used to forward packet loss in the talker stream to
+     * this client. The client will see a gap in the sequence numbers and can
+     * then conceal the lost audio.
+     */
+    void skipUdpTxSeq(uint16_t cnt) { m_next_udp_tx_seq += cnt; }
+
     /**
      * @brief   Get the next expected UDP packet sequence number
      * @return  Returns the next expected UDP packet sequence number
@@ -197,6 +211,35 @@ class ReflectorClient
      */
     int sendMsg(const ReflectorMsg& msg);
 
+    /**
+     * @brief   Send an already packed TCP message to the remote end
+     * @param   type The message type
+     * @param   frame The packed message, including the header
+     * @return  On success 0 is returned or else -1
+     *
+     * This function is used when the same message is sent to many clients so
+     * that it only have to be packed once. Use packMsg to pack the message.
+     */
+    int sendFrame(uint16_t type, const std::string& frame);
+
+    /**
+     * @brief   Pack a TCP message, including the header
+     * @param   msg The message to pack
+     * @param   frame The string to store the packed message in
+     * @return  Returns \em true on success or else \em false
+     */
+    static bool packMsg(const ReflectorMsg& msg, std::string& frame);
+
+    /**
+     * @brief   Check if the client identify nodes using node IDs
+     * @return  Returns \em true if the client use protocol version 1.1 or later
+     *
+     * Clients using protocol version 1.1 or later get the node table using
+     * MsgNodeTable and MsgNodeUpdate and talkers as node IDs. Older clients
+     * get callsigns in MsgServerInfo, MsgNodeJoined, MsgTalkerStart etc.
+     */
+    bool useNodeIds(void) const { return m_client_proto_ver >= ProtoVer(1, 1); }
+
     /**
      * @brief   Handle a received UDP message
      * @param   The received UDP message
@@ -234,6 +277,15 @@ class ReflectorClient
      */
     ConState conState(void) const { return m_con_state; }
 
+    /**
+     * @brief   Get the audio codec used by the client
+     * @return  Returns the name of the codec the client has selected
+     *
+     * Until the client has selected a codec, the first codec offered by the
+     * reflector is assumed.
+     */
+    const std::string& codec(void) const { return m_codec; }
+
   private:
     struct ProtoVer
     {
@@ -279,6 +331,7 @@ class ReflectorClient
     static const unsigned HEARTBEAT_RX_CNT_RESET      = 15;
     static const unsigned UDP_HEARTBEAT_TX_CNT_RESET  = 15;
     static const unsigned UDP_HEARTBEAT_RX_CNT_RESET  = 120;
+    static const size_t   SESSION_TOKEN_LEN = 4 + MsgAuthResponse::DIGEST_LEN;
 
     Async::FramedTcpConnection* m_con;
     unsigned                  m_msg_type;
@@ -300,7 +353,9 @@ class ReflectorClient
     unsigned                  m_blocktime;
     unsigned                  m_remaining_blocktime;
     ProtoVer                  m_client_proto_ver;
-    std::vector<std::string>  m_supported_codecs;
+    std::string               m_codec;
+    unsigned                  m_session_token_cnt;
+    Async::MetricGauge*       m_rtt_gauge;
 
     ReflectorClient(const ReflectorClient&);
     ReflectorClient& operator=(const ReflectorClient&);
@@ -308,12 +363,19 @@ class ReflectorClient
                          std::vector<uint8_t>& data);
     void handleMsgProtoVer(std::istream& is);
     void handleMsgAuthResponse(std::istream& is);
+    void handleMsgAuthResume(std::istream& is);
+    void loginOk(const std::string& callsign, const char *how);
     void handleMsgError(std::istream& is);
+    void handleMsgCodecSelect(std::istream& is);
     void sendError(const std::string& msg);
     void onDiscTimeout(Async::Timer *t);
     void disconnect(void);
     void handleHeartbeat(Async::Timer *t);
     std::string lookupUserKey(const std::string& callsign);
+    bool calcSessionToken(std::vector<uint8_t>& token,
+                          const std::string& callsign, uint32_t expires);
+    void sendSessionToken(void);
+    void updateRtt(void);
 
 };  /* class ReflectorClient */
 
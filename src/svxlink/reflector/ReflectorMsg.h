@@ -237,8 +237,10 @@ class MsgProtoVer : public ReflectorMsgBase<5>
 {
   public:
     static const uint16_t MAJOR = 1;
-    static const uint16_t MINOR = 0;
+    static const uint16_t MINOR = 2;
     MsgProtoVer(void) : m_major(MAJOR), m_minor(MINOR) {}
+    MsgProtoVer(uint16_t major, uint16_t minor)
+      : m_major(major), m_minor(minor) {}
     uint16_t majorVer(void) const { return m_major; }
     uint16_t minorVer(void) const { return m_minor; }
 
@@ -250,6 +252,32 @@ class MsgProtoVer : public ReflectorMsgBase<5>
 }; /* MsgProtoVer */
 
 
+/**
+@brief	 Protocol version downgrade TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2017-12-20
+
+This message is sent by the server if the client use a newer protocol version
+than the server support. It contain the highest protocol version supported by
+the server. If the client support that version, it should send a new
+MsgProtoVer message with the version given in this message.
+*/
+class MsgProtoVerDowngrade : public ReflectorMsgBase<6>
+{
+  public:
+    MsgProtoVerDowngrade(void)
+      : m_major(MsgProtoVer::MAJOR), m_minor(MsgProtoVer::MINOR) {}
+    uint16_t majorVer(void) const { return m_major; }
+    uint16_t minorVer(void) const { return m_minor; }
+
+    ASYNC_MSG_MEMBERS(m_major, m_minor);
+
+  private:
+    uint16_t m_major;
+    uint16_t m_minor;
+}; /* MsgProtoVerDowngrade */
+
+
 /**
 @brief	 Heartbeat TCP network message
 @author  Tobias Blomberg / SM0SVX
@@ -431,13 +459,91 @@ class MsgError : public ReflectorMsgBase<13>
 }; /* MsgError */
 
 
+/**
+@brief	 Session token TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2017-12-27
+
+This message is sent by the server to clients using protocol version 1.2 or
+later when they have logged in, and then again periodically as long as they
+are connected. The token is opaque to the client. If the client lose the
+connection, it can log in again within the given lifetime by sending the
+token in a MsgAuthResume message instead of answering the authentication
+challenge. Only the latest token received need to be kept.
+*/
+class MsgSessionToken : public ReflectorMsgBase<14>
+{
+  public:
+    MsgSessionToken(void) : m_lifetime(0) {}
+    MsgSessionToken(const std::vector<uint8_t>& token, uint32_t lifetime)
+      : m_token(token), m_lifetime(lifetime) {}
+
+    /**
+     * @brief   Get the token
+     */
+    const std::vector<uint8_t>& token(void) const { return m_token; }
+
+    /**
+     * @brief   Get the number of seconds that the token is valid
+     */
+    uint32_t lifetime(void) const { return m_lifetime; }
+
+    ASYNC_MSG_MEMBERS(m_token, m_lifetime)
+
+  private:
+    std::vector<uint8_t>  m_token;
+    uint32_t              m_lifetime;
+}; /* MsgSessionToken */
+
+
+/**
+@brief	 Authentication resume TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2017-12-27
+
+This message is sent by the client directly after the MsgProtoVer message if
+it has a valid token from a MsgSessionToken message. The client should then
+ignore the MsgAuthChallenge message from the server and wait for MsgAuthOk. If
+the token is not accepted, the server send a MsgError message and the client
+should log in the normal way on the next connection attempt. A token can only
+be used once. The server remember used tokens until they expire, but not
+across a restart. A new token is sent by the server after login.
+*/
+class MsgAuthResume : public ReflectorMsgBase<15>
+{
+  public:
+    MsgAuthResume(void) {}
+    MsgAuthResume(const std::string& callsign,
+                  const std::vector<uint8_t>& token)
+      : m_callsign(callsign), m_token(token) {}
+
+    /**
+     * @brief   Get the callsign
+     */
+    const std::string& callsign(void) const { return m_callsign; }
+
+    /**
+     * @brief   Get the token
+     */
+    const std::vector<uint8_t>& token(void) const { return m_token; }
+
+    ASYNC_MSG_MEMBERS(m_callsign, m_token)
+
+  private:
+    std::string           m_callsign;
+    std::vector<uint8_t>  m_token;
+}; /* MsgAuthResume */
+
+
 /**
 @brief	 Server information TCP network message
 @author  Tobias Blomberg / SM0SVX
 @date    2017-02-12
 
 This message is sent by the server to the client to inform about server and
-connection properties.
+connection properties. Clients using protocol version 1.1 or later get an
+empty node list. The connected nodes are instead sent in a MsgNodeTable
+message.
 */
 class MsgServerInfo : public ReflectorMsgBase<100>
 {
@@ -572,6 +678,137 @@ class MsgTalkerStop : public ReflectorMsgBase<105>
 }; /* MsgTalkerStop */
 
 
+/**
+@brief	 Codec select TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2017-11-12
+
+This message is sent by the client to the server, after MsgServerInfo has been
+received, to tell the server which one of the offered codecs that the client
+has chosen. The server will then send audio encoded with that codec to the
+client, transcoding it if the talker use another codec. A server not
+supporting transcoding will ignore this message. A codec that was not offered
+is ignored and the client keep the codec it used before. If this message is
+not received, the server will assume that the client use the first codec in
+the list.
+*/
+class MsgCodecSelect : public ReflectorMsgBase<106>
+{
+  public:
+    MsgCodecSelect(const std::string& codec="") : m_codec(codec) {}
+
+    const std::string& codec(void) const { return m_codec; }
+
+    ASYNC_MSG_MEMBERS(m_codec);
+
+  private:
+    std::string m_codec;
+}; /* MsgCodecSelect */
+
+
+/**
+@brief	 Node table TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2017-12-20
+
+This message is sent by the server to clients using protocol version 1.1 or
+later, after MsgServerInfo, instead of the node list in MsgServerInfo. It map
+node ID numbers to callsigns for all connected nodes. A node keep its ID for
+as long as the server is running, also when it reconnect. Later changes are
+sent using MsgNodeUpdate and node IDs are used instead of callsigns in other
+messages.
+*/
+class MsgNodeTable : public ReflectorMsgBase<107>
+{
+  public:
+    typedef std::map<uint16_t, std::string> Nodes;
+
+    MsgNodeTable(void) {}
+    MsgNodeTable(const Nodes& nodes) : m_nodes(nodes) {}
+    Nodes& nodes(void) { return m_nodes; }
+
+    ASYNC_MSG_MEMBERS(m_nodes);
+
+  private:
+    Nodes m_nodes;
+}; /* MsgNodeTable */
+
+
+/**
+@brief	 Node table update TCP network message
+@author  Tobias Blomberg / SM0SVX
+@date    2017-12-20
+
+This message is sent by the server to clients using protocol version 1.1 or
+later to tell which nodes that have joined and left since the last update.
+Changes are collected for a short while so that many nodes joining at the
+same time, e.g. after a server restart, result in few messages. The left
+nodes should be removed from the node table before the joined nodes are
+added. Both lists may contain nodes that the receiver already know about.
+*/
+class MsgNodeUpdate : public ReflectorMsgBase<108>
+{
+  public:
+    typedef std::map<uint16_t, std::string> Nodes;
+
+    MsgNodeUpdate(void) {}
+    Nodes& joined(void) { return m_joined; }
+    std::vector<uint16_t>& left(void) { return m_left; }
+    size_t size(void) const { return m_joined.size() + m_left.size(); }
+    bool empty(void) const { return m_joined.empty() && m_left.empty(); }
+    void clear(void) { m_joined.clear(); m_left.clear(); }
+
+    ASYNC_MSG_MEMBERS(m_left, m_joined);
+
+  private:
+    std::vector<uint16_t> m_left;
+    Nodes                 m_joined;
+}; /* MsgNodeUpdate */
+
+
+/**
+@brief	 Talker start TCP network message using a node ID
+@author  Tobias Blomberg / SM0SVX
+@date    2017-12-20
+
+Same as MsgTalkerStart but the talker is given as a node ID from the node
+table. Sent to clients using protocol version 1.1 or later.
+*/
+class MsgTalkerStartNode : public ReflectorMsgBase<109>
+{
+  public:
+    MsgTalkerStartNode(uint16_t node_id=0) : m_node_id(node_id) {}
+
+    uint16_t nodeId(void) const { return m_node_id; }
+
+    ASYNC_MSG_MEMBERS(m_node_id);
+
+  private:
+    uint16_t m_node_id;
+}; /* MsgTalkerStartNode */
+
+
+/**
+@brief	 Talker stop TCP network message using a node ID
+@author  Tobias Blomberg / SM0SVX
+@date    2017-12-20
+
+Same as MsgTalkerStop but the talker is given as a node ID from the node
+table. Sent to clients using protocol version 1.1 or later.
+*/
+class MsgTalkerStopNode : public ReflectorMsgBase<110>
+{
+  public:
+    MsgTalkerStopNode(uint16_t node_id=0) : m_node_id(node_id) {}
+
+    uint16_t nodeId(void) const { return m_node_id; }
+
+    ASYNC_MSG_MEMBERS(m_node_id);
+
+  private:
+    uint16_t m_node_id;
+}; /* MsgTalkerStopNode */
+
 
 
 
@@ -0,0 +1,296 @@
+/*
+ * Benchmark for the server side transcoding in the reflector.
+ *
+ * A number of simulated clients are spread evenly over a set of codecs. One
+ * client is the talker and use the first codec. The talker audio is encoded in
+ * advance and is then distributed to the other clients the same way the
+ * Reflector does it: clients using the talker codec get the audio forwarded,
+ * and the audio for the other clients is transcoded once per codec group. The
+ * time used and the number of encoder runs are printed.
+ *
+ * Usage: ReflectorTranscodeBench [-c clients] [-s seconds] [-n] [codec...]
+ *
+ *   -n  Naive mode, transcode once per client instead of once per codec group
+ *
+ * Default codecs: OPUS SPEEX GSM (only the available ones are used)
+ */
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+
+#include <AsyncAudioEncoder.h>
+
+#include "ReflectorTranscoder.h"
+
+using namespace std;
+using namespace Async;
+
+
+struct Client
+{
+  string                codec;
+  ReflectorTranscoder*  transcoder;     // Only used in naive mode
+  unsigned long         rx_bytes;
+};
+
+
+class Bench : public sigc::trackable
+{
+  public:
+    Bench(const vector<string>& codecs, unsigned client_cnt, bool naive)
+      : codecs(codecs), naive(naive), fwd_cnt(0), tx_bytes(0)
+    {
+      for (unsigned i=0; i<client_cnt; ++i)
+      {
+        Client client;
+        client.codec = codecs[i % codecs.size()];
+        client.transcoder = 0;
+        client.rx_bytes = 0;
+        if (naive && (i > 0) && (client.codec != codecs[0]))
+        {
+          client.transcoder = new ReflectorTranscoder;
+        }
+        clients.push_back(client);
+      }
+      for (unsigned i=0; i<clients.size(); ++i)
+      {
+        if (clients[i].transcoder != 0)
+        {
+          clients[i].transcoder->transcodedAudio.connect(
+              sigc::bind(sigc::mem_fun(*this, &Bench::clientAudio), i));
+        }
+      }
+      transcoder.transcodedAudio.connect(
+          sigc::mem_fun(*this, &Bench::groupAudio));
+    }
+
+    ~Bench(void)
+    {
+      for (unsigned i=0; i<clients.size(); ++i)
+      {
+        delete clients[i].transcoder;
+      }
+    }
+
+    void talkerFrame(vector<uint8_t>& frame)
+    {
+      const string& talker_codec = clients[0].codec;
+      set<string> dst_codecs;
+      for (unsigned i=1; i<clients.size(); ++i)
+      {
+        Client& client = clients[i];
+        if (client.codec == talker_codec)
+        {
+          client.rx_bytes += frame.size();
+          tx_bytes += frame.size();
+          ++fwd_cnt;
+        }
+        else if (naive)
+        {
+          set<string> codec;
+          codec.insert(client.codec);
+          client.transcoder->writeEncodedSamples(talker_codec, codec,
+                                                 &frame.front(),
+                                                 frame.size());
+        }
+        else
+        {
+          dst_codecs.insert(client.codec);
+        }
+      }
+      if (!dst_codecs.empty())
+      {
+        transcoder.writeEncodedSamples(talker_codec, dst_codecs,
+                                       &frame.front(), frame.size());
+      }
+    }
+
+    void flush(void)
+    {
+      transcoder.flushEncodedSamples();
+      for (unsigned i=0; i<clients.size(); ++i)
+      {
+        if (clients[i].transcoder != 0)
+        {
+          clients[i].transcoder->flushEncodedSamples();
+        }
+      }
+    }
+
+    void printResult(double secs, double audio_secs)
+    {
+      unsigned long decode_cnt = transcoder.decodeCount();
+      unsigned long encode_cnt = transcoder.encodeCount();
+      unsigned encoders = transcoder.encoderCount();
+      for (unsigned i=0; i<clients.size(); ++i)
+      {
+        if (clients[i].transcoder != 0)
+        {
+          decode_cnt += clients[i].transcoder->decodeCount();
+          encode_cnt += clients[i].transcoder->encodeCount();
+          encoders += clients[i].transcoder->encoderCount();
+        }
+      }
+      map<string, unsigned> group_size;
+      for (unsigned i=1; i<clients.size(); ++i)
+      {
+        group_size[clients[i].codec] += 1;
+      }
+      cout << "Codec groups:    ";
+      for (map<string, unsigned>::iterator it = group_size.begin();
+           it != group_size.end(); ++it)
+      {
+        cout << (*it).first << "=" << (*it).second << " ";
+      }
+      cout << endl;
+      cout << "Forwarded:       " << fwd_cnt << endl;
+      cout << "Decoder runs:    " << decode_cnt << endl;
+      cout << "Encoder runs:    " << encode_cnt << endl;
+      cout << "Encoders:        " << encoders << endl;
+      cout << "Sent kB:         " << (tx_bytes / 1024) << endl;
+      cout << "Time:            " << static_cast<unsigned>(secs * 1000.0)
+           << "ms" << endl;
+      cout << "Realtime factor: " << (audio_secs / secs) << endl;
+    }
+
+  private:
+    vector<string>        codecs;
+    bool                  naive;
+    vector<Client>        clients;
+    ReflectorTranscoder   transcoder;
+    unsigned long         fwd_cnt;
+    unsigned long         tx_bytes;
+
+    void groupAudio(const string& codec, const void *buf, int size)
+    {
+      for (unsigned i=1; i<clients.size(); ++i)
+      {
+        if (clients[i].codec == codec)
+        {
+          clients[i].rx_bytes += size;
+          tx_bytes += size;
+        }
+      }
+    }
+
+    void clientAudio(const string& codec, const void *buf, int size,
+                     unsigned client_idx)
+    {
+      clients[client_idx].rx_bytes += size;
+      tx_bytes += size;
+    }
+};
+
+
+static vector<vector<uint8_t> > frames;
+
+static void talker_encoded(const void *buf, int size)
+{
+  const uint8_t *bbuf = reinterpret_cast<const uint8_t*>(buf);
+  frames.push_back(vector<uint8_t>(bbuf, bbuf + size));
+}
+
+
+int main(int argc, char **argv)
+{
+  unsigned client_cnt = 100;
+  unsigned seconds = 60;
+  bool naive = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "c:s:n")) != -1)
+  {
+    switch (opt)
+    {
+      case 'c':
+        client_cnt = strtoul(optarg, NULL, 10);
+        break;
+      case 's':
+        seconds = strtoul(optarg, NULL, 10);
+        break;
+      case 'n':
+        naive = true;
+        break;
+      default:
+        cerr << "Usage: " << argv[0]
+             << " [-c clients] [-s seconds] [-n] [codec...]\n";
+        exit(1);
+    }
+  }
+
+  vector<string> wanted;
+  for (int i=optind; i<argc; ++i)
+  {
+    wanted.push_back(argv[i]);
+  }
+  if (wanted.empty())
+  {
+    wanted.push_back("OPUS");
+    wanted.push_back("SPEEX");
+    wanted.push_back("GSM");
+  }
+  vector<string> codecs;
+  for (unsigned i=0; i<wanted.size(); ++i)
+  {
+    if (ReflectorTranscoder::codecIsAvailable(wanted[i]))
+    {
+      codecs.push_back(wanted[i]);
+    }
+    else
+    {
+      cerr << "*** WARNING: Codec " << wanted[i] << " not available\n";
+    }
+  }
+  if (codecs.empty() || (client_cnt < 2) || (seconds == 0))
+  {
+    cerr << "*** ERROR: Illegal argument\n";
+    exit(1);
+  }
+
+    // Encode the talker audio in advance, a tone with some harmonics
+  AudioEncoder *enc = AudioEncoder::create(codecs[0]);
+  enc->writeEncodedSamples.connect(sigc::ptr_fun(&talker_encoded));
+  const int block_size = INTERNAL_SAMPLE_RATE / 50;
+  vector<float> block(block_size);
+  unsigned long sample_no = 0;
+  for (unsigned b=0; b<50 * seconds; ++b)
+  {
+    for (int i=0; i<block_size; ++i, ++sample_no)
+    {
+      double t = static_cast<double>(sample_no) / INTERNAL_SAMPLE_RATE;
+      block[i] = 0.3 * sin(2.0 * M_PI * 440.0 * t) +
+                 0.1 * sin(2.0 * M_PI * 1320.0 * t);
+    }
+    enc->writeSamples(&block[0], block_size);
+  }
+  enc->flushSamples();
+  delete enc;
+
+  cout << "Transcoding " << seconds << "s of " << codecs[0] << " audio ("
+       << frames.size() << " frames) to " << (client_cnt - 1)
+       << " clients, " << (naive ? "once per client" : "once per codec group")
+       << endl;
+
+  Bench bench(codecs, client_cnt, naive);
+  struct timeval start, now, diff;
+  gettimeofday(&start, NULL);
+  for (unsigned i=0; i<frames.size(); ++i)
+  {
+    bench.talkerFrame(frames[i]);
+  }
+  bench.flush();
+  gettimeofday(&now, NULL);
+  timersub(&now, &start, &diff);
+  bench.printResult(diff.tv_sec + diff.tv_usec / 1000000.0, seconds);
+
+  return 0;
+}
+
@@ -0,0 +1,337 @@
+/**
+@file	 ReflectorTranscoder.cpp
+@brief   Transcode talker audio to the codecs used by the client groups
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-11-12
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cassert>
+#include <iostream>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioEncoder.h>
+#include <AsyncAudioDecoder.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "ReflectorTranscoder.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Public static functions
+ *
+ ****************************************************************************/
+
+bool ReflectorTranscoder::codecIsAvailable(const std::string& codec)
+{
+  return AudioEncoder::isAvailable(codec) && AudioDecoder::isAvailable(codec);
+} /* ReflectorTranscoder::codecIsAvailable */
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+ReflectorTranscoder::ReflectorTranscoder(void)
+  : m_dec(0), m_stream_active(false), m_decode_cnt(0), m_encode_cnt(0)
+{
+} /* ReflectorTranscoder::ReflectorTranscoder */
+
+
+ReflectorTranscoder::~ReflectorTranscoder(void)
+{
+  if (m_dec != 0)
+  {
+    m_dec->unregisterSink();
+    m_dec = 0;
+  }
+  for (DecoderMap::iterator it = m_decoders.begin();
+       it != m_decoders.end(); ++it)
+  {
+    delete (*it).second;
+  }
+  for (EncoderMap::iterator it = m_encoders.begin();
+       it != m_encoders.end(); ++it)
+  {
+    delete (*it).second;
+  }
+} /* ReflectorTranscoder::~ReflectorTranscoder */
+
+
+bool ReflectorTranscoder::writeEncodedSamples(
+    const std::string& src_codec, const std::set<std::string>& dst_codecs,
+    void *buf, int size)
+{
+  AudioDecoder *dec = findDecoder(src_codec);
+  if (dec == 0)
+  {
+    return false;
+  }
+  if (dec != m_dec)
+  {
+    if (m_dec != 0)
+    {
+      flushEncodedSamples();
+      m_dec->unregisterSink();
+        // A threaded decoder report that it is done flushing after the
+        // sink has been unregistered so flush the encoders directly
+      flushEncoders();
+    }
+    m_dec = dec;
+    m_dec->registerSink(this, false);
+  }
+
+    // Flush encoders for codec groups that no longer need audio, e.g. when
+    // the last client in a group disconnected during a talker stream
+  for (CodecSet::iterator it = m_dst_codecs.begin();
+       m_stream_active && (it != m_dst_codecs.end()); ++it)
+  {
+    if (dst_codecs.find(*it) == dst_codecs.end())
+    {
+      findEncoder(*it)->flushSamples();
+    }
+  }
+  m_stream_active = true;
+  m_dst_codecs.clear();
+  for (CodecSet::const_iterator it = dst_codecs.begin();
+       it != dst_codecs.end(); ++it)
+  {
+    if ((*it != src_codec) && (findEncoder(*it) != 0))
+    {
+      m_dst_codecs.insert(*it);
+    }
+  }
+
+  ++m_decode_cnt;
+  m_dec->writeEncodedSamples(buf, size);
+
+  return true;
+} /* ReflectorTranscoder::writeEncodedSamples */
+
+
+void ReflectorTranscoder::flushEncodedSamples(void)
+{
+  if (m_dec != 0)
+  {
+      // The destination codecs are kept until the next talker stream start
+      // since a threaded decoder may still deliver audio for this stream.
+      // The encoders are flushed when the decoder is done flushing.
+    if (m_stream_active)
+    {
+      m_flush_codecs.insert(m_dst_codecs.begin(), m_dst_codecs.end());
+      m_stream_active = false;
+    }
+    m_dec->flushEncodedSamples();
+  }
+} /* ReflectorTranscoder::flushEncodedSamples */
+
+
+void ReflectorTranscoder::packetsLost(unsigned count)
+{
+  if (m_dec != 0)
+  {
+    m_dec->packetsLost(count);
+  }
+} /* ReflectorTranscoder::packetsLost */
+
+
+int ReflectorTranscoder::writeSamples(const float *samples, int count)
+{
+  for (CodecSet::iterator it = m_dst_codecs.begin();
+       it != m_dst_codecs.end(); ++it)
+  {
+    ++m_encode_cnt;
+    m_encoders[*it]->writeSamples(samples, count);
+  }
+  return count;
+} /* ReflectorTranscoder::writeSamples */
+
+
+void ReflectorTranscoder::flushSamples(void)
+{
+  flushEncoders();
+  sourceAllSamplesFlushed();
+} /* ReflectorTranscoder::flushSamples */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+AudioDecoder *ReflectorTranscoder::findDecoder(const std::string& codec)
+{
+  DecoderMap::iterator it = m_decoders.find(codec);
+  if (it != m_decoders.end())
+  {
+    return (*it).second;
+  }
+  AudioDecoder *dec = AudioDecoder::create(codec);
+  if (dec == 0)
+  {
+    cerr << "*** WARNING: Failed to create a " << codec
+         << " audio decoder for transcoding" << endl;
+    return 0;
+  }
+  m_decoders[codec] = dec;
+  return dec;
+} /* ReflectorTranscoder::findDecoder */
+
+
+AudioEncoder *ReflectorTranscoder::findEncoder(const std::string& codec)
+{
+  EncoderMap::iterator it = m_encoders.find(codec);
+  if (it != m_encoders.end())
+  {
+    return (*it).second;
+  }
+  AudioEncoder *enc = AudioEncoder::create(codec);
+  if (enc == 0)
+  {
+    cerr << "*** WARNING: Failed to create a " << codec
+         << " audio encoder for transcoding" << endl;
+    return 0;
+  }
+  enc->writeEncodedSamples.connect(
+      sigc::bind(mem_fun(*this, &ReflectorTranscoder::onEncodedSamples),
+                 codec));
+  enc->flushEncodedSamples.connect(
+      sigc::bind(mem_fun(*this, &ReflectorTranscoder::onEncoderFlushed),
+                 codec));
+  m_encoders[codec] = enc;
+  return enc;
+} /* ReflectorTranscoder::findEncoder */
+
+
+void ReflectorTranscoder::flushEncoders(void)
+{
+  for (CodecSet::iterator it = m_flush_codecs.begin();
+       it != m_flush_codecs.end(); ++it)
+  {
+    m_encoders[*it]->flushSamples();
+  }
+  m_flush_codecs.clear();
+} /* ReflectorTranscoder::flushEncoders */
+
+
+void ReflectorTranscoder::onEncodedSamples(const void *buf, int size,
+                                           std::string codec)
+{
+  transcodedAudio(codec, buf, size);
+} /* ReflectorTranscoder::onEncodedSamples */
+
+
+void ReflectorTranscoder::onEncoderFlushed(std::string codec)
+{
+  m_encoders[codec]->allEncodedSamplesFlushed();
+  transcodedFlush(codec);
+} /* ReflectorTranscoder::onEncoderFlushed */
+
+
+
+/*
+ * This file has not been truncated
+ */
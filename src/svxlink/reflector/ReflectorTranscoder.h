@@ -0,0 +1,266 @@
+/**
+@file	 ReflectorTranscoder.h
+@brief   Transcode talker audio to the codecs used by the client groups
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-11-12
+
+\verbatim
+SvxReflector - An audio reflector for connecting SvxLink Servers
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef REFLECTOR_TRANSCODER_INCLUDED
+#define REFLECTOR_TRANSCODER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <sigc++/sigc++.h>
+#include <string>
+#include <map>
+#include <set>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioSink.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+namespace Async
+{
+  class AudioEncoder;
+  class AudioDecoder;
+};
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Transcode talker audio to the codecs used by the client groups
+@author Tobias Blomberg / SM0SVX
+@date   2017-11-12
+
+The reflector normally forward the encoded audio from the talker untouched to
+all other clients. Clients using another codec than the talker are grouped by
+codec. The talker audio is decoded once and then encoded once for each codec
+group that need it, so the transcoding cost only depend on the number of codec
+groups and not on the number of clients.
+
+Decoders and encoders are created when first needed and are then kept, so the
+encoder state is preserved between talkers.
+*/
+class ReflectorTranscoder : public Async::AudioSink, public sigc::trackable
+{
+  public:
+    /**
+     * @brief   Check if transcoding to and from a codec is possible
+     * @param   codec The name of the codec
+     * @return  Returns \em true if both an encoder and a decoder is available
+     */
+    static bool codecIsAvailable(const std::string& codec);
+
+    /**
+     * @brief 	Default constructor
+     */
+    ReflectorTranscoder(void);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~ReflectorTranscoder(void);
+
+    /**
+     * @brief   Transcode a block of encoded audio
+     * @param   src_codec The codec used to encode the audio
+     * @param   dst_codecs The codecs to transcode the audio to
+     * @param   buf The encoded audio
+     * @param   size The size of the encoded audio in bytes
+     * @return  Returns \em true on success or else \em false
+     *
+     * The audio is decoded using the decoder for the source codec and the
+     * decoded audio is then written to the encoders for all destination
+     * codecs. Encoded audio is emitted through the transcodedAudio signal.
+     * The source codec should not be one of the destination codecs.
+     */
+    bool writeEncodedSamples(const std::string& src_codec,
+                             const std::set<std::string>& dst_codecs,
+                             void *buf, int size);
+
+    /**
+     * @brief   Flush the current talker stream
+     *
+     * This function should be called when the talker stop talking. The
+     * encoders are flushed when the decoder has flushed. When an encoder is
+     * done flushing, the transcodedFlush signal is emitted for its codec.
+     * Clients getting transcoded audio should not be told to flush before
+     * that since, when the codecs run in worker threads, transcoded audio may
+     * still be on its way when this function returns.
+     */
+    void flushEncodedSamples(void);
+
+    /**
+     * @brief   Tell the active decoder that talker packets have been lost
+     * @param   count The number of consecutive packets that was lost
+     *
+     * The decoder will conceal the lost audio when the next packet arrive so
+     * that the transcoded streams do not contain a gap.
+     */
+    void packetsLost(unsigned count);
+
+    /**
+     * @brief   Return the number of decoders created so far
+     * @return  Returns the number of cached decoders
+     */
+    unsigned decoderCount(void) const { return m_decoders.size(); }
+
+    /**
+     * @brief   Return the number of encoders created so far
+     * @return  Returns the number of cached encoders
+     */
+    unsigned encoderCount(void) const { return m_encoders.size(); }
+
+    /**
+     * @brief   Return the number of decoded blocks since creation
+     * @return  Returns the number of blocks written to a decoder
+     */
+    unsigned long decodeCount(void) const { return m_decode_cnt; }
+
+    /**
+     * @brief   Return the number of sample blocks that have been encoded
+     * @return  Returns the number of blocks written to an encoder
+     */
+    unsigned long encodeCount(void) const { return m_encode_cnt; }
+
+    /**
+     * @brief 	Write samples into this audio sink
+     * @param 	samples The buffer containing the samples
+     * @param 	count The number of samples in the buffer
+     * @return	Returns the number of samples that has been taken care of
+     *
+     * This function is called by the active decoder.
+     */
+    virtual int writeSamples(const float *samples, int count);
+
+    /**
+     * @brief 	Tell the sink to flush the previously written samples
+     *
+     * This function is called by the active decoder.
+     */
+    virtual void flushSamples(void);
+
+    /**
+     * @brief   A signal emitted when transcoded audio is available
+     * @param   codec The codec the audio has been encoded with
+     * @param   buf The encoded audio
+     * @param   size The size of the encoded audio in bytes
+     */
+    sigc::signal<void, const std::string&, const void*, int> transcodedAudio;
+
+    /**
+     * @brief   A signal emitted when an encoder has been flushed
+     * @param   codec The codec of the encoder
+     *
+     * All transcoded audio for the stream has been emitted through the
+     * transcodedAudio signal when this signal is emitted.
+     */
+    sigc::signal<void, const std::string&> transcodedFlush;
+
+  protected:
+
+  private:
+    typedef std::map<std::string, Async::AudioDecoder*> DecoderMap;
+    typedef std::map<std::string, Async::AudioEncoder*> EncoderMap;
+    typedef std::set<std::string>                       CodecSet;
+
+    DecoderMap            m_decoders;
+    EncoderMap            m_encoders;
+    Async::AudioDecoder*  m_dec;
+    CodecSet              m_dst_codecs;
+    CodecSet              m_flush_codecs;
+    bool                  m_stream_active;
+    unsigned long         m_decode_cnt;
+    unsigned long         m_encode_cnt;
+
+    ReflectorTranscoder(const ReflectorTranscoder&);
+    ReflectorTranscoder& operator=(const ReflectorTranscoder&);
+    Async::AudioDecoder *findDecoder(const std::string& codec);
+    Async::AudioEncoder *findEncoder(const std::string& codec);
+    void flushEncoders(void);
+    void onEncodedSamples(const void *buf, int size, std::string codec);
+    void onEncoderFlushed(std::string codec);
+
+};  /* class ReflectorTranscoder */
+
+
+#endif /* REFLECTOR_TRANSCODER_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -65,6 +65,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncCppApplication.h>
 #include <AsyncFdWatch.h>
 #include <AsyncConfig.h>
+#include <AsyncLog.h>
+#include <AsyncAudioCodecPool.h>
+#include <AsyncMetricsHttpServer.h>
 #include <config.h>
 
 
@@ -113,14 +116,9 @@ using namespace Async;
 
 static void parse_arguments(int argc, const char **argv);
 static void stdinHandler(FdWatch *w);
-static void stdout_handler(FdWatch *w);
 static void sighup_handler(int signal);
 static void sigterm_handler(int signal);
 static void handle_unix_signal(int signum);
-static bool logfile_open(void);
-static void logfile_reopen(const char *reason);
-static bool logfile_write_timestamp(void);
-static void logfile_write(const char *buf);
 static void logfile_flush(void);
 
 
@@ -143,9 +141,7 @@ static char             *logfile_name = NULL;
 static char             *runasuser = NULL;
 static char   	      	*config = NULL;
 static int    	      	daemonize = 0;
-static int    	      	logfd = -1;
 static FdWatch	      	*stdin_watch = 0;
-static FdWatch	      	*stdout_watch = 0;
 static string         	tstamp_format;
 
 
@@ -187,7 +183,7 @@ int main(int argc, const char *argv[])
   if (logfile_name != 0)
   {
       /* Open the logfile */
-    if (!logfile_open())
+    if (!Log::openLogfile(logfile_name))
     {
       exit(1);
     }
@@ -210,8 +206,7 @@ int main(int argc, const char *argv[])
       perror("fcntl(..., F_SETFL)");
       exit(1);
     }
-    stdout_watch = new FdWatch(pipefd[0], FdWatch::FD_WATCH_RD);
-    stdout_watch->activity.connect(sigc::ptr_fun(&stdout_handler));
+    Log::setInputFd(pipefd[0]);
 
       /* Redirect stdout to the logpipe */
     if (close(STDOUT_FILENO) == -1)
@@ -406,6 +401,19 @@ int main(int argc, const char *argv[])
   }
 
   cfg.getValue("GLOBAL", "TIMESTAMP_FORMAT", tstamp_format);
+  Log::setTimestampFormat(tstamp_format);
+  string log_level;
+  if (cfg.getValue("GLOBAL", "LOG_LEVEL", log_level) &&
+      !Log::setLevels(log_level))
+  {
+    cerr << "*** ERROR: Illegal format for configuration variable "
+            "GLOBAL/LOG_LEVEL: " << log_level << endl;
+    exit(1);
+  }
+  if (!Log::start())
+  {
+    exit(1);
+  }
 
   cout << PROGRAM_NAME " v" SVXREFLECTOR_VERSION
           " Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX\n\n";
@@ -430,6 +438,31 @@ int main(int argc, const char *argv[])
     stdin_watch->activity.connect(sigc::ptr_fun(&stdinHandler));
   }
 
+    // The codec pool must be configured before any codecs are created
+  unsigned codec_threads = 0;
+  if (cfg.getValue("GLOBAL", "CODEC_THREADS", codec_threads) &&
+      (codec_threads > 0))
+  {
+    cout << "--- Running audio codecs in " << codec_threads
+         << " worker thread(s)\n";
+    AudioCodecPool::setDefaultThreadCount(codec_threads);
+  }
+
+  MetricsHttpServer *metrics_srv = 0;
+  string metrics_port;
+  if (cfg.getValue("GLOBAL", "METRICS_LISTEN_PORT", metrics_port) &&
+      !metrics_port.empty())
+  {
+    IpAddress metrics_bind_ip;
+    string bind_ip_str;
+    if (cfg.getValue("GLOBAL", "METRICS_BIND_IP", bind_ip_str))
+    {
+      metrics_bind_ip = IpAddress(bind_ip_str);
+    }
+    cout << "--- Serving metrics on TCP port " << metrics_port << endl;
+    metrics_srv = new MetricsHttpServer(metrics_port, metrics_bind_ip);
+  }
+
   Reflector ref;
   if (ref.initialize(cfg))
   {
@@ -440,6 +473,8 @@ int main(int argc, const char *argv[])
     cerr << ":-(" << endl;
   }
 
+  delete metrics_srv;
+
   logfile_flush();
 
   if (stdin_watch != 0)
@@ -448,18 +483,12 @@ int main(int argc, const char *argv[])
     tcsetattr(STDIN_FILENO, TCSANOW, &org_termios);
   }
 
-  if (stdout_watch != 0)
+  if (pipefd[0] != -1)
   {
-    delete stdout_watch;
     close(pipefd[0]);
     close(pipefd[1]);
   }
 
-  if (logfd != -1)
-  {
-    close(logfd);
-  }
-
   return 0;
 } /* main */
 
@@ -576,22 +605,6 @@ static void stdinHandler(FdWatch *w)
 } /* stdinHandler */
 
 
-static void stdout_handler(FdWatch *w)
-{
-  ssize_t len =  0;
-  do
-  {
-    char buf[256];
-    len = read(w->fd(), buf, sizeof(buf)-1);
-    if (len > 0)
-    {
-      buf[len] = 0;
-      logfile_write(buf);
-    }
-  } while (len > 0);
-} /* stdout_handler  */
-
-
 static void sighup_handler(int signal)
 {
   if (logfile_name == 0)
@@ -599,7 +612,7 @@ static void sighup_handler(int signal)
     cout << "Ignoring SIGHUP\n";
     return;
   }
-  logfile_reopen("SIGHUP received");
+  Log::reopenLogfile("SIGHUP received");
 } /* sighup_handler */
 
 
@@ -621,7 +634,7 @@ static void sigterm_handler(int signal)
   string msg("\n");
   msg += signame;
   msg += " received. Shutting down application...\n";
-  logfile_write(msg.c_str());
+  cout << msg << flush;
   Application::app().quit();
 } /* sigterm_handler */
 
@@ -641,130 +654,11 @@ static void handle_unix_signal(int signum)
 } /* handle_unix_signal */
 
 
-static bool logfile_open(void)
-{
-  if (logfd != -1)
-  {
-    close(logfd);
-  }
-
-  logfd = open(logfile_name, O_WRONLY | O_APPEND | O_CREAT, 00644);
-  if (logfd == -1)
-  {
-    ostringstream ss;
-    ss << "open(\"" << logfile_name << "\")";
-    perror(ss.str().c_str());
-    return false;
-  }
-
-  return true;
-
-} /* logfile_open */
-
-
-static void logfile_reopen(const char *reason)
-{
-  logfile_write_timestamp();
-  string msg(reason);
-  msg += ". Reopening logfile\n";
-  if (write(logfd, msg.c_str(), msg.size()) == -1) {}
-
-  logfile_open();
-
-  logfile_write_timestamp();
-  msg = reason;
-  msg += ". Logfile reopened\n";
-  if (write(logfd, msg.c_str(), msg.size()) == -1) {}
-} /* logfile_reopen */
-
-
-static bool logfile_write_timestamp(void)
-{
-  if (!tstamp_format.empty())
-  {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    string fmt(tstamp_format);
-    const string frac_code("%f");
-    size_t pos = fmt.find(frac_code);
-    if (pos != string::npos)
-    {
-      stringstream ss;
-      ss << setfill('0') << setw(3) << (tv.tv_usec / 1000);
-      fmt.replace(pos, frac_code.length(), ss.str());
-    }
-    struct tm *tm = localtime(&tv.tv_sec);
-    char tstr[256];
-    size_t tlen = strftime(tstr, sizeof(tstr), fmt.c_str(), tm);
-    ssize_t ret = write(logfd, tstr, tlen);
-    if (ret != static_cast<ssize_t>(tlen))
-    {
-      return false;
-    }
-    ret = write(logfd, ": ", 2);
-    if (ret != 2)
-    {
-      return false;
-    }
-  }
-  return true;
-} /* logfile_write_timestamp */
-
-
-static void logfile_write(const char *buf)
-{
-  if (logfd == -1)
-  {
-    cout << buf;
-    return;
-  }
-
-  const char *ptr = buf;
-  while (*ptr != 0)
-  {
-    static bool print_timestamp = true;
-    ssize_t ret;
-
-    if (print_timestamp)
-    {
-      if (!logfile_write_timestamp())
-      {
-        logfile_reopen("Write error");
-        return;
-      }
-      print_timestamp = false;
-    }
-
-    size_t write_len = 0;
-    const char *nl = strchr(ptr, '\n');
-    if (nl != 0)
-    {
-      write_len = nl-ptr+1;
-      print_timestamp = true;
-    }
-    else
-    {
-      write_len = strlen(ptr);
-    }
-    ret = write(logfd, ptr, write_len);
-    if (ret != static_cast<ssize_t>(write_len))
-    {
-      logfile_reopen("Write error");
-      return;
-    }
-    ptr += write_len;
-  }
-} /* logfile_write */
-
-
 static void logfile_flush(void)
 {
   cout.flush();
   cerr.flush();
-  if (stdout_watch != 0)
-  {
-    stdout_handler(stdout_watch);
-  }
+  Log::stop();
 } /*  logfile_flush */
 
 
@@ -35,6 +35,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iostream>
 #include <cstring>
 #include <cerrno>
+#include <algorithm>
 
 
 /****************************************************************************
@@ -125,13 +126,13 @@ using namespace NetTrxMsg;
 
 NetUplink::NetUplink(Config &cfg, const string &name, Rx *rx, Tx *tx,
       	      	     const string& port_str)
-  : server(0), con(0), recv_cnt(0), recv_exp(0), rx(rx), tx(tx), fifo(0),
-    cfg(cfg), name(name), last_msg_timestamp(), heartbeat_timer(0),
-    audio_enc(0), audio_dec(0), loopback_con(0), rx_splitter(0),
-    tx_selector(0), state(STATE_DISC), mute_tx_timer(0), tx_muted(false),
-    fallback_enabled(false), tx_ctrl_mode(Tx::TX_OFF)
+  : server(0), max_clients(1), rx(rx), tx(tx), cfg(cfg), name(name),
+    heartbeat_timer(0), loopback_con(0), rx_splitter(0), tx_selector(0),
+    mute_tx_timer(0), tx_muted(false), fallback_enabled(false),
+    tx_ctrl_mode(Tx::TX_OFF), ctcss_enabled(false),
+    rx_mute_state(Rx::MUTE_ALL), send_batch_pending(false)
 {
-  heartbeat_timer = new Timer(10000);
+  heartbeat_timer = new Timer(10000, Timer::TYPE_PERIODIC);
   heartbeat_timer->setEnable(false);
   heartbeat_timer->expired.connect(mem_fun(*this, &NetUplink::heartbeat));
 
@@ -145,9 +146,16 @@ NetUplink::NetUplink(Config &cfg, const string &name, Rx *rx, Tx *tx,
 
 NetUplink::~NetUplink(void)
 {
-  delete audio_enc;
-  delete audio_dec;
-  delete fifo;
+  while (!clients.empty())
+  {
+    Client *client = clients.front();
+    releaseRxEncoder(client);
+    delete client->audio_dec;
+    tx_selector->removeSource(client->fifo);
+    delete client->fifo;
+    delete client;
+    clients.pop_front();
+  }
   delete tx_selector;
   delete rx_splitter;
   delete loopback_con;
@@ -192,6 +200,14 @@ bool NetUplink::initialize(void)
   
   cfg.getValue(name, "FALLBACK_REPEATER", fallback_enabled, true);
   cfg.getValue(name, "AUTH_KEY", auth_key, true);
+
+  if (cfg.getValue(name, "MAX_CLIENTS", max_clients, true) &&
+      (max_clients < 1))
+  {
+    cerr << "*** ERROR: Configuration variable " << name
+      	 << "/MAX_CLIENTS must be at least 1.\n";
+    return false;
+  }
   
   int mute_tx_on_rx = -1;
   cfg.getValue(name, "MUTE_TX_ON_RX", mute_tx_on_rx, true);
@@ -229,10 +245,6 @@ bool NetUplink::initialize(void)
   tx_selector = new AudioSelector;
   tx_selector->addSource(loopback_con);
 
-  fifo = new AudioFifo(16000);
-  tx_selector->addSource(fifo);
-  tx_selector->selectSource(fifo);
-
   tx_selector->registerSink(tx);
   
   if (fallback_enabled)
@@ -267,47 +279,56 @@ bool NetUplink::initialize(void)
 
 void NetUplink::handleIncomingConnection(TcpConnection *incoming_con)
 {
-  assert(con == 0);
-  rx->reset();
-  if (fallback_enabled) // Deactivate fallback repeater mode
-  {
-    setFallbackActive(false);
-  }
-  
-  if (audio_enc != 0)
+  if (clients.empty())
   {
-    rx_splitter->removeSink(audio_enc);
-    delete audio_enc;
-    audio_enc = 0;
+    rx->reset();
+    rx_mute_state = Rx::MUTE_ALL;
+    rx_tone_fqs.clear();
+    if (fallback_enabled) // Deactivate fallback repeater mode
+    {
+      setFallbackActive(false);
+    }
+    heartbeat_timer->setEnable(true);
   }
   
-  delete audio_dec;
-  audio_dec = 0;
+  Client *client = new Client;
+  client->con = incoming_con;
+  client->state = STATE_CON_SETUP;
+  gettimeofday(&client->last_msg_timestamp, NULL);
+  client->rx_enc = 0;
+  client->audio_dec = 0;
+  client->fifo = new AudioFifo(16000);
+  client->mute_state = Rx::MUTE_ALL;
+  client->tx_ctrl_mode = Tx::TX_OFF;
+  client->ctcss_enabled = false;
+  client->send_batch_pending = false;
+  clients.push_back(client);
+
+    // The TX audio from all clients is fed to the transmitter through
+    // the selector. The first client to send audio get the transmitter.
+  tx_selector->addSource(client->fifo);
+  tx_selector->enableAutoSelect(client->fifo, 0);
   
-  con = incoming_con;
-  con->dataReceived.connect(mem_fun(*this, &NetUplink::tcpDataReceived));
-  recv_exp = sizeof(Msg);
-  recv_cnt = 0;
-  heartbeat_timer->setEnable(true);
-  gettimeofday(&last_msg_timestamp, NULL);
+  incoming_con->dataReceived.connect(
+      mem_fun(*this, &NetUplink::tcpDataReceived));
+  incoming_con->setSendQueueSize(SEND_QUEUE_SIZE);
+  incoming_con->setRecvBufLen(RECV_BUF_SIZE);
   
-  setState(STATE_CON_SETUP);
-
   MsgProtoVer *ver_msg = new MsgProtoVer;
-  sendMsg(ver_msg);
+  sendMsg(client, ver_msg);
   
   if (auth_key.empty())
   {
     MsgAuthOk *auth_msg = new MsgAuthOk;
-    sendMsg(auth_msg);
-    setState(STATE_READY);
+    sendMsg(client, auth_msg);
+    client->state = STATE_READY;
   }
   else
   {
     MsgAuthChallenge *auth_msg = new MsgAuthChallenge;
-    memcpy(auth_challenge, auth_msg->challenge(),
+    memcpy(client->auth_challenge, auth_msg->challenge(),
            MsgAuthChallenge::CHALLENGE_LEN);
-    sendMsg(auth_msg);
+    sendMsg(client, auth_msg);
   }
 } /* NetUplink::handleIncomingConnection */
 
@@ -317,35 +338,47 @@ void NetUplink::clientConnected(TcpConnection *incoming_con)
   cout << name << ": Client connected: " << incoming_con->remoteHost() << ":"
        << incoming_con->remotePort() << endl;
   
-  switch (state)
+  if (clients.size() >= max_clients)
   {
-    case STATE_DISC:
-      handleIncomingConnection(incoming_con);
-      break;
-    case STATE_CON_SETUP:
-    case STATE_READY:
-      cout << name << ": Only one client allowed. Disconnecting...\n";
-      // Fall through
-    case STATE_DISC_CLEANUP:
-      incoming_con->disconnect();
-      break;
+    cout << name << ": Maximum number of clients (" << max_clients
+         << ") already connected. Disconnecting...\n";
+    incoming_con->disconnect();
+    return;
   }
+
+  handleIncomingConnection(incoming_con);
 } /* NetUplink::clientConnected */
 
 
-void NetUplink::disconnectCleanup(void)
+void NetUplink::clientCleanup(Client *client)
 {
-  con = 0;
-  recv_exp = 0;
-  setState(STATE_DISC);
+  releaseRxEncoder(client);
+  client->fifo->clear();
+  delete client->audio_dec;
+  tx_selector->removeSource(client->fifo);
+  delete client->fifo;
+  clients.remove(client);
+  delete client;
+
+  if (clients.empty())
+  {
+    disconnectCleanup();
+  }
+  else
+  {
+    updateRxMuteState();
+    updateTxState();
+  }
+} /* NetUplink::clientCleanup */
 
+
+void NetUplink::disconnectCleanup(void)
+{
   rx->reset();
+  rx_mute_state = Rx::MUTE_ALL;
+  rx_tone_fqs.clear();
   tx->enableCtcss(false);
-  fifo->clear();
-  if (audio_dec != 0)
-  {
-    audio_dec->flushEncodedSamples();
-  }
+  ctcss_enabled = false;
   tx->setTxCtrlMode(Tx::TX_OFF);
   heartbeat_timer->setEnable(false);
 
@@ -371,95 +404,100 @@ void NetUplink::disconnectCleanup(void)
 void NetUplink::clientDisconnected(TcpConnection *the_con,
                                    TcpConnection::DisconnectReason reason)
 {
+  Client *client = findClient(the_con);
+  if (client == 0)
+  {
+    return;
+  }
+
   cout << name << ": Client disconnected: " << the_con->remoteHost() << ":"
        << the_con->remotePort() << endl;
-  con = 0;
-  setState(STATE_DISC_CLEANUP);
-  Application::app().runTask(mem_fun(*this, &NetUplink::disconnectCleanup));
+
+    // The client is removed later since we may be called from a loop
+    // iterating over the clients
+  client->con = 0;
+  client->state = STATE_DISC_CLEANUP;
+  Application::app().runTask(
+      sigc::bind(mem_fun(*this, &NetUplink::clientCleanup), client));
 } /* NetUplink::clientDisconnected */
 
 
+NetUplink::Client *NetUplink::findClient(TcpConnection *con)
+{
+  for (ClientList::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    if ((*it)->con == con)
+    {
+      return *it;
+    }
+  }
+  return 0;
+} /* NetUplink::findClient */
+
+
+unsigned NetUplink::readyClientCount(void) const
+{
+  unsigned cnt = 0;
+  for (ClientList::const_iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    if ((*it)->state == STATE_READY)
+    {
+      ++cnt;
+    }
+  }
+  return cnt;
+} /* NetUplink::readyClientCount */
+
+
 int NetUplink::tcpDataReceived(TcpConnection *con, void *data, int size)
 {
   //cout << "NetRx::tcpDataReceived: size=" << size << endl;
   
-  //Msg *msg = reinterpret_cast<Msg*>(data);
-  //cout << "Received a TCP message with type " << msg->type()
-  //     << " and size " << msg->size() << endl;
-  
-    // Discard data if we are not in one of the "connected" states
-  if ((state != STATE_CON_SETUP) && (state != STATE_READY))
+    // Discard data if the client is not in one of the "connected" states
+  Client *client = findClient(con);
+  if ((client == 0) ||
+      ((client->state != STATE_CON_SETUP) && (client->state != STATE_READY)))
   {
     return size;
   }
 
-  if (recv_exp == 0)
-  {
-    cerr << "*** ERROR: Unexpected TCP data received in NetUplink "
-         << name << ". Throwing it away...\n";
-    return size;
-  }
-  
-  int orig_size = size;
-  
+    // Complete messages are handled in place in the receive buffer of the
+    // connection. A trailing partial message is left in the connection
+    // receive buffer and will be presented again when more data arrive.
+    // Messages that are not aligned are copied before being handled.
   char *buf = static_cast<char*>(data);
-  while (size > 0)
+  int processed = 0;
+  while (size - processed >= static_cast<int>(sizeof(Msg)))
   {
-    unsigned read_cnt = min(static_cast<unsigned>(size), recv_exp-recv_cnt);
-    if (recv_cnt+read_cnt > sizeof(recv_buf))
+    Msg *msg = reinterpret_cast<Msg*>(buf + processed);
+    if ((msg->size() < sizeof(Msg)) || (msg->size() > Msg::MAX_SIZE))
     {
-      cerr << "*** ERROR: TCP receive buffer overflow in NetUplink "
-           << name << ". Disconnecting...\n";
-      forceDisconnect();
-      return orig_size;
+      cerr << "*** ERROR: Illegal message header received in NetUplink "
+           << name << ". Illegal message length (" << msg->size()
+           << ")\n";
+      forceDisconnect(client);
+      return size;
     }
-    memcpy(recv_buf+recv_cnt, buf, read_cnt);
-    size -= read_cnt;
-    recv_cnt += read_cnt;
-    buf += read_cnt;
-    
-    if (recv_cnt == recv_exp)
+    if (static_cast<int>(msg->size()) > size - processed)
     {
-      if (recv_exp == sizeof(Msg))
-      {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-	if (msg->size() == sizeof(Msg))
-	{
-	  handleMsg(msg);
-	  recv_cnt = 0;
-	  recv_exp = sizeof(Msg);
-	}
-	else if (msg->size() > sizeof(Msg))
-	{
-      	  recv_exp = msg->size();
-	}
-	else
-	{
-	  cerr << "*** ERROR: Illegal message header received in NetUplink "
-               << name << ". Header length too small (" << msg->size()
-               << ")\n";
-          forceDisconnect();
-	  return orig_size;
-	}
-      }
-      else
-      {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-      	handleMsg(msg);
-	recv_cnt = 0;
-	recv_exp = sizeof(Msg);
-      }
+      break;
+    }
+    processed += msg->size();
+    handleMsg(client, msg_aligner.align(msg));
+    if ((client->state != STATE_CON_SETUP) && (client->state != STATE_READY))
+    {
+      return size;
     }
   }
   
-  return orig_size;
+  return processed;
   
 } /* NetUplink::tcpDataReceived */
 
 
-void NetUplink::handleMsg(Msg *msg)
+void NetUplink::handleMsg(Client *client, Msg *msg)
 {
-  switch (state)
+  switch (client->state)
   {
     case STATE_DISC:
     case STATE_DISC_CLEANUP:
@@ -470,24 +508,24 @@ void NetUplink::handleMsg(Msg *msg)
           msg->size() == sizeof(MsgAuthResponse))
       {
         MsgAuthResponse *resp_msg = reinterpret_cast<MsgAuthResponse *>(msg);
-        if (!resp_msg->verify(auth_key, auth_challenge))
+        if (!resp_msg->verify(auth_key, client->auth_challenge))
         {
           cerr << "*** ERROR: Authentication error in NetUplink "
                << name << ".\n";
-          forceDisconnect();
+          forceDisconnect(client);
           return;
         }
         else
         {
           MsgAuthOk *ok_msg = new MsgAuthOk;
-          sendMsg(ok_msg);
+          sendMsg(client, ok_msg);
         }
-        setState(STATE_READY);
+        client->state = STATE_READY;
       }
       else
       {
         cerr << "*** ERROR: Protocol error in NetUplink " << name << ".\n";
-        forceDisconnect();
+        forceDisconnect(client);
       }
       return;
     
@@ -495,7 +533,7 @@ void NetUplink::handleMsg(Msg *msg)
       break;
   }
   
-  gettimeofday(&last_msg_timestamp, NULL);
+  gettimeofday(&client->last_msg_timestamp, NULL);
   
   switch (msg->type())
   {
@@ -506,7 +544,18 @@ void NetUplink::handleMsg(Msg *msg)
     
     case MsgReset::TYPE:
     {
-      rx->reset();
+      client->mute_state = Rx::MUTE_ALL;
+      client->tone_fqs.clear();
+      if (readyClientCount() == 1)
+      {
+        rx->reset();
+        rx_mute_state = Rx::MUTE_ALL;
+        rx_tone_fqs.clear();
+      }
+      else
+      {
+        updateRxMuteState();
+      }
       break;
     }
     
@@ -516,36 +565,39 @@ void NetUplink::handleMsg(Msg *msg)
       cout << rx->name() << ": SetMuteState("
            << Rx::muteStateToString(mute_msg->muteState())
       	   << ")\n";
-      rx->setMuteState(mute_msg->muteState());
+      client->mute_state = mute_msg->muteState();
+      updateRxMuteState();
       break;
     }
     
     case MsgAddToneDetector::TYPE:
     {
       MsgAddToneDetector *atd = reinterpret_cast<MsgAddToneDetector*>(msg);
-      cout << rx->name() << ": AddToneDetector(" << atd->fq()
-      	   << ", " << atd->bw()
-	   << ", " << atd->requiredDuration() << ")\n";
-      rx->addToneDetector(atd->fq(), atd->bw(), atd->thresh(),
-      	      	      	  atd->requiredDuration());
+      client->tone_fqs.insert(atd->fq());
+      if (rx_tone_fqs.insert(atd->fq()).second)
+      {
+        cout << rx->name() << ": AddToneDetector(" << atd->fq()
+             << ", " << atd->bw()
+             << ", " << atd->requiredDuration() << ")\n";
+        rx->addToneDetector(atd->fq(), atd->bw(), atd->thresh(),
+                            atd->requiredDuration());
+      }
       break;
     }
     
     case MsgSetTxCtrlMode::TYPE:
     {
       MsgSetTxCtrlMode *mode_msg = reinterpret_cast<MsgSetTxCtrlMode *>(msg);
-      tx_ctrl_mode = mode_msg->mode();
-      if (!tx_muted)
-      {
-	tx->setTxCtrlMode(tx_ctrl_mode);
-      }
+      client->tx_ctrl_mode = mode_msg->mode();
+      updateTxState();
       break;
     }
      
     case MsgEnableCtcss::TYPE:
     {
       MsgEnableCtcss *ctcss_msg = reinterpret_cast<MsgEnableCtcss *>(msg);
-      tx->enableCtcss(ctcss_msg->enable());
+      client->ctcss_enabled = ctcss_msg->enable();
+      updateTxState();
       break;
     }
      
@@ -560,37 +612,7 @@ void NetUplink::handleMsg(Msg *msg)
     {
       MsgRxAudioCodecSelect *codec_msg = 
           reinterpret_cast<MsgRxAudioCodecSelect *>(msg);
-      if (audio_enc != 0)
-      {
-	rx_splitter->removeSink(audio_enc);
-	delete audio_enc;
-      }
-      audio_enc = AudioEncoder::create(codec_msg->name());
-      if (audio_enc != 0)
-      {
-        audio_enc->writeEncodedSamples.connect(
-                mem_fun(*this, &NetUplink::writeEncodedSamples));
-        audio_enc->flushEncodedSamples.connect(
-                mem_fun(*audio_enc, &AudioEncoder::allEncodedSamplesFlushed));
-        //audio_enc->registerSource(rx);
-	rx_splitter->addSink(audio_enc);
-        cout << name << ": Using CODEC \"" << audio_enc->name()
-             << "\" to encode RX audio\n";
-	
-	MsgRxAudioCodecSelect::Opts opts;
-	codec_msg->options(opts);
-	MsgRxAudioCodecSelect::Opts::const_iterator it;
-	for (it=opts.begin(); it!=opts.end(); ++it)
-	{
-	  audio_enc->setOption((*it).first, (*it).second);
-	}
-	audio_enc->printCodecParams();
-      }
-      else
-      {
-        cerr << "*** ERROR: Received request for unknown RX audio codec ("
-             << codec_msg->name() << ") in NetUplink " << name << "\n";
-      }
+      selectRxCodec(client, codec_msg);
       break;
     }
     
@@ -598,14 +620,15 @@ void NetUplink::handleMsg(Msg *msg)
     {
       MsgTxAudioCodecSelect *codec_msg = 
           reinterpret_cast<MsgTxAudioCodecSelect *>(msg);
-      delete audio_dec;
-      audio_dec = AudioDecoder::create(codec_msg->name());
-      if (audio_dec != 0)
+      delete client->audio_dec;
+      client->audio_dec = AudioDecoder::create(codec_msg->name());
+      if (client->audio_dec != 0)
       {
-        audio_dec->registerSink(fifo);
-        audio_dec->allEncodedSamplesFlushed.connect(
-            mem_fun(*this, &NetUplink::allEncodedSamplesFlushed));
-        cout << name << ": Using CODEC \"" << audio_dec->name()
+        client->audio_dec->registerSink(client->fifo);
+        client->audio_dec->allEncodedSamplesFlushed.connect(
+            sigc::bind(mem_fun(*this, &NetUplink::allEncodedSamplesFlushed),
+                       client));
+        cout << name << ": Using CODEC \"" << client->audio_dec->name()
              << "\" to decode TX audio\n";
 	
 	MsgRxAudioCodecSelect::Opts opts;
@@ -613,9 +636,9 @@ void NetUplink::handleMsg(Msg *msg)
 	MsgTxAudioCodecSelect::Opts::const_iterator it;
 	for (it=opts.begin(); it!=opts.end(); ++it)
 	{
-	  audio_dec->setOption((*it).first, (*it).second);
+	  client->audio_dec->setOption((*it).first, (*it).second);
 	}
-	audio_dec->printCodecParams();
+	client->audio_dec->printCodecParams();
       }
       else
       {
@@ -628,19 +651,20 @@ void NetUplink::handleMsg(Msg *msg)
     case MsgAudio::TYPE:
     {
       //cout << "NetUplink [MsgAudio]\n";
-      if (!tx_muted && (audio_dec != 0))
+      if (!tx_muted && (client->audio_dec != 0))
       {
         MsgAudio *audio_msg = reinterpret_cast<MsgAudio*>(msg);
-        audio_dec->writeEncodedSamples(audio_msg->buf(), audio_msg->size());
+        client->audio_dec->writeEncodedSamples(audio_msg->buf(),
+                                               audio_msg->size());
       }
       break;
     }
     
     case MsgFlush::TYPE:
     {
-      if (audio_dec != 0)
+      if (client->audio_dec != 0)
       {
-        audio_dec->flushEncodedSamples();
+        client->audio_dec->flushEncodedSamples();
       }
       break;
     } 
@@ -655,28 +679,214 @@ void NetUplink::handleMsg(Msg *msg)
 } /* NetUplink::handleMsg */
 
 
-void NetUplink::sendMsg(Msg *msg)
+void NetUplink::sendMsg(Client *client, Msg *msg)
+{
+  writeMsg(client, msg);
+  delete msg;
+} /* NetUplink::sendMsg */
+
+
+void NetUplink::broadcastMsg(Msg *msg)
 {
-  if ((state == STATE_CON_SETUP) || (state == STATE_READY))
+  for (ClientList::iterator it=clients.begin(); it!=clients.end(); ++it)
   {
-    int written = con->write(msg, msg->size());
-    if (written == -1)
+    if ((*it)->state == STATE_READY)
     {
-      cerr << "*** ERROR: TCP transmit error in NetUplink \"" << name
-           << "\": " << strerror(errno) << ".\n";
-      forceDisconnect();
+      writeMsg(*it, msg);
     }
-    else if (written != static_cast<int>(msg->size()))
+  }
+  delete msg;
+} /* NetUplink::broadcastMsg */
+
+
+void NetUplink::writeMsg(Client *client, const Msg *msg)
+{
+  if ((client->state != STATE_CON_SETUP) && (client->state != STATE_READY))
+  {
+    return;
+  }
+
+    // Messages sent during one main loop iteration are collected and
+    // written to the socket using one system call
+  if (!client->send_batch_pending)
+  {
+    client->send_batch_pending = true;
+    client->con->cork();
+  }
+  if (!send_batch_pending)
+  {
+    send_batch_pending = true;
+    Application::app().runTask(mem_fun(*this, &NetUplink::flushSendBatch));
+  }
+
+  int written = client->con->write(msg, msg->size());
+  if (written == -1)
+  {
+    cerr << "*** ERROR: TCP transmit error in NetUplink \"" << name
+         << "\": " << strerror(errno) << ".\n";
+    forceDisconnect(client);
+  }
+  else if (written != static_cast<int>(msg->size()))
+  {
+    cerr << "*** ERROR: TCP transmit buffer overflow in NetUplink "
+         << name << ".\n";
+    forceDisconnect(client);
+  }
+} /* NetUplink::writeMsg */
+
+
+void NetUplink::flushSendBatch(void)
+{
+  send_batch_pending = false;
+  for (ClientList::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    Client *client = *it;
+    if (client->send_batch_pending)
     {
-      cerr << "*** ERROR: TCP transmit buffer overflow in NetUplink "
-           << name << ".\n";
-      forceDisconnect();
+      client->send_batch_pending = false;
+      if (client->con != 0)
+      {
+        client->con->uncork();
+      }
+    }
+  }
+} /* NetUplink::flushSendBatch */
+
+
+void NetUplink::selectRxCodec(Client *client, MsgRxAudioCodecSelect *codec_msg)
+{
+  releaseRxEncoder(client);
+
+    // Clients asking for the same codec with the same options share one
+    // encoder so that the audio only is encoded once
+  MsgRxAudioCodecSelect::Opts opts;
+  codec_msg->options(opts);
+  string key(codec_msg->name());
+  MsgRxAudioCodecSelect::Opts::const_iterator it;
+  for (it=opts.begin(); it!=opts.end(); ++it)
+  {
+    key += ";" + (*it).first + "=" + (*it).second;
+  }
+
+  RxEncoder *rx_enc = 0;
+  RxEncoderMap::iterator eit = rx_encoders.find(key);
+  if (eit != rx_encoders.end())
+  {
+    rx_enc = (*eit).second;
+    cout << name << ": Sharing CODEC \"" << rx_enc->enc->name()
+         << "\" RX audio encoder with other clients\n";
+  }
+  else
+  {
+    AudioEncoder *audio_enc = AudioEncoder::create(codec_msg->name());
+    if (audio_enc == 0)
+    {
+      cerr << "*** ERROR: Received request for unknown RX audio codec ("
+           << codec_msg->name() << ") in NetUplink " << name << "\n";
+      return;
+    }
+    rx_enc = new RxEncoder;
+    rx_enc->key = key;
+    rx_enc->enc = audio_enc;
+    rx_encoders[key] = rx_enc;
+
+    audio_enc->writeEncodedSamples.connect(
+        sigc::bind(mem_fun(*this, &NetUplink::writeEncodedSamples), rx_enc));
+    audio_enc->flushEncodedSamples.connect(
+        mem_fun(*audio_enc, &AudioEncoder::allEncodedSamplesFlushed));
+    rx_splitter->addSink(audio_enc);
+    cout << name << ": Using CODEC \"" << audio_enc->name()
+         << "\" to encode RX audio\n";
+
+    for (it=opts.begin(); it!=opts.end(); ++it)
+    {
+      audio_enc->setOption((*it).first, (*it).second);
+    }
+    audio_enc->printCodecParams();
+  }
+
+  rx_enc->clients.push_back(client);
+  client->rx_enc = rx_enc;
+} /* NetUplink::selectRxCodec */
+
+
+void NetUplink::releaseRxEncoder(Client *client)
+{
+  RxEncoder *rx_enc = client->rx_enc;
+  if (rx_enc == 0)
+  {
+    return;
+  }
+  client->rx_enc = 0;
+
+  rx_enc->clients.remove(client);
+  if (rx_enc->clients.empty())
+  {
+    rx_splitter->removeSink(rx_enc->enc);
+    delete rx_enc->enc;
+    rx_encoders.erase(rx_enc->key);
+    delete rx_enc;
+  }
+} /* NetUplink::releaseRxEncoder */
+
+
+void NetUplink::updateRxMuteState(void)
+{
+    // The receiver is muted no more than what the least muting client
+    // have asked for
+  Rx::MuteState mute_state = Rx::MUTE_ALL;
+  for (ClientList::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    if (((*it)->state == STATE_READY) && ((*it)->mute_state < mute_state))
+    {
+      mute_state = (*it)->mute_state;
+    }
+  }
+  if (mute_state != rx_mute_state)
+  {
+    rx_mute_state = mute_state;
+    rx->setMuteState(mute_state);
+  }
+} /* NetUplink::updateRxMuteState */
+
+
+void NetUplink::updateTxState(void)
+{
+  Tx::TxCtrlMode mode = Tx::TX_OFF;
+  bool ctcss = false;
+  for (ClientList::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    Client *client = *it;
+    if (client->state != STATE_READY)
+    {
+      continue;
+    }
+    if (client->tx_ctrl_mode == Tx::TX_ON)
+    {
+      mode = Tx::TX_ON;
+    }
+    else if ((client->tx_ctrl_mode == Tx::TX_AUTO) && (mode == Tx::TX_OFF))
+    {
+      mode = Tx::TX_AUTO;
+    }
+    ctcss = ctcss || client->ctcss_enabled;
+  }
+
+  if (mode != tx_ctrl_mode)
+  {
+    tx_ctrl_mode = mode;
+    if (!tx_muted)
+    {
+      tx->setTxCtrlMode(tx_ctrl_mode);
     }
   }
-  
-  delete msg;
-  
-} /* NetUplink::sendMsg */
+
+  if (ctcss != ctcss_enabled)
+  {
+    ctcss_enabled = ctcss;
+    tx->enableCtcss(ctcss_enabled);
+  }
+} /* NetUplink::updateTxState */
 
 
 void NetUplink::squelchOpen(bool is_open)
@@ -696,7 +906,7 @@ void NetUplink::squelchOpen(bool is_open)
   
   MsgSquelch *msg = new MsgSquelch(is_open, rx->signalStrength(),
       	      	      	      	   rx->sqlRxId());
-  sendMsg(msg);
+  broadcastMsg(msg);
 } /* NetUplink::squelchOpen */
 
 
@@ -705,7 +915,7 @@ void NetUplink::dtmfDigitDetected(char digit, int duration)
   cout << name << ": DTMF digit detected: " << digit << " with duration " << duration
        << " milliseconds" << endl;
   MsgDtmf *msg = new MsgDtmf(digit, duration);
-  sendMsg(msg);
+  broadcastMsg(msg);
 } /* NetUplink::dtmfDigitDetected */
 
 
@@ -713,7 +923,14 @@ void NetUplink::toneDetected(float tone_fq)
 {
   cout << name << ": Tone detected: " << tone_fq << endl;
   MsgTone *msg = new MsgTone(tone_fq);
-  sendMsg(msg);
+  for (ClientList::iterator it=clients.begin(); it!=clients.end(); ++it)
+  {
+    if ((*it)->state == STATE_READY && ((*it)->tone_fqs.count(tone_fq) > 0))
+    {
+      writeMsg(*it, msg);
+    }
+  }
+  delete msg;
 } /* NetUplink::toneDetected */
 
 
@@ -721,11 +938,12 @@ void NetUplink::selcallSequenceDetected(std::string sequence)
 {
   // cout "Sel5 sequence detected: " << sequence << endl;
   MsgSel5 *msg = new MsgSel5(sequence);
-  sendMsg(msg);
+  broadcastMsg(msg);
 } /* NetUplink::selcallSequenceDetected */
 
 
-void NetUplink::writeEncodedSamples(const void *buf, int size)
+void NetUplink::writeEncodedSamples(const void *buf, int size,
+                                    RxEncoder *rx_enc)
 {
   //cout << "NetUplink::writeEncodedSamples: size=" << size << endl;
   const char *ptr = reinterpret_cast<const char *>(buf);
@@ -734,7 +952,12 @@ void NetUplink::writeEncodedSamples(const void *buf, int size)
     const int bufsize = MsgAudio::BUFSIZE;
     int len = min(size, bufsize);
     MsgAudio *msg = new MsgAudio(ptr, len);
-    sendMsg(msg);
+    ClientList::iterator it;
+    for (it=rx_enc->clients.begin(); it!=rx_enc->clients.end(); ++it)
+    {
+      writeMsg(*it, msg);
+    }
+    delete msg;
     size -= len;
     ptr += len;
   }
@@ -744,7 +967,7 @@ void NetUplink::writeEncodedSamples(const void *buf, int size)
 void NetUplink::txTimeout(void)
 {
   MsgTxTimeout *msg = new MsgTxTimeout;
-  sendMsg(msg);
+  broadcastMsg(msg);
 } /* NetUplink::txTimeout */
 
 
@@ -752,35 +975,43 @@ void NetUplink::transmitterStateChange(bool is_transmitting)
 {
   MsgTransmitterStateChange *msg =
       new MsgTransmitterStateChange(is_transmitting);
-  sendMsg(msg);
+  broadcastMsg(msg);
 } /* NetUplink::transmitterStateChange */
 
 
-void NetUplink::allEncodedSamplesFlushed(void)
+void NetUplink::allEncodedSamplesFlushed(Client *client)
 {
   MsgAllSamplesFlushed *msg = new MsgAllSamplesFlushed;
-  sendMsg(msg);
+  sendMsg(client, msg);
 } /* NetUplink::allEncodedSamplesFlushed */
 
 
 void NetUplink::heartbeat(Timer *t)
 {
-  MsgHeartbeat *msg = new MsgHeartbeat;
-  sendMsg(msg);
-  
-  struct timeval diff_tv;
   struct timeval now;
   gettimeofday(&now, NULL);
-  timersub(&now, &last_msg_timestamp, &diff_tv);
-  int diff_ms = diff_tv.tv_sec * 1000 + diff_tv.tv_usec / 1000;
-  
-  if (diff_ms > 15000)
+
+  for (ClientList::iterator it=clients.begin(); it!=clients.end(); ++it)
   {
-    cerr << "*** ERROR: Heartbeat timeout in NetUplink " << name << "\n";
-    forceDisconnect();
-  }
+    Client *client = *it;
+    if ((client->state != STATE_CON_SETUP) && (client->state != STATE_READY))
+    {
+      continue;
+    }
+
+    MsgHeartbeat *msg = new MsgHeartbeat;
+    sendMsg(client, msg);
   
-  t->reset();
+    struct timeval diff_tv;
+    timersub(&now, &client->last_msg_timestamp, &diff_tv);
+    int diff_ms = diff_tv.tv_sec * 1000 + diff_tv.tv_usec / 1000;
+  
+    if ((diff_ms > 15000) && (client->con != 0))
+    {
+      cerr << "*** ERROR: Heartbeat timeout in NetUplink " << name << "\n";
+      forceDisconnect(client);
+    }
+  }
   
 } /* NetTrxTcpClient::heartbeat */
 
@@ -813,7 +1044,7 @@ void NetUplink::setFallbackActive(bool activate)
   {
     cout << name << ": Deactivating fallback repeater mode\n";
     tx->setTxCtrlMode(Tx::TX_OFF);
-    tx_selector->selectSource(fifo);
+    tx_selector->selectSource(0);
   }
 } /* NetUplink::setFallbackActive */
 
@@ -822,12 +1053,17 @@ void NetUplink::signalLevelUpdated(float siglev)
 {
   MsgSiglevUpdate *msg = new MsgSiglevUpdate(rx->signalStrength(),
 					     rx->sqlRxId());
-  sendMsg(msg);  
+  broadcastMsg(msg);  
 } /* NetUplink::signalLevelUpdated */
 
 
-void NetUplink::forceDisconnect(void)
+void NetUplink::forceDisconnect(Client *client)
 {
+  TcpConnection *con = client->con;
+  if (con == 0)
+  {
+    return;
+  }
   con->disconnect();
   clientDisconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
 } /* NetUplink::forceDisconnect */
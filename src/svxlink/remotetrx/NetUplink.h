@@ -38,6 +38,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <sys/time.h>
 
 #include <string>
+#include <list>
+#include <map>
+#include <set>
 
 
 /****************************************************************************
@@ -130,6 +133,11 @@ namespace NetTrxMsg
 @date   2006-04-14
 
 This class implements a remote transceiver uplink via an IP network.
+More than one client may be connected at the same time, e.g. a primary and
+a backup SvxLink core. The receiver audio is encoded once for each audio
+codec in use and the encoded audio is sent to all clients using that codec.
+Tone detectors, receiver mute state and transmitter control requests from
+all clients are merged before being applied to the receiver and transmitter.
 */
 class NetUplink : public Uplink
 {
@@ -164,43 +172,82 @@ class NetUplink : public Uplink
     {
       STATE_DISC, STATE_CON_SETUP, STATE_READY, STATE_DISC_CLEANUP
     } State;
+
+    struct RxEncoder;
+
+    struct Client
+    {
+      Async::TcpConnection  *con;
+      State                 state;
+      unsigned char         auth_challenge[NetTrxMsg::MsgAuthChallenge::CHALLENGE_LEN];
+      struct timeval        last_msg_timestamp;
+      RxEncoder             *rx_enc;
+      Async::AudioDecoder   *audio_dec;
+      Async::AudioFifo      *fifo;
+      Rx::MuteState         mute_state;
+      std::set<float>       tone_fqs;
+      Tx::TxCtrlMode        tx_ctrl_mode;
+      bool                  ctcss_enabled;
+      bool                  send_batch_pending;
+    };
+    typedef std::list<Client*> ClientList;
+
+    struct RxEncoder
+    {
+      std::string           key;
+      Async::AudioEncoder   *enc;
+      ClientList            clients;
+    };
+    typedef std::map<std::string, RxEncoder*> RxEncoderMap;
+
+    static const size_t SEND_QUEUE_SIZE = 256 * 1024;
+    static const size_t RECV_BUF_SIZE = 16384;
     
     Async::TcpServer<Async::TcpConnection>*  server;
-    Async::TcpConnection    *con;
-    char      	      	    recv_buf[4096];
-    unsigned       	    recv_cnt;
-    unsigned       	    recv_exp;
+    ClientList              clients;
+    unsigned                max_clients;
+    RxEncoderMap            rx_encoders;
     Rx	      	      	    *rx;
     Tx	      	      	    *tx;
-    Async::AudioFifo  	    *fifo;
     Async::Config     	    &cfg;
     std::string       	    name;
-    struct timeval    	    last_msg_timestamp;
     Async::Timer      	    *heartbeat_timer;
-    Async::AudioEncoder     *audio_enc;
-    Async::AudioDecoder     *audio_dec;
     Async::AudioPassthrough *loopback_con;
     Async::AudioSplitter    *rx_splitter;
     Async::AudioSelector    *tx_selector;
-    State                   state;
     std::string             auth_key;
-    unsigned char           auth_challenge[NetTrxMsg::MsgAuthChallenge::CHALLENGE_LEN];
     Async::Timer      	    *siglev_check_timer;
     Async::Timer	    *mute_tx_timer;
     bool		    tx_muted;
     bool                    fallback_enabled;
     Tx::TxCtrlMode	    tx_ctrl_mode;
+    bool                    ctcss_enabled;
+    Rx::MuteState           rx_mute_state;
+    std::set<float>         rx_tone_fqs;
+    bool                    send_batch_pending;
+    NetTrxMsg::MsgAligner   msg_aligner;
     
     NetUplink(const NetUplink&);
     NetUplink& operator=(const NetUplink&);
     void handleIncomingConnection(Async::TcpConnection *incoming_con);
     void clientConnected(Async::TcpConnection *con);
+    void clientCleanup(Client *client);
     void disconnectCleanup(void);
     void clientDisconnected(Async::TcpConnection *con,
       	      	      	    Async::TcpConnection::DisconnectReason reason);
+    Client *findClient(Async::TcpConnection *con);
+    unsigned readyClientCount(void) const;
     int tcpDataReceived(Async::TcpConnection *con, void *data, int size);
-    void handleMsg(NetTrxMsg::Msg *msg);
-    void sendMsg(NetTrxMsg::Msg *msg);
+    void handleMsg(Client *client, NetTrxMsg::Msg *msg);
+    void sendMsg(Client *client, NetTrxMsg::Msg *msg);
+    void broadcastMsg(NetTrxMsg::Msg *msg);
+    void writeMsg(Client *client, const NetTrxMsg::Msg *msg);
+    void flushSendBatch(void);
+    void selectRxCodec(Client *client,
+                       NetTrxMsg::MsgRxAudioCodecSelect *codec_msg);
+    void releaseRxEncoder(Client *client);
+    void updateRxMuteState(void);
+    void updateTxState(void);
 
     /**
      * @brief 	Set squelch state to open/closed
@@ -227,17 +274,16 @@ class NetUplink : public Uplink
     void selcallSequenceDetected(std::string sequence);
 
 
-    void writeEncodedSamples(const void *buf, int size);
+    void writeEncodedSamples(const void *buf, int size, RxEncoder *rx_enc);
     void txTimeout(void);
     void transmitterStateChange(bool is_transmitting);
-    void allEncodedSamplesFlushed(void);
+    void allEncodedSamplesFlushed(Client *client);
     void heartbeat(Async::Timer *t);
     void checkSiglev(Async::Timer *t);
     void unmuteTx(Async::Timer *t);
     void setFallbackActive(bool activate);
     void signalLevelUpdated(float siglev);
-    void forceDisconnect(void);
-    void setState(State new_state) { state = new_state; }
+    void forceDisconnect(Client *client);
 
 };  /* class NetUplink */
 
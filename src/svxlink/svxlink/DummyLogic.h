@@ -131,6 +131,10 @@ class DummyLogic : public LogicBase
      */
     ~DummyLogic(void)
     {
+      if (LinkManager::hasInstance())
+      {
+        LinkManager::instance()->deleteLogic(this);
+      }
       delete m_logic_con_in;
       delete m_logic_con_out;
     }
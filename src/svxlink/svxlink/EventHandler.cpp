@@ -32,7 +32,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <sys/stat.h>
+#include <cerrno>
+
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
@@ -85,6 +91,14 @@ using namespace Async;
  *
  ****************************************************************************/
 
+struct CachedScript
+{
+  time_t  mtime;
+  off_t   size;
+  Tcl_Obj *script;
+};
+typedef map<string, CachedScript> ScriptCache;
+
 
 
 /****************************************************************************
@@ -110,6 +124,11 @@ using namespace Async;
  *
  ****************************************************************************/
 
+  // All logic cores source the same set of event scripts. To not have to
+  // read and convert all files once for each logic core, the script
+  // contents are cached and shared between all TCL interpreters.
+static ScriptCache script_cache;
+
 
 
 /****************************************************************************
@@ -150,6 +169,7 @@ EventHandler::EventHandler(const string& event_script, Logic *logic)
                     this, NULL);
   Tcl_CreateCommand(interp, "playDtmf", playDtmfHandler, this, NULL);
   Tcl_CreateCommand(interp, "injectDtmf", injectDtmfHandler, this, NULL);
+  Tcl_CreateObjCommand(interp, "source", sourceHandler, this, NULL);
 
   setVariable("script_path", event_script);
 
@@ -177,7 +197,7 @@ bool EventHandler::initialize(void)
     return false;
   }
   
-  if (Tcl_EvalFile(interp, event_script.c_str()) != TCL_OK)
+  if (evalFile(interp, event_script) != TCL_OK)
   {
     cerr << event_script << " in logic " << logic->name() << ": "
          << Tcl_GetStringResult(interp) << endl;
@@ -442,6 +462,131 @@ int EventHandler::injectDtmfHandler(ClientData cdata, Tcl_Interp *irp,
 } /* EventHandler::injectDtmfHandler */
 
 
+int EventHandler::sourceHandler(ClientData cdata, Tcl_Interp *irp,
+                                int objc, Tcl_Obj *const objv[])
+{
+  if (objc == 2)
+  {
+    return evalFile(irp, Tcl_GetString(objv[1]));
+  }
+
+  if ((objc == 4) && (strcmp(Tcl_GetString(objv[1]), "-encoding") == 0))
+  {
+    return Tcl_FSEvalFileEx(irp, objv[3], Tcl_GetString(objv[2]));
+  }
+
+  Tcl_WrongNumArgs(irp, 1, objv, "?-encoding name? fileName");
+  return TCL_ERROR;
+} /* EventHandler::sourceHandler */
+
+
+Tcl_Obj *EventHandler::cachedScript(const string& path)
+{
+  struct stat st;
+  if (stat(path.c_str(), &st) == -1)
+  {
+    return 0;
+  }
+
+  ScriptCache::iterator it = script_cache.find(path);
+  if (it != script_cache.end())
+  {
+    if ((it->second.mtime == st.st_mtime) && (it->second.size == st.st_size))
+    {
+      return it->second.script;
+    }
+    Tcl_DecrRefCount(it->second.script);
+    script_cache.erase(it);
+  }
+
+  ifstream file(path.c_str(), ios::in | ios::binary);
+  if (!file)
+  {
+    return 0;
+  }
+  stringstream ss;
+  ss << file.rdbuf();
+  string data(ss.str());
+
+    // Convert from the system encoding just like the source command does
+  Tcl_DString ds;
+  Tcl_ExternalToUtfDString(NULL, data.data(), data.size(), &ds);
+  Tcl_Obj *script = Tcl_NewStringObj(Tcl_DStringValue(&ds),
+                                     Tcl_DStringLength(&ds));
+  Tcl_DStringFree(&ds);
+  Tcl_IncrRefCount(script);
+
+  CachedScript &cached = script_cache[path];
+  cached.mtime = st.st_mtime;
+  cached.size = st.st_size;
+  cached.script = script;
+
+  return script;
+} /* EventHandler::cachedScript */
+
+
+int EventHandler::evalFile(Tcl_Interp *irp, const string& path)
+{
+  Tcl_Obj *script = cachedScript(path);
+  if (script == 0)
+  {
+    Tcl_ResetResult(irp);
+    Tcl_AppendResult(irp, "couldn't read file \"", path.c_str(), "\": ",
+                     strerror(errno), NULL);
+    return TCL_ERROR;
+  }
+
+    // Keep the script alive even if the cache entry is replaced while
+    // the script is being evaluated
+  Tcl_IncrRefCount(script);
+
+    // Make "info script" return the name of the file being sourced
+  if (Tcl_Eval(irp, "info script") != TCL_OK)
+  {
+    Tcl_DecrRefCount(script);
+    return TCL_ERROR;
+  }
+  Tcl_Obj *prev_script = Tcl_GetObjResult(irp);
+  Tcl_IncrRefCount(prev_script);
+  Tcl_Obj *info_script[] = {
+    Tcl_NewStringObj("info", -1), Tcl_NewStringObj("script", -1),
+    Tcl_NewStringObj(path.c_str(), -1)
+  };
+  for (int i=0; i<3; ++i)
+  {
+    Tcl_IncrRefCount(info_script[i]);
+  }
+  Tcl_EvalObjv(irp, 3, info_script, 0);
+  Tcl_ResetResult(irp);
+
+  int ret = Tcl_EvalObjEx(irp, script, 0);
+  if (ret == TCL_RETURN)
+  {
+    ret = TCL_OK;
+  }
+  else if (ret == TCL_ERROR)
+  {
+    string msg = "\n    (file \"" + path + "\")";
+    Tcl_AddErrorInfo(irp, msg.c_str());
+  }
+
+  Tcl_InterpState state = Tcl_SaveInterpState(irp, ret);
+  Tcl_DecrRefCount(info_script[2]);
+  info_script[2] = prev_script;
+  Tcl_EvalObjv(irp, 3, info_script, 0);
+  ret = Tcl_RestoreInterpState(irp, state);
+
+  for (int i=0; i<3; ++i)
+  {
+    Tcl_DecrRefCount(info_script[i]);
+  }
+  Tcl_DecrRefCount(script);
+
+  return ret;
+} /* EventHandler::evalFile */
+
+
+
 /*
  * This file has not been truncated
  */
@@ -35,6 +35,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <tcl.h>
+#include <sys/types.h>
 #include <sigc++/sigc++.h>
 
 #include <string>
@@ -241,6 +242,10 @@ class EventHandler : public sigc::trackable
                     int argc, const char *argv[]);
     static int injectDtmfHandler(ClientData cdata, Tcl_Interp *irp,
                     int argc, const char *argv[]);
+    static int sourceHandler(ClientData cdata, Tcl_Interp *irp,
+                    int objc, Tcl_Obj *const objv[]);
+    static Tcl_Obj *cachedScript(const std::string& path);
+    static int evalFile(Tcl_Interp *irp, const std::string& path);
 
 };  /* class EventHandler */
 
@@ -56,6 +56,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncAudioSplitter.h>
 #include <AsyncAudioSelector.h>
 #include <AsyncAudioPassthrough.h>
+#include <AsyncAudioLatencyProbe.h>
 
 
 /****************************************************************************
@@ -165,6 +166,13 @@ bool LinkManager::initialize(const Async::Config &cfg,
       // The link name is the same as the config section name
     link.name = *name_it;
 
+    link.active_gauge = Metrics::gauge("svxlink_link_active",
+        "Set to 1 when the logic link is active",
+        Metrics::label("link", link.name));
+    link.activation_cnt = Metrics::counter("svxlink_link_activations_total",
+        "Number of times the logic link has been activated",
+        Metrics::label("link", link.name));
+
       // Logic1:70:name1,Logic2:71:name2,...
     string connect_logics;
     cfg.getValue(link.name, "CONNECT_LOGICS", connect_logics);
@@ -299,7 +307,8 @@ void LinkManager::addLogic(LogicBase *logic)
     sinks[logic->name()].connectors[(*it).first] = connector;
   }
 
-  LogicInfo logic_info;
+    // Add the logic to the logic map
+  LogicInfo &logic_info = logic_map[logic->name()];
   logic_info.logic = logic;
 
     // Keep track of the newly added logics idle state so that we can start
@@ -307,9 +316,6 @@ void LinkManager::addLogic(LogicBase *logic)
   logic_info.idle_state_changed_con = logic->idleStateChanged.connect(
       sigc::bind(mem_fun(*this, &LinkManager::logicIdleStateChanged), logic));
 
-    // Add the logic to the logic map
-  logic_map[logic->name()] = logic_info;
-
     // Create command objects associated with this logic
   Logic *cmd_logic = dynamic_cast<Logic*>(logic);
   if (cmd_logic != 0)
@@ -328,11 +334,23 @@ void LinkManager::addLogic(LogicBase *logic)
           {
             cout << "*** WARNING: Can not setup command " << logic_props.cmd
                  << " for the logic " << logic->name() << endl;
+            delete link_cmd;
+          }
+          else
+          {
+            logic_info.link_cmds.push_back(link_cmd);
           }
         }
       }
     }
   }
+
+    // If the logic is added after startup, e.g. when it has been recreated
+    // after a configuration reload, connect it to all active links
+  if (all_logics_started)
+  {
+    establishWantedConnections();
+  }
 } /* LinkManager::addLogic */
 
 
@@ -353,6 +371,28 @@ void LinkManager::deleteLogic(LogicBase *logic)
     // logic was first registered.
   logic_info.idle_state_changed_con.disconnect();
 
+    // Delete the link commands that was added to the logic command parser
+  for (list<Command*>::iterator it = logic_info.link_cmds.begin();
+       it != logic_info.link_cmds.end(); ++it)
+  {
+    delete *it;
+  }
+  logic_info.link_cmds.clear();
+
+    // Forget all current connections to and from the logic
+  LogicConSet::iterator ccit = current_cons.begin();
+  while (ccit != current_cons.end())
+  {
+    if ((ccit->first == logic->name()) || (ccit->second == logic->name()))
+    {
+      current_cons.erase(ccit++);
+    }
+    else
+    {
+      ++ccit;
+    }
+  }
+
     // Delete the logic source splitter and all connections associated with it
   AudioSplitter *splitter = sources[logic->name()].splitter;
   for (SinkMap::iterator smit=sinks.begin(); smit!=sinks.end(); ++smit)
@@ -591,34 +631,11 @@ void LinkManager::activateLink(Link &link)
 
     // Mark link as activated
   link.is_activated = true;
+  link.active_gauge->set(1);
+  link.activation_cnt->inc();
 
-    // Get the wanted logic connections based on which links that are activated
-  LogicConSet want;
-  wantedConnections(want);
-
-    // Calculate the difference between the wanted connection set and the
-    // current connection set. This is easily done using the difference set
-    // operation. After this operation the "to_connect" variable will contain
-    // the set of logic connections that have to be established.
-  LogicConSet to_connect;
-  set_difference(want.begin(), want.end(),
-                 current_cons.begin(), current_cons.end(),
-                 inserter(to_connect, to_connect.end()));
-
-    // Establish missing connections
-  for (LogicConSet::iterator it = to_connect.begin();
-       it != to_connect.end();
-       ++it)
-  {
-    const string &src_name = it->first;
-    const string &sink_name = it->second;
-    //cout << "### " << src_name << " ===> " << sink_name << endl;
-    SinkInfo &sink = sinks[sink_name];
-    sink.selector->enableAutoSelect(sink.connectors[src_name], 0);
-
-      // Store all connections in "current_cons" (current connections)
-    current_cons.insert(*it);
-  }
+    // Establish the logic connections needed for the activated link
+  establishWantedConnections();
 
     // Check if the timeout timer should be enabled or disabled
   checkTimeoutTimer(link);
@@ -637,6 +654,7 @@ void LinkManager::deactivateLink(Link &link)
 
     // Clear the activation flag
   link.is_activated = false;
+  link.active_gauge->set(0);
 
     // Get the wanted connections
   LogicConSet want;
@@ -663,6 +681,10 @@ void LinkManager::deactivateLink(Link &link)
 
       // Disconnect the audio path from source logic to sink logic
     sink.selector->disableAutoSelect(sink.connectors[src_name]);
+    if (AudioLatencyProbe::isEnabled())
+    {
+      AudioLatencyProbe::unlinkTraces(src_name, sink_name);
+    }
 
       // Delete the link connect information
     current_cons.erase(*it);
@@ -674,6 +696,53 @@ void LinkManager::deactivateLink(Link &link)
 } /* LinkManager::deactivateLink */
 
 
+/**
+ * @brief Establish all missing logic connections for the active links
+ */
+void LinkManager::establishWantedConnections(void)
+{
+    // Get the wanted logic connections based on which links that are activated
+  LogicConSet want;
+  wantedConnections(want);
+
+    // Calculate the difference between the wanted connection set and the
+    // current connection set. This is easily done using the difference set
+    // operation. After this operation the "to_connect" variable will contain
+    // the set of logic connections that have to be established.
+  LogicConSet to_connect;
+  set_difference(want.begin(), want.end(),
+                 current_cons.begin(), current_cons.end(),
+                 inserter(to_connect, to_connect.end()));
+
+    // Establish missing connections
+  for (LogicConSet::iterator it = to_connect.begin();
+       it != to_connect.end();
+       ++it)
+  {
+    const string &src_name = it->first;
+    const string &sink_name = it->second;
+
+      // Both logics must be registered for the connection to be possible
+    SinkMap::iterator sink_it = sinks.find(sink_name);
+    if ((sink_it == sinks.end()) || (sources.find(src_name) == sources.end()))
+    {
+      continue;
+    }
+
+    //cout << "### " << src_name << " ===> " << sink_name << endl;
+    SinkInfo &sink = sink_it->second;
+    sink.selector->enableAutoSelect(sink.connectors[src_name], 0);
+    if (AudioLatencyProbe::isEnabled())
+    {
+      AudioLatencyProbe::linkTraces(src_name, sink_name);
+    }
+
+      // Store all connections in "current_cons" (current connections)
+    current_cons.insert(*it);
+  }
+} /* LinkManager::establishWantedConnections */
+
+
 #if 0
 bool LinkManager::isConnected(const string& source_name,
       	                      const string& sink_name)
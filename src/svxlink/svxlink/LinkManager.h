@@ -54,6 +54,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncTimer.h>
 #include <AsyncAudioSelector.h>
 #include <AsyncAudioSplitter.h>
+#include <AsyncMetrics.h>
 
 
 /****************************************************************************
@@ -204,6 +205,11 @@ class LinkManager : public sigc::trackable
     /**
      * @brief Delete a logic core from the link manager
      * @param logic The logic to delete
+     *
+     * The logic linking commands associated with the logic will also be
+     * removed. If the logic is added again later, e.g. after a
+     * configuration reload, the connections for all active links will be
+     * restored.
      */
     void deleteLogic(LogicBase *logic);
 
@@ -240,9 +246,14 @@ class LinkManager : public sigc::trackable
     {
       Link(void)
         : timeout(0), default_active(false), is_activated(false),
-          timeout_timer(0)
+          timeout_timer(0), active_gauge(0), activation_cnt(0)
       {}
-      ~Link(void) { delete timeout_timer; }
+      ~Link(void)
+      {
+        delete timeout_timer;
+        Async::Metrics::remove(active_gauge);
+        Async::Metrics::remove(activation_cnt);
+      }
 
       std::string  name;
       LogicPropMap logic_props;
@@ -251,6 +262,8 @@ class LinkManager : public sigc::trackable
       bool         default_active;
       bool         is_activated;
       Async::Timer *timeout_timer;
+      Async::MetricGauge   *active_gauge;
+      Async::MetricCounter *activation_cnt;
     };
     typedef std::map<std::string, Link> LinkMap;
     typedef std::set<std::pair<std::string, std::string> > LogicConSet;
@@ -270,8 +283,9 @@ class LinkManager : public sigc::trackable
     typedef std::map<std::string, SinkInfo>   SinkMap;
     struct LogicInfo
     {
-      LogicBase         *logic;
-      sigc::connection  idle_state_changed_con;
+      LogicBase           *logic;
+      sigc::connection    idle_state_changed_con;
+      std::list<Command*> link_cmds;
     };
     typedef std::map<std::string, LogicInfo> LogicMap;
 
@@ -292,6 +306,7 @@ class LinkManager : public sigc::trackable
     void wantedConnections(LogicConSet &want);
     void activateLink(Link &link);
     void deactivateLink(Link &link);
+    void establishWantedConnections(void);
     /*
     bool isConnected(const std::string& source_name,
                      const std::string& sink_name);
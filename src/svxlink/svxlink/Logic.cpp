@@ -73,6 +73,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncAudioPacer.h>
 #include <AsyncAudioDebugger.h>
 #include <AsyncAudioRecorder.h>
+#include <AsyncAudioProfiler.h>
+#include <AsyncAudioLatencyProbe.h>
+#include <AsyncMetrics.h>
 #include <common.h>
 #include <config.h>
 
@@ -172,10 +175,20 @@ Logic::Logic(Config &cfg, const string& name)
     dtmf_digit_handler(0),                  state_pty(0),
     dtmf_ctrl_pty(0)
 {
+  string label(Metrics::label("logic", name));
+  sql_open_cnt = Metrics::counter("svxlink_logic_squelch_opens_total",
+      "Number of times the receiver squelch has opened", label);
+  tx_cnt = Metrics::counter("svxlink_logic_tx_starts_total",
+      "Number of times the transmitter has been keyed", label);
+  tx_gauge = Metrics::gauge("svxlink_logic_transmitting",
+      "1 if the transmitter is keyed, otherwise 0", label);
+
   rgr_sound_timer.expired.connect(sigc::hide(
         mem_fun(*this, &Logic::sendRgrSound)));
   logic_con_in = new AudioSplitter;
   logic_con_out = new AudioSelector;
+  AudioProfiler::setName(logic_con_in, name + " logic_con_in");
+  AudioProfiler::setName(logic_con_out, name + " logic_con_out");
 } /* Logic::Logic */
 
 
@@ -185,6 +198,9 @@ Logic::~Logic(void)
   delete logic_con_out;
   delete logic_con_in;
   delete dtmf_digit_handler;
+  Metrics::remove(sql_open_cnt);
+  Metrics::remove(tx_cnt);
+  Metrics::remove(tx_gauge);
 } /* Logic::~Logic */
 
 
@@ -384,24 +400,24 @@ bool Logic::initialize(void)
   AudioSource *prev_rx_src = 0;
 
     // Create the RX object
-  cout << "Loading RX: " << rx_name << endl;
-  m_rx = RxFactory::createNamedRx(cfg(), rx_name);
-  if ((m_rx == 0) || !rx().initialize())
+  if (!loadRx(rx_name))
   {
-    delete m_rx;
-    m_rx = 0;
-    cerr << "*** ERROR: Could not initialize RX \"" << rx_name << "\"\n";
     cleanup();
     return false;
   }
-  rx().squelchOpen.connect(mem_fun(*this, &Logic::squelchOpen));
-  rx().dtmfDigitDetected.connect(mem_fun(*this, &Logic::dtmfDigitDetectedP));
-  rx().selcallSequenceDetected.connect(
-	mem_fun(*this, &Logic::selcallSequenceDetected));
-  rx().setMuteState(Rx::MUTE_NONE);
-  rx().publishStateEvent.connect(mem_fun(*this, &Logic::publishStateEvent));
   prev_rx_src = m_rx;
 
+    // Measure the latency from the receiver(s) into the logic core
+  if (AudioLatencyProbe::isEnabled())
+  {
+    AudioLatencyProbe::linkTraces(rx_name, name());
+    AudioLatencyProbe::linkTraces(name(), tx_name);
+    AudioLatencyProbe *probe = new AudioLatencyProbe(
+        AudioLatencyProbe::MEASURE, name(), name() + " RX");
+    prev_rx_src->registerSink(probe, true);
+    prev_rx_src = probe;
+  }
+
     // This valve is used to turn RX audio on/off into the logic core
   rx_valve = new AudioValve;
   rx_valve->setOpen(false);
@@ -446,6 +462,7 @@ bool Logic::initialize(void)
 
     // This selector is used to select audio source for TX audio
   tx_audio_selector = new AudioSelector;
+  AudioProfiler::setName(tx_audio_selector, name() + " TX selector");
   AudioSource *prev_tx_src = tx_audio_selector;
 
     // Connect the direct RX to TX audio valve to the TX audio selector
@@ -539,24 +556,26 @@ bool Logic::initialize(void)
   prev_tx_src->registerSink(tx_fifo, true);
   prev_tx_src = tx_fifo;
 
+    // Measure the latency up to the point where announcements are mixed in
+  if (AudioLatencyProbe::isEnabled())
+  {
+    AudioLatencyProbe *probe = new AudioLatencyProbe(
+        AudioLatencyProbe::MEASURE, name(), name() + " TX");
+    prev_tx_src->registerSink(probe, true);
+    prev_tx_src = probe;
+  }
+
     // Create the TX audio mixer
   tx_audio_mixer = new AudioMixer;
   tx_audio_mixer->addSource(prev_tx_src);
   prev_tx_src = tx_audio_mixer;
 
     // Create the TX object
-  cout << "Loading TX: " << tx_name << endl;
-  m_tx = TxFactory::createNamedTx(cfg(), tx_name);
-  if ((m_tx == 0) || !tx().initialize())
+  if (!loadTx(tx_name))
   {
-    delete m_tx;
-    m_tx = 0;
-    cerr << "*** ERROR: Could not initialize TX \"" << tx_name << "\"\n";
     cleanup();
     return false;
   }
-  tx().transmitterStateChange.connect(
-      mem_fun(*this, &Logic::transmitterStateChange));
   prev_tx_src->registerSink(m_tx, true);
   prev_tx_src = 0;
 
@@ -613,6 +632,15 @@ bool Logic::initialize(void)
     }
     loaded_modules += (*mit)->name();
   }
+  LazyModuleMap::const_iterator lit;
+  for (lit=lazy_modules.begin(); lit!=lazy_modules.end(); ++lit)
+  {
+    if (!loaded_modules.empty())
+    {
+      loaded_modules += " ";
+    }
+    loaded_modules += lit->second.name;
+  }
   event_handler->setVariable("loaded_modules", loaded_modules);
 
   event_handler->processEvent("namespace eval Logic {}");
@@ -803,6 +831,92 @@ void Logic::deactivateModule(Module *module)
 } /* Logic::deactivateModule */
 
 
+void Logic::reloadModule(const string& module_cfg_name)
+{
+  LazyModuleMap::iterator lit;
+  for (lit=lazy_modules.begin(); lit!=lazy_modules.end(); ++lit)
+  {
+    if (lit->second.cfg_name == module_cfg_name)
+    {
+      delete lit->second.cmd;
+      lazy_modules.erase(lit);
+      break;
+    }
+  }
+
+  list<Module *>::iterator it;
+  for (it=modules.begin(); it!=modules.end(); ++it)
+  {
+    if ((*it)->cfgName() == module_cfg_name)
+    {
+      cout << "Unloading module \"" << module_cfg_name << "\" from logic \""
+           << name() << "\"\n";
+      unloadModule(*it);
+      break;
+    }
+  }
+  loadModule(module_cfg_name);
+} /* Logic::reloadModule */
+
+
+bool Logic::reloadRx(void)
+{
+  string rx_name;
+  cfg().getValue(name(), "RX", rx_name);
+  cout << "Reloading RX \"" << rx_name << "\" in logic \"" << name()
+       << "\"\n";
+
+    // Resetting the receiver will close the squelch so that the logic core
+    // see a consistent squelch state
+  rx().reset();
+  AudioSink *rx_sink = m_rx->sink();
+  m_rx->unregisterSink();
+  delete m_rx;
+  m_rx = 0;
+
+  bool success = loadRx(rx_name);
+  if (!success)
+  {
+    cerr << "*** WARNING: Using a dummy receiver in logic \"" << name()
+         << "\"\n";
+    loadRx("NONE");
+  }
+  m_rx->registerSink(rx_sink, true);
+  rxReplaced();
+
+  return success;
+
+} /* Logic::reloadRx */
+
+
+bool Logic::reloadTx(void)
+{
+  string tx_name;
+  cfg().getValue(name(), "TX", tx_name);
+  cout << "Reloading TX \"" << tx_name << "\" in logic \"" << name()
+       << "\"\n";
+
+  tx().setTxCtrlMode(Tx::TX_OFF);
+  tx_audio_mixer->unregisterSink();
+  delete m_tx;
+  m_tx = 0;
+
+  bool success = loadTx(tx_name);
+  if (!success)
+  {
+    cerr << "*** WARNING: Using a dummy transmitter in logic \"" << name()
+         << "\"\n";
+    loadTx("NONE");
+  }
+  tx_audio_mixer->registerSink(m_tx, true);
+  tx().enableCtcss((tx_ctcss & tx_ctcss_mask) != 0);
+  tx().setTxCtrlMode(is_online ? currently_set_tx_ctrl_mode : Tx::TX_OFF);
+
+  return success;
+
+} /* Logic::reloadTx */
+
+
 Module *Logic::findModule(int id)
 {
   list<Module *>::iterator it;
@@ -814,6 +928,12 @@ Module *Logic::findModule(int id)
     }
   }
 
+  LazyModuleMap::iterator lit = lazy_modules.find(id);
+  if (lit != lazy_modules.end())
+  {
+    return loadLazyModule(lit);
+  }
+
   return 0;
 
 } /* Logic::findModule */
@@ -830,11 +950,51 @@ Module *Logic::findModule(const string& name)
     }
   }
 
+  LazyModuleMap::iterator lit;
+  for (lit=lazy_modules.begin(); lit!=lazy_modules.end(); ++lit)
+  {
+    if (lit->second.name == name)
+    {
+      return loadLazyModule(lit);
+    }
+  }
+
   return 0;
 
 } /* Logic::findModule */
 
 
+list<Module*> Logic::moduleList(void)
+{
+  LazyModuleMap::iterator it = lazy_modules.begin();
+  while (it != lazy_modules.end())
+  {
+    LazyModuleMap::iterator next = it;
+    ++next;
+    loadLazyModule(it);
+    it = next;
+  }
+  return modules;
+} /* Logic::moduleList */
+
+
+map<int, string> Logic::moduleNames(void) const
+{
+  map<int, string> names;
+  list<Module*>::const_iterator it;
+  for (it=modules.begin(); it!=modules.end(); ++it)
+  {
+    names[(*it)->id()] = (*it)->name();
+  }
+  LazyModuleMap::const_iterator lit;
+  for (lit=lazy_modules.begin(); lit!=lazy_modules.end(); ++lit)
+  {
+    names[lit->first] = lit->second.name;
+  }
+  return names;
+} /* Logic::moduleNames */
+
+
 void Logic::dtmfDigitDetected(char digit, int duration)
 {
   if (active_module != 0)
@@ -930,6 +1090,11 @@ void Logic::squelchOpen(bool is_open)
     active_module->squelchOpen(is_open);
   }
 
+  if (is_open)
+  {
+    sql_open_cnt->inc();
+  }
+
   stringstream ss;
   ss << "squelch_open " << rx().sqlRxId() << " " << (is_open ? "1" : "0");
   processEvent(ss.str());
@@ -989,6 +1154,12 @@ void Logic::transmitterStateChange(bool is_transmitting)
     LocationInfo::instance()->setTransmitting(name(), tv, is_transmitting);
   }
 
+  if (is_transmitting)
+  {
+    tx_cnt->inc();
+  }
+  tx_gauge->set(is_transmitting ? 1 : 0);
+
   stringstream ss;
   ss << "transmit " << (is_transmitting ? "1" : "0");
   processEvent(ss.str());
@@ -1147,6 +1318,56 @@ void Logic::loadModule(const string& module_cfg_name)
   cout << "Loading module \"" << module_cfg_name << "\" into logic \""
        << name() << "\"\n";
 
+  bool lazy_load = false;
+  cfg().getValue(module_cfg_name, "LAZY_LOAD", lazy_load);
+  if (lazy_load)
+  {
+    if (addLazyModule(module_cfg_name))
+    {
+      cout << "\tLoading deferred until the module is first used\n";
+    }
+    return;
+  }
+
+  struct timeval start;
+  gettimeofday(&start, NULL);
+
+  Module *module = createModule(module_cfg_name);
+  if (module == 0)
+  {
+    return;
+  }
+
+  stringstream ss;
+  ss << module->id();
+  ModuleActivateCmd *cmd = new ModuleActivateCmd(&cmd_parser, ss.str(), this);
+  if (!cmd->addToParser())
+  {
+    cerr << "\n*** ERROR: Failed to add module activation command for module \""
+	 << module_cfg_name << "\" in logic \"" << name() << "\". "
+         << "This is probably due to having set up two modules with the same "
+         << "module id or choosing a module id that is the same as another "
+         << "command.\n\n";
+    delete cmd;
+    void *handle = module->pluginHandle();
+    delete module;
+    dlclose(handle);
+    return;
+  }
+
+  addModule(module, cmd);
+
+  struct timeval now, diff;
+  gettimeofday(&now, NULL);
+  timersub(&now, &start, &diff);
+  cout << "\tModule loaded in "
+       << (diff.tv_sec * 1000 + diff.tv_usec / 1000) << "ms\n";
+
+} /* Logic::loadModule */
+
+
+Module *Logic::createModule(const string& module_cfg_name)
+{
   string module_path;
   cfg().getValue("GLOBAL", "MODULE_PATH", module_path);
 
@@ -1169,7 +1390,7 @@ void Logic::loadModule(const string& module_cfg_name)
       cerr << "*** ERROR: Failed to load module "
         << module_cfg_name.c_str() << " into logic " << name() << ": "
         << dlerror() << endl;
-      return;
+      return 0;
     }
   }
   else
@@ -1185,7 +1406,7 @@ void Logic::loadModule(const string& module_cfg_name)
         cerr << "*** ERROR: Failed to load module "
           << module_cfg_name.c_str() << " into logic " << name() << ": "
           << dlerror() << endl;
-        return;
+        return 0;
       }
     }
   }
@@ -1197,7 +1418,7 @@ void Logic::loadModule(const string& module_cfg_name)
       	 << module_cfg_name.c_str() << " in logic " << name() << ": "
          << dlerror() << endl;
     dlclose(handle);
-    return;
+    return 0;
   }
   cout << "\tFound " << link_map->l_name << endl;
 
@@ -1208,7 +1429,7 @@ void Logic::loadModule(const string& module_cfg_name)
       	 << module_cfg_name.c_str() << " in logic " << name() << ": "
          << dlerror() << endl;
     dlclose(handle);
-    return;
+    return 0;
   }
 
   Module *module = init(handle, this, module_cfg_name.c_str());
@@ -1217,7 +1438,7 @@ void Logic::loadModule(const string& module_cfg_name)
     cerr << "*** ERROR: Creation failed for module "
       	 << module_cfg_name.c_str() << " in logic " << name() << endl;
     dlclose(handle);
-    return;
+    return 0;
   }
 
   if (!module->initialize())
@@ -1226,36 +1447,129 @@ void Logic::loadModule(const string& module_cfg_name)
       	 << module_cfg_name.c_str() << " in logic " << name() << endl;
     delete module;
     dlclose(handle);
-    return;
+    return 0;
+  }
+
+  return module;
+
+} /* Logic::createModule */
+
+
+void Logic::addModule(Module *module, Command *cmd)
+{
+    // Connect module audio output to the module audio selector
+  audio_from_module_selector->addSource(module);
+  audio_from_module_selector->enableAutoSelect(module, 0);
+
+    // Connect module audio input to the module audio splitter
+  audio_to_module_splitter->addSink(module);
+  audio_to_module_splitter->enableSink(module, false);
+
+  modules.push_back(module);
+  module_cmds[module] = cmd;
+} /* Logic::addModule */
+
+
+bool Logic::addLazyModule(const string& module_cfg_name)
+{
+  int id;
+  if (!cfg().getValue(module_cfg_name, "ID", id))
+  {
+    cerr << "*** ERROR: Config variable " << module_cfg_name
+      	 << "/ID not set\n";
+    return false;
   }
 
+  LazyModule lazy_module;
+  lazy_module.cfg_name = module_cfg_name;
+  lazy_module.name = module_cfg_name;
+  cfg().getValue(module_cfg_name, "NAME", lazy_module.name);
+
   stringstream ss;
-  ss << module->id();
-  ModuleActivateCmd *cmd = new ModuleActivateCmd(&cmd_parser, ss.str(), this);
-  if (!cmd->addToParser())
+  ss << id;
+  lazy_module.cmd = new ModuleActivateCmd(&cmd_parser, ss.str(), this);
+  if (!lazy_module.cmd->addToParser())
   {
     cerr << "\n*** ERROR: Failed to add module activation command for module \""
 	 << module_cfg_name << "\" in logic \"" << name() << "\". "
          << "This is probably due to having set up two modules with the same "
          << "module id or choosing a module id that is the same as another "
          << "command.\n\n";
-    delete cmd;
-    delete module;
-    dlclose(handle);
-    return;
+    delete lazy_module.cmd;
+    return false;
   }
 
-    // Connect module audio output to the module audio selector
-  audio_from_module_selector->addSource(module);
-  audio_from_module_selector->enableAutoSelect(module, 0);
+    // Set up the module configuration variables in the event handler so
+    // that the module TCL code is loaded even though the module itself
+    // is not loaded yet.
+  event_handler->processEvent("namespace eval " + lazy_module.name + " {}");
+  list<string> vars = cfg().listSection(module_cfg_name);
+  list<string>::const_iterator cfgit;
+  for (cfgit=vars.begin(); cfgit!=vars.end(); ++cfgit)
+  {
+    string value;
+    cfg().getValue(module_cfg_name, *cfgit, value);
+    event_handler->setVariable(lazy_module.name + "::CFG_" + *cfgit, value);
+  }
 
-    // Connect module audio input to the module audio splitter
-  audio_to_module_splitter->addSink(module);
-  audio_to_module_splitter->enableSink(module, false);
+  lazy_modules[id] = lazy_module;
 
-  modules.push_back(module);
+  return true;
 
-} /* Logic::loadModule */
+} /* Logic::addLazyModule */
+
+
+Module *Logic::loadLazyModule(LazyModuleMap::iterator it)
+{
+  LazyModule lazy_module = it->second;
+
+  cout << name() << ": Loading module \"" << lazy_module.cfg_name
+       << "\" on first use\n";
+
+  struct timeval start;
+  gettimeofday(&start, NULL);
+
+  Module *module = createModule(lazy_module.cfg_name);
+  if (module == 0)
+  {
+    return 0;
+  }
+  lazy_modules.erase(it);
+  addModule(module, lazy_module.cmd);
+
+  struct timeval now, diff;
+  gettimeofday(&now, NULL);
+  timersub(&now, &start, &diff);
+  cout << "\tModule loaded in "
+       << (diff.tv_sec * 1000 + diff.tv_usec / 1000) << "ms\n";
+
+  return module;
+
+} /* Logic::loadLazyModule */
+
+
+void Logic::unloadModule(Module *module)
+{
+  if (module == active_module)
+  {
+    deactivateModule(module);
+  }
+
+  map<Module*, Command*>::iterator cmd_it = module_cmds.find(module);
+  if (cmd_it != module_cmds.end())
+  {
+    delete cmd_it->second;
+    module_cmds.erase(cmd_it);
+  }
+
+  audio_from_module_selector->removeSource(module);
+  audio_to_module_splitter->removeSink(module);
+  modules.remove(module);
+
+  void *plugin_handle = module->pluginHandle();
+  delete module;
+  dlclose(plugin_handle);
+} /* Logic::unloadModule */
 
 
 void Logic::unloadModules(void)
@@ -1268,9 +1582,61 @@ void Logic::unloadModules(void)
     dlclose(plugin_handle);
   }
   modules.clear();
+
+  map<Module*, Command*>::iterator cmd_it;
+  for (cmd_it=module_cmds.begin(); cmd_it!=module_cmds.end(); ++cmd_it)
+  {
+    delete cmd_it->second;
+  }
+  module_cmds.clear();
+
+  LazyModuleMap::iterator lit;
+  for (lit=lazy_modules.begin(); lit!=lazy_modules.end(); ++lit)
+  {
+    delete lit->second.cmd;
+  }
+  lazy_modules.clear();
 } /* logic::unloadModules */
 
 
+bool Logic::loadRx(const string& rx_name)
+{
+  cout << "Loading RX: " << rx_name << endl;
+  m_rx = RxFactory::createNamedRx(cfg(), rx_name);
+  if ((m_rx == 0) || !rx().initialize())
+  {
+    delete m_rx;
+    m_rx = 0;
+    cerr << "*** ERROR: Could not initialize RX \"" << rx_name << "\"\n";
+    return false;
+  }
+  rx().squelchOpen.connect(mem_fun(*this, &Logic::squelchOpen));
+  rx().dtmfDigitDetected.connect(mem_fun(*this, &Logic::dtmfDigitDetectedP));
+  rx().selcallSequenceDetected.connect(
+	mem_fun(*this, &Logic::selcallSequenceDetected));
+  rx().setMuteState(Rx::MUTE_NONE);
+  rx().publishStateEvent.connect(mem_fun(*this, &Logic::publishStateEvent));
+  return true;
+} /* Logic::loadRx */
+
+
+bool Logic::loadTx(const string& tx_name)
+{
+  cout << "Loading TX: " << tx_name << endl;
+  m_tx = TxFactory::createNamedTx(cfg(), tx_name);
+  if ((m_tx == 0) || !tx().initialize())
+  {
+    delete m_tx;
+    m_tx = 0;
+    cerr << "*** ERROR: Could not initialize TX \"" << tx_name << "\"\n";
+    return false;
+  }
+  tx().transmitterStateChange.connect(
+      mem_fun(*this, &Logic::transmitterStateChange));
+  return true;
+} /* Logic::loadTx */
+
+
 void Logic::processCommandQueue(void)
 {
   if (rx().squelchIsOpen() || cmd_queue.empty())
@@ -90,6 +90,8 @@ namespace Async
   class AudioSource;
   class AudioSink;
   class Pty;
+  class MetricCounter;
+  class MetricGauge;
 };
 
 
@@ -180,9 +182,79 @@ class Logic : public LogicBase
     virtual bool activateModule(Module *module);
     virtual void deactivateModule(Module *module);
     Module *activeModule(void) const { return active_module; }
+
+    /**
+     * @brief   Find a module using its module id
+     * @param   id The module id to look for
+     * @return  Returns the module or 0 if not found
+     *
+     * If the module is configured to be loaded lazily and it have not been
+     * loaded yet, it will be loaded by this function.
+     */
     Module *findModule(int id);
+
+    /**
+     * @brief   Find a module using its name
+     * @param   name The name of the module to look for
+     * @return  Returns the module or 0 if not found
+     *
+     * If the module is configured to be loaded lazily and it have not been
+     * loaded yet, it will be loaded by this function.
+     */
     Module *findModule(const std::string& name);
-    std::list<Module*> moduleList(void) const { return modules; }
+
+    /**
+     * @brief   Get a list of all modules in this logic core
+     * @return  Returns a list of all modules
+     *
+     * Calling this function will load all modules that are configured to be
+     * loaded lazily but that have not been loaded yet.
+     */
+    std::list<Module*> moduleList(void);
+
+    /**
+     * @brief   Get the id and name of all modules in this logic core
+     * @return  Returns a map from module id to module name
+     *
+     * Unlike moduleList, this function will not load modules that are
+     * configured to be loaded lazily.
+     */
+    std::map<int, std::string> moduleNames(void) const;
+
+    /**
+     * @brief   Unload and then load a module again
+     * @param   module_cfg_name The name of the module configuration section
+     *
+     * This function is used to apply configuration changes to a single
+     * module without affecting the rest of the logic core. If the module
+     * is active it will first be deactivated. If the module was not loaded
+     * before, it will just be loaded.
+     */
+    void reloadModule(const std::string& module_cfg_name);
+
+    /**
+     * @brief   Replace the receiver with a new one
+     * @return  Returns \em true on success or \em false on failure
+     *
+     * This function is used to apply configuration changes to the receiver
+     * without affecting the rest of the logic core. The old receiver is
+     * deleted before the new one is created since they may use the same
+     * hardware. If the new receiver could not be initialized, a dummy
+     * receiver is used instead so that the logic core can keep running.
+     */
+    bool reloadRx(void);
+
+    /**
+     * @brief   Replace the transmitter with a new one
+     * @return  Returns \em true on success or \em false on failure
+     *
+     * This function is used to apply configuration changes to the
+     * transmitter without affecting the rest of the logic core. The
+     * transmitter control mode and CTCSS state are restored on the new
+     * transmitter. If it could not be initialized, a dummy transmitter is
+     * used instead.
+     */
+    bool reloadTx(void);
 
     const std::string& callsign(void) const { return m_callsign; }
 
@@ -216,6 +288,14 @@ class Logic : public LogicBase
     virtual void selcallSequenceDetected(std::string sequence);
     virtual void dtmfCtrlPtyCmdReceived(const void *buf, size_t count);
 
+    /**
+     * @brief   Called when the receiver has been replaced by reloadRx
+     *
+     * Logic cores that have set up the receiver in some special way, like
+     * adding tone detectors, should do so again for the new receiver.
+     */
+    virtual void rxReplaced(void) {}
+
     void clearPendingSamples(void);
     void enableRgrSoundTimer(bool enable);
     void rxValveSetOpen(bool do_open);
@@ -237,11 +317,21 @@ class Logic : public LogicBase
       time_t last_tx_sec;
     };
 
+    struct LazyModule
+    {
+      std::string cfg_name;
+      std::string name;
+      Command     *cmd;
+    };
+    typedef std::map<int, LazyModule> LazyModuleMap;
+
     Rx	      	      	      	    *m_rx;
     Tx	      	      	      	    *m_tx;
     MsgHandler	      	      	    *msg_handler;
     Module    	      	      	    *active_module;
     std::list<Module*>	      	    modules;
+    std::map<Module*, Command*>     module_cmds;
+    LazyModuleMap                   lazy_modules;
     std::string       	      	    m_callsign;
     std::list<std::string>    	    cmd_queue;
     Async::Timer      	      	    exec_cmd_on_sql_close_timer;
@@ -281,10 +371,20 @@ class Logic : public LogicBase
     DtmfDigitHandler                *dtmf_digit_handler;
     Async::Pty                      *state_pty;
     Async::Pty                      *dtmf_ctrl_pty;
+    Async::MetricCounter            *sql_open_cnt;
+    Async::MetricCounter            *tx_cnt;
+    Async::MetricGauge              *tx_gauge;
 
     void loadModules(void);
     void loadModule(const std::string& module_name);
+    Module *createModule(const std::string& module_cfg_name);
+    void addModule(Module *module, Command *cmd);
+    bool addLazyModule(const std::string& module_cfg_name);
+    Module *loadLazyModule(LazyModuleMap::iterator it);
+    void unloadModule(Module *module);
     void unloadModules(void);
+    bool loadRx(const std::string& rx_name);
+    bool loadTx(const std::string& tx_name);
     void processCommandQueue(void);
     void processCommand(const std::string &cmd, bool force_core_cmd=false);
     void processMacroCmd(const std::string &macro_cmd);
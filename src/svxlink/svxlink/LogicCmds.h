@@ -141,8 +141,13 @@ class ModuleActivateCmd : public Command
       //std::cout << "cmd=" << cmdStr() << " subcmd=" << subcmd << std::endl;
       int module_id = atoi(cmdStr().c_str());
       Module *module = logic->findModule(module_id);
-      assert(module != 0);
-      if (!subcmd.empty())
+      if (module == 0)
+      {
+        std::stringstream ss;
+        ss << "command_failed " << cmdStr() << subcmd;
+        logic->processEvent(ss.str());
+      }
+      else if (!subcmd.empty())
       {
 	module->dtmfCmdReceivedWhenIdle(subcmd);
       }
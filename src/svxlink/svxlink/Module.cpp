@@ -243,6 +243,12 @@ list<Module*> Module::moduleList(void)
 } /* Module::moduleList */
 
 
+map<int, string> Module::moduleNames(void) const
+{
+  return logic()->moduleNames();
+} /* Module::moduleNames */
+
+
 void Module::setIdle(bool is_idle)
 {
   if (m_tmo_timer != 0)
@@ -43,6 +43,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <string>
 #include <list>
+#include <map>
 
 
 /****************************************************************************
@@ -450,6 +451,16 @@ class Module : public sigc::trackable, public Async::AudioSink,
      * loaded into the same logic core as this module.
      */
     std::list<Module*> moduleList(void);
+
+    /**
+     * @brief 	Retrieve the id and name of all modules
+     * @return	Returns a map from module id to module name
+     *
+     * A module can use this function to list the other modules in the same
+     * logic core without loading modules that are configured to be loaded
+     * lazily.
+     */
+    std::map<int, std::string> moduleNames(void) const;
     
     /**
      * @brief 	Tell the logic core if the module is idle or not
@@ -61,6 +61,7 @@ extern "C" {
  *
  ****************************************************************************/
 
+#include <AsyncAudioSampleConv.h>
 
 
 /****************************************************************************
@@ -584,7 +585,7 @@ bool RawFileQueueItem::initialize(void)
 
 int RawFileQueueItem::readSamples(float *samples, int len)
 {
-  short buf[len];
+  int16_t buf[len];
   assert(file != -1);
   int read_cnt = read(file, buf, len * sizeof(*buf));
   if (read_cnt == -1)
@@ -595,10 +596,7 @@ int RawFileQueueItem::readSamples(float *samples, int len)
   else
   {
     read_cnt /= sizeof(*buf);
-    for (int i=0; i<read_cnt; ++i)
-    {
-      samples[i] = static_cast<float>(buf[i]) / 32768.0;
-    }
+    Async::AudioSampleConv::s16ToFloat(samples, buf, read_cnt);
   }
   
   return read_cnt;
@@ -690,10 +688,9 @@ int GsmFileQueueItem::readSamples(float *samples, int len)
     }
   }
   
-  while ((read_cnt < len) && (buf_pos < BUFSIZE))
-  {
-    samples[read_cnt++] = static_cast<float>(buf[buf_pos++]) / 32768.0;
-  }
+  read_cnt = min(len, BUFSIZE - buf_pos);
+  Async::AudioSampleConv::s16ToFloat(samples, buf + buf_pos, read_cnt);
+  buf_pos += read_cnt;
   
   //cout << "GsmFileQueueItem::readSamples: " << read_cnt << endl;
   
@@ -939,7 +936,7 @@ bool WavFileQueueItem::initialize(void)
 
 int WavFileQueueItem::readSamples(float *samples, int len)
 {
-  short buf[len];
+  int16_t buf[len];
   assert(file.is_open());
   streamsize to_read = min(static_cast<uint32_t>(len * sizeof(*buf)),
                            subchunk2size - data_read);
@@ -959,10 +956,7 @@ int WavFileQueueItem::readSamples(float *samples, int len)
   int read_cnt = file.gcount();
   data_read += read_cnt;
   read_cnt /= sizeof(*buf);
-  for (int i=0; i<read_cnt; ++i)
-  {
-    samples[i] = static_cast<float>(buf[i]) / 32768.0;
-  }
+  Async::AudioSampleConv::s16ToFloat(samples, buf, read_cnt);
   
   return read_cnt;
 } /* WavFileQueueItem::readSamples */
@@ -35,6 +35,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <iomanip>
 #include <algorithm>
 #include <iterator>
+#include <ctime>
 
 
 /****************************************************************************
@@ -46,6 +47,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncTcpClient.h>
 #include <AsyncUdpSocket.h>
 #include <AsyncAudioPassthrough.h>
+#include <AsyncAudioLatencyProbe.h>
+#include <AsyncMetrics.h>
 
 
 /****************************************************************************
@@ -122,10 +125,15 @@ ReflectorLogic::ReflectorLogic(Async::Config& cfg, const std::string& name)
     m_reconnect_timer(20000, Timer::TYPE_ONESHOT, false),
     m_next_udp_tx_seq(0), m_next_udp_rx_seq(0),
     m_heartbeat_timer(1000, Timer::TYPE_PERIODIC, false), m_dec(0),
+    m_jitter_fifo(0),
     m_flush_timeout_timer(3000, Timer::TYPE_ONESHOT, false),
     m_udp_heartbeat_tx_cnt(0), m_udp_heartbeat_rx_cnt(0),
     m_tcp_heartbeat_tx_cnt(0), m_tcp_heartbeat_rx_cnt(0),
-    m_con_state(STATE_DISCONNECTED), m_enc(0)
+    m_con_state(STATE_DISCONNECTED), m_enc(0),
+    m_proto_ver_major(MsgProtoVer::MAJOR),
+    m_proto_ver_minor(MsgProtoVer::MINOR),
+    m_reconnect_interval(RECONNECT_MIN_INTERVAL), m_session_token_expires(0),
+    m_resuming(false)
 {
   m_reconnect_timer.expired.connect(
       sigc::hide(mem_fun(*this, &ReflectorLogic::reconnect)));
@@ -134,11 +142,34 @@ ReflectorLogic::ReflectorLogic(Async::Config& cfg, const std::string& name)
   m_flush_timeout_timer.expired.connect(
       mem_fun(*this, &ReflectorLogic::flushTimeout));
   timerclear(&m_last_talker_timestamp);
+
+  string label(Metrics::label("logic", name));
+  m_connected_gauge = Metrics::gauge("svxlink_reflector_connected",
+      "1 if logged in to the reflector, otherwise 0", label);
+  m_talker_cnt = Metrics::counter("svxlink_reflector_talker_starts_total",
+      "Number of times a node has started talking on the reflector", label);
+  m_udp_rx_cnt = Metrics::counter("svxlink_reflector_udp_rx_packets_total",
+      "UDP packets received from the reflector", label);
+  m_udp_tx_cnt = Metrics::counter("svxlink_reflector_udp_tx_packets_total",
+      "UDP packets sent to the reflector", label);
+  m_udp_lost_cnt = Metrics::counter(
+      "svxlink_reflector_udp_lost_frames_total",
+      "UDP frames lost on the way from the reflector", label);
+  m_jitter_fifo_gauge = Metrics::gauge(
+      "svxlink_reflector_jitter_fifo_samples",
+      "Number of samples in the reflector audio jitter buffer", label);
+  m_rtt_gauge = Metrics::gauge("svxlink_reflector_rtt_seconds",
+      "TCP round trip time to the reflector as estimated by the kernel",
+      label);
 } /* ReflectorLogic::ReflectorLogic */
 
 
 ReflectorLogic::~ReflectorLogic(void)
 {
+  if (LinkManager::hasInstance())
+  {
+    LinkManager::instance()->deleteLogic(this);
+  }
   delete m_udp_sock;
   m_udp_sock = 0;
   delete m_logic_con_in;
@@ -149,6 +180,13 @@ ReflectorLogic::~ReflectorLogic(void)
   m_dec = 0;
   delete m_con;
   m_con = 0;
+  Metrics::remove(m_connected_gauge);
+  Metrics::remove(m_talker_cnt);
+  Metrics::remove(m_udp_rx_cnt);
+  Metrics::remove(m_udp_tx_cnt);
+  Metrics::remove(m_udp_lost_cnt);
+  Metrics::remove(m_jitter_fifo_gauge);
+  Metrics::remove(m_rtt_gauge);
 } /* ReflectorLogic::~ReflectorLogic */
 
 
@@ -183,31 +221,38 @@ bool ReflectorLogic::initialize(void)
     return false;
   }
 
-#if 0
-  string audio_codec("GSM");
-  if (AudioDecoder::isAvailable("OPUS") && AudioEncoder::isAvailable("OPUS"))
+  cfg().getValue(name(), "AUDIO_CODEC", m_preferred_codec);
+
+    // Create logic connection incoming audio passthrough. When latency
+    // tracing is enabled, measure the latency up to the audio encoder.
+  if (AudioLatencyProbe::isEnabled())
   {
-    audio_codec = "OPUS";
+    m_logic_con_in = new AudioLatencyProbe(AudioLatencyProbe::MEASURE,
+                                           name(), name() + " encoder");
   }
-  else if (AudioDecoder::isAvailable("SPEEX") &&
-           AudioEncoder::isAvailable("SPEEX"))
+  else
   {
-    audio_codec = "SPEEX";
+    m_logic_con_in = new Async::AudioPassthrough;
   }
-  cfg().getValue(name(), "AUDIO_CODEC", audio_codec);
-#endif
-
-    // Create logic connection incoming audio passthrough
-  m_logic_con_in = new Async::AudioPassthrough;
 
     // Create dummy audio codec used before setting the real encoder
   if (!setAudioCodec("DUMMY")) { return false; }
   AudioSource *prev_src = m_dec;
 
-    // Create jitter FIFO if jitter buffer delay > 0
+    // Create an adaptive jitter buffer if a maximum jitter buffer delay is
+    // set. Otherwise create a fixed jitter FIFO if jitter buffer delay > 0.
   unsigned jitter_buffer_delay = 0;
   cfg().getValue(name(), "JITTER_BUFFER_DELAY", jitter_buffer_delay);
-  if (jitter_buffer_delay > 0)
+  unsigned jitter_buffer_max_delay = 0;
+  cfg().getValue(name(), "JITTER_BUFFER_MAX_DELAY", jitter_buffer_max_delay);
+  if (jitter_buffer_max_delay > 0)
+  {
+    m_jitter_fifo = new Async::AudioAdaptiveJitterFifo(
+        jitter_buffer_delay, jitter_buffer_max_delay);
+    prev_src->registerSink(m_jitter_fifo, true);
+    prev_src = m_jitter_fifo;
+  }
+  else if (jitter_buffer_delay > 0)
   {
     AudioFifo *fifo = new Async::AudioFifo(
         2 * jitter_buffer_delay * INTERNAL_SAMPLE_RATE / 1000);
@@ -254,7 +299,16 @@ void ReflectorLogic::onConnected(void)
 {
   cout << name() << ": Connection established to " << m_con->remoteHost() << ":"
        << m_con->remotePort() << endl;
-  sendMsg(MsgProtoVer());
+  sendMsg(MsgProtoVer(m_proto_ver_major, m_proto_ver_minor));
+  m_resuming = false;
+  if (!m_session_token.empty() && (time(NULL) < m_session_token_expires) &&
+      ((m_proto_ver_major > 1) || (m_proto_ver_minor >= 2)))
+  {
+      // Skip the authentication challenge. A token can only be used once.
+    sendMsg(MsgAuthResume(m_callsign, m_session_token));
+    m_resuming = true;
+  }
+  m_session_token.clear();
   m_udp_heartbeat_tx_cnt = UDP_HEARTBEAT_TX_CNT_RESET;
   m_udp_heartbeat_rx_cnt = UDP_HEARTBEAT_RX_CNT_RESET;
   m_tcp_heartbeat_tx_cnt = TCP_HEARTBEAT_TX_CNT_RESET;
@@ -274,7 +328,17 @@ void ReflectorLogic::onDisconnected(TcpConnection *con,
   cout << name() << ": Disconnected from " << m_con->remoteHost() << ":"
        << m_con->remotePort() << ": "
        << TcpConnection::disconnectReasonStr(reason) << endl;
+
+    // Use a randomized, exponentially increasing, reconnect interval so that
+    // all nodes do not reconnect at the same time when the reflector restart
+  uint32_t rnd = 0;
+  gcry_create_nonce(reinterpret_cast<unsigned char*>(&rnd), sizeof(rnd));
+  unsigned reconnect_time = m_reconnect_interval / 2 +
+                            rnd % (m_reconnect_interval / 2 + 1);
+  m_reconnect_timer.setTimeout(reconnect_time);
   m_reconnect_timer.setEnable(true);
+  m_reconnect_interval = (2 * m_reconnect_interval < RECONNECT_MAX_INTERVAL)
+                         ? 2 * m_reconnect_interval : RECONNECT_MAX_INTERVAL;
   delete m_udp_sock;
   m_udp_sock = 0;
   m_next_udp_tx_seq = 0;
@@ -290,6 +354,8 @@ void ReflectorLogic::onDisconnected(TcpConnection *con,
     m_dec->flushEncodedSamples();
     timerclear(&m_last_talker_timestamp);
   }
+  m_nodes.clear();
+  m_connected_gauge->set(0);
   m_con_state = STATE_DISCONNECTED;
 } /* ReflectorLogic::onDisconnected */
 
@@ -329,12 +395,18 @@ void ReflectorLogic::onFrameReceived(FramedTcpConnection *con,
     case MsgError::TYPE:
       handleMsgError(ss);
       break;
+    case MsgProtoVerDowngrade::TYPE:
+      handleMsgProtoVerDowngrade(ss);
+      break;
     case MsgAuthChallenge::TYPE:
       handleMsgAuthChallenge(ss);
       break;
     case MsgAuthOk::TYPE:
       handleMsgAuthOk();
       break;
+    case MsgSessionToken::TYPE:
+      handleMsgSessionToken(ss);
+      break;
     case MsgServerInfo::TYPE:
       handleMsgServerInfo(ss);
       break;
@@ -353,6 +425,18 @@ void ReflectorLogic::onFrameReceived(FramedTcpConnection *con,
     case MsgTalkerStop::TYPE:
       handleMsgTalkerStop(ss);
       break;
+    case MsgNodeTable::TYPE:
+      handleMsgNodeTable(ss);
+      break;
+    case MsgNodeUpdate::TYPE:
+      handleMsgNodeUpdate(ss);
+      break;
+    case MsgTalkerStartNode::TYPE:
+      handleMsgTalkerStartNode(ss);
+      break;
+    case MsgTalkerStopNode::TYPE:
+      handleMsgTalkerStopNode(ss);
+      break;
     default:
       // Better just ignoring unknown messages for easier addition of protocol
       // messages while being backwards compatible
@@ -376,10 +460,57 @@ void ReflectorLogic::handleMsgError(std::istream& is)
   }
   cout << name() << ": Error message received from server: " << msg.message()
        << endl;
+  if ((m_con_state == STATE_EXPECT_AUTH_CHALLENGE) &&
+      ((m_proto_ver_major != 1) || (m_proto_ver_minor != 0)))
+  {
+      // Servers older than protocol version 1.1 do not know how to ask for a
+      // downgrade. They just reject newer clients.
+    cout << name() << ": Falling back to protocol version 1.0" << endl;
+    m_proto_ver_major = 1;
+    m_proto_ver_minor = 0;
+  }
+  else if (m_resuming)
+  {
+    cout << name() << ": Will authenticate on the next connection attempt"
+         << endl;
+  }
   disconnect();
 } /* ReflectorLogic::handleMsgError */
 
 
+void ReflectorLogic::handleMsgProtoVerDowngrade(std::istream& is)
+{
+  if (m_con_state != STATE_EXPECT_AUTH_CHALLENGE)
+  {
+    cerr << "*** ERROR[" << name() << "]: Unexpected MsgProtoVerDowngrade\n";
+    disconnect();
+    return;
+  }
+  MsgProtoVerDowngrade msg;
+  if (!msg.unpack(is))
+  {
+    cerr << "*** ERROR[" << name()
+         << "]: Could not unpack MsgProtoVerDowngrade\n";
+    disconnect();
+    return;
+  }
+  if ((msg.majorVer() != m_proto_ver_major) ||
+      (msg.minorVer() >= m_proto_ver_minor))
+  {
+    cerr << "*** ERROR[" << name() << "]: The server asked for unsupported "
+         << "protocol version " << msg.majorVer() << "." << msg.minorVer()
+         << endl;
+    disconnect();
+    return;
+  }
+  cout << name() << ": Downgrading to protocol version "
+       << msg.majorVer() << "." << msg.minorVer() << endl;
+  m_proto_ver_minor = msg.minorVer();
+  m_resuming = false;
+  sendMsg(MsgProtoVer(m_proto_ver_major, m_proto_ver_minor));
+} /* ReflectorLogic::handleMsgProtoVerDowngrade */
+
+
 void ReflectorLogic::handleMsgAuthChallenge(std::istream& is)
 {
   if (m_con_state != STATE_EXPECT_AUTH_CHALLENGE)
@@ -396,6 +527,12 @@ void ReflectorLogic::handleMsgAuthChallenge(std::istream& is)
     disconnect();
     return;
   }
+  if (m_resuming)
+  {
+      // The server is already checking the session token
+    m_con_state = STATE_EXPECT_AUTH_OK;
+    return;
+  }
   const uint8_t *challenge = msg.challenge();
   if (challenge == 0)
   {
@@ -416,12 +553,28 @@ void ReflectorLogic::handleMsgAuthOk(void)
     disconnect();
     return;
   }
-  cout << name() << ": Authentication OK" << endl;
+  cout << name() << ": "
+       << (m_resuming ? "Session resumed" : "Authentication OK") << endl;
+  m_resuming = false;
   m_con_state = STATE_EXPECT_SERVER_INFO;
   m_con->setMaxFrameSize(ReflectorMsg::MAX_POSTAUTH_FRAME_SIZE);
 } /* ReflectorLogic::handleMsgAuthOk */
 
 
+void ReflectorLogic::handleMsgSessionToken(std::istream& is)
+{
+  MsgSessionToken msg;
+  if (!msg.unpack(is))
+  {
+    cerr << "*** ERROR[" << name() << "]: Could not unpack MsgSessionToken\n";
+    disconnect();
+    return;
+  }
+  m_session_token = msg.token();
+  m_session_token_expires = time(NULL) + msg.lifetime();
+} /* ReflectorLogic::handleMsgSessionToken */
+
+
 void ReflectorLogic::handleMsgServerInfo(std::istream& is)
 {
   if (m_con_state != STATE_EXPECT_SERVER_INFO)
@@ -438,6 +591,7 @@ void ReflectorLogic::handleMsgServerInfo(std::istream& is)
     return;
   }
   m_client_id = msg.clientId();
+  m_reconnect_interval = RECONNECT_MIN_INTERVAL;
 
   //cout << "### MsgServerInfo: clientId=" << msg.clientId()
   //     << " codecs=";
@@ -461,18 +615,29 @@ void ReflectorLogic::handleMsgServerInfo(std::istream& is)
   }
   cout << endl;
 
+    // Use the preferred codec if the server offer it. Otherwise use the
+    // first offered codec that we support.
   string selected_codec;
+  if (!m_preferred_codec.empty() && codecIsAvailable(m_preferred_codec) &&
+      (find(msg.codecs().begin(), msg.codecs().end(), m_preferred_codec) !=
+       msg.codecs().end()))
+  {
+    selected_codec = m_preferred_codec;
+  }
   for (vector<string>::const_iterator it = msg.codecs().begin();
-       it != msg.codecs().end();
+       selected_codec.empty() && (it != msg.codecs().end());
        ++it)
   {
     if (codecIsAvailable(*it))
     {
       selected_codec = *it;
-      setAudioCodec(selected_codec);
-      break;
     }
   }
+  if (!selected_codec.empty())
+  {
+    setAudioCodec(selected_codec);
+    sendMsg(MsgCodecSelect(selected_codec));
+  }
   cout << name() << ": ";
   if (!selected_codec.empty())
   {
@@ -490,6 +655,7 @@ void ReflectorLogic::handleMsgServerInfo(std::istream& is)
       mem_fun(*this, &ReflectorLogic::udpDatagramReceived));
 
   m_con_state = STATE_CONNECTED;
+  m_connected_gauge->set(1);
 
   sendUdpMsg(MsgUdpHeartbeat());
 
@@ -556,6 +722,7 @@ void ReflectorLogic::handleMsgTalkerStart(std::istream& is)
     return;
   }
   cout << name() << ": Talker start: " << msg.callsign() << endl;
+  m_talker_cnt->inc();
 } /* ReflectorLogic::handleMsgTalkerStart */
 
 
@@ -568,10 +735,129 @@ void ReflectorLogic::handleMsgTalkerStop(std::istream& is)
     disconnect();
     return;
   }
-  cout << name() << ": Talker stop: " << msg.callsign() << endl;
+  talkerStopped(msg.callsign());
 } /* ReflectorLogic::handleMsgTalkerStop */
 
 
+void ReflectorLogic::handleMsgNodeTable(std::istream& is)
+{
+  MsgNodeTable msg;
+  if (!msg.unpack(is))
+  {
+    cerr << "*** ERROR[" << name() << "]: Could not unpack MsgNodeTable\n";
+    disconnect();
+    return;
+  }
+  m_nodes.swap(msg.nodes());
+  cout << name() << ": Connected nodes: ";
+  for (std::map<uint16_t, string>::const_iterator it = m_nodes.begin();
+       it != m_nodes.end(); ++it)
+  {
+    cout << ((it != m_nodes.begin()) ? ", " : "") << (*it).second;
+  }
+  cout << endl;
+} /* ReflectorLogic::handleMsgNodeTable */
+
+
+void ReflectorLogic::handleMsgNodeUpdate(std::istream& is)
+{
+  MsgNodeUpdate msg;
+  if (!msg.unpack(is))
+  {
+    cerr << "*** ERROR[" << name() << "]: Could not unpack MsgNodeUpdate\n";
+    disconnect();
+    return;
+  }
+
+    // Only print the nodes that actually changed since the update may
+    // contain nodes that were already in the node table snapshot
+  ostringstream left_ss;
+  for (vector<uint16_t>::const_iterator it = msg.left().begin();
+       it != msg.left().end(); ++it)
+  {
+    std::map<uint16_t, string>::iterator nit = m_nodes.find(*it);
+    if (nit != m_nodes.end())
+    {
+      left_ss << (left_ss.str().empty() ? "" : ", ") << (*nit).second;
+      m_nodes.erase(nit);
+    }
+  }
+  ostringstream joined_ss;
+  for (MsgNodeUpdate::Nodes::const_iterator it = msg.joined().begin();
+       it != msg.joined().end(); ++it)
+  {
+    if (m_nodes.find((*it).first) == m_nodes.end())
+    {
+      joined_ss << (joined_ss.str().empty() ? "" : ", ") << (*it).second;
+    }
+    m_nodes[(*it).first] = (*it).second;
+  }
+  if (!left_ss.str().empty())
+  {
+    cout << name() << ": Node left: " << left_ss.str() << endl;
+  }
+  if (!joined_ss.str().empty())
+  {
+    cout << name() << ": Node joined: " << joined_ss.str() << endl;
+  }
+} /* ReflectorLogic::handleMsgNodeUpdate */
+
+
+void ReflectorLogic::handleMsgTalkerStartNode(std::istream& is)
+{
+  MsgTalkerStartNode msg;
+  if (!msg.unpack(is))
+  {
+    cerr << "*** ERROR[" << name()
+         << "]: Could not unpack MsgTalkerStartNode\n";
+    disconnect();
+    return;
+  }
+  cout << name() << ": Talker start: " << nodeCallsign(msg.nodeId()) << endl;
+  m_talker_cnt->inc();
+} /* ReflectorLogic::handleMsgTalkerStartNode */
+
+
+void ReflectorLogic::handleMsgTalkerStopNode(std::istream& is)
+{
+  MsgTalkerStopNode msg;
+  if (!msg.unpack(is))
+  {
+    cerr << "*** ERROR[" << name()
+         << "]: Could not unpack MsgTalkerStopNode\n";
+    disconnect();
+    return;
+  }
+  talkerStopped(nodeCallsign(msg.nodeId()));
+} /* ReflectorLogic::handleMsgTalkerStopNode */
+
+
+void ReflectorLogic::talkerStopped(const std::string& callsign)
+{
+  cout << name() << ": Talker stop: " << callsign << endl;
+
+  if (m_jitter_fifo != 0)
+  {
+    cout << name() << ": Jitter buffer statistics: "
+         << m_jitter_fifo->statistics() << endl;
+    m_jitter_fifo->resetStatistics();
+  }
+} /* ReflectorLogic::talkerStopped */
+
+
+std::string ReflectorLogic::nodeCallsign(uint16_t node_id) const
+{
+  std::map<uint16_t, string>::const_iterator it = m_nodes.find(node_id);
+  if (it != m_nodes.end())
+  {
+    return (*it).second;
+  }
+  ostringstream ss;
+  ss << "?" << node_id;
+  return ss.str();
+} /* ReflectorLogic::nodeCallsign */
+
+
 void ReflectorLogic::sendMsg(const ReflectorMsg& msg)
 {
   if ((m_con == 0) || !m_con->isConnected())
@@ -631,19 +917,24 @@ void ReflectorLogic::udpDatagramReceived(const IpAddress& addr, uint16_t port,
   {
     return;
   }
+  m_udp_rx_cnt->inc();
 
   if (addr != m_con->remoteHost())
   {
-    cout << "*** WARNING[" << name()
-         << "]: UDP packet received from wrong source address "
-         << addr << ". Should be " << m_con->remoteHost() << "." << endl;
+    ASYNC_LOG_LIMITED(Log::LEVEL_WARNING, name().c_str(),
+                      m_udp_warning_log_limit)
+      << "*** WARNING[" << name()
+      << "]: UDP packet received from wrong source address "
+      << addr << ". Should be " << m_con->remoteHost() << ".";
     return;
   }
   if (port != m_con->remotePort())
   {
-    cout << "*** WARNING[" << name()
-         << "]: UDP packet received with wrong source port number "
-         << port << ". Should be " << m_con->remotePort() << "." << endl;
+    ASYNC_LOG_LIMITED(Log::LEVEL_WARNING, name().c_str(),
+                      m_udp_warning_log_limit)
+      << "*** WARNING[" << name()
+      << "]: UDP packet received with wrong source port number "
+      << port << ". Should be " << m_con->remotePort() << ".";
     return;
   }
 
@@ -653,35 +944,43 @@ void ReflectorLogic::udpDatagramReceived(const IpAddress& addr, uint16_t port,
   ReflectorUdpMsg header;
   if (!header.unpack(ss))
   {
-    cout << "*** WARNING[" << name()
-         << "]: Unpacking failed for UDP message header" << endl;
+    ASYNC_LOG_LIMITED(Log::LEVEL_WARNING, name().c_str(),
+                      m_udp_warning_log_limit)
+      << "*** WARNING[" << name()
+      << "]: Unpacking failed for UDP message header";
     return;
   }
 
   if (header.clientId() != m_client_id)
   {
-    cout << "*** WARNING[" << name()
-         << "]: UDP packet received with wrong client id "
-         << header.clientId() << ". Should be " << m_client_id << "." << endl;
+    ASYNC_LOG_LIMITED(Log::LEVEL_WARNING, name().c_str(),
+                      m_udp_warning_log_limit)
+      << "*** WARNING[" << name()
+      << "]: UDP packet received with wrong client id "
+      << header.clientId() << ". Should be " << m_client_id << ".";
     return;
   }
 
     // Check sequence number
   uint16_t udp_rx_seq_diff = header.sequenceNum() - m_next_udp_rx_seq;
+  unsigned lost_frame_cnt = 0;
   if (udp_rx_seq_diff > 0x7fff) // Frame out of sequence (ignore)
   {
-    cout << name()
-         << ": Dropping out of sequence UDP frame with seq="
-         << header.sequenceNum() << endl;
+    ASYNC_LOG_LIMITED(Log::LEVEL_INFO, name().c_str(), m_udp_seq_log_limit)
+      << name() << ": Dropping out of sequence UDP frame with seq="
+      << header.sequenceNum();
     return;
   }
   else if (udp_rx_seq_diff > 0) // Frame lost
   {
-    cout << name() << ": UDP frame(s) lost. Expected seq="
-         << m_next_udp_rx_seq
-         << " but received " << header.sequenceNum()
-         << ". Resetting next expected sequence number to "
-         << (header.sequenceNum() + 1) << endl;
+    ASYNC_LOG_LIMITED(Log::LEVEL_INFO, name().c_str(), m_udp_seq_log_limit)
+      << name() << ": UDP frame(s) lost. Expected seq="
+      << m_next_udp_rx_seq
+      << " but received " << header.sequenceNum()
+      << ". Resetting next expected sequence number to "
+      << (header.sequenceNum() + 1);
+    lost_frame_cnt = udp_rx_seq_diff;
+    m_udp_lost_cnt->inc(lost_frame_cnt);
   }
   m_next_udp_rx_seq = header.sequenceNum() + 1;
 
@@ -702,6 +1001,12 @@ void ReflectorLogic::udpDatagramReceived(const IpAddress& addr, uint16_t port,
       }
       if (!msg.audioData().empty())
       {
+          // Let the decoder conceal frames lost in the middle of a talker
+          // stream. Loss before the first frame of a stream is not audible.
+        if ((lost_frame_cnt > 0) && timerisset(&m_last_talker_timestamp))
+        {
+          m_dec->packetsLost(lost_frame_cnt);
+        }
         gettimeofday(&m_last_talker_timestamp, NULL);
         m_dec->writeEncodedSamples(
             &msg.audioData().front(), msg.audioData().size());
@@ -752,6 +1057,7 @@ void ReflectorLogic::sendUdpMsg(const ReflectorUdpMsg& msg)
          << "]: Failed to pack reflector TCP message\n";
     return;
   }
+  m_udp_tx_cnt->inc();
   m_udp_sock->write(m_con->remoteHost(), m_con->remotePort(),
                     ss.str().data(), ss.str().size());
 } /* ReflectorLogic::sendUdpMsg */
@@ -828,6 +1134,16 @@ void ReflectorLogic::handleTimerTick(Async::Timer *t)
     }
   }
 
+  if (m_jitter_fifo != 0)
+  {
+    m_jitter_fifo_gauge->set(m_jitter_fifo->samplesInFifo());
+  }
+  long rtt = m_con->roundTripTime();
+  if (rtt >= 0)
+  {
+    m_rtt_gauge->set(rtt / 1000000.0);
+  }
+
   if (--m_udp_heartbeat_tx_cnt == 0)
   {
     sendUdpMsg(MsgUdpHeartbeat());
@@ -870,6 +1186,7 @@ bool ReflectorLogic::setAudioCodec(const std::string& codec_name)
   m_enc->flushEncodedSamples.connect(
       mem_fun(*this, &ReflectorLogic::flushEncodedAudio));
   m_logic_con_in->registerSink(m_enc, false);
+  setCodecOptions(m_enc, "_ENC_");
 
   AudioSink *sink = 0;
   if (m_dec != 0)
@@ -888,6 +1205,7 @@ bool ReflectorLogic::setAudioCodec(const std::string& codec_name)
     assert(m_dec != 0);
     return false;
   }
+  setCodecOptions(m_dec, "_DEC_");
   m_dec->allEncodedSamplesFlushed.connect(
       mem_fun(*this, &ReflectorLogic::allEncodedSamplesFlushed));
   if (sink != 0)
@@ -899,6 +1217,24 @@ bool ReflectorLogic::setAudioCodec(const std::string& codec_name)
 } /* ReflectorLogic::setAudioCodec */
 
 
+template <class Codec>
+void ReflectorLogic::setCodecOptions(Codec *codec, const std::string& type)
+{
+  string opt_prefix(codec->name() + type);
+  list<string> names = cfg().listSection(name());
+  for (list<string>::const_iterator nit=names.begin(); nit!=names.end(); ++nit)
+  {
+    if ((*nit).find(opt_prefix) == 0)
+    {
+      string opt_value;
+      cfg().getValue(name(), *nit, opt_value);
+      string opt_name((*nit).substr(opt_prefix.size()));
+      codec->setOption(opt_name, opt_value);
+    }
+  }
+} /* ReflectorLogic::setCodecOptions */
+
+
 bool ReflectorLogic::codecIsAvailable(const std::string &codec_name)
 {
   return AudioEncoder::isAvailable(codec_name) &&
@@ -36,6 +36,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <sys/time.h>
 #include <string>
+#include <map>
 
 
 /****************************************************************************
@@ -50,7 +51,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncFramedTcpConnection.h>
 #include <AsyncTimer.h>
 #include <AsyncAudioFifo.h>
+#include <AsyncAudioAdaptiveJitterFifo.h>
 #include <AsyncAudioPassthrough.h>
+#include <AsyncLog.h>
 
 
 /****************************************************************************
@@ -71,6 +74,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 namespace Async
 {
   class UdpSocket;
+  class MetricCounter;
+  class MetricGauge;
 };
 
 class ReflectorMsg;
@@ -160,6 +165,10 @@ class ReflectorLogic : public LogicBase
     static const unsigned UDP_HEARTBEAT_RX_CNT_RESET = 60;
     static const unsigned TCP_HEARTBEAT_TX_CNT_RESET = 10;
     static const unsigned TCP_HEARTBEAT_RX_CNT_RESET = 15;
+      // The reconnect interval in milliseconds is doubled for each failed
+      // connection attempt, within these limits, and then randomized
+    static const unsigned RECONNECT_MIN_INTERVAL = 5000;
+    static const unsigned RECONNECT_MAX_INTERVAL = 120000;
 
     std::string               m_reflector_host;
     uint16_t                  m_reflector_port;
@@ -176,14 +185,32 @@ class ReflectorLogic : public LogicBase
     uint16_t                  m_next_udp_rx_seq;
     Async::Timer              m_heartbeat_timer;
     Async::AudioDecoder*      m_dec;
+    Async::AudioAdaptiveJitterFifo* m_jitter_fifo;
     Async::Timer              m_flush_timeout_timer;
     unsigned                  m_udp_heartbeat_tx_cnt;
     unsigned                  m_udp_heartbeat_rx_cnt;
     unsigned                  m_tcp_heartbeat_tx_cnt;
     unsigned                  m_tcp_heartbeat_rx_cnt;
     struct timeval            m_last_talker_timestamp;
+    Async::LogRateLimit       m_udp_warning_log_limit;
+    Async::LogRateLimit       m_udp_seq_log_limit;
     ConState                  m_con_state;
     Async::AudioEncoder*      m_enc;
+    std::string               m_preferred_codec;
+    uint16_t                  m_proto_ver_major;
+    uint16_t                  m_proto_ver_minor;
+    std::map<uint16_t, std::string> m_nodes;
+    unsigned                  m_reconnect_interval;
+    std::vector<uint8_t>      m_session_token;
+    time_t                    m_session_token_expires;
+    bool                      m_resuming;
+    Async::MetricGauge*       m_connected_gauge;
+    Async::MetricCounter*     m_talker_cnt;
+    Async::MetricCounter*     m_udp_rx_cnt;
+    Async::MetricCounter*     m_udp_tx_cnt;
+    Async::MetricCounter*     m_udp_lost_cnt;
+    Async::MetricGauge*       m_jitter_fifo_gauge;
+    Async::MetricGauge*       m_rtt_gauge;
 
     ReflectorLogic(const ReflectorLogic&);
     ReflectorLogic& operator=(const ReflectorLogic&);
@@ -201,6 +228,14 @@ class ReflectorLogic : public LogicBase
     void handleMsgTalkerStop(std::istream& is);
     void handleMsgAuthOk(void);
     void handleMsgServerInfo(std::istream& is);
+    void handleMsgSessionToken(std::istream& is);
+    void handleMsgProtoVerDowngrade(std::istream& is);
+    void handleMsgNodeTable(std::istream& is);
+    void handleMsgNodeUpdate(std::istream& is);
+    void handleMsgTalkerStartNode(std::istream& is);
+    void handleMsgTalkerStopNode(std::istream& is);
+    void talkerStopped(const std::string& callsign);
+    std::string nodeCallsign(uint16_t node_id) const;
     void sendMsg(const ReflectorMsg& msg);
     void sendEncodedAudio(const void *buf, int count);
     void flushEncodedAudio(void);
@@ -215,6 +250,8 @@ class ReflectorLogic : public LogicBase
     void handleTimerTick(Async::Timer *t);
     bool setAudioCodec(const std::string& codec_name);
     bool codecIsAvailable(const std::string &codec_name);
+    template <class Codec>
+    void setCodecOptions(Codec *codec, const std::string& type);
 
 };  /* class ReflectorLogic */
 
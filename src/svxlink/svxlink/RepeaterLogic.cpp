@@ -134,7 +134,8 @@ RepeaterLogic::RepeaterLogic(Async::Config& cfg, const std::string& name)
     open_sql_flank(SQL_FLANK_CLOSE),
     short_sql_open_cnt(0), sql_flap_sup_min_time(1000),
     sql_flap_sup_max_cnt(0), rgr_enable(true), open_reason("?"),
-    ident_nag_min_time(2000), ident_nag_timer(-1)
+    ident_nag_min_time(2000), ident_nag_timer(-1), open_on_ctcss_fq(0),
+    open_on_ctcss_duration(0), required_1750_duration(0)
 {
   up_timer.expired.connect(mem_fun(*this, &RepeaterLogic::idleTimeout));
   open_on_sql_timer.expired.connect(
@@ -159,10 +160,6 @@ bool RepeaterLogic::initialize(void)
     return false;
   }
   
-  float open_on_ctcss_fq = 0;
-  int open_on_ctcss_duration = 0;
-  int required_1750_duration = 0;
-  
   int idle_timeout;
   if (cfg().getValue(name(), "IDLE_TIMEOUT", idle_timeout))
   {
@@ -281,25 +278,7 @@ bool RepeaterLogic::initialize(void)
     ident_nag_min_time = atoi(str.c_str());
   }
   
-  rx().toneDetected.connect(mem_fun(*this, &RepeaterLogic::detectedTone));
-  
-  if (required_1750_duration > 0)
-  {
-    if (!rx().addToneDetector(1750, 50, 10, required_1750_duration))
-    {
-      cerr << "*** WARNING: Could not setup 1750 detection in logic "
-           << name() << "\n";
-    }
-  }
-  
-  if ((open_on_ctcss_fq > 0) && (open_on_ctcss_duration > 0))
-  {
-    if (!rx().addToneDetector(open_on_ctcss_fq, 4, 10, open_on_ctcss_duration))
-    {
-      cerr << "*** WARNING: Could not setup CTCSS tone detection in logic "
-           << name() << "\n";
-    }
-  }
+  setupToneDetectors();
   
   rptValveSetOpen(!no_repeat);
   
@@ -450,6 +429,13 @@ void RepeaterLogic::dtmfCtrlPtyCmdReceived(const void *buf, size_t count)
 } /* RepeaterLogic::dtmfCtrlPtyCmdReceived */
 
 
+void RepeaterLogic::rxReplaced(void)
+{
+  Logic::rxReplaced();
+  setupToneDetectors();
+} /* RepeaterLogic::rxReplaced */
+
+
 #if 0
 bool RepeaterLogic::getIdleState(void) const
 {
@@ -668,6 +654,30 @@ void RepeaterLogic::detectedTone(float fq)
 } /* RepeaterLogic::detectedTone */
 
 
+void RepeaterLogic::setupToneDetectors(void)
+{
+  rx().toneDetected.connect(mem_fun(*this, &RepeaterLogic::detectedTone));
+  
+  if (required_1750_duration > 0)
+  {
+    if (!rx().addToneDetector(1750, 50, 10, required_1750_duration))
+    {
+      cerr << "*** WARNING: Could not setup 1750 detection in logic "
+           << name() << "\n";
+    }
+  }
+  
+  if ((open_on_ctcss_fq > 0) && (open_on_ctcss_duration > 0))
+  {
+    if (!rx().addToneDetector(open_on_ctcss_fq, 4, 10, open_on_ctcss_duration))
+    {
+      cerr << "*** WARNING: Could not setup CTCSS tone detection in logic "
+           << name() << "\n";
+    }
+  }
+} /* RepeaterLogic::setupToneDetectors */
+
+
 void RepeaterLogic::playIdleSound(Timer *t)
 {
   processEvent("repeater_idle");
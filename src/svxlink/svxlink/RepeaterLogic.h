@@ -176,6 +176,7 @@ class RepeaterLogic : public Logic
     virtual void allMsgsWritten(void);
     virtual void audioStreamStateChange(bool is_active, bool is_idle);
     virtual void dtmfCtrlPtyCmdReceived(const void *buf, size_t count);
+    virtual void rxReplaced(void);
 
 
   private:
@@ -204,6 +205,9 @@ class RepeaterLogic : public Logic
     std::string     open_reason;
     int		    ident_nag_min_time;
     Async::Timer    ident_nag_timer;
+    float           open_on_ctcss_fq;
+    int             open_on_ctcss_duration;
+    int             required_1750_duration;
     
     void idleTimeout(Async::Timer *t);
     void setIdle(bool idle);
@@ -214,6 +218,7 @@ class RepeaterLogic : public Logic
     void openOnSqlTimerExpired(Async::Timer *t);
     void activateOnOpenOrClose(SqlFlank flank);
     void identNag(Async::Timer *t);
+    void setupToneDetectors(void);
 
 };  /* class RepeaterLogic */
 
@@ -205,6 +205,16 @@ void SimplexLogic::transmitterStateChange(bool is_transmitting)
 } /* SimplexLogic::transmitterStateChange */
 
 
+void SimplexLogic::rxReplaced(void)
+{
+  Logic::rxReplaced();
+  if (mute_rx_on_tx && tx().isTransmitting())
+  {
+    rx().setMuteState(Rx::MUTE_ALL);
+  }
+} /* SimplexLogic::rxReplaced */
+
+
 
 
 /****************************************************************************
@@ -133,6 +133,7 @@ class SimplexLogic : public Logic
   protected:
     virtual void squelchOpen(bool is_open);
     virtual void transmitterStateChange(bool is_transmitting);
+    virtual void rxReplaced(void);
     
   private:
     bool  mute_rx_on_tx;
@@ -42,6 +42,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <fcntl.h>
 #include <dirent.h>
 #include <pwd.h>
@@ -49,11 +50,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <string>
 #include <iostream>
+#include <fstream>
 #include <iomanip>
 #include <algorithm>
 #include <vector>
 #include <cstring>
 #include <set>
+#include <map>
 #include <cerrno>
 
 
@@ -65,9 +68,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <AsyncCppApplication.h>
 #include <AsyncConfig.h>
+#include <AsyncLog.h>
 #include <AsyncTimer.h>
 #include <AsyncFdWatch.h>
+#include <AsyncPty.h>
 #include <AsyncAudioIO.h>
+#include <AsyncAudioProfiler.h>
+#include <AsyncAudioCodecPool.h>
+#include <AsyncAudioLatencyProbe.h>
+#include <AsyncMetricsHttpServer.h>
 #include <LocationInfo.h>
 #include <common.h>
 #include <config.h>
@@ -127,15 +136,29 @@ using namespace sigc;
 
 static void parse_arguments(int argc, const char **argv);
 static void stdinHandler(FdWatch *w);
-static void stdout_handler(FdWatch *w);
+static bool read_cfg_dir(Config &cfg, const string &main_cfg_filename);
+static LogicBase *create_logic(Config &cfg, const string &logic_name);
 static void initialize_logics(Config &cfg);
+static long elapsed_ms(const struct timeval &start);
+static void section_deps(Config &cfg, const string &section,
+                         set<string> &deps,
+                         const set<string> &skip_tags=set<string>());
+static bool deps_changed(Config &cfg, Config &new_cfg, const string &section,
+                         const set<string> &changed,
+                         const set<string> &skip_tags=set<string>());
+static void changed_sections(Config &old_cfg, Config &new_cfg,
+                             set<string> &changed);
+static void apply_config_changes(Config &cfg, Config &new_cfg,
+                                 const set<string> &changed);
+static void reload_config(void);
+static void ctrl_pty_cmd_received(const void *buf, size_t count);
 static void sighup_handler(int signal);
 static void sigterm_handler(int signal);
 static void handle_unix_signal(int signum);
-static bool logfile_open(void);
-static void logfile_reopen(const char *reason);
-static bool logfile_write_timestamp(void);
-static void logfile_write(const char *buf);
+static bool write_stats_file(const string& filename,
+                             void (*writer)(std::ostream&));
+static void audio_profiler_dump(void);
+static void latency_trace_dump(void);
 static void logfile_flush(void);
 
 
@@ -158,11 +181,15 @@ static char   	      	  *logfile_name = NULL;
 static char   	      	  *runasuser = NULL;
 static char   	      	  *config = NULL;
 static int    	      	  daemonize = 0;
-static int    	      	  logfd = -1;
 static vector<LogicBase*> logic_vec;
 static FdWatch	      	  *stdin_watch = 0;
-static FdWatch	      	  *stdout_watch = 0;
 static string         	  tstamp_format;
+static string         	  main_cfg_filename;
+static Config         	  *running_cfg = 0;
+static Pty            	  *ctrl_pty = 0;
+static string         	  ctrl_pty_buf;
+static string         	  audio_profiler_path;
+static string         	  latency_trace_path;
 
 
 /****************************************************************************
@@ -195,6 +222,7 @@ int main(int argc, char **argv)
   app.catchUnixSignal(SIGHUP);
   app.catchUnixSignal(SIGINT);
   app.catchUnixSignal(SIGTERM);
+  app.catchUnixSignal(SIGUSR1);
   app.unixSignalCaught.connect(sigc::ptr_fun(&handle_unix_signal));
 
   parse_arguments(argc, const_cast<const char **>(argv));
@@ -204,7 +232,7 @@ int main(int argc, char **argv)
   if (logfile_name != 0)
   {
       /* Open the logfile */
-    if (!logfile_open())
+    if (!Log::openLogfile(logfile_name))
     {
       exit(1);
     }
@@ -227,8 +255,7 @@ int main(int argc, char **argv)
       perror("fcntl(..., F_SETFL)");
       exit(1);
     }
-    stdout_watch = new FdWatch(pipefd[0], FdWatch::FD_WATCH_RD);
-    stdout_watch->activity.connect(sigc::ptr_fun(&stdout_handler));
+    Log::setInputFd(pipefd[0]);
 
       /* Redirect stdout to the logpipe */
     if (close(STDOUT_FILENO) == -1)
@@ -376,59 +403,27 @@ int main(int argc, char **argv)
       }
     }
   }
-  string main_cfg_filename(cfg_filename);
-  
-  string cfg_dir;
-  if (cfg.getValue("GLOBAL", "CFG_DIR", cfg_dir))
+  main_cfg_filename = cfg_filename;
+  if (!read_cfg_dir(cfg, main_cfg_filename))
   {
-    if (cfg_dir[0] != '/')
-    {
-      int slash_pos = main_cfg_filename.rfind('/');
-      if (slash_pos != -1)
-      {
-      	cfg_dir = main_cfg_filename.substr(0, slash_pos+1) + cfg_dir;
-      }
-      else
-      {
-      	cfg_dir = string("./") + cfg_dir;
-      }
-    }
-    
-    DIR *dir = opendir(cfg_dir.c_str());
-    if (dir == NULL)
-    {
-      cerr << "*** ERROR: Could not read from directory spcified by "
-      	   << "configuration variable GLOBAL/CFG_DIR=" << cfg_dir << endl;
-      exit(1);
-    }
-    
-    struct dirent *dirent;
-    while ((dirent = readdir(dir)) != NULL)
-    {
-      char *dot = strrchr(dirent->d_name, '.');
-      if ((dot == NULL) || (dirent->d_name[0] == '.') ||
-          (strcmp(dot, ".conf") != 0))
-      {
-      	continue;
-      }
-      cfg_filename = cfg_dir + "/" + dirent->d_name;
-      if (!cfg.open(cfg_filename))
-       {
-	 cerr << "*** ERROR: Could not open configuration file: "
-	      << cfg_filename << endl;
-	 exit(1);
-       }
-    }
-    
-    if (closedir(dir) == -1)
-    {
-      cerr << "*** ERROR: Error closing directory specified by"
-      	   << "configuration variable GLOBAL/CFG_DIR=" << cfg_dir << endl;
-      exit(1);
-    }
+    exit(1);
   }
+  running_cfg = &cfg;
   
   cfg.getValue("GLOBAL", "TIMESTAMP_FORMAT", tstamp_format);
+  Log::setTimestampFormat(tstamp_format);
+  string log_level;
+  if (cfg.getValue("GLOBAL", "LOG_LEVEL", log_level) &&
+      !Log::setLevels(log_level))
+  {
+    cerr << "*** ERROR: Illegal format for configuration variable "
+            "GLOBAL/LOG_LEVEL: " << log_level << endl;
+    exit(1);
+  }
+  if (!Log::start())
+  {
+    exit(1);
+  }
   
   cout << PROGRAM_NAME " v" SVXLINK_VERSION
           " Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX\n\n";
@@ -501,13 +496,68 @@ int main(int argc, char **argv)
     }
   }
 
+    // The audio profiler must be enabled before the audio pipeline is created
+  if (cfg.getValue("GLOBAL", "AUDIO_PROFILER", audio_profiler_path))
+  {
+    cout << "--- Audio profiler enabled. Dump using SIGUSR1 or the "
+            "AUDIO_PROFILE control PTY command.\n";
+    AudioProfiler::setEnabled(true);
+  }
+
+    // Latency probes are only created if enabled before the logics start
+  if (cfg.getValue("GLOBAL", "LATENCY_TRACE", latency_trace_path))
+  {
+    cout << "--- Latency tracing enabled. Dump using SIGUSR1 or the "
+            "LATENCY_REPORT control PTY command.\n";
+    AudioLatencyProbe::setEnabled(true);
+  }
+
+    // The codec pool must be configured before any codecs are created
+  unsigned codec_threads = 0;
+  if (cfg.getValue("GLOBAL", "CODEC_THREADS", codec_threads) &&
+      (codec_threads > 0))
+  {
+    cout << "--- Running audio codecs in " << codec_threads
+         << " worker thread(s)\n";
+    AudioCodecPool::setDefaultThreadCount(codec_threads);
+  }
+
   initialize_logics(cfg);
 
+  MetricsHttpServer *metrics_srv = 0;
+  string metrics_port;
+  if (cfg.getValue("GLOBAL", "METRICS_LISTEN_PORT", metrics_port) &&
+      !metrics_port.empty())
+  {
+    IpAddress metrics_bind_ip;
+    string bind_ip_str;
+    if (cfg.getValue("GLOBAL", "METRICS_BIND_IP", bind_ip_str))
+    {
+      metrics_bind_ip = IpAddress(bind_ip_str);
+    }
+    cout << "--- Serving metrics on TCP port " << metrics_port << endl;
+    metrics_srv = new MetricsHttpServer(metrics_port, metrics_bind_ip);
+  }
+
   if (LinkManager::hasInstance())
   {
     LinkManager::instance()->allLogicsStarted();
   }
 
+  string ctrl_pty_path;
+  cfg.getValue("GLOBAL", "CTRL_PTY", ctrl_pty_path);
+  if (!ctrl_pty_path.empty())
+  {
+    ctrl_pty = new Pty(ctrl_pty_path);
+    if (!ctrl_pty->open())
+    {
+      cerr << "*** ERROR: Could not open control PTY " << ctrl_pty_path
+           << " as specified in configuration variable GLOBAL/CTRL_PTY\n";
+      exit(1);
+    }
+    ctrl_pty->dataReceived.connect(sigc::ptr_fun(&ctrl_pty_cmd_received));
+  }
+
   struct termios org_termios;
   if (logfile_name == 0)
   {
@@ -525,6 +575,10 @@ int main(int argc, char **argv)
 
   app.exec();
 
+  delete metrics_srv;
+  delete ctrl_pty;
+  ctrl_pty = 0;
+
   LinkManager::deleteInstance();
   LocationInfo::deleteInstance();
 
@@ -536,9 +590,8 @@ int main(int argc, char **argv)
     tcsetattr(STDIN_FILENO, TCSANOW, &org_termios);
   }
 
-  if (stdout_watch != 0)
+  if (pipefd[0] != -1)
   {
-    delete stdout_watch;
     close(pipefd[0]);
     close(pipefd[1]);
   }
@@ -549,11 +602,7 @@ int main(int argc, char **argv)
     delete *lit;
   }
   logic_vec.clear();
-  
-  if (logfd != -1)
-  {
-    close(logfd);
-  }
+  running_cfg = 0;
   
   return 0;
   
@@ -688,20 +737,110 @@ static void stdinHandler(FdWatch *w)
 }
 
 
-static void stdout_handler(FdWatch *w)
+static bool read_cfg_dir(Config &cfg, const string &main_cfg_filename)
 {
-  ssize_t len =  0;
-  do
+  string cfg_dir;
+  if (!cfg.getValue("GLOBAL", "CFG_DIR", cfg_dir))
+  {
+    return true;
+  }
+
+  if (cfg_dir[0] != '/')
   {
-    char buf[256];
-    len = read(w->fd(), buf, sizeof(buf)-1);
-    if (len > 0)
+    int slash_pos = main_cfg_filename.rfind('/');
+    if (slash_pos != -1)
     {
-      buf[len] = 0;
-      logfile_write(buf);
+      cfg_dir = main_cfg_filename.substr(0, slash_pos+1) + cfg_dir;
     }
-  } while (len > 0);
-} /* stdout_handler  */
+    else
+    {
+      cfg_dir = string("./") + cfg_dir;
+    }
+  }
+  
+  DIR *dir = opendir(cfg_dir.c_str());
+  if (dir == NULL)
+  {
+    cerr << "*** ERROR: Could not read from directory spcified by "
+         << "configuration variable GLOBAL/CFG_DIR=" << cfg_dir << endl;
+    return false;
+  }
+  
+  bool success = true;
+  struct dirent *dirent;
+  while ((dirent = readdir(dir)) != NULL)
+  {
+    char *dot = strrchr(dirent->d_name, '.');
+    if ((dot == NULL) || (dirent->d_name[0] == '.') ||
+        (strcmp(dot, ".conf") != 0))
+    {
+      continue;
+    }
+    string cfg_filename = cfg_dir + "/" + dirent->d_name;
+    if (!cfg.open(cfg_filename))
+    {
+      cerr << "*** ERROR: Could not open configuration file: "
+           << cfg_filename << endl;
+      success = false;
+      break;
+    }
+  }
+  
+  if (closedir(dir) == -1)
+  {
+    cerr << "*** ERROR: Error closing directory specified by"
+         << "configuration variable GLOBAL/CFG_DIR=" << cfg_dir << endl;
+    return false;
+  }
+
+  return success;
+} /* read_cfg_dir */
+
+
+static LogicBase *create_logic(Config &cfg, const string &logic_name)
+{
+  cout << "\nStarting logic: " << logic_name << endl;
+  
+  string logic_type;
+  if (!cfg.getValue(logic_name, "TYPE", logic_type) || logic_type.empty())
+  {
+    cerr << "*** ERROR: Logic TYPE not specified for logic \""
+         << logic_name << "\". Skipping...\n";
+    return 0;
+  }
+  LogicBase *logic = 0;
+  if (logic_type == "Simplex")
+  {
+    logic = new SimplexLogic(cfg, logic_name);
+  }
+  else if (logic_type == "Repeater")
+  {
+    logic = new RepeaterLogic(cfg, logic_name);
+  }
+  else if (logic_type == "Reflector")
+  {
+    logic = new ReflectorLogic(cfg, logic_name);
+  }
+  else if (logic_type == "Dummy")
+  {
+    logic = new DummyLogic(cfg, logic_name);
+  }
+  else
+  {
+    cerr << "*** ERROR: Unknown logic type \"" << logic_type
+         << "\" specified for logic " << logic_name << ".\n";
+    return 0;
+  }
+  if ((logic == 0) || !logic->initialize())
+  {
+    cerr << "*** ERROR: Could not initialize Logic object \""
+         << logic_name << "\". Skipping...\n";
+    delete logic;
+    return 0;
+  }
+
+  return logic;
+} /* create_logic */
 
 
 static void initialize_logics(Config &cfg)
@@ -713,81 +852,472 @@ static void initialize_logics(Config &cfg)
     exit(1);
   }
 
-  string::iterator comma;
-  string::iterator begin = logics.begin();
-  do
+  struct timeval start;
+  gettimeofday(&start, NULL);
+
+  vector<string> logic_names;
+  vector<long> logic_times;
+  SvxLink::splitStr(logic_names, logics, ",");
+  for (vector<string>::const_iterator it = logic_names.begin();
+       it != logic_names.end(); ++it)
   {
-    comma = find(begin, logics.end(), ',');
-    string logic_name;
-    if (comma == logics.end())
+    struct timeval logic_start;
+    gettimeofday(&logic_start, NULL);
+    LogicBase *logic = create_logic(cfg, *it);
+    logic_times.push_back(elapsed_ms(logic_start));
+    if (logic != 0)
     {
-      logic_name = string(begin, logics.end());
+      logic_vec.push_back(logic);
     }
-    else
+  }
+
+  cout << "\n--- Startup timing report\n";
+  for (size_t i=0; i<logic_names.size(); ++i)
+  {
+    cout << "\t" << left << setw(24) << logic_names[i] << right
+         << setw(8) << logic_times[i] << "ms\n";
+  }
+  cout << "\t" << left << setw(24) << "Total" << right
+       << setw(8) << elapsed_ms(start) << "ms\n";
+  
+  if (logic_vec.size() == 0)
+  {
+    cerr << "*** ERROR: No logics available. Bailing out...\n";
+    exit(1);
+  }
+} /* initialize_logics */
+
+
+static long elapsed_ms(const struct timeval &start)
+{
+  struct timeval now, diff;
+  gettimeofday(&now, NULL);
+  timersub(&now, &start, &diff);
+  return diff.tv_sec * 1000 + diff.tv_usec / 1000;
+} /* elapsed_ms */
+
+
+/*
+ * Find all configuration sections that a section depend on. A section is
+ * considered to be a dependency if its name is used as a value, or as part
+ * of a comma or colon separated list value, in the given section. This will
+ * for example find the receiver and transmitter sections used by a logic
+ * section, as well as the receivers used by a voter.
+ */
+static void section_deps(Config &cfg, const string &section,
+                         set<string> &deps, const set<string> &skip_tags)
+{
+  if (!deps.insert(section).second)
+  {
+    return;
+  }
+
+  list<string> sections = cfg.listSections();
+  set<string> section_set(sections.begin(), sections.end());
+
+  list<string> tags = cfg.listSection(section);
+  for (list<string>::const_iterator tit = tags.begin();
+       tit != tags.end(); ++tit)
+  {
+    if (skip_tags.count(*tit) > 0)
     {
-      logic_name = string(begin, comma);
-      begin = comma + 1;
+      continue;
     }
-    
-    cout << "\nStarting logic: " << logic_name << endl;
-    
-    string logic_type;
-    if (!cfg.getValue(logic_name, "TYPE", logic_type) || logic_type.empty())
+    string value;
+    cfg.getValue(section, *tit, value);
+    vector<string> tokens;
+    SvxLink::splitStr(tokens, value, ",: \t");
+    for (vector<string>::const_iterator it = tokens.begin();
+         it != tokens.end(); ++it)
     {
-      cerr << "*** ERROR: Logic TYPE not specified for logic \""
-      	   << logic_name << "\". Skipping...\n";
+      if ((*it != section) && (section_set.count(*it) > 0))
+      {
+        section_deps(cfg, *it, deps);
+      }
+    }
+  }
+} /* section_deps */
+
+
+/*
+ * Find all sections that differ between the two configurations. A section
+ * is considered changed if it was added, removed or if any variable in
+ * it was added, removed or changed.
+ */
+static void changed_sections(Config &old_cfg, Config &new_cfg,
+                             set<string> &changed)
+{
+  list<string> old_sections = old_cfg.listSections();
+  list<string> new_sections = new_cfg.listSections();
+  set<string> sections(old_sections.begin(), old_sections.end());
+  sections.insert(new_sections.begin(), new_sections.end());
+
+  for (set<string>::const_iterator sit = sections.begin();
+       sit != sections.end(); ++sit)
+  {
+    list<string> old_tags = old_cfg.listSection(*sit);
+    list<string> new_tags = new_cfg.listSection(*sit);
+    if (old_tags != new_tags)
+    {
+      changed.insert(*sit);
       continue;
     }
-    LogicBase *logic = 0;
-    if (logic_type == "Simplex")
+    for (list<string>::const_iterator tit = new_tags.begin();
+         tit != new_tags.end(); ++tit)
     {
-      logic = new SimplexLogic(cfg, logic_name);
+      string old_value, new_value;
+      old_cfg.getValue(*sit, *tit, old_value);
+      new_cfg.getValue(*sit, *tit, new_value);
+      if (old_value != new_value)
+      {
+        changed.insert(*sit);
+        break;
+      }
     }
-    else if (logic_type == "Repeater")
+  }
+} /* changed_sections */
+
+
+/*
+ * Copy all changed sections from the new configuration into the running
+ * configuration. The running configuration object must be kept since all
+ * objects hold a reference to it.
+ */
+static void apply_config_changes(Config &cfg, Config &new_cfg,
+                                 const set<string> &changed)
+{
+  for (set<string>::const_iterator sit = changed.begin();
+       sit != changed.end(); ++sit)
+  {
+    list<string> old_tags = cfg.listSection(*sit);
+    for (list<string>::const_iterator tit = old_tags.begin();
+         tit != old_tags.end(); ++tit)
     {
-      logic = new RepeaterLogic(cfg, logic_name);
+      string value;
+      if (!new_cfg.getValue(*sit, *tit, value))
+      {
+        cfg.removeValue(*sit, *tit);
+      }
     }
-    else if (logic_type == "Reflector")
+    list<string> new_tags = new_cfg.listSection(*sit);
+    for (list<string>::const_iterator tit = new_tags.begin();
+         tit != new_tags.end(); ++tit)
     {
-      logic = new ReflectorLogic(cfg, logic_name);
+      string value;
+      new_cfg.getValue(*sit, *tit, value);
+      cfg.setValue(*sit, *tit, value);
     }
-    else if (logic_type == "Dummy")
+  }
+} /* apply_config_changes */
+
+
+/*
+ * Find out if any of the sections that a section depend on have changed
+ */
+static bool deps_changed(Config &cfg, Config &new_cfg, const string &section,
+                         const set<string> &changed,
+                         const set<string> &skip_tags)
+{
+  set<string> deps;
+  section_deps(cfg, section, deps, skip_tags);
+  section_deps(new_cfg, section, deps, skip_tags);
+  for (set<string>::const_iterator it = deps.begin(); it != deps.end(); ++it)
+  {
+    if (changed.count(*it) > 0)
     {
-      logic = new DummyLogic(cfg, logic_name);
+      return true;
+    }
+  }
+  return false;
+} /* deps_changed */
+
+
+/*
+ * Read the configuration files again and apply the changes to the running
+ * system. Only the logic cores, receivers, transmitters, modules and links
+ * that are affected by the changes are recreated. Everything else is left
+ * running.
+ */
+static void reload_config(void)
+{
+  if (running_cfg == 0)
+  {
+    return;
+  }
+  Config &cfg = *running_cfg;
+
+  cout << "\nReloading configuration file: " << main_cfg_filename << endl;
+  Config new_cfg;
+  if (!new_cfg.open(main_cfg_filename) ||
+      !read_cfg_dir(new_cfg, main_cfg_filename))
+  {
+    cerr << "*** ERROR: Could not read the configuration. "
+            "Keeping the current configuration.\n";
+    return;
+  }
+
+  set<string> changed;
+  changed_sections(cfg, new_cfg, changed);
+  if (changed.empty())
+  {
+    cout << "--- No configuration changes found\n";
+    return;
+  }
+
+  bool links_changed = false;
+  if (changed.count("GLOBAL") > 0)
+  {
+    list<string> tags = new_cfg.listSection("GLOBAL");
+    list<string> old_tags = cfg.listSection("GLOBAL");
+    tags.insert(tags.end(), old_tags.begin(), old_tags.end());
+    tags.sort();
+    tags.unique();
+    for (list<string>::const_iterator it = tags.begin();
+         it != tags.end(); ++it)
+    {
+      string old_value, new_value;
+      cfg.getValue("GLOBAL", *it, old_value);
+      new_cfg.getValue("GLOBAL", *it, new_value);
+      if (old_value == new_value)
+      {
+        continue;
+      }
+      if (*it == "LINKS")
+      {
+        links_changed = true;
+      }
+      else if (*it != "LOGICS")
+      {
+        cout << "*** WARNING: A change to configuration variable GLOBAL/"
+             << *it << " will not take effect until SvxLink is restarted\n";
+      }
+    }
+  }
+
+  string value;
+  vector<string> link_names, new_link_names;
+  cfg.getValue("GLOBAL", "LINKS", value);
+  SvxLink::splitStr(link_names, value, ",");
+  new_cfg.getValue("GLOBAL", "LINKS", value);
+  SvxLink::splitStr(new_link_names, value, ",");
+  link_names.insert(link_names.end(), new_link_names.begin(),
+                    new_link_names.end());
+  for (vector<string>::const_iterator it = link_names.begin();
+       it != link_names.end(); ++it)
+  {
+    links_changed |= (changed.count(*it) > 0);
+  }
+
+  vector<string> logic_names;
+  new_cfg.getValue("GLOBAL", "LOGICS", value);
+  SvxLink::splitStr(logic_names, value, ",");
+  set<string> new_logics(logic_names.begin(), logic_names.end());
+
+    // Find out which logic cores that need to be recreated and which
+    // receivers, transmitters and modules that need to be reloaded. A
+    // change to the RX or TX variable of a logic core will change the logic
+    // section itself so the logic core is recreated in that case.
+  set<string> logic_skip_tags;
+  logic_skip_tags.insert("MODULES");
+  logic_skip_tags.insert("RX");
+  logic_skip_tags.insert("TX");
+  map<string, LogicBase*> keep;
+  vector<LogicBase*> remove;
+  vector<Logic*> rx_reloads;
+  vector<Logic*> tx_reloads;
+  map<Logic*, set<string> > module_reloads;
+  for (vector<LogicBase*>::iterator lit = logic_vec.begin();
+       lit != logic_vec.end(); ++lit)
+  {
+    LogicBase *logic = *lit;
+    const string &name = logic->name();
+    Logic *rxtx_logic = dynamic_cast<Logic*>(logic);
+    set<string> skip_tags;
+    if (rxtx_logic != 0)
+    {
+      skip_tags = logic_skip_tags;
     }
     else
     {
-      cerr << "*** ERROR: Unknown logic type \"" << logic_type
-           << "\" specified for logic " << logic_name << ".\n";
+      skip_tags.insert("MODULES");
+    }
+    if ((new_logics.count(name) == 0) ||
+        deps_changed(cfg, new_cfg, name, changed, skip_tags))
+    {
+      remove.push_back(logic);
       continue;
     }
-    if ((logic == 0) || !logic->initialize())
+    keep[name] = logic;
+
+    if (rxtx_logic == 0)
     {
-      cerr << "*** ERROR: Could not initialize Logic object \""
-      	   << logic_name << "\". Skipping...\n";
-      delete logic;
       continue;
     }
-    
-    logic_vec.push_back(logic);
-  } while (comma != logics.end());
-  
-  if (logic_vec.size() == 0)
+
+    if (cfg.getValue(name, "RX", value) &&
+        deps_changed(cfg, new_cfg, value, changed))
+    {
+      rx_reloads.push_back(rxtx_logic);
+    }
+    if (cfg.getValue(name, "TX", value) &&
+        deps_changed(cfg, new_cfg, value, changed))
+    {
+      tx_reloads.push_back(rxtx_logic);
+    }
+
+    vector<string> modules;
+    cfg.getValue(name, "MODULES", value);
+    SvxLink::splitStr(modules, value, ",");
+    for (vector<string>::const_iterator mit = modules.begin();
+         mit != modules.end(); ++mit)
+    {
+      if (deps_changed(cfg, new_cfg, *mit, changed))
+      {
+        module_reloads[rxtx_logic].insert(*mit);
+      }
+    }
+  }
+
+    // Tear down everything that is affected by the changes
+  if (links_changed && LinkManager::hasInstance())
   {
-    cerr << "*** ERROR: No logics available. Bailing out...\n";
-    exit(1);
+    for (vector<LogicBase*>::iterator lit = logic_vec.begin();
+         lit != logic_vec.end(); ++lit)
+    {
+      LinkManager::instance()->deleteLogic(*lit);
+    }
+    LinkManager::deleteInstance();
   }
-} /* initialize_logics */
+  for (vector<LogicBase*>::iterator lit = remove.begin();
+       lit != remove.end(); ++lit)
+  {
+    cout << "Stopping logic: " << (*lit)->name() << endl;
+    delete *lit;
+  }
+  logic_vec.clear();
+
+    // Now the new configuration can be applied and everything that was
+    // torn down can be recreated
+  apply_config_changes(cfg, new_cfg, changed);
+
+  for (vector<Logic*>::iterator it = rx_reloads.begin();
+       it != rx_reloads.end(); ++it)
+  {
+    (*it)->reloadRx();
+  }
+  for (vector<Logic*>::iterator it = tx_reloads.begin();
+       it != tx_reloads.end(); ++it)
+  {
+    (*it)->reloadTx();
+  }
+
+  for (map<Logic*, set<string> >::iterator it = module_reloads.begin();
+       it != module_reloads.end(); ++it)
+  {
+    for (set<string>::const_iterator mit = it->second.begin();
+         mit != it->second.end(); ++mit)
+    {
+      it->first->reloadModule(*mit);
+    }
+  }
+
+  if (links_changed && cfg.getValue("GLOBAL", "LINKS", value))
+  {
+    if (LinkManager::initialize(cfg, value))
+    {
+      for (map<string, LogicBase*>::iterator it = keep.begin();
+           it != keep.end(); ++it)
+      {
+        LinkManager::instance()->addLogic(it->second);
+      }
+    }
+    else
+    {
+      cerr << "*** ERROR: Could not initialize link manager. "
+           << "GLOBAL/LINKS=" << value << ".\n";
+      LinkManager::deleteInstance();
+    }
+  }
+
+  for (vector<string>::const_iterator it = logic_names.begin();
+       it != logic_names.end(); ++it)
+  {
+    map<string, LogicBase*>::iterator kit = keep.find(*it);
+    if (kit != keep.end())
+    {
+      logic_vec.push_back(kit->second);
+      keep.erase(kit);
+      continue;
+    }
+    LogicBase *logic = create_logic(cfg, *it);
+    if (logic != 0)
+    {
+      logic_vec.push_back(logic);
+    }
+  }
+
+  if (links_changed && LinkManager::hasInstance())
+  {
+    LinkManager::instance()->allLogicsStarted();
+  }
+
+  if (logic_vec.empty())
+  {
+    cerr << "*** WARNING: No logics running after configuration reload\n";
+  }
+  cout << "--- Configuration reload done\n";
+} /* reload_config */
+
+
+static void ctrl_pty_cmd_received(const void *buf, size_t count)
+{
+  const char *buffer = reinterpret_cast<const char*>(buf);
+  ctrl_pty_buf.append(buffer, count);
+  string::size_type eol;
+  while ((eol = ctrl_pty_buf.find_first_of("\r\n")) != string::npos)
+  {
+    string cmd(ctrl_pty_buf, 0, eol);
+    ctrl_pty_buf.erase(0, eol + 1);
+    if (cmd.empty())
+    {
+      continue;
+    }
+    if (cmd == "RELOAD")
+    {
+      reload_config();
+    }
+    else if (cmd == "AUDIO_PROFILE")
+    {
+      audio_profiler_dump();
+    }
+    else if (cmd == "AUDIO_PROFILE_RESET")
+    {
+      AudioProfiler::reset();
+    }
+    else if (cmd == "LATENCY_REPORT")
+    {
+      latency_trace_dump();
+    }
+    else if (cmd == "LATENCY_RESET")
+    {
+      AudioLatencyProbe::reset();
+    }
+    else
+    {
+      cerr << "*** WARNING: Unknown command received on control PTY: "
+           << cmd << endl;
+    }
+  }
+} /* ctrl_pty_cmd_received */
 
 
 static void sighup_handler(int signal)
 {
-  if (logfile_name == 0)
+  if (logfile_name != 0)
   {
-    cout << "Ignoring SIGHUP\n";
-    return;
+    Log::reopenLogfile("SIGHUP received");
   }
-  logfile_reopen("SIGHUP received");
+  reload_config();
 } /* sighup_handler */
 
 
@@ -809,7 +1339,7 @@ static void sigterm_handler(int signal)
   string msg("\n");
   msg += signame;
   msg += " received. Shutting down application...\n";
-  logfile_write(msg.c_str());
+  cout << msg << flush;
   Application::app().quit();
 } /* sigterm_handler */
 
@@ -825,132 +1355,80 @@ static void handle_unix_signal(int signum)
     case SIGTERM:
       sigterm_handler(signum);
       break;
+    case SIGUSR1:
+      if (AudioProfiler::isEnabled() || !AudioLatencyProbe::isEnabled())
+      {
+        audio_profiler_dump();
+      }
+      if (AudioLatencyProbe::isEnabled())
+      {
+        latency_trace_dump();
+      }
+      break;
   }
 } /* handle_unix_signal */
 
 
-static bool logfile_open(void)
+static bool write_stats_file(const string& filename,
+                             void (*writer)(std::ostream&))
 {
-  if (logfd != -1)
-  {
-    close(logfd);
-  }
-  
-  logfd = open(logfile_name, O_WRONLY | O_APPEND | O_CREAT, 00644);
-  if (logfd == -1)
+  ofstream os(filename.c_str());
+  if (!os)
   {
-    cerr << "open(\"" << logfile_name << "\"): " << strerror(errno) << endl;
+    cerr << "*** ERROR: Could not open statistics output file "
+         << filename << endl;
     return false;
   }
-
+  writer(os);
   return true;
-  
-} /* logfile_open */
+} /* write_stats_file */
 
 
-static void logfile_reopen(const char *reason)
+static void audio_profiler_dump(void)
 {
-  logfile_write_timestamp();
-  string msg(reason);
-  msg += ". Reopening logfile\n";
-  if (write(logfd, msg.c_str(), msg.size()) == -1) {}
-
-  logfile_open();
-
-  logfile_write_timestamp();
-  msg = reason;
-  msg += ". Logfile reopened\n";
-  if (write(logfd, msg.c_str(), msg.size()) == -1) {}
-} /* logfile_reopen */
-
+  if (!AudioProfiler::isEnabled())
+  {
+    cerr << "*** WARNING: Audio profiler dump requested but the profiler "
+            "is not enabled. Set GLOBAL/AUDIO_PROFILER to enable it.\n";
+    return;
+  }
 
-static bool logfile_write_timestamp(void)
-{
-  if (!tstamp_format.empty())
+  string dot_filename(audio_profiler_path + ".dot");
+  string json_filename(audio_profiler_path + ".json");
+  if (write_stats_file(dot_filename, &AudioProfiler::writeDot) &&
+      write_stats_file(json_filename, &AudioProfiler::writeJson))
   {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    string fmt(tstamp_format);
-    const string frac_code("%f");
-    size_t pos = fmt.find(frac_code);
-    if (pos != string::npos)
-    {
-      stringstream ss;
-      ss << setfill('0') << setw(3) << (tv.tv_usec / 1000);
-      fmt.replace(pos, frac_code.length(), ss.str());
-    }
-    struct tm *tm = localtime(&tv.tv_sec);
-    char tstr[256];
-    size_t tlen = strftime(tstr, sizeof(tstr), fmt.c_str(), tm);
-    ssize_t ret = write(logfd, tstr, tlen);
-    if (ret != static_cast<ssize_t>(tlen))
-    {
-      return false;
-    }
-    ret = write(logfd, ": ", 2);
-    if (ret != 2)
-    {
-      return false;
-    }
+    cout << "--- Audio profile written to " << dot_filename << " and "
+         << json_filename << endl;
   }
-  return true;
-} /* logfile_write_timestamp */
+} /* audio_profiler_dump */
 
 
-static void logfile_write(const char *buf)
+static void latency_trace_dump(void)
 {
-  if (logfd == -1)
+  if (!AudioLatencyProbe::isEnabled())
   {
-    cout << buf;
+    cerr << "*** WARNING: Latency report requested but latency tracing "
+            "is not enabled. Set GLOBAL/LATENCY_TRACE to enable it.\n";
     return;
   }
-  
-  const char *ptr = buf;
-  while (*ptr != 0)
-  {
-    static bool print_timestamp = true;
-    ssize_t ret;
-    
-    if (print_timestamp)
-    {
-      if (!logfile_write_timestamp())
-      {
-        logfile_reopen("Write error");
-        return;
-      }
-      print_timestamp = false;
-    }
 
-    size_t write_len = 0;
-    const char *nl = strchr(ptr, '\n');
-    if (nl != 0)
-    {
-      write_len = nl-ptr+1;
-      print_timestamp = true;
-    }
-    else
-    {
-      write_len = strlen(ptr);
-    }
-    ret = write(logfd, ptr, write_len);
-    if (ret != static_cast<ssize_t>(write_len))
-    {
-      logfile_reopen("Write error");
-      return;
-    }
-    ptr += write_len;
+  string txt_filename(latency_trace_path + ".txt");
+  string json_filename(latency_trace_path + ".json");
+  if (write_stats_file(txt_filename, &AudioLatencyProbe::writeReport) &&
+      write_stats_file(json_filename, &AudioLatencyProbe::writeJson))
+  {
+    cout << "--- Latency report written to " << txt_filename << " and "
+         << json_filename << endl;
   }
-} /* logfile_write */
+} /* latency_trace_dump */
 
 
 static void logfile_flush(void)
 {
   cout.flush();
   cerr.flush();
-  if (stdout_watch != 0)
-  {
-    stdout_handler(stdout_watch);
-  }
+  Log::stop();
 } /*  logfile_flush */
 
 
@@ -0,0 +1,290 @@
+/**
+@file	 CrossCorrelator.cpp
+@brief   Find the time lag between two signals using FFT cross-correlation
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-30
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "CrossCorrelator.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+  // Signals with a mean power below this level (about -80dBFS) are
+  // considered to be silent
+static const double SILENCE_POWER = 1.0e-8;
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+CrossCorrelator::CrossCorrelator(unsigned ref_len, unsigned max_lag)
+  : ref_len(ref_len), max_lag(max_lag), fft_len(2)
+{
+    // The FFT must be long enough to hold the whole signal, so that the
+    // circular correlation do not wrap around for the lags we look at
+  unsigned bits = 1;
+  while (fft_len < ref_len + 2 * max_lag)
+  {
+    fft_len <<= 1;
+    ++bits;
+  }
+
+  twiddle.resize(fft_len / 2);
+  for (unsigned k=0; k<fft_len/2; ++k)
+  {
+    double phi = -2.0 * M_PI * k / fft_len;
+    twiddle[k] = Complex(cos(phi), sin(phi));
+  }
+
+  bitrev.resize(fft_len);
+  for (unsigned i=0; i<fft_len; ++i)
+  {
+    unsigned rev = 0;
+    for (unsigned b=0; b<bits; ++b)
+    {
+      rev |= ((i >> b) & 1) << (bits - 1 - b);
+    }
+    bitrev[i] = rev;
+  }
+
+  buf.resize(fft_len);
+  energy.resize(ref_len + 2 * max_lag + 1);
+} /* CrossCorrelator::CrossCorrelator */
+
+
+CrossCorrelator::~CrossCorrelator(void)
+{
+} /* CrossCorrelator::~CrossCorrelator */
+
+
+bool CrossCorrelator::findLag(const float *ref, const float *sig, int &lag,
+                              float &corr)
+{
+  const unsigned sig_len = sigLength();
+
+  double ref_energy = 0.0;
+  for (unsigned i=0; i<ref_len; ++i)
+  {
+    ref_energy += ref[i] * ref[i];
+  }
+  energy[0] = 0.0;
+  for (unsigned i=0; i<sig_len; ++i)
+  {
+    energy[i+1] = energy[i] + sig[i] * sig[i];
+  }
+  if ((ref_energy < SILENCE_POWER * ref_len) ||
+      (energy[sig_len] < SILENCE_POWER * sig_len))
+  {
+    return false;
+  }
+
+    // Transform both real signals using one complex FFT, the reference in
+    // the real part and the signal in the imaginary part
+  for (unsigned i=0; i<fft_len; ++i)
+  {
+    buf[i] = Complex((i < ref_len) ? ref[i] : 0.0f,
+                     (i < sig_len) ? sig[i] : 0.0f);
+  }
+  fft(buf);
+
+    // Separate the two spectra and calculate the cross spectrum
+    // C(k) = conj(X(k)) * Y(k). The cross spectrum is conjugated in the
+    // same step to prepare for the inverse transform.
+  for (unsigned k=0; k<=fft_len/2; ++k)
+  {
+    unsigned m = (fft_len - k) & (fft_len - 1);
+    float zk_re = buf[k].real(), zk_im = buf[k].imag();
+    float zm_re = buf[m].real(), zm_im = buf[m].imag();
+
+      // X(k) = (Z(k) + conj(Z(N-k))) / 2, Y(k) = (Z(k) - conj(Z(N-k))) / 2i
+    float xk_re = 0.5f * (zk_re + zm_re), xk_im = 0.5f * (zk_im - zm_im);
+    float yk_re = 0.5f * (zk_im + zm_im), yk_im = 0.5f * (zm_re - zk_re);
+    float ck_re = xk_re * yk_re + xk_im * yk_im;
+    float ck_im = xk_re * yk_im - xk_im * yk_re;
+
+      // X(N-k) and Y(N-k) are the complex conjugates of X(k) and Y(k) so
+      // C(N-k) is the complex conjugate of C(k)
+    buf[k] = Complex(ck_re, -ck_im);
+    buf[m] = Complex(ck_re, ck_im);
+  }
+
+    // The inverse transform of the conjugated cross spectrum. The result is
+    // real so there is no need to conjugate it again.
+  fft(buf);
+
+  float best_corr = 0.0f;
+  int best_lag = 0;
+  for (unsigned m=0; m<=2*max_lag; ++m)
+  {
+    double sig_energy = energy[m + ref_len] - energy[m];
+    if (sig_energy < SILENCE_POWER * ref_len)
+    {
+      continue;
+    }
+    float c = buf[m].real() / fft_len / sqrt(ref_energy * sig_energy);
+    if (fabs(c) > fabs(best_corr))
+    {
+      best_corr = c;
+      best_lag = static_cast<int>(m) - static_cast<int>(max_lag);
+    }
+  }
+
+  lag = best_lag;
+  corr = max(-1.0f, min(1.0f, best_corr));
+  return true;
+
+} /* CrossCorrelator::findLag */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void CrossCorrelator::fft(std::vector<Complex>& x)
+{
+  for (unsigned i=0; i<fft_len; ++i)
+  {
+    unsigned j = bitrev[i];
+    if (i < j)
+    {
+      swap(x[i], x[j]);
+    }
+  }
+
+    // Iterative radix-2 decimation in time. The complex multiplications are
+    // written out to avoid the slow NaN handling of std::complex.
+  for (unsigned len=2; len<=fft_len; len<<=1)
+  {
+    unsigned half = len / 2;
+    unsigned step = fft_len / len;
+    for (unsigned i=0; i<fft_len; i+=len)
+    {
+      for (unsigned k=0; k<half; ++k)
+      {
+        const Complex& w = twiddle[k * step];
+        Complex& a = x[i + k];
+        Complex& b = x[i + k + half];
+        float v_re = b.real() * w.real() - b.imag() * w.imag();
+        float v_im = b.real() * w.imag() + b.imag() * w.real();
+        float u_re = a.real();
+        float u_im = a.imag();
+        a = Complex(u_re + v_re, u_im + v_im);
+        b = Complex(u_re - v_re, u_im - v_im);
+      }
+    }
+  }
+} /* CrossCorrelator::fft */
+
+
+
+/*
+ * This file has not been truncated
+ */
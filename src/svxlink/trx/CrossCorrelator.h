@@ -0,0 +1,195 @@
+/**
+@file	 CrossCorrelator.h
+@brief   Find the time lag between two signals using FFT cross-correlation
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-30
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef CROSS_CORRELATOR_INCLUDED
+#define CROSS_CORRELATOR_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <vector>
+#include <complex>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Find the time lag between two signals using FFT cross-correlation
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-30
+
+This class find the lag where a signal best match a reference signal. All
+lags in the range -max_lag to max_lag are tried at once by calculating the
+cross-correlation in the frequency domain. Both signals are transformed using
+a single complex FFT so each call only need two FFTs, no matter how many lags
+are tried. The FFT tables are calculated once in the constructor so an
+object should be reused for all calculations with the same lengths.
+
+The result is the normalized correlation coefficient so it can be used to
+tell if the signals really contain the same audio. A negative coefficient
+mean that one of the signals is inverted.
+*/
+class CrossCorrelator
+{
+  public:
+    /**
+     * @brief 	Constuctor
+     * @param 	ref_len The number of samples in the reference signal
+     * @param 	max_lag The maximum lag to search for, in samples
+     */
+    CrossCorrelator(unsigned ref_len, unsigned max_lag);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~CrossCorrelator(void);
+
+    /**
+     * @brief 	Get the length of the reference signal
+     * @return	Returns the number of samples in the reference signal
+     */
+    unsigned refLength(void) const { return ref_len; }
+
+    /**
+     * @brief 	Get the maximum lag
+     * @return	Returns the maximum lag in samples
+     */
+    unsigned maxLag(void) const { return max_lag; }
+
+    /**
+     * @brief 	Get the length of the signal to match
+     * @return	Returns refLength() + 2 * maxLag()
+     */
+    unsigned sigLength(void) const { return ref_len + 2 * max_lag; }
+
+    /**
+     * @brief 	Find the lag where the signal best match the reference
+     * @param 	ref  The reference signal, refLength() samples
+     * @param 	sig  The signal to match, sigLength() samples
+     * @param 	lag  Set to the found lag
+     * @param 	corr Set to the correlation coefficient at the found lag
+     * @return	Returns \em true on success or \em false if one of the signals
+     *          is silent
+     *
+     * Sample sig[maxLag() + lag + i] is the best match for sample ref[i].
+     * A positive lag mean that the signal is delayed compared to the
+     * reference. The correlation coefficient is in the range -1 to 1.
+     */
+    bool findLag(const float *ref, const float *sig, int &lag, float &corr);
+
+  private:
+    typedef std::complex<float> Complex;
+
+    unsigned              ref_len;
+    unsigned              max_lag;
+    unsigned              fft_len;
+    std::vector<Complex>  twiddle;
+    std::vector<unsigned> bitrev;
+    std::vector<Complex>  buf;
+    std::vector<double>   energy;
+
+    CrossCorrelator(const CrossCorrelator&);
+    CrossCorrelator& operator=(const CrossCorrelator&);
+    void fft(std::vector<Complex>& x);
+
+};  /* class CrossCorrelator */
+
+
+//} /* namespace */
+
+#endif /* CROSS_CORRELATOR_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -474,7 +474,7 @@ namespace {
     public:
       virtual ~Demodulator(void) {}
 
-      virtual void iq_received(vector<WbRxRtlSdr::Sample> samples) = 0;
+      virtual void iq_received(const vector<WbRxRtlSdr::Sample> &samples) = 0;
 
       /**
        * @brief Resume audio output to the sink
@@ -554,7 +554,7 @@ namespace {
         dec->setGain(adj_db);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void iq_received(const vector<WbRxRtlSdr::Sample> &samples)
       {
           // From article-sdr-is-qs.pdf: Watch your Is and Qs:
           //   FM = (Qn.In-1 - In.Qn-1)/(In.In-1 + Qn.Qn-1)
@@ -603,7 +603,7 @@ namespace {
         agc.setReference(1);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void iq_received(const vector<WbRxRtlSdr::Sample> &samples)
       {
         vector<WbRxRtlSdr::Sample> gain_adjusted;
         agc.iq_received(gain_adjusted, samples);
@@ -640,7 +640,7 @@ namespace {
         use_lsb = use;
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void iq_received(const vector<WbRxRtlSdr::Sample> &samples)
       {
         vector<float> Q, Qh, audio;
         Q.reserve(samples.size());
@@ -691,7 +691,7 @@ namespace {
         trans.setOffset(lsb ? 2000 : -2000);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void iq_received(const vector<WbRxRtlSdr::Sample> &samples)
       {
         vector<WbRxRtlSdr::Sample> gain_adjusted;
         agc.iq_received(gain_adjusted, samples);
@@ -729,7 +729,7 @@ namespace {
         agc.setReference(0.05);
       }
 
-      void iq_received(vector<WbRxRtlSdr::Sample> samples)
+      void iq_received(const vector<WbRxRtlSdr::Sample> &samples)
       {
         vector<WbRxRtlSdr::Sample> gain_adjusted;
         agc.iq_received(gain_adjusted, samples);
@@ -1075,12 +1075,12 @@ class Ddr::Channel : public sigc::trackable, public Async::AudioSource
       return channelizer->chSampRate();
     }
 
-    void iq_received(vector<WbRxRtlSdr::Sample> samples)
+    void iq_received(const WbRxRtlSdr::IqBuffer &iq)
     {
       if (enabled)
       {
         vector<WbRxRtlSdr::Sample> translated, channelized;
-        trans.iq_received(translated, samples);
+        trans.iq_received(translated, iq.samples());
         channelizer->iq_received(channelized, translated);
         demod->iq_received(channelized);
       }
@@ -0,0 +1,499 @@
+/**
+@file	 DiversityCombiner.cpp
+@brief   Combine time aligned audio from multiple receivers
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-30
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioProfiler.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "DiversityCombiner.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+/**
+ * @brief A stream that may be combined with the reference stream
+ *
+ * The samples are stored in a ring buffer. The index of a sample is the
+ * number of samples written to the stream before it. The index of the sample
+ * matching reference sample n is n + offset.
+ */
+class DiversityCombiner::Input : public AudioSink
+{
+  public:
+    Input(DiversityCombiner *combiner)
+      : combiner(combiner), buf(BUF_SIZE, 0.0f), start(0), wr(0), offset(0),
+        next_estimate(0), weight(0.0f), polarity(1.0f), fade(0.0f),
+        missed_estimates(0), is_active(false), is_aligned(false)
+    {
+    }
+
+    virtual int writeSamples(const float *samples, int count)
+    {
+      if (!is_active)
+      {
+        is_active = true;
+        start = wr;
+        combiner->inputStarted(this);
+      }
+      for (int i=0; i<count; ++i)
+      {
+        buf[(wr + i) & (BUF_SIZE - 1)] = samples[i];
+      }
+      wr += count;
+      return count;
+    }
+
+    virtual void flushSamples(void)
+    {
+      is_active = false;
+      is_aligned = false;
+      sourceAllSamplesFlushed();
+    }
+
+    bool hasSample(int64_t idx) const
+    {
+      return (idx >= start) && (idx < wr) &&
+             (idx >= wr - static_cast<int64_t>(BUF_SIZE));
+    }
+
+    float sample(int64_t idx) const
+    {
+      return buf[idx & (BUF_SIZE - 1)];
+    }
+
+    DiversityCombiner *combiner;
+    vector<float>     buf;
+    int64_t           start;
+    int64_t           wr;
+    int64_t           offset;
+    int64_t           next_estimate;
+    float             weight;
+    float             polarity;
+    float             fade;
+    unsigned          missed_estimates;
+    bool              is_active;
+    bool              is_aligned;
+
+}; /* class DiversityCombiner::Input */
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+  // The minimum correlation coefficient for a stream to be considered to
+  // contain the same audio as the reference stream
+static const float MIN_CORRELATION = 0.5f;
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+DiversityCombiner::DiversityCombiner(unsigned delay_ms)
+  : xcorr(CORR_LEN_MS * INTERNAL_SAMPLE_RATE / 1000,
+          MAX_LAG_MS * INTERNAL_SAMPLE_RATE / 1000),
+    ref_buf(BUF_SIZE, 0.0f), corr_buf(xcorr.refLength() + xcorr.sigLength()),
+    ref_start(0), ref_wr(0), out_pos(0),
+    delay(delay_ms * INTERNAL_SAMPLE_RATE / 1000), ref_weight(1.0f),
+    fade_step(1000.0f / (FADE_IN_MS * INTERNAL_SAMPLE_RATE)), outbuf_pos(0),
+    outbuf_cnt(0), is_idle(true), is_flushing(false), input_stopped(false)
+{
+  assert(delay + OUTBUF_SIZE < BUF_SIZE);
+} /* DiversityCombiner::DiversityCombiner */
+
+
+DiversityCombiner::~DiversityCombiner(void)
+{
+  for (InputMap::iterator it=inputs.begin(); it!=inputs.end(); ++it)
+  {
+    delete (*it).second;
+  }
+} /* DiversityCombiner::~DiversityCombiner */
+
+
+void DiversityCombiner::addSource(AudioSource *source)
+{
+  assert(source != 0);
+  assert(inputs.find(source) == inputs.end());
+  Input *input = new Input(this);
+  AudioProfiler::setOwner(input, this);
+  input->registerSource(source);
+  inputs[source] = input;
+} /* DiversityCombiner::addSource */
+
+
+void DiversityCombiner::setWeight(AudioSource *source, float weight)
+{
+  InputMap::iterator it = inputs.find(source);
+  assert(it != inputs.end());
+  Input *input = (*it).second;
+  if (weight <= 0.0f)
+  {
+    input->weight = 0.0f;
+    input->is_aligned = false;
+    input->missed_estimates = 0;
+  }
+  else
+  {
+    input->weight = weight;
+  }
+} /* DiversityCombiner::setWeight */
+
+
+void DiversityCombiner::setReferenceWeight(float weight)
+{
+  ref_weight = max(weight, 0.0f);
+} /* DiversityCombiner::setReferenceWeight */
+
+
+bool DiversityCombiner::isAligned(AudioSource *source) const
+{
+  InputMap::const_iterator it = inputs.find(source);
+  assert(it != inputs.end());
+  const Input *input = (*it).second;
+  return input->is_aligned && (input->weight > 0.0f);
+} /* DiversityCombiner::isAligned */
+
+
+int DiversityCombiner::writeSamples(const float *samples, int count)
+{
+  assert(count > 0);
+
+  if (is_idle)
+  {
+      // A new reference stream is starting. Assume that all active inputs
+      // are in sync with it until we know better.
+    is_idle = false;
+    ref_start = ref_wr;
+    out_pos = ref_wr;
+    for (InputMap::iterator it=inputs.begin(); it!=inputs.end(); ++it)
+    {
+      Input *input = (*it).second;
+      if (input->is_active)
+      {
+        inputStarted(input);
+      }
+    }
+  }
+  is_flushing = false;
+
+  int64_t space = BUF_SIZE - (ref_wr - out_pos);
+  count = static_cast<int>(min(static_cast<int64_t>(count), space));
+  if (count == 0)
+  {
+    input_stopped = true;
+    return 0;
+  }
+
+  for (int i=0; i<count; ++i)
+  {
+    ref_buf[(ref_wr + i) & (BUF_SIZE - 1)] = samples[i];
+  }
+  ref_wr += count;
+
+  estimateLags();
+  writeOutput();
+
+  return count;
+
+} /* DiversityCombiner::writeSamples */
+
+
+void DiversityCombiner::flushSamples(void)
+{
+  is_flushing = true;
+  writeOutput();
+} /* DiversityCombiner::flushSamples */
+
+
+void DiversityCombiner::resumeOutput(void)
+{
+  writeOutput();
+} /* DiversityCombiner::resumeOutput */
+
+
+void DiversityCombiner::allSamplesFlushed(void)
+{
+  sourceAllSamplesFlushed();
+} /* DiversityCombiner::allSamplesFlushed */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void DiversityCombiner::inputStarted(Input *input)
+{
+    // The latest input sample is assumed to match the latest sample written
+    // to the reference stream before it was delayed. The cross-correlation
+    // will find the real offset.
+  input->offset = input->wr - ref_wr -
+                  static_cast<int64_t>(referenceDelay());
+  input->next_estimate = ref_wr;
+  input->missed_estimates = 0;
+  input->is_aligned = false;
+} /* DiversityCombiner::inputStarted */
+
+
+void DiversityCombiner::estimateLags(void)
+{
+  for (InputMap::iterator it=inputs.begin(); it!=inputs.end(); ++it)
+  {
+    Input *input = (*it).second;
+    if (input->is_active && (input->weight > 0.0f) &&
+        (ref_wr >= input->next_estimate))
+    {
+      estimateLag(input);
+    }
+  }
+} /* DiversityCombiner::estimateLags */
+
+
+void DiversityCombiner::estimateLag(Input *input)
+{
+  const int64_t ref_len = xcorr.refLength();
+  const int64_t max_lag = xcorr.maxLag();
+
+    // Use the latest reference samples where all input samples for all lags
+    // have been received
+  int64_t end = min(ref_wr, input->wr - input->offset - max_lag);
+  int64_t begin = end - ref_len;
+  int64_t sig_begin = begin + input->offset - max_lag;
+  if ((begin < ref_start) ||
+      (begin < ref_wr - static_cast<int64_t>(BUF_SIZE)) ||
+      !input->hasSample(sig_begin))
+  {
+      // Not enough samples yet. Try again on the next write.
+    return;
+  }
+
+  float *ref = &corr_buf[0];
+  float *sig = &corr_buf[ref_len];
+  for (int64_t i=0; i<ref_len; ++i)
+  {
+    ref[i] = ref_buf[(begin + i) & (BUF_SIZE - 1)];
+  }
+  for (unsigned i=0; i<xcorr.sigLength(); ++i)
+  {
+    sig[i] = input->sample(sig_begin + i);
+  }
+
+  int lag;
+  float corr;
+  if (xcorr.findLag(ref, sig, lag, corr))
+  {
+    if (fabs(corr) >= MIN_CORRELATION)
+    {
+      input->offset += lag;
+      input->polarity = (corr < 0.0f) ? -1.0f : 1.0f;
+      if (!input->is_aligned)
+      {
+        input->is_aligned = true;
+        input->fade = 0.0f;
+      }
+      input->missed_estimates = 0;
+    }
+    else if (++input->missed_estimates >= MAX_MISSED_ESTIMATES)
+    {
+      input->is_aligned = false;
+    }
+  }
+
+  input->next_estimate = ref_wr +
+      ESTIMATE_INTERVAL_MS * INTERNAL_SAMPLE_RATE / 1000;
+
+} /* DiversityCombiner::estimateLag */
+
+
+void DiversityCombiner::writeOutput(void)
+{
+  for (;;)
+  {
+    while (outbuf_pos < outbuf_cnt)
+    {
+      int written = sinkWriteSamples(outbuf + outbuf_pos,
+                                     outbuf_cnt - outbuf_pos);
+      if (written == 0)
+      {
+        return;
+      }
+      outbuf_pos += written;
+    }
+
+    int64_t end = is_flushing ? ref_wr : ref_wr - delay;
+    if (end <= out_pos)
+    {
+      break;
+    }
+    combine(static_cast<unsigned>(
+          min(end - out_pos, static_cast<int64_t>(OUTBUF_SIZE))));
+  }
+
+  if (input_stopped)
+  {
+    input_stopped = false;
+    sourceResumeOutput();
+  }
+
+  if (is_flushing && (out_pos == ref_wr))
+  {
+    is_flushing = false;
+    is_idle = true;
+    sinkFlushSamples();
+  }
+} /* DiversityCombiner::writeOutput */
+
+
+void DiversityCombiner::combine(unsigned count)
+{
+  float weights[OUTBUF_SIZE];
+  for (unsigned i=0; i<count; ++i)
+  {
+    outbuf[i] = ref_weight * ref_buf[(out_pos + i) & (BUF_SIZE - 1)];
+    weights[i] = ref_weight;
+  }
+
+  for (InputMap::iterator it=inputs.begin(); it!=inputs.end(); ++it)
+  {
+    Input *input = (*it).second;
+    if (!input->is_aligned || (input->weight <= 0.0f))
+    {
+      continue;
+    }
+    for (unsigned i=0; i<count; ++i)
+    {
+      int64_t idx = out_pos + i + input->offset;
+      if (input->hasSample(idx))
+      {
+        float weight = input->weight * input->fade;
+        outbuf[i] += weight * input->polarity * input->sample(idx);
+        weights[i] += weight;
+        input->fade = min(1.0f, input->fade + fade_step);
+      }
+    }
+  }
+
+  for (unsigned i=0; i<count; ++i)
+  {
+    if (weights[i] > 0.0f)
+    {
+      outbuf[i] /= weights[i];
+    }
+  }
+
+  out_pos += count;
+  outbuf_pos = 0;
+  outbuf_cnt = count;
+
+} /* DiversityCombiner::combine */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,266 @@
+/**
+@file	 DiversityCombiner.h
+@brief   Combine time aligned audio from multiple receivers
+@author  Tobias Blomberg / SM0SVX
+@date	 2017-12-30
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2017 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef DIVERSITY_COMBINER_INCLUDED
+#define DIVERSITY_COMBINER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+#include <sigc++/sigc++.h>
+
+#include <vector>
+#include <map>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioSink.h>
+#include <AsyncAudioSource.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "CrossCorrelator.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Combine time aligned audio from multiple receivers
+@author Tobias Blomberg / SM0SVX
+@date   2017-12-30
+
+This class is used by the voter to combine the audio from more than one
+receiver. The audio written to the sink side of this object is the reference
+stream, normally the audio from the receiver chosen by the voter. Audio from
+other receivers are added using the addSource function.
+
+The delay of each added stream, compared to the reference stream, is found by
+cross-correlating the two streams a couple of times per second. When a stream
+has been found to contain the same audio as the reference, it is time
+aligned and added to the output, weighted by the value given to the setWeight
+function. The output is normalized so that the audio level is the same no
+matter how many streams are combined. Streams that do not correlate well with
+the reference, e.g. because the receiver pick up a different transmitter,
+are never added.
+
+The reference stream is delayed a fixed time before being written to the
+output. This give streams that arrive later than the reference stream a
+chance to contribute.
+
+The reference stream may also be delayed before it reach this object, e.g.
+by the voting delay buffer, while the added streams are not. The
+referenceDelay signal is used to get that delay when a stream starts so that
+the initial offset guess is close enough for the cross-correlation to find
+the real offset.
+*/
+class DiversityCombiner : public Async::AudioSink, public Async::AudioSource
+{
+  public:
+    /**
+     * @brief 	Constuctor
+     * @param 	delay_ms The time in milliseconds to delay the reference
+     */
+    explicit DiversityCombiner(unsigned delay_ms);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~DiversityCombiner(void);
+
+    /**
+     * @brief 	Add a stream that may be combined with the reference
+     * @param 	source The audio source of the stream
+     */
+    void addSource(Async::AudioSource *source);
+
+    /**
+     * @brief 	Set the weight of a stream
+     * @param 	source The audio source of the stream
+     * @param 	weight The weight, relative to the reference weight
+     *
+     * Setting the weight to zero will remove the stream from the combined
+     * output. The weight of all streams is zero from the start.
+     */
+    void setWeight(Async::AudioSource *source, float weight);
+
+    /**
+     * @brief 	Set the weight of the reference stream
+     * @param 	weight The weight, default 1.0
+     */
+    void setReferenceWeight(float weight);
+
+    /**
+     * @brief 	Check if a stream is time aligned with the reference
+     * @param 	source The audio source of the stream
+     * @return	Returns \em true if the stream is currently combined
+     */
+    bool isAligned(Async::AudioSource *source) const;
+
+    /**
+     * @brief 	Write samples into this audio sink
+     * @param 	samples The buffer containing the samples
+     * @param 	count The number of samples in the buffer
+     * @return	Returns the number of samples that has been taken care of
+     */
+    virtual int writeSamples(const float *samples, int count);
+
+    /**
+     * @brief 	Tell the sink to flush the previously written samples
+     */
+    virtual void flushSamples(void);
+
+    /**
+     * @brief Resume audio output to the sink
+     */
+    virtual void resumeOutput(void);
+
+    /**
+     * @brief The registered sink has flushed all samples
+     */
+    virtual void allSamplesFlushed(void);
+
+    /**
+     * @brief   A signal that is emitted to get the reference stream delay
+     * @return  Return the number of samples the reference stream is delayed
+     *          compared to the added streams
+     *
+     * The signal is emitted when a stream start. If not connected, the
+     * streams are assumed to be in sync with the reference.
+     */
+    sigc::signal<unsigned> referenceDelay;
+
+  private:
+    class Input;
+    typedef std::map<Async::AudioSource*, Input*> InputMap;
+
+    static const unsigned BUF_SIZE                = 32768;
+    static const unsigned OUTBUF_SIZE             = 256;
+    static const unsigned CORR_LEN_MS             = 128;
+    static const unsigned MAX_LAG_MS              = 250;
+    static const unsigned ESTIMATE_INTERVAL_MS    = 500;
+    static const unsigned MAX_MISSED_ESTIMATES    = 4;
+    static const unsigned FADE_IN_MS              = 10;
+
+    InputMap            inputs;
+    CrossCorrelator     xcorr;
+    std::vector<float>  ref_buf;
+    std::vector<float>  corr_buf;
+    int64_t             ref_start;
+    int64_t             ref_wr;
+    int64_t             out_pos;
+    unsigned            delay;
+    float               ref_weight;
+    float               fade_step;
+    float               outbuf[OUTBUF_SIZE];
+    unsigned            outbuf_pos;
+    unsigned            outbuf_cnt;
+    bool                is_idle;
+    bool                is_flushing;
+    bool                input_stopped;
+
+    DiversityCombiner(const DiversityCombiner&);
+    DiversityCombiner& operator=(const DiversityCombiner&);
+    void inputStarted(Input *input);
+    void estimateLags(void);
+    void estimateLag(Input *input);
+    void writeOutput(void);
+    void combine(unsigned count);
+
+    friend class Input;
+
+};  /* class DiversityCombiner */
+
+
+//} /* namespace */
+
+#endif /* DIVERSITY_COMBINER_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
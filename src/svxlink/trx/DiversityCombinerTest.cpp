@@ -0,0 +1,247 @@
+/*
+ * Test for the CrossCorrelator and DiversityCombiner classes.
+ *
+ * First CrossCorrelator::findLag is run on delayed, inverted and noisy
+ * copies of a speech like signal and the found lags are checked. Then two
+ * receivers picking up the same transmission are simulated. The reference
+ * receiver is delayed by a voting delay buffer, like in the Voter, while the
+ * other receiver is fed directly to the combiner. The other receiver is also
+ * inverted, a bit delayed and has its own noise. The test check that the
+ * combiner align the streams and that the combined output is less noisy
+ * than the reference alone.
+ *
+ * Usage: DiversityCombinerTest [-v voting delay ms]
+ */
+
+#include <unistd.h>
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <cstdlib>
+#include <cmath>
+
+#include <AsyncAudioPassthrough.h>
+#include <AsyncAudioSink.h>
+
+#include "CrossCorrelator.h"
+#include "DiversityCombiner.h"
+
+using namespace std;
+using namespace Async;
+
+
+static const unsigned BLOCK_SIZE = INTERNAL_SAMPLE_RATE / 50;
+static const unsigned PATH_DELAY = 30 * INTERNAL_SAMPLE_RATE / 1000;
+static const unsigned COMBINE_DELAY_MS = 100;
+static const float    NOISE_LEVEL = 0.1f;
+
+static unsigned voting_delay_ms = 1000;
+static unsigned errors = 0;
+
+
+class SampleCollector : public AudioSink
+{
+  public:
+    virtual int writeSamples(const float *samples, int count)
+    {
+      buf.insert(buf.end(), samples, samples + count);
+      return count;
+    }
+
+    virtual void flushSamples(void)
+    {
+      sourceAllSamplesFlushed();
+    }
+
+    vector<float> buf;
+};
+
+
+static float noise(void)
+{
+  return 2.0f * rand() / RAND_MAX - 1.0f;
+}
+
+
+  // Low pass filtered noise with a slowly varying envelope
+static void generateSignal(vector<float> &sig, unsigned len)
+{
+  sig.resize(len);
+  float lp = 0.0f;
+  for (unsigned i=0; i<len; ++i)
+  {
+    lp += 0.3f * (noise() - lp);
+    float env = 0.6f + 0.4f * sin(2.0 * M_PI * 3.0 * i / INTERNAL_SAMPLE_RATE);
+    sig[i] = env * lp;
+  }
+}
+
+
+static void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    cout << "*** FAILED: " << what << endl;
+    ++errors;
+  }
+}
+
+
+static void testCrossCorrelator(void)
+{
+  CrossCorrelator xcorr(2048, 4000);
+  vector<float> clean;
+  generateSignal(clean, xcorr.sigLength() + 8000);
+  const unsigned ref_pos = 2 * xcorr.maxLag();
+
+  const int lags[] = { 0, 37, -1200, 3000, -3999 };
+  for (unsigned l=0; l<sizeof(lags)/sizeof(*lags); ++l)
+  {
+    for (int inverted=0; inverted<2; ++inverted)
+    {
+        // Sample sig[max_lag + lag + i] should match ref[i]
+      vector<float> ref(xcorr.refLength());
+      vector<float> sig(xcorr.sigLength());
+      for (unsigned i=0; i<ref.size(); ++i)
+      {
+        ref[i] = clean[ref_pos + i] + NOISE_LEVEL * noise();
+      }
+      float polarity = inverted ? -1.0f : 1.0f;
+      int first = static_cast<int>(ref_pos) -
+                  static_cast<int>(xcorr.maxLag()) - lags[l];
+      for (unsigned i=0; i<sig.size(); ++i)
+      {
+        sig[i] = polarity * clean[first + i] + NOISE_LEVEL * noise();
+      }
+
+      int lag = 0;
+      float corr = 0.0f;
+      bool found = xcorr.findLag(&ref[0], &sig[0], lag, corr);
+      cout << "findLag: lag=" << lags[l] << " inverted=" << inverted
+           << " -> lag=" << lag << " corr=" << corr << endl;
+      check(found, "findLag returned false");
+      check(lag == lags[l], "findLag found the wrong lag");
+      check(polarity * corr > 0.5f, "findLag correlation too low");
+    }
+  }
+
+  vector<float> ref(xcorr.refLength(), 0.0f);
+  vector<float> sig(clean.begin(), clean.begin() + xcorr.sigLength());
+  int lag;
+  float corr;
+  check(!xcorr.findLag(&ref[0], &sig[0], lag, corr),
+        "findLag accepted a silent reference");
+}
+
+
+static double noisePower(const vector<float> &out, const vector<float> &clean,
+                         size_t begin, size_t end)
+{
+  double pwr = 0.0;
+  for (size_t i=begin; i<end; ++i)
+  {
+    double diff = out[i] - clean[i];
+    pwr += diff * diff;
+  }
+  return pwr / (end - begin);
+}
+
+
+  // The fill of the simulated voting delay buffer
+static deque<float> voting_fifo;
+
+static unsigned referenceDelay(void)
+{
+  return voting_fifo.size();
+}
+
+
+static void testDiversityCombiner(void)
+{
+  const unsigned voting_delay =
+    voting_delay_ms * INTERNAL_SAMPLE_RATE / 1000;
+  const unsigned len = 6 * INTERNAL_SAMPLE_RATE;
+  vector<float> clean;
+  generateSignal(clean, len + PATH_DELAY);
+
+  DiversityCombiner combiner(COMBINE_DELAY_MS);
+  combiner.referenceDelay.connect(sigc::ptr_fun(referenceDelay));
+  SampleCollector output;
+  combiner.registerSink(&output);
+  AudioPassthrough other_rx;
+  combiner.addSource(&other_rx);
+  combiner.setWeight(&other_rx, 1.0f);
+
+  vector<float> ref_buf(BLOCK_SIZE);
+  vector<float> other_buf(BLOCK_SIZE);
+  for (unsigned pos=0; pos+BLOCK_SIZE<=len; pos+=BLOCK_SIZE)
+  {
+    for (unsigned i=0; i<BLOCK_SIZE; ++i)
+    {
+      voting_fifo.push_back(clean[PATH_DELAY + pos + i] +
+                            NOISE_LEVEL * noise());
+      other_buf[i] = -clean[pos + i] + NOISE_LEVEL * noise();
+    }
+    other_rx.writeSamples(&other_buf[0], other_buf.size());
+
+      // Like the AudioFifo, the samples being written are still counted as
+      // buffered while they are written
+    if (pos >= voting_delay)
+    {
+      while (!voting_fifo.empty())
+      {
+        copy(voting_fifo.begin(), voting_fifo.begin() + BLOCK_SIZE,
+             ref_buf.begin());
+        combiner.writeSamples(&ref_buf[0], ref_buf.size());
+        voting_fifo.erase(voting_fifo.begin(),
+                          voting_fifo.begin() + BLOCK_SIZE);
+      }
+    }
+  }
+  bool aligned = combiner.isAligned(&other_rx);
+  combiner.flushSamples();
+  other_rx.flushSamples();
+
+  cout << "DiversityCombiner: voting_delay=" << voting_delay_ms << "ms"
+       << " aligned=" << (aligned ? "yes" : "no") << endl;
+  check(aligned, "The streams were not aligned");
+
+    // Compare the noise in the last second of the output with the noise in
+    // the reference stream
+  vector<float> ref_clean(clean.begin() + PATH_DELAY, clean.end());
+  size_t end = output.buf.size();
+  size_t begin = end - INTERNAL_SAMPLE_RATE;
+  double ref_noise = NOISE_LEVEL * NOISE_LEVEL / 3.0;
+  double out_noise = noisePower(output.buf, ref_clean, begin, end);
+  cout << "DiversityCombiner: reference noise=" << ref_noise
+       << " combined noise=" << out_noise << endl;
+  check(output.buf.size() + BLOCK_SIZE >= len,
+        "The combiner lost output samples");
+  check(out_noise < 0.7 * ref_noise, "The combined output is too noisy");
+}
+
+
+int main(int argc, char **argv)
+{
+  int opt;
+  while ((opt = getopt(argc, argv, "v:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'v':
+        voting_delay_ms = atoi(optarg);
+        break;
+      default:
+        cerr << "Usage: DiversityCombinerTest [-v voting delay ms]\n";
+        exit(1);
+    }
+  }
+
+  srand(4711);
+  testCrossCorrelator();
+  testDiversityCombiner();
+
+  cout << (errors == 0 ? "OK" : "FAIL") << endl;
+  return (errors == 0) ? 0 : 1;
+}
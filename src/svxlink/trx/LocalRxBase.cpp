@@ -59,6 +59,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncAudioCompressor.h>
 #include <AsyncAudioFifo.h>
 #include <AsyncAudioStreamStateDetector.h>
+#include <AsyncAudioProfiler.h>
+#include <AsyncAudioLatencyProbe.h>
 #include <AsyncUdpSocket.h>
 #include <common.h>
 
@@ -280,6 +282,7 @@ bool LocalRxBase::initialize(void)
   
     // Create a fifo buffer to handle large audio blocks
   input_fifo = new AudioFifo(1024);
+  AudioProfiler::setName(input_fifo, name() + " input fifo");
 //  input_fifo->setOverwrite(true);
   prev_src->registerSink(input_fifo);
   prev_src = input_fifo;
@@ -352,6 +355,7 @@ bool LocalRxBase::initialize(void)
   
     // Create a mute valve
   mute_valve = new AudioValve;
+  AudioProfiler::setName(mute_valve, name() + " mute valve");
   mute_valve->setOpen(true);
   siglevdet_splitter->addSink(mute_valve, true);
   prev_src = mute_valve;
@@ -539,6 +543,17 @@ bool LocalRxBase::initialize(void)
   prev_src->registerSink(sql_valve, true);
   prev_src = sql_valve;
 
+    // Audio streams start here when latency tracing is enabled. The samples
+    // inserted by the delay line below is compensated for.
+  if (AudioLatencyProbe::isEnabled())
+  {
+    AudioLatencyProbe *probe =
+        new AudioLatencyProbe(AudioLatencyProbe::ORIGIN, name(), name());
+    probe->setPositionOffset(delay_line_len * INTERNAL_SAMPLE_RATE / 1000);
+    prev_src->registerSink(probe, true);
+    prev_src = probe;
+  }
+
     // Create the state detector
   AudioStreamStateDetector *state_det = new AudioStreamStateDetector;
   state_det->sigStreamStateChanged.connect(
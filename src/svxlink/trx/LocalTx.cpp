@@ -67,6 +67,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncAudioFifo.h>
 #include <AsyncAudioInterpolator.h>
 #include <AsyncAudioAmp.h>
+#include <AsyncAudioProfiler.h>
+#include <AsyncAudioLatencyProbe.h>
 #include <common.h>
 
 
@@ -456,6 +458,7 @@ bool LocalTx::initialize(void)
     // We need a selector to choose if DTMF or normal audio should be
     // transmitted
   selector = new AudioSelector;
+  AudioProfiler::setName(selector, name + " selector");
   selector->addSource(prev_src);
   selector->enableAutoSelect(prev_src, 0);
   prev_src = selector;
@@ -491,6 +494,16 @@ bool LocalTx::initialize(void)
     prev_src = master_gain_stage;
   }
 
+    // Measure the latency up to the audio device. This must be done before
+    // the sample rate is converted.
+  if (AudioLatencyProbe::isEnabled())
+  {
+    AudioLatencyProbe *probe = new AudioLatencyProbe(
+        AudioLatencyProbe::MEASURE, name, name + " output");
+    prev_src->registerSink(probe, true);
+    prev_src = probe;
+  }
+
 #if (INTERNAL_SAMPLE_RATE != 16000)  
   if (audio_io->sampleRate() > 8000)
   {
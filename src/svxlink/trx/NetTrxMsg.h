@@ -35,11 +35,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <stdint.h>
+
 #include <cassert>
 #include <cstring>
 #include <iostream>
 #include <vector>
 #include <utility>
+#include <new>
 
 #include <gcrypt.h>
 
@@ -112,6 +115,126 @@ namespace NetTrxMsg
  *
  ****************************************************************************/
 
+/**
+@brief	A pool of recycled memory blocks for network messages
+@author Tobias Blomberg / SM0SVX
+@date   2017-05-27
+
+Network messages are created and destroyed at a high rate, a couple of
+messages for every audio block for each connected transceiver. To avoid
+the overhead of the heap allocator, memory for messages is taken from this
+pool. Blocks are grouped in size classes and freed blocks are kept in a
+free list for each size class so that they can be reused.
+The pool is not thread safe. Messages must only be created and deleted
+from the main thread.
+*/
+class MsgPool
+{
+  public:
+    /**
+     * @brief   Get the pool instance
+     * @return  Returns the one and only pool instance
+     */
+    static MsgPool &instance(void)
+    {
+      static MsgPool pool;
+      return pool;
+    }
+
+    /**
+     * @brief   Destructor
+     */
+    ~MsgPool(void)
+    {
+      for (unsigned i=0; i<NUM_SIZE_CLASSES; ++i)
+      {
+        for (size_t j=0; j<m_free[i].size(); ++j)
+        {
+          ::operator delete(m_free[i][j]);
+        }
+      }
+    }
+
+    /**
+     * @brief   Allocate a memory block
+     * @param   size The number of bytes to allocate
+     * @return  Returns a pointer to the allocated memory
+     */
+    void *alloc(size_t size)
+    {
+      unsigned size_class = (size + GRANULARITY - 1) / GRANULARITY;
+      Block *block;
+      if ((size_class < NUM_SIZE_CLASSES) && !m_free[size_class].empty())
+      {
+        block = m_free[size_class].back();
+        m_free[size_class].pop_back();
+        ++m_reused_cnt;
+      }
+      else
+      {
+        size_t block_size = (size_class < NUM_SIZE_CLASSES)
+                            ? size_class * GRANULARITY : size;
+        block = static_cast<Block*>(::operator new(sizeof(Block) + block_size));
+        block->size_class = size_class;
+        ++m_heap_cnt;
+      }
+      return block + 1;
+    }
+
+    /**
+     * @brief   Return a memory block to the pool
+     * @param   ptr A pointer previously returned by alloc
+     */
+    void free(void *ptr)
+    {
+      if (ptr == 0)
+      {
+        return;
+      }
+      Block *block = static_cast<Block*>(ptr) - 1;
+      if ((block->size_class < NUM_SIZE_CLASSES) &&
+          (m_free[block->size_class].size() < MAX_FREE_BLOCKS))
+      {
+        m_free[block->size_class].push_back(block);
+      }
+      else
+      {
+        ::operator delete(block);
+      }
+    }
+
+    /**
+     * @brief   Get the number of allocations served from the free lists
+     */
+    unsigned long reusedCount(void) const { return m_reused_cnt; }
+
+    /**
+     * @brief   Get the number of allocations served by the heap allocator
+     */
+    unsigned long heapCount(void) const { return m_heap_cnt; }
+
+  private:
+    static const size_t   GRANULARITY = 64;
+    static const unsigned NUM_SIZE_CLASSES = 4096 / GRANULARITY + 1;
+    static const size_t   MAX_FREE_BLOCKS = 64;
+
+    union Block
+    {
+      size_t  size_class;
+      double  align;
+    };
+
+    std::vector<Block*> m_free[NUM_SIZE_CLASSES];
+    unsigned long       m_reused_cnt;
+    unsigned long       m_heap_cnt;
+
+    MsgPool(void) : m_reused_cnt(0), m_heap_cnt(0) {}
+    MsgPool(const MsgPool&);
+    MsgPool& operator=(const MsgPool&);
+
+};  /* class MsgPool */
+
+
 #pragma pack(push, 1)
 
 /**
@@ -122,6 +245,11 @@ namespace NetTrxMsg
 class Msg
 {
   public:
+    /**
+     * @brief   The maximum size of a message, including the header
+     */
+    static const unsigned MAX_SIZE = 4096;
+
     /**
      * @brief 	Constuctor
      * @param 	type The message type
@@ -133,6 +261,27 @@ class Msg
      * @brief 	Destructor
      */
     ~Msg(void) {}
+
+    /**
+     * @brief   Allocate memory for a message from the message pool
+     * @param   size The size of the message object
+     */
+    static void *operator new(size_t size)
+    {
+      return MsgPool::instance().alloc(size);
+    }
+
+    /**
+     * @brief   Return the memory for a message to the message pool
+     * @param   ptr Pointer to the message memory
+     *
+     * The memory block itself keep track of its size class so messages may
+     * be deleted through a pointer to the base class.
+     */
+    static void operator delete(void *ptr)
+    {
+      MsgPool::instance().free(ptr);
+    }
   
     /**
      * @brief 	Get the message type
@@ -661,6 +810,44 @@ class MsgAllSamplesFlushed : public Msg
 #pragma pack(pop)
 
 
+/**
+@brief	Make sure that a received message is properly aligned
+
+Received messages are handled in place in the receive buffer of the
+connection so a message may start at any address. That is fine for the
+message members since all messages are packed, and so have an alignment of
+one, but the audio payload is handed to the audio decoders which may read it
+as an array of samples. On architectures that does not allow unaligned
+access, that would fail. Messages that are not aligned are therefore copied
+to an aligned buffer before being handled. Most messages are aligned so the
+copy is seldom needed.
+*/
+class MsgAligner
+{
+  public:
+    /**
+     * @brief 	Return an aligned version of a message
+     * @param 	msg The received message
+     * @return	Returns the message itself if it's aligned or else a copy
+     *
+     * The returned copy is valid until the next call to this function.
+     */
+    Msg *align(Msg *msg)
+    {
+      if (reinterpret_cast<uintptr_t>(msg) % sizeof(m_buf[0]) == 0)
+      {
+        return msg;
+      }
+      memcpy(m_buf, msg, msg->size());
+      return reinterpret_cast<Msg*>(m_buf);
+    }
+
+  private:
+    uint64_t m_buf[Msg::MAX_SIZE / sizeof(uint64_t)];
+
+};  /* class MsgAligner */
+
+
 
 } /* namespace */
 
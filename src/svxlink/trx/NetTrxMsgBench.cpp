@@ -0,0 +1,259 @@
+/*
+ * Throughput benchmark for the remote transceiver network message path.
+ *
+ * A server, emulating a RemoteTrx, and a NetTrxTcpClient, the class used by
+ * SvxLink to talk to a RemoteTrx, are connected over the loopback
+ * interface. After the protocol version and authentication handshake, the
+ * server send a stream of audio and signal level messages, emulating a
+ * number of remote receivers. The messages are parsed in place by the real
+ * NetTrxTcpClient code and delivered through its msgReceived signal. The
+ * throughput and the message pool statistics are printed when all messages
+ * have been received.
+ *
+ * Usage: NetTrxMsgBench [-n blocks] [-b blocks per iteration] [-s audio size]
+ *                       [-u]
+ *
+ *   -u  Unbatched, write each message using its own system call
+ */
+
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <deque>
+
+#include <AsyncCppApplication.h>
+#include <AsyncTcpServer.h>
+
+#include "NetTrxMsg.h"
+#include "NetTrxTcpClient.h"
+
+using namespace std;
+using namespace Async;
+using namespace NetTrxMsg;
+
+
+static const char *PORT_STR = "5299";
+static const uint16_t PORT = 5299;
+static const size_t SEND_QUEUE_SIZE = 256 * 1024;
+
+
+class Receiver : public sigc::trackable
+{
+  public:
+    Receiver(unsigned long expected_msgs)
+      : con(NetTrxTcpClient::instance("127.0.0.1", PORT)),
+        expected_msgs(expected_msgs), msg_cnt(0), byte_cnt(0), start()
+    {
+      con->isReady.connect(sigc::mem_fun(*this, &Receiver::onReady));
+      con->msgReceived.connect(sigc::mem_fun(*this, &Receiver::onMsgReceived));
+      con->connect();
+    }
+
+    ~Receiver(void)
+    {
+      con->deleteInstance();
+    }
+
+  private:
+    NetTrxTcpClient *con;
+    unsigned long   expected_msgs;
+    unsigned long   msg_cnt;
+    unsigned long   byte_cnt;
+    struct timeval  start;
+
+    void onReady(bool is_ready)
+    {
+      if (!is_ready)
+      {
+        cerr << "*** ERROR: Disconnected: "
+             << TcpConnection::disconnectReasonStr(con->disconnectReason())
+             << endl;
+        exit(1);
+      }
+      gettimeofday(&start, NULL);
+    }
+
+    void onMsgReceived(Msg *msg)
+    {
+      byte_cnt += msg->size();
+      if (++msg_cnt == expected_msgs)
+      {
+        printResult();
+        Application::app().quit();
+      }
+    }
+
+    void printResult(void)
+    {
+      struct timeval now, diff;
+      gettimeofday(&now, NULL);
+      timersub(&now, &start, &diff);
+      double secs = diff.tv_sec + diff.tv_usec / 1000000.0;
+      cout << "Messages:        " << msg_cnt << endl;
+      cout << "Bytes:           " << byte_cnt << endl;
+      cout << "Time:            " << static_cast<unsigned>(secs * 1000.0)
+           << "ms" << endl;
+      cout << "Messages/s:      " << static_cast<unsigned long>(msg_cnt / secs)
+           << endl;
+      cout << "kB/s:            "
+           << static_cast<unsigned long>(byte_cnt / secs / 1024.0) << endl;
+      cout << "Pool reused:     " << MsgPool::instance().reusedCount()
+           << endl;
+      cout << "Pool heap alloc: " << MsgPool::instance().heapCount() << endl;
+    }
+};
+
+
+class Sender : public sigc::trackable
+{
+  public:
+    Sender(unsigned long blocks, unsigned blocks_per_iter,
+           unsigned audio_size, bool batched)
+      : server(PORT_STR), con(0), blocks_left(blocks),
+        blocks_per_iter(blocks_per_iter), audio(audio_size), batched(batched)
+    {
+      server.clientConnected.connect(
+          sigc::mem_fun(*this, &Sender::onClientConnected));
+    }
+
+  private:
+    TcpServer<>             server;
+    TcpConnection           *con;
+    unsigned long           blocks_left;
+    unsigned                blocks_per_iter;
+    std::vector<char>       audio;
+    bool                    batched;
+    std::deque<Msg*>        outq;
+
+    void onClientConnected(TcpConnection *incoming_con)
+    {
+      con = incoming_con;
+      con->setSendQueueSize(SEND_QUEUE_SIZE);
+      con->dataReceived.connect(sigc::mem_fun(*this, &Sender::onDataReceived));
+      con->disconnected.connect(sigc::mem_fun(*this, &Sender::onDisconnected));
+      con->sendBufferFull.connect(
+          sigc::mem_fun(*this, &Sender::onSendBufferFull));
+
+        // No authentication key is used so authentication is done directly
+      outq.push_back(new MsgProtoVer);
+      outq.push_back(new MsgAuthOk);
+      sendIteration();
+    }
+
+    int onDataReceived(TcpConnection *, void *, int size)
+    {
+        // Ignore heartbeats from the client
+      return size;
+    }
+
+    void onDisconnected(TcpConnection *, TcpConnection::DisconnectReason reason)
+    {
+      cerr << "*** ERROR: Client disconnected: "
+           << TcpConnection::disconnectReasonStr(reason) << endl;
+      exit(1);
+    }
+
+    void onSendBufferFull(bool is_full)
+    {
+      if (!is_full)
+      {
+        sendIteration();
+      }
+    }
+
+    void sendIteration(void)
+    {
+      if (batched)
+      {
+        con->cork();
+      }
+      for (unsigned i=0; outq.empty() && (i<blocks_per_iter) && (blocks_left>0);
+           ++i)
+      {
+        --blocks_left;
+        outq.push_back(new MsgAudio(&audio[0], audio.size()));
+        outq.push_back(new MsgSiglevUpdate(0.0f, i));
+      }
+      while (!outq.empty())
+      {
+        Msg *msg = outq.front();
+        int written = con->write(msg, msg->size());
+        if (written == 0)
+        {
+            // The send queue is full. Continue on sendBufferFull(false).
+          break;
+        }
+        if (written != static_cast<int>(msg->size()))
+        {
+          cerr << "*** ERROR: Write failed\n";
+          exit(1);
+        }
+        outq.pop_front();
+        delete msg;
+      }
+      if (batched)
+      {
+        con->uncork();
+      }
+      if (outq.empty() && (blocks_left > 0))
+      {
+        Application::app().runTask(
+            sigc::mem_fun(*this, &Sender::sendIteration));
+      }
+    }
+};
+
+
+int main(int argc, char **argv)
+{
+  unsigned long blocks = 200000;
+  unsigned blocks_per_iter = 8;
+  unsigned audio_size = 160;
+  bool batched = true;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "n:b:s:u")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        blocks = strtoul(optarg, NULL, 10);
+        break;
+      case 'b':
+        blocks_per_iter = strtoul(optarg, NULL, 10);
+        break;
+      case 's':
+        audio_size = strtoul(optarg, NULL, 10);
+        break;
+      case 'u':
+        batched = false;
+        break;
+      default:
+        cerr << "Usage: " << argv[0]
+             << " [-n blocks] [-b blocks per iteration] [-s audio size] [-u]\n";
+        exit(1);
+    }
+  }
+  if ((blocks == 0) || (blocks_per_iter == 0) ||
+      (audio_size == 0) || (audio_size > MsgAudio::BUFSIZE))
+  {
+    cerr << "*** ERROR: Illegal argument\n";
+    exit(1);
+  }
+
+  cout << "Sending " << blocks << " blocks of " << audio_size
+       << " bytes audio, " << blocks_per_iter << " blocks per iteration, "
+       << (batched ? "batched" : "unbatched") << endl;
+
+  CppApplication app;
+  Sender sender(blocks, blocks_per_iter, audio_size, batched);
+  Receiver receiver(2 * blocks);
+  app.exec();
+
+  return 0;
+}
+
@@ -43,6 +43,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <AsyncTimer.h>
+#include <AsyncApplication.h>
 
 
 /****************************************************************************
@@ -205,14 +206,18 @@ void NetTrxTcpClient::sendMsg(Msg *msg)
 
 NetTrxTcpClient::NetTrxTcpClient(const std::string& remote_host,
       	      	      	      	 uint16_t remote_port, size_t recv_buf_len)
-  : TcpClient<>(remote_host, remote_port, recv_buf_len), recv_cnt(0),
-    recv_exp(0), reconnect_timer(0), last_msg_timestamp(), heartbeat_timer(0),
-    user_cnt(0), state(STATE_DISC), disc_reason(DR_SYSTEM_ERROR)
+  : TcpClient<>(remote_host, remote_port, recv_buf_len), reconnect_timer(0),
+    last_msg_timestamp(), heartbeat_timer(0), user_cnt(0), state(STATE_DISC),
+    disc_reason(DR_SYSTEM_ERROR), send_batch_pending(false)
 {
   connected.connect(mem_fun(*this, &NetTrxTcpClient::tcpConnected));
   disconnected.connect(mem_fun(*this, &NetTrxTcpClient::tcpDisconnected));
   dataReceived.connect(mem_fun(*this, &NetTrxTcpClient::tcpDataReceived));
 
+    // Queue bursts in user space instead of disconnecting when the kernel
+    // send buffer is temporarily full
+  setSendQueueSize(SEND_QUEUE_SIZE);
+
   reconnect_timer = new Timer(20000);
   reconnect_timer->setEnable(false);
   reconnect_timer->expired.connect(mem_fun(*this, &NetTrxTcpClient::reconnect));
@@ -242,8 +247,6 @@ NetTrxTcpClient::~NetTrxTcpClient(void)
 
 void NetTrxTcpClient::tcpConnected(void)
 {
-  recv_cnt = 0;
-  recv_exp = sizeof(Msg);
   gettimeofday(&last_msg_timestamp, NULL);
   heartbeat_timer->setEnable(true);
   state = STATE_VER_WAIT;
@@ -254,7 +257,6 @@ void NetTrxTcpClient::tcpDisconnected(TcpConnection *con,
       	      	      	    TcpConnection::DisconnectReason reason)
 {
   disc_reason = reason;
-  recv_exp = 0;
   state = STATE_DISC;
   reconnect_timer->setEnable(true);
   heartbeat_timer->setEnable(false);
@@ -266,65 +268,37 @@ int NetTrxTcpClient::tcpDataReceived(TcpConnection *con, void *data, int size)
 {
   //cout << "NetTrxTcpClient::tcpDataReceived: size=" << size << endl;
   
-  //Msg *msg = reinterpret_cast<Msg*>(data);
-  //cout << "Received a TCP message with type " << msg->type()
-  //     << " and size " << msg->size() << endl;
-  
-  int orig_size = size;
-  
+    // Complete messages are handled in place in the receive buffer of the
+    // connection. A trailing partial message is left in the connection
+    // receive buffer and will be presented again when more data arrive.
+    // Messages that are not aligned are copied before being handled.
   char *buf = static_cast<char*>(data);
-  while (size > 0)
+  int processed = 0;
+  while (size - processed >= static_cast<int>(sizeof(Msg)))
   {
-    unsigned read_cnt = min(static_cast<unsigned>(size), recv_exp-recv_cnt);
-    if (recv_cnt+read_cnt > sizeof(recv_buf))
+    Msg *msg = reinterpret_cast<Msg*>(buf + processed);
+    if ((msg->size() < sizeof(Msg)) || (msg->size() > Msg::MAX_SIZE))
     {
-      cerr << "*** ERROR: TCP receive buffer overflow. Disconnecting from "
+      cerr << "*** ERROR: Illegal message header received. Illegal message "
+           << "length (" << msg->size() << "). Disconnecting from "
            << remoteHost().toString() << ":" << remotePort() << "...\n";
       con->disconnect();
       disconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
-      return orig_size;
+      return size;
     }
-    memcpy(recv_buf+recv_cnt, buf, read_cnt);
-    size -= read_cnt;
-    recv_cnt += read_cnt;
-    buf += read_cnt;
-    
-    if (recv_cnt == recv_exp)
+    if (static_cast<int>(msg->size()) > size - processed)
     {
-      if (recv_exp == sizeof(Msg))
-      {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-	if (msg->size() == sizeof(Msg))
-	{
-	  handleMsg(msg);
-	  recv_cnt = 0;
-	  recv_exp = sizeof(Msg);
-	}
-	else if (msg->size() > sizeof(Msg))
-	{
-      	  recv_exp = msg->size();
-	}
-	else
-	{
-	  cerr << "*** ERROR: Illegal message header received. Header length "
-	       << "too small (" << msg->size() << "). Disconnecting from "
-               << remoteHost().toString() << ":" << remotePort() << "...\n";
-	  con->disconnect();
-	  disconnected(con, TcpConnection::DR_ORDERED_DISCONNECT);
-	  return orig_size;
-	}
-      }
-      else
-      {
-      	Msg *msg = reinterpret_cast<Msg*>(recv_buf);
-	handleMsg(msg);
-	recv_cnt = 0;
-	recv_exp = sizeof(Msg);
-      }
+      break;
+    }
+    processed += msg->size();
+    handleMsg(msg_aligner.align(msg));
+    if (!isConnected())
+    {
+      return size;
     }
   }
   
-  return orig_size;
+  return processed;
   
 } /* NetTrxTcpClient::tcpDataReceived */
 
@@ -467,6 +441,15 @@ void NetTrxTcpClient::sendMsgP(Msg *msg)
 {
   assert(isConnected());
 
+    // Messages sent during one main loop iteration are collected and
+    // written to the socket using one system call
+  if (!send_batch_pending)
+  {
+    send_batch_pending = true;
+    cork();
+    Application::app().runTask(
+        mem_fun(*this, &NetTrxTcpClient::flushSendBatch));
+  }
   int written = write(msg, msg->size());
   if (written != static_cast<int>(msg->size()))
   {
@@ -488,6 +471,13 @@ void NetTrxTcpClient::sendMsgP(Msg *msg)
 } /* NetTrxTcpClient::sendMsgP */
 
 
+void NetTrxTcpClient::flushSendBatch(void)
+{
+  send_batch_pending = false;
+  uncork();
+} /* NetTrxTcpClient::flushSendBatch */
+
+
 
 /*
  * This file has not been truncated
@@ -200,12 +200,10 @@ class NetTrxTcpClient : public Async::TcpClient<>
       STATE_DISC, STATE_VER_WAIT, STATE_AUTH_WAIT, STATE_READY
     } State;
     
-    static const int RECV_BUF_SIZE = 4096;
+    static const int RECV_BUF_SIZE = 16384;
+    static const size_t SEND_QUEUE_SIZE = 256 * 1024;
     static Clients clients;
 
-    char      	    recv_buf[RECV_BUF_SIZE];
-    unsigned        recv_cnt;
-    unsigned        recv_exp;
     Async::Timer    *reconnect_timer;
     struct timeval  last_msg_timestamp;
     Async::Timer    *heartbeat_timer;
@@ -213,6 +211,8 @@ class NetTrxTcpClient : public Async::TcpClient<>
     std::string     auth_key;
     State           state;
     DiscReason      disc_reason;
+    bool            send_batch_pending;
+    NetTrxMsg::MsgAligner msg_aligner;
     
     NetTrxTcpClient(const NetTrxTcpClient&);
     NetTrxTcpClient& operator=(const NetTrxTcpClient&);
@@ -225,6 +225,7 @@ class NetTrxTcpClient : public Async::TcpClient<>
     void heartbeat(Async::Timer *t);
     void localDisconnect(void);
     void sendMsgP(NetTrxMsg::Msg *msg);
+    void flushSendBatch(void);
 
 };  /* class NetTrxTcpClient */
 
@@ -36,6 +36,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <fstream>
 #include <cstring>
 #include <sstream>
+#include <cerrno>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#ifdef HAS_GPIO_CHARDEV_SUPPORT
+#include <linux/gpio.h>
+#endif
 
 
 /****************************************************************************
@@ -114,13 +122,19 @@ using namespace Async;
  ****************************************************************************/
 
 PttGpio::PttGpio(void)
-  : gpio_path("/sys/class/gpio"), active_low(false)
+  : gpio_path("/sys/class/gpio"), active_low(false), fd(-1),
+    use_chardev(false)
 {
 } /* PttGpio::PttGpio */
 
 
 PttGpio::~PttGpio(void)
 {
+  if (fd >= 0)
+  {
+    close(fd);
+    fd = -1;
+  }
 } /* PttGpio::~PttGpio */
 
 
@@ -140,16 +154,67 @@ bool PttGpio::initialize(Async::Config &cfg, const std::string name)
     gpio_pin.erase(0, 1);
   }
 
+  string gpio_chip;
+  cfg.getValue(name, "GPIO_CHIP", gpio_chip);
+  if (!gpio_chip.empty())
+  {
+#ifdef HAS_GPIO_CHARDEV_SUPPORT
+    char *endptr = 0;
+    unsigned long line = strtoul(gpio_pin.c_str(), &endptr, 10);
+    if (gpio_pin.empty() || (*endptr != '\0'))
+    {
+      cerr << "*** ERROR: " << name << "/PTT_PIN must be a line number when "
+           << name << "/GPIO_CHIP is set\n";
+      return false;
+    }
+
+    int chip_fd = open(gpio_chip.c_str(), O_RDONLY);
+    if (chip_fd < 0)
+    {
+      cerr << "*** ERROR: Could not open GPIO chip " << gpio_chip
+           << " specified in " << name << "/GPIO_CHIP: "
+           << strerror(errno) << endl;
+      return false;
+    }
+
+    struct gpiohandle_request req;
+    memset(&req, 0, sizeof(req));
+    req.lineoffsets[0] = line;
+    req.lines = 1;
+    req.flags = GPIOHANDLE_REQUEST_OUTPUT;
+    req.default_values[0] = active_low ? 1 : 0;
+    strncpy(req.consumer_label, "svxlink_ptt",
+            sizeof(req.consumer_label) - 1);
+    int ret = ioctl(chip_fd, GPIO_GET_LINEHANDLE_IOCTL, &req);
+    int err = errno;
+    close(chip_fd);
+    if (ret < 0)
+    {
+      cerr << "*** ERROR: Could not request line " << line
+           << " on GPIO chip " << gpio_chip << " for output in transmitter "
+           << name << ": " << strerror(err) << endl;
+      return false;
+    }
+    fd = req.fd;
+    use_chardev = true;
+    return true;
+#else
+    cerr << "*** ERROR: " << name << "/GPIO_CHIP is set but SvxLink was "
+            "compiled without GPIO character device support\n";
+    return false;
+#endif
+  }
+
   stringstream ss;
   ss << gpio_path << "/" << gpio_pin << "/value";
-  ofstream gpioval(ss.str().c_str());
-  if (gpioval.fail())
+  fd = open(ss.str().c_str(), O_WRONLY);
+  if (fd < 0)
   {
     cerr << "*** ERROR: Could not open GPIO " << ss.str()
-         << " for writing in transmitter " << name << ".\n";
+         << " for writing in transmitter " << name << ": "
+         << strerror(errno) << endl;
     return false;
   }
-  gpioval.close();
 
   return true;
 } /* PttGpio::initialize */
@@ -159,17 +224,19 @@ bool PttGpio::setTxOn(bool tx_on)
 {
   //cerr << "### PttGpio::setTxOn(" << (tx_on ? "true" : "false") << ")\n";
 
-  stringstream ss;
-  ss << gpio_path << "/" << gpio_pin << "/value";
-  ofstream gpioval(ss.str().c_str());
-  if (gpioval.fail())
+  bool value = tx_on ^ active_low;
+
+#ifdef HAS_GPIO_CHARDEV_SUPPORT
+  if (use_chardev)
   {
-    return false;
+    struct gpiohandle_data data;
+    memset(&data, 0, sizeof(data));
+    data.values[0] = value ? 1 : 0;
+    return ioctl(fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) >= 0;
   }
-  gpioval << (tx_on ^ active_low ? 1 : 0);
-  gpioval.close();
+#endif
 
-  return true;
+  return pwrite(fd, value ? "1" : "0", 1, 0) == 1;
 } /* PttGpio::setTxOn */
 
 
@@ -104,6 +104,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 @brief	A PTT hardware controller using a pin in a GPIO port
 @author Tobias Blomberg / SM0SVX
 @date   2014-01-26
+
+The pin is either controlled through the sysfs value file of the pin or, if
+GPIO_CHIP is set, through a line handle requested from the GPIO character
+device. In both cases the file descriptor is kept open so that switching the
+PTT only cost a single system call.
 */
 class PttGpio : public Ptt
 {
@@ -144,6 +149,8 @@ class PttGpio : public Ptt
     std::string gpio_path;
     std::string gpio_pin;
     bool        active_low;
+    int         fd;
+    bool        use_chardev;
 
     PttGpio(const PttGpio&);
     PttGpio& operator=(const PttGpio&);
@@ -0,0 +1,187 @@
+/*
+ * Test for the IQ ingest path in the RtlSdr class.
+ *
+ * A fake RtlSdr subclass is fed with a known byte pattern from a producer
+ * thread, the same way the librtlsdr callback thread feeds RtlUsb. The IQ
+ * blocks delivered on the main thread are checked to contain exactly the
+ * samples written, in order. Some buffer handles are kept for a while by
+ * the consumer so that buffers are returned to the pool out of order. Build
+ * with -fsanitize=thread to also check the ingest thread for data races.
+ *
+ * Usage: RtlIqIngestTest [-n blocks]
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <deque>
+
+#include <AsyncCppApplication.h>
+
+#include "RtlSdr.h"
+
+using namespace std;
+using namespace Async;
+
+
+static const unsigned SAMPLE_RATE = 960000;
+static const size_t   WRITE_SIZE = 16384 * 3;
+static const unsigned PATTERN_LEN = 251;
+static const size_t   HOLD_CNT = 5;
+
+static unsigned blocks = 300;
+
+
+class FakeRtl : public RtlSdr
+{
+  public:
+    FakeRtl(void) : ended(false) {}
+
+    bool streamEnded(void) const { return ended; }
+
+    bool start(void)
+    {
+      if (!startIqIngest())
+      {
+        return false;
+      }
+      return pthread_create(&producer, NULL, startProducer, this) == 0;
+    }
+
+    void join(void)
+    {
+      pthread_join(producer, NULL);
+    }
+
+    virtual bool isReady(void) const { return true; }
+    virtual const std::string displayName(void) const { return "FakeRtl"; }
+
+  protected:
+    virtual void handleSetTunerIfGain(uint16_t stage, int16_t gain) {}
+    virtual void handleSetCenterFq(uint32_t fq) {}
+    virtual void handleSetSampleRate(uint32_t rate) {}
+    virtual void handleSetGainMode(uint32_t mode) {}
+    virtual void handleSetGain(int32_t gain) {}
+    virtual void handleSetFqCorr(int corr) {}
+    virtual void handleEnableTestMode(bool enable) {}
+    virtual void handleEnableDigitalAgc(bool enable) {}
+
+    virtual void handleIqStreamEnded(void)
+    {
+      ended = true;
+      stopIqIngest();
+      Application::app().quit();
+    }
+
+  private:
+    pthread_t producer;
+    bool      ended;
+
+    static void *startProducer(void *data)
+    {
+      static_cast<FakeRtl*>(data)->produce();
+      return NULL;
+    }
+
+    void produce(void)
+    {
+      vector<uint8_t> buf(WRITE_SIZE);
+      unsigned cnt = 0;
+      for (unsigned i = 0; i < blocks; ++i)
+      {
+        for (size_t j = 0; j < buf.size(); ++j)
+        {
+          buf[j] = cnt++ % PATTERN_LEN;
+        }
+        handleIq(reinterpret_cast<const complex<uint8_t>*>(&buf[0]),
+                 buf.size() / 2);
+        usleep(2000);
+      }
+        // Give the ingest thread time to deliver the last block
+      usleep(100000);
+      iqStreamEnded();
+    }
+
+};  /* class FakeRtl */
+
+
+static unsigned expected = 0;
+static unsigned samples = 0;
+static unsigned errors = 0;
+static deque<RtlSdr::IqBuffer> held;
+
+
+static float expectedValue(void)
+{
+  return (static_cast<float>(expected++ % PATTERN_LEN) - 127.5f) *
+         (1.0f / 127.5f);
+}
+
+
+static void onIqReceived(const RtlSdr::IqBuffer &buf)
+{
+  const vector<RtlSdr::Sample> &s = buf.samples();
+  for (size_t i = 0; i < s.size(); ++i)
+  {
+    float i_val = expectedValue();
+    float q_val = expectedValue();
+    if ((s[i].real() != i_val) || (s[i].imag() != q_val))
+    {
+      ++errors;
+    }
+  }
+  samples += s.size();
+
+    // Hold on to a few buffers so that they are recycled out of order
+  held.push_back(buf);
+  if (held.size() > HOLD_CNT)
+  {
+    held.pop_front();
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  int opt;
+  while ((opt = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        blocks = atoi(optarg);
+        break;
+      default:
+        cerr << "Usage: RtlIqIngestTest [-n blocks]\n";
+        exit(1);
+    }
+  }
+
+  CppApplication app;
+
+  FakeRtl rtl;
+  rtl.setSampleRate(SAMPLE_RATE);
+  rtl.iqReceived.connect(sigc::ptr_fun(onIqReceived));
+  if (!rtl.start())
+  {
+    cerr << "*** ERROR: Could not start the IQ ingest\n";
+    exit(1);
+  }
+  app.exec();
+  rtl.join();
+  held.clear();
+
+  unsigned expected_samples = blocks * WRITE_SIZE / 2;
+  cout << "Samples:  " << samples << " of " << expected_samples << endl;
+  cout << "Errors:   " << errors << endl;
+  cout << "Ended:    " << (rtl.streamEnded() ? "yes" : "no") << endl;
+
+  bool ok = (samples == expected_samples) && (errors == 0) &&
+            rtl.streamEnded();
+  cout << (ok ? "OK" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -32,8 +32,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
 #include <cstring>
 #include <cstdlib>
+#include <ctime>
+#include <cassert>
 #include <iterator>
 #include <algorithm>
 #include <iostream>
@@ -45,6 +53,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <AsyncAudioSampleConv.h>
+#include <AsyncFdWatch.h>
 
 
 /****************************************************************************
@@ -64,6 +74,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 using namespace std;
+using namespace Async;
 
 
 
@@ -81,6 +92,306 @@ using namespace std;
  *
  ****************************************************************************/
 
+namespace {
+
+  /**
+   * A lock free queue for one producer thread and one consumer thread
+   */
+  template <typename T>
+  class SpscQueue
+  {
+    public:
+      explicit SpscQueue(size_t size) : buf(size + 1), head(0), tail(0) {}
+
+      bool push(const T& item)
+      {
+        size_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        size_t next = (h + 1) % buf.size();
+        if (next == __atomic_load_n(&tail, __ATOMIC_ACQUIRE))
+        {
+          return false;
+        }
+        buf[h] = item;
+        __atomic_store_n(&head, next, __ATOMIC_RELEASE);
+        return true;
+      }
+
+      bool pop(T& item)
+      {
+        size_t t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+        if (t == __atomic_load_n(&head, __ATOMIC_ACQUIRE))
+        {
+          return false;
+        }
+        item = buf[t];
+        __atomic_store_n(&tail, (t + 1) % buf.size(), __ATOMIC_RELEASE);
+        return true;
+      }
+
+    private:
+      vector<T> buf;
+      size_t    head;
+      size_t    tail;
+  };
+
+}; /* anonymous namespace */
+
+
+struct RtlSdr::IqBlock
+{
+  vector<Sample>  samples;
+  unsigned        ref_cnt;
+  bool            full_scale;
+  IqIngest        *owner;
+};
+
+
+/*
+ * The IQ ingest take raw 8 bit samples from the thread reading the dongle,
+ * through a lock free byte ring buffer, and convert them to floating point
+ * blocks in a worker thread. The blocks are handed over to the main thread
+ * through a lock free queue and a pipe is used to wake the main thread up.
+ * Blocks released by the consumers are returned to the worker thread
+ * through another lock free queue so no memory is allocated per block once
+ * the pool has been filled.
+ */
+class RtlSdr::IqIngest : public sigc::trackable
+{
+  public:
+    IqIngest(RtlSdr& rtl)
+      : rtl(rtl), block_size(0), running(false), do_exit(0), thread(),
+        raw_head(0), raw_tail(0), free_blocks(MAX_IQ_BLOCKS),
+        ready_blocks(MAX_IQ_BLOCKS), watch(0), wakeup_pending(0),
+        stream_ended(0), dropped_bytes(0), last_drop_print(0)
+    {
+      sem_init(&raw_sem, 0, 0);
+      int r = pipe(signal_pipe);
+      assert(r == 0);
+      fcntl(signal_pipe[0], F_SETFL, O_NONBLOCK);
+      fcntl(signal_pipe[1], F_SETFL, O_NONBLOCK);
+      watch = new FdWatch(signal_pipe[0], FdWatch::FD_WATCH_RD);
+      watch->activity.connect(mem_fun(*this, &IqIngest::onWakeup));
+    }
+
+    ~IqIngest(void)
+    {
+      stop();
+      delete watch;
+      close(signal_pipe[0]);
+      close(signal_pipe[1]);
+      sem_destroy(&raw_sem);
+      for (vector<IqBlock*>::iterator it=all_blocks.begin();
+           it!=all_blocks.end(); ++it)
+      {
+        assert((*it)->ref_cnt == 0);
+        delete *it;
+      }
+    }
+
+    bool isRunning(void) const
+    {
+      return __atomic_load_n(&running, __ATOMIC_ACQUIRE);
+    }
+    size_t blockSize(void) const { return block_size; }
+
+    bool start(size_t new_block_size)
+    {
+      assert(!isRunning());
+      block_size = new_block_size;
+      raw_buf.resize(RAW_BLOCKS * block_size);
+      raw_head = 0;
+      raw_tail = 0;
+      do_exit = 0;
+      stream_ended = 0;
+      int r = pthread_create(&thread, NULL, startWorker, this);
+      if (r != 0)
+      {
+        cerr << "*** ERROR: Failed to create RTL IQ ingest thread: "
+             << strerror(r) << endl;
+        return false;
+      }
+      __atomic_store_n(&running, true, __ATOMIC_RELEASE);
+      return true;
+    }
+
+    void stop(void)
+    {
+      if (!isRunning())
+      {
+        return;
+      }
+      __atomic_store_n(&do_exit, 1, __ATOMIC_SEQ_CST);
+      sem_post(&raw_sem);
+      int r = pthread_join(thread, NULL);
+      if (r != 0)
+      {
+        cerr << "*** WARNING: Failed to join the RTL IQ ingest thread: "
+             << strerror(r) << endl;
+      }
+      __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+      __atomic_store_n(&stream_ended, 0, __ATOMIC_SEQ_CST);
+      IqBlock *blk;
+      while (ready_blocks.pop(blk))
+      {
+        recycle(blk);
+      }
+    }
+
+    void write(const uint8_t *data, size_t len)
+    {
+      if (!isRunning())
+      {
+        return;
+      }
+      size_t head = __atomic_load_n(&raw_head, __ATOMIC_RELAXED);
+      size_t tail = __atomic_load_n(&raw_tail, __ATOMIC_ACQUIRE);
+      size_t cap = raw_buf.size();
+      if (len > cap - (head - tail))
+      {
+        __atomic_fetch_add(&dropped_bytes, len, __ATOMIC_RELAXED);
+        return;
+      }
+      size_t pos = head % cap;
+      size_t first = min(len, cap - pos);
+      memcpy(&raw_buf[pos], data, first);
+      memcpy(&raw_buf[0], data + first, len - first);
+      __atomic_store_n(&raw_head, head + len, __ATOMIC_RELEASE);
+      if ((head + len) / block_size != head / block_size)
+      {
+        sem_post(&raw_sem);
+      }
+    }
+
+    void streamEnded(void)
+    {
+      __atomic_store_n(&stream_ended, 1, __ATOMIC_SEQ_CST);
+      wakeup();
+    }
+
+    void recycle(IqBlock *blk)
+    {
+      bool pushed = free_blocks.push(blk);
+      assert(pushed);
+      (void)pushed;
+    }
+
+  private:
+    static const size_t RAW_BLOCKS = 16;
+    static const size_t MAX_IQ_BLOCKS = 32;
+
+    RtlSdr&             rtl;
+    size_t              block_size;
+    bool                running;
+    int                 do_exit;
+    pthread_t           thread;
+    sem_t               raw_sem;
+    vector<uint8_t>     raw_buf;
+    size_t              raw_head;
+    size_t              raw_tail;
+    SpscQueue<IqBlock*> free_blocks;
+    SpscQueue<IqBlock*> ready_blocks;
+    vector<IqBlock*>    all_blocks;
+    int                 signal_pipe[2];
+    FdWatch             *watch;
+    int                 wakeup_pending;
+    int                 stream_ended;
+    size_t              dropped_bytes;
+    time_t              last_drop_print;
+
+    static void *startWorker(void *data)
+    {
+      reinterpret_cast<IqIngest*>(data)->worker();
+      return NULL;
+    }
+
+    void worker(void)
+    {
+      size_t cap = raw_buf.size();
+      while (__atomic_load_n(&do_exit, __ATOMIC_SEQ_CST) == 0)
+      {
+        size_t tail = __atomic_load_n(&raw_tail, __ATOMIC_RELAXED);
+        size_t head = __atomic_load_n(&raw_head, __ATOMIC_ACQUIRE);
+        if (head - tail < block_size)
+        {
+          while ((sem_wait(&raw_sem) == -1) && (errno == EINTR));
+          continue;
+        }
+
+        IqBlock *blk = 0;
+        if (!free_blocks.pop(blk) && (all_blocks.size() < MAX_IQ_BLOCKS))
+        {
+          blk = new IqBlock;
+          blk->owner = this;
+          all_blocks.push_back(blk);
+        }
+        if (blk != 0)
+        {
+          blk->samples.resize(block_size / 2);
+          blk->ref_cnt = 0;
+          blk->full_scale = AudioSampleConv::u8ToFloat(
+              reinterpret_cast<float*>(&blk->samples[0]),
+              &raw_buf[tail % cap], block_size);
+          bool pushed = ready_blocks.push(blk);
+          assert(pushed);
+          (void)pushed;
+          wakeup();
+        }
+        else
+        {
+            // All blocks are held by the consumers
+          __atomic_fetch_add(&dropped_bytes, block_size, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&raw_tail, tail + block_size, __ATOMIC_RELEASE);
+      }
+    }
+
+    void wakeup(void)
+    {
+      if (__atomic_exchange_n(&wakeup_pending, 1, __ATOMIC_SEQ_CST) == 0)
+      {
+        if (::write(signal_pipe[1], "S", 1) != 1)
+        {
+            // The pipe is full so the main thread will wake up anyway
+        }
+      }
+    }
+
+    void onWakeup(FdWatch *w)
+    {
+      char buf[64];
+      while (read(signal_pipe[0], buf, sizeof(buf)) > 0);
+      __atomic_store_n(&wakeup_pending, 0, __ATOMIC_SEQ_CST);
+
+      size_t dropped = __atomic_exchange_n(&dropped_bytes, 0,
+                                           __ATOMIC_RELAXED);
+      if (dropped > 0)
+      {
+        time_t now = time(NULL);
+        if (now - last_drop_print >= 10)
+        {
+          cerr << "*** WARNING: " << dropped / 2 << " IQ samples lost on "
+                  "Rtl tuner " << rtl.displayName()
+               << ". The CPU may be overloaded.\n";
+          last_drop_print = now;
+        }
+      }
+
+      IqBlock *blk;
+      while (isRunning() && ready_blocks.pop(blk))
+      {
+        rtl.deliverIq(blk);
+      }
+
+      if (__atomic_exchange_n(&stream_ended, 0, __ATOMIC_SEQ_CST) != 0)
+      {
+        rtl.handleIqStreamEnded();
+      }
+    }
+
+    IqIngest(const IqIngest&);
+    IqIngest& operator=(const IqIngest&);
+};
+
 
 
 /****************************************************************************
@@ -114,13 +425,61 @@ using namespace std;
  *
  ****************************************************************************/
 
+RtlSdr::IqBuffer::IqBuffer(const IqBuffer& other)
+  : blk(other.blk)
+{
+  if (blk != 0)
+  {
+    blk->ref_cnt += 1;
+  }
+} /* RtlSdr::IqBuffer::IqBuffer */
+
+
+RtlSdr::IqBuffer& RtlSdr::IqBuffer::operator=(const IqBuffer& other)
+{
+  if (other.blk != 0)
+  {
+    other.blk->ref_cnt += 1;
+  }
+  release();
+  blk = other.blk;
+  return *this;
+} /* RtlSdr::IqBuffer::operator= */
+
+
+const vector<RtlSdr::Sample>& RtlSdr::IqBuffer::samples(void) const
+{
+  assert(blk != 0);
+  return blk->samples;
+} /* RtlSdr::IqBuffer::samples */
+
+
+RtlSdr::IqBuffer::IqBuffer(IqBlock *blk)
+  : blk(blk)
+{
+  blk->ref_cnt += 1;
+} /* RtlSdr::IqBuffer::IqBuffer */
+
+
+void RtlSdr::IqBuffer::release(void)
+{
+  if ((blk != 0) && (--blk->ref_cnt == 0))
+  {
+    blk->owner->recycle(blk);
+  }
+  blk = 0;
+} /* RtlSdr::IqBuffer::release */
+
+
 RtlSdr::RtlSdr(void)
   : samp_rate(2048000), block_size(10*2*samp_rate/1000),
     tuner_type(TUNER_UNKNOWN), center_fq_set(false), center_fq(100000000),
     samp_rate_set(false), gain_mode(-1), gain(GAIN_UNSET), fq_corr_set(false),
     fq_corr(0), test_mode_set(false), test_mode(false),
-    use_digital_agc_set(false), use_digital_agc(false), dist_print_cnt(-1)
+    use_digital_agc_set(false), use_digital_agc(false), dist_print_cnt(-1),
+    iq_ingest(0)
 {
+  iq_ingest = new IqIngest(*this);
   for (unsigned i=0; i<MAX_IF_GAIN_STAGES; ++i)
   {
     tuner_if_gain[i] = GAIN_UNSET;
@@ -130,7 +489,9 @@ RtlSdr::RtlSdr(void)
 
 RtlSdr::~RtlSdr(void)
 {
-}
+  delete iq_ingest;
+  iq_ingest = 0;
+} /* RtlSdr::~RtlSdr */
 
 
 void RtlSdr::enableDistPrint(bool enable)
@@ -276,24 +637,54 @@ vector<int> RtlSdr::getTunerGains(void) const
  *
  ****************************************************************************/
 
+bool RtlSdr::startIqIngest(void)
+{
+  if (iq_ingest->isRunning())
+  {
+    if (iq_ingest->blockSize() == block_size)
+    {
+      return true;
+    }
+    iq_ingest->stop();
+  }
+  return iq_ingest->start(block_size);
+} /* RtlSdr::startIqIngest */
+
+
+void RtlSdr::stopIqIngest(void)
+{
+  iq_ingest->stop();
+} /* RtlSdr::stopIqIngest */
+
+
 void RtlSdr::handleIq(const complex<uint8_t> *samples, int samp_count)
 {
   //cout << "RtlSdr::handleIq: samp_count=" << samp_count << endl;
+  iq_ingest->write(reinterpret_cast<const uint8_t*>(samples), 2 * samp_count);
+} /* RtlSdr::handleIq */
+
+
+void RtlSdr::iqStreamEnded(void)
+{
+  iq_ingest->streamEnded();
+} /* RtlSdr::iqStreamEnded */
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void RtlSdr::deliverIq(IqBlock *blk)
+{
+  IqBuffer iq(blk);
 
-  vector<Sample> iq;
-  iq.reserve(samp_count);
-  for (int idx=0; idx<samp_count; ++idx)
+  int samp_count = blk->samples.size();
+  if (blk->full_scale && (dist_print_cnt == 0))
   {
-    if ((dist_print_cnt == 0) &&
-        ((samples[idx].real() == 255) || (samples[idx].imag() == 255)))
-    {
-      dist_print_cnt = samp_rate;
-    }
-    float i = samples[idx].real();
-    i = i / 127.5f - 1.0f;
-    float q = samples[idx].imag();
-    q = q / 127.5f - 1.0f;
-    iq.push_back(complex<float>(i, q));
+    dist_print_cnt = samp_rate;
   }
 
   if (dist_print_cnt > 0)
@@ -311,16 +702,9 @@ void RtlSdr::handleIq(const complex<uint8_t> *samples, int samp_count)
   }
 
   iqReceived(iq);
-} /* RtlSdr::handleIq */
+} /* RtlSdr::deliverIq */
 
 
-
-/****************************************************************************
- *
- * Private member functions
- *
- ****************************************************************************/
-
 void RtlSdr::updateSettings(void)
 {
   if (samp_rate_set)
@@ -403,20 +787,13 @@ int RtlSdr::dataReceived(Async::TcpConnection *con, void *buf, int count)
   int samp_count = count / 2;
   complex<uint8_t> *samples =
     reinterpret_cast<complex<uint8_t>*>(buf);
-  vector<Sample> iq;
-  iq.reserve(samp_count);
-  for (int idx=0; idx<samp_count; ++idx)
+  vector<Sample> iq(samp_count);
+  bool full_scale = Async::AudioSampleConv::u8ToFloat(
+      reinterpret_cast<float*>(&iq[0]),
+      reinterpret_cast<const uint8_t*>(samples), 2 * samp_count);
+  if (full_scale && (dist_print_cnt == 0))
   {
-    if ((dist_print_cnt == 0) &&
-        ((samples[idx].real() == 255) || (samples[idx].imag() == 255)))
-    {
-      dist_print_cnt = samp_rate;
-    }
-    float i = samples[idx].real();
-    i = i / 127.5f - 1.0f;
-    float q = samples[idx].imag();
-    q = q / 127.5f - 1.0f;
-    iq.push_back(complex<float>(i, q));
+    dist_print_cnt = samp_rate;
   }
 
   if (dist_print_cnt > 0)
@@ -132,6 +132,65 @@ class RtlSdr : public sigc::trackable
 
     static const int GAIN_UNSET = 1000;
 
+    class IqIngest;
+    struct IqBlock;
+
+    /**
+     * @brief A reference counted handle to a block of received samples
+     *
+     * The sample blocks are taken from a pool of recycled buffers. When the
+     * last handle to a block is destroyed, the block is returned to the pool
+     * so that it can be reused for a later block of samples. A consumer
+     * that need to keep the samples for a while may just keep a copy of the
+     * handle. Handles must only be copied and destroyed in the main thread.
+     */
+    class IqBuffer
+    {
+      public:
+        /**
+         * @brief   Default constructor, creating an empty handle
+         */
+        IqBuffer(void) : blk(0) {}
+
+        /**
+         * @brief   Copy constructor
+         * @param   other The handle to copy
+         */
+        IqBuffer(const IqBuffer& other);
+
+        /**
+         * @brief   Destructor
+         */
+        ~IqBuffer(void) { release(); }
+
+        /**
+         * @brief   Assignment operator
+         * @param   other The handle to assign from
+         * @returns Returns this object
+         */
+        IqBuffer& operator=(const IqBuffer& other);
+
+        /**
+         * @brief   Get the samples in the block
+         * @returns Returns a vector of complex floats (I/Q), range -1 to 1
+         */
+        const std::vector<Sample>& samples(void) const;
+
+        /**
+         * @brief   Get the number of samples in the block
+         * @returns Returns the number of samples
+         */
+        size_t size(void) const { return samples().size(); }
+
+      private:
+        IqBlock *blk;
+
+        explicit IqBuffer(IqBlock *blk);
+        void release(void);
+
+        friend class RtlSdr;
+    };
+
     /**
      * @brief 	Default constructor
      */
@@ -290,13 +349,14 @@ class RtlSdr : public sigc::trackable
 
     /**
      * @brief   A signal that is emitted when new samples have been received
-     * @param   samples A vector of received samples
+     * @param   samples A handle to a block of received samples
      *
      * Connecting to this signal is the way to get samples from the DVB-T
      * dongle. The format is a vector of complex floats (I/Q) with a range from
-     * -1 to 1.
+     * -1 to 1. The samples are converted in a separate thread and the signal
+     * is emitted in the main thread.
      */
-    sigc::signal<void, std::vector<Sample> > iqReceived;
+    sigc::signal<void, const IqBuffer&> iqReceived;
     
     /**
      * @brief   A signal that is emitted when the ready state changes
@@ -373,13 +433,53 @@ class RtlSdr : public sigc::trackable
     virtual void handleEnableDigitalAgc(bool enable) = 0;
 
 
+    /**
+     * @brief   Start the IQ ingest thread
+     * @returns Returns \em true on success or \em false on failure
+     *
+     * This function must be called before IQ data is given to the handleIq
+     * function. The current block size is used. If the thread is already
+     * running with another block size, it is restarted.
+     */
+    bool startIqIngest(void);
+
+    /**
+     * @brief   Stop the IQ ingest thread
+     *
+     * All samples not yet delivered are thrown away. The thread writing to
+     * the handleIq function must have been stopped before calling this
+     * function.
+     */
+    void stopIqIngest(void);
+
     /**
      * @brief   Handle IQ data coming from the dongle
      * @param   samples An array of 8 bit complex IQ samples
      * @param   samp_count The number of complex samples
+     *
+     * The samples are copied to a lock free buffer and are converted to
+     * floating point blocks of blockSize() / 2 samples in the IQ ingest
+     * thread. The blocks are then delivered through the iqReceived signal in
+     * the main thread. This function may be called from one single thread,
+     * which need not be the main thread. If the buffer is full, the samples
+     * are thrown away.
      */
     void handleIq(const std::complex<uint8_t> *samples, int samp_count);
 
+    /**
+     * @brief   Tell the main thread that the IQ data stream has ended
+     *
+     * This function may be called from the thread calling handleIq when no
+     * more data will come from the dongle. The handleIqStreamEnded function
+     * will then be called in the main thread.
+     */
+    void iqStreamEnded(void);
+
+    /**
+     * @brief   Called in the main thread when the IQ data stream has ended
+     */
+    virtual void handleIqStreamEnded(void) {}
+
     /**
      * @brief   Update all current settings in the dongle
      */
@@ -416,9 +516,11 @@ class RtlSdr : public sigc::trackable
     bool              use_digital_agc_set;
     bool              use_digital_agc;
     int               dist_print_cnt;
+    IqIngest          *iq_ingest;
 
     RtlSdr(const RtlSdr&);
     RtlSdr& operator=(const RtlSdr&);
+    void deliverIq(IqBlock *blk);
     
 };  /* class RtlSdr */
 
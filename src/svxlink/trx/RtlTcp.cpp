@@ -164,6 +164,10 @@ void RtlTcp::handleSetCenterFq(uint32_t fq)
 void RtlTcp::handleSetSampleRate(uint32_t rate)
 {
   con.setRecvBufLen(blockSize());
+  if (con.isConnected() && (tunerType() != TUNER_UNKNOWN))
+  {
+    startIqIngest();
+  }
   sendCommand(2, rate);
 } /* RtlTcp::handleSetSampleRate */
 
@@ -240,6 +244,7 @@ void RtlTcp::disconnected(Async::TcpConnection *c,
                           Async::TcpConnection::DisconnectReason reason)
 {
   setTunerType(TUNER_UNKNOWN);
+  stopIqIngest();
   if (!reconnect_timer.isEnabled())
   {
     /*
@@ -290,6 +295,12 @@ int RtlTcp::dataReceived(Async::TcpConnection *con, void *buf, int count)
          ostream_iterator<float>(cout, " "));
     cout << endl;
 #endif
+    if (!startIqIngest())
+    {
+      this->con.disconnect();
+      disconnected(&this->con, TcpConnection::DR_SYSTEM_ERROR);
+      return 12;
+    }
     readyStateChanged();
     updateSettings();
     return 12;
@@ -39,7 +39,6 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <sstream>
 #include <iostream>
 #include <cassert>
-#include <queue>
 #include <unistd.h>
 #include <stdio.h>
 #include <errno.h>
@@ -51,7 +50,6 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
-#include <AsyncFdWatch.h>
 
 
 /****************************************************************************
@@ -89,184 +87,6 @@ using namespace Async;
  *
  ****************************************************************************/
 
-class RtlUsb::SampleBuffer : public sigc::trackable
-{
-  public:
-    SampleBuffer(uint32_t block_size)
-      : block_size(block_size), buf(0), buf_cnt(0), watch(0)
-    {
-      pthread_mutex_init(&mutex, NULL);
-
-      buf = new uint8_t[block_size];
-
-      int r = pipe(signal_pipe);
-      assert (r == 0);
-      watch = new FdWatch(signal_pipe[0], FdWatch::FD_WATCH_RD);
-      watch->activity.connect(
-          sigc::hide(mem_fun(*this, &SampleBuffer::removeSamples)));
-    }
-
-    ~SampleBuffer(void)
-    {
-      pthread_mutex_destroy(&mutex);
-      delete [] buf;
-      buf = 0;
-      while (!block_queue.empty())
-      {
-        delete [] block_queue.front();
-        block_queue.pop();
-      }
-      closeReadPipe();
-      closeWritePipe();
-    }
-
-    void closeWritePipe(void)
-    {
-      if (signal_pipe[1] != -1)
-      {
-        if (close(signal_pipe[1]) != 0)
-        {
-          cerr << "*** ERROR: Close error on write end of SampleBuffer pipe: "
-               << strerror(errno) << "\n";
-        }
-        signal_pipe[1] = -1;
-      }
-    }
-
-    void closeReadPipe(void)
-    {
-      delete watch;
-      watch = 0;
-      if (signal_pipe[0] != -1)
-      {
-        if (close(signal_pipe[0]) != 0)
-        {
-          cerr << "*** ERROR: Close error on read end of SampleBuffer pipe: "
-               << strerror(errno) << endl;
-        }
-        signal_pipe[0] = -1;
-      }
-    }
-
-    void setBlockSize(uint32_t new_block_size)
-    {
-      lockMutex();
-      block_size = new_block_size;
-      while (!block_queue.empty())
-      {
-        delete block_queue.front();
-        block_queue.pop();
-      }
-      delete [] buf;
-      buf = new uint8_t[block_size];
-      buf_cnt = 0;
-      unlockMutex();
-    }
-
-    void clear(void)
-    {
-      lockMutex();
-      while (!block_queue.empty())
-      {
-        delete [] block_queue.front();
-        block_queue.pop();
-      }
-      buf_cnt = 0;
-      unlockMutex();
-    }
-
-    bool addSamples(const unsigned char *samples, uint32_t len)
-    {
-      lockMutex();
-      while (len > 0)
-      {
-        uint32_t cpy_cnt = min(block_size - buf_cnt, len);
-        memcpy(buf + buf_cnt, samples, cpy_cnt);
-        buf_cnt += cpy_cnt;
-        len -= cpy_cnt;
-        samples += cpy_cnt;
-        if (buf_cnt >= block_size)
-        {
-          block_queue.push(buf);
-          buf = new uint8_t[block_size];
-          buf_cnt = 0;
-          unlockMutex();
-          if (write(signal_pipe[1], "S", 1) != 1)
-          {
-            return false;
-          }
-          lockMutex();
-        }
-      }
-      unlockMutex();
-      return true;
-    }
-
-    sigc::signal<void, complex<uint8_t>*, int> handleIq;
-    sigc::signal<void> writePipeClosed;
-
-  private:
-    uint32_t          block_size;
-    uint8_t           *buf;
-    uint32_t          buf_cnt;
-    pthread_mutex_t   mutex;
-    int               signal_pipe[2];
-    FdWatch           *watch;
-    queue<uint8_t*>   block_queue;
-
-    void lockMutex(void)
-    {
-      int r = pthread_mutex_lock(&mutex);
-      if (r != 0)
-      {
-        cerr << "*** ERROR: pthread_mutex_lock failed: "
-             << strerror(r) << endl;
-        abort();
-      }
-    }
-
-    void unlockMutex(void)
-    {
-      int r = pthread_mutex_unlock(&mutex);
-      if (r != 0)
-      {
-        cerr << "*** ERROR: pthread_mutex_unlock failed: "
-             << strerror(r) << endl;
-        abort();
-      }
-    }
-
-    void removeSamples(void)
-    {
-      char read_buf[64];
-      int r = read(signal_pipe[0], read_buf, sizeof(read_buf));
-      if (r == 0)
-      {
-        closeReadPipe();
-        writePipeClosed();
-        return;
-      }
-      else if (r <= 0)
-      {
-        cerr << "*** ERROR: Error while reading SampleBuffer signal pipe\n";
-        abort();
-      }
-
-      lockMutex();
-      while (!block_queue.empty())
-      {
-        uint8_t *buf = block_queue.front();
-        block_queue.pop();
-        unlockMutex();
-        complex<uint8_t> *samples = reinterpret_cast<complex<uint8_t>*>(buf);
-        handleIq(samples, block_size / 2);
-        delete [] buf;
-        lockMutex();
-      }
-      unlockMutex();
-    }
-};
-
 
 
 /****************************************************************************
@@ -302,8 +122,7 @@ class RtlUsb::SampleBuffer : public sigc::trackable
 
 RtlUsb::RtlUsb(const std::string &match)
   : reconnect_timer(0, Timer::TYPE_ONESHOT), dev(NULL), rtl_reader_thread(),
-    dev_match(match), dev_name("?"), sample_buf(0),
-    rtl_reader_thread_started(false)
+    dev_match(match), dev_name("?"), rtl_reader_thread_started(false)
 {
   reconnect_timer.expired.connect(
       hide(mem_fun(*this, &RtlUsb::initializeDongle)));
@@ -313,8 +132,6 @@ RtlUsb::RtlUsb(const std::string &match)
 RtlUsb::~RtlUsb(void)
 {
   verboseClose();
-  delete sample_buf;
-  sample_buf = 0;
 } /* RtlUsb::~RtlUsb */
 
 
@@ -370,14 +187,17 @@ void RtlUsb::handleSetCenterFq(uint32_t fq)
 
 void RtlUsb::handleSetSampleRate(uint32_t rate)
 {
-  if (sample_buf != 0)
+  if (dev == NULL)
   {
-    sample_buf->setBlockSize(blockSize());
+    return;
   }
 
-  if (dev == NULL)
+    // The IQ ingest block size depend on the sample rate so the reader
+    // thread must be restarted if it is running.
+  bool restart_reader = rtl_reader_thread_started;
+  if (restart_reader)
   {
-    return;
+    stopReaderThread();
   }
 
   int r = rtlsdr_set_sample_rate(dev, rate);
@@ -386,6 +206,10 @@ void RtlUsb::handleSetSampleRate(uint32_t rate)
     cerr << "*** WARNING: Failed to set sample rate.\n";
     verboseClose();
   }
+  else if (restart_reader && !startReaderThread())
+  {
+    verboseClose();
+  }
   else
   {
     //cerr << "### Sample rate set to " << rate << "Hz\n";
@@ -510,6 +334,12 @@ void RtlUsb::handleEnableDigitalAgc(bool enable)
 } /* RtlUsb::handleEnableDigitalAgc */
 
 
+void RtlUsb::handleIqStreamEnded(void)
+{
+  verboseClose();
+} /* RtlUsb::handleIqStreamEnded */
+
+
 
 /****************************************************************************
  *
@@ -583,7 +413,7 @@ void RtlUsb::rtlReader(void)
   {
     cerr << "*** WARNING: Failed to read samples from RTL dongle\n";
   }
-  sample_buf->closeWritePipe();
+  iqStreamEnded();
 } /* RtlUsb::rtlReader */
 
 
@@ -591,11 +421,7 @@ void RtlUsb::rtlsdrCallback(unsigned char *buf, uint32_t len, void *ctx)
 {
   //cout << "### RtlUsb::rtlsdrCallback: len=" << len << endl;
   RtlUsb *rtl = reinterpret_cast<RtlUsb*>(ctx);
-  if (!rtl->sample_buf->addSamples(buf, len))
-  {
-    cerr << "*** WARNING: Write error while writing to the RTL sample buffer\n";
-    rtl->verboseClose();
-  }
+  rtl->handleIq(reinterpret_cast<complex<uint8_t>*>(buf), len / 2);
 } /* RtlUsb::rtlsdrCallback */
 #endif
 
@@ -669,19 +495,11 @@ void RtlUsb::initializeDongle(void)
     return;
   }
 
-  sample_buf = new SampleBuffer(blockSize());
-  sample_buf->handleIq.connect(mem_fun(*this, &RtlUsb::handleIq));
-  sample_buf->writePipeClosed.connect(mem_fun(*this, &RtlUsb::verboseClose));
-
-  r = pthread_create(&rtl_reader_thread, NULL, startRtlReader, this);
-  if (r != 0)
+  if (!startReaderThread())
   {
-    cerr << "*** ERROR: Failed to create RTL reader thread: "
-         << strerror(r) << "\n";
     verboseClose();
     return;
   }
-  rtl_reader_thread_started = true;
 
   char vendor[256], product[256], serial[256];
   r = rtlsdr_get_device_usb_strings(dev_index, vendor, product, serial);
@@ -714,25 +532,7 @@ void RtlUsb::verboseClose(void)
     return;
   }
 
-  if (rtl_reader_thread_started)
-  {
-    int r = rtlsdr_cancel_async(dev);
-    if (r != 0)
-    {
-      cerr << "*** WARNING: Failed to cancel the RTL async reader\n";
-    }
-
-    r = pthread_join(rtl_reader_thread, NULL);
-    if (r != 0)
-    {
-      cerr << "*** WARNING: Failed to join the RTL reader thread: "
-           << strerror(r) << "\n";
-    }
-    rtl_reader_thread_started = false;
-  }
-
-  delete sample_buf;
-  sample_buf = 0;
+  stopReaderThread();
 
     // Close the RTL device
   int r = rtlsdr_close(dev);
@@ -754,6 +554,53 @@ void RtlUsb::verboseClose(void)
 } /* RtlUsb::verboseClose */
 
 
+bool RtlUsb::startReaderThread(void)
+{
+  assert(!rtl_reader_thread_started);
+
+  if (!startIqIngest())
+  {
+    return false;
+  }
+
+  int r = pthread_create(&rtl_reader_thread, NULL, startRtlReader, this);
+  if (r != 0)
+  {
+    cerr << "*** ERROR: Failed to create RTL reader thread: "
+         << strerror(r) << "\n";
+    stopIqIngest();
+    return false;
+  }
+  rtl_reader_thread_started = true;
+  return true;
+} /* RtlUsb::startReaderThread */
+
+
+void RtlUsb::stopReaderThread(void)
+{
+  if (rtl_reader_thread_started)
+  {
+    int r = rtlsdr_cancel_async(dev);
+    if (r != 0)
+    {
+      cerr << "*** WARNING: Failed to cancel the RTL async reader\n";
+    }
+
+    r = pthread_join(rtl_reader_thread, NULL);
+    if (r != 0)
+    {
+      cerr << "*** WARNING: Failed to join the RTL reader thread: "
+           << strerror(r) << "\n";
+    }
+    rtl_reader_thread_started = false;
+  }
+
+    // Must be done after the reader thread has been stopped since it is
+    // the one writing samples to the IQ ingest.
+  stopIqIngest();
+} /* RtlUsb::stopReaderThread */
+
+
 int RtlUsb::verboseDeviceSearch(const char *s)
 {
   int i, device_count, device, offset;
@@ -215,10 +215,12 @@ class RtlUsb : public RtlSdr
      */
     virtual void handleEnableDigitalAgc(bool enable);
 
-    
-  private:
-    class SampleBuffer;
+    /**
+     * @brief   Called in the main thread when the IQ data stream has ended
+     */
+    virtual void handleIqStreamEnded(void);
 
+  private:
     static const unsigned RECONNECT_INTERVAL = 5000;
 
     Async::Timer    reconnect_timer;
@@ -226,7 +228,6 @@ class RtlUsb : public RtlSdr
     pthread_t       rtl_reader_thread;
     std::string     dev_match;
     std::string     dev_name;
-    SampleBuffer    *sample_buf;
     bool            rtl_reader_thread_started;
 
     static void *startRtlReader(void *data);
@@ -238,6 +239,8 @@ class RtlUsb : public RtlSdr
     void rtlSamplesReceived(void);
     void initializeDongle(void);
     void verboseClose(void);
+    bool startReaderThread(void);
+    void stopReaderThread(void);
     int verboseDeviceSearch(const char *s);
     
 };  /* class RtlUsb */
@@ -0,0 +1,395 @@
+/*
+ * Replay recorded audio through a receiver faster than real time.
+ *
+ * A receiver is created from a SvxLink configuration file, just like SvxLink
+ * would do it, but the audio device of the receiver is replaced by a "file"
+ * audio device reading the given audio file. The application run in
+ * simulated time so the recording is processed as fast as the CPU allow.
+ * Squelch, DTMF, selcall and tone detector events are printed with their
+ * time in the recording and a throughput summary is printed at the end.
+ *
+ * The events can be saved to a file and later be compared to a new run,
+ * which make it possible to use this program for regression testing of the
+ * squelch and detector implementations. Event times may differ by the given
+ * tolerance.
+ *
+ * Usage: RxReplayBench -c config -r rx section [-t tone fq] [-d duration]
+ *                      [-o events file] [-e expected events file]
+ *                      [-j tolerance ms] [audio file]
+ *
+ *   The audio file is a WAV file or a raw 16 bit mono file with the same
+ *   sample rate as the audio device. If no audio file is given, the
+ *   receiver configuration is used as is and the duration of the run in
+ *   seconds must be given using -d. That way more complex receivers, like a
+ *   voter with satellite receivers using file audio devices, can be run.
+ */
+
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <map>
+
+#include <AsyncSimApplication.h>
+#include <AsyncTimer.h>
+#include <AsyncConfig.h>
+#include <AsyncAudioIO.h>
+#include <AsyncAudioSink.h>
+
+#include "Rx.h"
+
+using namespace std;
+using namespace Async;
+
+
+static const unsigned TAIL_MS = 2000;
+
+
+class NullSink : public AudioSink
+{
+  public:
+    virtual int writeSamples(const float *samples, int count)
+    {
+      return count;
+    }
+
+    virtual void flushSamples(void)
+    {
+      sourceAllSamplesFlushed();
+    }
+};
+
+
+class EventLog : public sigc::trackable
+{
+  public:
+    EventLog(SimApplication &app, Rx *rx) : app(app)
+    {
+      rx->squelchOpen.connect(mem_fun(*this, &EventLog::onSquelchOpen));
+      rx->dtmfDigitDetected.connect(
+          mem_fun(*this, &EventLog::onDtmfDigitDetected));
+      rx->selcallSequenceDetected.connect(
+          mem_fun(*this, &EventLog::onSelcallSequenceDetected));
+      rx->toneDetected.connect(mem_fun(*this, &EventLog::onToneDetected));
+    }
+
+    const vector<string>& events(void) const { return m_events; }
+    const map<string, unsigned>& counters(void) const { return m_counters; }
+
+  private:
+    SimApplication&       app;
+    vector<string>        m_events;
+    map<string, unsigned> m_counters;
+
+    void addEvent(const string& type, const string& msg)
+    {
+      ostringstream ss;
+      ss << fixed << setprecision(3) << app.simTimeMs() / 1000.0 << " "
+         << msg;
+      cout << ss.str() << endl;
+      m_events.push_back(ss.str());
+      m_counters[type] += 1;
+    }
+
+    void onSquelchOpen(bool is_open)
+    {
+      addEvent("squelch", is_open ? "Squelch OPEN" : "Squelch CLOSED");
+    }
+
+    void onDtmfDigitDetected(char digit, int duration)
+    {
+      ostringstream ss;
+      ss << "DTMF digit " << digit << " " << duration << "ms";
+      addEvent("dtmf", ss.str());
+    }
+
+    void onSelcallSequenceDetected(string sequence)
+    {
+      addEvent("selcall", "Selcall sequence " + sequence);
+    }
+
+    void onToneDetected(float fq)
+    {
+      ostringstream ss;
+      ss << "Tone " << fixed << setprecision(1) << fq << "Hz";
+      addEvent("tone", ss.str());
+    }
+};
+
+
+static double audioFileDuration(const string& path, int sample_rate)
+{
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+  {
+    return -1.0;
+  }
+  long data_size = st.st_size;
+  int file_channels = 1;
+  if ((path.size() > 4) && (path.substr(path.size() - 4) == ".wav"))
+  {
+    ifstream ifs(path.c_str(), ios::binary);
+    unsigned char hdr[44];
+    if (!ifs.read(reinterpret_cast<char *>(hdr), sizeof(hdr)))
+    {
+      return -1.0;
+    }
+    file_channels = hdr[22] | (hdr[23] << 8);
+    data_size -= sizeof(hdr);
+  }
+  if ((file_channels == 0) || (data_size < 0))
+  {
+    return -1.0;
+  }
+  return static_cast<double>(data_size) / (2 * file_channels) / sample_rate;
+}
+
+
+static bool compareEvents(const vector<string>& events,
+                          const string& expected_file, unsigned tolerance_ms)
+{
+  ifstream ifs(expected_file.c_str());
+  if (!ifs)
+  {
+    cerr << "*** ERROR: Could not open expected events file \""
+         << expected_file << "\"\n";
+    return false;
+  }
+  vector<string> expected;
+  string line;
+  while (getline(ifs, line))
+  {
+    if (!line.empty())
+    {
+      expected.push_back(line);
+    }
+  }
+
+  bool ok = true;
+  for (size_t i=0; i<max(events.size(), expected.size()); ++i)
+  {
+    if (i >= events.size())
+    {
+      cout << "MISSING: " << expected[i] << endl;
+      ok = false;
+      continue;
+    }
+    if (i >= expected.size())
+    {
+      cout << "EXTRA:   " << events[i] << endl;
+      ok = false;
+      continue;
+    }
+    double t1, t2;
+    string msg1, msg2;
+    istringstream ss1(events[i]);
+    istringstream ss2(expected[i]);
+    ss1 >> t1 >> ws;
+    getline(ss1, msg1);
+    ss2 >> t2 >> ws;
+    getline(ss2, msg2);
+    if ((msg1 != msg2) || (fabs(t1 - t2) * 1000.0 > tolerance_ms))
+    {
+      cout << "DIFF:    " << events[i] << " (expected " << expected[i]
+           << ")\n";
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+
+static double cpuTime(void)
+{
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1000000.0 +
+         ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1000000.0;
+}
+
+
+static void usage(const char *prog)
+{
+  cerr << "Usage: " << prog << " -c config -r rx section [-t tone fq] "
+          "[-d duration] [-o events file] [-e expected events file] "
+          "[-j tolerance ms] [audio file]\n";
+  exit(1);
+}
+
+
+int main(int argc, char **argv)
+{
+  string cfg_filename;
+  string rx_name;
+  vector<float> tone_fqs;
+  double duration = -1.0;
+  string events_file;
+  string expected_file;
+  unsigned tolerance_ms = 50;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "c:r:t:d:o:e:j:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'c':
+        cfg_filename = optarg;
+        break;
+      case 'r':
+        rx_name = optarg;
+        break;
+      case 't':
+        tone_fqs.push_back(atof(optarg));
+        break;
+      case 'd':
+        duration = atof(optarg);
+        break;
+      case 'o':
+        events_file = optarg;
+        break;
+      case 'e':
+        expected_file = optarg;
+        break;
+      case 'j':
+        tolerance_ms = strtoul(optarg, NULL, 10);
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (cfg_filename.empty() || rx_name.empty() || (optind + 1 < argc))
+  {
+    usage(argv[0]);
+  }
+
+  SimApplication app;
+
+  Config cfg;
+  if (!cfg.open(cfg_filename))
+  {
+    cerr << "*** ERROR: Could not open configuration file \""
+         << cfg_filename << "\"\n";
+    exit(1);
+  }
+
+  int sample_rate = INTERNAL_SAMPLE_RATE;
+  if (cfg.getValue("GLOBAL", "CARD_SAMPLE_RATE", sample_rate))
+  {
+    AudioIO::setSampleRate(sample_rate);
+  }
+  int card_channels = 2;
+  cfg.getValue("GLOBAL", "CARD_CHANNELS", card_channels);
+  AudioIO::setChannels(card_channels);
+
+  if (optind < argc)
+  {
+    string audio_file(argv[optind]);
+    if (duration < 0.0)
+    {
+      duration = audioFileDuration(audio_file, sample_rate);
+      if (duration < 0.0)
+      {
+        cerr << "*** ERROR: Could not read audio file \"" << audio_file
+             << "\"\n";
+        exit(1);
+      }
+    }
+    cfg.setValue(rx_name, "AUDIO_DEV", "file:" + audio_file);
+  }
+  if (duration < 0.0)
+  {
+    cerr << "*** ERROR: The duration must be given when no audio file is "
+            "given\n";
+    exit(1);
+  }
+
+  Rx *rx = RxFactory::createNamedRx(cfg, rx_name);
+  if ((rx == 0) || !rx->initialize())
+  {
+    cerr << "*** ERROR: Could not initialize receiver \"" << rx_name
+         << "\"\n";
+    exit(1);
+  }
+  for (vector<float>::const_iterator it=tone_fqs.begin();
+       it!=tone_fqs.end(); ++it)
+  {
+    if (!rx->addToneDetector(*it, 50, 10, 500))
+    {
+      cerr << "*** WARNING: Could not add a tone detector to receiver \""
+           << rx_name << "\"\n";
+    }
+  }
+  NullSink sink;
+  rx->registerSink(&sink);
+  EventLog log(app, rx);
+  rx->setMuteState(Rx::MUTE_NONE);
+
+  unsigned long run_ms = static_cast<unsigned long>(duration * 1000.0) +
+                         TAIL_MS;
+  Timer quit_timer(run_ms);
+  quit_timer.expired.connect(
+      sigc::hide(mem_fun(app, &SimApplication::quit)));
+
+  struct timeval start, end;
+  gettimeofday(&start, NULL);
+  double cpu_start = cpuTime();
+  app.exec();
+  gettimeofday(&end, NULL);
+  double cpu = cpuTime() - cpu_start;
+  double wall = (end.tv_sec - start.tv_sec) +
+                (end.tv_usec - start.tv_usec) / 1000000.0;
+  double audio_secs = app.simTimeMs() / 1000.0;
+
+  delete rx;
+
+  cout << "\nProcessed " << fixed << setprecision(1) << audio_secs
+       << "s of audio in " << setprecision(3) << wall << "s ("
+       << setprecision(3) << cpu << "s CPU), "
+       << setprecision(1) << (wall > 0.0 ? audio_secs / wall : 0.0)
+       << "x realtime\n";
+  const map<string, unsigned>& counters = log.counters();
+  for (map<string, unsigned>::const_iterator it=counters.begin();
+       it!=counters.end(); ++it)
+  {
+    cout << "  " << it->first << ": " << it->second << " events\n";
+  }
+
+  if (!events_file.empty())
+  {
+    ofstream ofs(events_file.c_str());
+    const vector<string>& events = log.events();
+    for (vector<string>::const_iterator it=events.begin();
+         it!=events.end(); ++it)
+    {
+      ofs << *it << endl;
+    }
+    if (!ofs)
+    {
+      cerr << "*** ERROR: Could not write events file \"" << events_file
+           << "\"\n";
+      exit(1);
+    }
+  }
+
+  if (!expected_file.empty())
+  {
+    if (!compareEvents(log.events(), expected_file, tolerance_ms))
+    {
+      cout << "FAILED: The events differ from \"" << expected_file
+           << "\"\n";
+      exit(2);
+    }
+    cout << "OK: The events match \"" << expected_file << "\"\n";
+  }
+
+  return 0;
+}
@@ -38,6 +38,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#ifdef HAS_GPIO_CHARDEV_SUPPORT
+#include <linux/gpio.h>
+#endif
+
+#include <cstdlib>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
 
 
 /****************************************************************************
@@ -47,6 +57,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include <AsyncTimer.h>
+#include <AsyncFdWatch.h>
 
 
 /****************************************************************************
@@ -118,7 +129,9 @@ using namespace Async;
  ****************************************************************************/
 
 SquelchGpio::SquelchGpio(void)
-  : fd(-1), timer(0), active_low(false), gpio_path("/sys/class/gpio")
+  : fd(-1), timer(0), watch(0), active_low(false),
+    gpio_path("/sys/class/gpio"), lat_cnt(0), lat_last(0.0), lat_min(0.0),
+    lat_max(0.0), lat_sum(0.0)
 {
   
 } /* SquelchGpio::SquelchGpio */
@@ -128,6 +141,8 @@ SquelchGpio::~SquelchGpio(void)
 {
   delete timer;
   timer = 0;
+  delete watch;
+  watch = 0;
   if (fd >= 0)
   {
     close(fd);
@@ -145,6 +160,9 @@ bool SquelchGpio::initialize(Async::Config& cfg, const std::string& rx_name)
 
   cfg.getValue(rx_name, "GPIO_PATH", gpio_path);
 
+  string gpio_chip;
+  cfg.getValue(rx_name, "GPIO_CHIP", gpio_chip);
+
   string sql_pin;
   if (!cfg.getValue(rx_name, "GPIO_SQL_PIN", sql_pin) || sql_pin.empty())
   {
@@ -159,6 +177,17 @@ bool SquelchGpio::initialize(Async::Config& cfg, const std::string& rx_name)
     sql_pin.erase(0, 1);
   }
 
+  if (!gpio_chip.empty())
+  {
+#ifdef HAS_GPIO_CHARDEV_SUPPORT
+    return initGpioChardev(rx_name, gpio_chip, sql_pin);
+#else
+    cerr << "*** ERROR: " << rx_name << "/GPIO_CHIP is set but SvxLink was "
+            "compiled without GPIO character device support\n";
+    return false;
+#endif
+  }
+
   stringstream ss;
   ss << gpio_path << "/" << sql_pin << "/value";
   fd = open(ss.str().c_str(), O_RDONLY);
@@ -175,7 +204,7 @@ bool SquelchGpio::initialize(Async::Config& cfg, const std::string& rx_name)
       hide(mem_fun(*this, &SquelchGpio::readGpioValueData)));
 
   return true;
-}
+} /* SquelchGpio::initialize */
 
 
 
@@ -236,6 +265,152 @@ void SquelchGpio::readGpioValueData(void)
 } /* SquelchGpio::readGpioValueData */
 
 
+#ifdef HAS_GPIO_CHARDEV_SUPPORT
+
+/**
+ * @brief  Request edge events for a line on a GPIO character device
+ *
+ * The line event file descriptor become readable when an edge has been
+ * detected so it can be watched by the main loop like any other file
+ * descriptor. The current state of the line is read once to get the initial
+ * squelch state.
+ */
+bool SquelchGpio::initGpioChardev(const std::string& rx_name,
+                                  const std::string& gpio_chip,
+                                  const std::string& sql_pin)
+{
+  char *endptr = 0;
+  unsigned long line = strtoul(sql_pin.c_str(), &endptr, 10);
+  if (sql_pin.empty() || (*endptr != '\0'))
+  {
+    cerr << "*** ERROR: " << rx_name << "/GPIO_SQL_PIN must be a line "
+            "number when " << rx_name << "/GPIO_CHIP is set\n";
+    return false;
+  }
+
+  int chip_fd = open(gpio_chip.c_str(), O_RDONLY);
+  if (chip_fd < 0)
+  {
+    cerr << "*** ERROR: Could not open GPIO chip " << gpio_chip
+         << " specified in " << rx_name << "/GPIO_CHIP: "
+         << strerror(errno) << endl;
+    return false;
+  }
+
+  struct gpioevent_request req;
+  memset(&req, 0, sizeof(req));
+  req.lineoffset = line;
+  req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+  req.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+  strncpy(req.consumer_label, "svxlink_sql", sizeof(req.consumer_label) - 1);
+  int ret = ioctl(chip_fd, GPIO_GET_LINEEVENT_IOCTL, &req);
+  int err = errno;
+  close(chip_fd);
+  if (ret < 0)
+  {
+    cerr << "*** ERROR: Could not request events for line " << line
+         << " on GPIO chip " << gpio_chip << " (" << rx_name << "): "
+         << strerror(err) << endl;
+    return false;
+  }
+  fd = req.fd;
+
+  struct gpiohandle_data data;
+  memset(&data, 0, sizeof(data));
+  if (ioctl(fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0)
+  {
+    cerr << "*** ERROR: Could not read line " << line << " on GPIO chip "
+         << gpio_chip << " (" << rx_name << "): " << strerror(errno) << endl;
+    return false;
+  }
+  bool is_active = active_low ^ (data.values[0] != 0);
+  if (is_active)
+  {
+    setSignalDetected(true);
+  }
+
+  watch = new FdWatch(fd, FdWatch::FD_WATCH_RD);
+  watch->activity.connect(mem_fun(*this, &SquelchGpio::gpioEventReceived));
+
+  return true;
+} /* SquelchGpio::initGpioChardev */
+
+
+/**
+ * @brief  Called when an edge event is available on the line event fd
+ *
+ * Only one event is read per call. If more events are queued, the file
+ * descriptor will still be readable and we will be called again on the next
+ * main loop iteration.
+ *
+ * The kernel event timestamp is taken from CLOCK_MONOTONIC on newer kernels
+ * and from CLOCK_REALTIME on older ones. The clock giving the smallest
+ * difference is assumed to be the right one.
+ */
+void SquelchGpio::gpioEventReceived(FdWatch *w)
+{
+  struct gpioevent_data event;
+  ssize_t cnt = read(fd, &event, sizeof(event));
+  if (cnt == -1)
+  {
+    cerr << "*** WARNING: SquelchGpio::gpioEventReceived: read failed: "
+         << strerror(errno) << endl;
+    return;
+  }
+  else if (cnt != sizeof(event))
+  {
+    cerr << "*** WARNING: SquelchGpio::gpioEventReceived: read returned "
+         << cnt << " bytes instead of " << sizeof(event) << endl;
+    return;
+  }
+
+  struct timespec mono, real;
+  clock_gettime(CLOCK_MONOTONIC, &mono);
+  clock_gettime(CLOCK_REALTIME, &real);
+  double ts = event.timestamp / 1000000.0;
+  double mono_lat = mono.tv_sec * 1000.0 + mono.tv_nsec / 1000000.0 - ts;
+  double real_lat = real.tv_sec * 1000.0 + real.tv_nsec / 1000000.0 - ts;
+  updateLatency(fabs(real_lat) < fabs(mono_lat) ? real_lat : mono_lat);
+
+  bool is_active = active_low ^ (event.id == GPIOEVENT_EVENT_RISING_EDGE);
+  if (signalDetected() != is_active)
+  {
+    setSignalDetected(is_active);
+    if (!is_active)
+    {
+      ostringstream ss;
+      ss << fixed << setprecision(3)
+         << rxName() << ": GPIO squelch latency (last/min/avg/max): "
+         << lat_last << "/" << lat_min << "/" << (lat_sum / lat_cnt)
+         << "/" << lat_max << "ms\n";
+      cout << ss.str();
+    }
+  }
+} /* SquelchGpio::gpioEventReceived */
+
+
+void SquelchGpio::updateLatency(double latency)
+{
+  if (latency < 0.0)
+  {
+    latency = 0.0;
+  }
+  lat_last = latency;
+  if ((lat_cnt == 0) || (latency < lat_min))
+  {
+    lat_min = latency;
+  }
+  if ((lat_cnt == 0) || (latency > lat_max))
+  {
+    lat_max = latency;
+  }
+  lat_sum += latency;
+  ++lat_cnt;
+} /* SquelchGpio::updateLatency */
+
+#endif /* HAS_GPIO_CHARDEV_SUPPORT */
+
+
 
 /*
  * This file has not been truncated
@@ -63,6 +63,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 namespace Async
 {
   class Timer;
+  class FdWatch;
 };
 
 
@@ -114,6 +115,12 @@ namespace Async
 This squelch detector read the squelch indicator signal from a GPIO input pin.
 A high level (3.3V) will be interpreted as squelch open and a low level (GND)
 will be interpreted as squelch close.
+
+Two backends are available. The sysfs backend poll the value file of the pin
+every 100ms. If GPIO_CHIP is set, the GPIO character device is used instead.
+The line is then requested for edge events, which are delivered through a
+file descriptor watch as soon as the pin change state. The time from the edge
+to the squelch state update is measured using the kernel event timestamp.
 */
 class SquelchGpio : public Squelch
 {
@@ -139,14 +146,27 @@ class SquelchGpio : public Squelch
   protected:
 
   private:
-    int           fd;
-    Async::Timer  *timer;
-    bool          active_low;
-    std::string   gpio_path;
+    int             fd;
+    Async::Timer    *timer;
+    Async::FdWatch  *watch;
+    bool            active_low;
+    std::string     gpio_path;
+    unsigned        lat_cnt;
+    double          lat_last;
+    double          lat_min;
+    double          lat_max;
+    double          lat_sum;
 
     SquelchGpio(const SquelchGpio&);
     SquelchGpio& operator=(const SquelchGpio&);
     void readGpioValueData(void);
+#ifdef HAS_GPIO_CHARDEV_SUPPORT
+    bool initGpioChardev(const std::string& rx_name,
+                         const std::string& gpio_chip,
+                         const std::string& sql_pin);
+    void gpioEventReceived(Async::FdWatch *w);
+    void updateLatency(double latency);
+#endif
 
 };  /* class SquelchGpio */
 
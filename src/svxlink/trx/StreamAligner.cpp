@@ -0,0 +1,599 @@
+/**
+@file	 StreamAligner.cpp
+@brief   Track the delay between audio streams carrying the same audio
+@author  Tobias Blomberg / SM0SVX
+@date	 2018-01-02
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2018 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioSink.h>
+#include <AsyncAudioProfiler.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "StreamAligner.h"
+
+
+
+/****************************************************************************
+ *
+ * Namespaces to use
+ *
+ ****************************************************************************/
+
+using namespace std;
+using namespace Async;
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Local class definitions
+ *
+ ****************************************************************************/
+
+/**
+ * @brief A stream that is tracked by the aligner
+ *
+ * Both the samples and the envelope of the stream are stored in ring buffers.
+ * Envelope sample n is calculated from stream samples n * decimation to
+ * (n + 1) * decimation - 1. Envelope sample n + center is compared to
+ * envelope sample n of the reference stream when correlating.
+ */
+class StreamAligner::Input : public AudioSink
+{
+  public:
+    Input(StreamAligner *aligner)
+      : aligner(aligner), buf(aligner->buf_size, 0.0f),
+        env(aligner->env_buf_size, 0.0f), acc(2 * aligner->max_lag + 1, 0.0f),
+        energy(acc.size(), 0.0f), start(0), wr(0), env_start(0), env_wr(0),
+        env_sum(0.0f), env_cnt(0), env_mean(0.0f), center(0), next_ref(0),
+        ref_energy(0.0), processed(0), offset(0.0), epoch(0), offset_epoch(0),
+        offset_ref_epoch(0), seen_epoch(0), seen_ref_epoch(0),
+        is_active(false), has_env_mean(false), has_offset(false),
+        do_reset(true)
+    {
+    }
+
+    virtual int writeSamples(const float *samples, int count)
+    {
+      if (!is_active)
+      {
+        is_active = true;
+        ++epoch;
+        start = wr;
+        env_start = env_wr;
+        has_env_mean = false;
+      }
+
+      aligner->inputWritten(this, samples, count);
+
+      return count;
+    }
+
+    virtual void flushSamples(void)
+    {
+      is_active = false;
+      sourceAllSamplesFlushed();
+    }
+
+    bool hasSamples(int64_t pos, unsigned count) const
+    {
+      return (pos >= start) && (pos + count <= wr) &&
+             (pos >= wr - static_cast<int64_t>(buf.size()));
+    }
+
+    float sample(int64_t pos) const
+    {
+      return buf[pos & (buf.size() - 1)];
+    }
+
+    float envSample(int64_t idx) const
+    {
+      if ((idx < env_start) || (idx >= env_wr) ||
+          (idx < env_wr - static_cast<int64_t>(env.size())))
+      {
+        return 0.0f;
+      }
+      return env[idx & (env.size() - 1)];
+    }
+
+    StreamAligner *aligner;
+    vector<float> buf;
+    vector<float> env;
+    vector<float> acc;
+    vector<float> energy;
+    int64_t       start;
+    int64_t       wr;
+    int64_t       env_start;
+    int64_t       env_wr;
+    float         env_sum;
+    unsigned      env_cnt;
+    float         env_mean;
+    int64_t       center;
+    int64_t       next_ref;
+    double        ref_energy;
+    unsigned      processed;
+    double        offset;
+    unsigned      epoch;
+    unsigned      offset_epoch;
+    unsigned      offset_ref_epoch;
+    unsigned      seen_epoch;
+    unsigned      seen_ref_epoch;
+    bool          is_active;
+    bool          has_env_mean;
+    bool          has_offset;
+    bool          do_reset;
+
+}; /* class StreamAligner::Input */
+
+
+
+/****************************************************************************
+ *
+ * Prototypes
+ *
+ ****************************************************************************/
+
+static unsigned roundUpToPowerOfTwo(unsigned value);
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ *
+ * Local Global Variables
+ *
+ ****************************************************************************/
+
+  // How fast the envelope mean, which is removed from the envelope, follow
+  // the envelope. The cutoff frequency is about 1Hz.
+static const float ENV_MEAN_COEFF = 0.0125f;
+
+  // The correlation sums decay with this factor for each envelope sample,
+  // which give a time constant of about two seconds
+static const float CORR_DECAY = 0.999f;
+
+  // The minimum envelope correlation coefficient needed to trust an estimate
+static const float MIN_CORRELATION = 0.6f;
+
+  // The minimum audio correlation coefficient needed to use a refinement
+static const float MIN_FINE_CORRELATION = 0.5f;
+
+  // Envelopes with less energy than this are considered to be silent
+static const double SILENCE_ENERGY = 1.0e-7;
+
+
+
+/****************************************************************************
+ *
+ * Public member functions
+ *
+ ****************************************************************************/
+
+StreamAligner::StreamAligner(unsigned max_delay_ms)
+  : ref(0), xcorr(FINE_LENGTH, FINE_MAX_LAG),
+    fine_buf(xcorr.refLength() + xcorr.sigLength()),
+    decimation(INTERNAL_SAMPLE_RATE / ENV_RATE),
+    max_lag(max_delay_ms * ENV_RATE / 1000)
+{
+  assert(FINE_MAX_LAG >= 2 * decimation);
+
+    // Both ring buffers hold the longest delay plus a second of margin
+  buf_size = roundUpToPowerOfTwo(
+      (max_delay_ms + 1000) * INTERNAL_SAMPLE_RATE / 1000 +
+      xcorr.refLength() + xcorr.sigLength());
+  env_buf_size = roundUpToPowerOfTwo(2 * max_lag + ENV_RATE);
+} /* StreamAligner::StreamAligner */
+
+
+StreamAligner::~StreamAligner(void)
+{
+  for (InputMap::iterator it=inputs.begin(); it!=inputs.end(); ++it)
+  {
+    delete (*it).second;
+  }
+} /* StreamAligner::~StreamAligner */
+
+
+void StreamAligner::addSource(AudioSource *source)
+{
+  assert(source != 0);
+  assert(inputs.find(source) == inputs.end());
+  Input *input = new Input(this);
+  AudioProfiler::setOwner(input, this);
+  input->registerSource(source);
+  inputs[source] = input;
+} /* StreamAligner::addSource */
+
+
+void StreamAligner::setReference(AudioSource *source)
+{
+  Input *new_ref = 0;
+  if (source != 0)
+  {
+    InputMap::iterator it = inputs.find(source);
+    assert(it != inputs.end());
+    new_ref = (*it).second;
+  }
+  if (new_ref == ref)
+  {
+    return;
+  }
+
+    // Translate the known offsets so that they are relative to the new
+    // reference. All offsets are lost if the offset between the old and the
+    // new reference is not known.
+  bool translate = (ref != 0) && (new_ref != 0) && offsetIsValid(new_ref);
+  for (InputMap::iterator it=inputs.begin(); it!=inputs.end(); ++it)
+  {
+    Input *input = (*it).second;
+    input->do_reset = true;
+    if ((input == new_ref) || (input == ref))
+    {
+      continue;
+    }
+    if (translate && offsetIsValid(input))
+    {
+      input->offset -= new_ref->offset;
+      input->offset_ref_epoch = new_ref->epoch;
+    }
+    else
+    {
+      input->has_offset = false;
+    }
+  }
+  if (ref != 0)
+  {
+    ref->has_offset = translate;
+    if (translate)
+    {
+      ref->offset = -new_ref->offset;
+      ref->offset_epoch = ref->epoch;
+      ref->offset_ref_epoch = new_ref->epoch;
+    }
+  }
+  if (new_ref != 0)
+  {
+    new_ref->has_offset = false;
+  }
+
+  ref = new_ref;
+} /* StreamAligner::setReference */
+
+
+int64_t StreamAligner::position(AudioSource *source) const
+{
+  InputMap::const_iterator it = inputs.find(source);
+  assert(it != inputs.end());
+  return (*it).second->wr;
+} /* StreamAligner::position */
+
+
+bool StreamAligner::alignedPosition(AudioSource *source, int64_t ref_pos,
+                                    int64_t &pos)
+{
+  InputMap::iterator it = inputs.find(source);
+  assert(it != inputs.end());
+  Input *input = (*it).second;
+  if ((ref == 0) || (input == ref) || !offsetIsValid(input))
+  {
+    return false;
+  }
+
+  pos = ref_pos + static_cast<int64_t>(floor(input->offset + 0.5));
+  refinePosition(input, ref_pos, pos);
+
+  return true;
+
+} /* StreamAligner::alignedPosition */
+
+
+bool StreamAligner::switchSkip(AudioSource *from, unsigned from_buffered,
+                               AudioSource *to, unsigned to_buffered,
+                               unsigned &skip)
+{
+    // Find the position of the last sample sent from the old stream and
+    // the position of the matching sample from the new stream
+  int64_t from_pos = position(from) - from_buffered;
+  int64_t to_pos = 0;
+  if (!alignedPosition(to, from_pos, to_pos))
+  {
+    return false;
+  }
+
+    // Skip buffered samples that have already been sent from the old
+    // stream. If the matching sample is not buffered anymore, the best we
+    // can do is to start from the oldest buffered sample.
+  int64_t to_first = position(to) - to_buffered;
+  skip = static_cast<unsigned>(max(to_pos - to_first, int64_t(0)));
+  return true;
+} /* StreamAligner::switchSkip */
+
+
+
+/****************************************************************************
+ *
+ * Protected member functions
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Private member functions
+ *
+ ****************************************************************************/
+
+void StreamAligner::inputWritten(Input *input, const float *samples,
+                                 int count)
+{
+  const unsigned buf_mask = buf_size - 1;
+  const unsigned env_mask = env_buf_size - 1;
+  for (int i=0; i<count; ++i)
+  {
+    input->buf[input->wr++ & buf_mask] = samples[i];
+    input->env_sum += fabs(samples[i]);
+    if (++input->env_cnt == decimation)
+    {
+      float e = input->env_sum / decimation;
+      if (!input->has_env_mean)
+      {
+        input->env_mean = e;
+        input->has_env_mean = true;
+      }
+      input->env_mean += ENV_MEAN_COEFF * (e - input->env_mean);
+      input->env[input->env_wr++ & env_mask] = e - input->env_mean;
+      input->env_sum = 0.0f;
+      input->env_cnt = 0;
+    }
+  }
+
+  if (input != ref)
+  {
+    correlate(input);
+    return;
+  }
+
+  for (InputMap::iterator it=inputs.begin(); it!=inputs.end(); ++it)
+  {
+    correlate((*it).second);
+  }
+} /* StreamAligner::inputWritten */
+
+
+bool StreamAligner::offsetIsValid(const Input *input) const
+{
+  return (ref != 0) && input->has_offset &&
+         (input->offset_epoch == input->epoch) &&
+         (input->offset_ref_epoch == ref->epoch);
+} /* StreamAligner::offsetIsValid */
+
+
+void StreamAligner::resetEstimation(Input *input)
+{
+  fill(input->acc.begin(), input->acc.end(), 0.0f);
+  fill(input->energy.begin(), input->energy.end(), 0.0f);
+  input->ref_energy = 0.0;
+  input->processed = 0;
+  input->next_ref = ref->env_wr;
+
+    // Center the search around the last known offset. If there is no known
+    // offset, assume that the newest samples of both streams match.
+  if (offsetIsValid(input))
+  {
+    input->center = static_cast<int64_t>(
+        floor(input->offset / decimation + 0.5));
+  }
+  else
+  {
+    input->center = input->env_wr - ref->env_wr;
+  }
+
+  input->seen_epoch = input->epoch;
+  input->seen_ref_epoch = ref->epoch;
+  input->do_reset = false;
+} /* StreamAligner::resetEstimation */
+
+
+void StreamAligner::correlate(Input *input)
+{
+  if ((ref == 0) || (input == ref) || !input->is_active || !ref->is_active)
+  {
+    return;
+  }
+
+  if (input->do_reset || (input->seen_epoch != input->epoch) ||
+      (input->seen_ref_epoch != ref->epoch))
+  {
+    resetEstimation(input);
+  }
+
+  const int64_t lags = input->acc.size();
+  float *acc = &input->acc[0];
+  float *energy = &input->energy[0];
+  while (input->next_ref < ref->env_wr)
+  {
+    int64_t n = input->next_ref;
+    int64_t first = n + input->center - max_lag;
+
+      // Wait until the input have samples for all lags
+    if (first + lags > input->env_wr)
+    {
+      break;
+    }
+
+      // Start over if the input has been lagging behind for so long that
+      // the reference samples are gone
+    if (n < ref->env_wr - static_cast<int64_t>(env_buf_size))
+    {
+      resetEstimation(input);
+      break;
+    }
+
+      // The input energy is summed for each lag so that the correlation
+      // coefficient can be normalized using the energy at the best lag
+    float x = ref->envSample(n);
+    for (int64_t k=0; k<lags; ++k)
+    {
+      float y = input->envSample(first + k);
+      acc[k] = CORR_DECAY * acc[k] + x * y;
+      energy[k] = CORR_DECAY * energy[k] + y * y;
+    }
+    input->ref_energy = CORR_DECAY * input->ref_energy + x * x;
+
+    input->next_ref += 1;
+    input->processed += 1;
+    if ((input->processed >= MIN_ESTIMATE_LENGTH) &&
+        (input->processed % ESTIMATE_INTERVAL == 0))
+    {
+      updateEstimate(input);
+    }
+  }
+} /* StreamAligner::correlate */
+
+
+void StreamAligner::updateEstimate(Input *input)
+{
+  const vector<float>& acc = input->acc;
+  unsigned best = max_element(acc.begin(), acc.end()) - acc.begin();
+  double energy = input->energy[best];
+  if ((input->ref_energy < SILENCE_ENERGY) || (energy < SILENCE_ENERGY))
+  {
+    return;
+  }
+  float corr = acc[best] / sqrt(input->ref_energy * energy);
+  if (corr < MIN_CORRELATION)
+  {
+    return;
+  }
+
+    // Interpolate between the envelope samples by fitting a parabola to the
+    // peak and its neighbours
+  double frac = 0.0;
+  if ((best > 0) && (best + 1 < acc.size()))
+  {
+    double y0 = acc[best - 1];
+    double y1 = acc[best];
+    double y2 = acc[best + 1];
+    double denom = y0 - 2.0 * y1 + y2;
+    if (denom < 0.0)
+    {
+      frac = 0.5 * (y0 - y2) / denom;
+    }
+  }
+
+  double lag = static_cast<double>(input->center) + best - max_lag + frac;
+  input->offset = lag * decimation;
+  input->offset_epoch = input->epoch;
+  input->offset_ref_epoch = ref->epoch;
+  input->has_offset = true;
+} /* StreamAligner::updateEstimate */
+
+
+void StreamAligner::refinePosition(Input *input, int64_t ref_pos,
+                                   int64_t &pos)
+{
+  const unsigned ref_len = xcorr.refLength();
+  const unsigned sig_len = xcorr.sigLength();
+  int64_t ref_first = ref_pos - ref_len;
+  int64_t sig_first = pos - ref_len - xcorr.maxLag();
+  if (!ref->hasSamples(ref_first, ref_len) ||
+      !input->hasSamples(sig_first, sig_len))
+  {
+    return;
+  }
+
+  for (unsigned i=0; i<ref_len; ++i)
+  {
+    fine_buf[i] = ref->sample(ref_first + i);
+  }
+  for (unsigned i=0; i<sig_len; ++i)
+  {
+    fine_buf[ref_len + i] = input->sample(sig_first + i);
+  }
+
+  int lag = 0;
+  float corr = 0.0f;
+  if (xcorr.findLag(&fine_buf[0], &fine_buf[ref_len], lag, corr) &&
+      (fabs(corr) >= MIN_FINE_CORRELATION))
+  {
+    pos += lag;
+  }
+} /* StreamAligner::refinePosition */
+
+
+static unsigned roundUpToPowerOfTwo(unsigned value)
+{
+  unsigned size = 1;
+  while (size < value)
+  {
+    size <<= 1;
+  }
+  return size;
+} /* roundUpToPowerOfTwo */
+
+
+
+/*
+ * This file has not been truncated
+ */
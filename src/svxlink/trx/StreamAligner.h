@@ -0,0 +1,239 @@
+/**
+@file	 StreamAligner.h
+@brief   Track the delay between audio streams carrying the same audio
+@author  Tobias Blomberg / SM0SVX
+@date	 2018-01-02
+
+\verbatim
+SvxLink - A Multi Purpose Voice Services System for Ham Radio Use
+Copyright (C) 2003-2018 Tobias Blomberg / SM0SVX
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+\endverbatim
+*/
+
+#ifndef STREAM_ALIGNER_INCLUDED
+#define STREAM_ALIGNER_INCLUDED
+
+
+/****************************************************************************
+ *
+ * System Includes
+ *
+ ****************************************************************************/
+
+#include <stdint.h>
+
+#include <vector>
+#include <map>
+
+
+/****************************************************************************
+ *
+ * Project Includes
+ *
+ ****************************************************************************/
+
+#include <AsyncAudioSource.h>
+
+
+/****************************************************************************
+ *
+ * Local Includes
+ *
+ ****************************************************************************/
+
+#include "CrossCorrelator.h"
+
+
+/****************************************************************************
+ *
+ * Forward declarations
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Namespace
+ *
+ ****************************************************************************/
+
+//namespace MyNameSpace
+//{
+
+
+/****************************************************************************
+ *
+ * Forward declarations of classes inside of the declared namespace
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Defines & typedefs
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Exported Global Variables
+ *
+ ****************************************************************************/
+
+
+
+/****************************************************************************
+ *
+ * Class definitions
+ *
+ ****************************************************************************/
+
+/**
+@brief	Track the delay between audio streams carrying the same audio
+@author Tobias Blomberg / SM0SVX
+@date   2018-01-02
+
+This class is used by the voter to find out where in the audio stream of a
+receiver to continue when switching from another receiver. Receivers that are
+connected over different kinds of links have different delays so just
+continuing with the newest audio would make the audio jump or repeat.
+
+The position of a sample in a stream is the number of samples written to the
+stream before it. For each stream, the offset to the reference stream is
+tracked continuously by cross-correlating the envelopes of the two streams.
+The envelope is decimated to a low sample rate and the correlation for all
+lags is updated incrementally for each new envelope sample, so the cost is
+low even when there are many streams. When a position is looked up, the
+estimate is refined to sample precision by cross-correlating the audio
+around the found position.
+
+The offsets are only valid as long as both streams are active. When the
+reference is changed, the offsets are recalculated from the old ones so that
+there is no need to wait for a new estimate.
+*/
+class StreamAligner
+{
+  public:
+    /**
+     * @brief 	Constuctor
+     * @param 	max_delay_ms The maximum delay difference between two streams
+     */
+    explicit StreamAligner(unsigned max_delay_ms);
+
+    /**
+     * @brief 	Destructor
+     */
+    ~StreamAligner(void);
+
+    /**
+     * @brief 	Add a stream to track
+     * @param 	source The audio source of the stream
+     */
+    void addSource(Async::AudioSource *source);
+
+    /**
+     * @brief 	Set which stream all other streams are compared to
+     * @param 	source The audio source of the reference stream or 0 for none
+     */
+    void setReference(Async::AudioSource *source);
+
+    /**
+     * @brief 	Get the current position of a stream
+     * @param 	source The audio source of the stream
+     * @return	Returns the number of samples written to the stream so far
+     */
+    int64_t position(Async::AudioSource *source) const;
+
+    /**
+     * @brief 	Find the position in a stream matching a reference position
+     * @param 	source  The audio source of the stream
+     * @param 	ref_pos A position in the reference stream
+     * @param 	pos     Set to the position in the stream with the same audio
+     * @return	Returns \em true on success or \em false if the offset between
+     *          the streams is not known
+     */
+    bool alignedPosition(Async::AudioSource *source, int64_t ref_pos,
+                         int64_t &pos);
+
+    /**
+     * @brief 	Find how many samples to skip when switching stream
+     * @param 	from          The audio source of the stream switched from
+     * @param 	from_buffered The number of samples from the old stream that
+     *                        have been written here but not sent
+     * @param 	to            The audio source of the stream switched to
+     * @param 	to_buffered   The number of samples from the new stream that
+     *                        have been written here but not sent
+     * @param 	skip          Set to the number of samples to skip
+     * @return	Returns \em true on success or \em false if the offset between
+     *          the streams is not known
+     *
+     * The samples from the new stream that match samples already sent from
+     * the old stream should be skipped so that no audio is repeated. If
+     * the new stream is more delayed than the old one, the skip count is
+     * larger than the number of buffered samples so samples should also be
+     * skipped when they arrive. The old stream must be the reference.
+     */
+    bool switchSkip(Async::AudioSource *from, unsigned from_buffered,
+                    Async::AudioSource *to, unsigned to_buffered,
+                    unsigned &skip);
+
+  private:
+    class Input;
+    typedef std::map<Async::AudioSource*, Input*> InputMap;
+
+    static const unsigned ENV_RATE                = 500;
+    static const unsigned ESTIMATE_INTERVAL       = 50;
+    static const unsigned MIN_ESTIMATE_LENGTH     = 500;
+    static const unsigned FINE_LENGTH             = 512;
+    static const unsigned FINE_MAX_LAG            = 64;
+
+    InputMap            inputs;
+    Input               *ref;
+    CrossCorrelator     xcorr;
+    std::vector<float>  fine_buf;
+    unsigned            decimation;
+    unsigned            max_lag;
+    unsigned            buf_size;
+    unsigned            env_buf_size;
+
+    StreamAligner(const StreamAligner&);
+    StreamAligner& operator=(const StreamAligner&);
+    void inputWritten(Input *input, const float *samples, int count);
+    bool offsetIsValid(const Input *input) const;
+    void resetEstimation(Input *input);
+    void correlate(Input *input);
+    void updateEstimate(Input *input);
+    void refinePosition(Input *input, int64_t ref_pos, int64_t &pos);
+
+    friend class Input;
+
+};  /* class StreamAligner */
+
+
+//} /* namespace */
+
+#endif /* STREAM_ALIGNER_INCLUDED */
+
+
+
+/*
+ * This file has not been truncated
+ */
@@ -0,0 +1,191 @@
+/*
+ * Test for the StreamAligner class.
+ *
+ * Two receivers picking up the same speech like signal with different delays
+ * are simulated. The first stream is the reference. The delay of the second
+ * stream is either fixed or drifting, like when the sample clocks of two
+ * receivers differ. The test check that alignedPosition find the sample
+ * matching a reference position and that switchSkip, used by the Voter when
+ * switching receiver, give the expected number of samples to skip.
+ *
+ * When the matching audio has been received, the position is refined using
+ * the audio itself and must be exact. Otherwise only the envelope estimate
+ * can be used and it must be within the range of the refinement.
+ *
+ * Usage: StreamAlignerTest
+ */
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+#include <AsyncAudioPassthrough.h>
+
+#include "StreamAligner.h"
+
+using namespace std;
+using namespace Async;
+
+
+static const unsigned BLOCK_SIZE = INTERNAL_SAMPLE_RATE / 50;
+static const unsigned MAX_DELAY_MS = 500;
+static const int64_t  FINE_TOLERANCE = 1;
+static const int64_t  COARSE_TOLERANCE = 64;
+static const int64_t  FINE_MARGIN = 64;
+
+static unsigned errors = 0;
+
+
+static float noise(void)
+{
+  return 2.0f * rand() / RAND_MAX - 1.0f;
+}
+
+
+  // Low pass filtered noise with a syllable like envelope
+static void generateSignal(vector<float> &sig, unsigned len)
+{
+  sig.resize(len);
+  float lp = 0.0f;
+  float level = 0.0f;
+  float target = 0.0f;
+  unsigned next_syllable = 0;
+  for (unsigned i=0; i<len; ++i)
+  {
+    if (i == next_syllable)
+    {
+      target = 0.3f + 0.7f * rand() / RAND_MAX;
+      next_syllable += (80 + rand() % 170) * INTERNAL_SAMPLE_RATE / 1000;
+    }
+    level += 0.002f * (target - level);
+    lp += 0.3f * (noise() - lp);
+    sig[i] = level * lp;
+  }
+}
+
+
+static void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    cout << "*** FAILED: " << what << endl;
+    ++errors;
+  }
+}
+
+
+/*
+ * The delay, in samples, of the second stream at sample pos. The delay
+ * grow by one sample every drift_interval samples.
+ */
+static int64_t delayAt(int64_t pos, int64_t delay, unsigned drift_interval)
+{
+  return (drift_interval > 0) ? delay + pos / drift_interval : delay;
+}
+
+
+  // Find the sample in the second stream holding signal sample n
+static int64_t expectedPosition(int64_t n, int64_t delay,
+                                unsigned drift_interval)
+{
+  int64_t pos = n + delay;
+  while (pos - delayAt(pos, delay, drift_interval) < n)
+  {
+    ++pos;
+  }
+  return pos;
+}
+
+
+  // The audio matching a position can only be used if it has been received
+static int64_t tolerance(int64_t expected, int64_t end)
+{
+  return (expected + FINE_MARGIN <= end) ? FINE_TOLERANCE : COARSE_TOLERANCE;
+}
+
+
+static void runTest(const char *name, int64_t ref_delay, int64_t delay,
+                    unsigned drift_interval, unsigned seconds)
+{
+  const unsigned len = seconds * INTERNAL_SAMPLE_RATE;
+  vector<float> sig;
+  generateSignal(sig, len);
+
+  StreamAligner aligner(MAX_DELAY_MS);
+  AudioPassthrough ref_rx;
+  AudioPassthrough other_rx;
+  aligner.addSource(&ref_rx);
+  aligner.addSource(&other_rx);
+  aligner.setReference(&ref_rx);
+
+  vector<float> ref_buf(BLOCK_SIZE);
+  vector<float> other_buf(BLOCK_SIZE);
+  for (unsigned pos=0; pos+BLOCK_SIZE<=len; pos+=BLOCK_SIZE)
+  {
+    for (unsigned i=0; i<BLOCK_SIZE; ++i)
+    {
+      int64_t n = pos + i;
+      int64_t ref_idx = n - ref_delay;
+      int64_t idx = n - delayAt(n, delay, drift_interval);
+      ref_buf[i] = (ref_idx >= 0) ? sig[ref_idx] : 0.0f;
+      other_buf[i] = (idx >= 0) ? sig[idx] + 0.02f * noise() : 0.0f;
+    }
+    ref_rx.writeSamples(&ref_buf[0], ref_buf.size());
+    other_rx.writeSamples(&other_buf[0], other_buf.size());
+  }
+
+    // The position of each stream is the number of samples written to it.
+    // Reference sample ref_pos hold signal sample ref_pos - ref_delay.
+  int64_t end = aligner.position(&ref_rx);
+  check(aligner.position(&other_rx) == end, "Wrong stream position");
+  int64_t ref_pos = end - max(delay - ref_delay, int64_t(0)) - 4 * BLOCK_SIZE;
+  int64_t expected =
+    expectedPosition(ref_pos - ref_delay, delay, drift_interval);
+  int64_t pos = 0;
+  bool found = aligner.alignedPosition(&other_rx, ref_pos, pos);
+  cout << name << ": expected=" << expected - ref_pos
+       << " found=" << (found ? pos - ref_pos : 0)
+       << (found ? "" : " (not aligned)") << endl;
+  check(found, "alignedPosition failed");
+  check(llabs(pos - expected) <= tolerance(expected, end),
+        "alignedPosition returned the wrong position");
+
+    // Switch from the reference to the other stream, with audio from both
+    // streams buffered. The skip count put the first sample sent from the
+    // new stream right after the last sample sent from the old stream.
+  const unsigned buffered[][2] = {
+    { 3200, 4800 }, { 0, 8000 }, { 6000, 500 }, { 8000, 0 }
+  };
+  for (unsigned i=0; i<sizeof(buffered)/sizeof(*buffered); ++i)
+  {
+    unsigned from_buffered = buffered[i][0];
+    unsigned to_buffered = buffered[i][1];
+    int64_t from_pos = end - from_buffered;
+    int64_t to_pos =
+      expectedPosition(from_pos - ref_delay, delay, drift_interval);
+    int64_t expected_skip =
+      max(to_pos - (end - static_cast<int64_t>(to_buffered)), int64_t(0));
+    unsigned skip = 0;
+    bool ok = aligner.switchSkip(&ref_rx, from_buffered, &other_rx,
+                                 to_buffered, skip);
+    cout << name << ": buffered=" << from_buffered << "/" << to_buffered
+         << " expected_skip=" << expected_skip << " skip=" << skip << endl;
+    check(ok, "switchSkip failed");
+    check(llabs(static_cast<int64_t>(skip) - expected_skip) <=
+          tolerance(to_pos, end),
+          "switchSkip returned the wrong skip count");
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  srand(4711);
+  runTest("Delayed", 0, 1234, 0, 6);
+  runTest("Ahead", 3000, 200, 0, 6);
+  runTest("Drifting", 0, 800, 1000, 12);
+
+  cout << (errors == 0 ? "OK" : "FAIL") << endl;
+  return (errors == 0) ? 0 : 1;
+}
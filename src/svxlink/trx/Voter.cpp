@@ -40,6 +40,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <cstdlib>
 #include <utility>
 #include <list>
+#include <vector>
 #include <sigc++/bind.h>
 #include <sys/time.h>
 
@@ -54,8 +55,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <AsyncAudioFifo.h>
 #include <AsyncAudioSelector.h>
 #include <AsyncAudioValve.h>
+#include <AsyncAudioSplitter.h>
+#include <AsyncAudioPassthrough.h>
+#include <AsyncAudioProfiler.h>
+#include <AsyncAudioLatencyProbe.h>
 #include <AsyncPty.h>
 #include <AsyncPtyStreamBuf.h>
+#include <AsyncMetrics.h>
 
 
 /****************************************************************************
@@ -65,6 +71,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  ****************************************************************************/
 
 #include "Voter.h"
+#include "DiversityCombiner.h"
+#include "StreamAligner.h"
 
 
 
@@ -94,6 +102,33 @@ using namespace Async;
  *
  ****************************************************************************/
 
+/**
+ * @brief Throw away a given number of samples from an audio stream
+ */
+class SampleSkipper : public AudioPassthrough
+{
+  public:
+    SampleSkipper(void) : skip_cnt(0) {}
+
+    void skip(unsigned count) { skip_cnt = count; }
+
+    virtual int writeSamples(const float *samples, int count)
+    {
+      int skipped = min(static_cast<int>(skip_cnt), count);
+      skip_cnt -= skipped;
+      if (skipped == count)
+      {
+        return count;
+      }
+      return skipped +
+             AudioPassthrough::writeSamples(samples + skipped, count - skipped);
+    }
+
+  private:
+    unsigned skip_cnt;
+};
+
+
 /**
  * @brief A class that represents a satellite receiver
  * 
@@ -108,10 +143,18 @@ using namespace Async;
 class Voter::SatRx : public AudioSource, public sigc::trackable
 {
   public:
-    SatRx(Config &cfg, const string &rx_name, int id, int fifo_length_ms)
-      : rx_id(id), rx(0), fifo(0), sql_open(false), enabled(true),
-        mute_state(Rx::MUTE_ALL) // FIXME: Set this from the Rx object
+    SatRx(Config &cfg, const string &rx_name, int id, int fifo_length_ms,
+          bool combine, int align_length_ms)
+      : rx_id(id), rx(0), fifo(0), splitter(0), combine_tap(0), align_tap(0),
+        skipper(0),
+        buffer_samples(fifo_length_ms * INTERNAL_SAMPLE_RATE / 1000),
+        sql_open(false), enabled(true), combined(false), monitored(false),
+        skip_set(false),
+        mute_state(Rx::MUTE_ALL), // FIXME: Set this from the Rx object
+        level_avg(0.0f), level_slope(0.0f), level_cnt(0),
+        selected_cnt(0), siglev_gauge(0), fifo_gauge(0)
     {
+      timerclear(&level_time);
       rx = RxFactory::createNamedRx(cfg, rx_name);
       if (rx != 0)
       {
@@ -130,6 +173,31 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
 
 	AudioSource *prev_src = rx;
 
+	  // The audio taps give access to the audio from the receiver without
+	  // going through the voting delay buffer. They are used when combining
+	  // the audio from multiple receivers and when aligning receivers.
+	if (combine || (align_length_ms > 0))
+	{
+	  splitter = new AudioSplitter;
+	  prev_src->registerSink(splitter);
+	  if (combine)
+	  {
+	    combine_tap = new AudioPassthrough;
+	    splitter->addSink(combine_tap, true);
+	  }
+	  if (align_length_ms > 0)
+	  {
+	    align_tap = new AudioPassthrough;
+	    splitter->addSink(align_tap, true);
+	  }
+	  AudioPassthrough *main_branch = new AudioPassthrough;
+	  splitter->addSink(main_branch, true);
+	  prev_src = main_branch;
+	}
+
+	  // When aligning, the buffer must hold enough audio to find the
+	  // audio matching the end of the audio from another receiver
+	fifo_length_ms = max(fifo_length_ms, align_length_ms);
 	if (fifo_length_ms > 0)
 	{
 	  fifo = new AudioFifo(fifo_length_ms * INTERNAL_SAMPLE_RATE / 1000);
@@ -142,6 +210,13 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
 	{
 	  valve.setBlockWhenClosed(false);
 	}
+
+	if (align_length_ms > 0)
+	{
+	  skipper = new SampleSkipper;
+	  prev_src->registerSink(skipper);
+	  prev_src = skipper;
+	}
 	
 	valve.setOpen(false);
 	prev_src->registerSink(&valve);
@@ -152,7 +227,12 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
     
     ~SatRx(void)
     {
+      Metrics::remove(selected_cnt);
+      Metrics::remove(siglev_gauge);
+      Metrics::remove(fifo_gauge);
       delete fifo;
+      delete skipper;
+      delete splitter;
       rx->reset();
       delete rx;
     }
@@ -167,6 +247,27 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
       return true;
     }
 
+    void initMetrics(const std::string& voter_name)
+    {
+      string labels(Metrics::label("voter", voter_name) + "," +
+                    Metrics::label("rx", name()));
+      selected_cnt = Metrics::counter("svxlink_voter_rx_selected_total",
+          "Number of times the receiver has been selected by the voter",
+          labels);
+      siglev_gauge = Metrics::gauge("svxlink_voter_rx_signal_level",
+          "Last signal level reported by the receiver", labels);
+      fifo_gauge = Metrics::gauge("svxlink_voter_rx_fifo_samples",
+          "Number of samples buffered in the voter for the receiver", labels);
+    }
+
+    void countSelection(void)
+    {
+      if (selected_cnt != 0)
+      {
+        selected_cnt->inc();
+      }
+    }
+
     void setEnabled(bool do_enable)
     {
       if (do_enable)
@@ -185,6 +286,63 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
 
     bool isEnabled(void) const { return enabled; }
 
+    AudioSource *combineTap(void) { return combine_tap; }
+
+    AudioSource *alignTap(void) { return align_tap; }
+
+    void setCombined(bool do_combine)
+    {
+      if (do_combine == combined)
+      {
+        return;
+      }
+      combined = do_combine;
+
+        // Throw away buffered content. It has already been delivered by
+        // the active receiver. When aligning, the buffered audio is kept
+        // since it is needed to find where to continue if switching to this
+        // receiver.
+      if ((fifo != 0) && (skipper == 0))
+      {
+        fifo->clear();
+      }
+      dtmf_buf.clear();
+      selcall_buf.clear();
+    }
+
+    bool isCombined(void) const { return combined; }
+
+    void setMonitored(bool do_monitor)
+    {
+      monitored = do_monitor;
+
+        // Digits detected by a monitored receiver are dropped since they
+        // are delivered by the active receiver. Digits buffered before the
+        // receiver became monitored must not be replayed if the voter later
+        // switch to it.
+      if (monitored)
+      {
+        dtmf_buf.clear();
+        selcall_buf.clear();
+      }
+    }
+
+    bool isMonitored(void) const { return monitored; }
+
+    unsigned bufferedSamples(void) const
+    {
+      return (fifo != 0) ? fifo->samplesInFifo() : 0;
+    }
+
+    void skipSamples(unsigned count)
+    {
+      assert(skipper != 0);
+      skipper->skip(count);
+      skip_set = true;
+    }
+
+    Rx::MuteState muteState(void) const { return mute_state; }
+
     const std::string& name(void) const { return rx->name(); }
     
     bool addToneDetector(float fq, int bw, float thresh, int required_duration)
@@ -194,6 +352,20 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
     
     float signalStrength(void) const { return rx->signalStrength(); }
 
+    float smoothedSignalStrength(void) const { return level_avg; }
+
+    float predictedSignalStrength(unsigned time_ms) const
+    {
+      return level_avg + level_slope * time_ms / 1000.0f;
+    }
+
+    unsigned levelUpdateCount(void) const { return level_cnt; }
+
+    static bool hasStrongerSignal(const SatRx *a, const SatRx *b)
+    {
+      return a->signalStrength() > b->signalStrength();
+    }
+
     void setMuteState(Rx::MuteState new_mute_state)
     {
       mute_state = new_mute_state;
@@ -208,6 +380,11 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
         {
           fifo->clear();
         }
+        if (skipper != 0)
+        {
+          skipper->skip(0);
+          skip_set = false;
+        }
 	dtmf_buf.clear();
 	selcall_buf.clear();
       }
@@ -223,6 +400,18 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
     
     void stopOutput(bool do_stop)
     {
+        // When aligning, the buffer may hold more audio than the voting
+        // delay buffer. Only release the voting delay buffer unless the
+        // position to start from has been set.
+      if (!do_stop && !valve.isOpen() && (skipper != 0))
+      {
+        unsigned buffered = fifo->samplesInFifo();
+        if (!skip_set && (buffered > buffer_samples))
+        {
+          skipper->skip(buffered - buffer_samples);
+        }
+        skip_set = false;
+      }
       valve.setOpen(!do_stop);
       if (!do_stop)
       {
@@ -266,15 +455,34 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
     int		  rx_id;
     Rx		  *rx;
     AudioFifo 	  *fifo;
+    AudioSplitter *splitter;
+    AudioPassthrough *combine_tap;
+    AudioPassthrough *align_tap;
+    SampleSkipper *skipper;
+    unsigned      buffer_samples;
     AudioValve	  valve;
     DtmfBuf   	  dtmf_buf;
     SelcallBuf	  selcall_buf;
     bool      	  sql_open;
     bool          enabled;
+    bool          combined;
+    bool          monitored;
+    bool          skip_set;
     Rx::MuteState mute_state;
+    float         level_avg;
+    float         level_slope;
+    struct timeval level_time;
+    unsigned      level_cnt;
+    MetricCounter *selected_cnt;
+    MetricGauge   *siglev_gauge;
+    MetricGauge   *fifo_gauge;
     
     void onDtmfDigitDetected(char digit, int duration)
     {
+      if (combined || monitored)
+      {
+        return;
+      }
       if (!valve.isOpen())
       {
 	dtmf_buf.push_back(pair<char, int>(digit, duration));
@@ -287,6 +495,10 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
     
     void onSelcallSequenceDetected(string sequence)
     {
+      if (combined || monitored)
+      {
+        return;
+      }
       if (!valve.isOpen())
       {
 	selcall_buf.push_back(sequence);
@@ -314,8 +526,14 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
     
     void rxSignalLevelUpdated(float siglev)
     {
+      if (siglev_gauge != 0)
+      {
+        siglev_gauge->set(siglev);
+        fifo_gauge->set((fifo != 0) ? fifo->samplesInFifo() : 0);
+      }
       if (sql_open)
       {
+        updateLevelTrend(siglev);
 	signalLevelUpdated(siglev, this);
       }
     }
@@ -325,9 +543,38 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
       if (is_open != sql_open)
       {
       	sql_open = is_open;
+        if (is_open)
+        {
+          level_avg = rx->signalStrength();
+          level_slope = 0.0f;
+          level_cnt = 1;
+          gettimeofday(&level_time, NULL);
+        }
 	squelchOpen(is_open, this);
       }
     }
+
+      // Smooth the signal level and its trend using double exponential
+      // smoothing. The trend is given in level units per second since the
+      // signal level updates may not arrive at a regular interval.
+    void updateLevelTrend(float siglev)
+    {
+      struct timeval now, diff;
+      gettimeofday(&now, NULL);
+      timersub(&now, &level_time, &diff);
+      float dt = diff.tv_sec + diff.tv_usec / 1000000.0f;
+      level_time = now;
+
+      float prev_avg = level_avg;
+      level_avg = LEVEL_SMOOTHING * siglev +
+                  (1.0f - LEVEL_SMOOTHING) * (level_avg + level_slope * dt);
+      if (dt >= MIN_LEVEL_TREND_INTERVAL)
+      {
+        level_slope = LEVEL_TREND_SMOOTHING * (level_avg - prev_avg) / dt +
+                      (1.0f - LEVEL_TREND_SMOOTHING) * level_slope;
+      }
+      ++level_cnt;
+    }
 };
 
 
@@ -365,18 +612,31 @@ class Voter::SatRx : public AudioSource, public sigc::trackable
 
 Voter::Voter(Config &cfg, const std::string& name)
   : Rx(cfg, name), cfg(cfg), m_verbose(true), selector(0),
-    sm(Macho::State<Top>(this)), is_processing_event(false), command_pty(0)
+    sm(Macho::State<Top>(this)), is_processing_event(false), command_pty(0),
+    combiner(0), combine_rx_cnt(DEFAULT_COMBINE_RECEIVERS), aligner(0),
+    ref_srx(0), vote_latency_hist(0), immediate_vote_cnt(0), fast_vote_cnt(0),
+    full_delay_vote_cnt(0), switch_cnt(0)
 {
+  timerclear(&vote_start);
   Rx::setVerbose(false);
 } /* Voter::Voter */
 
 
 Voter::~Voter(void)
 {
+  Metrics::remove(vote_latency_hist);
+  Metrics::remove(immediate_vote_cnt);
+  Metrics::remove(fast_vote_cnt);
+  Metrics::remove(full_delay_vote_cnt);
+  Metrics::remove(switch_cnt);
   delete command_pty;
   command_pty = 0;
   delete selector;
   selector = 0;
+  delete combiner;
+  combiner = 0;
+  delete aligner;
+  aligner = 0;
   
     // Mute all receivers before deleting them so that we do not get any
     // unexpected updates during deletion
@@ -494,9 +754,118 @@ bool Voter::initialize(void)
     return false;
   }
   sm->setRxSwitchDelay(rx_switch_delay);
+
+  cfg.getValue(name(), "COMBINE_RECEIVERS", combine_rx_cnt);
+  if ((combine_rx_cnt < 1) || (combine_rx_cnt > MAX_COMBINE_RECEIVERS))
+  {
+    cerr << "*** ERROR: Config variable " << name()
+         << "/COMBINE_RECEIVERS out of range ("
+         << combine_rx_cnt << "). Valid range is 1 to "
+         << MAX_COMBINE_RECEIVERS << ".\n";
+    return false;
+  }
+
+  unsigned combine_delay = DEFAULT_COMBINE_DELAY;
+  cfg.getValue(name(), "COMBINE_DELAY", combine_delay);
+  if (combine_delay > MAX_COMBINE_DELAY)
+  {
+    cerr << "*** ERROR: Config variable " << name()
+         << "/COMBINE_DELAY out of range ("
+         << combine_delay << "). Valid range is 0 to "
+         << MAX_COMBINE_DELAY << ".\n";
+    return false;
+  }
+
+  unsigned align_max_delay = DEFAULT_ALIGN_MAX_DELAY;
+  cfg.getValue(name(), "ALIGN_MAX_DELAY", align_max_delay);
+  if (align_max_delay > MAX_ALIGN_MAX_DELAY)
+  {
+    cerr << "*** ERROR: Config variable " << name()
+         << "/ALIGN_MAX_DELAY out of range ("
+         << align_max_delay << "). Valid range is 0 to "
+         << MAX_ALIGN_MAX_DELAY << ".\n";
+    return false;
+  }
+  if (align_max_delay > 0)
+  {
+    aligner = new StreamAligner(align_max_delay);
+  }
+
+  float fast_vote_margin = DEFAULT_FAST_VOTE_MARGIN;
+  cfg.getValue(name(), "FAST_VOTE_MARGIN", fast_vote_margin);
+  if ((fast_vote_margin < 0.0f) || (fast_vote_margin > MAX_FAST_VOTE_MARGIN))
+  {
+    cerr << "*** ERROR: Config variable " << name()
+         << "/FAST_VOTE_MARGIN out of range ("
+         << fast_vote_margin << "). Valid range is 0 to "
+         << MAX_FAST_VOTE_MARGIN << ".\n";
+    return false;
+  }
+  sm->setFastVoteMargin(fast_vote_margin);
+
+  unsigned fast_vote_min_delay = DEFAULT_FAST_VOTE_MIN_DELAY;
+  cfg.getValue(name(), "FAST_VOTE_MIN_DELAY", fast_vote_min_delay);
+  if (fast_vote_min_delay > MAX_VOTING_DELAY)
+  {
+    cerr << "*** ERROR: Config variable " << name()
+         << "/FAST_VOTE_MIN_DELAY out of range ("
+         << fast_vote_min_delay << "). Valid range is 0 to "
+         << MAX_VOTING_DELAY << ".\n";
+    return false;
+  }
+  sm->setFastVoteMinDelay(fast_vote_min_delay);
+
+  string labels(Metrics::label("voter", name()));
+  vector<double> latency_bounds;
+  latency_bounds.push_back(0.01);
+  latency_bounds.push_back(0.025);
+  latency_bounds.push_back(0.05);
+  latency_bounds.push_back(0.1);
+  latency_bounds.push_back(0.2);
+  latency_bounds.push_back(0.3);
+  latency_bounds.push_back(0.5);
+  latency_bounds.push_back(1.0);
+  latency_bounds.push_back(2.0);
+  latency_bounds.push_back(5.0);
+  vote_latency_hist = Metrics::histogram(
+      "svxlink_voter_voting_latency_seconds",
+      "Time from the first squelch opening until a receiver was chosen",
+      latency_bounds, labels);
+  const char *votes_help =
+      "Number of times a receiver was chosen at the start of an over";
+  immediate_vote_cnt = Metrics::counter("svxlink_voter_votes_total",
+      votes_help, labels + "," + Metrics::label("decision", "immediate"));
+  fast_vote_cnt = Metrics::counter("svxlink_voter_votes_total",
+      votes_help, labels + "," + Metrics::label("decision", "fast"));
+  full_delay_vote_cnt = Metrics::counter("svxlink_voter_votes_total",
+      votes_help, labels + "," + Metrics::label("decision", "full_delay"));
+  switch_cnt = Metrics::counter("svxlink_voter_switches_total",
+      "Number of times the voter switched receiver during an over", labels);
   
   selector = new AudioSelector;
-  setHandler(selector);
+  AudioProfiler::setName(selector, name() + " selector");
+  AudioSource *prev_src = selector;
+  if (combine_rx_cnt > 1)
+  {
+    combiner = new DiversityCombiner(combine_delay);
+    AudioProfiler::setName(combiner, name() + " combiner");
+    combiner->referenceDelay.connect(
+        mem_fun(*this, &Voter::combineReferenceDelay));
+    prev_src->registerSink(combiner);
+    prev_src = combiner;
+  }
+  if (AudioLatencyProbe::isEnabled())
+  {
+      // Measure the latency caused by the voting delay
+    AudioLatencyProbe *probe = new AudioLatencyProbe(
+        AudioLatencyProbe::MEASURE, name(), name() + " output");
+    prev_src->registerSink(probe, true);
+    setHandler(probe);
+  }
+  else
+  {
+    setHandler(prev_src);
+  }
   
   string::iterator start(receivers.begin());
   for (;;)
@@ -506,7 +875,8 @@ bool Voter::initialize(void)
     if (!rx_name.empty())
     {
       cout << "\tAdding receiver: " << rx_name << endl;
-      SatRx *srx = new SatRx(cfg, rx_name, rxs.size() + 1, buffer_length);
+      SatRx *srx = new SatRx(cfg, rx_name, rxs.size() + 1, buffer_length,
+                             combiner != 0, align_max_delay);
       srx->squelchOpen.connect(mem_fun(*this, &Voter::satSquelchOpen));
       srx->signalLevelUpdated.connect(
 	      mem_fun(*this, &Voter::satSignalLevelUpdated));
@@ -518,9 +888,18 @@ bool Voter::initialize(void)
       	return false;
       }
       srx->setMuteState(MUTE_ALL);
+      srx->initMetrics(name());
       srx->toneDetected.connect(toneDetected.make_slot());
       selector->addSource(srx);
       selector->enableAutoSelect(srx, 0);
+      if (combiner != 0)
+      {
+        combiner->addSource(srx->combineTap());
+      }
+      if (aligner != 0)
+      {
+        aligner->addSource(srx->alignTap());
+      }
       
       rxs.push_back(srx);
     }
@@ -714,6 +1093,177 @@ Voter::SatRx *Voter::findBestRx(void) const
 } /* Voter::findBestRx */
 
 
+void Voter::updateMonitoredRxs(SatRx *active_srx, bool do_monitor)
+{
+  if ((combiner == 0) && (aligner == 0))
+  {
+    return;
+  }
+
+    // Find the receivers that should deliver audio besides the active one,
+    // strongest signal first. When combining, the strongest ones are
+    // combined. When aligning, all receivers with an open squelch are
+    // monitored so that their delay is known if the voter switch to them.
+  vector<SatRx *> candidates;
+  if (do_monitor && (active_srx != 0))
+  {
+    list<SatRx *>::const_iterator it;
+    for (it=rxs.begin(); it!=rxs.end(); ++it)
+    {
+      if ((*it != active_srx) && (*it)->isEnabled() &&
+          (*it)->squelchIsOpen())
+      {
+        candidates.push_back(*it);
+      }
+    }
+    sort(candidates.begin(), candidates.end(), SatRx::hasStrongerSignal);
+  }
+  size_t combine_cnt = 0;
+  if (combiner != 0)
+  {
+    combine_cnt = min(candidates.size(), size_t(combine_rx_cnt - 1));
+  }
+  if (aligner == 0)
+  {
+    candidates.resize(combine_cnt);
+  }
+
+    // Weight the combined receivers by their signal level, relative to the
+    // active receiver. The signal level is handled as if it was given in dB.
+  float active_siglev =
+      (active_srx != 0) ? active_srx->signalStrength() : 0.0f;
+  list<SatRx *>::iterator it;
+  for (it=rxs.begin(); it!=rxs.end(); ++it)
+  {
+    SatRx *srx = *it;
+    if (srx == active_srx)
+    {
+        // The active receiver is the reference. Its buffer is cleared if it
+        // was combined before it became active, unless aligning.
+      srx->setCombined(false);
+      srx->setMonitored(false);
+      if (combiner != 0)
+      {
+        combiner->setWeight(srx->combineTap(), 0.0f);
+      }
+      continue;
+    }
+    vector<SatRx *>::iterator cit =
+        find(candidates.begin(), candidates.end(), srx);
+    if (cit != candidates.end())
+    {
+      bool do_combine = size_t(cit - candidates.begin()) < combine_cnt;
+      srx->setCombined(do_combine);
+      srx->setMonitored(true);
+      if (srx->muteState() != MUTE_NONE)
+      {
+        srx->setMuteState(MUTE_NONE);
+      }
+      if (combiner != 0)
+      {
+        float weight = 0.0f;
+        if (do_combine)
+        {
+            // Copy the limit since std::min take its arguments by reference
+            // and the static member is not defined outside of the class
+          const float max_diff = MAX_COMBINE_LEVEL_DIFF;
+          float diff = srx->signalStrength() - active_siglev;
+          diff = max(-max_diff, min(max_diff, diff));
+          weight = pow(10.0f, diff / 20.0f);
+        }
+        combiner->setWeight(srx->combineTap(), weight);
+      }
+    }
+    else if (srx->isMonitored())
+    {
+      srx->setCombined(false);
+      srx->setMonitored(false);
+      srx->setMuteState(MUTE_CONTENT);
+      if (combiner != 0)
+      {
+        combiner->setWeight(srx->combineTap(), 0.0f);
+      }
+    }
+  }
+} /* Voter::updateMonitoredRxs */
+
+
+void Voter::setReferenceRx(SatRx *srx)
+{
+  ref_srx = srx;
+  if (aligner != 0)
+  {
+    aligner->setReference((srx != 0) ? srx->alignTap() : 0);
+  }
+} /* Voter::setReferenceRx */
+
+
+unsigned Voter::combineReferenceDelay(void)
+{
+    // The combined receivers are tapped before the voting delay buffer but
+    // the reference audio from the active receiver pass through it
+  return (ref_srx != 0) ? ref_srx->bufferedSamples() : 0;
+} /* Voter::combineReferenceDelay */
+
+
+void Voter::alignSwitch(SatRx *from_srx, SatRx *to_srx)
+{
+  if (aligner == 0)
+  {
+    return;
+  }
+
+    // Skip buffered samples that have already been sent from the old
+    // receiver. If the new receiver is more delayed than the old one, the
+    // matching sample has not arrived yet so samples are skipped when they
+    // arrive.
+  unsigned skip = 0;
+  if (aligner->switchSkip(from_srx->alignTap(), from_srx->bufferedSamples(),
+                          to_srx->alignTap(), to_srx->bufferedSamples(),
+                          skip))
+  {
+    to_srx->skipSamples(skip);
+  }
+} /* Voter::alignSwitch */
+
+
+void Voter::voteStarted(void)
+{
+  gettimeofday(&vote_start, NULL);
+} /* Voter::voteStarted */
+
+
+unsigned Voter::voteTime(void) const
+{
+  struct timeval now, diff;
+  gettimeofday(&now, NULL);
+  timersub(&now, &vote_start, &diff);
+  return diff.tv_sec * 1000 + diff.tv_usec / 1000;
+} /* Voter::voteTime */
+
+
+void Voter::voteDecided(VoteDecision decision)
+{
+  if (vote_latency_hist == 0)
+  {
+    return;
+  }
+  vote_latency_hist->observe(voteTime() / 1000.0);
+  switch (decision)
+  {
+    case VOTE_IMMEDIATE:
+      immediate_vote_cnt->inc();
+      break;
+    case VOTE_FAST:
+      fast_vote_cnt->inc();
+      break;
+    case VOTE_FULL_DELAY:
+      full_delay_vote_cnt->inc();
+      break;
+  }
+} /* Voter::voteDecided */
+
+
 
 /****************************************************************************
  *
@@ -919,8 +1469,10 @@ void Voter::Idle::satSquelchOpen(SatRx *srx, bool is_open)
   SUPER::satSquelchOpen(srx, is_open);
   if (is_open)
   {
+    voter().voteStarted();
     if (srx->signalStrength() * hysteresis() > 100.0f)
     {
+      voter().voteDecided(VOTE_IMMEDIATE);
       setState<ActiveRxSelected>(bestSrx());
     }
     else
@@ -959,6 +1511,7 @@ void Voter::VotingDelay::satSquelchOpen(SatRx *srx, bool is_open)
   {
     if (srx->signalStrength() * hysteresis() > 100.0f)
     {
+      voter().voteDecided(VOTE_IMMEDIATE);
       setState<ActiveRxSelected>(bestSrx());
     }
   }
@@ -972,14 +1525,86 @@ void Voter::VotingDelay::satSquelchOpen(SatRx *srx, bool is_open)
 } /* Voter::VotingDelay::satSquelchOpen */
 
 
+void Voter::VotingDelay::satSignalLevelUpdated(SatRx *srx, float siglev)
+{
+  SUPER::satSignalLevelUpdated(srx, siglev);
+  if (fastVoteMargin() <= 0.0f)
+  {
+    return;
+  }
+  SatRx *dominant_srx = dominantSrx();
+  if (dominant_srx != 0)
+  {
+    voter().voteDecided(VOTE_FAST);
+    setState<ActiveRxSelected>(dominant_srx);
+  }
+} /* Voter::VotingDelay::satSignalLevelUpdated */
+
+
 void Voter::VotingDelay::timerExpired(void)
 {
   assert(bestSrx() != 0);
   assert(bestSrx()->squelchIsOpen());
+  voter().voteDecided(VOTE_FULL_DELAY);
   setState<ActiveRxSelected>(bestSrx());
 } /* Voter::VotingDelay::timerExpired */
 
 
+Voter::SatRx *Voter::VotingDelay::dominantSrx(void)
+{
+  unsigned vote_time = voter().voteTime();
+  if (vote_time < fastVoteMinDelay())
+  {
+    return 0;
+  }
+  unsigned time_left =
+      (votingDelay() > vote_time) ? votingDelay() - vote_time : 0;
+
+    // Find the receiver with the strongest predicted signal level at the
+    // end of the voting delay
+  const list<SatRx *>& rxs = voter().rxs;
+  SatRx *best_srx = 0;
+  float best_level = 0.0f;
+  list<SatRx *>::const_iterator it;
+  for (it=rxs.begin(); it!=rxs.end(); ++it)
+  {
+    float level = (*it)->predictedSignalStrength(time_left);
+    if ((*it)->squelchIsOpen() && ((best_srx == 0) || (level > best_level)))
+    {
+      best_srx = *it;
+      best_level = level;
+    }
+  }
+  if ((best_srx == 0) ||
+      (best_srx->levelUpdateCount() < FAST_VOTE_MIN_LEVEL_UPDATES))
+  {
+    return 0;
+  }
+
+    // The receiver must be clearly stronger than all other receivers, both
+    // now and at the end of the voting delay
+  for (it=rxs.begin(); it!=rxs.end(); ++it)
+  {
+    if ((*it == best_srx) || !(*it)->squelchIsOpen())
+    {
+      continue;
+    }
+    float level_diff = best_srx->smoothedSignalStrength() -
+                       (*it)->smoothedSignalStrength();
+    float predicted_diff =
+        best_level - (*it)->predictedSignalStrength(time_left);
+    if ((level_diff < fastVoteMargin()) ||
+        (predicted_diff < fastVoteMargin()))
+    {
+      return 0;
+    }
+  }
+
+  return best_srx;
+
+} /* Voter::VotingDelay::dominantSrx */
+
+
 
 /****************************************************************************
  *
@@ -991,6 +1616,8 @@ void Voter::ActiveRxSelected::init(SatRx *srx)
 {
   assert(srx != 0);
   box().active_srx = srx;
+  srx->countSelection();
+  voter().setReferenceRx(srx);
   if (muteState() == MUTE_CONTENT)
   {
     voter().muteAll(MUTE_CONTENT);
@@ -1006,6 +1633,7 @@ void Voter::ActiveRxSelected::init(SatRx *srx)
 void Voter::ActiveRxSelected::exit(void)
 {
   runTask(bind(mem_fun(activeSrx(), &SatRx::stopOutput), true));  
+  voter().setReferenceRx(0);
 } /* Voter::ActiveRxSelected::exit */
 
 
@@ -1029,9 +1657,27 @@ int Voter::ActiveRxSelected::sqlRxId(void)
 
 void Voter::ActiveRxSelected::changeActiveSrx(SatRx *srx)
 {
+  voter().alignSwitch(activeSrx(), srx);
   voter().selector->selectSource(srx);
-  activeSrx()->setMuteState(MUTE_CONTENT);
+  if ((voter().aligner != 0) && activeSrx()->squelchIsOpen() &&
+      (muteState() == Rx::MUTE_NONE))
+  {
+      // Keep receiving audio from the old receiver so that its delay is
+      // still known if switching back to it
+    activeSrx()->setMonitored(true);
+  }
+  else
+  {
+    activeSrx()->setMuteState(MUTE_CONTENT);
+  }
   box().active_srx = srx;
+  srx->setMonitored(false);
+  srx->countSelection();
+  if (voter().switch_cnt != 0)
+  {
+    voter().switch_cnt->inc();
+  }
+  voter().setReferenceRx(srx);
   if (muteState() == Rx::MUTE_NONE)
   {
     activeSrx()->setMuteState(MUTE_NONE);
@@ -1078,6 +1724,7 @@ void Voter::SquelchOpen::exit(void)
 	 << endl;
   }
   
+  voter().updateMonitoredRxs(activeSrx(), false);
   runTask(bind(mem_fun(voter(), &Voter::setSquelchState), false));
   runTask(mem_fun(voter(), &Voter::printSquelchState));
 } /* Voter::SquelchOpen::exit */
@@ -1162,10 +1809,9 @@ void Voter::SqlCloseWait::timerExpired(void)
 void Voter::Receiving::entry(void)
 {
   //cout << "### Receiving::entry\n";
-  if (revoteInterval() >= MIN_REVOTE_INTERVAL)
-  {
-    startTimer(revoteInterval());
-  }
+  voter().updateMonitoredRxs(activeSrx(),
+                              TOP::box().mute_state == MUTE_NONE);
+  startRevoteTimer();
 } /* Voter::Receiving::entry */
 
 
@@ -1182,8 +1828,12 @@ void Voter::Receiving::timerExpired(void)
   
   assert(activeSrx() != 0);
   //assert(bestSrx() != 0);
+
+  voter().updateMonitoredRxs(activeSrx(),
+                              TOP::box().mute_state == MUTE_NONE);
   
-  if ((bestSrx() != 0) && (bestSrx() != activeSrx()))
+  if ((revoteInterval() >= MIN_REVOTE_INTERVAL) &&
+      (bestSrx() != 0) && (bestSrx() != activeSrx()))
   {
     float best_srx_siglev = bestSrx()->signalStrength();
     float active_srx_siglev = activeSrx()->signalStrength();
@@ -1193,11 +1843,23 @@ void Voter::Receiving::timerExpired(void)
       return;
     }
   }
+  startRevoteTimer();
+} /* Voter::Receiving::timerExpired */
+
+
+void Voter::Receiving::startRevoteTimer(void)
+{
   if (revoteInterval() >= MIN_REVOTE_INTERVAL)
   {
     startTimer(revoteInterval());
   }
-} /* Voter::Receiving::timerExpired */
+  else if ((voter().combiner != 0) || (voter().aligner != 0))
+  {
+      // Combining and aligning need the timer to update the monitored
+      // receivers even if revoting is disabled
+    startTimer(DEFAULT_REVOTE_INTERVAL);
+  }
+} /* Voter::Receiving::startRevoteTimer */
 
 
 
@@ -1227,7 +1889,7 @@ void Voter::SwitchActiveRx::init(SatRx *srx)
 void Voter::SwitchActiveRx::exit(void)
 {
   //cout << "### SwitchActiveRx::exit\n";
-  if (box().switch_to_srx != 0)
+  if ((box().switch_to_srx != 0) && !box().switch_to_srx->isMonitored())
   {
     box().switch_to_srx->setMuteState(MUTE_CONTENT);
   }
@@ -35,6 +35,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include <sys/time.h>
+
 #include <list>
 
 
@@ -69,7 +71,11 @@ namespace Async
   class Timer;
   class AudioSelector;
   class Pty;
+  class MetricCounter;
+  class MetricHistogram;
 };
+class DiversityCombiner;
+class StreamAligner;
 
 
 /****************************************************************************
@@ -120,6 +126,25 @@ namespace Async
 This class implements a receiver voter. A voter is a device that choose the
 best receiver from a pool of receivers tuned to the same frequency. This
 make it possible to cover a larger geographical area with a radio system.
+
+Optionally, the audio from the best receivers can be combined instead of just
+using the best one. The audio from each receiver is time aligned with the
+audio from the chosen receiver and the streams are weighted by their signal
+level before being added together. This improve the audio quality when no
+receiver have a really good signal.
+
+Receivers connected over different kinds of links may have quite different
+delays. To make switching between receivers seamless, the voter can track the
+delay of each receiver compared to the chosen one. When switching, the audio
+from the new receiver then continue exactly where the audio from the old
+receiver ended, without repeating or skipping any audio.
+
+To keep the voting delay short, the voter can optionally decide which receiver
+to use before the voting delay has expired. The signal level reported by each
+receiver is smoothed and its trend is used to predict the level at the end of
+the voting delay. If one receiver is predicted to be clearly stronger than all
+others, it is chosen right away. The full voting delay is only used when the
+signal levels are close.
 */
 class Voter : public Rx
 {
@@ -191,6 +216,11 @@ class Voter : public Rx
     static CONSTEXPR unsigned DEFAULT_SQL_CLOSE_REVOTE_DELAY = 500;
     static CONSTEXPR unsigned DEFAULT_REVOTE_INTERVAL        = 1000;
     static CONSTEXPR unsigned DEFAULT_RX_SWITCH_DELAY        = 500;
+    static CONSTEXPR unsigned DEFAULT_COMBINE_RECEIVERS      = 1;
+    static CONSTEXPR unsigned DEFAULT_COMBINE_DELAY          = 100;
+    static CONSTEXPR unsigned DEFAULT_ALIGN_MAX_DELAY        = 0;
+    static CONSTEXPR float    DEFAULT_FAST_VOTE_MARGIN       = 0.0f;
+    static CONSTEXPR unsigned DEFAULT_FAST_VOTE_MIN_DELAY    = 100;
     
     static CONSTEXPR unsigned MAX_VOTING_DELAY               = 5000;
     static CONSTEXPR unsigned MAX_BUFFER_LENGTH              = MAX_VOTING_DELAY;
@@ -199,6 +229,20 @@ class Voter : public Rx
     static CONSTEXPR unsigned MIN_REVOTE_INTERVAL            = 100;
     static CONSTEXPR unsigned MAX_REVOTE_INTERVAL            = 60000;
     static CONSTEXPR unsigned MAX_RX_SWITCH_DELAY            = 3000;
+    static CONSTEXPR unsigned MAX_COMBINE_RECEIVERS          = 16;
+    static CONSTEXPR unsigned MAX_COMBINE_DELAY              = 500;
+    static CONSTEXPR float    MAX_COMBINE_LEVEL_DIFF         = 40.0f;
+    static CONSTEXPR unsigned MAX_ALIGN_MAX_DELAY            = 1000;
+    static CONSTEXPR float    MAX_FAST_VOTE_MARGIN           = 100.0f;
+    static CONSTEXPR unsigned FAST_VOTE_MIN_LEVEL_UPDATES    = 2;
+    static CONSTEXPR float    LEVEL_SMOOTHING                = 0.5f;
+    static CONSTEXPR float    LEVEL_TREND_SMOOTHING          = 0.3f;
+    static CONSTEXPR float    MIN_LEVEL_TREND_INTERVAL       = 0.01f;
+
+    typedef enum
+    {
+      VOTE_IMMEDIATE, VOTE_FAST, VOTE_FULL_DELAY
+    } VoteDecision;
 
     class SatRx;
 
@@ -212,8 +256,10 @@ class Voter : public Rx
 	  : voting_delay(DEFAULT_VOTING_DEALAY), hysteresis(DEFAULT_HYSTERESIS),
 	    sql_close_revote_delay(DEFAULT_SQL_CLOSE_REVOTE_DELAY),
 	    rx_switch_delay(DEFAULT_RX_SWITCH_DELAY),
-	    revote_interval(DEFAULT_REVOTE_INTERVAL), voter(0), best_srx(0),
-	    mute_state(MUTE_ALL), task_timer(0), event_timer(0)
+	    revote_interval(DEFAULT_REVOTE_INTERVAL),
+	    fast_vote_margin(DEFAULT_FAST_VOTE_MARGIN),
+	    fast_vote_min_delay(DEFAULT_FAST_VOTE_MIN_DELAY), voter(0),
+	    best_srx(0), mute_state(MUTE_ALL), task_timer(0), event_timer(0)
 	{
 	  event_timer.setEnable(false);
 	}
@@ -223,6 +269,8 @@ class Voter : public Rx
 	unsigned	sql_close_revote_delay;
 	unsigned	rx_switch_delay;
 	unsigned	revote_interval;
+	float		fast_vote_margin;
+	unsigned	fast_vote_min_delay;
 	Voter		*voter;
 	SatRx		*best_srx;
         Rx::MuteState   mute_state;
@@ -258,6 +306,16 @@ class Voter : public Rx
 	box().revote_interval = interval_ms;
       }
       unsigned revoteInterval(void) { return box().revote_interval; }
+      void setFastVoteMargin(float margin)
+      {
+        box().fast_vote_margin = margin;
+      }
+      float fastVoteMargin(void) { return box().fast_vote_margin; }
+      void setFastVoteMinDelay(unsigned delay_ms)
+      {
+        box().fast_vote_min_delay = delay_ms;
+      }
+      unsigned fastVoteMinDelay(void) { return box().fast_vote_min_delay; }
       
 	// Machine's event protocol
       virtual void timerExpired(void) { }
@@ -314,10 +372,12 @@ class Voter : public Rx
 
       virtual void timerExpired(void);
       virtual void satSquelchOpen(SatRx *srx, bool is_open);
+      virtual void satSignalLevelUpdated(SatRx *srx, float siglev);
 
       private:
 	void entry(void);
 	void exit(void);
+	SatRx *dominantSrx(void);
 	
     };
 
@@ -378,6 +438,7 @@ class Voter : public Rx
       private:
 	void entry(void);
 	void exit(void);
+	void startRevoteTimer(void);
     };
 
     SUBSTATE(SwitchActiveRx, SquelchOpen)
@@ -412,6 +473,16 @@ class Voter : public Rx
     EventQueue		  event_queue;
     Async::Pty            *command_pty;
     std::string           command_buf;
+    DiversityCombiner     *combiner;
+    unsigned              combine_rx_cnt;
+    StreamAligner         *aligner;
+    SatRx                 *ref_srx;
+    struct timeval        vote_start;
+    Async::MetricHistogram *vote_latency_hist;
+    Async::MetricCounter  *immediate_vote_cnt;
+    Async::MetricCounter  *fast_vote_cnt;
+    Async::MetricCounter  *full_delay_vote_cnt;
+    Async::MetricCounter  *switch_cnt;
     
     void dispatchEvent(Macho::IEvent<Top> *event);
     void satSquelchOpen(bool is_open, SatRx *rx);
@@ -422,6 +493,13 @@ class Voter : public Rx
     void resetAll(void);
     void printSquelchState(void);
     SatRx *findBestRx(void) const;
+    void updateMonitoredRxs(SatRx *active_srx, bool do_monitor);
+    void setReferenceRx(SatRx *srx);
+    unsigned combineReferenceDelay(void);
+    void alignSwitch(SatRx *from_srx, SatRx *to_srx);
+    void voteStarted(void);
+    unsigned voteTime(void) const;
+    void voteDecided(VoteDecision decision);
     void onCommandPtyInput(const void *buf, size_t count);
     void handlePtyCommand(const std::string &full_command);
     void setRxEnabled(const std::string &rx_name, bool do_enable);
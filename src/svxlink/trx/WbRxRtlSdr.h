@@ -57,6 +57,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  ****************************************************************************/
 
+#include "RtlSdr.h"
 
 
 /****************************************************************************
@@ -69,7 +70,6 @@ namespace Async
 {
   class Config;
 };
-class RtlSdr;
 class Ddr;
 
 
@@ -124,7 +124,8 @@ is read from the given section in the given configuration file.
 class WbRxRtlSdr : public sigc::trackable
 {
   public:
-    typedef std::complex<float> Sample;
+    typedef RtlSdr::Sample Sample;
+    typedef RtlSdr::IqBuffer IqBuffer;
 
     static WbRxRtlSdr *instance(Async::Config &cfg, const std::string &name);
 
@@ -191,13 +192,13 @@ class WbRxRtlSdr : public sigc::trackable
 
     /**
      * @brief   A signal that is emitted when new samples have been received
-     * @param   samples A vector of received samples
+     * @param   samples A handle to a block of received samples
      *
      * Connecting to this signal is the way to get samples from the DVB-T
      * dongle. The format is a vector of complex floats (I/Q) with a range from
      * -1 to 1.
      */
-    sigc::signal<void, std::vector<Sample> > iqReceived;
+    sigc::signal<void, const IqBuffer&> iqReceived;
     
     /**
      * @brief   A signal that is emitted when the ready state changes